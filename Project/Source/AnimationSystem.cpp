@@ -0,0 +1,509 @@
+///////////////////////////////////////////////////////////////////////////////
+// animationsystem.cpp
+// ============
+// evaluate keyframed scene values in batches across the worker threads
+///////////////////////////////////////////////////////////////////////////////
+
+#include "AnimationSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <thread>
+
+#if defined(_MSC_VER) || defined(__SSE2__)
+#include <emmintrin.h>
+#define ANIMATION_SSE2
+#endif
+
+// declaration of global variables
+namespace
+{
+	// channels evaluated together by one worker at the least
+	const size_t ANIMATION_GRAIN_SIZE = 1024;
+
+	/***********************************************************
+	 *  EvaluateSegment()
+	 *
+	 *  Evaluate the cubic of a segment at the passed in time,
+	 *  clamped to the segment.  This is the scalar form of the
+	 *  SSE loop in EvaluateChannels().
+	 ***********************************************************/
+	float EvaluateSegment(const float* coefficients, float startTime, float inverseSpan, float time)
+	{
+		float u = std::min(std::max((time - startTime) * inverseSpan, 0.0f), 1.0f);
+		return((((coefficients[0] * u) + coefficients[1]) * u + coefficients[2]) * u + coefficients[3]);
+	}
+
+	/***********************************************************
+	 *  EvaluateKeys()
+	 *
+	 *  Evaluate a track straight from its keys, searching for
+	 *  the key before the time and blending with the Hermite
+	 *  basis, as a reference for the segments.
+	 ***********************************************************/
+	float EvaluateKeys(ANIMATION_INTERPOLATION interpolation, const std::vector<ANIMATION_KEY>& keys, float time)
+	{
+		if (time <= keys.front().time)
+		{
+			return(keys.front().value);
+		}
+		if (time >= keys.back().time)
+		{
+			return(keys.back().value);
+		}
+
+		size_t i = 0;
+		while (keys[i + 1].time <= time)
+		{
+			i++;
+		}
+		if (interpolation == ANIMATION_STEP)
+		{
+			return(keys[i].value);
+		}
+
+		float span = keys[i + 1].time - keys[i].time;
+		float u = (time - keys[i].time) / span;
+		if (interpolation == ANIMATION_LINEAR)
+		{
+			return(keys[i].value + ((keys[i + 1].value - keys[i].value) * u));
+		}
+
+		float tangents[2];
+		for (int k = 0; k < 2; k++)
+		{
+			size_t key = i + k;
+			size_t previous = (key > 0) ? (key - 1) : key;
+			size_t next = (key + 1 < keys.size()) ? (key + 1) : key;
+			tangents[k] = (keys[next].value - keys[previous].value) / (keys[next].time - keys[previous].time);
+		}
+		float u2 = u * u;
+		float u3 = u2 * u;
+		return((((2.0f * u3) - (3.0f * u2) + 1.0f) * keys[i].value) +
+			((u3 - (2.0f * u2) + u) * span * tangents[0]) +
+			(((-2.0f * u3) + (3.0f * u2)) * keys[i + 1].value) +
+			((u3 - u2) * span * tangents[1]));
+	}
+}
+
+/***********************************************************
+ *  AnimationSystem()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+AnimationSystem::AnimationSystem()
+{
+}
+
+/***********************************************************
+ *  ~AnimationSystem()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+AnimationSystem::~AnimationSystem()
+{
+}
+
+/***********************************************************
+ *  CreateClip()
+ *
+ *  This method is used for creating an empty clip of the
+ *  passed in length, which either loops or holds its last
+ *  values once played through.
+ ***********************************************************/
+int AnimationSystem::CreateClip(float duration, bool bLoop)
+{
+	ANIMATION_CLIP clip;
+	clip.duration = std::max(duration, 0.001f);
+	clip.bLoop = bLoop;
+	m_clips.push_back(clip);
+	return(static_cast<int>(m_clips.size()) - 1);
+}
+
+/***********************************************************
+ *  AddTrack()
+ *
+ *  This method is used for turning the keys of one track
+ *  into segments in the pool.  Each segment is the Hermite
+ *  curve between two keys written as a polynomial in the
+ *  fraction of the segment, so evaluating it needs neither
+ *  the keys nor the kind of interpolation.  The tangent of
+ *  each key of a cubic track is the slope between its
+ *  neighbors, so the curve passes smoothly through every
+ *  key.  Returns -1 when the key times are not increasing.
+ ***********************************************************/
+int AnimationSystem::AddTrack(int clip, ANIMATION_INTERPOLATION interpolation, const std::vector<ANIMATION_KEY>& keys)
+{
+	if ((clip < 0) || (clip >= m_clips.size()) || (keys.size() == 0))
+	{
+		return(-1);
+	}
+	for (size_t i = 1; i < keys.size(); i++)
+	{
+		if (keys[i].time <= keys[i - 1].time)
+		{
+			std::cout << "Animation keys must have increasing times" << std::endl;
+			return(-1);
+		}
+	}
+
+	ANIMATION_CLIP& animationClip = m_clips[clip];
+	animationClip.trackSegmentStarts.push_back(static_cast<uint32_t>(m_segmentStartTimes.size()));
+	animationClip.trackSegmentCounts.push_back(static_cast<uint32_t>(keys.size()));
+
+	std::vector<float> tangents(keys.size(), 0.0f);
+	if (interpolation == ANIMATION_CUBIC)
+	{
+		for (size_t i = 0; i < keys.size(); i++)
+		{
+			size_t previous = (i > 0) ? (i - 1) : i;
+			size_t next = (i + 1 < keys.size()) ? (i + 1) : i;
+			if (next != previous)
+			{
+				tangents[i] = (keys[next].value - keys[previous].value) / (keys[next].time - keys[previous].time);
+			}
+		}
+	}
+
+	for (size_t i = 0; i < keys.size(); i++)
+	{
+		float startValue = keys[i].value;
+		float cubic = 0.0f;
+		float square = 0.0f;
+		float linear = 0.0f;
+		float inverseSpan = 0.0f;
+		if (i + 1 < keys.size())
+		{
+			float span = keys[i + 1].time - keys[i].time;
+			float endValue = keys[i + 1].value;
+			inverseSpan = 1.0f / span;
+			if (interpolation == ANIMATION_CUBIC)
+			{
+				float startSlope = tangents[i] * span;
+				float endSlope = tangents[i + 1] * span;
+				cubic = (2.0f * startValue) - (2.0f * endValue) + startSlope + endSlope;
+				square = (3.0f * endValue) - (3.0f * startValue) - (2.0f * startSlope) - endSlope;
+				linear = startSlope;
+			}
+			else if (interpolation == ANIMATION_LINEAR)
+			{
+				linear = endValue - startValue;
+			}
+		}
+
+		m_segmentStartTimes.push_back(keys[i].time);
+		m_segmentInverseSpans.push_back(inverseSpan);
+		m_segmentCoefficients.push_back(cubic);
+		m_segmentCoefficients.push_back(square);
+		m_segmentCoefficients.push_back(linear);
+		m_segmentCoefficients.push_back(startValue);
+	}
+
+	return(static_cast<int>(animationClip.trackSegmentStarts.size()) - 1);
+}
+
+/***********************************************************
+ *  Play()
+ *
+ *  This method is used for starting a clip at the passed in
+ *  time and speed, binding each of its tracks to a value.
+ *  The bound channels are appended to the channel arrays.
+ *  Returns -1 when the targets do not match the tracks.
+ ***********************************************************/
+int AnimationSystem::Play(int clip, const std::vector<float*>& targets, float speed, float startTime)
+{
+	if ((clip < 0) || (clip >= m_clips.size()) || (targets.size() != m_clips[clip].trackSegmentStarts.size()))
+	{
+		std::cout << "Animation targets do not match the tracks of clip " << clip << std::endl;
+		return(-1);
+	}
+
+	const ANIMATION_CLIP& animationClip = m_clips[clip];
+	ANIMATION_PLAYBACK playback;
+	playback.clip = clip;
+	playback.speed = speed;
+	playback.time = startTime;
+	m_playbacks.push_back(playback);
+	uint32_t playbackIndex = static_cast<uint32_t>(m_playbacks.size()) - 1;
+
+	for (size_t i = 0; i < targets.size(); i++)
+	{
+		if (NULL == targets[i])
+		{
+			continue;
+		}
+		m_channelSegmentStarts.push_back(animationClip.trackSegmentStarts[i]);
+		m_channelSegmentEnds.push_back(animationClip.trackSegmentStarts[i] + animationClip.trackSegmentCounts[i]);
+		m_channelPlaybacks.push_back(playbackIndex);
+		m_channelSegments.push_back(animationClip.trackSegmentStarts[i]);
+		m_channelTimes.push_back(0.0f);
+		m_channelTargets.push_back(targets[i]);
+	}
+
+	return(static_cast<int>(playbackIndex));
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for stopping every playing clip and
+ *  removing every clip and segment.
+ ***********************************************************/
+void AnimationSystem::Clear()
+{
+	m_clips.clear();
+	m_playbacks.clear();
+	m_playbackTimes.clear();
+	m_segmentStartTimes.clear();
+	m_segmentInverseSpans.clear();
+	m_segmentCoefficients.clear();
+	m_channelSegmentStarts.clear();
+	m_channelSegmentEnds.clear();
+	m_channelPlaybacks.clear();
+	m_channelSegments.clear();
+	m_channelTimes.clear();
+	m_channelTargets.clear();
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for advancing the clock of every
+ *  playing clip, wrapping looped clips and holding the
+ *  others at their end, and then evaluating every channel
+ *  across the workers.
+ ***********************************************************/
+void AnimationSystem::Update(float deltaSeconds, JobSystem* pJobSystem)
+{
+	m_playbackTimes.resize(m_playbacks.size());
+	for (size_t i = 0; i < m_playbacks.size(); i++)
+	{
+		ANIMATION_PLAYBACK& playback = m_playbacks[i];
+		const ANIMATION_CLIP& clip = m_clips[playback.clip];
+		playback.time += deltaSeconds * playback.speed;
+		if (clip.bLoop)
+		{
+			playback.time = fmodf(playback.time, clip.duration);
+			if (playback.time < 0.0f)
+			{
+				playback.time += clip.duration;
+			}
+		}
+		else
+		{
+			playback.time = std::min(std::max(playback.time, 0.0f), clip.duration);
+		}
+		m_playbackTimes[i] = playback.time;
+	}
+
+	if (NULL != pJobSystem)
+	{
+		pJobSystem->ParallelFor(m_channelTargets.size(), ANIMATION_GRAIN_SIZE, [this](size_t begin, size_t end)
+			{
+				EvaluateChannels(begin, end);
+			});
+	}
+	else
+	{
+		EvaluateChannels(0, m_channelTargets.size());
+	}
+}
+
+/***********************************************************
+ *  EvaluateChannels()
+ *
+ *  This method is used for evaluating a range of channels
+ *  in two passes.  The first moves each channel to the
+ *  segment containing its clip time, continuing from the
+ *  segment of the update before, so it usually moves by no
+ *  more than one, and starting over when a loop wrapped.
+ *  The second loads the coefficients of the segments of
+ *  four channels and transposes them, so each register
+ *  holds one coefficient of all four, which are then
+ *  evaluated together with Horner's rule.
+ ***********************************************************/
+void AnimationSystem::EvaluateChannels(size_t begin, size_t end)
+{
+	for (size_t channel = begin; channel < end; channel++)
+	{
+		float time = m_playbackTimes[m_channelPlaybacks[channel]];
+		uint32_t segment = m_channelSegments[channel];
+		uint32_t lastSegment = m_channelSegmentEnds[channel] - 1;
+		if (time < m_segmentStartTimes[segment])
+		{
+			segment = m_channelSegmentStarts[channel];
+		}
+		while ((segment < lastSegment) && (m_segmentStartTimes[segment + 1] <= time))
+		{
+			segment++;
+		}
+		m_channelSegments[channel] = segment;
+		m_channelTimes[channel] = time;
+	}
+
+	size_t channel = begin;
+
+#ifdef ANIMATION_SSE2
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	for (; (channel + 4) <= end; channel += 4)
+	{
+		const uint32_t* segments = &m_channelSegments[channel];
+		__m128 cubic = _mm_loadu_ps(&m_segmentCoefficients[segments[0] * 4]);
+		__m128 square = _mm_loadu_ps(&m_segmentCoefficients[segments[1] * 4]);
+		__m128 linear = _mm_loadu_ps(&m_segmentCoefficients[segments[2] * 4]);
+		__m128 constant = _mm_loadu_ps(&m_segmentCoefficients[segments[3] * 4]);
+		_MM_TRANSPOSE4_PS(cubic, square, linear, constant);
+
+		__m128 startTime = _mm_setr_ps(
+			m_segmentStartTimes[segments[0]],
+			m_segmentStartTimes[segments[1]],
+			m_segmentStartTimes[segments[2]],
+			m_segmentStartTimes[segments[3]]);
+		__m128 inverseSpan = _mm_setr_ps(
+			m_segmentInverseSpans[segments[0]],
+			m_segmentInverseSpans[segments[1]],
+			m_segmentInverseSpans[segments[2]],
+			m_segmentInverseSpans[segments[3]]);
+		__m128 u = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&m_channelTimes[channel]), startTime), inverseSpan);
+		u = _mm_min_ps(_mm_max_ps(u, zero), one);
+
+		__m128 value = _mm_add_ps(_mm_mul_ps(cubic, u), square);
+		value = _mm_add_ps(_mm_mul_ps(value, u), linear);
+		value = _mm_add_ps(_mm_mul_ps(value, u), constant);
+
+		alignas(16) float results[4];
+		_mm_store_ps(results, value);
+		*m_channelTargets[channel] = results[0];
+		*m_channelTargets[channel + 1] = results[1];
+		*m_channelTargets[channel + 2] = results[2];
+		*m_channelTargets[channel + 3] = results[3];
+	}
+#endif
+
+	for (; channel < end; channel++)
+	{
+		uint32_t segment = m_channelSegments[channel];
+		*m_channelTargets[channel] = EvaluateSegment(
+			&m_segmentCoefficients[segment * 4],
+			m_segmentStartTimes[segment],
+			m_segmentInverseSpans[segment],
+			m_channelTimes[channel]);
+	}
+}
+
+/***********************************************************
+ *  Benchmark()
+ *
+ *  This method is used for timing the update of a thousand
+ *  looping clips of a hundred tracks each, a hundred
+ *  thousand channels of eight keys with every kind of
+ *  interpolation, against the number of threads.  Every
+ *  run reports the average and the slowest update, and the
+ *  largest difference from evaluating the keys directly
+ *  after the last update.
+ ***********************************************************/
+void AnimationSystem::Benchmark()
+{
+	const int clipCount = 1000;
+	const int trackCount = 100;
+	const int keyCount = 8;
+	const int updateCount = 300;
+	const float deltaSeconds = 1.0f / 60.0f;
+	unsigned int coreCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+	std::vector<unsigned int> threadCounts;
+	for (unsigned int threads = 1; threads < coreCount; threads *= 2)
+	{
+		threadCounts.push_back(threads);
+	}
+	threadCounts.push_back(coreCount);
+
+	// random keys at uneven times over a four second clip
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::vector<std::vector<ANIMATION_KEY>> trackKeys(clipCount * trackCount);
+	std::vector<ANIMATION_INTERPOLATION> trackInterpolations(clipCount * trackCount);
+	for (int i = 0; i < trackKeys.size(); i++)
+	{
+		float time = 0.0f;
+		for (int k = 0; k < keyCount; k++)
+		{
+			trackKeys[i].push_back(ANIMATION_KEY{ time, (unit(random) * 20.0f) - 10.0f });
+			time += 0.2f + (unit(random) * 0.4f);
+		}
+		trackInterpolations[i] = static_cast<ANIMATION_INTERPOLATION>(i % 3);
+	}
+	std::vector<float> clipSpeeds(clipCount);
+	std::vector<float> clipStarts(clipCount);
+	for (int c = 0; c < clipCount; c++)
+	{
+		clipSpeeds[c] = 0.5f + unit(random);
+		clipStarts[c] = unit(random) * 4.0f;
+	}
+
+#ifdef ANIMATION_SSE2
+	std::cout << "Animation benchmark, SSE2, " << (clipCount * trackCount) << " channels" << std::endl;
+#else
+	std::cout << "Animation benchmark, scalar, " << (clipCount * trackCount) << " channels" << std::endl;
+#endif
+	std::cout << "threads  update ms  slowest ms  max error" << std::endl;
+
+	for (int t = 0; t < threadCounts.size(); t++)
+	{
+		// the calling thread works too, so one fewer worker
+		JobSystem* pJobSystem = NULL;
+		if (threadCounts[t] > 1)
+		{
+			pJobSystem = new JobSystem(threadCounts[t] - 1);
+		}
+
+		AnimationSystem animation;
+		std::vector<float> values(clipCount * trackCount, 0.0f);
+		for (int c = 0; c < clipCount; c++)
+		{
+			int clip = animation.CreateClip(4.0f, true);
+			std::vector<float*> targets;
+			for (int k = 0; k < trackCount; k++)
+			{
+				int track = (c * trackCount) + k;
+				animation.AddTrack(clip, trackInterpolations[track], trackKeys[track]);
+				targets.push_back(&values[track]);
+			}
+			animation.Play(clip, targets, clipSpeeds[c], clipStarts[c]);
+		}
+
+		double totalMilliseconds = 0.0;
+		double slowestMilliseconds = 0.0;
+		for (int i = 0; i < updateCount; i++)
+		{
+			std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+			animation.Update(deltaSeconds, pJobSystem);
+			double milliseconds = std::chrono::duration<double, std::milli>(
+				std::chrono::steady_clock::now() - startTime).count();
+			totalMilliseconds += milliseconds;
+			slowestMilliseconds = std::max(slowestMilliseconds, milliseconds);
+		}
+
+		// the clip times advanced by the update, checked against the keys
+		float maxError = 0.0f;
+		for (int c = 0; c < clipCount; c++)
+		{
+			float time = animation.m_playbacks[c].time;
+			for (int k = 0; k < trackCount; k++)
+			{
+				int track = (c * trackCount) + k;
+				float expected = EvaluateKeys(trackInterpolations[track], trackKeys[track], time);
+				maxError = std::max(maxError, std::fabs(values[track] - expected));
+			}
+		}
+
+		std::cout << threadCounts[t] << "  " << (totalMilliseconds / updateCount) << "  "
+			<< slowestMilliseconds << "  " << maxError << std::endl;
+
+		delete pJobSystem;
+	}
+}
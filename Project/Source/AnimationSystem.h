@@ -0,0 +1,112 @@
+///////////////////////////////////////////////////////////////////////////////
+// animationsystem.h
+// ============
+// evaluate keyframed scene values in batches across the worker threads
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "JobSystem.h"
+
+#include <cstdint>
+#include <vector>
+
+// how the value of a track moves from one key to the next
+enum ANIMATION_INTERPOLATION
+{
+	ANIMATION_STEP,
+	ANIMATION_LINEAR,
+	ANIMATION_CUBIC
+};
+
+// value of a track at a time in seconds from the start of its clip
+struct ANIMATION_KEY
+{
+	float time;
+	float value;
+};
+
+/***********************************************************
+ *  AnimationSystem
+ *
+ *  This class turns the keys of every clip into segments,
+ *  each a cubic polynomial in the time between two keys,
+ *  kept in one pool of separate start time, span and
+ *  coefficient arrays.  The bound channels of the playing
+ *  clips are kept in arrays of their own, so a frame is
+ *  evaluated as one long loop over the channels, split
+ *  across the workers.  Within each range four channels
+ *  are evaluated at once with SSE, and each result is
+ *  written straight to the value the channel is bound to.
+ ***********************************************************/
+class AnimationSystem
+{
+public:
+	// constructor
+	AnimationSystem();
+	// destructor
+	~AnimationSystem();
+
+	// create an empty clip, returns its index
+	int CreateClip(float duration, bool bLoop);
+	// add a track of keys sorted by time to a clip, returns its
+	// index within the clip; cubic tracks get Catmull-Rom tangents
+	int AddTrack(int clip, ANIMATION_INTERPOLATION interpolation, const std::vector<ANIMATION_KEY>& keys);
+	// start playing a clip, writing each track to the value at the
+	// same index of the targets, which must stay valid while playing
+	int Play(int clip, const std::vector<float*>& targets, float speed = 1.0f, float startTime = 0.0f);
+	// stop every playing clip and remove every clip
+	void Clear();
+
+	// advance the playing clips and write the values of every channel
+	void Update(float deltaSeconds, JobSystem* pJobSystem);
+
+	// get the number of values written by each update
+	int GetChannelCount() const { return(static_cast<int>(m_channelTargets.size())); }
+
+	// time a hundred thousand channels against the number of threads
+	// and check them against a per-key evaluation
+	static void Benchmark();
+
+private:
+	struct ANIMATION_CLIP
+	{
+		float duration;
+		bool bLoop;
+		// first segment in the pool and number of segments of each track
+		std::vector<uint32_t> trackSegmentStarts;
+		std::vector<uint32_t> trackSegmentCounts;
+	};
+
+	struct ANIMATION_PLAYBACK
+	{
+		int clip;
+		float speed;
+		float time;
+	};
+
+	std::vector<ANIMATION_CLIP> m_clips;
+	std::vector<ANIMATION_PLAYBACK> m_playbacks;
+	// clip time of each playback for the current update
+	std::vector<float> m_playbackTimes;
+
+	// one segment per key, running to the next key, with the
+	// segment of the last key holding its value
+	std::vector<float> m_segmentStartTimes;
+	std::vector<float> m_segmentInverseSpans;
+	// cubic, square, linear and constant coefficients of each segment
+	std::vector<float> m_segmentCoefficients;
+
+	// bound channels of the playing clips
+	std::vector<uint32_t> m_channelSegmentStarts;
+	std::vector<uint32_t> m_channelSegmentEnds;
+	std::vector<uint32_t> m_channelPlaybacks;
+	// segment the channel is in and its clip time for the current
+	// update, where the search of the next update starts
+	std::vector<uint32_t> m_channelSegments;
+	std::vector<float> m_channelTimes;
+	std::vector<float*> m_channelTargets;
+
+	// find the segments of the channels in [begin, end) and evaluate them
+	void EvaluateChannels(size_t begin, size_t end);
+};
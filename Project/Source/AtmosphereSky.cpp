@@ -0,0 +1,546 @@
+///////////////////////////////////////////////////////////////////////////////
+// atmospheresky.cpp
+// ============
+// precompute the scattering of the atmosphere into lookup tables for the sky
+///////////////////////////////////////////////////////////////////////////////
+
+#include "AtmosphereSky.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	const uint32_t ATMOSPHERE_FILE_MAGIC = 0x314D5441; // "ATM1"
+	const uint32_t ATMOSPHERE_FILE_VERSION = 1;
+
+	// passes of the compute program, selected by atmospherePass
+	const int ATMOSPHERE_PASS_TRANSMITTANCE = 0;
+	const int ATMOSPHERE_PASS_MULTI_SCATTERING = 1;
+	const int ATMOSPHERE_PASS_SKY_VIEW = 2;
+	// invocations along each side of a work group, the local size of
+	// the program
+	const int ATMOSPHERE_COMPUTE_GROUP_SIZE = 8;
+
+	// sizes of the tables, the transmittance by zenith angle and height,
+	// the multiple scattering by sun angle and height, and the sky view
+	// by azimuth from the sun and zenith angle
+	const int TRANSMITTANCE_WIDTH = 256;
+	const int TRANSMITTANCE_HEIGHT = 64;
+	const int MULTI_SCATTERING_SIZE = 32;
+	const int SKY_VIEW_WIDTH = 192;
+	const int SKY_VIEW_HEIGHT = 108;
+
+	// the sun has to turn further than this, as the cosine of the angle,
+	// before the sky-view table is filled again
+	const float SUN_MOVED_COSINE = 0.99999f;
+	// brightness of the sun disk over its sunlight, enough to saturate
+	// once tone mapped
+	const float SUN_DISK_SCALE = 20.0f;
+
+	const float PI = 3.14159265f;
+
+	/***********************************************************
+	 *  HashSettings()
+	 *
+	 *  Hash the settings that shape the cached tables with
+	 *  64-bit FNV-1a, so changed settings are computed again.
+	 ***********************************************************/
+	uint64_t HashSettings(const ATMOSPHERE_SETTINGS& settings)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		auto hashBytes = [&hash](const void* data, size_t size)
+			{
+				const uint8_t* bytes = static_cast<const uint8_t*>(data);
+				for (size_t i = 0; i < size; i++)
+				{
+					hash ^= bytes[i];
+					hash *= 1099511628211ull;
+				}
+			};
+
+		hashBytes(&ATMOSPHERE_FILE_VERSION, sizeof(ATMOSPHERE_FILE_VERSION));
+		hashBytes(&TRANSMITTANCE_WIDTH, sizeof(TRANSMITTANCE_WIDTH));
+		hashBytes(&TRANSMITTANCE_HEIGHT, sizeof(TRANSMITTANCE_HEIGHT));
+		hashBytes(&MULTI_SCATTERING_SIZE, sizeof(MULTI_SCATTERING_SIZE));
+		hashBytes(&settings.groundRadius, sizeof(settings.groundRadius));
+		hashBytes(&settings.topRadius, sizeof(settings.topRadius));
+		hashBytes(&settings.rayleighScattering, sizeof(settings.rayleighScattering));
+		hashBytes(&settings.rayleighScaleHeight, sizeof(settings.rayleighScaleHeight));
+		hashBytes(&settings.mieScattering, sizeof(settings.mieScattering));
+		hashBytes(&settings.mieExtinction, sizeof(settings.mieExtinction));
+		hashBytes(&settings.mieScaleHeight, sizeof(settings.mieScaleHeight));
+		hashBytes(&settings.ozoneAbsorption, sizeof(settings.ozoneAbsorption));
+		hashBytes(&settings.groundAlbedo, sizeof(settings.groundAlbedo));
+		return(hash);
+	}
+
+	/***********************************************************
+	 *  SkyViewZenithAngle()
+	 *
+	 *  The view zenith angle of a row of the sky-view table,
+	 *  the same mapping as the compute program, with half the
+	 *  rows above the horizon and half below, packed toward
+	 *  the horizon.
+	 ***********************************************************/
+	float SkyViewZenithAngle(float v, float viewHeight, float groundRadius)
+	{
+		float horizonCos = std::sqrt((viewHeight * viewHeight) - (groundRadius * groundRadius)) / viewHeight;
+		float beta = std::acos(horizonCos);
+		float zenithHorizonAngle = PI - beta;
+		if (v < 0.5f)
+		{
+			float coord = 1.0f - (2.0f * v);
+			coord = 1.0f - (coord * coord);
+			return(zenithHorizonAngle * coord);
+		}
+		float coord = (v * 2.0f) - 1.0f;
+		return(zenithHorizonAngle + (beta * coord * coord));
+	}
+}
+
+/***********************************************************
+ *  AtmosphereSky()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+AtmosphereSky::AtmosphereSky()
+{
+	m_computeProgram = 0;
+	m_transmittanceUnit = 0;
+	m_multiScatteringUnit = 0;
+	m_skyViewUnit = 0;
+	m_transmittanceTexture = 0;
+	m_multiScatteringTexture = 0;
+	m_skyViewTexture = 0;
+	m_vertexArray = 0;
+	m_bSkyView = false;
+	m_sunDirection = glm::vec3(0.0f, 1.0f, 0.0f);
+	m_sunColor = glm::vec3(0.0f);
+	m_sunDiskColor = glm::vec3(0.0f);
+	m_ambientColor = glm::vec3(0.0f);
+}
+
+/***********************************************************
+ *  ~AtmosphereSky()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+AtmosphereSky::~AtmosphereSky()
+{
+	Release();
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for creating the three tables.  The
+ *  transmittance and the multiple scattering are read from
+ *  the cache file when it was written with these settings,
+ *  and otherwise computed once and saved there.  The sky
+ *  view is filled by the first update.
+ ***********************************************************/
+bool AtmosphereSky::Initialize(
+	const ATMOSPHERE_SETTINGS& settings,
+	GLuint computeProgram,
+	const char* cacheFile,
+	int transmittanceUnit,
+	int multiScatteringUnit,
+	int skyViewUnit)
+{
+	Release();
+
+	if ((computeProgram == 0) || (settings.topRadius <= settings.groundRadius) || (settings.viewerAltitude <= 0.0f))
+	{
+		std::cout << "The sky needs its compute program and a viewer inside the atmosphere" << std::endl;
+		return(false);
+	}
+
+	m_settings = settings;
+	m_computeProgram = computeProgram;
+	m_transmittanceUnit = transmittanceUnit;
+	m_multiScatteringUnit = multiScatteringUnit;
+	m_skyViewUnit = skyViewUnit;
+
+	if (LoadTables(cacheFile) == false)
+	{
+		std::vector<float> multiScattering;
+		ComputeTables(multiScattering);
+		SaveTables(cacheFile, multiScattering);
+	}
+
+	m_skyViewTexture = CreateTable(GL_RGBA16F, SKY_VIEW_WIDTH, SKY_VIEW_HEIGHT, NULL);
+	glGenVertexArrays(1, &m_vertexArray);
+	return(true);
+}
+
+/***********************************************************
+ *  Release()
+ *
+ *  This method is used for freeing the tables.
+ ***********************************************************/
+void AtmosphereSky::Release()
+{
+	GLuint textures[3] = { m_transmittanceTexture, m_multiScatteringTexture, m_skyViewTexture };
+	for (int i = 0; i < 3; i++)
+	{
+		if (textures[i] != 0)
+		{
+			glDeleteTextures(1, &textures[i]);
+		}
+	}
+	m_transmittanceTexture = 0;
+	m_multiScatteringTexture = 0;
+	m_skyViewTexture = 0;
+
+	if (m_vertexArray != 0)
+	{
+		glDeleteVertexArrays(1, &m_vertexArray);
+		m_vertexArray = 0;
+	}
+
+	m_transmittance.clear();
+	m_skyView.clear();
+	m_bSkyView = false;
+	m_computeProgram = 0;
+}
+
+/***********************************************************
+ *  LoadTables()
+ *
+ *  This method is used for reading the transmittance and the
+ *  multiple scattering from the cache file, when it was
+ *  written with the same settings.
+ ***********************************************************/
+bool AtmosphereSky::LoadTables(const char* cacheFile)
+{
+	std::ifstream file(cacheFile, std::ios::binary);
+	if (!file)
+	{
+		return(false);
+	}
+
+	uint32_t magic = 0;
+	uint32_t version = 0;
+	uint64_t settingsHash = 0;
+	file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+	file.read(reinterpret_cast<char*>(&version), sizeof(version));
+	file.read(reinterpret_cast<char*>(&settingsHash), sizeof(settingsHash));
+	if (!file || (magic != ATMOSPHERE_FILE_MAGIC) || (version != ATMOSPHERE_FILE_VERSION) ||
+		(settingsHash != HashSettings(m_settings)))
+	{
+		return(false);
+	}
+
+	std::vector<float> transmittance(static_cast<size_t>(TRANSMITTANCE_WIDTH) * TRANSMITTANCE_HEIGHT * 4);
+	std::vector<float> multiScattering(static_cast<size_t>(MULTI_SCATTERING_SIZE) * MULTI_SCATTERING_SIZE * 4);
+	file.read(reinterpret_cast<char*>(transmittance.data()), transmittance.size() * sizeof(float));
+	file.read(reinterpret_cast<char*>(multiScattering.data()), multiScattering.size() * sizeof(float));
+	if (!file)
+	{
+		std::cout << "Atmosphere cache is truncated:" << cacheFile << std::endl;
+		return(false);
+	}
+
+	m_transmittanceTexture = CreateTable(GL_RGBA32F, TRANSMITTANCE_WIDTH, TRANSMITTANCE_HEIGHT, transmittance.data());
+	m_multiScatteringTexture = CreateTable(GL_RGBA32F, MULTI_SCATTERING_SIZE, MULTI_SCATTERING_SIZE, multiScattering.data());
+	m_transmittance.swap(transmittance);
+	return(true);
+}
+
+/***********************************************************
+ *  SaveTables()
+ *
+ *  This method is used for writing the transmittance and the
+ *  multiple scattering to the cache file, behind the hash of
+ *  the settings they were computed with.
+ ***********************************************************/
+bool AtmosphereSky::SaveTables(const char* cacheFile, const std::vector<float>& multiScattering) const
+{
+	std::ofstream file(cacheFile, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		std::cout << "Could not write atmosphere cache:" << cacheFile << std::endl;
+		return(false);
+	}
+
+	uint64_t settingsHash = HashSettings(m_settings);
+	file.write(reinterpret_cast<const char*>(&ATMOSPHERE_FILE_MAGIC), sizeof(ATMOSPHERE_FILE_MAGIC));
+	file.write(reinterpret_cast<const char*>(&ATMOSPHERE_FILE_VERSION), sizeof(ATMOSPHERE_FILE_VERSION));
+	file.write(reinterpret_cast<const char*>(&settingsHash), sizeof(settingsHash));
+	file.write(reinterpret_cast<const char*>(m_transmittance.data()), m_transmittance.size() * sizeof(float));
+	file.write(reinterpret_cast<const char*>(multiScattering.data()), multiScattering.size() * sizeof(float));
+	return(static_cast<bool>(file));
+}
+
+/***********************************************************
+ *  ComputeTables()
+ *
+ *  This method is used for filling the transmittance table
+ *  and then the multiple scattering table, which reads it,
+ *  with the compute program, and reading both back for the
+ *  cache file and the color of the sunlight.
+ ***********************************************************/
+void AtmosphereSky::ComputeTables(std::vector<float>& multiScattering)
+{
+	m_transmittanceTexture = CreateTable(GL_RGBA32F, TRANSMITTANCE_WIDTH, TRANSMITTANCE_HEIGHT, NULL);
+	m_multiScatteringTexture = CreateTable(GL_RGBA32F, MULTI_SCATTERING_SIZE, MULTI_SCATTERING_SIZE, NULL);
+
+	GLint oldProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &oldProgram);
+	glUseProgram(m_computeProgram);
+	SetComputeUniforms();
+	Bind();
+	glBindImageTexture(0, m_transmittanceTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+	glBindImageTexture(1, m_multiScatteringTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+
+	glUniform1i(glGetUniformLocation(m_computeProgram, "atmospherePass"), ATMOSPHERE_PASS_TRANSMITTANCE);
+	glDispatchCompute(
+		(TRANSMITTANCE_WIDTH + ATMOSPHERE_COMPUTE_GROUP_SIZE - 1) / ATMOSPHERE_COMPUTE_GROUP_SIZE,
+		(TRANSMITTANCE_HEIGHT + ATMOSPHERE_COMPUTE_GROUP_SIZE - 1) / ATMOSPHERE_COMPUTE_GROUP_SIZE,
+		1);
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+	glUniform1i(glGetUniformLocation(m_computeProgram, "atmospherePass"), ATMOSPHERE_PASS_MULTI_SCATTERING);
+	glDispatchCompute(
+		(MULTI_SCATTERING_SIZE + ATMOSPHERE_COMPUTE_GROUP_SIZE - 1) / ATMOSPHERE_COMPUTE_GROUP_SIZE,
+		(MULTI_SCATTERING_SIZE + ATMOSPHERE_COMPUTE_GROUP_SIZE - 1) / ATMOSPHERE_COMPUTE_GROUP_SIZE,
+		1);
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+	glUseProgram(oldProgram);
+
+	m_transmittance.resize(static_cast<size_t>(TRANSMITTANCE_WIDTH) * TRANSMITTANCE_HEIGHT * 4);
+	multiScattering.resize(static_cast<size_t>(MULTI_SCATTERING_SIZE) * MULTI_SCATTERING_SIZE * 4);
+	glBindTexture(GL_TEXTURE_2D, m_transmittanceTexture);
+	glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, m_transmittance.data());
+	glBindTexture(GL_TEXTURE_2D, m_multiScatteringTexture);
+	glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, multiScattering.data());
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+/***********************************************************
+ *  UpdateSkyView()
+ *
+ *  This method is used for filling the sky-view table for a
+ *  new direction toward the sun, and reading the color of
+ *  the sunlight and of the ambient light off the tables.
+ *  Nothing is done while the sun has not moved, so the
+ *  table costs nothing on most frames.
+ ***********************************************************/
+bool AtmosphereSky::UpdateSkyView(glm::vec3 sunDirection)
+{
+	if ((m_skyViewTexture == 0) || (glm::length(sunDirection) <= 0.0f))
+	{
+		return(false);
+	}
+
+	sunDirection = glm::normalize(sunDirection);
+	if ((m_bSkyView) && (glm::dot(sunDirection, m_sunDirection) > SUN_MOVED_COSINE))
+	{
+		return(false);
+	}
+	m_sunDirection = sunDirection;
+
+	GLint oldProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &oldProgram);
+	glUseProgram(m_computeProgram);
+	SetComputeUniforms();
+	Bind();
+	glBindImageTexture(2, m_skyViewTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+
+	glUniform1i(glGetUniformLocation(m_computeProgram, "atmospherePass"), ATMOSPHERE_PASS_SKY_VIEW);
+	glUniform1f(glGetUniformLocation(m_computeProgram, "viewHeight"), GetViewHeight());
+	glUniform3fv(glGetUniformLocation(m_computeProgram, "sunDirection"), 1, &m_sunDirection[0]);
+	glDispatchCompute(
+		(SKY_VIEW_WIDTH + ATMOSPHERE_COMPUTE_GROUP_SIZE - 1) / ATMOSPHERE_COMPUTE_GROUP_SIZE,
+		(SKY_VIEW_HEIGHT + ATMOSPHERE_COMPUTE_GROUP_SIZE - 1) / ATMOSPHERE_COMPUTE_GROUP_SIZE,
+		1);
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+	glUseProgram(oldProgram);
+
+	// the read back waits for the table, which only happens when the
+	// sun moves
+	m_skyView.resize(static_cast<size_t>(SKY_VIEW_WIDTH) * SKY_VIEW_HEIGHT * 4);
+	glActiveTexture(GL_TEXTURE0 + m_skyViewUnit);
+	glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, m_skyView.data());
+
+	m_sunColor = m_settings.sunIlluminance * SampleTransmittance(GetViewHeight(), m_sunDirection.y);
+	m_sunDiskColor = m_sunColor * SUN_DISK_SCALE;
+	m_ambientColor = IntegrateAmbient();
+	m_bSkyView = true;
+	return(true);
+}
+
+/***********************************************************
+ *  SetComputeUniforms()
+ *
+ *  This method is used for passing the atmosphere to the
+ *  compute program.
+ ***********************************************************/
+void AtmosphereSky::SetComputeUniforms()
+{
+	glUniform1i(glGetUniformLocation(m_computeProgram, "transmittanceTable"), m_transmittanceUnit);
+	glUniform1i(glGetUniformLocation(m_computeProgram, "multiScatteringTable"), m_multiScatteringUnit);
+	glUniform1f(glGetUniformLocation(m_computeProgram, "groundRadius"), m_settings.groundRadius);
+	glUniform1f(glGetUniformLocation(m_computeProgram, "topRadius"), m_settings.topRadius);
+	glUniform3fv(glGetUniformLocation(m_computeProgram, "rayleighScattering"), 1, &m_settings.rayleighScattering[0]);
+	glUniform1f(glGetUniformLocation(m_computeProgram, "rayleighScaleHeight"), m_settings.rayleighScaleHeight);
+	glUniform1f(glGetUniformLocation(m_computeProgram, "mieScattering"), m_settings.mieScattering);
+	glUniform1f(glGetUniformLocation(m_computeProgram, "mieExtinction"), m_settings.mieExtinction);
+	glUniform1f(glGetUniformLocation(m_computeProgram, "mieScaleHeight"), m_settings.mieScaleHeight);
+	glUniform1f(glGetUniformLocation(m_computeProgram, "mieAnisotropy"), m_settings.mieAnisotropy);
+	glUniform3fv(glGetUniformLocation(m_computeProgram, "ozoneAbsorption"), 1, &m_settings.ozoneAbsorption[0]);
+	glUniform3fv(glGetUniformLocation(m_computeProgram, "groundAlbedo"), 1, &m_settings.groundAlbedo[0]);
+	glUniform3fv(glGetUniformLocation(m_computeProgram, "sunIlluminance"), 1, &m_settings.sunIlluminance[0]);
+}
+
+/***********************************************************
+ *  CreateTable()
+ *
+ *  This method is used for creating a floating point table,
+ *  filtered linearly and clamped at its edges.
+ ***********************************************************/
+GLuint AtmosphereSky::CreateTable(GLenum internalFormat, int width, int height, const float* data) const
+{
+	GLuint texture = 0;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, GL_RGBA, GL_FLOAT, data);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	return(texture);
+}
+
+/***********************************************************
+ *  SampleTransmittance()
+ *
+ *  This method is used for looking up the transmittance
+ *  table read back, with the mapping of the compute program
+ *  and bilinear filtering.  A ray into the ground gets no
+ *  light through.
+ ***********************************************************/
+glm::vec3 AtmosphereSky::SampleTransmittance(float r, float mu) const
+{
+	if (m_transmittance.empty())
+	{
+		return(glm::vec3(1.0f));
+	}
+
+	const float groundRadius = m_settings.groundRadius;
+	const float topRadius = m_settings.topRadius;
+	float groundDiscriminant = (r * r * ((mu * mu) - 1.0f)) + (groundRadius * groundRadius);
+	if ((mu < 0.0f) && (groundDiscriminant >= 0.0f))
+	{
+		return(glm::vec3(0.0f));
+	}
+
+	float horizon = std::sqrt((topRadius * topRadius) - (groundRadius * groundRadius));
+	float rho = std::sqrt(std::max((r * r) - (groundRadius * groundRadius), 0.0f));
+	float discriminant = (r * r * ((mu * mu) - 1.0f)) + (topRadius * topRadius);
+	float d = std::max((-r * mu) + std::sqrt(std::max(discriminant, 0.0f)), 0.0f);
+	float dMin = topRadius - r;
+	float dMax = rho + horizon;
+	float u = (d - dMin) / (dMax - dMin);
+	float v = rho / horizon;
+
+	float x = std::min(std::max((u * TRANSMITTANCE_WIDTH) - 0.5f, 0.0f), TRANSMITTANCE_WIDTH - 1.0f);
+	float y = std::min(std::max((v * TRANSMITTANCE_HEIGHT) - 0.5f, 0.0f), TRANSMITTANCE_HEIGHT - 1.0f);
+	int x0 = static_cast<int>(x);
+	int y0 = static_cast<int>(y);
+	int x1 = std::min(x0 + 1, TRANSMITTANCE_WIDTH - 1);
+	int y1 = std::min(y0 + 1, TRANSMITTANCE_HEIGHT - 1);
+	float fx = x - x0;
+	float fy = y - y0;
+
+	auto texel = [this](int tx, int ty)
+		{
+			const float* value = &m_transmittance[((static_cast<size_t>(ty) * TRANSMITTANCE_WIDTH) + tx) * 4];
+			return(glm::vec3(value[0], value[1], value[2]));
+		};
+	glm::vec3 bottom = glm::mix(texel(x0, y0), texel(x1, y0), fx);
+	glm::vec3 top = glm::mix(texel(x0, y1), texel(x1, y1), fx);
+	return(glm::mix(bottom, top, fy));
+}
+
+/***********************************************************
+ *  IntegrateAmbient()
+ *
+ *  This method is used for summing the radiance of the sky
+ *  above the horizon in the sky-view table read back,
+ *  weighted by the cosine to the ground normal and the
+ *  solid angle of every texel, into the light the sky casts
+ *  on level ground.  The table covers half the sky around
+ *  the plane of the sun, so its sum counts twice.
+ ***********************************************************/
+glm::vec3 AtmosphereSky::IntegrateAmbient() const
+{
+	glm::vec3 irradiance(0.0f);
+	if (m_skyView.empty())
+	{
+		return(irradiance);
+	}
+
+	const float azimuthStep = PI / SKY_VIEW_WIDTH;
+	for (int row = 0; row < SKY_VIEW_HEIGHT; row++)
+	{
+		float top = SkyViewZenithAngle(static_cast<float>(row) / SKY_VIEW_HEIGHT, GetViewHeight(), m_settings.groundRadius);
+		float bottom = SkyViewZenithAngle(static_cast<float>(row + 1) / SKY_VIEW_HEIGHT, GetViewHeight(), m_settings.groundRadius);
+		float zenithAngle = 0.5f * (top + bottom);
+		float cosine = std::cos(zenithAngle);
+		if (cosine <= 0.0f)
+		{
+			continue;
+		}
+
+		float weight = 2.0f * cosine * std::sin(zenithAngle) * (bottom - top) * azimuthStep;
+		for (int column = 0; column < SKY_VIEW_WIDTH; column++)
+		{
+			const float* value = &m_skyView[((static_cast<size_t>(row) * SKY_VIEW_WIDTH) + column) * 4];
+			irradiance += glm::vec3(value[0], value[1], value[2]) * weight;
+		}
+	}
+	return(irradiance);
+}
+
+/***********************************************************
+ *  Bind()
+ *
+ *  This method is used for binding the three tables to their
+ *  texture units.
+ ***********************************************************/
+void AtmosphereSky::Bind() const
+{
+	glActiveTexture(GL_TEXTURE0 + m_transmittanceUnit);
+	glBindTexture(GL_TEXTURE_2D, m_transmittanceTexture);
+	glActiveTexture(GL_TEXTURE0 + m_multiScatteringUnit);
+	glBindTexture(GL_TEXTURE_2D, m_multiScatteringTexture);
+	glActiveTexture(GL_TEXTURE0 + m_skyViewUnit);
+	glBindTexture(GL_TEXTURE_2D, m_skyViewTexture);
+}
+
+/***********************************************************
+ *  Draw()
+ *
+ *  This method is used for drawing the sky as one triangle
+ *  covering the screen, its corners made by the vertex
+ *  shader from the vertex index.
+ ***********************************************************/
+void AtmosphereSky::Draw()
+{
+	if (m_vertexArray == 0)
+	{
+		return;
+	}
+
+	glBindVertexArray(m_vertexArray);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+}
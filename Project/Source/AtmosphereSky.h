@@ -0,0 +1,145 @@
+///////////////////////////////////////////////////////////////////////////////
+// atmospheresky.h
+// ============
+// precompute the scattering of the atmosphere into lookup tables for the sky
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// the planet and its air, in kilometers and per kilometer, with the
+// defaults of an earth-like atmosphere
+struct ATMOSPHERE_SETTINGS
+{
+	// radius of the ground and of the top of the atmosphere
+	float groundRadius = 6360.0f;
+	float topRadius = 6460.0f;
+	// scattering of the air molecules at the ground, falling off by e
+	// every scale height
+	glm::vec3 rayleighScattering = glm::vec3(0.005802f, 0.013558f, 0.0331f);
+	float rayleighScaleHeight = 8.0f;
+	// scattering and extinction of the aerosols at the ground, and how
+	// much they scatter forward
+	float mieScattering = 0.003996f;
+	float mieExtinction = 0.00444f;
+	float mieScaleHeight = 1.2f;
+	float mieAnisotropy = 0.8f;
+	// absorption of the ozone layer, peaking 25 km up
+	glm::vec3 ozoneAbsorption = glm::vec3(0.00065f, 0.001881f, 0.000085f);
+	glm::vec3 groundAlbedo = glm::vec3(0.3f);
+
+	// illuminance of the sun above the atmosphere, in the units of the
+	// scene lights, and the height of the viewer above the ground
+	glm::vec3 sunIlluminance = glm::vec3(1.0f);
+	float viewerAltitude = 0.2f;
+	// scale of the sky radiance before it is tone mapped on screen
+	float skyExposure = 10.0f;
+};
+
+/***********************************************************
+ *  AtmosphereSky
+ *
+ *  This class renders the sky from three lookup tables, as
+ *  in the precomputed scattering of Bruneton and the sky of
+ *  Hillaire.  The transmittance table holds how much light
+ *  reaches the top of the atmosphere from every height and
+ *  zenith angle, and the multiple scattering table the
+ *  light scattered more than once for every height and sun
+ *  angle.  Neither depends on the sun, so a compute program
+ *  fills them once and they are kept in a cache file.  The
+ *  small sky-view table holds the radiance of the sky
+ *  around the viewer and is filled again only when the sun
+ *  moves, so the sky costs one lookup per pixel.  The color
+ *  of the sunlight and the ambient light of the sky are
+ *  read off the same tables.
+ ***********************************************************/
+class AtmosphereSky
+{
+public:
+	// constructor
+	AtmosphereSky();
+	// destructor
+	~AtmosphereSky();
+
+	// create the tables, loading the transmittance and the multiple
+	// scattering from the cache file or computing them with the passed
+	// in compute program and saving them there
+	bool Initialize(
+		const ATMOSPHERE_SETTINGS& settings,
+		GLuint computeProgram,
+		const char* cacheFile,
+		int transmittanceUnit,
+		int multiScatteringUnit,
+		int skyViewUnit);
+	// free the tables
+	void Release();
+
+	// fill the sky-view table for the direction toward the sun, unless
+	// the sun has not moved, returning true when it was filled
+	bool UpdateSkyView(glm::vec3 sunDirection);
+	// bind the tables to their texture units
+	void Bind() const;
+	// draw one triangle covering the screen
+	void Draw();
+
+	// true once the sky-view table was filled for a sun
+	bool IsReady() const { return(m_bSkyView); }
+	const ATMOSPHERE_SETTINGS& GetSettings() const { return(m_settings); }
+	// get the direction toward the sun of the sky-view table
+	glm::vec3 GetSunDirection() const { return(m_sunDirection); }
+	// get the sunlight reaching the viewer, the light of the sun disk
+	// and the light the sky casts on the ground
+	glm::vec3 GetSunColor() const { return(m_sunColor); }
+	glm::vec3 GetSunDiskColor() const { return(m_sunDiskColor); }
+	glm::vec3 GetAmbientColor() const { return(m_ambientColor); }
+	// get the distance of the viewer from the center of the planet
+	float GetViewHeight() const { return(m_settings.groundRadius + m_settings.viewerAltitude); }
+	// get the texture unit the sky-view table is bound to
+	int GetSkyViewUnit() const { return(m_skyViewUnit); }
+
+private:
+	ATMOSPHERE_SETTINGS m_settings;
+	GLuint m_computeProgram;
+	int m_transmittanceUnit;
+	int m_multiScatteringUnit;
+	int m_skyViewUnit;
+
+	GLuint m_transmittanceTexture;
+	GLuint m_multiScatteringTexture;
+	GLuint m_skyViewTexture;
+	// empty, the sky triangle is made from the vertex index
+	GLuint m_vertexArray;
+
+	// the transmittance table kept for coloring the sunlight, and the
+	// sky-view table read back for the ambient light
+	std::vector<float> m_transmittance;
+	std::vector<float> m_skyView;
+
+	bool m_bSkyView;
+	glm::vec3 m_sunDirection;
+	glm::vec3 m_sunColor;
+	glm::vec3 m_sunDiskColor;
+	glm::vec3 m_ambientColor;
+
+	// read the two tables from the cache file when it was written with
+	// the same settings
+	bool LoadTables(const char* cacheFile);
+	// write the two tables to the cache file
+	bool SaveTables(const char* cacheFile, const std::vector<float>& multiScattering) const;
+	// fill the two tables with the compute program
+	void ComputeTables(std::vector<float>& multiScattering);
+	// set the uniforms of the compute program shared by the passes
+	void SetComputeUniforms();
+	// create a floating point table of the passed in size
+	GLuint CreateTable(GLenum internalFormat, int width, int height, const float* data) const;
+	// transmittance from a distance to the planet center along a zenith
+	// cosine to the top of the atmosphere
+	glm::vec3 SampleTransmittance(float r, float mu) const;
+	// the light of the sky falling on level ground, from the sky-view
+	// table read back
+	glm::vec3 IntegrateAmbient() const;
+};
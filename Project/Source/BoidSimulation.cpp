@@ -0,0 +1,813 @@
+///////////////////////////////////////////////////////////////////////////////
+// boidsimulation.cpp
+// ============
+// flock large schools of fish with a spatial hash and vectorized force kernels
+///////////////////////////////////////////////////////////////////////////////
+
+#include "BoidSimulation.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <thread>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define BOIDS_AVX2_FUNCTION
+#else
+#define BOIDS_AVX2_FUNCTION __attribute__((target("avx2")))
+#endif
+#define BOIDS_AVX2
+#endif
+
+// declaration of global variables
+namespace
+{
+	// length of each simulation step, and the most steps taken in
+	// one update so a long frame does not stall the next ones
+	const float BOIDS_STEP_SECONDS = 1.0f / 60.0f;
+	const int BOIDS_MAX_STEPS_PER_UPDATE = 4;
+	// agents steered together by one worker at the least
+	const size_t BOIDS_GRAIN_SIZE = 256;
+	// floats the sorted arrays are padded by, so the vectorized
+	// kernel can load eight agents from the end of any bucket
+	const size_t BOIDS_PADDING = 8;
+	// threads in each compute shader work group
+	const int BOIDS_COMPUTE_GROUP_SIZE = 256;
+
+	// passes of the compute shader, selected by a uniform
+	const int BOIDS_PASS_COUNT = 0;
+	const int BOIDS_PASS_SCAN = 1;
+	const int BOIDS_PASS_SCATTER = 2;
+	const int BOIDS_PASS_MOVE = 3;
+
+	/***********************************************************
+	 *  HashCell()
+	 *
+	 *  Hash the integer coordinates of a grid cell into the
+	 *  bucket table.  The compute shader hashes the same way.
+	 ***********************************************************/
+	inline uint32_t HashCell(int x, int y, int z, uint32_t mask)
+	{
+		return(((static_cast<uint32_t>(x) * 73856093u) ^
+			(static_cast<uint32_t>(y) * 19349663u) ^
+			(static_cast<uint32_t>(z) * 83492791u)) & mask);
+	}
+
+	/***********************************************************
+	 *  CpuSupportsAVX2()
+	 *
+	 *  Check that the processor and the operating system both
+	 *  support the AVX2 instructions.
+	 ***********************************************************/
+	bool CpuSupportsAVX2()
+	{
+#if defined(BOIDS_AVX2) && defined(_MSC_VER)
+		int info[4] = { 0 };
+		__cpuid(info, 0);
+		if (info[0] < 7)
+		{
+			return(false);
+		}
+		__cpuid(info, 1);
+		bool bOSXSave = (info[2] & (1 << 27)) != 0;
+		bool bAVX = (info[2] & (1 << 28)) != 0;
+		if ((bOSXSave == false) || (bAVX == false) || ((_xgetbv(0) & 6) != 6))
+		{
+			return(false);
+		}
+		__cpuidex(info, 7, 0);
+		return((info[1] & (1 << 5)) != 0);
+#elif defined(BOIDS_AVX2)
+		return(__builtin_cpu_supports("avx2") != 0);
+#else
+		return(false);
+#endif
+	}
+
+#ifdef BOIDS_AVX2
+	/***********************************************************
+	 *  SumLanes()
+	 *
+	 *  Add the eight lanes of an AVX register together.
+	 ***********************************************************/
+	BOIDS_AVX2_FUNCTION inline float SumLanes(__m256 value)
+	{
+		__m128 sum = _mm_add_ps(_mm256_castps256_ps128(value), _mm256_extractf128_ps(value, 1));
+		sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+		sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+		return(_mm_cvtss_f32(sum));
+	}
+#endif
+}
+
+/***********************************************************
+ *  BoidSimulation()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+BoidSimulation::BoidSimulation()
+{
+	m_agentCount = 0;
+	m_bAVX2 = CpuSupportsAVX2();
+	m_pendingTime = 0.0f;
+	m_bucketMask = 0;
+	m_computeProgram = 0;
+	m_agentBuffer = 0;
+	m_bucketBuffer = 0;
+	m_cursorBuffer = 0;
+	m_sortedBuffer = 0;
+	m_instanceBuffer = 0;
+}
+
+/***********************************************************
+ *  ~BoidSimulation()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+BoidSimulation::~BoidSimulation()
+{
+	if (m_agentBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_agentBuffer);
+		glDeleteBuffers(1, &m_bucketBuffer);
+		glDeleteBuffers(1, &m_cursorBuffer);
+		glDeleteBuffers(1, &m_sortedBuffer);
+	}
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for replacing the agents and the
+ *  flocking rules.  The bucket table is sized to the next
+ *  power of two at or above twice the number of agents, so
+ *  few cells share a bucket.
+ ***********************************************************/
+void BoidSimulation::Initialize(
+	const std::vector<glm::vec3>& positions,
+	const std::vector<glm::vec3>& velocities,
+	const BOID_SETTINGS& settings)
+{
+	m_settings = settings;
+	m_agentCount = static_cast<int>(std::min(positions.size(), velocities.size()));
+	m_pendingTime = 0.0f;
+
+	m_positionX.resize(m_agentCount);
+	m_positionY.resize(m_agentCount);
+	m_positionZ.resize(m_agentCount);
+	m_velocityX.resize(m_agentCount);
+	m_velocityY.resize(m_agentCount);
+	m_velocityZ.resize(m_agentCount);
+	for (int i = 0; i < m_agentCount; i++)
+	{
+		m_positionX[i] = positions[i].x;
+		m_positionY[i] = positions[i].y;
+		m_positionZ[i] = positions[i].z;
+		m_velocityX[i] = velocities[i].x;
+		m_velocityY[i] = velocities[i].y;
+		m_velocityZ[i] = velocities[i].z;
+	}
+
+	uint32_t bucketCount = BOIDS_COMPUTE_GROUP_SIZE;
+	while (bucketCount < 2 * static_cast<uint32_t>(m_agentCount))
+	{
+		bucketCount *= 2;
+	}
+	m_bucketMask = bucketCount - 1;
+	m_agentBuckets.resize(m_agentCount);
+	m_bucketStarts.resize(bucketCount + 1);
+
+	m_sortedPositionX.assign(m_agentCount + BOIDS_PADDING, 0.0f);
+	m_sortedPositionY.assign(m_agentCount + BOIDS_PADDING, 0.0f);
+	m_sortedPositionZ.assign(m_agentCount + BOIDS_PADDING, 0.0f);
+	m_sortedVelocityX.assign(m_agentCount + BOIDS_PADDING, 0.0f);
+	m_sortedVelocityY.assign(m_agentCount + BOIDS_PADDING, 0.0f);
+	m_sortedVelocityZ.assign(m_agentCount + BOIDS_PADDING, 0.0f);
+	m_sortedAgents.resize(m_agentCount);
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for advancing the simulation by the
+ *  passed in time in steps of a fixed length, so the flock
+ *  moves the same whatever the frame rate.
+ ***********************************************************/
+void BoidSimulation::Update(float deltaSeconds, JobSystem* pJobSystem)
+{
+	if (m_agentCount == 0)
+	{
+		return;
+	}
+
+	m_pendingTime = std::min(m_pendingTime + deltaSeconds, BOIDS_STEP_SECONDS * BOIDS_MAX_STEPS_PER_UPDATE);
+	while (m_pendingTime >= BOIDS_STEP_SECONDS)
+	{
+		if (IsComputeEnabled())
+		{
+			StepCompute(BOIDS_STEP_SECONDS);
+		}
+		else
+		{
+			Step(BOIDS_STEP_SECONDS, pJobSystem);
+		}
+		m_pendingTime -= BOIDS_STEP_SECONDS;
+	}
+}
+
+/***********************************************************
+ *  Step()
+ *
+ *  This method is used for running one step on the CPU.
+ *  The agents are sorted by bucket, then steered from the
+ *  sorted copy, in order, so the workers walk through
+ *  memory one cell after the next.  Moved agents are
+ *  written back to their own index.
+ ***********************************************************/
+void BoidSimulation::Step(float deltaSeconds, JobSystem* pJobSystem)
+{
+	SortAgents(pJobSystem);
+
+	auto moveRange = [this, deltaSeconds](size_t begin, size_t end)
+		{
+			if (m_bAVX2)
+			{
+				MoveAgentsAVX2(begin, end, deltaSeconds);
+			}
+			else
+			{
+				MoveAgents(begin, end, deltaSeconds);
+			}
+		};
+
+	if (NULL != pJobSystem)
+	{
+		pJobSystem->ParallelFor(m_agentCount, BOIDS_GRAIN_SIZE, moveRange);
+	}
+	else
+	{
+		moveRange(0, m_agentCount);
+	}
+}
+
+/***********************************************************
+ *  SortAgents()
+ *
+ *  This method is used for counting sorting the agents by
+ *  the bucket of the cell they are in.  Hashing is split
+ *  across the workers; counting, summing the counts into
+ *  bucket starts and scattering the copies are single
+ *  passes over the arrays.
+ ***********************************************************/
+void BoidSimulation::SortAgents(JobSystem* pJobSystem)
+{
+	const float inverseCellSize = 1.0f / m_settings.neighborRadius;
+	auto hashRange = [this, inverseCellSize](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				m_agentBuckets[i] = HashCell(
+					static_cast<int>(floorf(m_positionX[i] * inverseCellSize)),
+					static_cast<int>(floorf(m_positionY[i] * inverseCellSize)),
+					static_cast<int>(floorf(m_positionZ[i] * inverseCellSize)),
+					m_bucketMask);
+			}
+		};
+	if (NULL != pJobSystem)
+	{
+		pJobSystem->ParallelFor(m_agentCount, 4096, hashRange);
+	}
+	else
+	{
+		hashRange(0, m_agentCount);
+	}
+
+	std::fill(m_bucketStarts.begin(), m_bucketStarts.end(), 0);
+	for (int i = 0; i < m_agentCount; i++)
+	{
+		m_bucketStarts[m_agentBuckets[i] + 1]++;
+	}
+	for (size_t i = 1; i < m_bucketStarts.size(); i++)
+	{
+		m_bucketStarts[i] += m_bucketStarts[i - 1];
+	}
+
+	// the starts are advanced while scattering and shifted back after
+	for (int i = 0; i < m_agentCount; i++)
+	{
+		uint32_t sorted = m_bucketStarts[m_agentBuckets[i]]++;
+		m_sortedPositionX[sorted] = m_positionX[i];
+		m_sortedPositionY[sorted] = m_positionY[i];
+		m_sortedPositionZ[sorted] = m_positionZ[i];
+		m_sortedVelocityX[sorted] = m_velocityX[i];
+		m_sortedVelocityY[sorted] = m_velocityY[i];
+		m_sortedVelocityZ[sorted] = m_velocityZ[i];
+		m_sortedAgents[sorted] = static_cast<uint32_t>(i);
+	}
+	for (size_t i = m_bucketStarts.size() - 1; i > 0; i--)
+	{
+		m_bucketStarts[i] = m_bucketStarts[i - 1];
+	}
+	m_bucketStarts[0] = 0;
+}
+
+/***********************************************************
+ *  FindNeighborBuckets()
+ *
+ *  This method is used for collecting the buckets of the 27
+ *  cells around a position, skipping buckets shared by more
+ *  than one of the cells so no agent is counted twice.
+ ***********************************************************/
+int BoidSimulation::FindNeighborBuckets(float x, float y, float z, uint32_t* buckets) const
+{
+	const float inverseCellSize = 1.0f / m_settings.neighborRadius;
+	int cellX = static_cast<int>(floorf(x * inverseCellSize));
+	int cellY = static_cast<int>(floorf(y * inverseCellSize));
+	int cellZ = static_cast<int>(floorf(z * inverseCellSize));
+
+	int bucketCount = 0;
+	for (int offsetZ = -1; offsetZ <= 1; offsetZ++)
+	{
+		for (int offsetY = -1; offsetY <= 1; offsetY++)
+		{
+			for (int offsetX = -1; offsetX <= 1; offsetX++)
+			{
+				uint32_t bucket = HashCell(cellX + offsetX, cellY + offsetY, cellZ + offsetZ, m_bucketMask);
+				if ((m_bucketStarts[bucket] != m_bucketStarts[bucket + 1]) &&
+					(std::find(buckets, buckets + bucketCount, bucket) == buckets + bucketCount))
+				{
+					buckets[bucketCount++] = bucket;
+				}
+			}
+		}
+	}
+
+	return(bucketCount);
+}
+
+/***********************************************************
+ *  MoveAgents()
+ *
+ *  This method is used for steering the sorted agents in
+ *  the range one neighbor at a time.  It is the fallback for
+ *  processors without AVX2 and gives the same results as
+ *  MoveAgentsAVX2() up to rounding.
+ ***********************************************************/
+void BoidSimulation::MoveAgents(size_t begin, size_t end, float deltaSeconds)
+{
+	const float neighborRadius2 = m_settings.neighborRadius * m_settings.neighborRadius;
+	const float separationRadius2 = m_settings.separationRadius * m_settings.separationRadius;
+	uint32_t buckets[27];
+
+	for (size_t sorted = begin; sorted < end; sorted++)
+	{
+		float x = m_sortedPositionX[sorted];
+		float y = m_sortedPositionY[sorted];
+		float z = m_sortedPositionZ[sorted];
+
+		int neighborCount = 0;
+		glm::vec3 positionSum(0.0f);
+		glm::vec3 velocitySum(0.0f);
+		glm::vec3 separation(0.0f);
+		int bucketCount = FindNeighborBuckets(x, y, z, buckets);
+		for (int i = 0; i < bucketCount; i++)
+		{
+			for (uint32_t other = m_bucketStarts[buckets[i]]; other < m_bucketStarts[buckets[i] + 1]; other++)
+			{
+				float dx = m_sortedPositionX[other] - x;
+				float dy = m_sortedPositionY[other] - y;
+				float dz = m_sortedPositionZ[other] - z;
+				float distance2 = (dx * dx) + (dy * dy) + (dz * dz);
+				if ((distance2 >= neighborRadius2) || (distance2 <= 0.0f))
+				{
+					continue;
+				}
+
+				neighborCount++;
+				positionSum += glm::vec3(m_sortedPositionX[other], m_sortedPositionY[other], m_sortedPositionZ[other]);
+				velocitySum += glm::vec3(m_sortedVelocityX[other], m_sortedVelocityY[other], m_sortedVelocityZ[other]);
+				if (distance2 < separationRadius2)
+				{
+					separation -= glm::vec3(dx, dy, dz) / distance2;
+				}
+			}
+		}
+
+		IntegrateAgent(sorted, deltaSeconds, neighborCount, positionSum, velocitySum, separation);
+	}
+}
+
+/***********************************************************
+ *  MoveAgentsAVX2()
+ *
+ *  This method is used for steering the sorted agents in
+ *  the range eight neighbors at a time.  The agents of a
+ *  bucket are contiguous in the sorted arrays, so they are
+ *  read with plain vector loads, and lanes past the end of
+ *  the bucket, outside the neighbor radius or holding the
+ *  agent itself are masked out of the sums.
+ ***********************************************************/
+#ifdef BOIDS_AVX2
+BOIDS_AVX2_FUNCTION void BoidSimulation::MoveAgentsAVX2(size_t begin, size_t end, float deltaSeconds)
+{
+	const __m256 neighborRadius2 = _mm256_set1_ps(m_settings.neighborRadius * m_settings.neighborRadius);
+	const __m256 separationRadius2 = _mm256_set1_ps(m_settings.separationRadius * m_settings.separationRadius);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256i laneOffsets = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	uint32_t buckets[27];
+
+	for (size_t sorted = begin; sorted < end; sorted++)
+	{
+		float x = m_sortedPositionX[sorted];
+		float y = m_sortedPositionY[sorted];
+		float z = m_sortedPositionZ[sorted];
+		const __m256 agentX = _mm256_set1_ps(x);
+		const __m256 agentY = _mm256_set1_ps(y);
+		const __m256 agentZ = _mm256_set1_ps(z);
+
+		__m256 count = zero;
+		__m256 positionSumX = zero;
+		__m256 positionSumY = zero;
+		__m256 positionSumZ = zero;
+		__m256 velocitySumX = zero;
+		__m256 velocitySumY = zero;
+		__m256 velocitySumZ = zero;
+		__m256 separationX = zero;
+		__m256 separationY = zero;
+		__m256 separationZ = zero;
+
+		int bucketCount = FindNeighborBuckets(x, y, z, buckets);
+		for (int i = 0; i < bucketCount; i++)
+		{
+			uint32_t first = m_bucketStarts[buckets[i]];
+			uint32_t last = m_bucketStarts[buckets[i] + 1];
+			const __m256i bucketEnd = _mm256_set1_epi32(static_cast<int>(last));
+			for (uint32_t other = first; other < last; other += 8)
+			{
+				__m256 otherX = _mm256_loadu_ps(&m_sortedPositionX[other]);
+				__m256 otherY = _mm256_loadu_ps(&m_sortedPositionY[other]);
+				__m256 otherZ = _mm256_loadu_ps(&m_sortedPositionZ[other]);
+				__m256 dx = _mm256_sub_ps(otherX, agentX);
+				__m256 dy = _mm256_sub_ps(otherY, agentY);
+				__m256 dz = _mm256_sub_ps(otherZ, agentZ);
+				__m256 distance2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+
+				__m256i lanes = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(other)), laneOffsets);
+				__m256 inBucket = _mm256_castsi256_ps(_mm256_cmpgt_epi32(bucketEnd, lanes));
+				__m256 neighbor = _mm256_and_ps(inBucket, _mm256_and_ps(
+					_mm256_cmp_ps(distance2, neighborRadius2, _CMP_LT_OQ),
+					_mm256_cmp_ps(distance2, zero, _CMP_GT_OQ)));
+
+				count = _mm256_add_ps(count, _mm256_and_ps(neighbor, one));
+				positionSumX = _mm256_add_ps(positionSumX, _mm256_and_ps(neighbor, otherX));
+				positionSumY = _mm256_add_ps(positionSumY, _mm256_and_ps(neighbor, otherY));
+				positionSumZ = _mm256_add_ps(positionSumZ, _mm256_and_ps(neighbor, otherZ));
+				velocitySumX = _mm256_add_ps(velocitySumX, _mm256_and_ps(neighbor, _mm256_loadu_ps(&m_sortedVelocityX[other])));
+				velocitySumY = _mm256_add_ps(velocitySumY, _mm256_and_ps(neighbor, _mm256_loadu_ps(&m_sortedVelocityY[other])));
+				velocitySumZ = _mm256_add_ps(velocitySumZ, _mm256_and_ps(neighbor, _mm256_loadu_ps(&m_sortedVelocityZ[other])));
+
+				// masked lanes may divide by zero, their result is dropped
+				__m256 close = _mm256_and_ps(neighbor, _mm256_cmp_ps(distance2, separationRadius2, _CMP_LT_OQ));
+				__m256 inverseDistance2 = _mm256_div_ps(one, distance2);
+				separationX = _mm256_sub_ps(separationX, _mm256_and_ps(close, _mm256_mul_ps(dx, inverseDistance2)));
+				separationY = _mm256_sub_ps(separationY, _mm256_and_ps(close, _mm256_mul_ps(dy, inverseDistance2)));
+				separationZ = _mm256_sub_ps(separationZ, _mm256_and_ps(close, _mm256_mul_ps(dz, inverseDistance2)));
+			}
+		}
+
+		IntegrateAgent(
+			sorted,
+			deltaSeconds,
+			static_cast<int>(SumLanes(count)),
+			glm::vec3(SumLanes(positionSumX), SumLanes(positionSumY), SumLanes(positionSumZ)),
+			glm::vec3(SumLanes(velocitySumX), SumLanes(velocitySumY), SumLanes(velocitySumZ)),
+			glm::vec3(SumLanes(separationX), SumLanes(separationY), SumLanes(separationZ)));
+	}
+}
+#else
+void BoidSimulation::MoveAgentsAVX2(size_t begin, size_t end, float deltaSeconds)
+{
+	MoveAgents(begin, end, deltaSeconds);
+}
+#endif
+
+/***********************************************************
+ *  IntegrateAgent()
+ *
+ *  This method is used for steering a sorted agent towards
+ *  the average heading and center of its neighbors, away
+ *  from the ones too close and from the walls, and moving
+ *  it.  The steering and the speed are clamped so the fish
+ *  neither turn on the spot nor stop.
+ ***********************************************************/
+void BoidSimulation::IntegrateAgent(
+	size_t sorted,
+	float deltaSeconds,
+	int neighborCount,
+	glm::vec3 positionSum,
+	glm::vec3 velocitySum,
+	glm::vec3 separation)
+{
+	glm::vec3 position(m_sortedPositionX[sorted], m_sortedPositionY[sorted], m_sortedPositionZ[sorted]);
+	glm::vec3 velocity(m_sortedVelocityX[sorted], m_sortedVelocityY[sorted], m_sortedVelocityZ[sorted]);
+
+	glm::vec3 acceleration = separation * m_settings.separationWeight;
+	if (neighborCount > 0)
+	{
+		float inverseCount = 1.0f / neighborCount;
+		acceleration += ((velocitySum * inverseCount) - velocity) * m_settings.alignmentWeight;
+		acceleration += ((positionSum * inverseCount) - position) * m_settings.cohesionWeight;
+	}
+
+	// walls push back harder the deeper the agent is in the margin
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float low = (m_settings.boundsMin[axis] + m_settings.avoidanceMargin) - position[axis];
+		float high = position[axis] - (m_settings.boundsMax[axis] - m_settings.avoidanceMargin);
+		if (low > 0.0f)
+		{
+			acceleration[axis] += (low / m_settings.avoidanceMargin) * m_settings.avoidanceWeight;
+		}
+		if (high > 0.0f)
+		{
+			acceleration[axis] -= (high / m_settings.avoidanceMargin) * m_settings.avoidanceWeight;
+		}
+	}
+
+	float accelerationLength = glm::length(acceleration);
+	if (accelerationLength > m_settings.maxAcceleration)
+	{
+		acceleration *= m_settings.maxAcceleration / accelerationLength;
+	}
+
+	velocity += acceleration * deltaSeconds;
+	float speed = glm::length(velocity);
+	if (speed < 0.0001f)
+	{
+		velocity = glm::vec3(-m_settings.minSpeed, 0.0f, 0.0f);
+	}
+	else if (speed < m_settings.minSpeed)
+	{
+		velocity *= m_settings.minSpeed / speed;
+	}
+	else if (speed > m_settings.maxSpeed)
+	{
+		velocity *= m_settings.maxSpeed / speed;
+	}
+	position = glm::clamp(position + (velocity * deltaSeconds), m_settings.boundsMin, m_settings.boundsMax);
+
+	uint32_t agent = m_sortedAgents[sorted];
+	m_positionX[agent] = position.x;
+	m_positionY[agent] = position.y;
+	m_positionZ[agent] = position.z;
+	m_velocityX[agent] = velocity.x;
+	m_velocityY[agent] = velocity.y;
+	m_velocityZ[agent] = velocity.z;
+}
+
+/***********************************************************
+ *  EnableCompute()
+ *
+ *  This method is used for moving the simulation into the
+ *  compute shader program.  The agents are uploaded into a
+ *  storage buffer, and the bucket counts, scatter cursors
+ *  and sorted copy get storage buffers of their own.  Needs
+ *  OpenGL 4.3 for compute shaders and storage buffers.
+ ***********************************************************/
+bool BoidSimulation::EnableCompute(GLuint computeProgram, GLuint instanceBuffer)
+{
+	if ((computeProgram == 0) || (instanceBuffer == 0) || (GLEW_VERSION_4_3 == false) || (m_agentCount == 0))
+	{
+		return(false);
+	}
+	if (IsComputeEnabled())
+	{
+		return(true);
+	}
+
+	std::vector<glm::vec4> agents(static_cast<size_t>(m_agentCount) * 2);
+	for (int i = 0; i < m_agentCount; i++)
+	{
+		agents[(i * 2)] = glm::vec4(m_positionX[i], m_positionY[i], m_positionZ[i], 0.0f);
+		agents[(i * 2) + 1] = glm::vec4(m_velocityX[i], m_velocityY[i], m_velocityZ[i], 0.0f);
+	}
+
+	if (m_agentBuffer == 0)
+	{
+		glGenBuffers(1, &m_agentBuffer);
+		glGenBuffers(1, &m_bucketBuffer);
+		glGenBuffers(1, &m_cursorBuffer);
+		glGenBuffers(1, &m_sortedBuffer);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_agentBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, agents.size() * sizeof(glm::vec4), agents.data(), GL_DYNAMIC_COPY);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_bucketBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, m_bucketStarts.size() * sizeof(uint32_t), NULL, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_cursorBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, m_bucketStarts.size() * sizeof(uint32_t), NULL, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_sortedBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, agents.size() * sizeof(glm::vec4), NULL, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	m_computeProgram = computeProgram;
+	m_instanceBuffer = instanceBuffer;
+	return(true);
+}
+
+/***********************************************************
+ *  DisableCompute()
+ *
+ *  This method is used for reading the agents back from the
+ *  storage buffer so the simulation continues on the CPU
+ *  where the compute shaders left it.
+ ***********************************************************/
+void BoidSimulation::DisableCompute()
+{
+	if (IsComputeEnabled() == false)
+	{
+		return;
+	}
+
+	std::vector<glm::vec4> agents(static_cast<size_t>(m_agentCount) * 2);
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_agentBuffer);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, agents.size() * sizeof(glm::vec4), agents.data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	for (int i = 0; i < m_agentCount; i++)
+	{
+		m_positionX[i] = agents[(i * 2)].x;
+		m_positionY[i] = agents[(i * 2)].y;
+		m_positionZ[i] = agents[(i * 2)].z;
+		m_velocityX[i] = agents[(i * 2) + 1].x;
+		m_velocityY[i] = agents[(i * 2) + 1].y;
+		m_velocityZ[i] = agents[(i * 2) + 1].z;
+	}
+
+	m_computeProgram = 0;
+	m_instanceBuffer = 0;
+}
+
+/***********************************************************
+ *  StepCompute()
+ *
+ *  This method is used for running one step in the compute
+ *  shader, as four passes over the same program: counting
+ *  the agents of each bucket, summing the counts into
+ *  bucket starts in one work group, scattering the agents
+ *  into the sorted copy, and steering and moving them.  The
+ *  last pass also writes the position and heading of each
+ *  fish into the instance buffer it is drawn from.
+ ***********************************************************/
+void BoidSimulation::StepCompute(float deltaSeconds)
+{
+	GLint oldProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &oldProgram);
+	glUseProgram(m_computeProgram);
+
+	glUniform1ui(glGetUniformLocation(m_computeProgram, "agentCount"), static_cast<GLuint>(m_agentCount));
+	glUniform1ui(glGetUniformLocation(m_computeProgram, "bucketMask"), m_bucketMask);
+	glUniform1f(glGetUniformLocation(m_computeProgram, "deltaSeconds"), deltaSeconds);
+	glUniform1f(glGetUniformLocation(m_computeProgram, "neighborRadius"), m_settings.neighborRadius);
+	glUniform1f(glGetUniformLocation(m_computeProgram, "separationRadius"), m_settings.separationRadius);
+	glUniform1f(glGetUniformLocation(m_computeProgram, "separationWeight"), m_settings.separationWeight);
+	glUniform1f(glGetUniformLocation(m_computeProgram, "alignmentWeight"), m_settings.alignmentWeight);
+	glUniform1f(glGetUniformLocation(m_computeProgram, "cohesionWeight"), m_settings.cohesionWeight);
+	glUniform1f(glGetUniformLocation(m_computeProgram, "avoidanceMargin"), m_settings.avoidanceMargin);
+	glUniform1f(glGetUniformLocation(m_computeProgram, "avoidanceWeight"), m_settings.avoidanceWeight);
+	glUniform1f(glGetUniformLocation(m_computeProgram, "maxAcceleration"), m_settings.maxAcceleration);
+	glUniform1f(glGetUniformLocation(m_computeProgram, "minSpeed"), m_settings.minSpeed);
+	glUniform1f(glGetUniformLocation(m_computeProgram, "maxSpeed"), m_settings.maxSpeed);
+	glUniform3fv(glGetUniformLocation(m_computeProgram, "boundsMin"), 1, &m_settings.boundsMin[0]);
+	glUniform3fv(glGetUniformLocation(m_computeProgram, "boundsMax"), 1, &m_settings.boundsMax[0]);
+	GLint passLocation = glGetUniformLocation(m_computeProgram, "simulationPass");
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_agentBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_bucketBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_cursorBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_sortedBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, m_instanceBuffer);
+
+	const GLuint agentGroups = (m_agentCount + BOIDS_COMPUTE_GROUP_SIZE - 1) / BOIDS_COMPUTE_GROUP_SIZE;
+	GLuint zeroCount = 0;
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_bucketBuffer);
+	glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zeroCount);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	glUniform1i(passLocation, BOIDS_PASS_COUNT);
+	glDispatchCompute(agentGroups, 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	glUniform1i(passLocation, BOIDS_PASS_SCAN);
+	glDispatchCompute(1, 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	glUniform1i(passLocation, BOIDS_PASS_SCATTER);
+	glDispatchCompute(agentGroups, 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	glUniform1i(passLocation, BOIDS_PASS_MOVE);
+	glDispatchCompute(agentGroups, 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+
+	glUseProgram(oldProgram);
+}
+
+/***********************************************************
+ *  Benchmark()
+ *
+ *  This method is used for timing a hundred thousand agents
+ *  spread through a box 22 meters across, about nine to the
+ *  cubic meter so each has a handful of neighbors, on the
+ *  CPU against the number of threads.  Each run starts
+ *  from the same agents and reports the average time of
+ *  the sort alone and of the whole step, and the slowest
+ *  step.  The scalar kernel is timed too when the CPU has
+ *  AVX2.
+ ***********************************************************/
+void BoidSimulation::Benchmark()
+{
+	const int agentCount = 100000;
+	const int stepCount = 120;
+	const float halfSize = 11.0f;
+	unsigned int coreCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+	std::vector<unsigned int> threadCounts;
+	for (unsigned int threads = 1; threads < coreCount; threads *= 2)
+	{
+		threadCounts.push_back(threads);
+	}
+	threadCounts.push_back(coreCount);
+
+	BOID_SETTINGS settings;
+	settings.boundsMin = glm::vec3(-halfSize);
+	settings.boundsMax = glm::vec3(halfSize);
+	std::mt19937 random(5);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::vector<glm::vec3> positions(agentCount);
+	std::vector<glm::vec3> velocities(agentCount);
+	for (int i = 0; i < agentCount; i++)
+	{
+		positions[i] = glm::vec3(unit(random), unit(random), unit(random)) * (halfSize - settings.avoidanceMargin);
+		velocities[i] = glm::vec3(unit(random), unit(random), unit(random));
+	}
+
+	std::vector<bool> kernels;
+	if (CpuSupportsAVX2())
+	{
+		kernels.push_back(true);
+	}
+	kernels.push_back(false);
+
+	std::cout << "Boids benchmark, " << agentCount << " agents" << std::endl;
+	std::cout << "kernel  threads  sort ms  step ms  slowest ms" << std::endl;
+
+	for (int k = 0; k < kernels.size(); k++)
+	{
+		for (int t = 0; t < threadCounts.size(); t++)
+		{
+			// the calling thread works too, so one fewer worker
+			JobSystem* pJobSystem = NULL;
+			if (threadCounts[t] > 1)
+			{
+				pJobSystem = new JobSystem(threadCounts[t] - 1);
+			}
+
+			BoidSimulation simulation;
+			simulation.Initialize(positions, velocities, settings);
+			simulation.m_bAVX2 = kernels[k];
+
+			double sortMilliseconds = 0.0;
+			double totalMilliseconds = 0.0;
+			double slowestMilliseconds = 0.0;
+			for (int i = 0; i < stepCount; i++)
+			{
+				// the sort is timed on its own first, and again as part
+				// of the step, which sorts the same agents
+				std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+				simulation.SortAgents(pJobSystem);
+				sortMilliseconds += std::chrono::duration<double, std::milli>(
+					std::chrono::steady_clock::now() - startTime).count();
+
+				startTime = std::chrono::steady_clock::now();
+				simulation.Step(BOIDS_STEP_SECONDS, pJobSystem);
+				double milliseconds = std::chrono::duration<double, std::milli>(
+					std::chrono::steady_clock::now() - startTime).count();
+				totalMilliseconds += milliseconds;
+				slowestMilliseconds = std::max(slowestMilliseconds, milliseconds);
+			}
+
+			std::cout << (kernels[k] ? "AVX2" : "scalar") << "  " << threadCounts[t] << "  "
+				<< (sortMilliseconds / stepCount) << "  " << (totalMilliseconds / stepCount) << "  "
+				<< slowestMilliseconds << std::endl;
+
+			delete pJobSystem;
+		}
+	}
+}
@@ -0,0 +1,151 @@
+///////////////////////////////////////////////////////////////////////////////
+// boidsimulation.h
+// ============
+// flock large schools of fish with a spatial hash and vectorized force kernels
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "JobSystem.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// tuning of the flocking rules, in world units and seconds
+struct BOID_SETTINGS
+{
+	// agents closer than this are neighbors, also the hash cell size
+	float neighborRadius = 0.6f;
+	// neighbors closer than this are pushed away
+	float separationRadius = 0.25f;
+	float separationWeight = 0.08f;
+	float alignmentWeight = 1.2f;
+	float cohesionWeight = 0.9f;
+	// the walls of the bounds push back over this distance
+	float avoidanceMargin = 1.0f;
+	float avoidanceWeight = 6.0f;
+	// limits on the steering and the swimming speed
+	float maxAcceleration = 4.0f;
+	float minSpeed = 0.5f;
+	float maxSpeed = 1.6f;
+	// box the agents are kept in
+	glm::vec3 boundsMin = glm::vec3(-1.0f);
+	glm::vec3 boundsMax = glm::vec3(1.0f);
+};
+
+/***********************************************************
+ *  BoidSimulation
+ *
+ *  This class moves a flock of agents by separation,
+ *  alignment and cohesion with their neighbors and by
+ *  avoiding the walls of a box.  The agents are kept as
+ *  separate arrays of each coordinate.  Every step hashes
+ *  them into a grid of cells the size of the neighbor
+ *  radius and counting sorts a copy of them by cell, so
+ *  the agents of a cell lie next to each other and the
+ *  force kernel reads them eight at a time with AVX2 when
+ *  the CPU has it.  Agents are split across the workers.
+ *  The same steps can instead run in compute shaders on
+ *  OpenGL 4.3, writing the instances of the fish directly.
+ ***********************************************************/
+class BoidSimulation
+{
+public:
+	// constructor
+	BoidSimulation();
+	// destructor
+	~BoidSimulation();
+
+	// replace the agents and the flocking rules
+	void Initialize(
+		const std::vector<glm::vec3>& positions,
+		const std::vector<glm::vec3>& velocities,
+		const BOID_SETTINGS& settings);
+
+	// advance the simulation in fixed steps by the passed in time
+	void Update(float deltaSeconds, JobSystem* pJobSystem);
+
+	// get the number of agents
+	int GetAgentCount() const { return(m_agentCount); }
+	// get the state of an agent after the last step on the CPU
+	glm::vec3 GetPosition(int agent) const { return(glm::vec3(m_positionX[agent], m_positionY[agent], m_positionZ[agent])); }
+	glm::vec3 GetVelocity(int agent) const { return(glm::vec3(m_velocityX[agent], m_velocityY[agent], m_velocityZ[agent])); }
+	const BOID_SETTINGS& GetSettings() const { return(m_settings); }
+	// true when the force kernel runs with AVX2
+	bool IsVectorized() const { return(m_bAVX2); }
+
+	// move the simulation into compute shaders, writing the position
+	// and heading of each agent into the passed in instance buffer,
+	// which holds two vec4 per agent; false when not supported
+	bool EnableCompute(GLuint computeProgram, GLuint instanceBuffer);
+	// read the agents back and continue on the CPU
+	void DisableCompute();
+	// true while the simulation runs in compute shaders
+	bool IsComputeEnabled() const { return(m_computeProgram != 0); }
+
+	// time the steps of a hundred thousand agents on the CPU against
+	// the number of threads, with and without AVX2
+	static void Benchmark();
+
+private:
+	BOID_SETTINGS m_settings;
+	int m_agentCount;
+	bool m_bAVX2;
+	// simulated time not yet stepped through
+	float m_pendingTime;
+
+	// agent state, one array per coordinate
+	std::vector<float> m_positionX;
+	std::vector<float> m_positionY;
+	std::vector<float> m_positionZ;
+	std::vector<float> m_velocityX;
+	std::vector<float> m_velocityY;
+	std::vector<float> m_velocityZ;
+
+	// hash bucket of each agent and the first sorted agent of each
+	// bucket, with one more entry holding the agent count
+	std::vector<uint32_t> m_agentBuckets;
+	std::vector<uint32_t> m_bucketStarts;
+	uint32_t m_bucketMask;
+	// copy of the agents in bucket order, padded for full vector loads,
+	// and the index each sorted agent has in the arrays above
+	std::vector<float> m_sortedPositionX;
+	std::vector<float> m_sortedPositionY;
+	std::vector<float> m_sortedPositionZ;
+	std::vector<float> m_sortedVelocityX;
+	std::vector<float> m_sortedVelocityY;
+	std::vector<float> m_sortedVelocityZ;
+	std::vector<uint32_t> m_sortedAgents;
+
+	// compute shader program and buffers, zero while on the CPU
+	GLuint m_computeProgram;
+	GLuint m_agentBuffer;
+	GLuint m_bucketBuffer;
+	GLuint m_cursorBuffer;
+	GLuint m_sortedBuffer;
+	GLuint m_instanceBuffer;
+
+	// run one step of the simulation on the CPU
+	void Step(float deltaSeconds, JobSystem* pJobSystem);
+	// run one step of the simulation in the compute shaders
+	void StepCompute(float deltaSeconds);
+	// hash each agent into its bucket and sort a copy of them by bucket
+	void SortAgents(JobSystem* pJobSystem);
+	// gather the distinct buckets of the cells around a position,
+	// returns their number
+	int FindNeighborBuckets(float x, float y, float z, uint32_t* buckets) const;
+	// steer and move the sorted agents in [begin, end)
+	void MoveAgents(size_t begin, size_t end, float deltaSeconds);
+	void MoveAgentsAVX2(size_t begin, size_t end, float deltaSeconds);
+	// add the steering, clamp the speed and write the moved agent
+	void IntegrateAgent(
+		size_t sorted,
+		float deltaSeconds,
+		int neighborCount,
+		glm::vec3 positionSum,
+		glm::vec3 velocitySum,
+		glm::vec3 separation);
+};
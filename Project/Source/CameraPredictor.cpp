@@ -0,0 +1,185 @@
+///////////////////////////////////////////////////////////////////////////////
+// camerapredictor.cpp
+// ============
+// extrapolate the path of the camera to load what it will see ahead of time
+///////////////////////////////////////////////////////////////////////////////
+
+#include "CameraPredictor.h"
+
+#include <glm/gtc/constants.hpp>
+
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	// a frame longer than this is a stall or a jump of the camera, and
+	// says nothing about its motion
+	const float PREDICTION_MAX_FRAME_SECONDS = 0.25f;
+	// steps a prediction is integrated in
+	const int PREDICTION_STEPS = 8;
+	const glm::vec3 PREDICTION_UP = glm::vec3(0.0f, 1.0f, 0.0f);
+
+	/***********************************************************
+	 *  GetYaw()
+	 *
+	 *  Heading of a front direction about the vertical.
+	 ***********************************************************/
+	float GetYaw(glm::vec3 front)
+	{
+		return(std::atan2(front.z, front.x));
+	}
+
+	/***********************************************************
+	 *  GetFlatFront()
+	 *
+	 *  Level direction along a heading.
+	 ***********************************************************/
+	glm::vec3 GetFlatFront(float yaw)
+	{
+		return(glm::vec3(std::cos(yaw), 0.0f, std::sin(yaw)));
+	}
+}
+
+/***********************************************************
+ *  CameraPredictor()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+CameraPredictor::CameraPredictor()
+{
+	Reset();
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for keeping the settings of the
+ *  predictions.
+ ***********************************************************/
+void CameraPredictor::Initialize(const CAMERA_PREDICTION_SETTINGS& settings)
+{
+	m_settings = settings;
+	Reset();
+}
+
+/***********************************************************
+ *  Reset()
+ *
+ *  This method is used for forgetting the motion measured
+ *  so far, so the next two samples start it again.
+ ***********************************************************/
+void CameraPredictor::Reset()
+{
+	m_position = glm::vec3(0.0f);
+	m_front = glm::vec3(0.0f, 0.0f, -1.0f);
+	m_sampleCount = 0;
+	m_localVelocity = glm::vec3(0.0f);
+	m_yawRate = 0.0f;
+}
+
+/***********************************************************
+ *  AddSample()
+ *
+ *  This method is used for measuring the motion since the
+ *  last sample and averaging it in.  The velocity is kept
+ *  in the frame of the camera at the middle of the step,
+ *  and the turn rate from the change of heading, wrapped
+ *  to the shorter way around.  A stalled frame starts the
+ *  measurement again from this sample.
+ ***********************************************************/
+void CameraPredictor::AddSample(glm::vec3 position, glm::vec3 front, float deltaSeconds)
+{
+	// looking straight up or down keeps the last heading
+	if (glm::length(glm::vec2(front.x, front.z)) < 0.0001f)
+	{
+		front = glm::vec3(m_front.x, front.y, m_front.z);
+	}
+
+	if ((m_sampleCount == 0) || (deltaSeconds <= 0.0f) || (deltaSeconds > PREDICTION_MAX_FRAME_SECONDS))
+	{
+		m_position = position;
+		m_front = front;
+		m_localVelocity = glm::vec3(0.0f);
+		m_yawRate = 0.0f;
+		m_sampleCount = 1;
+		return;
+	}
+
+	float lastYaw = GetYaw(m_front);
+	float yawChange = GetYaw(front) - lastYaw;
+	if (yawChange > glm::pi<float>())
+	{
+		yawChange -= glm::two_pi<float>();
+	}
+	else if (yawChange < -glm::pi<float>())
+	{
+		yawChange += glm::two_pi<float>();
+	}
+
+	glm::vec3 flatFront = GetFlatFront(lastYaw + (0.5f * yawChange));
+	glm::vec3 right = glm::cross(flatFront, PREDICTION_UP);
+	glm::vec3 velocity = (position - m_position) / deltaSeconds;
+	glm::vec3 localVelocity(glm::dot(velocity, right), velocity.y, glm::dot(velocity, flatFront));
+
+	float blend = 1.0f;
+	if (m_settings.smoothingSeconds > 0.0f)
+	{
+		blend = 1.0f - std::exp(-deltaSeconds / m_settings.smoothingSeconds);
+	}
+	if (m_sampleCount == 1)
+	{
+		// the first measured step has nothing to average with
+		blend = 1.0f;
+	}
+	m_localVelocity += (localVelocity - m_localVelocity) * blend;
+	m_yawRate += ((yawChange / deltaSeconds) - m_yawRate) * blend;
+
+	m_position = position;
+	m_front = front;
+	m_sampleCount = 2;
+}
+
+/***********************************************************
+ *  Predict()
+ *
+ *  This method is used for extrapolating the camera.  The
+ *  heading turns at the averaged rate, the pitch is held,
+ *  and the position follows the averaged velocity turned
+ *  along with the heading, integrated in a few steps.
+ ***********************************************************/
+void CameraPredictor::Predict(float seconds, glm::vec3& position, glm::vec3& front) const
+{
+	position = m_position;
+	front = m_front;
+	if ((IsReady() == false) || (seconds <= 0.0f))
+	{
+		return;
+	}
+
+	float yaw = GetYaw(m_front);
+	float step = seconds / PREDICTION_STEPS;
+	for (int i = 0; i < PREDICTION_STEPS; i++)
+	{
+		glm::vec3 flatFront = GetFlatFront(yaw + (m_yawRate * (i + 0.5f) * step));
+		glm::vec3 right = glm::cross(flatFront, PREDICTION_UP);
+		position += ((right * m_localVelocity.x) + (PREDICTION_UP * m_localVelocity.y) + (flatFront * m_localVelocity.z)) * step;
+	}
+
+	float flatLength = glm::length(glm::vec2(m_front.x, m_front.z));
+	glm::vec3 flatFront = GetFlatFront(yaw + (m_yawRate * seconds));
+	front = glm::vec3(flatFront.x * flatLength, m_front.y, flatFront.z * flatLength);
+}
+
+/***********************************************************
+ *  GetVelocity()
+ *
+ *  This method is used for getting the averaged velocity
+ *  turned back into world space.
+ ***********************************************************/
+glm::vec3 CameraPredictor::GetVelocity() const
+{
+	glm::vec3 flatFront = GetFlatFront(GetYaw(m_front));
+	glm::vec3 right = glm::cross(flatFront, PREDICTION_UP);
+	return((right * m_localVelocity.x) + (PREDICTION_UP * m_localVelocity.y) + (flatFront * m_localVelocity.z));
+}
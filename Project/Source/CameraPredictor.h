@@ -0,0 +1,69 @@
+///////////////////////////////////////////////////////////////////////////////
+// camerapredictor.h
+// ============
+// extrapolate the path of the camera to load what it will see ahead of time
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+// how far ahead the camera is predicted and how quickly the prediction
+// follows changes of its motion
+struct CAMERA_PREDICTION_SETTINGS
+{
+	// time ahead of the camera covered by the predictions, split into
+	// this many evenly spaced views
+	float horizonSeconds = 0.4f;
+	int viewCount = 4;
+	// time over which the measured velocity and turn rate are averaged
+	float smoothingSeconds = 0.1f;
+};
+
+/***********************************************************
+ *  CameraPredictor
+ *
+ *  This class follows the camera from frame to frame and
+ *  extrapolates where it will be.  The camera moves along
+ *  its own heading, so the averaged velocity is kept in the
+ *  frame of the camera, together with how fast it turns
+ *  about the vertical, and a prediction turns the heading
+ *  at that rate while carrying the velocity around with it.
+ *  A camera flying a curve is then predicted along the
+ *  curve rather than off its tangent.
+ ***********************************************************/
+class CameraPredictor
+{
+public:
+	// constructor
+	CameraPredictor();
+
+	// keep the passed in settings and forget the motion so far
+	void Initialize(const CAMERA_PREDICTION_SETTINGS& settings);
+	// forget the motion so far, as after the camera jumped
+	void Reset();
+	// add the camera of a frame, the passed in seconds after the last
+	void AddSample(glm::vec3 position, glm::vec3 front, float deltaSeconds);
+	// get the position and front direction of the camera the passed in
+	// seconds ahead
+	void Predict(float seconds, glm::vec3& position, glm::vec3& front) const;
+
+	// true once the motion was measured over two frames
+	bool IsReady() const { return(m_sampleCount >= 2); }
+	const CAMERA_PREDICTION_SETTINGS& GetSettings() const { return(m_settings); }
+	// get the averaged velocity in world space
+	glm::vec3 GetVelocity() const;
+
+private:
+	CAMERA_PREDICTION_SETTINGS m_settings;
+
+	// camera of the last sample
+	glm::vec3 m_position;
+	glm::vec3 m_front;
+	int m_sampleCount;
+	// averaged velocity along the right, up and flat front directions
+	// of the camera, and turn rate about the vertical in radians per
+	// second
+	glm::vec3 m_localVelocity;
+	float m_yawRate;
+};
@@ -0,0 +1,430 @@
+///////////////////////////////////////////////////////////////////////////////
+// editserver.cpp
+// ============
+// receive scene edits from external tools over a local socket
+///////////////////////////////////////////////////////////////////////////////
+
+#include "EditServer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <afunix.h>
+typedef SOCKET EDIT_SOCKET;
+#define CloseEditSocket closesocket
+#else
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+typedef int EDIT_SOCKET;
+#define INVALID_SOCKET (-1)
+#define CloseEditSocket close
+#endif
+
+// declaration of global variables
+namespace
+{
+	// bytes of the header in front of every edit
+	const size_t EDIT_HEADER_SIZE = 4;
+	// most values a single edit carries
+	const int EDIT_MAX_VALUES = 4;
+	// time the server thread waits for data before checking for a stop
+	const long EDIT_POLL_MICROSECONDS = 20000;
+
+	// names of the kinds and properties as used in the scene settings
+	const char* g_EditKindNames[] = { "", "light", "material", "object" };
+	const char* g_EditPropertyNames[] =
+	{
+		"",
+		"position",
+		"scale",
+		"rotation",
+		"color",
+		"uvScale",
+		"ambient",
+		"diffuse",
+		"specular",
+		"shininess",
+		"direction",
+		"constant",
+		"linear",
+		"quadratic"
+	};
+	const int EDIT_KIND_COUNT = sizeof(g_EditKindNames) / sizeof(g_EditKindNames[0]);
+	const int EDIT_PROPERTY_COUNT = sizeof(g_EditPropertyNames) / sizeof(g_EditPropertyNames[0]);
+
+	// a connected tool and the bytes of its unfinished edit
+	struct EDIT_CLIENT
+	{
+		EDIT_SOCKET socket;
+		std::vector<uint8_t> received;
+	};
+}
+
+/***********************************************************
+ *  EditServer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+EditServer::EditServer()
+{
+	m_rejectedEdits = 0;
+	m_bStop = false;
+}
+
+/***********************************************************
+ *  ~EditServer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+EditServer::~EditServer()
+{
+	Stop();
+}
+
+/***********************************************************
+ *  Start()
+ *
+ *  This method is used for creating the listening socket at
+ *  the passed in path and starting the server thread.  A
+ *  socket file left behind by an earlier run is replaced.
+ ***********************************************************/
+bool EditServer::Start(const char* socketPath)
+{
+	if (m_thread.joinable())
+	{
+		return(true);
+	}
+
+#ifdef _WIN32
+	WSADATA wsaData;
+	if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+	{
+		std::cout << "Could not initialize sockets for scene editing" << std::endl;
+		return(false);
+	}
+#endif
+
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	size_t pathLength = strlen(socketPath);
+	if (pathLength >= sizeof(address.sun_path))
+	{
+		std::cout << "Scene edit socket path is too long:" << socketPath << std::endl;
+		return(false);
+	}
+	memcpy(address.sun_path, socketPath, pathLength + 1);
+
+	EDIT_SOCKET listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listenSocket == INVALID_SOCKET)
+	{
+		std::cout << "Could not create the scene edit socket" << std::endl;
+		return(false);
+	}
+
+	remove(socketPath);
+	if ((bind(listenSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) ||
+		(listen(listenSocket, 4) != 0))
+	{
+		std::cout << "Could not listen for scene edits on:" << socketPath << std::endl;
+		CloseEditSocket(listenSocket);
+		return(false);
+	}
+
+	m_socketPath = socketPath;
+	m_bStop = false;
+	m_thread = std::thread(&EditServer::ServerLoop, this, static_cast<uintptr_t>(listenSocket));
+
+	std::cout << "Listening for scene edits on:" << socketPath << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  Stop()
+ *
+ *  This method is used for stopping the server thread, which
+ *  closes every socket it opened, and removing the socket
+ *  file.
+ ***********************************************************/
+void EditServer::Stop()
+{
+	if (m_thread.joinable() == false)
+	{
+		return;
+	}
+
+	m_bStop = true;
+	m_thread.join();
+	remove(m_socketPath.c_str());
+
+#ifdef _WIN32
+	WSACleanup();
+#endif
+}
+
+/***********************************************************
+ *  CollectEdits()
+ *
+ *  This method is used for taking the queued edits and the
+ *  count of the edits rejected along with them.
+ ***********************************************************/
+int EditServer::CollectEdits(std::vector<SCENE_SETTING>& edits)
+{
+	edits.clear();
+	std::lock_guard<std::mutex> lock(m_mutex);
+	edits.swap(m_edits);
+	int rejectedCount = m_rejectedEdits;
+	m_rejectedEdits = 0;
+	return(rejectedCount);
+}
+
+/***********************************************************
+ *  ServerLoop()
+ *
+ *  This method is run by the server thread.  It waits on
+ *  the listening socket and every connected tool at once,
+ *  and queues each batch of decoded edits with one lock, so
+ *  the render loop never waits on a slow tool.
+ ***********************************************************/
+void EditServer::ServerLoop(uintptr_t listenSocketValue)
+{
+	EDIT_SOCKET listenSocket = static_cast<EDIT_SOCKET>(listenSocketValue);
+	std::vector<EDIT_CLIENT> clients;
+	std::vector<SCENE_SETTING> edits;
+	int rejectedCount = 0;
+	uint8_t buffer[65536];
+
+	while (m_bStop == false)
+	{
+		fd_set readSet;
+		FD_ZERO(&readSet);
+		FD_SET(listenSocket, &readSet);
+		EDIT_SOCKET maxSocket = listenSocket;
+		for (size_t i = 0; i < clients.size(); i++)
+		{
+			FD_SET(clients[i].socket, &readSet);
+			if (clients[i].socket > maxSocket)
+			{
+				maxSocket = clients[i].socket;
+			}
+		}
+
+		timeval timeout;
+		timeout.tv_sec = 0;
+		timeout.tv_usec = EDIT_POLL_MICROSECONDS;
+		if (select(static_cast<int>(maxSocket + 1), &readSet, NULL, NULL, &timeout) <= 0)
+		{
+			continue;
+		}
+
+		if (FD_ISSET(listenSocket, &readSet))
+		{
+			EDIT_CLIENT client;
+			client.socket = accept(listenSocket, NULL, NULL);
+			if ((client.socket != INVALID_SOCKET) && (clients.size() + 1 < FD_SETSIZE))
+			{
+				clients.push_back(client);
+			}
+			else if (client.socket != INVALID_SOCKET)
+			{
+				CloseEditSocket(client.socket);
+			}
+		}
+
+		for (size_t i = 0; i < clients.size(); i++)
+		{
+			EDIT_CLIENT& client = clients[i];
+			if (FD_ISSET(client.socket, &readSet) == false)
+			{
+				continue;
+			}
+
+			int byteCount = static_cast<int>(recv(client.socket, reinterpret_cast<char*>(buffer), sizeof(buffer), 0));
+			bool bConnected = (byteCount > 0);
+			if (bConnected)
+			{
+				client.received.insert(client.received.end(), buffer, buffer + byteCount);
+				bConnected = DecodeEdits(client.received, edits, rejectedCount);
+			}
+			if (bConnected == false)
+			{
+				CloseEditSocket(client.socket);
+				clients.erase(clients.begin() + i);
+				i--;
+			}
+		}
+
+		if ((edits.size() > 0) || (rejectedCount > 0))
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_edits.insert(m_edits.end(), edits.begin(), edits.end());
+			m_rejectedEdits += rejectedCount;
+			edits.clear();
+			rejectedCount = 0;
+		}
+	}
+
+	for (size_t i = 0; i < clients.size(); i++)
+	{
+		CloseEditSocket(clients[i].socket);
+	}
+	CloseEditSocket(listenSocket);
+}
+
+/***********************************************************
+ *  DecodeEdits()
+ *
+ *  This method is used for decoding every complete edit at
+ *  the start of the received bytes, leaving a partly
+ *  received edit for the next read.  An invalid header
+ *  means the stream can no longer be followed, so the tool
+ *  is disconnected.  An edit with a value that is not
+ *  finite is dropped and counted, since it would spread
+ *  through the transforms and the lighting.
+ ***********************************************************/
+bool EditServer::DecodeEdits(std::vector<uint8_t>& received, std::vector<SCENE_SETTING>& edits, int& rejectedCount)
+{
+	size_t offset = 0;
+	while (received.size() - offset >= EDIT_HEADER_SIZE)
+	{
+		const uint8_t* header = &received[offset];
+		int kind = header[0];
+		int property = header[1];
+		int tagLength = header[2];
+		int valueCount = header[3];
+		if ((kind <= 0) || (kind >= EDIT_KIND_COUNT) ||
+			(property <= 0) || (property >= EDIT_PROPERTY_COUNT) ||
+			(tagLength == 0) ||
+			(valueCount <= 0) || (valueCount > EDIT_MAX_VALUES))
+		{
+			std::cout << "Invalid scene edit received, disconnecting the tool" << std::endl;
+			return(false);
+		}
+
+		size_t editSize = EDIT_HEADER_SIZE + tagLength + (valueCount * sizeof(float));
+		if (received.size() - offset < editSize)
+		{
+			break;
+		}
+
+		SCENE_SETTING edit;
+		edit.kind = g_EditKindNames[kind];
+		edit.tag.assign(reinterpret_cast<const char*>(header + EDIT_HEADER_SIZE), tagLength);
+		edit.property = g_EditPropertyNames[property];
+		edit.values.resize(valueCount);
+		memcpy(edit.values.data(), header + EDIT_HEADER_SIZE + tagLength, valueCount * sizeof(float));
+		edit.line = 0;
+		offset += editSize;
+
+		bool bFinite = true;
+		for (int i = 0; i < valueCount; i++)
+		{
+			bFinite = bFinite && std::isfinite(edit.values[i]);
+		}
+		if (bFinite == false)
+		{
+			rejectedCount++;
+			continue;
+		}
+		edits.push_back(edit);
+	}
+
+	received.erase(received.begin(), received.begin() + offset);
+	return(true);
+}
+
+/***********************************************************
+ *  Benchmark()
+ *
+ *  This method is used for timing a tool that sends twenty
+ *  thousand object edits in one burst, from the first byte
+ *  sent until the last edit has been collected, polling
+ *  the way the render loop does between frames.
+ ***********************************************************/
+void EditServer::Benchmark()
+{
+	const char* socketPath = "benchmarkEdit.sock";
+	const int editCount = 20000;
+	const int objectCount = 100;
+
+	EditServer server;
+	if (server.Start(socketPath) == false)
+	{
+		return;
+	}
+
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	memcpy(address.sun_path, socketPath, strlen(socketPath) + 1);
+	EDIT_SOCKET toolSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if ((toolSocket == INVALID_SOCKET) ||
+		(connect(toolSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0))
+	{
+		std::cout << "Could not connect to the scene edit socket" << std::endl;
+		if (toolSocket != INVALID_SOCKET)
+		{
+			CloseEditSocket(toolSocket);
+		}
+		return;
+	}
+
+	// positions of a hundred objects, moved over and over
+	std::vector<uint8_t> burst;
+	for (int i = 0; i < editCount; i++)
+	{
+		char tag[16];
+		int tagLength = snprintf(tag, sizeof(tag), "object%d", i % objectCount);
+		uint8_t header[EDIT_HEADER_SIZE] = { EDIT_KIND_OBJECT, EDIT_PROPERTY_POSITION, static_cast<uint8_t>(tagLength), 3 };
+		float values[3] = { i * 0.001f, 1.0f, -i * 0.001f };
+		burst.insert(burst.end(), header, header + EDIT_HEADER_SIZE);
+		burst.insert(burst.end(), tag, tag + tagLength);
+		const uint8_t* valueBytes = reinterpret_cast<const uint8_t*>(values);
+		burst.insert(burst.end(), valueBytes, valueBytes + sizeof(values));
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	size_t sent = 0;
+	while (sent < burst.size())
+	{
+		int byteCount = static_cast<int>(send(toolSocket, reinterpret_cast<const char*>(burst.data() + sent), static_cast<int>(burst.size() - sent), 0));
+		if (byteCount <= 0)
+		{
+			break;
+		}
+		sent += byteCount;
+	}
+
+	std::vector<SCENE_SETTING> edits;
+	int collected = 0;
+	int collectCount = 0;
+	size_t largestCollect = 0;
+	while ((collected < editCount) && (std::chrono::steady_clock::now() - start < std::chrono::seconds(10)))
+	{
+		collected += server.CollectEdits(edits);
+		collected += static_cast<int>(edits.size());
+		if (edits.size() > 0)
+		{
+			collectCount++;
+			largestCollect = std::max(largestCollect, edits.size());
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	CloseEditSocket(toolSocket);
+	server.Stop();
+
+	std::cout << "Scene edits over the local socket, " << burst.size() << " bytes in one burst" << std::endl;
+	std::cout << "edits  collected  collects  largest  total ms  edits/s" << std::endl;
+	printf("%5d  %9d  %8d  %7zu  %8.2f  %7.0f\n",
+		editCount, collected, collectCount, largestCollect, milliseconds, collected * 1000.0 / milliseconds);
+}
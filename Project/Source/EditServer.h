@@ -0,0 +1,97 @@
+///////////////////////////////////////////////////////////////////////////////
+// editserver.h
+// ============
+// receive scene edits from external tools over a local socket
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneFile.h"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Every edit sent to the socket is a 4 byte header followed by the
+// tag of the edited item and its new values:
+//     uint8   kind          EDIT_KIND value
+//     uint8   property      EDIT_PROPERTY value
+//     uint8   tagLength     bytes of the tag that follows, not terminated
+//     uint8   valueCount    1 to 4 little-endian 32-bit floats after the tag
+// The values are the same as in the scene settings file, so an edit of
+//     light sunLight diffuse 1.0 0.98 0.9
+// is sent as { 1, 7, 8, 3 } "sunLight" 1.0f 0.98f 0.9f
+
+// kind of scene item an edit applies to
+enum EDIT_KIND
+{
+	EDIT_KIND_LIGHT = 1,
+	EDIT_KIND_MATERIAL = 2,
+	EDIT_KIND_OBJECT = 3
+};
+
+// value of the scene item an edit sets
+enum EDIT_PROPERTY
+{
+	EDIT_PROPERTY_POSITION = 1,
+	EDIT_PROPERTY_SCALE = 2,
+	EDIT_PROPERTY_ROTATION = 3,
+	EDIT_PROPERTY_COLOR = 4,
+	EDIT_PROPERTY_UV_SCALE = 5,
+	EDIT_PROPERTY_AMBIENT = 6,
+	EDIT_PROPERTY_DIFFUSE = 7,
+	EDIT_PROPERTY_SPECULAR = 8,
+	EDIT_PROPERTY_SHININESS = 9,
+	EDIT_PROPERTY_DIRECTION = 10,
+	EDIT_PROPERTY_CONSTANT = 11,
+	EDIT_PROPERTY_LINEAR = 12,
+	EDIT_PROPERTY_QUADRATIC = 13
+};
+
+/***********************************************************
+ *  EditServer
+ *
+ *  This class listens on a Unix domain socket on a thread
+ *  of its own, decodes the edits sent by any number of
+ *  connected tools, and queues them as scene settings until
+ *  the render loop collects them between two frames.
+ ***********************************************************/
+class EditServer
+{
+public:
+	// constructor
+	EditServer();
+	// destructor
+	~EditServer();
+
+	// start listening on the socket file, returns false on errors
+	bool Start(const char* socketPath);
+	// stop listening and disconnect every tool
+	void Stop();
+	// take the edits received since the last call, in arrival order,
+	// returns how many were rejected for values that are not finite
+	int CollectEdits(std::vector<SCENE_SETTING>& edits);
+
+	// time a burst of edits from a tool through the socket until
+	// every one is collected, and report the edits per second
+	static void Benchmark();
+
+private:
+	std::string m_socketPath;
+	std::vector<SCENE_SETTING> m_edits;
+	// edits dropped since the last collect for values that are not finite
+	int m_rejectedEdits;
+	// guards the queued edits
+	std::mutex m_mutex;
+	std::atomic<bool> m_bStop;
+	std::thread m_thread;
+
+	// the loop executed by the server thread on the listening socket
+	void ServerLoop(uintptr_t listenSocket);
+	// decode the complete edits at the start of the received bytes,
+	// returns false when the bytes are not a valid edit
+	bool DecodeEdits(std::vector<uint8_t>& received, std::vector<SCENE_SETTING>& edits, int& rejectedCount);
+};
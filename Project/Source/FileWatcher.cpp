@@ -0,0 +1,132 @@
+///////////////////////////////////////////////////////////////////////////////
+// filewatcher.cpp
+// ============
+// notice changes to asset files on disk while the application is running
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FileWatcher.h"
+
+#include <chrono>
+
+// declaration of global variables
+namespace
+{
+	// time between two checks of the watched files
+	const std::chrono::milliseconds WATCH_INTERVAL(100);
+}
+
+/***********************************************************
+ *  FileWatcher()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FileWatcher::FileWatcher()
+{
+	m_bStop = false;
+}
+
+/***********************************************************
+ *  ~FileWatcher()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FileWatcher::~FileWatcher()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStop = true;
+	}
+	m_stopCondition.notify_all();
+
+	if (m_thread.joinable())
+	{
+		m_thread.join();
+	}
+}
+
+/***********************************************************
+ *  Watch()
+ *
+ *  This method is used for adding a file to the watched
+ *  files.  A file that does not exist yet is reported once
+ *  it is created.
+ ***********************************************************/
+void FileWatcher::Watch(const std::string& path)
+{
+	WATCHED_FILE file;
+	file.path = path;
+	std::error_code error;
+	file.writeTime = std::filesystem::last_write_time(path, error);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (size_t i = 0; i < m_files.size(); i++)
+		{
+			if (m_files[i].path == path)
+			{
+				return;
+			}
+		}
+		m_files.push_back(file);
+	}
+
+	if (m_thread.joinable() == false)
+	{
+		m_thread = std::thread(&FileWatcher::WatchLoop, this);
+	}
+}
+
+/***********************************************************
+ *  CollectChanges()
+ *
+ *  This method is used for taking the queued changes.  A
+ *  file saved several times between two calls is reported
+ *  once, with its latest modification time.
+ ***********************************************************/
+void FileWatcher::CollectChanges(std::vector<FILE_CHANGE>& changes)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	changes.swap(m_changes);
+	m_changes.clear();
+}
+
+/***********************************************************
+ *  WatchLoop()
+ *
+ *  This method is run by the watch thread, comparing the
+ *  modification times of the watched files until stopped.
+ ***********************************************************/
+void FileWatcher::WatchLoop()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (m_stopCondition.wait_for(lock, WATCH_INTERVAL, [this] { return m_bStop; }) == false)
+	{
+		for (size_t i = 0; i < m_files.size(); i++)
+		{
+			std::error_code error;
+			std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(m_files[i].path, error);
+			if (error || (writeTime == m_files[i].writeTime))
+			{
+				continue;
+			}
+			m_files[i].writeTime = writeTime;
+
+			bool bQueued = false;
+			for (size_t j = 0; j < m_changes.size(); j++)
+			{
+				if (m_changes[j].path == m_files[i].path)
+				{
+					m_changes[j].writeTime = writeTime;
+					bQueued = true;
+				}
+			}
+			if (bQueued == false)
+			{
+				FILE_CHANGE change;
+				change.path = m_files[i].path;
+				change.writeTime = writeTime;
+				m_changes.push_back(change);
+			}
+		}
+	}
+}
@@ -0,0 +1,61 @@
+///////////////////////////////////////////////////////////////////////////////
+// filewatcher.h
+// ============
+// notice changes to asset files on disk while the application is running
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  FileWatcher
+ *
+ *  This class checks the modification time of the watched
+ *  files on a background thread a few times per second, and
+ *  queues the ones that changed until they are collected.
+ ***********************************************************/
+class FileWatcher
+{
+public:
+	// a changed file, with its new modification time
+	struct FILE_CHANGE
+	{
+		std::string path;
+		std::filesystem::file_time_type writeTime;
+	};
+
+	// constructor
+	FileWatcher();
+	// destructor
+	~FileWatcher();
+
+	// add a file to the watched files, starting the watch thread
+	void Watch(const std::string& path);
+	// take the files that changed since the last call
+	void CollectChanges(std::vector<FILE_CHANGE>& changes);
+
+private:
+	struct WATCHED_FILE
+	{
+		std::string path;
+		std::filesystem::file_time_type writeTime;
+	};
+
+	std::vector<WATCHED_FILE> m_files;
+	std::vector<FILE_CHANGE> m_changes;
+	// guards the watched files and the queued changes
+	std::mutex m_mutex;
+	// signalled to stop the watch thread
+	std::condition_variable m_stopCondition;
+	bool m_bStop;
+	std::thread m_thread;
+
+	// the loop executed by the watch thread
+	void WatchLoop();
+};
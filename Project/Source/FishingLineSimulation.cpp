@@ -0,0 +1,626 @@
+///////////////////////////////////////////////////////////////////////////////
+// fishinglinesimulation.cpp
+// ============
+// hang fishing lines through fixed points with position based dynamics
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FishingLineSimulation.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <emmintrin.h>
+#define LINE_SSE
+#endif
+
+// declaration of global variables
+namespace
+{
+	// length of each simulation step, and the most steps taken in
+	// one update so a long frame does not stall the next ones
+	const float LINE_STEP_SECONDS = 1.0f / 120.0f;
+	const int LINE_MAX_STEPS_PER_UPDATE = 8;
+	// lines stepped together by one worker at the least
+	const size_t LINE_GRAIN_SIZE = 4;
+	// segments shorter than this are left alone, having no direction
+	const float LINE_MIN_LENGTH = 0.000001f;
+}
+
+/***********************************************************
+ *  FishingLineSimulation()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FishingLineSimulation::FishingLineSimulation()
+{
+	m_segmentCount = 0;
+	m_pendingTime = 0.0f;
+	m_boundsMin = glm::vec3(0.0f);
+	m_boundsMax = glm::vec3(0.0f);
+	m_pointBuffer = 0;
+	m_pointTexture = 0;
+	m_pointUnit = 0;
+	m_vertexArray = 0;
+}
+
+/***********************************************************
+ *  ~FishingLineSimulation()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FishingLineSimulation::~FishingLineSimulation()
+{
+	ReleaseResources();
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for removing every line and setting
+ *  the behavior of the lines added after it.
+ ***********************************************************/
+void FishingLineSimulation::Initialize(const FISHING_LINE_SETTINGS& settings)
+{
+	m_settings = settings;
+	m_settings.iterations = std::max(m_settings.iterations, 1);
+
+	m_lines.clear();
+	m_segmentCount = 0;
+	m_pendingTime = 0.0f;
+	m_positionX.clear();
+	m_positionY.clear();
+	m_positionZ.clear();
+	m_previousX.clear();
+	m_previousY.clear();
+	m_previousZ.clear();
+	m_inverseMass.clear();
+	m_restLength.clear();
+	m_points.clear();
+	m_boundsMin = glm::vec3(0.0f);
+	m_boundsMax = glm::vec3(0.0f);
+}
+
+/***********************************************************
+ *  AddLine()
+ *
+ *  This method is used for adding a line that starts at the
+ *  first anchor and runs through the others in order.  The
+ *  line between two anchors is longer than the distance
+ *  between them by the slack, so it sags, and is split into
+ *  segments of about the passed in length.  Past the last
+ *  anchor the free end starts out along the last span, or
+ *  downward when there is only one anchor, and falls from
+ *  there.  Returns -1 when there is nothing to add.
+ ***********************************************************/
+int FishingLineSimulation::AddLine(
+	const std::vector<glm::vec3>& anchors,
+	float segmentLength,
+	float slack,
+	float freeLength)
+{
+	if ((anchors.size() == 0) || (segmentLength <= 0.0f))
+	{
+		return(-1);
+	}
+
+	// lay out the points, the rest length of the segment ending at
+	// each of them, and which of them are pinned
+	std::vector<glm::vec3> positions(1, anchors[0]);
+	std::vector<float> restLengths(1, 0.0f);
+	std::vector<size_t> pinned(1, 0);
+	glm::vec3 freeDirection = glm::vec3(0.0f, -1.0f, 0.0f);
+	for (int i = 1; i < anchors.size(); i++)
+	{
+		glm::vec3 span = anchors[i] - anchors[i - 1];
+		float length = glm::length(span) * (1.0f + std::max(slack, 0.0f));
+		int segments = std::max(static_cast<int>(ceilf(length / segmentLength)), 1);
+		for (int j = 1; j <= segments; j++)
+		{
+			positions.push_back(anchors[i - 1] + (span * (static_cast<float>(j) / segments)));
+			restLengths.push_back(length / segments);
+		}
+		pinned.push_back(positions.size() - 1);
+
+		if (glm::length(span) > LINE_MIN_LENGTH)
+		{
+			freeDirection = glm::normalize(span);
+		}
+	}
+	int freeSegments = static_cast<int>(ceilf(std::max(freeLength, 0.0f) / segmentLength));
+	for (int j = 1; j <= freeSegments; j++)
+	{
+		positions.push_back(positions.back() + (freeDirection * (freeLength / freeSegments)));
+		restLengths.push_back(freeLength / freeSegments);
+	}
+	if (positions.size() < 2)
+	{
+		return(-1);
+	}
+
+	LINE line;
+	line.firstPoint = m_positionX.size();
+	line.pointCount = positions.size();
+	line.paddedCount = ((line.pointCount + 6) / 4) * 4;
+	line.firstDrawnPoint = m_points.size();
+
+	size_t total = line.firstPoint + line.paddedCount;
+	m_positionX.resize(total, 0.0f);
+	m_positionY.resize(total, 0.0f);
+	m_positionZ.resize(total, 0.0f);
+	m_previousX.resize(total, 0.0f);
+	m_previousY.resize(total, 0.0f);
+	m_previousZ.resize(total, 0.0f);
+	m_inverseMass.resize(total, 0.0f);
+	m_restLength.resize(total, 0.0f);
+	m_points.resize(m_points.size() + line.pointCount);
+
+	for (size_t i = 0; i < line.pointCount; i++)
+	{
+		size_t point = line.firstPoint + i;
+		m_positionX[point] = m_previousX[point] = positions[i].x;
+		m_positionY[point] = m_previousY[point] = positions[i].y;
+		m_positionZ[point] = m_previousZ[point] = positions[i].z;
+		m_inverseMass[point] = 1.0f;
+		if (i + 1 < line.pointCount)
+		{
+			m_restLength[point] = restLengths[i + 1];
+		}
+	}
+	for (int i = 0; i < pinned.size(); i++)
+	{
+		LINE_ANCHOR anchor;
+		anchor.point = line.firstPoint + pinned[i];
+		anchor.start = anchors[i];
+		anchor.target = anchors[i];
+		line.anchors.push_back(anchor);
+		m_inverseMass[anchor.point] = 0.0f;
+	}
+
+	WritePoints(line);
+	if (m_lines.size() == 0)
+	{
+		m_boundsMin = line.boundsMin;
+		m_boundsMax = line.boundsMax;
+	}
+	else
+	{
+		m_boundsMin = glm::min(m_boundsMin, line.boundsMin);
+		m_boundsMax = glm::max(m_boundsMax, line.boundsMax);
+	}
+	m_segmentCount += static_cast<int>(line.pointCount) - 1;
+	m_lines.push_back(line);
+	return(static_cast<int>(m_lines.size()) - 1);
+}
+
+/***********************************************************
+ *  SetAnchor()
+ *
+ *  This method is used for moving an anchor of a line.  The
+ *  anchor travels to the new position over the steps of the
+ *  next update, so a fast move does not jerk the line.
+ ***********************************************************/
+void FishingLineSimulation::SetAnchor(int line, int anchor, glm::vec3 position)
+{
+	if ((line < 0) || (line >= m_lines.size()) ||
+		(anchor < 0) || (anchor >= m_lines[line].anchors.size()))
+	{
+		return;
+	}
+	m_lines[line].anchors[anchor].target = position;
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for advancing every line by the
+ *  whole steps that fit in the passed in time, carrying the
+ *  remainder over to the next update.  The lines do not
+ *  touch each other, so each worker steps whole lines, then
+ *  the bounds of the lines are merged.
+ ***********************************************************/
+void FishingLineSimulation::Update(float deltaSeconds, JobSystem* pJobSystem)
+{
+	if (m_lines.size() == 0)
+	{
+		return;
+	}
+
+	m_pendingTime = std::min(m_pendingTime + deltaSeconds, LINE_STEP_SECONDS * LINE_MAX_STEPS_PER_UPDATE);
+	int steps = static_cast<int>(m_pendingTime / LINE_STEP_SECONDS);
+	if (steps == 0)
+	{
+		return;
+	}
+	m_pendingTime -= steps * LINE_STEP_SECONDS;
+
+	pJobSystem->ParallelFor(m_lines.size(), LINE_GRAIN_SIZE, [this, steps](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				StepLine(m_lines[i], steps, LINE_STEP_SECONDS);
+			}
+		});
+
+	m_boundsMin = m_lines[0].boundsMin;
+	m_boundsMax = m_lines[0].boundsMax;
+	for (int i = 1; i < m_lines.size(); i++)
+	{
+		m_boundsMin = glm::min(m_boundsMin, m_lines[i].boundsMin);
+		m_boundsMax = glm::max(m_boundsMax, m_lines[i].boundsMax);
+	}
+}
+
+/***********************************************************
+ *  StepLine()
+ *
+ *  This method is used for advancing one line by a number
+ *  of steps.  Every step moves the anchors part of the way
+ *  to their targets, integrates the free points, restores
+ *  the segment lengths in alternating even and odd passes
+ *  and rests the line on the ground.
+ ***********************************************************/
+void FishingLineSimulation::StepLine(LINE& line, int steps, float stepSeconds)
+{
+	for (int step = 1; step <= steps; step++)
+	{
+		float blend = static_cast<float>(step) / steps;
+		for (int i = 0; i < line.anchors.size(); i++)
+		{
+			const LINE_ANCHOR& anchor = line.anchors[i];
+			glm::vec3 position = anchor.start + ((anchor.target - anchor.start) * blend);
+			m_positionX[anchor.point] = position.x;
+			m_positionY[anchor.point] = position.y;
+			m_positionZ[anchor.point] = position.z;
+		}
+
+		Integrate(line, stepSeconds);
+		for (int i = 0; i < m_settings.iterations; i++)
+		{
+			SolveSegments(line, 0);
+			SolveSegments(line, 1);
+		}
+		CollideGround(line);
+	}
+
+	for (int i = 0; i < line.anchors.size(); i++)
+	{
+		line.anchors[i].start = line.anchors[i].target;
+	}
+	WritePoints(line);
+}
+
+/***********************************************************
+ *  Integrate()
+ *
+ *  This method is used for moving the free points of a line
+ *  by their Verlet velocity, slowed by the drag, and by
+ *  gravity.  Pinned and padding points have no inverse mass
+ *  and are left where they are.
+ ***********************************************************/
+void FishingLineSimulation::Integrate(const LINE& line, float stepSeconds)
+{
+	float damping = std::max(1.0f - (m_settings.drag * stepSeconds), 0.0f);
+	glm::vec3 fall = m_settings.gravity * (stepSeconds * stepSeconds);
+	size_t begin = line.firstPoint;
+	size_t end = line.firstPoint + line.paddedCount;
+
+#ifdef LINE_SSE
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 dampingV = _mm_set1_ps(damping);
+	const __m128 fallX = _mm_set1_ps(fall.x);
+	const __m128 fallY = _mm_set1_ps(fall.y);
+	const __m128 fallZ = _mm_set1_ps(fall.z);
+	for (size_t i = begin; i < end; i += 4)
+	{
+		__m128 bFree = _mm_cmpgt_ps(_mm_loadu_ps(&m_inverseMass[i]), zero);
+
+		__m128 x = _mm_loadu_ps(&m_positionX[i]);
+		__m128 y = _mm_loadu_ps(&m_positionY[i]);
+		__m128 z = _mm_loadu_ps(&m_positionZ[i]);
+		__m128 moveX = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(x, _mm_loadu_ps(&m_previousX[i])), dampingV), fallX);
+		__m128 moveY = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(y, _mm_loadu_ps(&m_previousY[i])), dampingV), fallY);
+		__m128 moveZ = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(z, _mm_loadu_ps(&m_previousZ[i])), dampingV), fallZ);
+
+		_mm_storeu_ps(&m_previousX[i], x);
+		_mm_storeu_ps(&m_previousY[i], y);
+		_mm_storeu_ps(&m_previousZ[i], z);
+		_mm_storeu_ps(&m_positionX[i], _mm_add_ps(x, _mm_and_ps(bFree, moveX)));
+		_mm_storeu_ps(&m_positionY[i], _mm_add_ps(y, _mm_and_ps(bFree, moveY)));
+		_mm_storeu_ps(&m_positionZ[i], _mm_add_ps(z, _mm_and_ps(bFree, moveZ)));
+	}
+#else
+	for (size_t i = begin; i < end; i++)
+	{
+		float x = m_positionX[i];
+		float y = m_positionY[i];
+		float z = m_positionZ[i];
+		if (m_inverseMass[i] > 0.0f)
+		{
+			m_positionX[i] += ((x - m_previousX[i]) * damping) + fall.x;
+			m_positionY[i] += ((y - m_previousY[i]) * damping) + fall.y;
+			m_positionZ[i] += ((z - m_previousZ[i]) * damping) + fall.z;
+		}
+		m_previousX[i] = x;
+		m_previousY[i] = y;
+		m_previousZ[i] = z;
+	}
+#endif
+}
+
+/***********************************************************
+ *  SolveSegments()
+ *
+ *  This method is used for restoring the length of every
+ *  other segment of a line, the even ones or the odd ones,
+ *  moving both ends by their share of the inverse mass.
+ *  Segments of one parity share no points, so with SSE the
+ *  corrections of four neighboring segments are computed
+ *  together and only the lanes of the passed in parity are
+ *  applied, first to the start points and then, reloaded,
+ *  to the end points.
+ ***********************************************************/
+void FishingLineSimulation::SolveSegments(const LINE& line, int parity)
+{
+	size_t begin = line.firstPoint;
+	size_t end = line.firstPoint + line.pointCount - 1;
+
+#ifdef LINE_SSE
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 minLength = _mm_set1_ps(LINE_MIN_LENGTH);
+	const __m128 parityMask = (parity == 0) ?
+		_mm_castsi128_ps(_mm_set_epi32(0, -1, 0, -1)) :
+		_mm_castsi128_ps(_mm_set_epi32(-1, 0, -1, 0));
+	for (size_t i = begin; i < end; i += 4)
+	{
+		__m128 x0 = _mm_loadu_ps(&m_positionX[i]);
+		__m128 y0 = _mm_loadu_ps(&m_positionY[i]);
+		__m128 z0 = _mm_loadu_ps(&m_positionZ[i]);
+		__m128 dx = _mm_sub_ps(_mm_loadu_ps(&m_positionX[i + 1]), x0);
+		__m128 dy = _mm_sub_ps(_mm_loadu_ps(&m_positionY[i + 1]), y0);
+		__m128 dz = _mm_sub_ps(_mm_loadu_ps(&m_positionZ[i + 1]), z0);
+		__m128 w0 = _mm_loadu_ps(&m_inverseMass[i]);
+		__m128 w1 = _mm_loadu_ps(&m_inverseMass[i + 1]);
+		__m128 rest = _mm_loadu_ps(&m_restLength[i]);
+
+		__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+		__m128 weight = _mm_add_ps(w0, w1);
+		__m128 bActive = _mm_and_ps(parityMask, _mm_cmpgt_ps(rest, zero));
+		bActive = _mm_and_ps(bActive, _mm_cmpgt_ps(weight, zero));
+		bActive = _mm_and_ps(bActive, _mm_cmpgt_ps(length, minLength));
+
+		// the division is only kept in the active lanes
+		__m128 scale = _mm_and_ps(bActive, _mm_div_ps(_mm_sub_ps(length, rest), _mm_mul_ps(length, weight)));
+		__m128 scale0 = _mm_mul_ps(scale, w0);
+		__m128 scale1 = _mm_mul_ps(scale, w1);
+
+		_mm_storeu_ps(&m_positionX[i], _mm_add_ps(x0, _mm_mul_ps(dx, scale0)));
+		_mm_storeu_ps(&m_positionY[i], _mm_add_ps(y0, _mm_mul_ps(dy, scale0)));
+		_mm_storeu_ps(&m_positionZ[i], _mm_add_ps(z0, _mm_mul_ps(dz, scale0)));
+		_mm_storeu_ps(&m_positionX[i + 1], _mm_sub_ps(_mm_loadu_ps(&m_positionX[i + 1]), _mm_mul_ps(dx, scale1)));
+		_mm_storeu_ps(&m_positionY[i + 1], _mm_sub_ps(_mm_loadu_ps(&m_positionY[i + 1]), _mm_mul_ps(dy, scale1)));
+		_mm_storeu_ps(&m_positionZ[i + 1], _mm_sub_ps(_mm_loadu_ps(&m_positionZ[i + 1]), _mm_mul_ps(dz, scale1)));
+	}
+#else
+	for (size_t i = begin + parity; i < end; i += 2)
+	{
+		float weight = m_inverseMass[i] + m_inverseMass[i + 1];
+		if ((m_restLength[i] <= 0.0f) || (weight <= 0.0f))
+		{
+			continue;
+		}
+
+		float dx = m_positionX[i + 1] - m_positionX[i];
+		float dy = m_positionY[i + 1] - m_positionY[i];
+		float dz = m_positionZ[i + 1] - m_positionZ[i];
+		float length = sqrtf((dx * dx) + (dy * dy) + (dz * dz));
+		if (length <= LINE_MIN_LENGTH)
+		{
+			continue;
+		}
+
+		float scale = (length - m_restLength[i]) / (length * weight);
+		float scale0 = scale * m_inverseMass[i];
+		float scale1 = scale * m_inverseMass[i + 1];
+		m_positionX[i] += dx * scale0;
+		m_positionY[i] += dy * scale0;
+		m_positionZ[i] += dz * scale0;
+		m_positionX[i + 1] -= dx * scale1;
+		m_positionY[i + 1] -= dy * scale1;
+		m_positionZ[i + 1] -= dz * scale1;
+	}
+#endif
+}
+
+/***********************************************************
+ *  CollideGround()
+ *
+ *  This method is used for lifting the free points that
+ *  sank into the ground rectangle back onto it.  Their
+ *  fall is stopped, and friction takes away part of their
+ *  sideways speed, so the line comes to rest in coils
+ *  instead of sliding off.
+ ***********************************************************/
+void FishingLineSimulation::CollideGround(const LINE& line)
+{
+	float floor = m_settings.groundHeight + m_settings.radius;
+	size_t begin = line.firstPoint;
+	size_t end = line.firstPoint + line.paddedCount;
+
+#ifdef LINE_SSE
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 floorV = _mm_set1_ps(floor);
+	const __m128 friction = _mm_set1_ps(m_settings.friction);
+	const __m128 minX = _mm_set1_ps(m_settings.groundMin.x);
+	const __m128 minZ = _mm_set1_ps(m_settings.groundMin.y);
+	const __m128 maxX = _mm_set1_ps(m_settings.groundMax.x);
+	const __m128 maxZ = _mm_set1_ps(m_settings.groundMax.y);
+	for (size_t i = begin; i < end; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(&m_positionX[i]);
+		__m128 y = _mm_loadu_ps(&m_positionY[i]);
+		__m128 z = _mm_loadu_ps(&m_positionZ[i]);
+		__m128 bContact = _mm_and_ps(_mm_cmplt_ps(y, floorV), _mm_cmpgt_ps(_mm_loadu_ps(&m_inverseMass[i]), zero));
+		bContact = _mm_and_ps(bContact, _mm_and_ps(_mm_cmpge_ps(x, minX), _mm_cmple_ps(x, maxX)));
+		bContact = _mm_and_ps(bContact, _mm_and_ps(_mm_cmpge_ps(z, minZ), _mm_cmple_ps(z, maxZ)));
+		if (_mm_movemask_ps(bContact) == 0)
+		{
+			continue;
+		}
+
+		__m128 previousX = _mm_loadu_ps(&m_previousX[i]);
+		__m128 previousZ = _mm_loadu_ps(&m_previousZ[i]);
+		__m128 slowX = _mm_mul_ps(_mm_sub_ps(x, previousX), friction);
+		__m128 slowZ = _mm_mul_ps(_mm_sub_ps(z, previousZ), friction);
+		__m128 lifted = _mm_or_ps(_mm_andnot_ps(bContact, y), _mm_and_ps(bContact, floorV));
+		__m128 stopped = _mm_or_ps(_mm_andnot_ps(bContact, _mm_loadu_ps(&m_previousY[i])), _mm_and_ps(bContact, floorV));
+
+		_mm_storeu_ps(&m_positionY[i], lifted);
+		_mm_storeu_ps(&m_previousY[i], stopped);
+		_mm_storeu_ps(&m_previousX[i], _mm_add_ps(previousX, _mm_and_ps(bContact, slowX)));
+		_mm_storeu_ps(&m_previousZ[i], _mm_add_ps(previousZ, _mm_and_ps(bContact, slowZ)));
+	}
+#else
+	for (size_t i = begin; i < end; i++)
+	{
+		float x = m_positionX[i];
+		float z = m_positionZ[i];
+		if ((m_positionY[i] >= floor) || (m_inverseMass[i] <= 0.0f) ||
+			(x < m_settings.groundMin.x) || (x > m_settings.groundMax.x) ||
+			(z < m_settings.groundMin.y) || (z > m_settings.groundMax.y))
+		{
+			continue;
+		}
+
+		m_positionY[i] = floor;
+		m_previousY[i] = floor;
+		m_previousX[i] += (x - m_previousX[i]) * m_settings.friction;
+		m_previousZ[i] += (z - m_previousZ[i]) * m_settings.friction;
+	}
+#endif
+}
+
+/***********************************************************
+ *  WritePoints()
+ *
+ *  This method is used for copying the points of a line
+ *  into its part of the streamed points and for finding the
+ *  box around them.  The last point of the line is marked
+ *  so the vertex shader does not join it to the next line.
+ ***********************************************************/
+void FishingLineSimulation::WritePoints(LINE& line)
+{
+	line.boundsMin = glm::vec3(FLT_MAX);
+	line.boundsMax = glm::vec3(-FLT_MAX);
+	for (size_t i = 0; i < line.pointCount; i++)
+	{
+		size_t point = line.firstPoint + i;
+		glm::vec3 position = glm::vec3(m_positionX[point], m_positionY[point], m_positionZ[point]);
+		m_points[line.firstDrawnPoint + i] = glm::vec4(position, (i + 1 < line.pointCount) ? 1.0f : 0.0f);
+		line.boundsMin = glm::min(line.boundsMin, position);
+		line.boundsMax = glm::max(line.boundsMax, position);
+	}
+}
+
+/***********************************************************
+ *  CreateResources()
+ *
+ *  This method is used for creating the buffer the points
+ *  are streamed into, the buffer texture the vertex shader
+ *  reads them through, and an empty vertex array, since the
+ *  ribbon vertices are made from the vertex index alone.
+ ***********************************************************/
+bool FishingLineSimulation::CreateResources(int pointUnit)
+{
+	ReleaseResources();
+	m_pointUnit = pointUnit;
+
+	glGenBuffers(1, &m_pointBuffer);
+	glBindBuffer(GL_TEXTURE_BUFFER, m_pointBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, std::max(m_points.size(), static_cast<size_t>(1)) * sizeof(glm::vec4),
+		m_points.data(), GL_STREAM_DRAW);
+
+	glActiveTexture(GL_TEXTURE0 + m_pointUnit);
+	glGenTextures(1, &m_pointTexture);
+	glBindTexture(GL_TEXTURE_BUFFER, m_pointTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_pointBuffer);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	glGenVertexArrays(1, &m_vertexArray);
+	return(true);
+}
+
+/***********************************************************
+ *  ReleaseResources()
+ *
+ *  This method is used for freeing the buffer texture and
+ *  the vertex array.
+ ***********************************************************/
+void FishingLineSimulation::ReleaseResources()
+{
+	if (m_pointTexture != 0)
+	{
+		glDeleteTextures(1, &m_pointTexture);
+		glDeleteBuffers(1, &m_pointBuffer);
+		glDeleteVertexArrays(1, &m_vertexArray);
+		m_pointTexture = 0;
+		m_pointBuffer = 0;
+		m_vertexArray = 0;
+	}
+}
+
+/***********************************************************
+ *  Upload()
+ *
+ *  This method is used for streaming the last simulated
+ *  points into the buffer.  The old storage is orphaned
+ *  first, so the driver hands out fresh memory instead of
+ *  waiting for the frame still drawing from the old points.
+ ***********************************************************/
+void FishingLineSimulation::Upload()
+{
+	if ((IsReady() == false) || (m_points.size() == 0))
+	{
+		return;
+	}
+
+	GLsizeiptr size = m_points.size() * sizeof(glm::vec4);
+	glBindBuffer(GL_TEXTURE_BUFFER, m_pointBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, size, NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_TEXTURE_BUFFER, 0, size, m_points.data());
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+/***********************************************************
+ *  Bind()
+ *
+ *  This method is used for binding the buffer texture to
+ *  its texture unit.
+ ***********************************************************/
+void FishingLineSimulation::Bind() const
+{
+	glActiveTexture(GL_TEXTURE0 + m_pointUnit);
+	glBindTexture(GL_TEXTURE_BUFFER, m_pointTexture);
+}
+
+/***********************************************************
+ *  Draw()
+ *
+ *  This method is used for drawing six vertices for every
+ *  pair of neighboring streamed points.  The vertex shader
+ *  turns them into the two triangles of a ribbon, and
+ *  collapses the pairs that join the end of one line to the
+ *  start of the next.
+ ***********************************************************/
+void FishingLineSimulation::Draw() const
+{
+	if ((IsReady() == false) || (m_points.size() < 2))
+	{
+		return;
+	}
+
+	glBindVertexArray(m_vertexArray);
+	glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>((m_points.size() - 1) * 6));
+	glBindVertexArray(0);
+}
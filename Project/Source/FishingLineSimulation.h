@@ -0,0 +1,161 @@
+///////////////////////////////////////////////////////////////////////////////
+// fishinglinesimulation.h
+// ============
+// hang fishing lines through fixed points with position based dynamics
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "JobSystem.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// behavior of the lines, in world units (meters) and seconds
+struct FISHING_LINE_SETTINGS
+{
+	glm::vec3 gravity = glm::vec3(0.0f, -9.81f, 0.0f);
+	// fraction of its speed a point loses to the air every second
+	float drag = 0.8f;
+	// passes over the segment lengths in every step, more passes
+	// giving a stiffer line
+	int iterations = 12;
+	// radius of the line, also kept between it and the ground
+	float radius = 0.01f;
+	// fraction of the sideways speed lost while lying on the ground
+	float friction = 0.3f;
+	// rectangle of ground the lines rest on, at the passed in height
+	float groundHeight = -0.5f;
+	glm::vec2 groundMin = glm::vec2(-1.0f);
+	glm::vec2 groundMax = glm::vec2(1.0f);
+};
+
+/***********************************************************
+ *  FishingLineSimulation
+ *
+ *  This class moves any number of fishing lines as chains
+ *  of points joined by segments of fixed length.  Points
+ *  are advanced by Verlet integration under gravity and air
+ *  drag, then the segment lengths are restored in a number
+ *  of passes, the even segments and then the odd ones, so
+ *  no point is moved by two segments at once and four
+ *  segments are solved together with SSE.  Points can be
+ *  pinned to anchors, such as the eyelets of a rod, and the
+ *  line rests on a rectangle of ground.  Each line is
+ *  stepped by one worker, so many lines spread across all
+ *  of them.  The points are streamed to a buffer texture
+ *  every frame and the vertex shader expands each segment
+ *  into a ribbon facing the camera.
+ ***********************************************************/
+class FishingLineSimulation
+{
+public:
+	// constructor
+	FishingLineSimulation();
+	// destructor
+	~FishingLineSimulation();
+
+	// remove every line and replace the settings
+	void Initialize(const FISHING_LINE_SETTINGS& settings);
+	// add a line pinned to the passed in anchors in order, with
+	// segments of about the passed in length, a fraction of slack
+	// between the anchors and a free end hanging from the last one;
+	// returns the index of the line
+	int AddLine(
+		const std::vector<glm::vec3>& anchors,
+		float segmentLength,
+		float slack,
+		float freeLength);
+	// move an anchor of a line, reached over the next update
+	void SetAnchor(int line, int anchor, glm::vec3 position);
+
+	// advance the simulation in fixed steps by the passed in time
+	void Update(float deltaSeconds, JobSystem* pJobSystem);
+
+	// create the buffer texture bound to the passed in unit, and an
+	// empty vertex array to draw the ribbons with
+	bool CreateResources(int pointUnit);
+	// free the buffer texture and the vertex array
+	void ReleaseResources();
+	// stream the last simulated points into the buffer texture
+	void Upload();
+	// bind the buffer texture to its texture unit
+	void Bind() const;
+	// draw two triangles for every segment of every line
+	void Draw() const;
+
+	// true once the buffer texture was created
+	bool IsReady() const { return(m_pointTexture != 0); }
+	int GetLineCount() const { return(static_cast<int>(m_lines.size())); }
+	int GetSegmentCount() const { return(m_segmentCount); }
+	// get the box around every point of the last simulated lines
+	glm::vec3 GetBoundsMin() const { return(m_boundsMin); }
+	glm::vec3 GetBoundsMax() const { return(m_boundsMax); }
+	const FISHING_LINE_SETTINGS& GetSettings() const { return(m_settings); }
+
+private:
+	// a point of a line held in place
+	struct LINE_ANCHOR
+	{
+		size_t point;
+		// position at the start of the update and the one reached
+		// at its end, stepped between in even parts
+		glm::vec3 start;
+		glm::vec3 target;
+	};
+
+	// a run of points in the arrays below, padded to whole groups of
+	// four with room for the next point of the last segment group, so
+	// the vectorized passes never reach into the next line
+	struct LINE
+	{
+		size_t firstPoint;
+		size_t pointCount;
+		size_t paddedCount;
+		// first point of the line in the streamed points
+		size_t firstDrawnPoint;
+		std::vector<LINE_ANCHOR> anchors;
+		// box around the points after the last step
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+	};
+
+	FISHING_LINE_SETTINGS m_settings;
+	std::vector<LINE> m_lines;
+	int m_segmentCount;
+	float m_pendingTime;
+
+	// positions at this and the previous step, inverse masses, zero for
+	// pinned and padding points, and the rest length of the segment to
+	// the next point, zero past the end of a line
+	std::vector<float> m_positionX;
+	std::vector<float> m_positionY;
+	std::vector<float> m_positionZ;
+	std::vector<float> m_previousX;
+	std::vector<float> m_previousY;
+	std::vector<float> m_previousZ;
+	std::vector<float> m_inverseMass;
+	std::vector<float> m_restLength;
+
+	// streamed points, the w component being 1 where a segment starts
+	std::vector<glm::vec4> m_points;
+	glm::vec3 m_boundsMin;
+	glm::vec3 m_boundsMax;
+
+	// buffer texture of the points and the texture unit it is bound to
+	GLuint m_pointBuffer;
+	GLuint m_pointTexture;
+	int m_pointUnit;
+	GLuint m_vertexArray;
+
+	// advance one line by the passed in number of steps
+	void StepLine(LINE& line, int steps, float stepSeconds);
+	// integrate, restore the segment lengths and collide one line
+	void Integrate(const LINE& line, float stepSeconds);
+	void SolveSegments(const LINE& line, int parity);
+	void CollideGround(const LINE& line);
+	// copy the points of a line into the streamed points
+	void WritePoints(LINE& line);
+};
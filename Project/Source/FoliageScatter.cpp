@@ -0,0 +1,760 @@
+///////////////////////////////////////////////////////////////////////////////
+// foliagescatter.cpp
+// ============
+// scatter, cull and draw the grass and reeds of the lakeshore on the GPU
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FoliageScatter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <thread>
+
+// declaration of global variables
+namespace
+{
+	// passes of the compute program, selected by foliagePass
+	const int FOLIAGE_PASS_SCATTER = 0;
+	const int FOLIAGE_PASS_CULL = 1;
+	const int FOLIAGE_PASS_CLAMP = 2;
+	// invocations of every work group, the local size of the program
+	const int FOLIAGE_COMPUTE_GROUP_SIZE = 256;
+
+	// a clump as read by the compute program and the vertex shader,
+	// its position and heading, then its height, blade width, sway
+	// phase and kind, 0 for grass and 1 for reeds
+	const size_t FOLIAGE_CLUMP_BYTES = 2 * sizeof(glm::vec4);
+	// the unsigned integers of one indexed indirect draw command
+	const int FOLIAGE_COMMAND_SIZE = 5;
+
+	// limits on the streaming work done for each frame
+	const int FOLIAGE_MAX_SCATTERS_PER_FRAME = 4;
+	const int FOLIAGE_MAX_LOADS_IN_FLIGHT = 8;
+
+	// blades of every clump, and the segments up each blade of the
+	// detailed and the simple clump
+	const int FOLIAGE_BLADES_PER_CLUMP = 3;
+	const int FOLIAGE_DETAILED_SEGMENTS = 4;
+	const int FOLIAGE_SIMPLE_SEGMENTS = 1;
+	// height of the tallest reeds, for the bounds of the tiles
+	const float FOLIAGE_MAX_HEIGHT = 2.2f;
+	// side of the patches of thicker and thinner growth
+	const float FOLIAGE_PATCH_SIZE = 24.0f;
+
+	/***********************************************************
+	 *  Smoothstep()
+	 *
+	 *  Ease from 0 to 1 as the value moves between the edges.
+	 ***********************************************************/
+	float Smoothstep(float edge0, float edge1, float value)
+	{
+		float t = std::min(std::max((value - edge0) / (edge1 - edge0), 0.0f), 1.0f);
+		return(t * t * (3.0f - (2.0f * t)));
+	}
+
+	/***********************************************************
+	 *  HashCorner()
+	 *
+	 *  Hash the integer coordinates of a noise lattice corner
+	 *  into a value between 0 and 1.
+	 ***********************************************************/
+	float HashCorner(int x, int z, uint32_t seed)
+	{
+		uint32_t hash = seed ^ (static_cast<uint32_t>(x) * 73856093u) ^ (static_cast<uint32_t>(z) * 19349663u);
+		hash ^= hash >> 13;
+		hash *= 0x5bd1e995u;
+		hash ^= hash >> 15;
+		return(static_cast<float>(hash & 0xFFFFFF) / 16777215.0f);
+	}
+
+	/***********************************************************
+	 *  PatchNoise()
+	 *
+	 *  Smoothly interpolated value noise, one lattice cell per
+	 *  unit, for the patches of thicker growth.
+	 ***********************************************************/
+	float PatchNoise(float x, float z, uint32_t seed)
+	{
+		int cellX = static_cast<int>(std::floor(x));
+		int cellZ = static_cast<int>(std::floor(z));
+		float fractionX = Smoothstep(0.0f, 1.0f, x - cellX);
+		float fractionZ = Smoothstep(0.0f, 1.0f, z - cellZ);
+
+		float bottom = HashCorner(cellX, cellZ, seed) +
+			((HashCorner(cellX + 1, cellZ, seed) - HashCorner(cellX, cellZ, seed)) * fractionX);
+		float top = HashCorner(cellX, cellZ + 1, seed) +
+			((HashCorner(cellX + 1, cellZ + 1, seed) - HashCorner(cellX, cellZ + 1, seed)) * fractionX);
+		return(bottom + ((top - bottom) * fractionZ));
+	}
+}
+
+/***********************************************************
+ *  FoliageScatter()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FoliageScatter::FoliageScatter()
+{
+	m_pTerrain = NULL;
+	m_computeProgram = 0;
+	m_pJobSystem = NULL;
+	m_tileCount = 0;
+	m_tileSize = 0.0f;
+	m_origin = 0.0f;
+	m_gridResolution = 0;
+	m_slotFloats = 0;
+	m_scatteredTileCount = 0;
+	m_loadsInFlight = 0;
+	m_tileBuffer = 0;
+	m_countBuffer = 0;
+	m_scatteredBuffer = 0;
+	m_visibleBuffer = 0;
+	m_commandBuffer = 0;
+	m_vertexArray = 0;
+	m_vertexBuffer = 0;
+	m_indexBuffer = 0;
+	for (int i = 0; i < 2; i++)
+	{
+		m_indexCounts[i] = 0;
+		m_firstIndices[i] = 0;
+		m_baseVertices[i] = 0;
+	}
+	m_boundsMin = glm::vec3(0.0f);
+	m_boundsMax = glm::vec3(0.0f);
+}
+
+/***********************************************************
+ *  ~FoliageScatter()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FoliageScatter::~FoliageScatter()
+{
+	Release();
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for sizing the slots for the tiles
+ *  the range can touch at once, and creating the buffers
+ *  the compute program scatters into and culls from, along
+ *  with the two clump meshes.
+ ***********************************************************/
+bool FoliageScatter::Initialize(
+	const FOLIAGE_SETTINGS& settings,
+	const HeightfieldTerrain* pTerrain,
+	GLuint computeProgram,
+	JobSystem* pJobSystem)
+{
+	Release();
+
+	if ((NULL == pTerrain) || (pTerrain->IsReady() == false) || (computeProgram == 0) ||
+		(settings.candidatesPerSide < 1) || (settings.maxVisible < 1) || (settings.range <= 0.0f))
+	{
+		std::cout << "Foliage needs an open terrain and its compute program" << std::endl;
+		return(false);
+	}
+
+	m_settings = settings;
+	m_pTerrain = pTerrain;
+	m_computeProgram = computeProgram;
+	m_pJobSystem = pJobSystem;
+
+	const TERRAIN_SETTINGS& terrain = pTerrain->GetSettings();
+	m_tileCount = pTerrain->GetNodeCount(0);
+	m_tileSize = terrain.worldSize / m_tileCount;
+	m_origin = -0.5f * terrain.worldSize;
+	m_gridResolution = terrain.gridResolution;
+
+	// the heights of a tile with their border, then a reed and a grass
+	// density at every vertex of its grid
+	const int tileSamples = m_gridResolution + 3;
+	const int densityTexels = m_gridResolution + 1;
+	m_slotFloats = (tileSamples * tileSamples) + (2 * densityTexels * densityTexels);
+
+	// a circle of the range touches this many tiles along each side
+	int slotsPerSide = static_cast<int>(std::ceil((2.0f * m_settings.range) / m_tileSize)) + 1;
+	m_slots.resize(std::min(slotsPerSide, m_tileCount) * std::min(slotsPerSide, m_tileCount));
+	for (int i = 0; i < m_slots.size(); i++)
+	{
+		m_slots[i].tileX = -1;
+		m_slots[i].tileZ = -1;
+	}
+	m_tileSlots.assign(static_cast<size_t>(m_tileCount) * m_tileCount, -1);
+	m_pendingTiles.assign(static_cast<size_t>(m_tileCount) * m_tileCount, false);
+	m_scatteredTileCount = 0;
+
+	const size_t slotCapacity = static_cast<size_t>(m_settings.candidatesPerSide) * m_settings.candidatesPerSide;
+	std::vector<GLuint> zeroCounts(m_slots.size(), 0);
+	GLuint zeroCommands[2 * FOLIAGE_COMMAND_SIZE] = { 0 };
+
+	glGenBuffers(1, &m_tileBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_tileBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, m_slots.size() * m_slotFloats * sizeof(float), NULL, GL_DYNAMIC_DRAW);
+	glGenBuffers(1, &m_countBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_countBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, zeroCounts.size() * sizeof(GLuint), zeroCounts.data(), GL_DYNAMIC_COPY);
+	glGenBuffers(1, &m_scatteredBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_scatteredBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, m_slots.size() * slotCapacity * FOLIAGE_CLUMP_BYTES, NULL, GL_DYNAMIC_COPY);
+	glGenBuffers(1, &m_visibleBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_visibleBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, 2 * m_settings.maxVisible * FOLIAGE_CLUMP_BYTES, NULL, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	glGenBuffers(1, &m_commandBuffer);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(zeroCommands), zeroCommands, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+	CreateMeshes();
+	return(true);
+}
+
+/***********************************************************
+ *  Release()
+ *
+ *  This method is used for freeing the buffers and meshes,
+ *  once the workers have finished their reads.
+ ***********************************************************/
+void FoliageScatter::Release()
+{
+	// the workers read the terrain and write into this object, so
+	// let them finish
+	while (m_loadsInFlight.load() > 0)
+	{
+		std::this_thread::yield();
+	}
+	m_loadedTiles.clear();
+
+	GLuint buffers[5] = { m_tileBuffer, m_countBuffer, m_scatteredBuffer, m_visibleBuffer, m_commandBuffer };
+	for (int i = 0; i < 5; i++)
+	{
+		if (buffers[i] != 0)
+		{
+			glDeleteBuffers(1, &buffers[i]);
+		}
+	}
+	m_tileBuffer = 0;
+	m_countBuffer = 0;
+	m_scatteredBuffer = 0;
+	m_visibleBuffer = 0;
+	m_commandBuffer = 0;
+
+	if (m_vertexArray != 0)
+	{
+		glDeleteVertexArrays(1, &m_vertexArray);
+		glDeleteBuffers(1, &m_vertexBuffer);
+		glDeleteBuffers(1, &m_indexBuffer);
+		m_vertexArray = 0;
+		m_vertexBuffer = 0;
+		m_indexBuffer = 0;
+	}
+
+	m_tileSlots.clear();
+	m_pendingTiles.clear();
+	m_slots.clear();
+	m_pTerrain = NULL;
+	m_computeProgram = 0;
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for dropping the tiles that left the
+ *  range, scattering the tiles the workers have read within
+ *  a per-frame budget and handing the tiles that came into
+ *  range to the workers.  The clumps of every slot are then
+ *  culled in the compute program into the instances of the
+ *  two draw commands, so the CPU never touches a clump.
+ ***********************************************************/
+void FoliageScatter::Update(glm::vec3 cameraPosition, const glm::mat4& viewProjection)
+{
+	if (IsReady() == false)
+	{
+		return;
+	}
+
+	// the counts and commands written by the last update are written
+	// from here again
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+	for (int i = 0; i < m_slots.size(); i++)
+	{
+		if ((m_slots[i].tileX >= 0) && (IsTileInRange(m_slots[i].tileX, m_slots[i].tileZ, cameraPosition) == false))
+		{
+			FreeSlot(i);
+		}
+	}
+
+	GLint oldProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &oldProgram);
+	glUseProgram(m_computeProgram);
+
+	const GLuint slotCapacity = static_cast<GLuint>(m_settings.candidatesPerSide * m_settings.candidatesPerSide);
+	glUniform1ui(glGetUniformLocation(m_computeProgram, "slotCapacity"), slotCapacity);
+	glUniform1i(glGetUniformLocation(m_computeProgram, "slotFloats"), m_slotFloats);
+	glUniform1i(glGetUniformLocation(m_computeProgram, "tileGridResolution"), m_gridResolution);
+	glUniform1f(glGetUniformLocation(m_computeProgram, "tileSize"), m_tileSize);
+	glUniform1i(glGetUniformLocation(m_computeProgram, "candidatesPerSide"), m_settings.candidatesPerSide);
+	glUniform1ui(glGetUniformLocation(m_computeProgram, "seed"), m_settings.seed);
+	GLint passLocation = glGetUniformLocation(m_computeProgram, "foliagePass");
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_tileBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_countBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_scatteredBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_visibleBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, m_commandBuffer);
+
+	std::vector<LOADED_TILE> loaded;
+	{
+		std::lock_guard<std::mutex> lock(m_loadedMutex);
+		loaded.swap(m_loadedTiles);
+	}
+
+	glUniform1i(passLocation, FOLIAGE_PASS_SCATTER);
+	int scatters = 0;
+	for (size_t i = 0; i < loaded.size(); i++)
+	{
+		LOADED_TILE& tile = loaded[i];
+		if (scatters >= FOLIAGE_MAX_SCATTERS_PER_FRAME)
+		{
+			// over budget, so keep the tile for the next frame
+			std::lock_guard<std::mutex> lock(m_loadedMutex);
+			m_loadedTiles.push_back(std::move(tile));
+			continue;
+		}
+
+		// a tile that could not be read, or has left the range since,
+		// is read again once it is in range
+		size_t index = (static_cast<size_t>(tile.tileZ) * m_tileCount) + tile.tileX;
+		m_pendingTiles[index] = false;
+		if ((tile.data.size() > 0) && (m_tileSlots[index] < 0) &&
+			(IsTileInRange(tile.tileX, tile.tileZ, cameraPosition)) &&
+			(ScatterTile(tile)))
+		{
+			scatters++;
+		}
+	}
+
+	// hand the tiles that came into range to the workers
+	int firstX = std::max(static_cast<int>(std::floor((cameraPosition.x - m_settings.range - m_origin) / m_tileSize)), 0);
+	int lastX = std::min(static_cast<int>(std::floor((cameraPosition.x + m_settings.range - m_origin) / m_tileSize)), m_tileCount - 1);
+	int firstZ = std::max(static_cast<int>(std::floor((cameraPosition.z - m_settings.range - m_origin) / m_tileSize)), 0);
+	int lastZ = std::min(static_cast<int>(std::floor((cameraPosition.z + m_settings.range - m_origin) / m_tileSize)), m_tileCount - 1);
+	for (int tileZ = firstZ; tileZ <= lastZ; tileZ++)
+	{
+		for (int tileX = firstX; tileX <= lastX; tileX++)
+		{
+			size_t index = (static_cast<size_t>(tileZ) * m_tileCount) + tileX;
+			if ((m_tileSlots[index] >= 0) || (m_pendingTiles[index]) ||
+				(IsTileInRange(tileX, tileZ, cameraPosition) == false) ||
+				(m_loadsInFlight.load() >= FOLIAGE_MAX_LOADS_IN_FLIGHT))
+			{
+				continue;
+			}
+
+			m_pendingTiles[index] = true;
+			m_loadsInFlight++;
+			auto loadTile = [this, tileX, tileZ]()
+				{
+					LOADED_TILE tile;
+					tile.tileX = tileX;
+					tile.tileZ = tileZ;
+					if (LoadTile(tileX, tileZ, tile.data) == false)
+					{
+						tile.data.clear();
+					}
+					{
+						std::lock_guard<std::mutex> lock(m_loadedMutex);
+						m_loadedTiles.push_back(std::move(tile));
+					}
+					m_loadsInFlight--;
+				};
+
+			if (NULL != m_pJobSystem)
+			{
+				m_pJobSystem->Submit(loadTile);
+			}
+			else
+			{
+				loadTile();
+			}
+		}
+	}
+
+	// the box around the scattered tiles, up to the tallest reeds
+	bool bFirst = true;
+	for (int i = 0; i < m_slots.size(); i++)
+	{
+		if (m_slots[i].tileX < 0)
+		{
+			continue;
+		}
+		glm::vec3 tileMin;
+		glm::vec3 tileMax;
+		m_pTerrain->GetNodeBounds(0, m_slots[i].tileX, m_slots[i].tileZ, tileMin, tileMax);
+		tileMax.y += FOLIAGE_MAX_HEIGHT;
+		m_boundsMin = (bFirst) ? tileMin : glm::min(m_boundsMin, tileMin);
+		m_boundsMax = (bFirst) ? tileMax : glm::max(m_boundsMax, tileMax);
+		bFirst = false;
+	}
+
+	// restart the two draws, the detailed clumps taking the first half
+	// of the instances and the simple ones the second
+	GLuint commands[2 * FOLIAGE_COMMAND_SIZE];
+	for (int i = 0; i < 2; i++)
+	{
+		commands[(i * FOLIAGE_COMMAND_SIZE) + 0] = static_cast<GLuint>(m_indexCounts[i]);
+		commands[(i * FOLIAGE_COMMAND_SIZE) + 1] = 0;
+		commands[(i * FOLIAGE_COMMAND_SIZE) + 2] = static_cast<GLuint>(m_firstIndices[i]);
+		commands[(i * FOLIAGE_COMMAND_SIZE) + 3] = static_cast<GLuint>(m_baseVertices[i]);
+		commands[(i * FOLIAGE_COMMAND_SIZE) + 4] = static_cast<GLuint>(i * m_settings.maxVisible);
+	}
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+	glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(commands), commands);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+	// the planes of the view facing inward, normalized so the clumps
+	// are tested as spheres
+	glm::vec4 planes[6];
+	for (int i = 0; i < 3; i++)
+	{
+		glm::vec4 row(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+		glm::vec4 last(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+		planes[(i * 2) + 0] = last + row;
+		planes[(i * 2) + 1] = last - row;
+	}
+	for (int i = 0; i < 6; i++)
+	{
+		planes[i] /= std::max(glm::length(glm::vec3(planes[i])), 1e-6f);
+	}
+
+	glUniform4fv(glGetUniformLocation(m_computeProgram, "frustumPlanes"), 6, &planes[0][0]);
+	glUniform3fv(glGetUniformLocation(m_computeProgram, "cameraPosition"), 1, &cameraPosition[0]);
+	glUniform1f(glGetUniformLocation(m_computeProgram, "range"), m_settings.range);
+	glUniform1f(glGetUniformLocation(m_computeProgram, "fadeStart"), m_settings.fadeStart);
+	glUniform1f(glGetUniformLocation(m_computeProgram, "detailRange"), m_settings.detailRange);
+	glUniform1i(glGetUniformLocation(m_computeProgram, "slotCount"), static_cast<GLint>(m_slots.size()));
+	glUniform1ui(glGetUniformLocation(m_computeProgram, "maxVisible"), static_cast<GLuint>(m_settings.maxVisible));
+
+	const GLuint clumpGroups = static_cast<GLuint>(
+		((m_slots.size() * slotCapacity) + FOLIAGE_COMPUTE_GROUP_SIZE - 1) / FOLIAGE_COMPUTE_GROUP_SIZE);
+	glUniform1i(passLocation, FOLIAGE_PASS_CULL);
+	glDispatchCompute(clumpGroups, 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	glUniform1i(passLocation, FOLIAGE_PASS_CLAMP);
+	glDispatchCompute(1, 1, 1);
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+
+	glUseProgram(oldProgram);
+}
+
+/***********************************************************
+ *  Draw()
+ *
+ *  This method is used for drawing the detailed and the
+ *  simple clumps in one call, with the instance counts the
+ *  culling pass left in the draw commands.
+ ***********************************************************/
+void FoliageScatter::Draw()
+{
+	if ((IsReady() == false) || (GetTileCount() == 0))
+	{
+		return;
+	}
+
+	glBindVertexArray(m_vertexArray);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+	glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, NULL, 2, 0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindVertexArray(0);
+}
+
+/***********************************************************
+ *  GetTileCount()
+ *
+ *  This method is used for counting the slots holding the
+ *  clumps of a tile.
+ ***********************************************************/
+int FoliageScatter::GetTileCount() const
+{
+	int count = 0;
+	for (size_t i = 0; i < m_slots.size(); i++)
+	{
+		if (m_slots[i].tileX >= 0)
+		{
+			count++;
+		}
+	}
+	return(count);
+}
+
+/***********************************************************
+ *  ReadDrawnCounts()
+ *
+ *  This method is used for reading the instance counts of
+ *  the two draw commands back from the GPU.  It waits for
+ *  the culling pass, so it is only called for the reports.
+ ***********************************************************/
+void FoliageScatter::ReadDrawnCounts(int& detailedCount, int& simpleCount)
+{
+	detailedCount = 0;
+	simpleCount = 0;
+	if (IsReady() == false)
+	{
+		return;
+	}
+
+	GLuint commands[2 * FOLIAGE_COMMAND_SIZE] = { 0 };
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+	glGetBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(commands), commands);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	detailedCount = static_cast<int>(commands[1]);
+	simpleCount = static_cast<int>(commands[FOLIAGE_COMMAND_SIZE + 1]);
+}
+
+/***********************************************************
+ *  IsTileInRange()
+ *
+ *  This method is used for testing whether the nearest
+ *  point of a tile is within the range of the camera,
+ *  measured across the ground.
+ ***********************************************************/
+bool FoliageScatter::IsTileInRange(int tileX, int tileZ, glm::vec3 cameraPosition) const
+{
+	float minX = m_origin + (tileX * m_tileSize);
+	float minZ = m_origin + (tileZ * m_tileSize);
+	float nearestX = std::min(std::max(cameraPosition.x, minX), minX + m_tileSize);
+	float nearestZ = std::min(std::max(cameraPosition.z, minZ), minZ + m_tileSize);
+	float distanceX = cameraPosition.x - nearestX;
+	float distanceZ = cameraPosition.z - nearestZ;
+	return(((distanceX * distanceX) + (distanceZ * distanceZ)) <= (m_settings.range * m_settings.range));
+}
+
+/***********************************************************
+ *  LoadTile()
+ *
+ *  This method is used for reading the heights of a finest
+ *  terrain tile and deriving its density map, on a worker.
+ *  Reeds grow in a band along the waterline and grass on
+ *  the flat ground above it, both thinning out on slopes
+ *  and in patches, so the clumps follow the lakeshore.
+ ***********************************************************/
+bool FoliageScatter::LoadTile(int tileX, int tileZ, std::vector<float>& data) const
+{
+	std::vector<uint16_t> samples;
+	const int tileSamples = m_gridResolution + 3;
+	if ((m_pTerrain->ReadTile(0, tileX, tileZ, samples) == false) ||
+		(samples.size() != static_cast<size_t>(tileSamples) * tileSamples))
+	{
+		return(false);
+	}
+
+	glm::vec2 heightRange = m_pTerrain->GetHeightRange();
+	float heightScale = (heightRange.y - heightRange.x) / 65535.0f;
+	data.resize(m_slotFloats);
+	for (size_t i = 0; i < samples.size(); i++)
+	{
+		data[i] = heightRange.x + (samples[i] * heightScale);
+	}
+
+	const float spacing = m_tileSize / m_gridResolution;
+	const float cornerX = m_origin + (tileX * m_tileSize);
+	const float cornerZ = m_origin + (tileZ * m_tileSize);
+	float* pDensity = data.data() + samples.size();
+	for (int z = 0; z <= m_gridResolution; z++)
+	{
+		for (int x = 0; x <= m_gridResolution; x++)
+		{
+			// the border sample around the grid gives every vertex its
+			// neighbors for the slope
+			const float* pHeight = &data[((z + 1) * tileSamples) + (x + 1)];
+			float slopeX = (pHeight[1] - pHeight[-1]) / (2.0f * spacing);
+			float slopeZ = (pHeight[tileSamples] - pHeight[-tileSamples]) / (2.0f * spacing);
+			float flatness = 1.0f / std::sqrt(1.0f + (slopeX * slopeX) + (slopeZ * slopeZ));
+			float aboveWater = pHeight[0] - m_settings.waterLevel;
+			float patches = PatchNoise(
+				(cornerX + (x * spacing)) / FOLIAGE_PATCH_SIZE,
+				(cornerZ + (z * spacing)) / FOLIAGE_PATCH_SIZE,
+				m_settings.seed);
+
+			float reeds = Smoothstep(-0.6f, -0.1f, aboveWater) * (1.0f - Smoothstep(0.4f, 0.9f, aboveWater)) *
+				Smoothstep(0.85f, 0.95f, flatness) * (0.4f + (0.4f * patches));
+			float grass = Smoothstep(0.5f, 1.5f, aboveWater) * Smoothstep(0.8f, 0.92f, flatness) *
+				(0.25f + (0.65f * patches));
+
+			size_t texel = (static_cast<size_t>(z) * (m_gridResolution + 1)) + x;
+			pDensity[(texel * 2) + 0] = reeds;
+			pDensity[(texel * 2) + 1] = grass;
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  ScatterTile()
+ *
+ *  This method is used for copying the heights and density
+ *  map of a tile into a free slot and scattering its clumps
+ *  there in the compute program, which is already bound.
+ ***********************************************************/
+bool FoliageScatter::ScatterTile(const LOADED_TILE& tile)
+{
+	int slot = -1;
+	for (int i = 0; (i < m_slots.size()) && (slot < 0); i++)
+	{
+		if (m_slots[i].tileX < 0)
+		{
+			slot = i;
+		}
+	}
+	if ((slot < 0) || (tile.data.size() != m_slotFloats))
+	{
+		return(false);
+	}
+
+	GLuint zeroCount = 0;
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_tileBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, slot * m_slotFloats * sizeof(float), m_slotFloats * sizeof(float), tile.data.data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_countBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, slot * sizeof(GLuint), sizeof(GLuint), &zeroCount);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	glUniform1i(glGetUniformLocation(m_computeProgram, "tileSlot"), slot);
+	glUniform2i(glGetUniformLocation(m_computeProgram, "tileIndex"), tile.tileX, tile.tileZ);
+	glUniform2f(glGetUniformLocation(m_computeProgram, "tileCorner"),
+		m_origin + (tile.tileX * m_tileSize),
+		m_origin + (tile.tileZ * m_tileSize));
+
+	const GLuint candidates = static_cast<GLuint>(m_settings.candidatesPerSide * m_settings.candidatesPerSide);
+	glDispatchCompute((candidates + FOLIAGE_COMPUTE_GROUP_SIZE - 1) / FOLIAGE_COMPUTE_GROUP_SIZE, 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	m_slots[slot].tileX = tile.tileX;
+	m_slots[slot].tileZ = tile.tileZ;
+	m_tileSlots[(static_cast<size_t>(tile.tileZ) * m_tileCount) + tile.tileX] = slot;
+	m_scatteredTileCount++;
+	return(true);
+}
+
+/***********************************************************
+ *  FreeSlot()
+ *
+ *  This method is used for dropping the clumps of a slot by
+ *  zeroing its count, so the culling pass skips it.
+ ***********************************************************/
+void FoliageScatter::FreeSlot(int slot)
+{
+	GLuint zeroCount = 0;
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_countBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, slot * sizeof(GLuint), sizeof(GLuint), &zeroCount);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	m_tileSlots[(static_cast<size_t>(m_slots[slot].tileZ) * m_tileCount) + m_slots[slot].tileX] = -1;
+	m_slots[slot].tileX = -1;
+	m_slots[slot].tileZ = -1;
+}
+
+/***********************************************************
+ *  CreateMeshes()
+ *
+ *  This method is used for building the detailed and the
+ *  simple clump into one mesh with the same vertex layout
+ *  as the basic meshes.  A clump is three tapering blades
+ *  crossing at its root, across x and z in units of the
+ *  blade width and up y in units of the clump height, each
+ *  normal facing out of its blade.  The instances come from
+ *  the culled clumps, the second draw starting halfway in.
+ ***********************************************************/
+void FoliageScatter::CreateMeshes()
+{
+	std::vector<float> vertices;
+	std::vector<uint16_t> indices;
+	const int segmentCounts[2] = { FOLIAGE_DETAILED_SEGMENTS, FOLIAGE_SIMPLE_SEGMENTS };
+	for (int mesh = 0; mesh < 2; mesh++)
+	{
+		const int segments = segmentCounts[mesh];
+		m_baseVertices[mesh] = static_cast<int>(vertices.size() / 8);
+		m_firstIndices[mesh] = static_cast<int>(indices.size());
+
+		for (int blade = 0; blade < FOLIAGE_BLADES_PER_CLUMP; blade++)
+		{
+			float angle = (blade * 3.14159265f) / FOLIAGE_BLADES_PER_CLUMP;
+			glm::vec2 across(std::cos(angle), std::sin(angle));
+			glm::vec2 facing(-across.y, across.x);
+			uint16_t first = static_cast<uint16_t>((vertices.size() / 8) - m_baseVertices[mesh]);
+
+			// a pair of vertices at the bottom of every segment, then
+			// the tip
+			for (int segment = 0; segment <= segments; segment++)
+			{
+				float height = static_cast<float>(segment) / segments;
+				float halfWidth = 0.5f * (1.0f - height);
+				int sides = (segment < segments) ? 2 : 1;
+				for (int side = 0; side < sides; side++)
+				{
+					float offset = (sides == 1) ? 0.0f : ((side == 0) ? -halfWidth : halfWidth);
+					float u = (sides == 1) ? 0.5f : static_cast<float>(side);
+					float vertex[8] = {
+						across.x * offset, height, across.y * offset,
+						facing.x, 0.0f, facing.y,
+						u, height };
+					vertices.insert(vertices.end(), vertex, vertex + 8);
+				}
+			}
+
+			for (int segment = 0; segment < segments; segment++)
+			{
+				uint16_t bottom = static_cast<uint16_t>(first + (segment * 2));
+				if (segment < segments - 1)
+				{
+					uint16_t quad[6] = {
+						bottom, static_cast<uint16_t>(bottom + 1), static_cast<uint16_t>(bottom + 2),
+						static_cast<uint16_t>(bottom + 1), static_cast<uint16_t>(bottom + 3), static_cast<uint16_t>(bottom + 2) };
+					indices.insert(indices.end(), quad, quad + 6);
+				}
+				else
+				{
+					uint16_t tip[3] = { bottom, static_cast<uint16_t>(bottom + 1), static_cast<uint16_t>(bottom + 2) };
+					indices.insert(indices.end(), tip, tip + 3);
+				}
+			}
+		}
+		m_indexCounts[mesh] = static_cast<int>(indices.size()) - m_firstIndices[mesh];
+	}
+
+	glGenVertexArrays(1, &m_vertexArray);
+	glBindVertexArray(m_vertexArray);
+
+	const GLsizei stride = 8 * sizeof(float);
+	glGenBuffers(1, &m_vertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(0));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(3 * sizeof(float)));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(6 * sizeof(float)));
+
+	glGenBuffers(1, &m_indexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint16_t), indices.data(), GL_STATIC_DRAW);
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_visibleBuffer);
+	glEnableVertexAttribArray(3);
+	glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, FOLIAGE_CLUMP_BYTES, reinterpret_cast<void*>(0));
+	glVertexAttribDivisor(3, 1);
+	glEnableVertexAttribArray(4);
+	glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, FOLIAGE_CLUMP_BYTES, reinterpret_cast<void*>(sizeof(glm::vec4)));
+	glVertexAttribDivisor(4, 1);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
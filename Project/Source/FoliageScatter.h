@@ -0,0 +1,170 @@
+///////////////////////////////////////////////////////////////////////////////
+// foliagescatter.h
+// ============
+// scatter, cull and draw the grass and reeds of the lakeshore on the GPU
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "JobSystem.h"
+#include "HeightfieldTerrain.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// reach and density of the foliage and the wind swaying it, in world
+// units (meters) and seconds
+struct FOLIAGE_SETTINGS
+{
+	// distance from the camera the foliage reaches, thinning out from
+	// the fade start, and the distance the detailed blades reach
+	float range = 128.0f;
+	float fadeStart = 96.0f;
+	float detailRange = 32.0f;
+	// candidate positions along each side of a terrain tile, each
+	// growing at most one clump of blades
+	int candidatesPerSide = 96;
+	// most clumps drawn in a frame at each level of detail
+	int maxVisible = 131072;
+	// height of the still water, reeds growing along it and grass on
+	// the flat ground above it
+	float waterLevel = 0.0f;
+	uint32_t seed = 7;
+
+	// direction and strength of the wind swaying the blades
+	glm::vec2 windDirection = glm::vec2(1.0f, 0.4f);
+	float windStrength = 0.3f;
+};
+
+/***********************************************************
+ *  FoliageScatter
+ *
+ *  This class grows clumps of grass and reeds on the finest
+ *  tiles of the terrain without touching single clumps on
+ *  the CPU.  When a tile comes into range a worker reads its
+ *  heights from the terrain cache and derives a density map
+ *  of reeds along the waterline and grass on the flat ground
+ *  from them.  A compute shader then scatters the clumps of
+ *  the tile into its slot of the scattered buffer once, and
+ *  they stay there while the tile is in range.  Every frame
+ *  a second pass culls the clumps of every slot against the
+ *  view and by distance, picks a level of detail for each
+ *  and appends the survivors to the instances of two
+ *  indirect draws, which draw them in a single call.  The
+ *  vertex shader sways the blades in the wind.
+ ***********************************************************/
+class FoliageScatter
+{
+public:
+	// constructor
+	FoliageScatter();
+	// destructor
+	~FoliageScatter();
+
+	// create the tile slots, the clump buffers and the blade meshes
+	// for the finest tiles of the terrain, scattered and culled by the
+	// passed in compute program
+	bool Initialize(
+		const FOLIAGE_SETTINGS& settings,
+		const HeightfieldTerrain* pTerrain,
+		GLuint computeProgram,
+		JobSystem* pJobSystem);
+	// free the buffers and meshes, once the workers have finished
+	void Release();
+
+	// scatter the tiles that came into range, then cull the clumps and
+	// choose their levels of detail for the camera
+	void Update(glm::vec3 cameraPosition, const glm::mat4& viewProjection);
+	// draw the clumps that survived the culling
+	void Draw();
+
+	// true once the buffers and meshes were created
+	bool IsReady() const { return(m_vertexArray != 0); }
+	const FOLIAGE_SETTINGS& GetSettings() const { return(m_settings); }
+	// get the box around the tiles in range
+	glm::vec3 GetBoundsMin() const { return(m_boundsMin); }
+	glm::vec3 GetBoundsMax() const { return(m_boundsMax); }
+	// get the tiles holding clumps, and the tiles scattered so far
+	int GetTileCount() const;
+	int GetScatteredTileCount() const { return(m_scatteredTileCount); }
+	// read back the clumps drawn at each level of detail by the last
+	// update, which waits for the GPU to finish it
+	void ReadDrawnCounts(int& detailedCount, int& simpleCount);
+
+private:
+	// the heights and density map of a tile read by a worker
+	struct LOADED_TILE
+	{
+		int tileX;
+		int tileZ;
+		std::vector<float> data;
+	};
+
+	// one tile worth of room in the scattered buffer
+	struct TILE_SLOT
+	{
+		// tile held by the slot, -1 while the slot is free
+		int tileX;
+		int tileZ;
+	};
+
+	FOLIAGE_SETTINGS m_settings;
+	const HeightfieldTerrain* m_pTerrain;
+	GLuint m_computeProgram;
+	JobSystem* m_pJobSystem;
+
+	// layout of the finest terrain tiles
+	int m_tileCount;
+	float m_tileSize;
+	float m_origin;
+	int m_gridResolution;
+	int m_slotFloats;
+
+	// slot of every tile, -1 when not scattered, and the tiles being
+	// read by a worker
+	std::vector<int> m_tileSlots;
+	std::vector<bool> m_pendingTiles;
+	std::vector<TILE_SLOT> m_slots;
+	int m_scatteredTileCount;
+
+	// tiles handed back by the workers
+	std::vector<LOADED_TILE> m_loadedTiles;
+	std::mutex m_loadedMutex;
+	// number of tile reads still running on the workers
+	std::atomic<int> m_loadsInFlight;
+
+	// heights and density maps, clump counts and clumps of every
+	// slot, then the clumps drawn and their two draw commands
+	GLuint m_tileBuffer;
+	GLuint m_countBuffer;
+	GLuint m_scatteredBuffer;
+	GLuint m_visibleBuffer;
+	GLuint m_commandBuffer;
+
+	// the detailed and the simple clump of blades, one after the other
+	GLuint m_vertexArray;
+	GLuint m_vertexBuffer;
+	GLuint m_indexBuffer;
+	int m_indexCounts[2];
+	int m_firstIndices[2];
+	int m_baseVertices[2];
+
+	glm::vec3 m_boundsMin;
+	glm::vec3 m_boundsMax;
+
+	// true when a tile is close enough to the camera to hold foliage
+	bool IsTileInRange(int tileX, int tileZ, glm::vec3 cameraPosition) const;
+	// read the heights of a tile and derive its density map
+	bool LoadTile(int tileX, int tileZ, std::vector<float>& data) const;
+	// copy a loaded tile into a free slot and scatter its clumps
+	bool ScatterTile(const LOADED_TILE& tile);
+	// free the slot of a tile, dropping its clumps
+	void FreeSlot(int slot);
+	// build the detailed and the simple clump of blades
+	void CreateMeshes();
+};
@@ -0,0 +1,1082 @@
+///////////////////////////////////////////////////////////////////////////////
+// heightfieldterrain.cpp
+// ============
+// draw kilometers of terrain around the lake with a streamed quadtree of
+// continuous levels of detail
+///////////////////////////////////////////////////////////////////////////////
+
+#include "HeightfieldTerrain.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+// declaration of global variables
+namespace
+{
+	// identifies a cooked terrain cache file and its layout version
+	const uint32_t TERRAIN_FILE_MAGIC = 0x314E5254; // "TRN1"
+	const uint32_t TERRAIN_FILE_VERSION = 1;
+	// size in bytes of the cache file header
+	const uint64_t TERRAIN_HEADER_SIZE = (sizeof(uint32_t) * 2) + sizeof(uint64_t) + (sizeof(int32_t) * 2) + (sizeof(float) * 3);
+
+	// samples repeated around the grid of every tile, so the vertex
+	// shader finds the neighbors of the edge vertices for the normals
+	const int TERRAIN_TILE_BORDER = 1;
+
+	// limits on the streaming work done for each frame
+	const int TERRAIN_MAX_UPLOADS_PER_FRAME = 16;
+	const int TERRAIN_MAX_LOADS_IN_FLIGHT = 16;
+
+	// octaves of noise summed into the hills
+	const int TERRAIN_HILL_OCTAVES = 8;
+
+	/***********************************************************
+	 *  ExtractFrustumPlanes()
+	 *
+	 *  The six planes of a view, each row combination of the
+	 *  view projection facing inward.
+	 ***********************************************************/
+	void ExtractFrustumPlanes(const glm::mat4& viewProjection, glm::vec4* planes)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			glm::vec4 row(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+			glm::vec4 last(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+			planes[(i * 2) + 0] = last + row;
+			planes[(i * 2) + 1] = last - row;
+		}
+	}
+
+	/***********************************************************
+	 *  RunParallel()
+	 *
+	 *  Run the loop on the job system when there is one.
+	 ***********************************************************/
+	void RunParallel(
+		JobSystem* pJobSystem,
+		size_t count,
+		size_t grainSize,
+		const std::function<void(size_t begin, size_t end)>& func)
+	{
+		if (NULL != pJobSystem)
+		{
+			pJobSystem->ParallelFor(count, grainSize, func);
+		}
+		else
+		{
+			func(0, count);
+		}
+	}
+
+	/***********************************************************
+	 *  HashSettings()
+	 *
+	 *  Hash the settings that shape the cooked heights with
+	 *  64-bit FNV-1a, so changed settings are cooked again.
+	 ***********************************************************/
+	uint64_t HashSettings(const TERRAIN_SETTINGS& settings)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		auto hashBytes = [&hash](const void* data, size_t size)
+			{
+				const uint8_t* bytes = static_cast<const uint8_t*>(data);
+				for (size_t i = 0; i < size; i++)
+				{
+					hash ^= bytes[i];
+					hash *= 1099511628211ull;
+				}
+			};
+
+		hashBytes(&TERRAIN_FILE_VERSION, sizeof(TERRAIN_FILE_VERSION));
+		hashBytes(&settings.worldSize, sizeof(settings.worldSize));
+		hashBytes(&settings.levelCount, sizeof(settings.levelCount));
+		hashBytes(&settings.gridResolution, sizeof(settings.gridResolution));
+		hashBytes(&settings.seed, sizeof(settings.seed));
+		hashBytes(&settings.basinRadius, sizeof(settings.basinRadius));
+		hashBytes(&settings.basinDepth, sizeof(settings.basinDepth));
+		hashBytes(&settings.shoreHeight, sizeof(settings.shoreHeight));
+		hashBytes(&settings.hillSize, sizeof(settings.hillSize));
+		hashBytes(&settings.hillHeight, sizeof(settings.hillHeight));
+		return(hash);
+	}
+
+	/***********************************************************
+	 *  LatticeValue()
+	 *
+	 *  Random value in [0, 1] of a lattice cell.
+	 ***********************************************************/
+	float LatticeValue(int x, int z, uint32_t seed)
+	{
+		uint32_t h = (static_cast<uint32_t>(x) * 0x8da6b343u) ^ (static_cast<uint32_t>(z) * 0xd8163841u) ^ (seed * 0xcb1ab31fu);
+		h ^= h >> 15;
+		h *= 0x2c1b3c6du;
+		h ^= h >> 12;
+		h *= 0x297a2d39u;
+		h ^= h >> 15;
+		return(static_cast<float>(h & 0xFFFFFFu) / 16777215.0f);
+	}
+
+	/***********************************************************
+	 *  ValueNoise()
+	 *
+	 *  Smoothly interpolated lattice noise.
+	 ***********************************************************/
+	float ValueNoise(float x, float z, uint32_t seed)
+	{
+		float cellX = floorf(x);
+		float cellZ = floorf(z);
+		float fx = x - cellX;
+		float fz = z - cellZ;
+		float ux = fx * fx * (3.0f - (2.0f * fx));
+		float uz = fz * fz * (3.0f - (2.0f * fz));
+
+		int ix = static_cast<int>(cellX);
+		int iz = static_cast<int>(cellZ);
+		float a = LatticeValue(ix, iz, seed);
+		float b = LatticeValue(ix + 1, iz, seed);
+		float c = LatticeValue(ix, iz + 1, seed);
+		float d = LatticeValue(ix + 1, iz + 1, seed);
+		return(((a + ((b - a) * ux)) * (1.0f - uz)) + ((c + ((d - c) * ux)) * uz));
+	}
+
+	/***********************************************************
+	 *  LakeshoreHeight()
+	 *
+	 *  Height of the generated terrain at a world position: a
+	 *  basin under the lake rising smoothly to the shore, and
+	 *  hills growing out of the ground past a strip of low
+	 *  land around it.
+	 ***********************************************************/
+	float LakeshoreHeight(float x, float z, const TERRAIN_SETTINGS& settings)
+	{
+		float distance = sqrtf((x * x) + (z * z));
+		float shore = std::clamp((distance - settings.basinRadius) / settings.basinRadius, 0.0f, 1.0f);
+		shore = shore * shore * (3.0f - (2.0f * shore));
+		float rise = std::clamp((distance - (2.0f * settings.basinRadius)) / settings.hillSize, 0.0f, 1.0f);
+
+		float hills = 0.0f;
+		float amplitude = 0.5f;
+		float frequency = 1.0f / settings.hillSize;
+		float total = 0.0f;
+		for (int octave = 0; octave < TERRAIN_HILL_OCTAVES; octave++)
+		{
+			hills += amplitude * ValueNoise(x * frequency, z * frequency, settings.seed + octave);
+			total += amplitude;
+			amplitude *= 0.5f;
+			frequency *= 2.0f;
+		}
+		hills /= total;
+
+		return(settings.basinDepth + ((settings.shoreHeight - settings.basinDepth) * shore) +
+			(settings.hillHeight * hills * hills * rise));
+	}
+}
+
+/***********************************************************
+ *  HeightfieldTerrain()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+HeightfieldTerrain::HeightfieldTerrain()
+{
+	m_pJobSystem = NULL;
+	m_levelCount = 0;
+	m_gridResolution = 0;
+	m_minHeight = 0.0f;
+	m_maxHeight = 0.0f;
+	m_heightTexture = 0;
+	m_heightUnit = 0;
+	m_frame = 0;
+	m_loadsInFlight = 0;
+	m_gridVertexArray = 0;
+	m_gridVertexBuffer = 0;
+	m_gridIndexBuffer = 0;
+	m_instanceBuffer = 0;
+	m_gridIndexCount = 0;
+	m_instanceCapacity = 0;
+	m_culledCount = 0;
+	m_placeholderCount = 0;
+	m_prefetchUsedCount = 0;
+	m_prefetchWastedCount = 0;
+	m_boundsMin = glm::vec3(0.0f);
+	m_boundsMax = glm::vec3(0.0f);
+	m_cameraPosition = glm::vec3(0.0f);
+}
+
+/***********************************************************
+ *  ~HeightfieldTerrain()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+HeightfieldTerrain::~HeightfieldTerrain()
+{
+	Close();
+}
+
+/***********************************************************
+ *  Cook()
+ *
+ *  This method is used for generating the heightmap and
+ *  writing the cache file read by Open().  The heightmap
+ *  has one sample for every vertex of the finest nodes.
+ *  Each coarser level keeps every other sample of the one
+ *  below, so a vertex fully morphed onto the coarser grid
+ *  lands exactly on the height the coarser node draws.  The
+ *  file holds the lowest and highest sample under every
+ *  node, then the tiles of every node, finest level first.
+ ***********************************************************/
+bool HeightfieldTerrain::Cook(const char* cacheFile, const TERRAIN_SETTINGS& settings, JobSystem* pJobSystem)
+{
+	if ((settings.levelCount < 1) || (settings.gridResolution < 2) || ((settings.gridResolution & 1) != 0))
+	{
+		std::cout << "Invalid terrain layout, levels:" << settings.levelCount
+			<< ", grid:" << settings.gridResolution << std::endl;
+		return(false);
+	}
+	uint64_t settingsHash = HashSettings(settings);
+
+	// keep the existing cache file when it was cooked with these settings
+	{
+		std::ifstream cached(cacheFile, std::ios::binary);
+		uint32_t magic = 0;
+		uint32_t version = 0;
+		uint64_t cachedHash = 0;
+		cached.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+		cached.read(reinterpret_cast<char*>(&version), sizeof(version));
+		cached.read(reinterpret_cast<char*>(&cachedHash), sizeof(cachedHash));
+		if (cached && (magic == TERRAIN_FILE_MAGIC) && (version == TERRAIN_FILE_VERSION) && (cachedHash == settingsHash))
+		{
+			return(true);
+		}
+	}
+
+	const int grid = settings.gridResolution;
+	const int levelCount = settings.levelCount;
+	const int quads = grid << (levelCount - 1);
+	const int sampleCount = quads + 1;
+	const float spacing = settings.worldSize / quads;
+	const float origin = -0.5f * settings.worldSize;
+
+	std::vector<float> heights(static_cast<size_t>(sampleCount) * sampleCount);
+	RunParallel(pJobSystem, sampleCount, 16, [&](size_t begin, size_t end)
+		{
+			for (size_t z = begin; z < end; z++)
+			{
+				for (int x = 0; x < sampleCount; x++)
+				{
+					heights[(z * sampleCount) + x] = LakeshoreHeight(origin + (x * spacing), origin + (z * spacing), settings);
+				}
+			}
+		});
+	std::pair<std::vector<float>::iterator, std::vector<float>::iterator> range = std::minmax_element(heights.begin(), heights.end());
+	float minHeight = *range.first;
+	float maxHeight = std::max(*range.second, minHeight + 0.001f);
+
+	// store the heights as fractions of the range
+	std::vector<uint16_t> samples(heights.size());
+	float scale = 65535.0f / (maxHeight - minHeight);
+	for (size_t i = 0; i < heights.size(); i++)
+	{
+		samples[i] = static_cast<uint16_t>(((heights[i] - minHeight) * scale) + 0.5f);
+	}
+	std::vector<float>().swap(heights);
+
+	// the lowest and highest sample under each node, the finest level
+	// from the samples and every other one from its four children
+	std::vector<std::vector<uint16_t>> nodeHeights(levelCount);
+	for (int level = 0; level < levelCount; level++)
+	{
+		int nodes = 1 << (levelCount - 1 - level);
+		nodeHeights[level].resize(static_cast<size_t>(nodes) * nodes * 2);
+		RunParallel(pJobSystem, nodes, 1, [&](size_t begin, size_t end)
+			{
+				for (size_t nodeZ = begin; nodeZ < end; nodeZ++)
+				{
+					for (int nodeX = 0; nodeX < nodes; nodeX++)
+					{
+						uint16_t low = 65535;
+						uint16_t high = 0;
+						if (level == 0)
+						{
+							for (size_t z = nodeZ * grid; z <= (nodeZ + 1) * grid; z++)
+							{
+								for (size_t x = static_cast<size_t>(nodeX) * grid; x <= static_cast<size_t>(nodeX + 1) * grid; x++)
+								{
+									low = std::min(low, samples[(z * sampleCount) + x]);
+									high = std::max(high, samples[(z * sampleCount) + x]);
+								}
+							}
+						}
+						else
+						{
+							const std::vector<uint16_t>& children = nodeHeights[level - 1];
+							for (int child = 0; child < 4; child++)
+							{
+								size_t childIndex = ((((nodeZ * 2) + (child >> 1)) * (nodes * 2)) + (nodeX * 2) + (child & 1)) * 2;
+								low = std::min(low, children[childIndex]);
+								high = std::max(high, children[childIndex + 1]);
+							}
+						}
+						nodeHeights[level][((nodeZ * nodes) + nodeX) * 2] = low;
+						nodeHeights[level][(((nodeZ * nodes) + nodeX) * 2) + 1] = high;
+					}
+				}
+			});
+	}
+
+	std::ofstream file(cacheFile, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		std::cout << "Could not write terrain cache:" << cacheFile << std::endl;
+		return(false);
+	}
+
+	int32_t layout[2] = { levelCount, grid };
+	float extent[3] = { settings.worldSize, minHeight, maxHeight };
+	file.write(reinterpret_cast<const char*>(&TERRAIN_FILE_MAGIC), sizeof(TERRAIN_FILE_MAGIC));
+	file.write(reinterpret_cast<const char*>(&TERRAIN_FILE_VERSION), sizeof(TERRAIN_FILE_VERSION));
+	file.write(reinterpret_cast<const char*>(&settingsHash), sizeof(settingsHash));
+	file.write(reinterpret_cast<const char*>(layout), sizeof(layout));
+	file.write(reinterpret_cast<const char*>(extent), sizeof(extent));
+	for (int level = 0; level < levelCount; level++)
+	{
+		file.write(reinterpret_cast<const char*>(nodeHeights[level].data()), nodeHeights[level].size() * sizeof(uint16_t));
+	}
+
+	// the tiles of a node hold its grid and the border around it at the
+	// sample spacing of its level, clamped at the edge of the terrain
+	const int tileSize = grid + 1 + (2 * TERRAIN_TILE_BORDER);
+	const size_t tileSamples = static_cast<size_t>(tileSize) * tileSize;
+	std::vector<uint16_t> rowTiles;
+	for (int level = 0; level < levelCount; level++)
+	{
+		int nodes = 1 << (levelCount - 1 - level);
+		rowTiles.resize(nodes * tileSamples);
+		for (int nodeZ = 0; nodeZ < nodes; nodeZ++)
+		{
+			RunParallel(pJobSystem, nodes, 4, [&](size_t begin, size_t end)
+				{
+					for (size_t nodeX = begin; nodeX < end; nodeX++)
+					{
+						uint16_t* tile = &rowTiles[nodeX * tileSamples];
+						for (int y = 0; y < tileSize; y++)
+						{
+							int sampleZ = std::clamp(((nodeZ * grid) + y - TERRAIN_TILE_BORDER) << level, 0, quads);
+							for (int x = 0; x < tileSize; x++)
+							{
+								int sampleX = std::clamp(((static_cast<int>(nodeX) * grid) + x - TERRAIN_TILE_BORDER) << level, 0, quads);
+								tile[(y * tileSize) + x] = samples[(static_cast<size_t>(sampleZ) * sampleCount) + sampleX];
+							}
+						}
+					}
+				});
+			file.write(reinterpret_cast<const char*>(rowTiles.data()), rowTiles.size() * sizeof(uint16_t));
+		}
+	}
+
+	std::cout << "Cooked terrain:" << cacheFile << ", samples:" << sampleCount << "x" << sampleCount
+		<< ", levels:" << levelCount << ", heights:" << minHeight << " to " << maxHeight << std::endl;
+
+	return(file.good());
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method is used for reading the layout and the node
+ *  heights of a cooked cache file and creating the tile
+ *  cache, a texture array with one tile in every layer, and
+ *  the grid every node is drawn with.  The tile of the root
+ *  is loaded right away and never evicted, so there is
+ *  always a node to draw.
+ ***********************************************************/
+bool HeightfieldTerrain::Open(
+	const char* cacheFile,
+	const TERRAIN_SETTINGS& settings,
+	int heightUnit,
+	JobSystem* pJobSystem)
+{
+	Close();
+
+	std::ifstream file(cacheFile, std::ios::binary);
+	if (!file)
+	{
+		std::cout << "Could not open terrain cache:" << cacheFile << std::endl;
+		return(false);
+	}
+
+	uint32_t magic = 0;
+	uint32_t version = 0;
+	uint64_t settingsHash = 0;
+	int32_t layout[2] = { 0 };
+	float extent[3] = { 0.0f };
+	file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+	file.read(reinterpret_cast<char*>(&version), sizeof(version));
+	file.read(reinterpret_cast<char*>(&settingsHash), sizeof(settingsHash));
+	file.read(reinterpret_cast<char*>(layout), sizeof(layout));
+	file.read(reinterpret_cast<char*>(extent), sizeof(extent));
+	if (!file || (magic != TERRAIN_FILE_MAGIC) || (version != TERRAIN_FILE_VERSION) ||
+		(layout[0] < 1) || (layout[0] > 16) || (layout[1] < 2) || (settings.cacheTiles < 1))
+	{
+		std::cout << "Invalid terrain cache:" << cacheFile << std::endl;
+		return(false);
+	}
+
+	m_settings = settings;
+	m_settings.worldSize = extent[0];
+	m_cacheFile = cacheFile;
+	m_pJobSystem = pJobSystem;
+	m_levelCount = layout[0];
+	m_gridResolution = layout[1];
+	m_minHeight = extent[1];
+	m_maxHeight = extent[2];
+
+	const int tileSize = m_gridResolution + 1 + (2 * TERRAIN_TILE_BORDER);
+	const uint64_t tileBytes = static_cast<uint64_t>(tileSize) * tileSize * sizeof(uint16_t);
+	m_nodeHeights.resize(m_levelCount);
+	m_residentSlots.resize(m_levelCount);
+	m_pendingTiles.resize(m_levelCount);
+	m_levelOffsets.resize(m_levelCount);
+	m_ranges.resize(m_levelCount);
+	m_morphStarts.resize(m_levelCount);
+	uint64_t offset = TERRAIN_HEADER_SIZE;
+	for (int level = 0; level < m_levelCount; level++)
+	{
+		size_t nodes = static_cast<size_t>(GetNodeCount(level)) * GetNodeCount(level);
+		m_nodeHeights[level].resize(nodes * 2);
+		file.read(reinterpret_cast<char*>(m_nodeHeights[level].data()), nodes * 2 * sizeof(uint16_t));
+		m_residentSlots[level].assign(nodes, -1);
+		m_pendingTiles[level].assign(nodes, false);
+		offset += nodes * 2 * sizeof(uint16_t);
+	}
+	for (int level = 0; level < m_levelCount; level++)
+	{
+		m_levelOffsets[level] = offset;
+		offset += static_cast<uint64_t>(GetNodeCount(level)) * GetNodeCount(level) * tileBytes;
+
+		// the vertices of a level morph over the last part of the
+		// distance between the split of its own nodes and its parents
+		float nodeSize = m_settings.worldSize / GetNodeCount(level);
+		m_ranges[level] = m_settings.lodRangeRatio * nodeSize;
+		float previousRange = (level > 0) ? m_ranges[level - 1] : 0.0f;
+		m_morphStarts[level] = previousRange + ((m_ranges[level] - previousRange) * m_settings.morphStartRatio);
+	}
+	if (!file)
+	{
+		std::cout << "Invalid terrain cache:" << cacheFile << std::endl;
+		return(false);
+	}
+	file.close();
+
+	m_heightUnit = heightUnit;
+	glActiveTexture(GL_TEXTURE0 + m_heightUnit);
+	glGenTextures(1, &m_heightTexture);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_heightTexture);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R16, tileSize, tileSize, m_settings.cacheTiles, 0, GL_RED, GL_UNSIGNED_SHORT, NULL);
+
+	m_slots.resize(m_settings.cacheTiles);
+	for (int i = 0; i < m_slots.size(); i++)
+	{
+		m_slots[i].level = -1;
+		m_slots[i].nodeX = 0;
+		m_slots[i].nodeZ = 0;
+		m_slots[i].lastUsedFrame = -1;
+		m_slots[i].bPrefetched = false;
+	}
+
+	// the root tile stays in the first slot
+	LOADED_TILE root;
+	root.level = m_levelCount - 1;
+	root.nodeX = 0;
+	root.nodeZ = 0;
+	root.priority = 0;
+	if ((ReadTile(root.level, 0, 0, root.samples) == false) || (UploadTile(root) == false))
+	{
+		std::cout << "Could not read the terrain root tile:" << cacheFile << std::endl;
+		Close();
+		return(false);
+	}
+	m_slots[m_residentSlots[root.level][0]].lastUsedFrame = INT_MAX;
+
+	// one grid over the unit square with the same layout as the basic
+	// meshes; the heights and normals come from the tiles
+	const int quads = m_gridResolution;
+	std::vector<float> vertices;
+	vertices.reserve(static_cast<size_t>(quads + 1) * (quads + 1) * 8);
+	for (int z = 0; z <= quads; z++)
+	{
+		for (int x = 0; x <= quads; x++)
+		{
+			float u = static_cast<float>(x) / quads;
+			float v = static_cast<float>(z) / quads;
+			float vertex[8] = { u, 0.0f, v, 0.0f, 1.0f, 0.0f, u, v };
+			vertices.insert(vertices.end(), vertex, vertex + 8);
+		}
+	}
+	std::vector<uint16_t> indices;
+	indices.reserve(static_cast<size_t>(quads) * quads * 6);
+	for (int z = 0; z < quads; z++)
+	{
+		for (int x = 0; x < quads; x++)
+		{
+			uint16_t corner = static_cast<uint16_t>((z * (quads + 1)) + x);
+			uint16_t quad[6] = {
+				corner, static_cast<uint16_t>(corner + quads + 1), static_cast<uint16_t>(corner + 1),
+				static_cast<uint16_t>(corner + 1), static_cast<uint16_t>(corner + quads + 1), static_cast<uint16_t>(corner + quads + 2) };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	}
+	m_gridIndexCount = static_cast<int>(indices.size());
+
+	glGenVertexArrays(1, &m_gridVertexArray);
+	glBindVertexArray(m_gridVertexArray);
+
+	const GLsizei stride = 8 * sizeof(float);
+	glGenBuffers(1, &m_gridVertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, m_gridVertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(0));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(3 * sizeof(float)));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(6 * sizeof(float)));
+
+	glGenBuffers(1, &m_gridIndexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_gridIndexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint16_t), indices.data(), GL_STATIC_DRAW);
+
+	// each node is placed by its corner, side and slot, and morphed
+	// between its two distances
+	m_instanceCapacity = 256;
+	glGenBuffers(1, &m_instanceBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+	glBufferData(GL_ARRAY_BUFFER, m_instanceCapacity * sizeof(NODE_INSTANCE), NULL, GL_STREAM_DRAW);
+	glEnableVertexAttribArray(3);
+	glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(NODE_INSTANCE), reinterpret_cast<void*>(0));
+	glVertexAttribDivisor(3, 1);
+	glEnableVertexAttribArray(4);
+	glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(NODE_INSTANCE), reinterpret_cast<void*>(sizeof(glm::vec4)));
+	glVertexAttribDivisor(4, 1);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	return(true);
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method is used for freeing the tile cache and the
+ *  grid, once the workers have finished their loads.
+ ***********************************************************/
+void HeightfieldTerrain::Close()
+{
+	// the workers write into this object, so let them finish
+	while (m_loadsInFlight.load() > 0)
+	{
+		std::this_thread::yield();
+	}
+	m_loadedTiles.clear();
+
+	if (m_heightTexture != 0)
+	{
+		glDeleteTextures(1, &m_heightTexture);
+		m_heightTexture = 0;
+	}
+	if (m_gridVertexArray != 0)
+	{
+		glDeleteVertexArrays(1, &m_gridVertexArray);
+		glDeleteBuffers(1, &m_gridVertexBuffer);
+		glDeleteBuffers(1, &m_gridIndexBuffer);
+		glDeleteBuffers(1, &m_instanceBuffer);
+		m_gridVertexArray = 0;
+		m_gridVertexBuffer = 0;
+		m_gridIndexBuffer = 0;
+		m_instanceBuffer = 0;
+	}
+
+	m_residentSlots.clear();
+	m_pendingTiles.clear();
+	m_slots.clear();
+	m_requests.clear();
+	m_predictedViews.clear();
+	m_nodes.clear();
+	m_placeholderCount = 0;
+	m_prefetchUsedCount = 0;
+	m_prefetchWastedCount = 0;
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for uploading the tiles the workers
+ *  have finished loading, within a per-frame budget, then
+ *  walking the quadtree for the camera and handing the
+ *  tiles of the nodes waiting to split to the workers.  The
+ *  tiles needed now go first, both to the workers and to
+ *  the uploads, followed by those of the predicted views,
+ *  soonest first.
+ ***********************************************************/
+void HeightfieldTerrain::Update(glm::vec3 cameraPosition, const glm::mat4& viewProjection)
+{
+	if (IsReady() == false)
+	{
+		return;
+	}
+	m_frame++;
+
+	std::vector<LOADED_TILE> loaded;
+	{
+		std::lock_guard<std::mutex> lock(m_loadedMutex);
+		loaded.swap(m_loadedTiles);
+	}
+	std::stable_sort(loaded.begin(), loaded.end(), [](const LOADED_TILE& a, const LOADED_TILE& b)
+		{
+			return(a.priority < b.priority);
+		});
+
+	int uploads = 0;
+	for (size_t i = 0; i < loaded.size(); i++)
+	{
+		LOADED_TILE& tile = loaded[i];
+		if (uploads >= TERRAIN_MAX_UPLOADS_PER_FRAME)
+		{
+			// over budget, so keep the tile for the next frame
+			std::lock_guard<std::mutex> lock(m_loadedMutex);
+			m_loadedTiles.push_back(std::move(tile));
+			continue;
+		}
+
+		// a tile that could not be read or placed is requested again
+		// while its node still waits to split
+		m_pendingTiles[tile.level][(tile.nodeZ * GetNodeCount(tile.level)) + tile.nodeX] = false;
+		if (tile.samples.size() > 0)
+		{
+			UploadTile(tile);
+			uploads++;
+		}
+	}
+
+	ExtractFrustumPlanes(viewProjection, m_frustumPlanes);
+	m_cameraPosition = cameraPosition;
+
+	m_nodes.clear();
+	m_culledCount = 0;
+	m_placeholderCount = 0;
+	m_boundsMin = glm::vec3(FLT_MAX);
+	m_boundsMax = glm::vec3(-FLT_MAX);
+	SelectNode(m_levelCount - 1, 0, 0);
+
+	for (size_t i = 0; i < m_predictedViews.size(); i++)
+	{
+		glm::vec4 planes[6];
+		ExtractFrustumPlanes(m_predictedViews[i].viewProjection, planes);
+		PrefetchNode(m_levelCount - 1, 0, 0, planes, m_predictedViews[i].cameraPosition, static_cast<int>(i) + 1);
+	}
+
+	// load the tiles needed now first and the coarse tiles first
+	// among them, since they split the most ground
+	std::sort(m_requests.begin(), m_requests.end(), [](const glm::ivec4& a, const glm::ivec4& b)
+		{
+			return((a.w < b.w) || ((a.w == b.w) && (a.x > b.x)));
+		});
+
+	for (size_t i = 0; i < m_requests.size(); i++)
+	{
+		int level = m_requests[i].x;
+		int nodeX = m_requests[i].y;
+		int nodeZ = m_requests[i].z;
+		int priority = m_requests[i].w;
+
+		// a tile asked for by several views is loaded once, for the
+		// soonest of them
+		if ((m_pendingTiles[level][(nodeZ * GetNodeCount(level)) + nodeX]) ||
+			(m_loadsInFlight.load() >= TERRAIN_MAX_LOADS_IN_FLIGHT))
+		{
+			// dropped, the next walk asks again if still needed
+			continue;
+		}
+
+		m_pendingTiles[level][(nodeZ * GetNodeCount(level)) + nodeX] = true;
+		m_loadsInFlight++;
+		auto loadTile = [this, level, nodeX, nodeZ, priority]()
+			{
+				LOADED_TILE tile;
+				tile.level = level;
+				tile.nodeX = nodeX;
+				tile.nodeZ = nodeZ;
+				tile.priority = priority;
+				if (ReadTile(level, nodeX, nodeZ, tile.samples) == false)
+				{
+					tile.samples.clear();
+				}
+				{
+					std::lock_guard<std::mutex> lock(m_loadedMutex);
+					m_loadedTiles.push_back(std::move(tile));
+				}
+				m_loadsInFlight--;
+			};
+
+		if (NULL != m_pJobSystem)
+		{
+			m_pJobSystem->Submit(loadTile);
+		}
+		else
+		{
+			loadTile();
+		}
+	}
+	m_requests.clear();
+}
+
+/***********************************************************
+ *  SetPredictedViews()
+ *
+ *  This method is used for setting the views the camera is
+ *  predicted to reach.  An empty list stops the prefetch.
+ ***********************************************************/
+void HeightfieldTerrain::SetPredictedViews(const std::vector<TERRAIN_PREDICTED_VIEW>& views)
+{
+	m_predictedViews = views;
+}
+
+/***********************************************************
+ *  TakePrefetchCounts()
+ *
+ *  This method is used for getting the number of tiles
+ *  loaded for a predicted view that were drawn, and that
+ *  were evicted without being drawn, since the last call.
+ ***********************************************************/
+void HeightfieldTerrain::TakePrefetchCounts(int& usedCount, int& wastedCount)
+{
+	usedCount = m_prefetchUsedCount;
+	wastedCount = m_prefetchWastedCount;
+	m_prefetchUsedCount = 0;
+	m_prefetchWastedCount = 0;
+}
+
+/***********************************************************
+ *  Bind()
+ *
+ *  This method is used for binding the tile cache for the
+ *  next draw command.
+ ***********************************************************/
+void HeightfieldTerrain::Bind() const
+{
+	glActiveTexture(GL_TEXTURE0 + m_heightUnit);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_heightTexture);
+}
+
+/***********************************************************
+ *  Draw()
+ *
+ *  This method is used for drawing the nodes chosen by the
+ *  last update in one instanced draw of the grid.
+ ***********************************************************/
+void HeightfieldTerrain::Draw()
+{
+	if ((IsReady() == false) || (m_nodes.size() == 0))
+	{
+		return;
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+	if (m_nodes.size() > m_instanceCapacity)
+	{
+		m_instanceCapacity = m_nodes.size() * 2;
+	}
+	// orphan the buffer, so the draws of the last frame do not stall it
+	glBufferData(GL_ARRAY_BUFFER, m_instanceCapacity * sizeof(NODE_INSTANCE), NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, m_nodes.size() * sizeof(NODE_INSTANCE), m_nodes.data());
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glBindVertexArray(m_gridVertexArray);
+	glDrawElementsInstanced(GL_TRIANGLES, m_gridIndexCount, GL_UNSIGNED_SHORT, NULL, static_cast<GLsizei>(m_nodes.size()));
+	glBindVertexArray(0);
+}
+
+/***********************************************************
+ *  GetResidentCount()
+ *
+ *  This method is used for counting the occupied slots of
+ *  the tile cache.
+ ***********************************************************/
+int HeightfieldTerrain::GetResidentCount() const
+{
+	int count = 0;
+	for (size_t i = 0; i < m_slots.size(); i++)
+	{
+		if (m_slots[i].level >= 0)
+		{
+			count++;
+		}
+	}
+	return(count);
+}
+
+/***********************************************************
+ *  GetNodeBounds()
+ *
+ *  This method is used for getting the box around a node,
+ *  from its square and the lowest and highest sample under
+ *  it.
+ ***********************************************************/
+void HeightfieldTerrain::GetNodeBounds(int level, int nodeX, int nodeZ, glm::vec3& boundsMin, glm::vec3& boundsMax) const
+{
+	float nodeSize = m_settings.worldSize / GetNodeCount(level);
+	float origin = -0.5f * m_settings.worldSize;
+	size_t index = ((static_cast<size_t>(nodeZ) * GetNodeCount(level)) + nodeX) * 2;
+	float heightScale = (m_maxHeight - m_minHeight) / 65535.0f;
+
+	boundsMin = glm::vec3(
+		origin + (nodeX * nodeSize),
+		m_minHeight + (m_nodeHeights[level][index] * heightScale),
+		origin + (nodeZ * nodeSize));
+	boundsMax = glm::vec3(
+		boundsMin.x + nodeSize,
+		m_minHeight + (m_nodeHeights[level][index + 1] * heightScale),
+		boundsMin.z + nodeSize);
+}
+
+/***********************************************************
+ *  IsInView()
+ *
+ *  This method is used for testing a box against the planes
+ *  of the view.  The box is outside when its corner farthest
+ *  along the inward normal of any plane is behind it.
+ ***********************************************************/
+bool HeightfieldTerrain::IsInView(const glm::vec4* planes, glm::vec3 boundsMin, glm::vec3 boundsMax) const
+{
+	for (int i = 0; i < 6; i++)
+	{
+		const glm::vec4& plane = planes[i];
+		glm::vec3 corner(
+			(plane.x >= 0.0f) ? boundsMax.x : boundsMin.x,
+			(plane.y >= 0.0f) ? boundsMax.y : boundsMin.y,
+			(plane.z >= 0.0f) ? boundsMax.z : boundsMin.z);
+		if ((plane.x * corner.x) + (plane.y * corner.y) + (plane.z * corner.z) + plane.w < 0.0f)
+		{
+			return(false);
+		}
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  SelectNode()
+ *
+ *  This method is used for choosing the nodes to draw under
+ *  a node in view.  The node splits while the camera is
+ *  within the range of the level below, once the tiles of
+ *  its children in view are resident, and is drawn itself
+ *  otherwise.  Children out of view are skipped, so the
+ *  culling costs one test per node rather than per vertex.
+ ***********************************************************/
+void HeightfieldTerrain::SelectNode(int level, int nodeX, int nodeZ)
+{
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+	GetNodeBounds(level, nodeX, nodeZ, boundsMin, boundsMax);
+	if (IsInView(m_frustumPlanes, boundsMin, boundsMax) == false)
+	{
+		m_culledCount++;
+		return;
+	}
+
+	int slot = m_residentSlots[level][(nodeZ * GetNodeCount(level)) + nodeX];
+	m_slots[slot].lastUsedFrame = std::max(m_slots[slot].lastUsedFrame, m_frame);
+	if (m_slots[slot].bPrefetched)
+	{
+		m_slots[slot].bPrefetched = false;
+		m_prefetchUsedCount++;
+	}
+
+	glm::vec3 nearest = glm::clamp(m_cameraPosition, boundsMin, boundsMax);
+	if ((level > 0) && (glm::length(m_cameraPosition - nearest) < m_ranges[level - 1]))
+	{
+		bool bChildrenResident = true;
+		for (int child = 0; child < 4; child++)
+		{
+			int childX = (nodeX * 2) + (child & 1);
+			int childZ = (nodeZ * 2) + (child >> 1);
+			glm::vec3 childMin;
+			glm::vec3 childMax;
+			GetNodeBounds(level - 1, childX, childZ, childMin, childMax);
+			if ((IsInView(m_frustumPlanes, childMin, childMax) == true) && (RequestTile(level - 1, childX, childZ, 0) == false))
+			{
+				bChildrenResident = false;
+			}
+		}
+		if (bChildrenResident == false)
+		{
+			m_placeholderCount++;
+		}
+
+		if (bChildrenResident == true)
+		{
+			for (int child = 0; child < 4; child++)
+			{
+				SelectNode(level - 1, (nodeX * 2) + (child & 1), (nodeZ * 2) + (child >> 1));
+			}
+			return;
+		}
+	}
+
+	NODE_INSTANCE node;
+	node.placement = glm::vec4(boundsMin.x, boundsMin.z, boundsMax.x - boundsMin.x, static_cast<float>(slot));
+	node.morph = glm::vec4(m_morphStarts[level], m_ranges[level], 0.0f, 0.0f);
+	m_nodes.push_back(node);
+	m_boundsMin = glm::min(m_boundsMin, boundsMin);
+	m_boundsMax = glm::max(m_boundsMax, boundsMax);
+}
+
+/***********************************************************
+ *  PrefetchNode()
+ *
+ *  This method is used for walking the quadtree for a view
+ *  the camera is predicted to reach.  The tiles of the
+ *  nodes in that view are requested with the priority of
+ *  the view, the resident ones are marked as used so they
+ *  are not evicted before the camera gets there, and the
+ *  walk goes on into the children the predicted camera is
+ *  close enough to split, resident or not.
+ ***********************************************************/
+void HeightfieldTerrain::PrefetchNode(int level, int nodeX, int nodeZ, const glm::vec4* planes, glm::vec3 cameraPosition, int priority)
+{
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+	GetNodeBounds(level, nodeX, nodeZ, boundsMin, boundsMax);
+	if (IsInView(planes, boundsMin, boundsMax) == false)
+	{
+		return;
+	}
+
+	if (RequestTile(level, nodeX, nodeZ, priority) == true)
+	{
+		int slot = m_residentSlots[level][(nodeZ * GetNodeCount(level)) + nodeX];
+		m_slots[slot].lastUsedFrame = std::max(m_slots[slot].lastUsedFrame, m_frame);
+	}
+
+	glm::vec3 nearest = glm::clamp(cameraPosition, boundsMin, boundsMax);
+	if ((level > 0) && (glm::length(cameraPosition - nearest) < m_ranges[level - 1]))
+	{
+		for (int child = 0; child < 4; child++)
+		{
+			PrefetchNode(level - 1, (nodeX * 2) + (child & 1), (nodeZ * 2) + (child >> 1), planes, cameraPosition, priority);
+		}
+	}
+}
+
+/***********************************************************
+ *  RequestTile()
+ *
+ *  This method is used for queueing the tile of a node for
+ *  the workers unless it is resident or already loading.
+ *  Returns true when the tile is resident.
+ ***********************************************************/
+bool HeightfieldTerrain::RequestTile(int level, int nodeX, int nodeZ, int priority)
+{
+	int index = (nodeZ * GetNodeCount(level)) + nodeX;
+	if (m_residentSlots[level][index] >= 0)
+	{
+		return(true);
+	}
+	if (m_pendingTiles[level][index] == false)
+	{
+		m_requests.push_back(glm::ivec4(level, nodeX, nodeZ, priority));
+	}
+	return(false);
+}
+
+/***********************************************************
+ *  ReadTile()
+ *
+ *  This method is used for reading the samples of a tile
+ *  from the cache file.  It is called by the workers, so it
+ *  only reads members that never change after Open().
+ ***********************************************************/
+bool HeightfieldTerrain::ReadTile(int level, int nodeX, int nodeZ, std::vector<uint16_t>& samples) const
+{
+	std::ifstream file(m_cacheFile, std::ios::binary);
+	if (!file)
+	{
+		return(false);
+	}
+
+	const int tileSize = m_gridResolution + 1 + (2 * TERRAIN_TILE_BORDER);
+	const uint64_t tileSamples = static_cast<uint64_t>(tileSize) * tileSize;
+	uint64_t tileIndex = (static_cast<uint64_t>(nodeZ) * GetNodeCount(level)) + nodeX;
+
+	samples.resize(tileSamples);
+	file.seekg(m_levelOffsets[level] + (tileIndex * tileSamples * sizeof(uint16_t)));
+	file.read(reinterpret_cast<char*>(samples.data()), tileSamples * sizeof(uint16_t));
+	return(file.good());
+}
+
+/***********************************************************
+ *  UploadTile()
+ *
+ *  This method is used for copying a tile into a free layer
+ *  of the cache, or else into the layer of the node passed
+ *  least recently.  Nodes passed in the last walk are never
+ *  evicted, so a full cache cannot thrash.
+ ***********************************************************/
+bool HeightfieldTerrain::UploadTile(const LOADED_TILE& tile)
+{
+	int slot = -1;
+	for (int i = 0; i < m_slots.size(); i++)
+	{
+		if (m_slots[i].level < 0)
+		{
+			slot = i;
+			break;
+		}
+		if ((m_slots[i].lastUsedFrame < m_frame - 1) &&
+			((slot < 0) || (m_slots[i].lastUsedFrame < m_slots[slot].lastUsedFrame)))
+		{
+			slot = i;
+		}
+	}
+	if (slot < 0)
+	{
+		return(false);
+	}
+
+	// evict the node held by the slot
+	CACHE_SLOT& cacheSlot = m_slots[slot];
+	if (cacheSlot.level >= 0)
+	{
+		m_residentSlots[cacheSlot.level][(cacheSlot.nodeZ * GetNodeCount(cacheSlot.level)) + cacheSlot.nodeX] = -1;
+		if (cacheSlot.bPrefetched)
+		{
+			m_prefetchWastedCount++;
+		}
+	}
+	cacheSlot.level = tile.level;
+	cacheSlot.nodeX = tile.nodeX;
+	cacheSlot.nodeZ = tile.nodeZ;
+	cacheSlot.lastUsedFrame = m_frame;
+	cacheSlot.bPrefetched = (tile.priority > 0);
+	m_residentSlots[tile.level][(tile.nodeZ * GetNodeCount(tile.level)) + tile.nodeX] = slot;
+
+	// the rows of a tile are not a multiple of four bytes long
+	const int tileSize = m_gridResolution + 1 + (2 * TERRAIN_TILE_BORDER);
+	glActiveTexture(GL_TEXTURE0 + m_heightUnit);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_heightTexture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+	glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, slot, tileSize, tileSize, 1, GL_RED, GL_UNSIGNED_SHORT, tile.samples.data());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	return(true);
+}
@@ -0,0 +1,248 @@
+///////////////////////////////////////////////////////////////////////////////
+// heightfieldterrain.h
+// ============
+// draw kilometers of terrain around the lake with a streamed quadtree of
+// continuous levels of detail
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "JobSystem.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// size of the terrain, its levels of detail and the shape of the
+// generated lakeshore, in world units (meters)
+struct TERRAIN_SETTINGS
+{
+	// side of the square of terrain, centered on the origin
+	float worldSize = 4096.0f;
+	// levels of the quadtree, each node splitting into four of half
+	// its side, and the quads along each side of the grid drawn for
+	// every node; the heightmap has one sample per finest vertex
+	int levelCount = 7;
+	int gridResolution = 32;
+	// a node splits while the camera is closer than this many of its
+	// sides, and the vertices of a level morph into the next coarser
+	// grid from this fraction of the way into their range
+	float lodRangeRatio = 3.0f;
+	float morphStartRatio = 0.7f;
+	// height tiles kept in video memory
+	int cacheTiles = 512;
+
+	// a basin around the origin holding the lake, rising to a low
+	// shore and into hills of the passed in size and height
+	uint32_t seed = 11;
+	float basinRadius = 90.0f;
+	float basinDepth = -10.0f;
+	float shoreHeight = -1.5f;
+	float hillSize = 700.0f;
+	float hillHeight = 240.0f;
+};
+
+// a view the camera is predicted to reach, whose tiles are loaded ahead
+// of time after the tiles needed now
+struct TERRAIN_PREDICTED_VIEW
+{
+	glm::vec3 cameraPosition;
+	glm::mat4 viewProjection;
+};
+
+/***********************************************************
+ *  HeightfieldTerrain
+ *
+ *  This class draws a heightfield with continuous distance
+ *  dependent levels of detail.  The heightmap is cooked once
+ *  into a cache file holding a tile of heights for every
+ *  node of a quadtree over the terrain, each level sampled
+ *  half as densely as the one below it.  Every frame the
+ *  quadtree is walked from the root, skipping the nodes
+ *  outside the view and splitting those the camera is close
+ *  to, and the chosen nodes are drawn in one instanced draw
+ *  of a single grid.  The vertex shader reads the heights
+ *  from the tile of each node in a texture array, and moves
+ *  the vertices onto the grid of the next coarser level as
+ *  they near the end of the range of their own, so levels
+ *  blend without popping or cracks.  A node only splits
+ *  once the tiles of its children were loaded by the
+ *  workers, and the tiles not drawn for longest are evicted
+ *  to make room for new ones.  The quadtree is also walked
+ *  for the views the camera is predicted to reach, so the
+ *  tiles they need are loaded after those needed now and
+ *  are kept from eviction until the camera gets there.
+ ***********************************************************/
+class HeightfieldTerrain
+{
+public:
+	// constructor
+	HeightfieldTerrain();
+	// destructor
+	~HeightfieldTerrain();
+
+	// generate the heightmap and write the tiles of every node into the
+	// cache file, unless it was already cooked with these settings
+	static bool Cook(const char* cacheFile, const TERRAIN_SETTINGS& settings, JobSystem* pJobSystem);
+
+	// open a file cooked with the passed in settings and create the
+	// tile cache, bound to the passed in texture unit, and the grid
+	bool Open(
+		const char* cacheFile,
+		const TERRAIN_SETTINGS& settings,
+		int heightUnit,
+		JobSystem* pJobSystem);
+	// free the tile cache and the grid
+	void Close();
+
+	// upload the tiles loaded since the last frame, then choose the
+	// nodes to draw for the camera and start loading the missing tiles
+	void Update(glm::vec3 cameraPosition, const glm::mat4& viewProjection);
+	// set the views the camera is predicted to reach, soonest first,
+	// walked by every update until they are set again
+	void SetPredictedViews(const std::vector<TERRAIN_PREDICTED_VIEW>& views);
+	// bind the tile cache to its texture unit
+	void Bind() const;
+	// draw the chosen nodes
+	void Draw();
+
+	// true once a cache file was opened
+	bool IsReady() const { return(m_gridVertexArray != 0); }
+	const TERRAIN_SETTINGS& GetSettings() const { return(m_settings); }
+	// get the lowest and highest height of the terrain
+	glm::vec2 GetHeightRange() const { return(glm::vec2(m_minHeight, m_maxHeight)); }
+	// get the box around the chosen nodes
+	glm::vec3 GetBoundsMin() const { return(m_boundsMin); }
+	glm::vec3 GetBoundsMax() const { return(m_boundsMax); }
+	// get the nodes drawn and culled in the last update
+	int GetDrawnCount() const { return(static_cast<int>(m_nodes.size())); }
+	int GetCulledCount() const { return(m_culledCount); }
+	// get the number of tiles resident in the cache
+	int GetResidentCount() const;
+	// get the nodes drawn in the last update in place of finer nodes
+	// whose tiles were not resident yet
+	int GetPlaceholderCount() const { return(m_placeholderCount); }
+	// take the number of tiles loaded for a predicted view that were
+	// drawn since the last call, and of those evicted without being drawn
+	void TakePrefetchCounts(int& usedCount, int& wastedCount);
+
+	// get the number of nodes along each side of a level
+	int GetNodeCount(int level) const { return(1 << (m_levelCount - 1 - level)); }
+	// get the box around a node
+	void GetNodeBounds(int level, int nodeX, int nodeZ, glm::vec3& boundsMin, glm::vec3& boundsMax) const;
+	// read the samples of one tile from the cache file, from any thread
+	bool ReadTile(int level, int nodeX, int nodeZ, std::vector<uint16_t>& samples) const;
+
+private:
+	// a tile loaded by a worker, waiting to be uploaded
+	struct LOADED_TILE
+	{
+		int level;
+		int nodeX;
+		int nodeZ;
+		// zero for a tile needed now, the number of the predicted
+		// view that asked for it otherwise
+		int priority;
+		std::vector<uint16_t> samples;
+	};
+
+	// one layer of the tile cache
+	struct CACHE_SLOT
+	{
+		// node held by the slot, level is -1 while the slot is free
+		int level;
+		int nodeX;
+		int nodeZ;
+		// last frame the walk of the quadtree passed the node
+		int lastUsedFrame;
+		// true while a tile loaded for a predicted view was not drawn
+		bool bPrefetched;
+	};
+
+	// a chosen node as read by the vertex shader, its corner, side
+	// and cache slot, then the distances its vertices morph between
+	struct NODE_INSTANCE
+	{
+		glm::vec4 placement;
+		glm::vec4 morph;
+	};
+
+	TERRAIN_SETTINGS m_settings;
+	std::string m_cacheFile;
+	JobSystem* m_pJobSystem;
+
+	// layout of the cooked cache file
+	int m_levelCount;
+	int m_gridResolution;
+	float m_minHeight;
+	float m_maxHeight;
+	// offset of the first tile of each level in the cache file
+	std::vector<uint64_t> m_levelOffsets;
+	// lowest and highest sample under every node of every level
+	std::vector<std::vector<uint16_t>> m_nodeHeights;
+	// split and morph distances of every level
+	std::vector<float> m_ranges;
+	std::vector<float> m_morphStarts;
+
+	// GPU tile cache and the texture unit it is bound to
+	GLuint m_heightTexture;
+	int m_heightUnit;
+
+	// cache slot of every node of every level, -1 when not resident
+	std::vector<std::vector<int>> m_residentSlots;
+	// true for tiles being loaded by a worker
+	std::vector<std::vector<bool>> m_pendingTiles;
+	// cache slots
+	std::vector<CACHE_SLOT> m_slots;
+	// tiles of the nodes waiting to split, as level, x, z and the
+	// priority of the tile
+	std::vector<glm::ivec4> m_requests;
+	// views the camera is predicted to reach, soonest first
+	std::vector<TERRAIN_PREDICTED_VIEW> m_predictedViews;
+	int m_frame;
+
+	// tiles handed back by the workers
+	std::vector<LOADED_TILE> m_loadedTiles;
+	std::mutex m_loadedMutex;
+	// number of tile loads still running on the workers
+	std::atomic<int> m_loadsInFlight;
+
+	// one grid over the unit square, and the chosen nodes
+	GLuint m_gridVertexArray;
+	GLuint m_gridVertexBuffer;
+	GLuint m_gridIndexBuffer;
+	GLuint m_instanceBuffer;
+	int m_gridIndexCount;
+	size_t m_instanceCapacity;
+	std::vector<NODE_INSTANCE> m_nodes;
+	int m_culledCount;
+	int m_placeholderCount;
+	// prefetched tiles drawn and evicted since they were last taken
+	int m_prefetchUsedCount;
+	int m_prefetchWastedCount;
+	glm::vec3 m_boundsMin;
+	glm::vec3 m_boundsMax;
+
+	// view of the last update, six planes facing inward
+	glm::vec4 m_frustumPlanes[6];
+	glm::vec3 m_cameraPosition;
+
+	// true when any part of the box may be inside the view of the
+	// passed in six planes
+	bool IsInView(const glm::vec4* planes, glm::vec3 boundsMin, glm::vec3 boundsMax) const;
+	// draw a node, or its children when the camera is close enough
+	// and their tiles are resident
+	void SelectNode(int level, int nodeX, int nodeZ);
+	// request the tile of a node in a predicted view, and those of its
+	// children when the predicted camera is close enough
+	void PrefetchNode(int level, int nodeX, int nodeZ, const glm::vec4* planes, glm::vec3 cameraPosition, int priority);
+	// queue the tile of a node for loading unless it is resident
+	bool RequestTile(int level, int nodeX, int nodeZ, int priority);
+	// copy a loaded tile into a cache slot, evicting the stalest node
+	bool UploadTile(const LOADED_TILE& tile);
+};
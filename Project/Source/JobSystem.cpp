@@ -0,0 +1,206 @@
+///////////////////////////////////////////////////////////////////////////////
+// jobsystem.cpp
+// ============
+// manage a pool of worker threads for spreading scene work across all cores
+///////////////////////////////////////////////////////////////////////////////
+
+#include "JobSystem.h"
+
+/***********************************************************
+ *  JobSystem()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+JobSystem::JobSystem(unsigned int workerCount)
+{
+	m_bShutdown = false;
+
+	// leave one core for the thread that owns the OpenGL context
+	if (workerCount == 0)
+	{
+		unsigned int coreCount = std::thread::hardware_concurrency();
+		workerCount = (coreCount > 1) ? (coreCount - 1) : 1;
+	}
+
+	for (unsigned int i = 0; i < workerCount; i++)
+	{
+		m_workers.emplace_back(&JobSystem::WorkerLoop, this);
+	}
+}
+
+/***********************************************************
+ *  ~JobSystem()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+		m_bShutdown = true;
+	}
+	m_queueCondition.notify_all();
+
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+}
+
+/***********************************************************
+ *  WorkerLoop()
+ *
+ *  This method is run by every worker thread, waiting for
+ *  queued jobs until the pool is shut down.  The ranges of
+ *  parallel loops go before the background jobs, since a
+ *  thread is waiting on them.
+ ***********************************************************/
+void JobSystem::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(m_queueMutex);
+			m_queueCondition.wait(lock, [this]
+				{
+					return m_bShutdown || !m_jobs.empty() || !m_backgroundJobs.empty();
+				});
+			if (m_jobs.empty() == false)
+			{
+				job = std::move(m_jobs.front());
+				m_jobs.pop_front();
+			}
+			else if (m_backgroundJobs.empty() == false)
+			{
+				job = std::move(m_backgroundJobs.front());
+				m_backgroundJobs.pop_front();
+			}
+			else
+			{
+				return;
+			}
+		}
+		job();
+	}
+}
+
+/***********************************************************
+ *  RunBatchRange()
+ *
+ *  This method is used for claiming the next range of a
+ *  parallel loop and running it.  A worker whose job comes
+ *  up after the ranges ran out finds nothing to claim, and
+ *  the loop function is only called while the thread that
+ *  started the loop still waits for the claimed range.
+ ***********************************************************/
+bool JobSystem::RunBatchRange(PARALLEL_BATCH& batch)
+{
+	size_t range = batch.nextRange.fetch_add(1, std::memory_order_relaxed);
+	if (range >= batch.rangeCount)
+	{
+		return(false);
+	}
+
+	size_t begin = range * batch.rangeSize;
+	size_t end = (begin + batch.rangeSize < batch.count) ? (begin + batch.rangeSize) : batch.count;
+	(*batch.pFunc)(begin, end);
+	batch.remaining.fetch_sub(1, std::memory_order_release);
+	return(true);
+}
+
+/***********************************************************
+ *  ParallelFor()
+ *
+ *  This method is used for splitting a loop into ranges
+ *  that are run across the worker threads.  It returns once
+ *  every range has completed.  The calling thread claims
+ *  ranges of this loop alone, never a queued background
+ *  job or a range of another loop.
+ ***********************************************************/
+void JobSystem::ParallelFor(
+	size_t count,
+	size_t grainSize,
+	const std::function<void(size_t begin, size_t end)>& func)
+{
+	if (count == 0)
+	{
+		return;
+	}
+	if (grainSize == 0)
+	{
+		grainSize = 1;
+	}
+
+	// aim for a few ranges per thread so uneven work balances out
+	size_t threadCount = m_workers.size() + 1;
+	size_t rangeSize = (count + (threadCount * 4) - 1) / (threadCount * 4);
+	if (rangeSize < grainSize)
+	{
+		rangeSize = grainSize;
+	}
+	size_t rangeCount = (count + rangeSize - 1) / rangeSize;
+
+	// small loops are not worth the hand-off to the workers
+	if (rangeCount == 1)
+	{
+		func(0, count);
+		return;
+	}
+
+	// shared with the queued jobs, which may outlive this call when
+	// the ranges ran out before a worker got to them
+	std::shared_ptr<PARALLEL_BATCH> batch = std::make_shared<PARALLEL_BATCH>();
+	batch->pFunc = &func;
+	batch->count = count;
+	batch->rangeSize = rangeSize;
+	batch->rangeCount = rangeCount;
+	batch->nextRange = 0;
+	batch->remaining = rangeCount;
+	{
+		// the calling thread takes one range itself
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+		for (size_t i = 1; i < rangeCount; i++)
+		{
+			m_jobs.push_back([batch]() { RunBatchRange(*batch); });
+		}
+	}
+	m_queueCondition.notify_all();
+
+	// help out with this loop, then wait for the ranges still running
+	while (RunBatchRange(*batch))
+	{
+	}
+	while (batch->remaining.load(std::memory_order_acquire) > 0)
+	{
+		std::this_thread::yield();
+	}
+}
+
+/***********************************************************
+ *  Submit()
+ *
+ *  This method is used for queuing a job that runs in the
+ *  background.  Only the workers run it, after any waiting
+ *  ranges of parallel loops.  Jobs still queued when the
+ *  pool is destroyed are run before the workers exit.
+ ***********************************************************/
+void JobSystem::Submit(const std::function<void()>& job)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+		m_backgroundJobs.push_back(job);
+	}
+	m_queueCondition.notify_one();
+}
+
+/***********************************************************
+ *  GetWorkerCount()
+ *
+ *  This method is used for getting the number of worker
+ *  threads owned by the pool.
+ ***********************************************************/
+unsigned int JobSystem::GetWorkerCount() const
+{
+	return(static_cast<unsigned int>(m_workers.size()));
+}
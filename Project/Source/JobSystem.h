@@ -0,0 +1,83 @@
+///////////////////////////////////////////////////////////////////////////////
+// jobsystem.h
+// ============
+// manage a pool of worker threads for spreading scene work across all cores
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  JobSystem
+ *
+ *  This class owns one worker thread per hardware core and
+ *  runs queued jobs on them.  The calling thread takes part
+ *  in the work while waiting, so a parallel loop never sits
+ *  idle on the thread that started it, but it only takes
+ *  ranges of its own loop.  Background jobs wait in a queue
+ *  of their own that the workers turn to once no loop has
+ *  ranges left, so a slow read or decode never lands on the
+ *  render thread in the middle of a frame.
+ ***********************************************************/
+class JobSystem
+{
+public:
+	// constructor - zero workers means one per hardware core
+	JobSystem(unsigned int workerCount = 0);
+	// destructor
+	~JobSystem();
+
+	// run the passed in function over [0, count) split into
+	// ranges of at least grainSize items, and wait for all of them
+	void ParallelFor(
+		size_t count,
+		size_t grainSize,
+		const std::function<void(size_t begin, size_t end)>& func);
+
+	// queue a job to run on a worker without waiting for it
+	void Submit(const std::function<void()>& job);
+
+	// get the number of worker threads in the pool
+	unsigned int GetWorkerCount() const;
+
+private:
+	// ranges of a parallel loop, claimed in order by the thread that
+	// started it and by the workers
+	struct PARALLEL_BATCH
+	{
+		const std::function<void(size_t begin, size_t end)>* pFunc;
+		size_t count;
+		size_t rangeSize;
+		size_t rangeCount;
+		std::atomic<size_t> nextRange;
+		std::atomic<size_t> remaining;
+	};
+
+	// worker threads owned by the pool
+	std::vector<std::thread> m_workers;
+	// ranges of parallel loops waiting to be picked up by a worker
+	std::deque<std::function<void()>> m_jobs;
+	// background jobs, picked up once no ranges are waiting
+	std::deque<std::function<void()>> m_backgroundJobs;
+	// guards the job queue
+	std::mutex m_queueMutex;
+	// signalled when a job is queued or the pool shuts down
+	std::condition_variable m_queueCondition;
+	// set when the pool is being destroyed
+	bool m_bShutdown;
+
+	// the loop executed by each worker thread
+	void WorkerLoop();
+	// claim and run the next range of a loop, returns false once every
+	// range was claimed
+	static bool RunBatchRange(PARALLEL_BATCH& batch);
+};
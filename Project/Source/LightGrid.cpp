@@ -0,0 +1,290 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightgrid.cpp
+// ============
+// uniform grid over point light influence spheres for per-object light lists
+///////////////////////////////////////////////////////////////////////////////
+
+#include "LightGrid.h"
+
+#include <cfloat>
+#include <climits>
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	// lights reaching across more cells than this from their center
+	// are tested directly, since registering them would fill
+	// thousands of cells for a handful of lights
+	const float MAX_REGISTERED_CELL_SPAN = 8.0f;
+}
+
+/***********************************************************
+ *  LightGrid()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+LightGrid::LightGrid()
+{
+	m_cellSize = 1.0f;
+	m_firstCell = glm::ivec3(INT_MAX);
+	m_lastCell = glm::ivec3(INT_MIN);
+	m_currentStamp = 0;
+}
+
+/***********************************************************
+ *  MakeCellKey()
+ *
+ *  This method is used for packing three signed 21-bit cell
+ *  coordinates into one hash key.
+ ***********************************************************/
+uint64_t LightGrid::MakeCellKey(int x, int y, int z)
+{
+	const uint64_t mask = 0x1FFFFF;
+	return(((static_cast<uint64_t>(x) & mask) << 42) |
+		((static_cast<uint64_t>(y) & mask) << 21) |
+		(static_cast<uint64_t>(z) & mask));
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method is used for registering every light in each
+ *  grid cell that its sphere of influence overlaps.  The
+ *  grid is kept as it is while the lights do not change,
+ *  which is every frame of a scene with static lights.
+ ***********************************************************/
+void LightGrid::Build(
+	const std::vector<glm::vec3>& positions,
+	const std::vector<float>& ranges,
+	float cellSize)
+{
+	if ((m_cellSize == cellSize) && (m_positions == positions) && (m_ranges == ranges))
+	{
+		return;
+	}
+
+	m_cellSize = cellSize;
+	m_positions = positions;
+	m_ranges = ranges;
+	m_cells.clear();
+	m_firstCell = glm::ivec3(INT_MAX);
+	m_lastCell = glm::ivec3(INT_MIN);
+	m_directLights.clear();
+
+	if (m_queryStamps.size() != positions.size())
+	{
+		m_queryStamps.assign(positions.size(), 0);
+		m_currentStamp = 0;
+	}
+
+	for (int light = 0; light < positions.size(); light++)
+	{
+		float range = ranges[light];
+		if ((range / m_cellSize) > MAX_REGISTERED_CELL_SPAN)
+		{
+			m_directLights.push_back(light);
+			continue;
+		}
+
+		glm::ivec3 firstCell = glm::ivec3(glm::floor((positions[light] - range) / m_cellSize));
+		glm::ivec3 lastCell = glm::ivec3(glm::floor((positions[light] + range) / m_cellSize));
+		m_firstCell = glm::min(m_firstCell, firstCell);
+		m_lastCell = glm::max(m_lastCell, lastCell);
+		for (int z = firstCell.z; z <= lastCell.z; z++)
+		{
+			for (int y = firstCell.y; y <= lastCell.y; y++)
+			{
+				for (int x = firstCell.x; x <= lastCell.x; x++)
+				{
+					m_cells[MakeCellKey(x, y, z)].push_back(light);
+				}
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  BeginQuery()
+ *
+ *  This method is used for advancing the query stamp, so no
+ *  light counts as reported by an earlier query.
+ ***********************************************************/
+void LightGrid::BeginQuery()
+{
+	m_currentStamp++;
+	if (m_currentStamp == 0)
+	{
+		m_queryStamps.assign(m_queryStamps.size(), 0);
+		m_currentStamp = 1;
+	}
+}
+
+/***********************************************************
+ *  TouchesBounds()
+ *
+ *  This method is used for the exact test of a light sphere
+ *  against a box, by the distance from the light to the
+ *  closest point of the box.  Unbounded lights always pass.
+ ***********************************************************/
+bool LightGrid::TouchesBounds(int light, glm::vec3 boundsMin, glm::vec3 boundsMax) const
+{
+	if (m_ranges[light] >= FLT_MAX)
+	{
+		return(true);
+	}
+
+	glm::vec3 closest = glm::clamp(m_positions[light], boundsMin, boundsMax);
+	glm::vec3 offset = m_positions[light] - closest;
+	return(glm::dot(offset, offset) <= (m_ranges[light] * m_ranges[light]));
+}
+
+/***********************************************************
+ *  AddLight()
+ *
+ *  This method is used for appending a light to the query
+ *  output unless it was already reported by another cell.
+ ***********************************************************/
+bool LightGrid::AddLight(int light, int* lightIndices, int& count, int maxLights)
+{
+	if (m_queryStamps[light] == m_currentStamp)
+	{
+		return(count < maxLights);
+	}
+	m_queryStamps[light] = m_currentStamp;
+
+	lightIndices[count++] = light;
+	return(count < maxLights);
+}
+
+/***********************************************************
+ *  QueryBounds()
+ *
+ *  This method is used for finding the lights that affect
+ *  the passed in world bounds.  Candidates come from the
+ *  overlapped grid cells, limited to the cells the lights
+ *  were registered in, and are then tested exactly.  When
+ *  that still leaves more cells than there are lights, the
+ *  lights are tested directly instead.
+ ***********************************************************/
+int LightGrid::QueryBounds(
+	glm::vec3 boundsMin,
+	glm::vec3 boundsMax,
+	int* lightIndices,
+	int maxLights)
+{
+	int count = 0;
+	if ((maxLights <= 0) || (m_positions.size() == 0))
+	{
+		return(0);
+	}
+
+	BeginQuery();
+
+	for (int i = 0; i < m_directLights.size(); i++)
+	{
+		int light = m_directLights[i];
+		if ((TouchesBounds(light, boundsMin, boundsMax) == true) &&
+			(AddLight(light, lightIndices, count, maxLights) == false))
+		{
+			return(count);
+		}
+	}
+
+	if (m_firstCell.x > m_lastCell.x)
+	{
+		return(count);
+	}
+
+	// only the cells the lights were registered in can hold any
+	glm::vec3 registeredMin = glm::vec3(m_firstCell) - 1.0f;
+	glm::vec3 registeredMax = glm::vec3(m_lastCell) + 1.0f;
+	glm::ivec3 firstCell = glm::ivec3(glm::clamp(glm::floor(boundsMin / m_cellSize), registeredMin, registeredMax));
+	glm::ivec3 lastCell = glm::ivec3(glm::clamp(glm::floor(boundsMax / m_cellSize), registeredMin, registeredMax));
+	firstCell = glm::max(firstCell, m_firstCell);
+	lastCell = glm::min(lastCell, m_lastCell);
+	if ((firstCell.x > lastCell.x) || (firstCell.y > lastCell.y) || (firstCell.z > lastCell.z))
+	{
+		return(count);
+	}
+
+	glm::dvec3 cellSpan = glm::dvec3(lastCell - firstCell) + 1.0;
+	if ((cellSpan.x * cellSpan.y * cellSpan.z) > static_cast<double>(m_positions.size()))
+	{
+		for (int light = 0; light < m_positions.size(); light++)
+		{
+			if ((TouchesBounds(light, boundsMin, boundsMax) == true) &&
+				(AddLight(light, lightIndices, count, maxLights) == false))
+			{
+				return(count);
+			}
+		}
+		return(count);
+	}
+
+	for (int z = firstCell.z; z <= lastCell.z; z++)
+	{
+		for (int y = firstCell.y; y <= lastCell.y; y++)
+		{
+			for (int x = firstCell.x; x <= lastCell.x; x++)
+			{
+				auto cell = m_cells.find(MakeCellKey(x, y, z));
+				if (cell == m_cells.end())
+				{
+					continue;
+				}
+
+				for (int i = 0; i < cell->second.size(); i++)
+				{
+					int light = cell->second[i];
+					if ((m_queryStamps[light] == m_currentStamp) ||
+						(TouchesBounds(light, boundsMin, boundsMax) == false))
+					{
+						continue;
+					}
+
+					if (AddLight(light, lightIndices, count, maxLights) == false)
+					{
+						return(count);
+					}
+				}
+			}
+		}
+	}
+
+	return(count);
+}
+
+/***********************************************************
+ *  QueryBoundsDirect()
+ *
+ *  This method is used for finding the lights that affect
+ *  the passed in world bounds by testing every light sphere,
+ *  which for bounds across a large part of the scene costs
+ *  less than even looking at the cells they cover.
+ ***********************************************************/
+int LightGrid::QueryBoundsDirect(
+	glm::vec3 boundsMin,
+	glm::vec3 boundsMax,
+	int* lightIndices,
+	int maxLights)
+{
+	int count = 0;
+	if ((maxLights <= 0) || (m_positions.size() == 0))
+	{
+		return(0);
+	}
+
+	BeginQuery();
+
+	for (int light = 0; light < m_positions.size(); light++)
+	{
+		if ((TouchesBounds(light, boundsMin, boundsMax) == true) &&
+			(AddLight(light, lightIndices, count, maxLights) == false))
+		{
+			return(count);
+		}
+	}
+
+	return(count);
+}
@@ -0,0 +1,80 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightgrid.h
+// ============
+// uniform grid over point light influence spheres for per-object light lists
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/***********************************************************
+ *  LightGrid
+ *
+ *  This class sorts point lights into the cells of a uniform
+ *  grid by their sphere of influence.  Querying with an
+ *  object's bounds only visits the lights registered in the
+ *  cells that the bounds overlap.  Lights spanning many
+ *  cells and bounds covering more cells than there are
+ *  lights are tested against the light spheres directly.
+ ***********************************************************/
+class LightGrid
+{
+public:
+	// constructor
+	LightGrid();
+
+	// rebuild the grid from the light spheres, unless they are the
+	// same as in the last build, lights too large for the cells are
+	// tested directly by every query
+	void Build(
+		const std::vector<glm::vec3>& positions,
+		const std::vector<float>& ranges,
+		float cellSize);
+
+	// write the indices of the lights whose sphere touches the
+	// bounds, up to maxLights of them, returning how many were written
+	int QueryBounds(
+		glm::vec3 boundsMin,
+		glm::vec3 boundsMax,
+		int* lightIndices,
+		int maxLights);
+	// same as QueryBounds() but testing every light sphere without
+	// the cells, for bounds that cover a large part of the scene
+	int QueryBoundsDirect(
+		glm::vec3 boundsMin,
+		glm::vec3 boundsMax,
+		int* lightIndices,
+		int maxLights);
+
+private:
+	// world size of a grid cell
+	float m_cellSize;
+	// light spheres copied from the last build
+	std::vector<glm::vec3> m_positions;
+	std::vector<float> m_ranges;
+	// lights registered in each occupied cell
+	std::unordered_map<uint64_t, std::vector<int>> m_cells;
+	// cell range covered by the registered lights, empty when the
+	// first cell is past the last
+	glm::ivec3 m_firstCell;
+	glm::ivec3 m_lastCell;
+	// lights too large for the cells, tested by every query
+	std::vector<int> m_directLights;
+	// per light query stamp, so a light found in several cells is reported once
+	std::vector<uint32_t> m_queryStamps;
+	uint32_t m_currentStamp;
+
+	// pack integer cell coordinates into a single key
+	static uint64_t MakeCellKey(int x, int y, int z);
+	// start a query, invalidating the reported flags of the last one
+	void BeginQuery();
+	// true when the sphere of the light touches the bounds
+	bool TouchesBounds(int light, glm::vec3 boundsMin, glm::vec3 boundsMax) const;
+	// add a light to the output if not already reported this query
+	bool AddLight(int light, int* lightIndices, int& count, int maxLights);
+};
@@ -9,6 +9,11 @@
 
 #include <iostream>         // error handling and output
 #include <cstdlib>          // EXIT_FAILURE
+#include <cstring>          // strcmp
+#include <algorithm>        // std::sort
+#include <filesystem>       // scene layout folder
+#include <string>
+#include <vector>
 
 #include <GL/glew.h>        // GLEW library
 #include "GLFW/glfw3.h"     // GLFW library
@@ -39,6 +44,15 @@ namespace
 	ShaderManager* g_ShaderManager = nullptr;
 	// view manager object for managing the 3D view setup and projection to 2D
 	ViewManager* g_ViewManager = nullptr;
+
+	// shader source files, watched for edits while running
+	const char* const VERTEX_SHADER_FILE = "shaders/vertexShader.glsl";
+	const char* const FRAGMENT_SHADER_FILE = "shaders/fragmentShader.glsl";
+
+	// snapshot images saved with the F5 key and copied here are the
+	// scene layouts cycled through with the F6 key
+	const char* const SCENE_LAYOUT_FOLDER = "scene/layouts";
+	const char* const SCENE_LAYOUT_EXTENSION = ".snapshot";
 }
 
 // Function declarations - all functions that are called manually
@@ -55,6 +69,46 @@ bool InitializeGLEW();
  ***********************************************************/
 int main(int argc, char* argv[])
 {
+	// time the lake wave transforms and exit when started with
+	// --benchmark-water, before any window is opened
+	if ((argc > 1) && (strcmp(argv[1], "--benchmark-water") == 0))
+	{
+		WaterSurface::Benchmark();
+		return(EXIT_SUCCESS);
+	}
+
+	// time dropping thousands of rigid body props and exit when
+	// started with --benchmark-physics
+	if ((argc > 1) && (strcmp(argv[1], "--benchmark-physics") == 0))
+	{
+		RigidBodySimulation::Benchmark();
+		return(EXIT_SUCCESS);
+	}
+
+	// time a hundred thousand keyframed channels and exit when
+	// started with --benchmark-animation
+	if ((argc > 1) && (strcmp(argv[1], "--benchmark-animation") == 0))
+	{
+		AnimationSystem::Benchmark();
+		return(EXIT_SUCCESS);
+	}
+
+	// time the flocking of a hundred thousand boids and exit when
+	// started with --benchmark-boids
+	if ((argc > 1) && (strcmp(argv[1], "--benchmark-boids") == 0))
+	{
+		BoidSimulation::Benchmark();
+		return(EXIT_SUCCESS);
+	}
+
+	// time a burst of edits through the scene edit socket and exit
+	// when started with --benchmark-edits
+	if ((argc > 1) && (strcmp(argv[1], "--benchmark-edits") == 0))
+	{
+		EditServer::Benchmark();
+		return(EXIT_SUCCESS);
+	}
+
 	// if GLFW fails initialization, then terminate the application
 	if (InitializeGLFW() == false)
 	{
@@ -78,13 +132,51 @@ int main(int argc, char* argv[])
 
 	// load the shader code from the external GLSL files
 	g_ShaderManager->LoadShaders(
-		"shaders/vertexShader.glsl",
-		"shaders/fragmentShader.glsl");
+		VERTEX_SHADER_FILE,
+		FRAGMENT_SHADER_FILE);
 	g_ShaderManager->use();
 
-	// try to create a new scene manager object and prepare the 3D scene
+	// try to create a new scene manager object and prepare the 3D scene,
+	// from the last saved snapshot when started with --restore
 	g_SceneManager = new SceneManager(g_ShaderManager);
-	g_SceneManager->PrepareScene();
+	SNAPSHOT_CAMERA snapshotCamera;
+	if ((argc > 1) && (strcmp(argv[1], "--restore") == 0) &&
+		(g_SceneManager->RestoreScene(snapshotCamera) == true))
+	{
+		g_ViewManager->SetCameraSnapshot(snapshotCamera);
+	}
+	else
+	{
+		g_SceneManager->PrepareScene();
+	}
+
+	// pick up edits to the shaders, textures and scene settings
+	// file while the scene is running
+	g_SceneManager->EnableHotReload(VERTEX_SHADER_FILE, FRAGMENT_SHADER_FILE);
+	g_SceneManager->EnableLiveEditing();
+
+	// create the textures of the preloaded scenes on a second context
+	// so their uploads stay off the render thread
+	g_SceneManager->EnableBackgroundUploads(g_Window);
+
+	// load the first scene layout in the background, ready for the
+	// first switch
+	std::vector<std::string> sceneLayouts;
+	std::error_code layoutError;
+	for (std::filesystem::directory_iterator entry(SCENE_LAYOUT_FOLDER, layoutError), end;
+		(layoutError.value() == 0) && (entry != end); entry.increment(layoutError))
+	{
+		if (entry->path().extension() == SCENE_LAYOUT_EXTENSION)
+		{
+			sceneLayouts.push_back(entry->path().string());
+		}
+	}
+	std::sort(sceneLayouts.begin(), sceneLayouts.end());
+	size_t nextSceneLayout = 0;
+	if (sceneLayouts.size() > 0)
+	{
+		g_SceneManager->PreloadScene(sceneLayouts[nextSceneLayout].c_str());
+	}
 
 	// loop will keep running until the application is closed 
 	// or until an error has occurred
@@ -101,8 +193,54 @@ int main(int argc, char* argv[])
 		g_ViewManager->PrepareSceneView();
 
 		// refresh the 3D scene
+		g_SceneManager->UpdateHotReload();
+		g_SceneManager->UpdateLiveEdits();
+		g_SceneManager->UpdateAnimations();
+		g_SceneManager->SetBoidComputeEnabled(g_ViewManager->IsBoidComputeEnabled());
+		g_SceneManager->UpdateFishSchools();
+		g_SceneManager->SetLakeEnabled(g_ViewManager->IsLakeEnabled());
+		g_SceneManager->UpdateLake();
+		g_SceneManager->SetTackleDisplayEnabled(g_ViewManager->IsTackleDisplayEnabled());
+		g_SceneManager->UpdateFishingLines();
+		g_SceneManager->SetPhysicsEnabled(g_ViewManager->IsPhysicsEnabled());
+		if (g_ViewManager->IsBobberThrowRequested())
+		{
+			g_SceneManager->ThrowBobber();
+		}
+		g_SceneManager->UpdateRigidBodies();
+		g_SceneManager->UpdateTasks();
+		if ((g_ViewManager->IsSceneSwitchRequested()) && (sceneLayouts.size() > 0) &&
+			(g_SceneManager->SwitchToPreloadedScene(snapshotCamera) == true))
+		{
+			g_ViewManager->SetCameraSnapshot(snapshotCamera);
+			g_ViewManager->ClearSceneSwitchRequest();
+			nextSceneLayout = (nextSceneLayout + 1) % sceneLayouts.size();
+			g_SceneManager->PreloadScene(sceneLayouts[nextSceneLayout].c_str());
+		}
+		g_SceneManager->SetCameraPosition(g_ViewManager->GetCameraPosition());
+		g_SceneManager->SetViewProjection(g_ViewManager->GetViewMatrix(), g_ViewManager->GetProjectionMatrix());
+		g_SceneManager->SetTerrainEnabled(g_ViewManager->IsTerrainEnabled());
+		g_SceneManager->SetPrefetchEnabled(g_ViewManager->IsPrefetchEnabled());
+		g_SceneManager->UpdateTerrain();
+		g_SceneManager->SetFoliageEnabled(g_ViewManager->IsFoliageEnabled());
+		g_SceneManager->UpdateFoliage();
+		g_SceneManager->SetSkyEnabled(g_ViewManager->IsSkyEnabled());
+		g_SceneManager->UpdateSky();
+		g_SceneManager->SetReflectionsEnabled(g_ViewManager->IsReflectionsEnabled());
+		g_SceneManager->SetLinearMarchEnabled(g_ViewManager->IsLinearMarchEnabled());
+		g_SceneManager->UpdateReflections();
+		g_SceneManager->SetDepthPrepassEnabled(g_ViewManager->IsDepthPrepassEnabled());
+		g_SceneManager->SetShadingTierDebug(g_ViewManager->IsShadingTierDebugEnabled());
+		g_SceneManager->SetAquariumEnabled(g_ViewManager->IsAquariumEnabled());
 		g_SceneManager->RenderScene();
 
+		// save the scene state when the snapshot key was pressed
+		if (g_ViewManager->IsSnapshotRequested())
+		{
+			g_ViewManager->GetCameraSnapshot(snapshotCamera);
+			g_SceneManager->SaveSnapshot(snapshotCamera);
+		}
+
 
 		// Flips the the back buffer with the front buffer every frame.
 		glfwSwapBuffers(g_Window);
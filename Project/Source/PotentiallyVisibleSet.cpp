@@ -0,0 +1,593 @@
+///////////////////////////////////////////////////////////////////////////////
+// potentiallyvisibleset.cpp
+// ============
+// bake and query per view cell visibility of the static scene objects
+///////////////////////////////////////////////////////////////////////////////
+
+#include "PotentiallyVisibleSet.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// identifies a baked PVS cache file and its layout version
+	const uint32_t PVS_FILE_MAGIC = 0x31535650; // "PVS1"
+	const uint32_t PVS_FILE_VERSION = 1;
+
+	// a segment must clear this much of its length at either end
+	// before an occluder counts as blocking it
+	const float SEGMENT_EPSILON = 0.001f;
+
+	// occluder prepared for segment tests in its own local space
+	struct OCCLUDER
+	{
+		int objectIndex;
+		glm::mat4 worldToLocal;
+		glm::vec3 localMin;
+		glm::vec3 localMax;
+	};
+
+	/***********************************************************
+	 *  SegmentHitsBox()
+	 *
+	 *  Slab test of the segment from start to end against an
+	 *  axis aligned box, ignoring hits right at the endpoints.
+	 ***********************************************************/
+	bool SegmentHitsBox(glm::vec3 start, glm::vec3 end, glm::vec3 boxMin, glm::vec3 boxMax)
+	{
+		glm::vec3 direction = end - start;
+		float tNear = SEGMENT_EPSILON;
+		float tFar = 1.0f - SEGMENT_EPSILON;
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			if (std::fabs(direction[axis]) < 1e-8f)
+			{
+				// parallel to this slab, so it must start inside it
+				if ((start[axis] < boxMin[axis]) || (start[axis] > boxMax[axis]))
+				{
+					return(false);
+				}
+			}
+			else
+			{
+				float inverse = 1.0f / direction[axis];
+				float t0 = (boxMin[axis] - start[axis]) * inverse;
+				float t1 = (boxMax[axis] - start[axis]) * inverse;
+				if (t0 > t1)
+				{
+					float swap = t0;
+					t0 = t1;
+					t1 = swap;
+				}
+				tNear = (t0 > tNear) ? t0 : tNear;
+				tFar = (t1 < tFar) ? t1 : tFar;
+				if (tNear > tFar)
+				{
+					return(false);
+				}
+			}
+		}
+
+		return(true);
+	}
+
+	/***********************************************************
+	 *  IsPointInsideBox()
+	 *
+	 *  Test whether a local space point is within the box.
+	 ***********************************************************/
+	bool IsPointInsideBox(glm::vec3 point, glm::vec3 boxMin, glm::vec3 boxMax)
+	{
+		return((point.x > boxMin.x) && (point.x < boxMax.x) &&
+			(point.y > boxMin.y) && (point.y < boxMax.y) &&
+			(point.z > boxMin.z) && (point.z < boxMax.z));
+	}
+
+	/***********************************************************
+	 *  CompressRunLength()
+	 *
+	 *  PackBits style run-length encoding.  Neighbouring cells
+	 *  mostly share their visible sets, so the byte stream is
+	 *  dominated by long runs.
+	 ***********************************************************/
+	std::vector<uint8_t> CompressRunLength(const uint8_t* data, size_t size)
+	{
+		std::vector<uint8_t> packed;
+		size_t index = 0;
+
+		while (index < size)
+		{
+			// measure the run of repeated bytes starting here
+			size_t run = 1;
+			while ((index + run < size) && (run < 128) && (data[index + run] == data[index]))
+			{
+				run++;
+			}
+
+			if (run >= 2)
+			{
+				packed.push_back(static_cast<uint8_t>(257 - run));
+				packed.push_back(data[index]);
+				index += run;
+			}
+			else
+			{
+				// gather literal bytes until the next repeated pair
+				size_t literal = 1;
+				while ((index + literal < size) && (literal < 128) &&
+					!((index + literal + 1 < size) && (data[index + literal] == data[index + literal + 1])))
+				{
+					literal++;
+				}
+				packed.push_back(static_cast<uint8_t>(literal - 1));
+				packed.insert(packed.end(), data + index, data + index + literal);
+				index += literal;
+			}
+		}
+
+		return(packed);
+	}
+
+	/***********************************************************
+	 *  DecompressRunLength()
+	 *
+	 *  Expand a PackBits stream into exactly size bytes.
+	 ***********************************************************/
+	bool DecompressRunLength(const std::vector<uint8_t>& packed, uint8_t* data, size_t size)
+	{
+		size_t input = 0;
+		size_t output = 0;
+
+		while ((input < packed.size()) && (output < size))
+		{
+			uint8_t header = packed[input++];
+			if (header < 128)
+			{
+				size_t literal = static_cast<size_t>(header) + 1;
+				if ((input + literal > packed.size()) || (output + literal > size))
+				{
+					return(false);
+				}
+				memcpy(data + output, &packed[input], literal);
+				input += literal;
+				output += literal;
+			}
+			else
+			{
+				size_t run = 257 - static_cast<size_t>(header);
+				if ((input >= packed.size()) || (output + run > size))
+				{
+					return(false);
+				}
+				memset(data + output, packed[input++], run);
+				output += run;
+			}
+		}
+
+		return(output == size);
+	}
+}
+
+/***********************************************************
+ *  PotentiallyVisibleSet()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+PotentiallyVisibleSet::PotentiallyVisibleSet()
+{
+	m_sourceHash = 0;
+	m_regionMin = glm::vec3(0.0f);
+	m_cellSize = 1.0f;
+	m_cellCount[0] = m_cellCount[1] = m_cellCount[2] = 0;
+	m_objectCount = 0;
+	m_wordsPerCell = 0;
+}
+
+/***********************************************************
+ *  ~PotentiallyVisibleSet()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+PotentiallyVisibleSet::~PotentiallyVisibleSet()
+{
+	m_cellVisibility.clear();
+}
+
+/***********************************************************
+ *  ComputeSourceHash()
+ *
+ *  This method is used for hashing everything the bake
+ *  depends on with 64-bit FNV-1a.
+ ***********************************************************/
+uint64_t PotentiallyVisibleSet::ComputeSourceHash(
+	const std::vector<PVS_OBJECT>& objects,
+	glm::vec3 regionMin,
+	glm::vec3 regionMax,
+	float cellSize)
+{
+	uint64_t hash = 14695981039346656037ull;
+	auto hashBytes = [&hash](const void* data, size_t size)
+		{
+			const uint8_t* bytes = static_cast<const uint8_t*>(data);
+			for (size_t i = 0; i < size; i++)
+			{
+				hash ^= bytes[i];
+				hash *= 1099511628211ull;
+			}
+		};
+
+	hashBytes(&PVS_FILE_VERSION, sizeof(PVS_FILE_VERSION));
+	hashBytes(&regionMin[0], sizeof(float) * 3);
+	hashBytes(&regionMax[0], sizeof(float) * 3);
+	hashBytes(&cellSize, sizeof(cellSize));
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		for (int column = 0; column < 4; column++)
+		{
+			hashBytes(&objects[i].modelMatrix[column][0], sizeof(float) * 4);
+		}
+		hashBytes(&objects[i].boundsMin[0], sizeof(float) * 3);
+		hashBytes(&objects[i].boundsMax[0], sizeof(float) * 3);
+		uint8_t occluder = objects[i].bOccluder ? 1 : 0;
+		hashBytes(&occluder, sizeof(occluder));
+		if (objects[i].bOccluder)
+		{
+			hashBytes(&objects[i].occluderMin[0], sizeof(float) * 3);
+			hashBytes(&objects[i].occluderMax[0], sizeof(float) * 3);
+		}
+	}
+
+	return(hash);
+}
+
+/***********************************************************
+ *  Bake()
+ *
+ *  This method is used for computing the visible set of
+ *  every view cell.  Sight lines are sampled from a few
+ *  points inside each cell to points on each object's
+ *  bounds; an object is visible when any sight line reaches
+ *  it without passing through an occluder.  Cells are spread
+ *  across the job system workers.
+ ***********************************************************/
+void PotentiallyVisibleSet::Bake(
+	const std::vector<PVS_OBJECT>& objects,
+	glm::vec3 regionMin,
+	glm::vec3 regionMax,
+	float cellSize,
+	JobSystem* pJobSystem)
+{
+	auto startTime = std::chrono::steady_clock::now();
+
+	m_sourceHash = ComputeSourceHash(objects, regionMin, regionMax, cellSize);
+	m_regionMin = regionMin;
+	m_cellSize = cellSize;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		m_cellCount[axis] = static_cast<int>(std::ceil((regionMax[axis] - regionMin[axis]) / cellSize));
+		if (m_cellCount[axis] < 1)
+		{
+			m_cellCount[axis] = 1;
+		}
+	}
+	m_objectCount = static_cast<int>(objects.size());
+	m_wordsPerCell = (m_objectCount + 31) / 32;
+
+	size_t totalCells = static_cast<size_t>(m_cellCount[0]) * m_cellCount[1] * m_cellCount[2];
+	m_cellVisibility.assign(totalCells * m_wordsPerCell, 0);
+
+	// prepare the occluders for testing in their own local space
+	std::vector<OCCLUDER> occluders;
+	for (int i = 0; i < m_objectCount; i++)
+	{
+		if (objects[i].bOccluder)
+		{
+			OCCLUDER occluder;
+			occluder.objectIndex = i;
+			occluder.worldToLocal = glm::inverse(objects[i].modelMatrix);
+			occluder.localMin = objects[i].occluderMin;
+			occluder.localMax = objects[i].occluderMax;
+			occluders.push_back(occluder);
+		}
+	}
+
+	// sight line targets - center, shrunken corners and face centers of the bounds
+	const int TARGETS_PER_OBJECT = 15;
+	std::vector<glm::vec3> targets(static_cast<size_t>(m_objectCount) * TARGETS_PER_OBJECT);
+	for (int i = 0; i < m_objectCount; i++)
+	{
+		glm::vec3 center = (objects[i].boundsMin + objects[i].boundsMax) * 0.5f;
+		glm::vec3 extent = (objects[i].boundsMax - objects[i].boundsMin) * 0.5f;
+		glm::vec3 localPoints[TARGETS_PER_OBJECT];
+		int count = 0;
+		localPoints[count++] = center;
+		for (int corner = 0; corner < 8; corner++)
+		{
+			glm::vec3 offset(
+				(corner & 1) ? 0.9f : -0.9f,
+				(corner & 2) ? 0.9f : -0.9f,
+				(corner & 4) ? 0.9f : -0.9f);
+			localPoints[count++] = center + (offset * extent);
+		}
+		for (int axis = 0; axis < 3; axis++)
+		{
+			glm::vec3 offset(0.0f);
+			offset[axis] = extent[axis];
+			localPoints[count++] = center + offset;
+			localPoints[count++] = center - offset;
+		}
+		for (int j = 0; j < TARGETS_PER_OBJECT; j++)
+		{
+			targets[(i * TARGETS_PER_OBJECT) + j] = glm::vec3(objects[i].modelMatrix * glm::vec4(localPoints[j], 1.0f));
+		}
+	}
+
+	auto bakeCells = [&](size_t begin, size_t end)
+		{
+			for (size_t cell = begin; cell < end; cell++)
+			{
+				uint32_t* cellBits = &m_cellVisibility[cell * m_wordsPerCell];
+				int cellX = static_cast<int>(cell % m_cellCount[0]);
+				int cellY = static_cast<int>((cell / m_cellCount[0]) % m_cellCount[1]);
+				int cellZ = static_cast<int>(cell / (static_cast<size_t>(m_cellCount[0]) * m_cellCount[1]));
+				glm::vec3 cellCenter = m_regionMin + (glm::vec3(cellX + 0.5f, cellY + 0.5f, cellZ + 0.5f) * m_cellSize);
+
+				// sample the cell center and eight points toward its corners,
+				// skipping any that are buried inside an occluder
+				std::vector<glm::vec3> samples;
+				for (int s = 0; s < 9; s++)
+				{
+					glm::vec3 sample = cellCenter;
+					if (s > 0)
+					{
+						glm::vec3 offset(
+							(s & 1) ? 0.4f : -0.4f,
+							(s & 2) ? 0.4f : -0.4f,
+							(s & 4) ? 0.4f : -0.4f);
+						sample += offset * m_cellSize;
+					}
+
+					bool bBuried = false;
+					for (size_t o = 0; (o < occluders.size()) && (bBuried == false); o++)
+					{
+						glm::vec3 local = glm::vec3(occluders[o].worldToLocal * glm::vec4(sample, 1.0f));
+						bBuried = IsPointInsideBox(local, occluders[o].localMin, occluders[o].localMax);
+					}
+					if (bBuried == false)
+					{
+						samples.push_back(sample);
+					}
+				}
+
+				// a cell entirely inside geometry cannot be judged, so keep everything
+				if (samples.size() == 0)
+				{
+					for (int i = 0; i < m_objectCount; i++)
+					{
+						cellBits[i >> 5] |= (1u << (i & 31));
+					}
+					continue;
+				}
+
+				for (int i = 0; i < m_objectCount; i++)
+				{
+					bool bVisible = false;
+					for (size_t s = 0; (s < samples.size()) && (bVisible == false); s++)
+					{
+						for (int t = 0; (t < TARGETS_PER_OBJECT) && (bVisible == false); t++)
+						{
+							glm::vec3 target = targets[(i * TARGETS_PER_OBJECT) + t];
+							bool bBlocked = false;
+							for (size_t o = 0; (o < occluders.size()) && (bBlocked == false); o++)
+							{
+								if (occluders[o].objectIndex == i)
+								{
+									continue;
+								}
+								glm::vec3 localStart = glm::vec3(occluders[o].worldToLocal * glm::vec4(samples[s], 1.0f));
+								glm::vec3 localEnd = glm::vec3(occluders[o].worldToLocal * glm::vec4(target, 1.0f));
+								bBlocked = SegmentHitsBox(localStart, localEnd, occluders[o].localMin, occluders[o].localMax);
+							}
+							bVisible = !bBlocked;
+						}
+					}
+					if (bVisible)
+					{
+						cellBits[i >> 5] |= (1u << (i & 31));
+					}
+				}
+			}
+		};
+
+	if (NULL != pJobSystem)
+	{
+		pJobSystem->ParallelFor(totalCells, 8, bakeCells);
+	}
+	else
+	{
+		bakeCells(0, totalCells);
+	}
+
+	auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime);
+	std::cout << "PVS: baked " << totalCells << " view cells for " << m_objectCount
+		<< " objects in " << elapsed.count() << " ms, average visible "
+		<< GetAverageVisibleCount() << std::endl;
+}
+
+/***********************************************************
+ *  SaveToCache()
+ *
+ *  This method is used for writing the baked cells into
+ *  the asset cache as a run-length compressed bit stream.
+ ***********************************************************/
+bool PotentiallyVisibleSet::SaveToCache(const char* filename) const
+{
+	if (IsBaked() == false)
+	{
+		return(false);
+	}
+
+	std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		std::cout << "Could not write PVS cache:" << filename << std::endl;
+		return(false);
+	}
+
+	std::vector<uint8_t> packed = CompressRunLength(
+		reinterpret_cast<const uint8_t*>(m_cellVisibility.data()),
+		m_cellVisibility.size() * sizeof(uint32_t));
+	uint32_t packedSize = static_cast<uint32_t>(packed.size());
+
+	file.write(reinterpret_cast<const char*>(&PVS_FILE_MAGIC), sizeof(PVS_FILE_MAGIC));
+	file.write(reinterpret_cast<const char*>(&PVS_FILE_VERSION), sizeof(PVS_FILE_VERSION));
+	file.write(reinterpret_cast<const char*>(&m_sourceHash), sizeof(m_sourceHash));
+	file.write(reinterpret_cast<const char*>(&m_regionMin[0]), sizeof(float) * 3);
+	file.write(reinterpret_cast<const char*>(&m_cellSize), sizeof(m_cellSize));
+	file.write(reinterpret_cast<const char*>(m_cellCount), sizeof(m_cellCount));
+	file.write(reinterpret_cast<const char*>(&m_objectCount), sizeof(m_objectCount));
+	file.write(reinterpret_cast<const char*>(&packedSize), sizeof(packedSize));
+	file.write(reinterpret_cast<const char*>(packed.data()), packed.size());
+
+	std::cout << "PVS: cached " << (m_cellVisibility.size() * sizeof(uint32_t))
+		<< " bytes of cell visibility as " << packedSize << " bytes" << std::endl;
+
+	return(file.good());
+}
+
+/***********************************************************
+ *  LoadFromCache()
+ *
+ *  This method is used for reading baked cells from the
+ *  asset cache.  The file is rejected when it was baked
+ *  from different inputs than the current scene.
+ ***********************************************************/
+bool PotentiallyVisibleSet::LoadFromCache(const char* filename, uint64_t sourceHash)
+{
+	std::ifstream file(filename, std::ios::binary);
+	if (!file)
+	{
+		return(false);
+	}
+
+	uint32_t magic = 0;
+	uint32_t version = 0;
+	uint64_t hash = 0;
+	glm::vec3 regionMin(0.0f);
+	float cellSize = 0.0f;
+	int cellCount[3] = { 0, 0, 0 };
+	int objectCount = 0;
+	uint32_t packedSize = 0;
+
+	file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+	file.read(reinterpret_cast<char*>(&version), sizeof(version));
+	file.read(reinterpret_cast<char*>(&hash), sizeof(hash));
+	if (!file || (magic != PVS_FILE_MAGIC) || (version != PVS_FILE_VERSION) || (hash != sourceHash))
+	{
+		return(false);
+	}
+
+	file.read(reinterpret_cast<char*>(&regionMin[0]), sizeof(float) * 3);
+	file.read(reinterpret_cast<char*>(&cellSize), sizeof(cellSize));
+	file.read(reinterpret_cast<char*>(cellCount), sizeof(cellCount));
+	file.read(reinterpret_cast<char*>(&objectCount), sizeof(objectCount));
+	file.read(reinterpret_cast<char*>(&packedSize), sizeof(packedSize));
+	if (!file || (cellCount[0] < 1) || (cellCount[1] < 1) || (cellCount[2] < 1) || (objectCount < 0))
+	{
+		return(false);
+	}
+
+	std::vector<uint8_t> packed(packedSize);
+	file.read(reinterpret_cast<char*>(packed.data()), packedSize);
+	if (!file)
+	{
+		return(false);
+	}
+
+	int wordsPerCell = (objectCount + 31) / 32;
+	size_t totalCells = static_cast<size_t>(cellCount[0]) * cellCount[1] * cellCount[2];
+	std::vector<uint32_t> cellVisibility(totalCells * wordsPerCell);
+	if (DecompressRunLength(packed, reinterpret_cast<uint8_t*>(cellVisibility.data()),
+		cellVisibility.size() * sizeof(uint32_t)) == false)
+	{
+		return(false);
+	}
+
+	m_sourceHash = hash;
+	m_regionMin = regionMin;
+	m_cellSize = cellSize;
+	m_cellCount[0] = cellCount[0];
+	m_cellCount[1] = cellCount[1];
+	m_cellCount[2] = cellCount[2];
+	m_objectCount = objectCount;
+	m_wordsPerCell = wordsPerCell;
+	m_cellVisibility.swap(cellVisibility);
+
+	std::cout << "PVS: loaded " << totalCells << " view cells from cache " << filename << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  FindCellVisibility()
+ *
+ *  This method is used for getting the visibility bits of
+ *  the view cell that contains the passed in position.
+ ***********************************************************/
+const uint32_t* PotentiallyVisibleSet::FindCellVisibility(glm::vec3 position) const
+{
+	if (IsBaked() == false)
+	{
+		return(NULL);
+	}
+
+	int cell[3];
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float offset = (position[axis] - m_regionMin[axis]) / m_cellSize;
+		if ((offset < 0.0f) || (offset >= static_cast<float>(m_cellCount[axis])))
+		{
+			return(NULL);
+		}
+		cell[axis] = static_cast<int>(offset);
+	}
+
+	size_t index = static_cast<size_t>(cell[0]) +
+		(static_cast<size_t>(cell[1]) * m_cellCount[0]) +
+		(static_cast<size_t>(cell[2]) * m_cellCount[0] * m_cellCount[1]);
+
+	return(&m_cellVisibility[index * m_wordsPerCell]);
+}
+
+/***********************************************************
+ *  GetAverageVisibleCount()
+ *
+ *  This method is used for reporting how many objects each
+ *  view cell keeps on average.
+ ***********************************************************/
+float PotentiallyVisibleSet::GetAverageVisibleCount() const
+{
+	if ((IsBaked() == false) || (m_wordsPerCell == 0))
+	{
+		return(0.0f);
+	}
+
+	size_t visibleBits = 0;
+	for (size_t i = 0; i < m_cellVisibility.size(); i++)
+	{
+		uint32_t word = m_cellVisibility[i];
+		while (word != 0)
+		{
+			word &= (word - 1);
+			visibleBits++;
+		}
+	}
+
+	return(static_cast<float>(visibleBits) / static_cast<float>(m_cellVisibility.size() / m_wordsPerCell));
+}
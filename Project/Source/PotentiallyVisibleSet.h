@@ -0,0 +1,97 @@
+///////////////////////////////////////////////////////////////////////////////
+// potentiallyvisibleset.h
+// ============
+// bake and query per view cell visibility of the static scene objects
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "JobSystem.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  PotentiallyVisibleSet
+ *
+ *  This class partitions the navigable space of a static
+ *  scene into a grid of view cells, and stores for every
+ *  cell one bit per scene object telling whether the object
+ *  can be seen from anywhere inside that cell.
+ ***********************************************************/
+class PotentiallyVisibleSet
+{
+public:
+	// constructor
+	PotentiallyVisibleSet();
+	// destructor
+	~PotentiallyVisibleSet();
+
+	// static object description used while baking
+	struct PVS_OBJECT
+	{
+		// local to world transform of the object
+		glm::mat4 modelMatrix;
+		// conservative local bounds enclosing the whole mesh
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+		// true when the object blocks sight lines
+		bool bOccluder;
+		// local bounds fully inside the mesh, used for occlusion
+		glm::vec3 occluderMin;
+		glm::vec3 occluderMax;
+	};
+
+	// compute the visible set of every view cell covering the region
+	void Bake(
+		const std::vector<PVS_OBJECT>& objects,
+		glm::vec3 regionMin,
+		glm::vec3 regionMax,
+		float cellSize,
+		JobSystem* pJobSystem);
+
+	// write the baked cells in compressed form into the cache file
+	bool SaveToCache(const char* filename) const;
+	// read previously baked cells, rejecting stale cache files
+	bool LoadFromCache(const char* filename, uint64_t sourceHash);
+
+	// hash the bake inputs so stale cache files can be detected
+	static uint64_t ComputeSourceHash(
+		const std::vector<PVS_OBJECT>& objects,
+		glm::vec3 regionMin,
+		glm::vec3 regionMax,
+		float cellSize);
+
+	// get the visibility bits of the cell containing the position,
+	// or NULL when the position is outside the baked region
+	const uint32_t* FindCellVisibility(glm::vec3 position) const;
+
+	// test a single object bit of a cell returned by FindCellVisibility
+	static bool IsObjectVisible(const uint32_t* cellBits, int objectIndex)
+	{
+		return((cellBits[objectIndex >> 5] & (1u << (objectIndex & 31))) != 0);
+	}
+
+	// true when a bake or cache load has completed
+	bool IsBaked() const { return(m_cellVisibility.size() > 0); }
+	// drop the baked cells, after which every object counts as visible
+	void Clear() { m_cellVisibility.clear(); }
+	// get the average number of objects visible from a cell
+	float GetAverageVisibleCount() const;
+
+private:
+	// hash of the inputs used to bake the current cells
+	uint64_t m_sourceHash;
+	// world position of the region corner and size of a cell
+	glm::vec3 m_regionMin;
+	float m_cellSize;
+	// number of cells along each axis
+	int m_cellCount[3];
+	// number of objects and 32-bit words per cell
+	int m_objectCount;
+	int m_wordsPerCell;
+	// visibility bits of all cells, cell after cell
+	std::vector<uint32_t> m_cellVisibility;
+};
@@ -0,0 +1,187 @@
+///////////////////////////////////////////////////////////////////////////////
+// proceduralmaterials.cpp
+// ============
+// evaluate the procedural wood, cork and ceramic surfaces on the CPU
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ProceduralMaterials.h"
+
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	/***********************************************************
+	 *  HashCell()
+	 *
+	 *  Integer hash of a lattice cell, identical to the shader.
+	 ***********************************************************/
+	uint32_t HashCell(uint32_t x, uint32_t y)
+	{
+		uint32_t h = (x * 0x8da6b343u) ^ (y * 0xd8163841u);
+		h ^= h >> 15;
+		h *= 0x2c1b3c6du;
+		h ^= h >> 12;
+		h *= 0x297a2d39u;
+		h ^= h >> 15;
+		return(h);
+	}
+
+	/***********************************************************
+	 *  LatticeValue()
+	 *
+	 *  Random value in [0, 1] of a cell, wrapped to the period
+	 *  so the noise tiles seamlessly.
+	 ***********************************************************/
+	float LatticeValue(glm::vec2 cell, glm::vec2 period)
+	{
+		glm::vec2 wrapped = cell - (period * glm::floor(cell / period));
+		uint32_t h = HashCell(static_cast<uint32_t>(wrapped.x), static_cast<uint32_t>(wrapped.y));
+		return(static_cast<float>(h & 0xFFFFFFu) / 16777215.0f);
+	}
+
+	/***********************************************************
+	 *  ValueNoise()
+	 *
+	 *  Smoothly interpolated lattice noise.
+	 ***********************************************************/
+	float ValueNoise(glm::vec2 p, glm::vec2 period)
+	{
+		glm::vec2 cell = glm::floor(p);
+		glm::vec2 f = p - cell;
+		glm::vec2 u = f * f * (glm::vec2(3.0f) - (f * 2.0f));
+
+		float a = LatticeValue(cell, period);
+		float b = LatticeValue(cell + glm::vec2(1.0f, 0.0f), period);
+		float c = LatticeValue(cell + glm::vec2(0.0f, 1.0f), period);
+		float d = LatticeValue(cell + glm::vec2(1.0f, 1.0f), period);
+
+		return(glm::mix(glm::mix(a, b, u.x), glm::mix(c, d, u.x), u.y));
+	}
+
+	/***********************************************************
+	 *  Fbm()
+	 *
+	 *  Four octaves of value noise, each keeping the tiling.
+	 ***********************************************************/
+	float Fbm(glm::vec2 p, glm::vec2 period)
+	{
+		float sum = 0.0f;
+		float amplitude = 0.5f;
+		for (int octave = 0; octave < 4; octave++)
+		{
+			sum += amplitude * ValueNoise(p, period);
+			p *= 2.0f;
+			period *= 2.0f;
+			amplitude *= 0.5f;
+		}
+		return(sum);
+	}
+
+	float Smoothstep(float edge0, float edge1, float x)
+	{
+		float t = glm::clamp((x - edge0) / (edge1 - edge0), 0.0f, 1.0f);
+		return(t * t * (3.0f - (2.0f * t)));
+	}
+}
+
+/***********************************************************
+ *  EvaluateProceduralColor()
+ *
+ *  The params hold the pattern scale in noise cells per UV
+ *  unit (x), the ring count or speck threshold (y), the
+ *  turbulence (z) and the amount of fine detail (w).
+ ***********************************************************/
+glm::vec3 EvaluateProceduralColor(
+	int proceduralType,
+	glm::vec3 colorA,
+	glm::vec3 colorB,
+	glm::vec4 params,
+	glm::vec2 uv)
+{
+	float scale = std::floor(params.x);
+	glm::vec2 p = uv * scale;
+	glm::vec2 period = glm::vec2(scale);
+
+	if (proceduralType == PROCEDURAL_WOOD)
+	{
+		// growth rings bent by noise stretched along the grain
+		glm::vec2 grainScale = glm::vec2(1.0f, 4.0f);
+		float bend = Fbm(p * grainScale, period * grainScale);
+		float ring = uv.y * std::floor(params.y) + (bend * params.z);
+		ring = ring - std::floor(ring);
+		float band = Smoothstep(0.2f, 0.8f, std::fabs((ring * 2.0f) - 1.0f));
+		// fine streaks along the grain
+		glm::vec2 streakScale = glm::vec2(1.0f, 16.0f);
+		float streak = Fbm(p * streakScale, period * streakScale);
+		return(glm::mix(colorA, colorB, band) * (1.0f - (params.w * streak)));
+	}
+	if (proceduralType == PROCEDURAL_CORK)
+	{
+		// granules of varying tone with dark pores
+		float granule = Fbm(p * 2.0f, period * 2.0f);
+		float pore = Smoothstep(params.y, params.y + 0.05f, ValueNoise(p * 8.0f, period * 8.0f));
+		glm::vec3 color = glm::mix(colorA, colorB, glm::clamp(granule * params.z, 0.0f, 1.0f));
+		return(color * (1.0f - (params.w * pore)));
+	}
+	if (proceduralType == PROCEDURAL_CERAMIC)
+	{
+		// a glaze pooling into slightly darker patches, with fine speckles
+		float pooling = Fbm(p, period);
+		float speckle = Smoothstep(params.y, params.y + 0.02f, ValueNoise(p * 16.0f, period * 16.0f));
+		glm::vec3 color = glm::mix(colorA, colorB, glm::clamp(pooling * params.z, 0.0f, 1.0f));
+		return(color * (1.0f - (params.w * speckle)));
+	}
+
+	return(colorA);
+}
+
+/***********************************************************
+ *  BakeProceduralImage()
+ *
+ *  This function is used for evaluating a procedural
+ *  material into an image, sampling the texel centers and
+ *  spreading the rows across the job system workers.
+ ***********************************************************/
+void BakeProceduralImage(
+	int proceduralType,
+	glm::vec3 colorA,
+	glm::vec3 colorB,
+	glm::vec4 params,
+	int resolution,
+	std::vector<uint8_t>& pixels,
+	JobSystem* pJobSystem)
+{
+	pixels.resize(static_cast<size_t>(resolution) * resolution * 3);
+
+	auto bakeRows = [&](size_t begin, size_t end)
+		{
+			for (size_t y = begin; y < end; y++)
+			{
+				for (int x = 0; x < resolution; x++)
+				{
+					glm::vec2 uv(
+						(static_cast<float>(x) + 0.5f) / resolution,
+						(static_cast<float>(y) + 0.5f) / resolution);
+					glm::vec3 color = glm::clamp(
+						EvaluateProceduralColor(proceduralType, colorA, colorB, params, uv),
+						glm::vec3(0.0f),
+						glm::vec3(1.0f));
+
+					size_t offset = ((y * resolution) + x) * 3;
+					pixels[offset + 0] = static_cast<uint8_t>((color.r * 255.0f) + 0.5f);
+					pixels[offset + 1] = static_cast<uint8_t>((color.g * 255.0f) + 0.5f);
+					pixels[offset + 2] = static_cast<uint8_t>((color.b * 255.0f) + 0.5f);
+				}
+			}
+		};
+
+	if (NULL != pJobSystem)
+	{
+		pJobSystem->ParallelFor(resolution, 16, bakeRows);
+	}
+	else
+	{
+		bakeRows(0, resolution);
+	}
+}
@@ -0,0 +1,45 @@
+///////////////////////////////////////////////////////////////////////////////
+// proceduralmaterials.h
+// ============
+// evaluate the procedural wood, cork and ceramic surfaces on the CPU
+//
+// The functions here mirror the procedural functions in fragmentShader.glsl
+// line for line, so a baked texture matches what the shader draws live.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "JobSystem.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// procedural surface types, matching material.proceduralType in the shader
+enum PROCEDURAL_TYPE
+{
+	PROCEDURAL_NONE = 0,
+	PROCEDURAL_WOOD = 1,
+	PROCEDURAL_CORK = 2,
+	PROCEDURAL_CERAMIC = 3
+};
+
+// evaluate the surface color of a procedural material at a
+// texture coordinate, with one repeat of the pattern per UV unit
+glm::vec3 EvaluateProceduralColor(
+	int proceduralType,
+	glm::vec3 colorA,
+	glm::vec3 colorB,
+	glm::vec4 params,
+	glm::vec2 uv);
+
+// fill an RGB8 image of the given resolution with one repeat of the pattern
+void BakeProceduralImage(
+	int proceduralType,
+	glm::vec3 colorA,
+	glm::vec3 colorB,
+	glm::vec4 params,
+	int resolution,
+	std::vector<uint8_t>& pixels,
+	JobSystem* pJobSystem);
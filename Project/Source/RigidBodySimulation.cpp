@@ -0,0 +1,1638 @@
+///////////////////////////////////////////////////////////////////////////////
+// rigidbodysimulation.cpp
+// ============
+// knock tabletop props around as rigid bodies on the worker threads
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RigidBodySimulation.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <thread>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <emmintrin.h>
+#define RIGID_SSE
+#endif
+
+// declaration of global variables
+namespace
+{
+	// length of each simulation step, and the most steps taken in
+	// one update so a long frame does not stall the next ones
+	const float RIGID_STEP_SECONDS = 1.0f / 60.0f;
+	const int RIGID_MAX_STEPS_PER_UPDATE = 4;
+	// bodies or pairs handled together by one worker at the least
+	const size_t RIGID_GRAIN_SIZE = 128;
+	// ranges the pair and contact searches are split into at the
+	// most, each filling a list of its own
+	const size_t RIGID_MAX_RANGES = 256;
+	// contacts kept between two bodies, spread over where they touch
+	const int RIGID_MAX_PAIR_CONTACTS = 8;
+	// bodies are numbered in 20 bits of the contact keys, the ground
+	// taking the highest number
+	const int RIGID_MAX_BODIES = (1 << 20) - 1;
+	const uint64_t RIGID_GROUND_KEY = (1 << 20) - 1;
+	// hulls are found by trying every plane through three points
+	const int RIGID_MAX_HULL_POINTS = 64;
+	// points around each rim of a cylinder
+	const int RIGID_CYLINDER_POINTS = 12;
+	// contacts closing slower than this do not bounce
+	const float RIGID_BOUNCE_SPEED = 1.0f;
+	// fraction of their speed the bodies lose every second
+	const float RIGID_LINEAR_DAMPING = 0.05f;
+	const float RIGID_ANGULAR_DAMPING = 0.1f;
+
+	/***********************************************************
+	 *  CountRanges()
+	 *
+	 *  Number of ranges of at least the passed in size that a
+	 *  count of items is split into by RunRanges().
+	 ***********************************************************/
+	size_t CountRanges(size_t count, size_t grainSize)
+	{
+		return(std::min(std::max(count / grainSize, static_cast<size_t>(1)), RIGID_MAX_RANGES));
+	}
+
+	/***********************************************************
+	 *  RunRanges()
+	 *
+	 *  Split [0, count) into the passed in number of ranges and
+	 *  run the function over each, on the workers or on the
+	 *  calling thread without a job system.  The function gets
+	 *  the index of its range, so it can fill a list of its
+	 *  own without locking.
+	 ***********************************************************/
+	void RunRanges(
+		JobSystem* pJobSystem,
+		size_t count,
+		size_t rangeCount,
+		const std::function<void(size_t range, size_t begin, size_t end)>& func)
+	{
+		auto runRanges = [count, rangeCount, &func](size_t first, size_t last)
+			{
+				for (size_t range = first; range < last; range++)
+				{
+					func(range, (count * range) / rangeCount, (count * (range + 1)) / rangeCount);
+				}
+			};
+		if (NULL != pJobSystem)
+		{
+			pJobSystem->ParallelFor(rangeCount, 1, runRanges);
+		}
+		else
+		{
+			runRanges(0, rangeCount);
+		}
+	}
+
+	/***********************************************************
+	 *  SignOf()
+	 *
+	 *  One with the sign of the passed in value, positive for
+	 *  zero so a point on a plane still gets a direction.
+	 ***********************************************************/
+	inline float SignOf(float value)
+	{
+		return((value < 0.0f) ? -1.0f : 1.0f);
+	}
+
+	/***********************************************************
+	 *  ApplyImpulse()
+	 *
+	 *  Push two touching bodies apart by an impulse, the first
+	 *  along it and the second against it, turning them by the
+	 *  passed in changes of angular velocity.  Bodies that do
+	 *  not move are left alone, since they are shared between
+	 *  islands.
+	 ***********************************************************/
+	template<class BODY>
+	inline void ApplyImpulse(BODY& bodyA, BODY* pBodyB, glm::vec3 impulse, glm::vec3 turnA, glm::vec3 turnB)
+	{
+		bodyA.linearVelocity += impulse * bodyA.inverseMass;
+		bodyA.angularVelocity += turnA;
+		if ((NULL != pBodyB) && (pBodyB->inverseMass > 0.0f))
+		{
+			pBodyB->linearVelocity -= impulse * pBodyB->inverseMass;
+			pBodyB->angularVelocity -= turnB;
+		}
+	}
+
+	/***********************************************************
+	 *  RelativeVelocity()
+	 *
+	 *  Velocity of the first body against the second at the
+	 *  point the passed in offsets lead to.
+	 ***********************************************************/
+	template<class BODY>
+	inline glm::vec3 RelativeVelocity(const BODY& bodyA, const BODY* pBodyB, glm::vec3 offsetA, glm::vec3 offsetB)
+	{
+		glm::vec3 velocity = bodyA.linearVelocity + glm::cross(bodyA.angularVelocity, offsetA);
+		if (NULL != pBodyB)
+		{
+			velocity -= pBodyB->linearVelocity + glm::cross(pBodyB->angularVelocity, offsetB);
+		}
+		return(velocity);
+	}
+
+	/***********************************************************
+	 *  PrepareDirection()
+	 *
+	 *  Find how much each body turns from a unit impulse along
+	 *  the passed in direction at the passed in offsets, and
+	 *  return the mass the two bodies put up against it.
+	 ***********************************************************/
+	template<class BODY>
+	inline float PrepareDirection(
+		const BODY& bodyA,
+		const BODY* pBodyB,
+		glm::vec3 offsetA,
+		glm::vec3 offsetB,
+		glm::vec3 direction,
+		glm::vec3& turnA,
+		glm::vec3& turnB)
+	{
+		glm::vec3 armA = glm::cross(offsetA, direction);
+		turnA = bodyA.inverseInertiaWorld * armA;
+		float inverse = bodyA.inverseMass + glm::dot(armA, turnA);
+		turnB = glm::vec3(0.0f);
+		if (NULL != pBodyB)
+		{
+			glm::vec3 armB = glm::cross(offsetB, direction);
+			turnB = pBodyB->inverseInertiaWorld * armB;
+			inverse += pBodyB->inverseMass + glm::dot(armB, turnB);
+		}
+		return((inverse > 0.0f) ? (1.0f / inverse) : 0.0f);
+	}
+
+#ifdef RIGID_SSE
+	/***********************************************************
+	 *  Abs4()
+	 *
+	 *  Absolute value of four floats, clearing the sign bits.
+	 ***********************************************************/
+	inline __m128 Abs4(__m128 value)
+	{
+		return(_mm_andnot_ps(_mm_set1_ps(-0.0f), value));
+	}
+
+	/***********************************************************
+	 *  BoxDistance4()
+	 *
+	 *  Signed distance from four points to a box centered on
+	 *  the origin, exact inside and outside.
+	 ***********************************************************/
+	inline __m128 BoxDistance4(__m128 x, __m128 y, __m128 z, glm::vec3 halfExtents)
+	{
+		const __m128 zero = _mm_setzero_ps();
+		__m128 qx = _mm_sub_ps(Abs4(x), _mm_set1_ps(halfExtents.x));
+		__m128 qy = _mm_sub_ps(Abs4(y), _mm_set1_ps(halfExtents.y));
+		__m128 qz = _mm_sub_ps(Abs4(z), _mm_set1_ps(halfExtents.z));
+		__m128 outX = _mm_max_ps(qx, zero);
+		__m128 outY = _mm_max_ps(qy, zero);
+		__m128 outZ = _mm_max_ps(qz, zero);
+		__m128 outside = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(outX, outX), _mm_mul_ps(outY, outY)), _mm_mul_ps(outZ, outZ)));
+		__m128 inside = _mm_min_ps(_mm_max_ps(qx, _mm_max_ps(qy, qz)), zero);
+		return(_mm_add_ps(outside, inside));
+	}
+
+	/***********************************************************
+	 *  SphereDistance4()
+	 *
+	 *  Signed distance from four points to a sphere centered on
+	 *  the origin.
+	 ***********************************************************/
+	inline __m128 SphereDistance4(__m128 x, __m128 y, __m128 z, float radius)
+	{
+		__m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+		return(_mm_sub_ps(_mm_sqrt_ps(lengthSquared), _mm_set1_ps(radius)));
+	}
+
+	/***********************************************************
+	 *  CylinderDistance4()
+	 *
+	 *  Signed distance from four points to a cylinder centered
+	 *  on the origin and standing along y.
+	 ***********************************************************/
+	inline __m128 CylinderDistance4(__m128 x, __m128 y, __m128 z, float radius, float halfHeight)
+	{
+		const __m128 zero = _mm_setzero_ps();
+		__m128 radial = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(z, z)));
+		__m128 side = _mm_sub_ps(radial, _mm_set1_ps(radius));
+		__m128 cap = _mm_sub_ps(Abs4(y), _mm_set1_ps(halfHeight));
+		__m128 outSide = _mm_max_ps(side, zero);
+		__m128 outCap = _mm_max_ps(cap, zero);
+		__m128 outside = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(outSide, outSide), _mm_mul_ps(outCap, outCap)));
+		return(_mm_add_ps(outside, _mm_min_ps(_mm_max_ps(side, cap), zero)));
+	}
+
+	/***********************************************************
+	 *  HullDistance4()
+	 *
+	 *  Distance from four points to a convex hull, the farthest
+	 *  of its faces.  It is exact inside and never more than
+	 *  the true distance outside.
+	 ***********************************************************/
+	inline __m128 HullDistance4(__m128 x, __m128 y, __m128 z, const std::vector<glm::vec4>& planes)
+	{
+		__m128 distance = _mm_set1_ps(-FLT_MAX);
+		for (int i = 0; i < planes.size(); i++)
+		{
+			__m128 planeDistance = _mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(x, _mm_set1_ps(planes[i].x)),
+				_mm_mul_ps(y, _mm_set1_ps(planes[i].y))),
+				_mm_mul_ps(z, _mm_set1_ps(planes[i].z)));
+			distance = _mm_max_ps(distance, _mm_sub_ps(planeDistance, _mm_set1_ps(planes[i].w)));
+		}
+		return(distance);
+	}
+#endif
+}
+
+/***********************************************************
+ *  RigidBodySimulation()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RigidBodySimulation::RigidBodySimulation()
+{
+	m_pendingTime = 0.0f;
+	m_awakeCount = 0;
+	m_islandCount = 0;
+	m_bSortNeeded = true;
+}
+
+/***********************************************************
+ *  ~RigidBodySimulation()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+RigidBodySimulation::~RigidBodySimulation()
+{
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for removing every shape and body
+ *  and setting the behavior of the bodies added after it.
+ ***********************************************************/
+void RigidBodySimulation::Initialize(const RIGID_BODY_SETTINGS& settings)
+{
+	m_settings = settings;
+	m_settings.iterations = std::max(m_settings.iterations, 1);
+
+	m_shapes.clear();
+	m_bodies.clear();
+	m_pendingTime = 0.0f;
+	m_awakeCount = 0;
+	m_islandCount = 0;
+	m_sortedBodies.clear();
+	m_bSortNeeded = true;
+	m_pairs.clear();
+	m_contacts.clear();
+	m_cachedImpulses.clear();
+}
+
+/***********************************************************
+ *  AddBox()
+ *
+ *  This method is used for adding a box shape.  Its corners
+ *  and the middles of its edges are tested against other
+ *  shapes, so a box lying across an edge is caught too.
+ ***********************************************************/
+int RigidBodySimulation::AddBox(glm::vec3 halfExtents)
+{
+	RIGID_SHAPE shape;
+	shape.type = RIGID_BOX;
+	shape.halfExtents = halfExtents;
+
+	std::vector<glm::vec3> points;
+	for (int x = -1; x <= 1; x++)
+	{
+		for (int y = -1; y <= 1; y++)
+		{
+			for (int z = -1; z <= 1; z++)
+			{
+				// corners have no zero, the middles of edges one
+				int zeros = (x == 0) + (y == 0) + (z == 0);
+				if (zeros <= 1)
+				{
+					points.push_back(glm::vec3(x * halfExtents.x, y * halfExtents.y, z * halfExtents.z));
+				}
+			}
+		}
+	}
+	return(AddShape(shape, points));
+}
+
+/***********************************************************
+ *  AddSphere()
+ *
+ *  This method is used for adding a sphere shape, tested
+ *  against other shapes by its center and radius.
+ ***********************************************************/
+int RigidBodySimulation::AddSphere(float radius)
+{
+	RIGID_SHAPE shape;
+	shape.type = RIGID_SPHERE;
+	shape.radius = radius;
+	shape.pointRadius = radius;
+	return(AddShape(shape, std::vector<glm::vec3>(1, glm::vec3(0.0f))));
+}
+
+/***********************************************************
+ *  AddCylinder()
+ *
+ *  This method is used for adding a cylinder shape standing
+ *  along its y axis, tested against other shapes by points
+ *  around the rims of its caps.
+ ***********************************************************/
+int RigidBodySimulation::AddCylinder(float radius, float halfHeight)
+{
+	RIGID_SHAPE shape;
+	shape.type = RIGID_CYLINDER;
+	shape.radius = radius;
+	shape.halfHeight = halfHeight;
+
+	std::vector<glm::vec3> points;
+	for (int i = 0; i < RIGID_CYLINDER_POINTS; i++)
+	{
+		float angle = (6.2831853f * i) / RIGID_CYLINDER_POINTS;
+		points.push_back(glm::vec3(radius * cosf(angle), -halfHeight, radius * sinf(angle)));
+		points.push_back(glm::vec3(radius * cosf(angle), halfHeight, radius * sinf(angle)));
+	}
+	return(AddShape(shape, points));
+}
+
+/***********************************************************
+ *  AddHull()
+ *
+ *  This method is used for adding the convex hull of the
+ *  passed in points.  Every plane through three points that
+ *  has all the points on one side is a face of the hull,
+ *  which is plenty fast for the few dozen points of a prop.
+ *  The points that lie on a face are kept as the points
+ *  tested against other shapes.
+ ***********************************************************/
+int RigidBodySimulation::AddHull(const std::vector<glm::vec3>& points)
+{
+	if ((points.size() < 4) || (points.size() > RIGID_MAX_HULL_POINTS))
+	{
+		std::cout << "Rigid body hulls need 4 to " << RIGID_MAX_HULL_POINTS << " points" << std::endl;
+		return(-1);
+	}
+
+	glm::vec3 boundsMin = points[0];
+	glm::vec3 boundsMax = points[0];
+	for (int i = 1; i < points.size(); i++)
+	{
+		boundsMin = glm::min(boundsMin, points[i]);
+		boundsMax = glm::max(boundsMax, points[i]);
+	}
+	float tolerance = 0.0001f * glm::length(boundsMax - boundsMin);
+
+	RIGID_SHAPE shape;
+	shape.type = RIGID_HULL;
+	for (int i = 0; i < points.size(); i++)
+	{
+		for (int j = i + 1; j < points.size(); j++)
+		{
+			for (int k = j + 1; k < points.size(); k++)
+			{
+				glm::vec3 normal = glm::cross(points[j] - points[i], points[k] - points[i]);
+				float normalLength = glm::length(normal);
+				if (normalLength <= tolerance * tolerance)
+				{
+					continue;
+				}
+				normal /= normalLength;
+				float offset = glm::dot(normal, points[i]);
+
+				// the plane is a face when no point lies on both sides,
+				// and it faces away from the points
+				bool bAbove = false;
+				bool bBelow = false;
+				for (int m = 0; m < points.size(); m++)
+				{
+					float distance = glm::dot(normal, points[m]) - offset;
+					bAbove = bAbove || (distance > tolerance);
+					bBelow = bBelow || (distance < -tolerance);
+				}
+				if (bAbove == bBelow)
+				{
+					continue;
+				}
+				if (bAbove)
+				{
+					normal = -normal;
+					offset = -offset;
+				}
+
+				bool bKnown = false;
+				for (int m = 0; (m < shape.planes.size()) && (bKnown == false); m++)
+				{
+					bKnown = (glm::dot(normal, glm::vec3(shape.planes[m])) > 0.9999f) &&
+						(fabsf(offset - shape.planes[m].w) <= tolerance);
+				}
+				if (bKnown == false)
+				{
+					shape.planes.push_back(glm::vec4(normal, offset));
+				}
+			}
+		}
+	}
+	if (shape.planes.size() < 4)
+	{
+		std::cout << "Rigid body hull points do not enclose any volume" << std::endl;
+		return(-1);
+	}
+
+	std::vector<glm::vec3> surfacePoints;
+	for (int i = 0; i < points.size(); i++)
+	{
+		float distance = -FLT_MAX;
+		for (int j = 0; j < shape.planes.size(); j++)
+		{
+			distance = std::max(distance, glm::dot(glm::vec3(shape.planes[j]), points[i]) - shape.planes[j].w);
+		}
+		if (distance >= -tolerance)
+		{
+			surfacePoints.push_back(points[i]);
+		}
+	}
+	return(AddShape(shape, surfacePoints));
+}
+
+/***********************************************************
+ *  AddShape()
+ *
+ *  This method is used for storing the tested points of a
+ *  shape in groups of four, repeating the last point to
+ *  fill the last group, and for finding the bounds and the
+ *  inertia of the shape.  Hulls take the inertia of the box
+ *  around them, which is close enough for how they tumble.
+ ***********************************************************/
+int RigidBodySimulation::AddShape(RIGID_SHAPE& shape, const std::vector<glm::vec3>& points)
+{
+	shape.pointCount = static_cast<int>(points.size());
+	size_t paddedCount = ((points.size() + 3) / 4) * 4;
+	for (size_t i = 0; i < paddedCount; i++)
+	{
+		const glm::vec3& point = points[std::min(i, points.size() - 1)];
+		shape.pointX.push_back(point.x);
+		shape.pointY.push_back(point.y);
+		shape.pointZ.push_back(point.z);
+	}
+
+	glm::vec3 halfSize;
+	switch (shape.type)
+	{
+	case RIGID_SPHERE:
+		shape.boundsMax = glm::vec3(shape.radius);
+		shape.boundsMin = -shape.boundsMax;
+		shape.unitInertia = glm::vec3(0.4f * shape.radius * shape.radius);
+		break;
+	case RIGID_CYLINDER:
+		shape.boundsMax = glm::vec3(shape.radius, shape.halfHeight, shape.radius);
+		shape.boundsMin = -shape.boundsMax;
+		shape.unitInertia.y = 0.5f * shape.radius * shape.radius;
+		shape.unitInertia.x = ((3.0f * shape.radius * shape.radius) + (4.0f * shape.halfHeight * shape.halfHeight)) / 12.0f;
+		shape.unitInertia.z = shape.unitInertia.x;
+		break;
+	case RIGID_HULL:
+		shape.boundsMin = points[0];
+		shape.boundsMax = points[0];
+		for (int i = 1; i < points.size(); i++)
+		{
+			shape.boundsMin = glm::min(shape.boundsMin, points[i]);
+			shape.boundsMax = glm::max(shape.boundsMax, points[i]);
+		}
+		halfSize = (shape.boundsMax - shape.boundsMin) * 0.5f;
+		shape.unitInertia = glm::vec3(
+			(halfSize.y * halfSize.y) + (halfSize.z * halfSize.z),
+			(halfSize.x * halfSize.x) + (halfSize.z * halfSize.z),
+			(halfSize.x * halfSize.x) + (halfSize.y * halfSize.y)) / 3.0f;
+		break;
+	case RIGID_BOX:
+	default:
+		shape.boundsMax = shape.halfExtents;
+		shape.boundsMin = -shape.halfExtents;
+		halfSize = shape.halfExtents;
+		shape.unitInertia = glm::vec3(
+			(halfSize.y * halfSize.y) + (halfSize.z * halfSize.z),
+			(halfSize.x * halfSize.x) + (halfSize.z * halfSize.z),
+			(halfSize.x * halfSize.x) + (halfSize.y * halfSize.y)) / 3.0f;
+		break;
+	}
+
+	m_shapes.push_back(shape);
+	return(static_cast<int>(m_shapes.size()) - 1);
+}
+
+/***********************************************************
+ *  AddBody()
+ *
+ *  This method is used for adding a body of a shape at the
+ *  passed in place.  Bodies with mass start awake and fall;
+ *  bodies without it are fixed obstacles.  Returns -1 for
+ *  an unknown shape or once the contact keys run out of
+ *  body numbers.
+ ***********************************************************/
+int RigidBodySimulation::AddBody(
+	int shape,
+	glm::vec3 position,
+	const glm::mat3& orientation,
+	float mass,
+	float friction,
+	float restitution)
+{
+	if ((shape < 0) || (shape >= m_shapes.size()) || (m_bodies.size() >= RIGID_MAX_BODIES))
+	{
+		return(-1);
+	}
+
+	RIGID_BODY body;
+	body.shape = shape;
+	body.position = position;
+	body.orientation = orientation;
+	body.linearVelocity = glm::vec3(0.0f);
+	body.angularVelocity = glm::vec3(0.0f);
+	body.inverseMass = (mass > 0.0f) ? (1.0f / mass) : 0.0f;
+	body.inverseInertia = (mass > 0.0f) ? (1.0f / (m_shapes[shape].unitInertia * mass)) : glm::vec3(0.0f);
+	body.friction = friction;
+	body.restitution = restitution;
+	body.sleepTime = 0.0f;
+	body.bAwake = (mass > 0.0f);
+	body.island = -1;
+	UpdateBody(body);
+
+	m_bodies.push_back(body);
+	m_bSortNeeded = true;
+	return(static_cast<int>(m_bodies.size()) - 1);
+}
+
+/***********************************************************
+ *  PlaceBody()
+ *
+ *  This method is used for moving a body to the passed in
+ *  place at rest, waking it up so it falls from there.
+ ***********************************************************/
+void RigidBodySimulation::PlaceBody(int body, glm::vec3 position, const glm::mat3& orientation)
+{
+	if ((body < 0) || (body >= m_bodies.size()))
+	{
+		return;
+	}
+	RIGID_BODY& moved = m_bodies[body];
+	moved.position = position;
+	moved.orientation = orientation;
+	moved.linearVelocity = glm::vec3(0.0f);
+	moved.angularVelocity = glm::vec3(0.0f);
+	moved.sleepTime = 0.0f;
+	moved.bAwake = (moved.inverseMass > 0.0f);
+	UpdateBody(moved);
+}
+
+/***********************************************************
+ *  SetVelocity()
+ *
+ *  This method is used for setting the velocity of a body,
+ *  waking it up if it was asleep.
+ ***********************************************************/
+void RigidBodySimulation::SetVelocity(int body, glm::vec3 linearVelocity, glm::vec3 angularVelocity)
+{
+	if ((body < 0) || (body >= m_bodies.size()) || (m_bodies[body].inverseMass <= 0.0f))
+	{
+		return;
+	}
+	m_bodies[body].linearVelocity = linearVelocity;
+	m_bodies[body].angularVelocity = angularVelocity;
+	m_bodies[body].sleepTime = 0.0f;
+	m_bodies[body].bAwake = true;
+}
+
+/***********************************************************
+ *  GetTransform()
+ *
+ *  This method is used for getting the rotation and the
+ *  position of a body as one matrix.
+ ***********************************************************/
+glm::mat4 RigidBodySimulation::GetTransform(int body) const
+{
+	glm::mat4 transform = glm::mat4(m_bodies[body].orientation);
+	transform[3] = glm::vec4(m_bodies[body].position, 1.0f);
+	return(transform);
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for advancing the bodies by the
+ *  whole steps that fit in the passed in time, carrying
+ *  the remainder over to the next update.
+ ***********************************************************/
+void RigidBodySimulation::Update(float deltaSeconds, JobSystem* pJobSystem)
+{
+	if (m_bodies.size() == 0)
+	{
+		return;
+	}
+
+	m_pendingTime = std::min(m_pendingTime + deltaSeconds, RIGID_STEP_SECONDS * RIGID_MAX_STEPS_PER_UPDATE);
+	while (m_pendingTime >= RIGID_STEP_SECONDS)
+	{
+		Step(RIGID_STEP_SECONDS, pJobSystem);
+		m_pendingTime -= RIGID_STEP_SECONDS;
+	}
+}
+
+/***********************************************************
+ *  Step()
+ *
+ *  This method is used for running one step.  The awake
+ *  bodies are pulled by gravity, then the overlapping
+ *  bounds and the contacts in them are found and the
+ *  touching bodies joined into islands.  Each island is
+ *  solved and moved by one worker, the largest islands
+ *  going first so no worker is left with a big one at the
+ *  end.  The impulses are kept, sorted by contact key, for
+ *  warm starting the next step.
+ ***********************************************************/
+void RigidBodySimulation::Step(float stepSeconds, JobSystem* pJobSystem)
+{
+	glm::vec3 fall = m_settings.gravity * stepSeconds;
+	float linearDamping = 1.0f / (1.0f + (stepSeconds * RIGID_LINEAR_DAMPING));
+	float angularDamping = 1.0f / (1.0f + (stepSeconds * RIGID_ANGULAR_DAMPING));
+	RunRanges(pJobSystem, m_bodies.size(), CountRanges(m_bodies.size(), RIGID_GRAIN_SIZE),
+		[this, fall, linearDamping, angularDamping](size_t /*range*/, size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				RIGID_BODY& body = m_bodies[i];
+				if (body.bAwake)
+				{
+					body.linearVelocity = (body.linearVelocity + fall) * linearDamping;
+					body.angularVelocity *= angularDamping;
+				}
+			}
+		});
+
+	FindPairs(pJobSystem);
+	FindContacts(pJobSystem);
+	BuildIslands();
+
+	RunRanges(pJobSystem, m_islandCount, m_islandCount,
+		[this, stepSeconds](size_t /*range*/, size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				SolveIsland(m_islandOrder[i], stepSeconds);
+				IntegrateIsland(m_islandOrder[i], stepSeconds);
+			}
+		});
+
+	m_cachedImpulses.resize(m_contacts.size());
+	for (int i = 0; i < m_contacts.size(); i++)
+	{
+		const RIGID_CONTACT& contact = m_contacts[i];
+		m_cachedImpulses[i].key = contact.key;
+		m_cachedImpulses[i].normalImpulse = contact.normalImpulse;
+		m_cachedImpulses[i].frictionImpulse = (contact.tangent0 * contact.tangentImpulse0) + (contact.tangent1 * contact.tangentImpulse1);
+	}
+	std::sort(m_cachedImpulses.begin(), m_cachedImpulses.end(),
+		[](const RIGID_CACHED_IMPULSE& a, const RIGID_CACHED_IMPULSE& b) { return(a.key < b.key); });
+
+	m_awakeCount = 0;
+	for (int i = 0; i < m_bodies.size(); i++)
+	{
+		m_awakeCount += m_bodies[i].bAwake ? 1 : 0;
+	}
+}
+
+/***********************************************************
+ *  FindPairs()
+ *
+ *  This method is used for finding the bodies whose bounds
+ *  overlap.  The bodies are kept in order of the low end of
+ *  their bounds along x; they move little between steps, so
+ *  an insertion sort puts them back in order in close to a
+ *  single pass.  Sweeping along the order, each body only
+ *  meets those that start before it ends.  Pairs where
+ *  neither body is awake are skipped, which leaves out every
+ *  pair of sleeping and fixed bodies.  The sweep is split
+ *  across the workers by ranges of the order.
+ ***********************************************************/
+void RigidBodySimulation::FindPairs(JobSystem* pJobSystem)
+{
+	const std::vector<RIGID_BODY>& bodies = m_bodies;
+	if ((m_bSortNeeded) || (m_sortedBodies.size() != bodies.size()))
+	{
+		m_sortedBodies.resize(bodies.size());
+		std::iota(m_sortedBodies.begin(), m_sortedBodies.end(), 0);
+		std::sort(m_sortedBodies.begin(), m_sortedBodies.end(),
+			[&bodies](int a, int b) { return(bodies[a].boundsMin.x < bodies[b].boundsMin.x); });
+		m_bSortNeeded = false;
+	}
+	else
+	{
+		for (size_t i = 1; i < m_sortedBodies.size(); i++)
+		{
+			int body = m_sortedBodies[i];
+			float start = bodies[body].boundsMin.x;
+			size_t j = i;
+			while ((j > 0) && (bodies[m_sortedBodies[j - 1]].boundsMin.x > start))
+			{
+				m_sortedBodies[j] = m_sortedBodies[j - 1];
+				j--;
+			}
+			m_sortedBodies[j] = body;
+		}
+	}
+
+	size_t rangeCount = CountRanges(m_sortedBodies.size(), RIGID_GRAIN_SIZE);
+	std::vector<std::vector<RIGID_PAIR>> rangePairs(rangeCount);
+	RunRanges(pJobSystem, m_sortedBodies.size(), rangeCount,
+		[this, &bodies, &rangePairs](size_t range, size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				int indexA = m_sortedBodies[i];
+				const RIGID_BODY& bodyA = bodies[indexA];
+				for (size_t j = i + 1; j < m_sortedBodies.size(); j++)
+				{
+					int indexB = m_sortedBodies[j];
+					const RIGID_BODY& bodyB = bodies[indexB];
+					if (bodyB.boundsMin.x > bodyA.boundsMax.x)
+					{
+						break;
+					}
+					if (((bodyA.bAwake == false) && (bodyB.bAwake == false)) ||
+						(bodyA.boundsMin.y > bodyB.boundsMax.y) || (bodyB.boundsMin.y > bodyA.boundsMax.y) ||
+						(bodyA.boundsMin.z > bodyB.boundsMax.z) || (bodyB.boundsMin.z > bodyA.boundsMax.z))
+					{
+						continue;
+					}
+
+					RIGID_PAIR pair;
+					pair.bodyA = std::min(indexA, indexB);
+					pair.bodyB = std::max(indexA, indexB);
+					rangePairs[range].push_back(pair);
+				}
+			}
+		});
+
+	m_pairs.clear();
+	for (size_t i = 0; i < rangeCount; i++)
+	{
+		m_pairs.insert(m_pairs.end(), rangePairs[i].begin(), rangePairs[i].end());
+	}
+}
+
+/***********************************************************
+ *  FindContacts()
+ *
+ *  This method is used for testing every pair, and every
+ *  awake body against the ground, for contacts.  The pairs
+ *  and the bodies are run as one list split across the
+ *  workers, each range keeping its contacts in a list of
+ *  its own until they are joined.
+ ***********************************************************/
+void RigidBodySimulation::FindContacts(JobSystem* pJobSystem)
+{
+	size_t count = m_pairs.size() + m_bodies.size();
+	size_t rangeCount = CountRanges(count, RIGID_GRAIN_SIZE);
+	std::vector<std::vector<RIGID_CONTACT>> rangeContacts(rangeCount);
+	RunRanges(pJobSystem, count, rangeCount,
+		[this, &rangeContacts](size_t range, size_t begin, size_t end)
+		{
+			std::vector<RIGID_HIT> hits;
+			for (size_t i = begin; i < end; i++)
+			{
+				if (i < m_pairs.size())
+				{
+					CollidePair(m_pairs[i].bodyA, m_pairs[i].bodyB, hits, rangeContacts[range]);
+				}
+				else if (m_bodies[i - m_pairs.size()].bAwake)
+				{
+					CollideGround(static_cast<int>(i - m_pairs.size()), hits, rangeContacts[range]);
+				}
+			}
+		});
+
+	m_contacts.clear();
+	for (size_t i = 0; i < rangeCount; i++)
+	{
+		m_contacts.insert(m_contacts.end(), rangeContacts[i].begin(), rangeContacts[i].end());
+	}
+}
+
+/***********************************************************
+ *  CollidePair()
+ *
+ *  This method is used for finding where two bodies touch.
+ *  The points of the first body are moved into the space
+ *  of the second and measured against its surface, then
+ *  the other way around, except for two spheres, which
+ *  meet at a single point either way.  Each point found
+ *  is a contact halfway between the two surfaces, with a
+ *  normal from the surface it was found under.
+ ***********************************************************/
+void RigidBodySimulation::CollidePair(int bodyA, int bodyB, std::vector<RIGID_HIT>& hits, std::vector<RIGID_CONTACT>& contacts) const
+{
+	const RIGID_BODY& a = m_bodies[bodyA];
+	const RIGID_BODY& b = m_bodies[bodyB];
+	const RIGID_SHAPE& shapeA = m_shapes[a.shape];
+	const RIGID_SHAPE& shapeB = m_shapes[b.shape];
+	size_t first = contacts.size();
+
+	RIGID_CONTACT contact;
+	contact.bodyA = bodyA;
+	contact.bodyB = bodyB;
+	contact.friction = sqrtf(a.friction * b.friction);
+	contact.restitution = std::max(a.restitution, b.restitution);
+	uint64_t pairKey = (static_cast<uint64_t>(bodyA) << 44) | (static_cast<uint64_t>(bodyB) << 24);
+
+	for (int direction = 0; direction < 2; direction++)
+	{
+		if ((direction == 1) && (shapeA.type == RIGID_SPHERE) && (shapeB.type == RIGID_SPHERE))
+		{
+			break;
+		}
+		const RIGID_BODY& pointBody = (direction == 0) ? a : b;
+		const RIGID_BODY& surfaceBody = (direction == 0) ? b : a;
+		const RIGID_SHAPE& pointShape = m_shapes[pointBody.shape];
+		const RIGID_SHAPE& surfaceShape = m_shapes[surfaceBody.shape];
+
+		glm::mat3 toSurface = glm::transpose(surfaceBody.orientation);
+		TestPoints(pointShape, toSurface * pointBody.orientation,
+			toSurface * (pointBody.position - surfaceBody.position), &surfaceShape, hits);
+		for (int i = 0; i < hits.size(); i++)
+		{
+			// the normal leaves the surface toward the tested point
+			glm::vec3 normal = surfaceBody.orientation * ShapeNormal(surfaceShape, hits[i].localPoint);
+			glm::vec3 point = surfaceBody.position + (surfaceBody.orientation * hits[i].localPoint);
+			point -= normal * (pointShape.pointRadius + (hits[i].distance * 0.5f));
+
+			contact.key = pairKey | (static_cast<uint64_t>(direction) << 23) | static_cast<uint64_t>(hits[i].point);
+			contact.point = point;
+			contact.normal = (direction == 0) ? normal : -normal;
+			contact.overlap = -hits[i].distance;
+			contacts.push_back(contact);
+		}
+	}
+	ReduceContacts(contacts, first);
+}
+
+/***********************************************************
+ *  CollideGround()
+ *
+ *  This method is used for finding where a body touches the
+ *  ground.  The points are moved into the space of the
+ *  ground plane and only those over the rectangle count,
+ *  so bodies pushed off its edge fall.
+ ***********************************************************/
+void RigidBodySimulation::CollideGround(int body, std::vector<RIGID_HIT>& hits, std::vector<RIGID_CONTACT>& contacts) const
+{
+	const RIGID_BODY& a = m_bodies[body];
+	const RIGID_SHAPE& shape = m_shapes[a.shape];
+	if (a.boundsMin.y > m_settings.groundHeight)
+	{
+		return;
+	}
+	size_t first = contacts.size();
+
+	RIGID_CONTACT contact;
+	contact.bodyA = body;
+	contact.bodyB = -1;
+	contact.normal = glm::vec3(0.0f, 1.0f, 0.0f);
+	contact.friction = sqrtf(a.friction * m_settings.groundFriction);
+	contact.restitution = a.restitution;
+	uint64_t pairKey = (static_cast<uint64_t>(body) << 44) | (RIGID_GROUND_KEY << 24);
+
+	glm::vec3 ground = glm::vec3(0.0f, m_settings.groundHeight, 0.0f);
+	TestPoints(shape, a.orientation, a.position - ground, NULL, hits);
+	for (int i = 0; i < hits.size(); i++)
+	{
+		glm::vec3 point = hits[i].localPoint + ground;
+		if ((point.x < m_settings.groundMin.x) || (point.x > m_settings.groundMax.x) ||
+			(point.z < m_settings.groundMin.y) || (point.z > m_settings.groundMax.y))
+		{
+			continue;
+		}
+
+		point.y -= shape.pointRadius + (hits[i].distance * 0.5f);
+		contact.key = pairKey | static_cast<uint64_t>(hits[i].point);
+		contact.point = point;
+		contact.overlap = -hits[i].distance;
+		contacts.push_back(contact);
+	}
+	ReduceContacts(contacts, first);
+}
+
+/***********************************************************
+ *  TestPoints()
+ *
+ *  This method is used for finding the points of a shape
+ *  that lie inside or within the contact margin of another
+ *  shape, or of the ground plane at zero height when there
+ *  is no other shape.  With SSE four points are moved and
+ *  measured at once, and only those close enough are
+ *  looked at one by one.  The distances are from the
+ *  surface of the tested shape, less the sphere radius.
+ ***********************************************************/
+void RigidBodySimulation::TestPoints(
+	const RIGID_SHAPE& pointShape,
+	const glm::mat3& rotation,
+	glm::vec3 offset,
+	const RIGID_SHAPE* pSurfaceShape,
+	std::vector<RIGID_HIT>& hits) const
+{
+	hits.clear();
+	float reach = m_settings.contactMargin + pointShape.pointRadius;
+
+#ifdef RIGID_SSE
+	const __m128 r00 = _mm_set1_ps(rotation[0][0]);
+	const __m128 r01 = _mm_set1_ps(rotation[0][1]);
+	const __m128 r02 = _mm_set1_ps(rotation[0][2]);
+	const __m128 r10 = _mm_set1_ps(rotation[1][0]);
+	const __m128 r11 = _mm_set1_ps(rotation[1][1]);
+	const __m128 r12 = _mm_set1_ps(rotation[1][2]);
+	const __m128 r20 = _mm_set1_ps(rotation[2][0]);
+	const __m128 r21 = _mm_set1_ps(rotation[2][1]);
+	const __m128 r22 = _mm_set1_ps(rotation[2][2]);
+	const __m128 offsetX = _mm_set1_ps(offset.x);
+	const __m128 offsetY = _mm_set1_ps(offset.y);
+	const __m128 offsetZ = _mm_set1_ps(offset.z);
+	const __m128 reachV = _mm_set1_ps(reach);
+	float localX[4];
+	float localY[4];
+	float localZ[4];
+	float distances[4];
+
+	for (int first = 0; first < pointShape.pointCount; first += 4)
+	{
+		__m128 x = _mm_loadu_ps(&pointShape.pointX[first]);
+		__m128 y = _mm_loadu_ps(&pointShape.pointY[first]);
+		__m128 z = _mm_loadu_ps(&pointShape.pointZ[first]);
+		__m128 lx = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(r00, x), _mm_mul_ps(r10, y)), _mm_mul_ps(r20, z)), offsetX);
+		__m128 ly = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(r01, x), _mm_mul_ps(r11, y)), _mm_mul_ps(r21, z)), offsetY);
+		__m128 lz = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(r02, x), _mm_mul_ps(r12, y)), _mm_mul_ps(r22, z)), offsetZ);
+
+		__m128 distance = ly;
+		if (NULL != pSurfaceShape)
+		{
+			switch (pSurfaceShape->type)
+			{
+			case RIGID_SPHERE:
+				distance = SphereDistance4(lx, ly, lz, pSurfaceShape->radius);
+				break;
+			case RIGID_CYLINDER:
+				distance = CylinderDistance4(lx, ly, lz, pSurfaceShape->radius, pSurfaceShape->halfHeight);
+				break;
+			case RIGID_HULL:
+				distance = HullDistance4(lx, ly, lz, pSurfaceShape->planes);
+				break;
+			case RIGID_BOX:
+			default:
+				distance = BoxDistance4(lx, ly, lz, pSurfaceShape->halfExtents);
+				break;
+			}
+		}
+
+		int mask = _mm_movemask_ps(_mm_cmplt_ps(distance, reachV));
+		if (mask == 0)
+		{
+			continue;
+		}
+		_mm_storeu_ps(localX, lx);
+		_mm_storeu_ps(localY, ly);
+		_mm_storeu_ps(localZ, lz);
+		_mm_storeu_ps(distances, distance);
+		for (int lane = 0; (lane < 4) && (first + lane < pointShape.pointCount); lane++)
+		{
+			if ((mask & (1 << lane)) != 0)
+			{
+				RIGID_HIT hit;
+				hit.point = first + lane;
+				hit.localPoint = glm::vec3(localX[lane], localY[lane], localZ[lane]);
+				hit.distance = distances[lane] - pointShape.pointRadius;
+				hits.push_back(hit);
+			}
+		}
+	}
+#else
+	for (int i = 0; i < pointShape.pointCount; i++)
+	{
+		glm::vec3 local = (rotation * glm::vec3(pointShape.pointX[i], pointShape.pointY[i], pointShape.pointZ[i])) + offset;
+		float distance = (NULL != pSurfaceShape) ? ShapeDistance(*pSurfaceShape, local) : local.y;
+		if (distance < reach)
+		{
+			RIGID_HIT hit;
+			hit.point = i;
+			hit.localPoint = local;
+			hit.distance = distance - pointShape.pointRadius;
+			hits.push_back(hit);
+		}
+	}
+#endif
+}
+
+/***********************************************************
+ *  ReduceContacts()
+ *
+ *  This method is used for keeping only a few contacts of
+ *  one pair, past the passed in first contact.  The deepest
+ *  is kept, then each next one is the contact farthest from
+ *  those already kept, so the kept contacts still span the
+ *  whole area the bodies touch over.
+ ***********************************************************/
+void RigidBodySimulation::ReduceContacts(std::vector<RIGID_CONTACT>& contacts, size_t first) const
+{
+	size_t count = contacts.size() - first;
+	if (count <= RIGID_MAX_PAIR_CONTACTS)
+	{
+		return;
+	}
+
+	size_t deepest = first;
+	for (size_t i = first + 1; i < contacts.size(); i++)
+	{
+		if (contacts[i].overlap > contacts[deepest].overlap)
+		{
+			deepest = i;
+		}
+	}
+	std::swap(contacts[first], contacts[deepest]);
+
+	for (size_t kept = 1; kept < RIGID_MAX_PAIR_CONTACTS; kept++)
+	{
+		size_t farthest = first + kept;
+		float farthestDistance = -1.0f;
+		for (size_t i = first + kept; i < contacts.size(); i++)
+		{
+			float nearest = FLT_MAX;
+			for (size_t j = first; j < first + kept; j++)
+			{
+				glm::vec3 difference = contacts[i].point - contacts[j].point;
+				nearest = std::min(nearest, glm::dot(difference, difference));
+			}
+			if (nearest > farthestDistance)
+			{
+				farthestDistance = nearest;
+				farthest = i;
+			}
+		}
+		std::swap(contacts[first + kept], contacts[farthest]);
+	}
+	contacts.resize(first + RIGID_MAX_PAIR_CONTACTS);
+}
+
+/***********************************************************
+ *  WarmStart()
+ *
+ *  This method is used for starting a contact from the
+ *  impulses the same contact ended the last step with.  The
+ *  friction impulse was kept as a world direction, since
+ *  the tangents of the contact may have turned since.
+ ***********************************************************/
+void RigidBodySimulation::WarmStart(RIGID_CONTACT& contact) const
+{
+	contact.normalImpulse = 0.0f;
+	contact.tangentImpulse0 = 0.0f;
+	contact.tangentImpulse1 = 0.0f;
+
+	std::vector<RIGID_CACHED_IMPULSE>::const_iterator found = std::lower_bound(
+		m_cachedImpulses.begin(), m_cachedImpulses.end(), contact.key,
+		[](const RIGID_CACHED_IMPULSE& cached, uint64_t key) { return(cached.key < key); });
+	if ((found != m_cachedImpulses.end()) && (found->key == contact.key))
+	{
+		contact.normalImpulse = found->normalImpulse;
+		contact.tangentImpulse0 = glm::dot(found->frictionImpulse, contact.tangent0);
+		contact.tangentImpulse1 = glm::dot(found->frictionImpulse, contact.tangent1);
+	}
+}
+
+/***********************************************************
+ *  BuildIslands()
+ *
+ *  This method is used for joining the bodies that touch
+ *  into islands with a union-find over the contacts.  Fixed
+ *  bodies join nothing, since nothing passes through them.
+ *  The awake bodies and those they touch take part in the
+ *  step, gathered island by island along with the contacts
+ *  of each island.  An island holding a sleeping body was
+ *  touched by one that is awake, so the whole island wakes.
+ ***********************************************************/
+void RigidBodySimulation::BuildIslands()
+{
+	std::vector<int>& parents = m_islandParents;
+	parents.resize(m_bodies.size());
+	std::iota(parents.begin(), parents.end(), 0);
+	auto findRoot = [&parents](int body)
+		{
+			while (parents[body] != body)
+			{
+				parents[body] = parents[parents[body]];
+				body = parents[body];
+			}
+			return(body);
+		};
+
+	for (int i = 0; i < m_bodies.size(); i++)
+	{
+		m_bodies[i].island = m_bodies[i].bAwake ? 0 : -1;
+	}
+	for (int i = 0; i < m_contacts.size(); i++)
+	{
+		const RIGID_CONTACT& contact = m_contacts[i];
+		bool bMovingA = (m_bodies[contact.bodyA].inverseMass > 0.0f);
+		bool bMovingB = (contact.bodyB >= 0) && (m_bodies[contact.bodyB].inverseMass > 0.0f);
+		if (bMovingA)
+		{
+			m_bodies[contact.bodyA].island = 0;
+		}
+		if (bMovingB)
+		{
+			m_bodies[contact.bodyB].island = 0;
+		}
+		if (bMovingA && bMovingB)
+		{
+			int rootA = findRoot(contact.bodyA);
+			int rootB = findRoot(contact.bodyB);
+			if (rootA != rootB)
+			{
+				parents[rootA] = rootB;
+			}
+		}
+	}
+
+	// number the islands in the order their first body comes
+	std::vector<int> rootIslands(m_bodies.size(), -1);
+	m_islandCount = 0;
+	for (int i = 0; i < m_bodies.size(); i++)
+	{
+		if (m_bodies[i].island < 0)
+		{
+			continue;
+		}
+		int root = findRoot(i);
+		if (rootIslands[root] < 0)
+		{
+			rootIslands[root] = m_islandCount++;
+		}
+		m_bodies[i].island = rootIslands[root];
+	}
+
+	// gather the bodies and the contacts of each island
+	m_islandBodyStarts.assign(m_islandCount + 1, 0);
+	m_islandContactStarts.assign(m_islandCount + 1, 0);
+	for (int i = 0; i < m_bodies.size(); i++)
+	{
+		if (m_bodies[i].island >= 0)
+		{
+			m_islandBodyStarts[m_bodies[i].island + 1]++;
+		}
+	}
+	std::vector<int> contactIslands(m_contacts.size());
+	for (int i = 0; i < m_contacts.size(); i++)
+	{
+		const RIGID_CONTACT& contact = m_contacts[i];
+		contactIslands[i] = (m_bodies[contact.bodyA].inverseMass > 0.0f) ?
+			m_bodies[contact.bodyA].island : m_bodies[contact.bodyB].island;
+		m_islandContactStarts[contactIslands[i] + 1]++;
+	}
+	for (int i = 0; i < m_islandCount; i++)
+	{
+		m_islandBodyStarts[i + 1] += m_islandBodyStarts[i];
+		m_islandContactStarts[i + 1] += m_islandContactStarts[i];
+	}
+
+	std::vector<int> bodyCursors(m_islandBodyStarts.begin(), m_islandBodyStarts.end() - 1);
+	std::vector<int> contactCursors(m_islandContactStarts.begin(), m_islandContactStarts.end() - 1);
+	m_islandBodies.resize(m_islandBodyStarts[m_islandCount]);
+	m_islandContacts.resize(m_contacts.size());
+	for (int i = 0; i < m_bodies.size(); i++)
+	{
+		RIGID_BODY& body = m_bodies[i];
+		if (body.island >= 0)
+		{
+			m_islandBodies[bodyCursors[body.island]++] = i;
+			if (body.bAwake == false)
+			{
+				body.bAwake = true;
+				body.sleepTime = 0.0f;
+			}
+		}
+	}
+	for (int i = 0; i < m_contacts.size(); i++)
+	{
+		m_islandContacts[contactCursors[contactIslands[i]]++] = m_contacts[i];
+	}
+	m_contacts.swap(m_islandContacts);
+
+	m_islandOrder.resize(m_islandCount);
+	std::iota(m_islandOrder.begin(), m_islandOrder.end(), 0);
+	std::sort(m_islandOrder.begin(), m_islandOrder.end(), [this](int a, int b)
+		{
+			return((m_islandContactStarts[a + 1] - m_islandContactStarts[a]) >
+				(m_islandContactStarts[b + 1] - m_islandContactStarts[b]));
+		});
+}
+
+/***********************************************************
+ *  SolveIsland()
+ *
+ *  This method is used for solving the contacts of one
+ *  island with sequential impulses.  Each contact gets its
+ *  masses along the normal and two tangents and the speed
+ *  it should separate at, to push out part of the overlap
+ *  or to bounce, and is warm started.  Then every pass
+ *  limits the friction of each contact to its share of the
+ *  normal impulse and stops the contact from closing.
+ ***********************************************************/
+void RigidBodySimulation::SolveIsland(int island, float stepSeconds)
+{
+	int begin = m_islandContactStarts[island];
+	int end = m_islandContactStarts[island + 1];
+
+	for (int i = begin; i < end; i++)
+	{
+		RIGID_CONTACT& contact = m_contacts[i];
+		RIGID_BODY& bodyA = m_bodies[contact.bodyA];
+		RIGID_BODY* pBodyB = (contact.bodyB >= 0) ? &m_bodies[contact.bodyB] : NULL;
+
+		contact.offsetA = contact.point - bodyA.position;
+		contact.offsetB = (NULL != pBodyB) ? (contact.point - pBodyB->position) : glm::vec3(0.0f);
+		const glm::vec3& normal = contact.normal;
+		contact.tangent0 = (fabsf(normal.x) > 0.57735f) ?
+			glm::normalize(glm::vec3(normal.y, -normal.x, 0.0f)) :
+			glm::normalize(glm::vec3(0.0f, normal.z, -normal.y));
+		contact.tangent1 = glm::cross(normal, contact.tangent0);
+		contact.normalMass = PrepareDirection(bodyA, pBodyB, contact.offsetA, contact.offsetB,
+			normal, contact.turnA[0], contact.turnB[0]);
+		contact.tangentMass0 = PrepareDirection(bodyA, pBodyB, contact.offsetA, contact.offsetB,
+			contact.tangent0, contact.turnA[1], contact.turnB[1]);
+		contact.tangentMass1 = PrepareDirection(bodyA, pBodyB, contact.offsetA, contact.offsetB,
+			contact.tangent1, contact.turnA[2], contact.turnB[2]);
+
+		float closingSpeed = glm::dot(RelativeVelocity(bodyA, pBodyB, contact.offsetA, contact.offsetB), normal);
+		// a contact still apart may close the gap within the step, so
+		// bodies land on each other instead of stopping at the margin
+		contact.bias = (m_settings.overlapCorrection / stepSeconds) * std::max(contact.overlap - m_settings.allowedOverlap, 0.0f);
+		if (contact.overlap < 0.0f)
+		{
+			contact.bias = contact.overlap / stepSeconds;
+		}
+		if (closingSpeed < -RIGID_BOUNCE_SPEED)
+		{
+			contact.bias = std::max(contact.bias, -contact.restitution * closingSpeed);
+		}
+
+		WarmStart(contact);
+		ApplyImpulse(bodyA, pBodyB,
+			(normal * contact.normalImpulse) + (contact.tangent0 * contact.tangentImpulse0) + (contact.tangent1 * contact.tangentImpulse1),
+			(contact.turnA[0] * contact.normalImpulse) + (contact.turnA[1] * contact.tangentImpulse0) + (contact.turnA[2] * contact.tangentImpulse1),
+			(contact.turnB[0] * contact.normalImpulse) + (contact.turnB[1] * contact.tangentImpulse0) + (contact.turnB[2] * contact.tangentImpulse1));
+	}
+
+	for (int iteration = 0; iteration < m_settings.iterations; iteration++)
+	{
+		for (int i = begin; i < end; i++)
+		{
+			RIGID_CONTACT& contact = m_contacts[i];
+			RIGID_BODY& bodyA = m_bodies[contact.bodyA];
+			RIGID_BODY* pBodyB = (contact.bodyB >= 0) ? &m_bodies[contact.bodyB] : NULL;
+
+			// friction, limited by the normal impulse of the last pass
+			float limit = contact.friction * contact.normalImpulse;
+			glm::vec3 velocity = RelativeVelocity(bodyA, pBodyB, contact.offsetA, contact.offsetB);
+			float impulse0 = std::clamp(contact.tangentImpulse0 - (glm::dot(velocity, contact.tangent0) * contact.tangentMass0), -limit, limit);
+			float impulse1 = std::clamp(contact.tangentImpulse1 - (glm::dot(velocity, contact.tangent1) * contact.tangentMass1), -limit, limit);
+			float change0 = impulse0 - contact.tangentImpulse0;
+			float change1 = impulse1 - contact.tangentImpulse1;
+			ApplyImpulse(bodyA, pBodyB,
+				(contact.tangent0 * change0) + (contact.tangent1 * change1),
+				(contact.turnA[1] * change0) + (contact.turnA[2] * change1),
+				(contact.turnB[1] * change0) + (contact.turnB[2] * change1));
+			contact.tangentImpulse0 = impulse0;
+			contact.tangentImpulse1 = impulse1;
+
+			// the bodies may only be pushed apart
+			velocity = RelativeVelocity(bodyA, pBodyB, contact.offsetA, contact.offsetB);
+			float impulse = std::max(contact.normalImpulse + ((contact.bias - glm::dot(velocity, contact.normal)) * contact.normalMass), 0.0f);
+			float change = impulse - contact.normalImpulse;
+			ApplyImpulse(bodyA, pBodyB, contact.normal * change, contact.turnA[0] * change, contact.turnB[0] * change);
+			contact.normalImpulse = impulse;
+		}
+	}
+}
+
+/***********************************************************
+ *  IntegrateIsland()
+ *
+ *  This method is used for moving and turning the bodies of
+ *  one island by their velocities.  The island falls asleep
+ *  once every body in it was slow for the sleep time, and
+ *  bodies that fell below the floor height are frozen.
+ ***********************************************************/
+void RigidBodySimulation::IntegrateIsland(int island, float stepSeconds)
+{
+	float sleepSpeedSquared = m_settings.sleepSpeed * m_settings.sleepSpeed;
+	bool bAtRest = true;
+	for (int i = m_islandBodyStarts[island]; i < m_islandBodyStarts[island + 1]; i++)
+	{
+		RIGID_BODY& body = m_bodies[m_islandBodies[i]];
+		body.position += body.linearVelocity * stepSeconds;
+
+		// turn the axes by the angular velocity and square them up again
+		glm::vec3 turn = body.angularVelocity * stepSeconds;
+		glm::mat3& axes = body.orientation;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			axes[axis] += glm::cross(turn, axes[axis]);
+		}
+		axes[0] = glm::normalize(axes[0]);
+		axes[1] = glm::normalize(axes[1] - (axes[0] * glm::dot(axes[0], axes[1])));
+		axes[2] = glm::cross(axes[0], axes[1]);
+		UpdateBody(body);
+
+		if ((glm::dot(body.linearVelocity, body.linearVelocity) < sleepSpeedSquared) &&
+			(glm::dot(body.angularVelocity, body.angularVelocity) < sleepSpeedSquared))
+		{
+			body.sleepTime += stepSeconds;
+		}
+		else
+		{
+			body.sleepTime = 0.0f;
+		}
+		if (body.position.y < m_settings.floorHeight)
+		{
+			body.bAwake = false;
+			body.linearVelocity = glm::vec3(0.0f);
+			body.angularVelocity = glm::vec3(0.0f);
+		}
+		bAtRest = bAtRest && (body.sleepTime >= m_settings.sleepSeconds);
+	}
+
+	for (int i = m_islandBodyStarts[island]; (bAtRest) && (i < m_islandBodyStarts[island + 1]); i++)
+	{
+		RIGID_BODY& body = m_bodies[m_islandBodies[i]];
+		body.bAwake = false;
+		body.linearVelocity = glm::vec3(0.0f);
+		body.angularVelocity = glm::vec3(0.0f);
+	}
+}
+
+/***********************************************************
+ *  UpdateBody()
+ *
+ *  This method is used for turning the inertia of a body
+ *  into world space and for finding its world bounds from
+ *  the bounds of its shape, grown by the contact margin.
+ ***********************************************************/
+void RigidBodySimulation::UpdateBody(RIGID_BODY& body) const
+{
+	const glm::mat3& axes = body.orientation;
+	glm::mat3 scaled = axes;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		scaled[axis] *= body.inverseInertia[axis];
+	}
+	body.inverseInertiaWorld = scaled * glm::transpose(axes);
+
+	const RIGID_SHAPE& shape = m_shapes[body.shape];
+	glm::vec3 center = body.position + (axes * ((shape.boundsMin + shape.boundsMax) * 0.5f));
+	glm::vec3 halfSize = (shape.boundsMax - shape.boundsMin) * 0.5f;
+	glm::vec3 extent = (glm::abs(axes[0]) * halfSize.x) + (glm::abs(axes[1]) * halfSize.y) + (glm::abs(axes[2]) * halfSize.z);
+	extent += glm::vec3(m_settings.contactMargin);
+	body.boundsMin = center - extent;
+	body.boundsMax = center + extent;
+}
+
+/***********************************************************
+ *  ShapeDistance()
+ *
+ *  This method is used for measuring the signed distance
+ *  from a local point to the surface of a shape, the same
+ *  way the vectorized tests do.
+ ***********************************************************/
+float RigidBodySimulation::ShapeDistance(const RIGID_SHAPE& shape, glm::vec3 point)
+{
+	float distance = 0.0f;
+	glm::vec3 outside;
+	glm::vec3 q;
+	float side;
+	float cap;
+	switch (shape.type)
+	{
+	case RIGID_SPHERE:
+		distance = glm::length(point) - shape.radius;
+		break;
+	case RIGID_CYLINDER:
+		side = sqrtf((point.x * point.x) + (point.z * point.z)) - shape.radius;
+		cap = fabsf(point.y) - shape.halfHeight;
+		distance = std::min(std::max(side, cap), 0.0f) +
+			sqrtf((std::max(side, 0.0f) * std::max(side, 0.0f)) + (std::max(cap, 0.0f) * std::max(cap, 0.0f)));
+		break;
+	case RIGID_HULL:
+		distance = -FLT_MAX;
+		for (int i = 0; i < shape.planes.size(); i++)
+		{
+			distance = std::max(distance, glm::dot(glm::vec3(shape.planes[i]), point) - shape.planes[i].w);
+		}
+		break;
+	case RIGID_BOX:
+	default:
+		q = glm::abs(point) - shape.halfExtents;
+		outside = glm::max(q, glm::vec3(0.0f));
+		distance = glm::length(outside) + std::min(std::max(q.x, std::max(q.y, q.z)), 0.0f);
+		break;
+	}
+	return(distance);
+}
+
+/***********************************************************
+ *  ShapeNormal()
+ *
+ *  This method is used for finding the outward direction
+ *  of the surface of a shape nearest to a local point.
+ *  Outside a box or a cylinder it points from the nearest
+ *  surface point, and inside along the nearest face.
+ ***********************************************************/
+glm::vec3 RigidBodySimulation::ShapeNormal(const RIGID_SHAPE& shape, glm::vec3 point)
+{
+	glm::vec3 normal = glm::vec3(0.0f, 1.0f, 0.0f);
+	glm::vec3 q;
+	glm::vec3 radial;
+	glm::vec3 capDirection;
+	float radialLength;
+	float side;
+	float cap;
+	float farthest;
+	switch (shape.type)
+	{
+	case RIGID_SPHERE:
+		if (glm::dot(point, point) > 0.0f)
+		{
+			normal = glm::normalize(point);
+		}
+		break;
+	case RIGID_CYLINDER:
+		radialLength = sqrtf((point.x * point.x) + (point.z * point.z));
+		radial = (radialLength > 0.0f) ? (glm::vec3(point.x, 0.0f, point.z) / radialLength) : glm::vec3(1.0f, 0.0f, 0.0f);
+		capDirection = glm::vec3(0.0f, SignOf(point.y), 0.0f);
+		side = radialLength - shape.radius;
+		cap = fabsf(point.y) - shape.halfHeight;
+		if ((side > 0.0f) || (cap > 0.0f))
+		{
+			normal = glm::normalize((radial * std::max(side, 0.0f)) + (capDirection * std::max(cap, 0.0f)));
+		}
+		else
+		{
+			normal = (side > cap) ? radial : capDirection;
+		}
+		break;
+	case RIGID_HULL:
+		farthest = -FLT_MAX;
+		for (int i = 0; i < shape.planes.size(); i++)
+		{
+			float distance = glm::dot(glm::vec3(shape.planes[i]), point) - shape.planes[i].w;
+			if (distance > farthest)
+			{
+				farthest = distance;
+				normal = glm::vec3(shape.planes[i]);
+			}
+		}
+		break;
+	case RIGID_BOX:
+	default:
+		q = glm::abs(point) - shape.halfExtents;
+		if ((q.x > 0.0f) || (q.y > 0.0f) || (q.z > 0.0f))
+		{
+			normal = glm::max(q, glm::vec3(0.0f));
+			normal = glm::normalize(glm::vec3(normal.x * SignOf(point.x), normal.y * SignOf(point.y), normal.z * SignOf(point.z)));
+		}
+		else if ((q.x >= q.y) && (q.x >= q.z))
+		{
+			normal = glm::vec3(SignOf(point.x), 0.0f, 0.0f);
+		}
+		else if (q.y >= q.z)
+		{
+			normal = glm::vec3(0.0f, SignOf(point.y), 0.0f);
+		}
+		else
+		{
+			normal = glm::vec3(0.0f, 0.0f, SignOf(point.z));
+		}
+		break;
+	}
+	return(normal);
+}
+
+/***********************************************************
+ *  Benchmark()
+ *
+ *  This method is used for timing ten thousand props of
+ *  every shape dropped in layers onto a table, against the
+ *  number of threads.  Each run starts from the same props
+ *  and reports the average and the slowest step, and how
+ *  many props are still awake at the end.
+ ***********************************************************/
+void RigidBodySimulation::Benchmark()
+{
+	const int propCount = 10000;
+	const int stepCount = 300;
+	unsigned int coreCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+	std::vector<unsigned int> threadCounts;
+	for (unsigned int threads = 1; threads < coreCount; threads *= 2)
+	{
+		threadCounts.push_back(threads);
+	}
+	threadCounts.push_back(coreCount);
+
+#ifdef RIGID_SSE
+	std::cout << "Rigid body benchmark, SSE narrowphase, " << propCount << " props" << std::endl;
+#else
+	std::cout << "Rigid body benchmark, scalar narrowphase, " << propCount << " props" << std::endl;
+#endif
+	std::cout << "threads  step ms  slowest ms  awake  pairs  contacts  islands" << std::endl;
+
+	for (int t = 0; t < threadCounts.size(); t++)
+	{
+		// the calling thread works too, so one fewer worker
+		JobSystem* pJobSystem = NULL;
+		if (threadCounts[t] > 1)
+		{
+			pJobSystem = new JobSystem(threadCounts[t] - 1);
+		}
+
+		RIGID_BODY_SETTINGS settings;
+		settings.groundHeight = 0.0f;
+		settings.groundMin = glm::vec2(-25.0f, -15.0f);
+		settings.groundMax = glm::vec2(25.0f, 15.0f);
+		RigidBodySimulation simulation;
+		simulation.Initialize(settings);
+
+		// a lure is the hull of points around a slender spindle
+		std::vector<glm::vec3> lurePoints;
+		for (int i = 0; i < 8; i++)
+		{
+			float angle = (6.2831853f * i) / 8.0f;
+			lurePoints.push_back(glm::vec3(-0.1f, 0.06f * cosf(angle), 0.06f * sinf(angle)));
+			lurePoints.push_back(glm::vec3(0.1f, 0.04f * cosf(angle), 0.04f * sinf(angle)));
+		}
+		lurePoints.push_back(glm::vec3(-0.25f, 0.0f, 0.0f));
+		lurePoints.push_back(glm::vec3(0.25f, 0.0f, 0.0f));
+		int shapes[4] = {
+			simulation.AddBox(glm::vec3(0.2f, 0.15f, 0.25f)),
+			simulation.AddSphere(0.2f),
+			simulation.AddCylinder(0.15f, 0.2f),
+			simulation.AddHull(lurePoints) };
+
+		// layers of props over the table, each turned at random
+		std::mt19937 random(11);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		const int columns = 50;
+		const int rows = 30;
+		for (int i = 0; i < propCount; i++)
+		{
+			int layer = i / (columns * rows);
+			int row = (i / columns) % rows;
+			int column = i % columns;
+			glm::vec3 position = glm::vec3(
+				-19.6f + (column * 0.8f) + (0.1f * unit(random)),
+				0.5f + (layer * 0.8f),
+				-11.6f + (row * 0.8f) + (0.1f * unit(random)));
+			glm::vec3 axis = glm::vec3(unit(random), unit(random), unit(random)) + glm::vec3(0.0f, 0.01f, 0.0f);
+			glm::mat3 orientation = glm::mat3(glm::rotate(3.14159265f * unit(random), glm::normalize(axis)));
+			simulation.AddBody(shapes[i % 4], position, orientation, 1.0f);
+		}
+
+		double totalMilliseconds = 0.0;
+		double slowestMilliseconds = 0.0;
+		for (int i = 0; i < stepCount; i++)
+		{
+			std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+			simulation.Update(RIGID_STEP_SECONDS, pJobSystem);
+			double milliseconds = std::chrono::duration<double, std::milli>(
+				std::chrono::steady_clock::now() - startTime).count();
+			totalMilliseconds += milliseconds;
+			slowestMilliseconds = std::max(slowestMilliseconds, milliseconds);
+		}
+
+		std::cout << threadCounts[t] << "\t " << (totalMilliseconds / stepCount) << "\t  " << slowestMilliseconds
+			<< "\t      " << simulation.GetAwakeCount() << "  " << simulation.GetPairCount()
+			<< "  " << simulation.GetContactCount() << "  " << simulation.GetIslandCount() << std::endl;
+		delete pJobSystem;
+	}
+}
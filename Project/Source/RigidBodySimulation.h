@@ -0,0 +1,293 @@
+///////////////////////////////////////////////////////////////////////////////
+// rigidbodysimulation.h
+// ============
+// knock tabletop props around as rigid bodies on the worker threads
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "JobSystem.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// shapes of the bodies, matching the basic meshes
+enum RIGID_SHAPE_TYPE
+{
+	RIGID_BOX,
+	RIGID_SPHERE,
+	RIGID_CYLINDER,
+	RIGID_HULL
+};
+
+// behavior of the bodies and the ground they land on, in world units
+// (meters) and seconds
+struct RIGID_BODY_SETTINGS
+{
+	glm::vec3 gravity = glm::vec3(0.0f, -9.81f, 0.0f);
+	// passes of the contact solver over every island in each step
+	int iterations = 8;
+	// fraction of the overlap pushed apart in each step, and the
+	// overlap left alone so resting bodies do not jitter
+	float overlapCorrection = 0.2f;
+	float allowedOverlap = 0.01f;
+	// bodies closer than this already touch, so resting contacts
+	// stay found from one step to the next
+	float contactMargin = 0.02f;
+	// bodies slower than this for the passed in time fall asleep
+	float sleepSpeed = 0.08f;
+	float sleepSeconds = 0.5f;
+	// rectangle of ground the bodies rest on, at the passed in height
+	float groundHeight = 0.0f;
+	glm::vec2 groundMin = glm::vec2(-1.0f);
+	glm::vec2 groundMax = glm::vec2(1.0f);
+	float groundFriction = 0.6f;
+	// bodies that fell this far are frozen where they are
+	float floorHeight = -50.0f;
+};
+
+/***********************************************************
+ *  RigidBodySimulation
+ *
+ *  This class moves boxes, spheres, cylinders and convex
+ *  hulls under gravity, colliding with each other and with
+ *  a rectangle of ground.  Every step the bounds of the
+ *  moving bodies are swept along x, kept sorted from the
+ *  last step by insertion sort, to find the pairs that may
+ *  touch.  Each shape carries a set of surface points, and
+ *  a pair is tested by moving the points of each body into
+ *  the other one and measuring their distance to its
+ *  surface, four points at a time with SSE.  Touching
+ *  bodies are joined into islands, which are solved with
+ *  sequential impulses on the workers, warm started from
+ *  the impulses of the last step.  Islands that come to
+ *  rest fall asleep and cost nothing until something
+ *  awake touches them.
+ ***********************************************************/
+class RigidBodySimulation
+{
+public:
+	// constructor
+	RigidBodySimulation();
+	// destructor
+	~RigidBodySimulation();
+
+	// remove every shape and body and replace the settings
+	void Initialize(const RIGID_BODY_SETTINGS& settings);
+
+	// add a shape centered on its body, returns the index of the shape
+	int AddBox(glm::vec3 halfExtents);
+	int AddSphere(float radius);
+	// a cylinder standing along its y axis
+	int AddCylinder(float radius, float halfHeight);
+	// the convex hull of the passed in points, returns -1 when the
+	// points do not enclose any volume
+	int AddHull(const std::vector<glm::vec3>& points);
+
+	// add a body of a shape, which does not move when it has no mass;
+	// returns the index of the body
+	int AddBody(
+		int shape,
+		glm::vec3 position,
+		const glm::mat3& orientation,
+		float mass,
+		float friction = 0.5f,
+		float restitution = 0.1f);
+	// move a body to the passed in place and wake it up
+	void PlaceBody(int body, glm::vec3 position, const glm::mat3& orientation);
+	// set the velocity of a body and wake it up
+	void SetVelocity(int body, glm::vec3 linearVelocity, glm::vec3 angularVelocity);
+
+	// advance the simulation in fixed steps by the passed in time
+	void Update(float deltaSeconds, JobSystem* pJobSystem);
+
+	// get the placement of a body, without scale
+	glm::mat4 GetTransform(int body) const;
+	glm::vec3 GetPosition(int body) const { return(m_bodies[body].position); }
+	bool IsAwake(int body) const { return(m_bodies[body].bAwake); }
+	int GetBodyCount() const { return(static_cast<int>(m_bodies.size())); }
+	int GetAwakeCount() const { return(m_awakeCount); }
+	// get the pairs, contacts and islands of the last step
+	int GetPairCount() const { return(static_cast<int>(m_pairs.size())); }
+	int GetContactCount() const { return(static_cast<int>(m_contacts.size())); }
+	int GetIslandCount() const { return(m_islandCount); }
+	const RIGID_BODY_SETTINGS& GetSettings() const { return(m_settings); }
+
+	// time dropping thousands of props onto a table against the
+	// number of threads
+	static void Benchmark();
+
+private:
+	// a shape in the local space of its body
+	struct RIGID_SHAPE
+	{
+		RIGID_SHAPE_TYPE type = RIGID_BOX;
+		glm::vec3 halfExtents = glm::vec3(0.0f);
+		float radius = 0.0f;
+		float halfHeight = 0.0f;
+		// outward faces of a hull, the normal and the offset
+		std::vector<glm::vec4> planes;
+		// points tested against other shapes as separate arrays of
+		// each coordinate, padded to whole groups of four
+		std::vector<float> pointX;
+		std::vector<float> pointY;
+		std::vector<float> pointZ;
+		int pointCount = 0;
+		// the sphere is tested by its center, pushed out by its radius
+		float pointRadius = 0.0f;
+		// box around the shape
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+		// moments of inertia along the local axes for a mass of one
+		glm::vec3 unitInertia;
+	};
+
+	struct RIGID_BODY
+	{
+		int shape;
+		glm::vec3 position;
+		glm::mat3 orientation;
+		glm::vec3 linearVelocity;
+		glm::vec3 angularVelocity;
+		// zero for bodies that do not move
+		float inverseMass;
+		glm::vec3 inverseInertia;
+		glm::mat3 inverseInertiaWorld;
+		float friction;
+		float restitution;
+		// world box around the body, grown by the contact margin
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+		// time spent slower than the sleep speed
+		float sleepTime;
+		bool bAwake;
+		// island of the body in the last step, -1 when it had none
+		int island;
+	};
+
+	// two bodies whose bounds overlap, the lower index first
+	struct RIGID_PAIR
+	{
+		int bodyA;
+		int bodyB;
+	};
+
+	// a point where two bodies touch, or a body touches the ground
+	// when the second body is -1; the normal points from the second
+	// body toward the first
+	struct RIGID_CONTACT
+	{
+		int bodyA;
+		int bodyB;
+		// the bodies, the direction the points were tested in and
+		// the point, matching the same contact across steps
+		uint64_t key;
+		glm::vec3 point;
+		glm::vec3 normal;
+		float overlap;
+		float friction;
+		float restitution;
+		// values prepared for the solver
+		glm::vec3 offsetA;
+		glm::vec3 offsetB;
+		glm::vec3 tangent0;
+		glm::vec3 tangent1;
+		// change of angular velocity of each body from a unit impulse
+		// along the normal and the two tangents
+		glm::vec3 turnA[3];
+		glm::vec3 turnB[3];
+		float normalMass;
+		float tangentMass0;
+		float tangentMass1;
+		float bias;
+		// impulses accumulated over the iterations
+		float normalImpulse;
+		float tangentImpulse0;
+		float tangentImpulse1;
+	};
+
+	// impulses of a contact kept for warm starting the next step
+	struct RIGID_CACHED_IMPULSE
+	{
+		uint64_t key;
+		float normalImpulse;
+		glm::vec3 frictionImpulse;
+	};
+
+	// a point of one shape found inside or near another
+	struct RIGID_HIT
+	{
+		int point;
+		glm::vec3 localPoint;
+		float distance;
+	};
+
+	RIGID_BODY_SETTINGS m_settings;
+	std::vector<RIGID_SHAPE> m_shapes;
+	std::vector<RIGID_BODY> m_bodies;
+	float m_pendingTime;
+	int m_awakeCount;
+	int m_islandCount;
+
+	// bodies in order of the low end of their bounds along x, and
+	// whether the order has to be sorted from scratch
+	std::vector<int> m_sortedBodies;
+	bool m_bSortNeeded;
+
+	// pairs and contacts of the last step, and the impulses of the
+	// contacts ordered by key
+	std::vector<RIGID_PAIR> m_pairs;
+	std::vector<RIGID_CONTACT> m_contacts;
+	std::vector<RIGID_CACHED_IMPULSE> m_cachedImpulses;
+
+	// islands of the last step, as runs of bodies and of the contacts,
+	// which are moved into island order through the spare list so
+	// the solver walks them in memory order
+	std::vector<int> m_islandParents;
+	std::vector<int> m_islandBodies;
+	std::vector<int> m_islandBodyStarts;
+	std::vector<RIGID_CONTACT> m_islandContacts;
+	std::vector<int> m_islandContactStarts;
+	std::vector<int> m_islandOrder;
+
+	// add a shape and fill in its bounds and inertia
+	int AddShape(RIGID_SHAPE& shape, const std::vector<glm::vec3>& points);
+	// run one step of the simulation
+	void Step(float stepSeconds, JobSystem* pJobSystem);
+	// find the overlapping bounds of the bodies
+	void FindPairs(JobSystem* pJobSystem);
+	// find the contacts of the pairs and of the bodies on the ground
+	void FindContacts(JobSystem* pJobSystem);
+	void CollidePair(int bodyA, int bodyB, std::vector<RIGID_HIT>& hits, std::vector<RIGID_CONTACT>& contacts) const;
+	void CollideGround(int body, std::vector<RIGID_HIT>& hits, std::vector<RIGID_CONTACT>& contacts) const;
+	// keep the deepest contacts of a pair and those spread farthest
+	// from them, past the passed in first contact of the pair
+	void ReduceContacts(std::vector<RIGID_CONTACT>& contacts, size_t first) const;
+	// test the points of a shape, moved by the passed in rotation and
+	// offset into the space of the other shape, or above the ground
+	// when there is no other shape
+	void TestPoints(
+		const RIGID_SHAPE& pointShape,
+		const glm::mat3& rotation,
+		glm::vec3 offset,
+		const RIGID_SHAPE* pSurfaceShape,
+		std::vector<RIGID_HIT>& hits) const;
+	// look up the impulses of a contact in the last step
+	void WarmStart(RIGID_CONTACT& contact) const;
+	// join the touching bodies into islands and wake the islands
+	// that touch a body that is awake
+	void BuildIslands();
+	// solve the contacts of one island
+	void SolveIsland(int island, float stepSeconds);
+	// move the bodies of one island and put it to sleep once at rest
+	void IntegrateIsland(int island, float stepSeconds);
+	// update the world bounds and inertia of a body
+	void UpdateBody(RIGID_BODY& body) const;
+
+	// distance from a local point to the surface of a shape, negative
+	// inside, and the outward direction of the surface nearest to it
+	static float ShapeDistance(const RIGID_SHAPE& shape, glm::vec3 point);
+	static glm::vec3 ShapeNormal(const RIGID_SHAPE& shape, glm::vec3 point);
+};
@@ -0,0 +1,63 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenefile.cpp
+// ============
+// read the scene settings file that overrides values defined in code
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneFile.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+/***********************************************************
+ *  ReadSceneSettings()
+ *
+ *  This function is used for parsing the scene settings
+ *  file.  Each line names the kind and tag of a scene item
+ *  and one of its properties, followed by the values.
+ ***********************************************************/
+bool ReadSceneSettings(const char* filename, std::vector<SCENE_SETTING>& settings)
+{
+	std::ifstream file(filename);
+	if (!file)
+	{
+		return(false);
+	}
+
+	settings.clear();
+	std::string text;
+	int lineNumber = 0;
+	while (std::getline(file, text))
+	{
+		lineNumber++;
+
+		std::istringstream line(text);
+		SCENE_SETTING setting;
+		setting.line = lineNumber;
+		if (!(line >> setting.kind) || (setting.kind[0] == '#'))
+		{
+			continue;
+		}
+		if (!(line >> setting.tag >> setting.property))
+		{
+			std::cout << filename << "(" << lineNumber << "): expected a tag and a property" << std::endl;
+			continue;
+		}
+
+		float value = 0.0f;
+		while (line >> value)
+		{
+			setting.values.push_back(value);
+		}
+		if ((setting.values.size() == 0) || (line.eof() == false))
+		{
+			std::cout << filename << "(" << lineNumber << "): expected only numbers after the property" << std::endl;
+			continue;
+		}
+
+		settings.push_back(setting);
+	}
+
+	return(true);
+}
@@ -0,0 +1,32 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenefile.h
+// ============
+// read the scene settings file that overrides values defined in code
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+// one line of the scene settings file, such as
+//     light sunLight diffuse 1.0 0.98 0.9
+struct SCENE_SETTING
+{
+	// kind of scene item - light, material or object
+	std::string kind;
+	// tag of the scene item the setting applies to
+	std::string tag;
+	// name of the value being set
+	std::string property;
+	std::vector<float> values;
+	// line number in the file, for error messages
+	int line;
+
+	// text identifying the value, unique within the file
+	std::string GetKey() const { return(kind + " " + tag + " " + property); }
+};
+
+// read every setting of the file, returns false when it cannot be opened;
+// blank lines and lines starting with # are skipped
+bool ReadSceneSettings(const char* filename, std::vector<SCENE_SETTING>& settings);
@@ -30,8 +30,18 @@
 #endif
 
 #define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtc/constants.hpp>
 #include <glm/gtx/transform.hpp>
 
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+
 // declaration of global variables
 namespace
 {
@@ -39,7 +49,419 @@ namespace
 	const char* g_ColorValueName = "objectColor";
 	const char* g_TextureValueName = "objectTexture";
 	const char* g_UseTextureName = "bUseTexture";
+	const char* g_UseAtlasTextureName = "bAtlasTexture";
+	const char* g_AtlasRectName = "atlasRect";
 	const char* g_UseLightingName = "bUseLighting";
+	const char* g_DepthOnlyName = "bDepthOnly";
+
+	// procedural material values in the shader
+	const char* g_ProceduralTypeName = "material.proceduralType";
+	const char* g_ProceduralColorAName = "material.proceduralColorA";
+	const char* g_ProceduralColorBName = "material.proceduralColorB";
+	const char* g_ProceduralParamsName = "material.proceduralParams";
+	// prefix of the tags of baked procedural textures
+	const char* g_BakedTexturePrefix = "baked:";
+	// largest procedural bake a snapshot may ask for
+	const int g_MaxBakeResolution = 4096;
+
+	// virtual texture values in the shader
+	const char* g_UseVirtualTextureName = "bVirtualTexture";
+	const char* g_VirtualTextureFeedbackName = "bVirtualTextureFeedback";
+	// texture units 14 and 15 are kept for the virtual texture tile
+	// cache and page table, and 12 and 13 for the vertex animation
+	// positions and normals, the loaded textures use the ones below
+	const int g_VirtualTexturePhysicalUnit = 14;
+	const int g_VirtualTexturePageTableUnit = 15;
+	const int g_VertexAnimationPositionUnit = 12;
+	const int g_VertexAnimationNormalUnit = 13;
+	// the feedback pass is drawn at this fraction of the window size
+	const int g_FeedbackDownscale = 8;
+
+	// tag of the loaded texture holding the packed small textures
+	const char* g_AtlasTextureTag = "atlas";
+	// width of the texture atlas, and the largest side of a texture
+	// that is packed into it rather than loaded on its own
+	const int g_AtlasSize = 2048;
+
+	// number of frames averaged into each GPU time report
+	const int g_GPUTimeReportFrames = 300;
+
+	// per-object point light list in the fragment shader
+	const char* g_PointLightCountName = "pointLightCount";
+	const char* g_PointLightIndexNames[TOTAL_POINT_LIGHTS] =
+	{
+		"pointLightIndices[0]",
+		"pointLightIndices[1]",
+		"pointLightIndices[2]",
+		"pointLightIndices[3]",
+		"pointLightIndices[4]"
+	};
+
+	// vertex animation values in the shader
+	const char* g_VertexAnimationName = "bVertexAnimation";
+	const char* g_VertexAnimationTimeName = "vertexAnimationTime";
+	// frames baked into the swim cycle of the fish schools
+	const int g_VertexAnimationFrames = 32;
+	// compute shader flocking the fish schools
+	const char* g_BoidComputeShaderFile = "shaders/boidCompute.glsl";
+	// the flocking box reaches this far past the ellipsoid a school
+	// starts in, and the fish cruise at this speed when released
+	const float g_SchoolBoundsScale = 1.6f;
+	const float g_SchoolCruiseSpeed = 1.0f;
+
+	// lake values in the shader
+	const char* g_WaterSurfaceName = "bWaterSurface";
+	// the lake textures are bound past the sixteen units above, the
+	// displacements read by the vertex shader and the normals by the
+	// fragment shader
+	const int g_WaterDisplacementUnit = 16;
+	const int g_WaterNormalUnit = 17;
+	// height of the still lake surface, below the table top
+	const float g_LakeLevel = -3.0f;
+
+	// terrain values in the shader, the height tiles being bound past
+	// the fishing line points
+	const char* g_TerrainName = "bTerrain";
+	const int g_TerrainHeightUnit = 19;
+
+	// foliage values in the shader, and the compute shader scattering
+	// and culling the clumps
+	const char* g_FoliageName = "bFoliage";
+	const char* g_FoliageTimeName = "foliageTime";
+	const char* g_FoliageComputeShaderFile = "shaders/foliageCompute.glsl";
+
+	// sky values in the shader, the atmosphere tables being bound past
+	// the terrain heights, and the compute shader filling them
+	const char* g_SkyName = "bSky";
+	const int g_AtmosphereTransmittanceUnit = 20;
+	const int g_AtmosphereMultiScatteringUnit = 21;
+	const int g_AtmosphereSkyViewUnit = 22;
+	const char* g_AtmosphereComputeShaderFile = "shaders/atmosphereCompute.glsl";
+
+	// first of the texture units the reflection passes read, past the
+	// atmosphere tables, and the compute shader tracing the reflections
+	const int g_ReflectionFirstUnit = 23;
+	const char* g_ReflectionComputeShaderFile = "shaders/reflectionCompute.glsl";
+
+	// fishing line values in the shader, the streamed points being
+	// bound past the lake textures
+	const char* g_FishingLineName = "bFishingLine";
+	const int g_FishingLinePointUnit = 18;
+	// rows and columns of pegs of the tackle shop display, each spool of
+	// line hung from a pair of pegs
+	const int g_TackleDisplayRows = 16;
+	const int g_TackleDisplayColumns = 32;
+
+	// bobbers thrown at the tabletop props, their size, weight and the
+	// speed they leave the camera at, and how many are in flight before
+	// the oldest is thrown again
+	const float g_BobberRadius = 0.25f;
+	const float g_BobberMass = 0.2f;
+	const float g_BobberSpeed = 12.0f;
+	const int g_MaxThrownBobbers = 16;
+
+	// shading level-of-detail
+	const char* g_VertexLightingName = "bVertexLighting";
+	const char* g_ShadingTierDebugName = "bShadingTierDebug";
+	// objects whose bounding sphere covers fewer pixels than this
+	// across the screen are lit per vertex instead of per pixel
+	const float g_VertexLightingMaxPixels = 48.0f;
+
+	// world size of the cells in the grid over the point lights
+	const float g_LightGridCellSize = 4.0f;
+	// a point light stops influencing an object once its
+	// attenuation falls below this fraction of full strength, the
+	// shaders fading it out to nothing there (POINT_LIGHT_CUTOFF)
+	const float g_LightCutoffAttenuation = 1.0f / 256.0f;
+
+	/***********************************************************
+	 *  ComputeLightRange()
+	 *
+	 *  Distance at which the attenuation of the point light
+	 *  drops to the cutoff, solving the attenuation quadratic.
+	 ***********************************************************/
+	float ComputeLightRange(const SceneManager::POINT_LIGHT& light)
+	{
+		float target = (1.0f / g_LightCutoffAttenuation) - light.constant;
+		if (target <= 0.0f)
+		{
+			return(0.0f);
+		}
+		if (light.quadratic > 0.0f)
+		{
+			float discriminant = (light.linear * light.linear) + (4.0f * light.quadratic * target);
+			return((-light.linear + sqrtf(discriminant)) / (2.0f * light.quadratic));
+		}
+		if (light.linear > 0.0f)
+		{
+			return(target / light.linear);
+		}
+
+		// no attenuation, so the light reaches everything
+		return(FLT_MAX);
+	}
+
+	// folder holding the baked scene data between runs
+	const char* g_AssetCacheFolder = "cache";
+	const char* g_VertexAnimationCacheFile = "cache/trout.vat";
+	const char* g_TerrainCacheFile = "cache/lakeshore.terrain";
+	const char* g_AtmosphereCacheFile = "cache/atmosphere.lut";
+	const char* g_VisibilityCacheFile = "cache/scene.pvs";
+	const char* g_VisibilityCacheExtension = ".pvs";
+	const char* g_VirtualTextureCacheExtension = ".vtc";
+
+	// values overriding the scene defined in code, reapplied when edited
+	const char* g_SceneSettingsFile = "scene/SceneSettings.txt";
+	// what has to be recomputed after scene settings were applied
+	const int SETTING_CHANGES_TRANSFORMS = 1;
+	const int SETTING_CHANGES_LIGHTS = 2;
+
+	// socket external tools send live scene edits to
+	const char* g_SceneEditSocketFile = "cache/sceneEdit.sock";
+
+	// image of the running scene state saved on request
+	const char* g_SceneSnapshotFile = "cache/scene.snapshot";
+
+	// navigable space around the table covered by view cells
+	const glm::vec3 g_ViewRegionMin = glm::vec3(-25.0f, -1.0f, -15.0f);
+	const glm::vec3 g_ViewRegionMax = glm::vec3(25.0f, 16.0f, 20.0f);
+	const float g_ViewCellSize = 2.5f;
+
+	/***********************************************************
+	 *  GetShapeBounds()
+	 *
+	 *  Local bounds that enclose the whole basic mesh.
+	 ***********************************************************/
+	void GetShapeBounds(SceneManager::SHAPE_TYPE shape, glm::vec3& boundsMin, glm::vec3& boundsMax)
+	{
+		switch (shape)
+		{
+		case SceneManager::SHAPE_PLANE:
+			boundsMin = glm::vec3(-1.0f, 0.0f, -1.0f);
+			boundsMax = glm::vec3(1.0f, 0.0f, 1.0f);
+			break;
+		case SceneManager::SHAPE_CYLINDER:
+			boundsMin = glm::vec3(-1.0f, 0.0f, -1.0f);
+			boundsMax = glm::vec3(1.0f, 1.0f, 1.0f);
+			break;
+		case SceneManager::SHAPE_TORUS:
+			// the ring plus its tube, whichever plane it lies in
+			boundsMin = glm::vec3(-1.25f);
+			boundsMax = glm::vec3(1.25f);
+			break;
+		case SceneManager::SHAPE_SPHERE:
+			boundsMin = glm::vec3(-1.0f);
+			boundsMax = glm::vec3(1.0f);
+			break;
+		case SceneManager::SHAPE_BOX:
+		default:
+			boundsMin = glm::vec3(-0.5f);
+			boundsMax = glm::vec3(0.5f);
+			break;
+		}
+	}
+
+	/***********************************************************
+	 *  GetShapeOccluderBounds()
+	 *
+	 *  Local box that lies completely inside the basic mesh, so
+	 *  anything passing through it is certainly hidden.
+	 ***********************************************************/
+	bool GetShapeOccluderBounds(SceneManager::SHAPE_TYPE shape, glm::vec3& boundsMin, glm::vec3& boundsMax)
+	{
+		switch (shape)
+		{
+		case SceneManager::SHAPE_PLANE:
+			boundsMin = glm::vec3(-1.0f, -0.001f, -1.0f);
+			boundsMax = glm::vec3(1.0f, 0.0f, 1.0f);
+			return(true);
+		case SceneManager::SHAPE_CYLINDER:
+			// square inscribed in the unit circle
+			boundsMin = glm::vec3(-0.7f, 0.0f, -0.7f);
+			boundsMax = glm::vec3(0.7f, 1.0f, 0.7f);
+			return(true);
+		case SceneManager::SHAPE_SPHERE:
+			// cube inscribed in the unit sphere
+			boundsMin = glm::vec3(-0.57f);
+			boundsMax = glm::vec3(0.57f);
+			return(true);
+		case SceneManager::SHAPE_BOX:
+			boundsMin = glm::vec3(-0.5f);
+			boundsMax = glm::vec3(0.5f);
+			return(true);
+		default:
+			// a torus has a hole through it
+			return(false);
+		}
+	}
+
+	/***********************************************************
+	 *  CompileShaderFile()
+	 *
+	 *  Compile the shader source file into a new shader object,
+	 *  printing the compile log on errors.  Returns 0 when the
+	 *  file cannot be read or does not compile.
+	 ***********************************************************/
+	GLuint CompileShaderFile(GLenum type, const std::string& filename)
+	{
+		std::ifstream file(filename);
+		if (!file)
+		{
+			std::cout << "Could not read shader:" << filename << std::endl;
+			return(0);
+		}
+		std::stringstream buffer;
+		buffer << file.rdbuf();
+		std::string source = buffer.str();
+		const char* sourceText = source.c_str();
+
+		GLuint shader = glCreateShader(type);
+		glShaderSource(shader, 1, &sourceText, NULL);
+		glCompileShader(shader);
+
+		GLint status = GL_FALSE;
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+		if (status == GL_FALSE)
+		{
+			GLchar log[1024];
+			glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+			std::cout << "Shader compile errors in " << filename << ":" << std::endl << log << std::endl;
+			glDeleteShader(shader);
+			return(0);
+		}
+
+		return(shader);
+	}
+
+	/***********************************************************
+	 *  ValidateShaderProgram()
+	 *
+	 *  Compile and link the shader files into a throwaway
+	 *  program, to find out whether they are safe to load.
+	 ***********************************************************/
+	bool ValidateShaderProgram(const std::string& vertexShaderFile, const std::string& fragmentShaderFile)
+	{
+		GLuint vertexShader = CompileShaderFile(GL_VERTEX_SHADER, vertexShaderFile);
+		GLuint fragmentShader = CompileShaderFile(GL_FRAGMENT_SHADER, fragmentShaderFile);
+		bool bValid = (vertexShader != 0) && (fragmentShader != 0);
+
+		if (bValid)
+		{
+			GLuint program = glCreateProgram();
+			glAttachShader(program, vertexShader);
+			glAttachShader(program, fragmentShader);
+			glLinkProgram(program);
+
+			GLint status = GL_FALSE;
+			glGetProgramiv(program, GL_LINK_STATUS, &status);
+			if (status == GL_FALSE)
+			{
+				GLchar log[1024];
+				glGetProgramInfoLog(program, sizeof(log), NULL, log);
+				std::cout << "Shader link errors:" << std::endl << log << std::endl;
+				bValid = false;
+			}
+			glDeleteProgram(program);
+		}
+
+		glDeleteShader(vertexShader);
+		glDeleteShader(fragmentShader);
+		return(bValid);
+	}
+
+	/***********************************************************
+	 *  LoadComputeProgram()
+	 *
+	 *  Compile and link the compute shader file into a new
+	 *  program.  Returns 0 when compute shaders are not
+	 *  supported or the file does not compile or link.
+	 ***********************************************************/
+	GLuint LoadComputeProgram(const std::string& computeShaderFile)
+	{
+		if (GLEW_VERSION_4_3 == false)
+		{
+			std::cout << "Compute shaders need OpenGL 4.3" << std::endl;
+			return(0);
+		}
+
+		GLuint computeShader = CompileShaderFile(GL_COMPUTE_SHADER, computeShaderFile);
+		if (computeShader == 0)
+		{
+			return(0);
+		}
+
+		GLuint program = glCreateProgram();
+		glAttachShader(program, computeShader);
+		glLinkProgram(program);
+		glDeleteShader(computeShader);
+
+		GLint status = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &status);
+		if (status == GL_FALSE)
+		{
+			GLchar log[1024];
+			glGetProgramInfoLog(program, sizeof(log), NULL, log);
+			std::cout << "Shader link errors in " << computeShaderFile << ":" << std::endl << log << std::endl;
+			glDeleteProgram(program);
+			return(0);
+		}
+
+		return(program);
+	}
+
+	// bytes of preloaded textures uploaded per frame, so the copies
+	// never add more than a fraction of a millisecond to a frame
+	const size_t g_PreloadUploadBytesPerFrame = 4 * 1024 * 1024;
+
+	/***********************************************************
+	 *  ReadFileContents()
+	 *
+	 *  Read the bytes of a file and hash them with FNV-1a, so
+	 *  that equal image files are recognized whatever their
+	 *  name or the scene they were loaded for.
+	 ***********************************************************/
+	bool ReadFileContents(const std::string& filename, std::vector<uint8_t>& bytes, uint64_t& contentHash)
+	{
+		std::ifstream file(filename, std::ios::binary | std::ios::ate);
+		if (!file)
+		{
+			return(false);
+		}
+
+		std::streamoff size = file.tellg();
+		file.seekg(0);
+		bytes.resize(static_cast<size_t>(size));
+		if (!file.read(reinterpret_cast<char*>(bytes.data()), size))
+		{
+			return(false);
+		}
+
+		contentHash = 14695981039346656037ull;
+		for (size_t i = 0; i < bytes.size(); i++)
+		{
+			contentHash = (contentHash ^ bytes[i]) * 1099511628211ull;
+		}
+		return(true);
+	}
+
+	/***********************************************************
+	 *  ReportReload()
+	 *
+	 *  Print how long a reload took, and how long after the
+	 *  file was saved the change was on screen.
+	 ***********************************************************/
+	void ReportReload(
+		const std::string& path,
+		std::chrono::steady_clock::time_point startTime,
+		std::filesystem::file_time_type writeTime)
+	{
+		double applyMilliseconds = std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - startTime).count();
+		double saveMilliseconds = std::chrono::duration<double, std::milli>(
+			std::filesystem::file_time_type::clock::now() - writeTime).count();
+		std::cout << "Reloaded " << path << " in " << applyMilliseconds << " ms, "
+			<< saveMilliseconds << " ms after it was saved" << std::endl;
+	}
 }
 
 /***********************************************************
@@ -59,6 +481,106 @@ SceneManager::SceneManager(ShaderManager *pShaderManager)
 		m_textureIDs[i].ID = -1;
 	}
 	m_loadedTextures = 0;
+
+	m_pJobSystem = new JobSystem();
+	m_pTasks = new TaskScheduler(m_pJobSystem);
+	m_pUploads = NULL;
+	m_cameraPosition = glm::vec3(0.0f);
+	m_viewMatrix = glm::mat4(1.0f);
+	m_projectionMatrix = glm::mat4(1.0f);
+	m_bShadingTierDebug = false;
+
+	m_bDepthPrepass = true;
+	m_gpuTimerQueries[0] = 0;
+	m_gpuTimerQueries[1] = 0;
+	m_shadedSampleQueries[0] = 0;
+	m_shadedSampleQueries[1] = 0;
+	m_renderedFrames = 0;
+	m_timedFrames = 0;
+	m_gpuTimeTotal = 0.0;
+	m_shadedSampleTotal = 0.0;
+
+	m_feedbackFramebuffer = 0;
+	m_feedbackRenderbuffers[0] = 0;
+	m_feedbackRenderbuffers[1] = 0;
+	m_feedbackWidth = 0;
+	m_feedbackHeight = 0;
+	m_feedbackPixelBuffers[0] = 0;
+	m_feedbackPixelBuffers[1] = 0;
+	m_feedbackReadbacks = 0;
+
+	m_pFileWatcher = NULL;
+	m_pEditServer = NULL;
+
+	m_pPreloadedScene = NULL;
+	m_preloadState = PRELOAD_NONE;
+	m_preloadSerial = 0;
+
+	m_lastAnimationTime = std::chrono::steady_clock::now();
+	m_animatedFrames = 0;
+	m_animationTimeTotal = 0.0;
+
+	m_schoolStartTime = std::chrono::steady_clock::now();
+	m_bAquarium = false;
+	m_lastSchoolTime = std::chrono::steady_clock::now();
+	m_flockedFrames = 0;
+	m_flockTimeTotal = 0.0;
+	m_boidComputeProgram = 0;
+	m_bBoidCompute = false;
+	m_bBoidComputeRequested = false;
+
+	m_bLake = false;
+	m_lakeStartTime = std::chrono::steady_clock::now();
+	m_simulatedLakeFrames = 0;
+	m_lakeTimeTotal = 0.0;
+	m_lakePointLightCount = 0;
+
+	m_bTerrain = false;
+	m_updatedTerrainFrames = 0;
+	m_terrainTimeTotal = 0.0;
+	m_terrainPointLightCount = 0;
+	m_bPrefetch = false;
+	m_lastTerrainUpdateTime = std::chrono::steady_clock::now();
+	m_terrainSeconds = 0.0;
+	m_placeholderSeconds = 0.0;
+	m_prefetchUsedTotal = 0;
+	m_prefetchWastedTotal = 0;
+
+	m_foliageComputeProgram = 0;
+	m_bFoliage = false;
+	m_bFoliageRequested = false;
+	m_foliageStartTime = std::chrono::steady_clock::now();
+	m_updatedFoliageFrames = 0;
+	m_foliageTimeTotal = 0.0;
+	m_foliagePointLightCount = 0;
+
+	m_atmosphereComputeProgram = 0;
+	m_bSky = false;
+	m_bSkyRequested = false;
+	m_updatedSkyFrames = 0;
+	m_skyViewUpdates = 0;
+	m_skyTimeTotal = 0.0;
+
+	m_reflectionComputeProgram = 0;
+	m_bReflections = false;
+	m_bReflectionsRequested = false;
+	m_bLinearMarch = false;
+	m_reflectionFrames = 0;
+	m_reflectionTimeTotal = 0.0;
+
+	m_rodLine = -1;
+	m_bTackleDisplay = false;
+	m_lastFishingLineTime = std::chrono::steady_clock::now();
+	m_simulatedLineFrames = 0;
+	m_lineTimeTotal = 0.0;
+	m_fishingLinePointLightCount = 0;
+
+	m_nextBobber = 0;
+	m_bobberShape = -1;
+	m_bPhysics = false;
+	m_lastPhysicsTime = std::chrono::steady_clock::now();
+	m_simulatedPhysicsFrames = 0;
+	m_physicsTimeTotal = 0.0;
 }
 
 /***********************************************************
@@ -71,6 +593,61 @@ SceneManager::~SceneManager()
 	m_pShaderManager = NULL;
 	delete m_basicMeshes;
 	m_basicMeshes = NULL;
+	delete m_pFileWatcher;
+	m_pFileWatcher = NULL;
+	delete m_pEditServer;
+	m_pEditServer = NULL;
+	// the queued uploads finish and hand their tasks to the scheduler
+	// before the thread stops
+	delete m_pUploads;
+	m_pUploads = NULL;
+	delete m_pJobSystem;
+	m_pJobSystem = NULL;
+	// the workers have handed every task back by now, and the tasks
+	// still waiting are freed without running further
+	delete m_pTasks;
+	m_pTasks = NULL;
+
+	// the job system has finished every tile load and preload by now
+	DiscardPreloadedScene();
+	for (int i = 0; i < m_virtualTextures.size(); i++)
+	{
+		delete m_virtualTextures[i];
+	}
+	m_virtualTextures.clear();
+	ClearFishSchools();
+	m_vertexAnimation.Close();
+	if (m_boidComputeProgram != 0)
+	{
+		glDeleteProgram(m_boidComputeProgram);
+	}
+	m_foliage.Release();
+	if (m_foliageComputeProgram != 0)
+	{
+		glDeleteProgram(m_foliageComputeProgram);
+	}
+	m_atmosphere.Release();
+	if (m_atmosphereComputeProgram != 0)
+	{
+		glDeleteProgram(m_atmosphereComputeProgram);
+	}
+	m_reflections.Release();
+	if (m_reflectionComputeProgram != 0)
+	{
+		glDeleteProgram(m_reflectionComputeProgram);
+	}
+	if (m_feedbackFramebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_feedbackFramebuffer);
+		glDeleteRenderbuffers(2, m_feedbackRenderbuffers);
+		glDeleteBuffers(2, m_feedbackPixelBuffers);
+	}
+
+	if (m_gpuTimerQueries[0] != 0)
+	{
+		glDeleteQueries(2, m_gpuTimerQueries);
+		glDeleteQueries(2, m_shadedSampleQueries);
+	}
 
 	// Cleans up and deallocates any loaded OpenGL textures before destruction.
 	DestroyGLTextures();
@@ -82,7 +659,9 @@ SceneManager::~SceneManager()
  *  This method is used for loading textures from image files,
  *  configuring the texture mapping parameters in OpenGL,
  *  generating the mipmaps, and loading the read texture into
- *  the next available texture slot in memory.
+ *  the next available texture slot in memory.  The RGBA
+ *  conversion and the mipmaps are prepared on the worker
+ *  threads, so the driver only copies finished levels.
  ***********************************************************/
 bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
 {
@@ -117,20 +696,18 @@ bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-		// if the loaded image is in RGB format
-		if (colorChannels == 3)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-		// if the loaded image is in RGBA format - it supports transparency
-		else if (colorChannels == 4)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-		else
+		// expand RGB images to RGBA and generate the texture mipmaps
+		// for mapping textures to lower resolutions
+		std::vector<TEXTURE_LEVEL> levels;
+		if (PrepareTextureLevels(image, width, height, colorChannels, -1, levels, m_pJobSystem) == false)
 		{
 			std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
+			stbi_image_free(image);
+			glBindTexture(GL_TEXTURE_2D, 0);
+			glDeleteTextures(1, &textureID);
 			return false;
 		}
-
-		// generate the texture mipmaps for mapping textures to lower resolutions
-		glGenerateMipmap(GL_TEXTURE_2D);
+		UploadTextureLevels(levels);
 
 		// free the image data from local memory
 		stbi_image_free(image);
@@ -140,6 +717,7 @@ bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
 		m_textureIDs[m_loadedTextures].ID = textureID;
 		m_textureIDs[m_loadedTextures].tag = tag;
 		m_loadedTextures++;
+		AddTextureSource(filename, tag, TEXTURE_SOURCE_IMAGE);
 
 		return true;
 	}
@@ -150,6 +728,277 @@ bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
 	return false;
 }
 
+/***********************************************************
+ *  AddAtlasTexture()
+ *
+ *  This method is used for queuing a small texture image
+ *  to be packed into the texture atlas with the passed in
+ *  tag.  Only the image header is read here.  Images too
+ *  large for the atlas are loaded as a texture of their own.
+ ***********************************************************/
+bool SceneManager::AddAtlasTexture(const char* filename, std::string tag)
+{
+	int width = 0;
+	int height = 0;
+	int colorChannels = 0;
+
+	if (stbi_info(filename, &width, &height, &colorChannels) == 0)
+	{
+		std::cout << "Could not load image:" << filename << std::endl;
+		return false;
+	}
+
+	if ((width > g_AtlasSize / 2) || (height > g_AtlasSize / 2))
+	{
+		return CreateGLTexture(filename, tag);
+	}
+
+	m_atlasFilenames.push_back(filename);
+	m_atlasTags.push_back(tag);
+	AddTextureSource(filename, tag, TEXTURE_SOURCE_ATLAS);
+
+	return true;
+}
+
+/***********************************************************
+ *  CreateAtlasTexture()
+ *
+ *  This method is used for decoding the small textures
+ *  queued by AddAtlasTexture() on the worker threads,
+ *  packing them, and loading the atlas into the next
+ *  available texture slot.  The mipmaps stop at the level
+ *  where the gutters around the images run out.
+ ***********************************************************/
+bool SceneManager::CreateAtlasTexture()
+{
+	if (m_atlasFilenames.size() == 0)
+	{
+		return false;
+	}
+
+	// decode the images in parallel, expanding RGB to RGBA
+	std::vector<TEXTURE_LEVEL> images(m_atlasFilenames.size());
+	stbi_set_flip_vertically_on_load(true);
+	m_pJobSystem->ParallelFor(m_atlasFilenames.size(), 1, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				// grey and grey-alpha images are expanded by the decoder,
+				// since the atlas keeps every image as RGBA8
+				int colorChannels = 0;
+				unsigned char* image = stbi_load(
+					m_atlasFilenames[i].c_str(),
+					&images[i].width,
+					&images[i].height,
+					&colorChannels,
+					4);
+				if (!image)
+				{
+					continue;
+				}
+
+				std::vector<TEXTURE_LEVEL> levels;
+				if (PrepareTextureLevels(image, images[i].width, images[i].height, 4, 0, levels, NULL) == true)
+				{
+					images[i].texels.swap(levels[0].texels);
+				}
+				stbi_image_free(image);
+			}
+		});
+
+	for (int i = 0; i < images.size(); i++)
+	{
+		if (images[i].texels.size() == 0)
+		{
+			std::cout << "Could not load image:" << m_atlasFilenames[i] << std::endl;
+			continue;
+		}
+		m_textureAtlas.AddImage(
+			m_atlasTags[i],
+			images[i].width,
+			images[i].height,
+			reinterpret_cast<const uint8_t*>(images[i].texels.data()));
+	}
+	m_atlasFilenames.clear();
+	m_atlasTags.clear();
+
+	if ((m_textureAtlas.GetImageCount() == 0) || (m_textureAtlas.Pack(g_AtlasSize) == false))
+	{
+		return false;
+	}
+
+	std::vector<TEXTURE_LEVEL> levels;
+	PrepareTextureLevels(
+		m_textureAtlas.GetPixels().data(),
+		m_textureAtlas.GetWidth(),
+		m_textureAtlas.GetHeight(),
+		4,
+		m_textureAtlas.GetMaxMipLevel(),
+		levels,
+		m_pJobSystem);
+
+	// only the rectangles are needed from here on
+	m_textureAtlas.ReleasePixels();
+
+	GLuint textureID = 0;
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+
+	// the shader wraps inside each image rectangle itself
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	UploadTextureLevels(levels);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	m_textureIDs[m_loadedTextures].ID = textureID;
+	m_textureIDs[m_loadedTextures].tag = g_AtlasTextureTag;
+	m_loadedTextures++;
+
+	return true;
+}
+
+/***********************************************************
+ *  CreateProceduralTexture()
+ *
+ *  This method is used for baking a procedural material
+ *  into a texture image and loading it into the next
+ *  available texture slot, bound to its texture unit.
+ ***********************************************************/
+bool SceneManager::CreateProceduralTexture(const OBJECT_MATERIAL& material, std::string tag)
+{
+	if (m_loadedTextures >= g_VertexAnimationPositionUnit)
+	{
+		std::cout << "No free texture slot to bake procedural material:" << material.tag << std::endl;
+		return false;
+	}
+
+	std::vector<uint8_t> pixels;
+	BakeProceduralImage(
+		material.proceduralType,
+		material.proceduralColorA,
+		material.proceduralColorB,
+		material.proceduralParams,
+		material.bakeResolution,
+		pixels,
+		m_pJobSystem);
+
+	GLuint textureID = 0;
+	glGenTextures(1, &textureID);
+	glActiveTexture(GL_TEXTURE0 + m_loadedTextures);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+
+	// the pattern repeats once per UV unit, so it wraps seamlessly
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	std::vector<TEXTURE_LEVEL> levels;
+	PrepareTextureLevels(pixels.data(), material.bakeResolution, material.bakeResolution, 3, -1, levels, m_pJobSystem);
+	UploadTextureLevels(levels);
+
+	// register the baked texture and leave it bound to its unit
+	m_textureIDs[m_loadedTextures].ID = textureID;
+	m_textureIDs[m_loadedTextures].tag = tag;
+	m_loadedTextures++;
+
+	std::cout << "Baked procedural material:" << material.tag << ", resolution:" << material.bakeResolution << std::endl;
+
+	return true;
+}
+
+/***********************************************************
+ *  BakeProceduralMaterials()
+ *
+ *  This method is used for baking the procedural materials
+ *  with a bake resolution into textures as the scene is
+ *  loaded, so the draw loop only ever binds them.  Those
+ *  already baked for an unchanged material are kept.
+ ***********************************************************/
+void SceneManager::BakeProceduralMaterials()
+{
+	for (int i = 0; i < m_objectMaterials.size(); i++)
+	{
+		const OBJECT_MATERIAL& material = m_objectMaterials[i];
+		if ((material.proceduralType == PROCEDURAL_NONE) || (material.bakeResolution <= 0))
+		{
+			continue;
+		}
+
+		std::string bakedTag = g_BakedTexturePrefix + material.tag;
+		if (FindTextureSlot(bakedTag) < 0)
+		{
+			CreateProceduralTexture(material, bakedTag);
+		}
+	}
+}
+
+/***********************************************************
+ *  CreateVirtualTexture()
+ *
+ *  This method is used for cooking an image too large to be
+ *  kept in video memory into the tiled asset cache, and
+ *  opening it for streaming through the virtual texture
+ *  units.  Cooking is skipped when the cache is current.
+ ***********************************************************/
+bool SceneManager::CreateVirtualTexture(const char* filename, std::string tag)
+{
+	std::error_code error;
+	std::filesystem::create_directories(g_AssetCacheFolder, error);
+
+	std::string cacheFile = std::string(g_AssetCacheFolder) + "/" +
+		std::filesystem::path(filename).stem().string() + g_VirtualTextureCacheExtension;
+	if (VirtualTexture::Cook(filename, cacheFile.c_str(), m_pJobSystem) == false)
+	{
+		return false;
+	}
+
+	VirtualTexture* pVirtualTexture = new VirtualTexture();
+	if (pVirtualTexture->Open(
+		cacheFile.c_str(),
+		tag,
+		g_VirtualTexturePhysicalUnit,
+		g_VirtualTexturePageTableUnit,
+		m_pJobSystem) == false)
+	{
+		delete pVirtualTexture;
+		return false;
+	}
+
+	m_virtualTextures.push_back(pVirtualTexture);
+	AddTextureSource(filename, tag, TEXTURE_SOURCE_VIRTUAL);
+	return true;
+}
+
+/***********************************************************
+ *  AddTextureSource()
+ *
+ *  This method is used for remembering the image file a
+ *  texture was loaded from and how, so that it can be
+ *  loaded again the same way when the file is edited.
+ ***********************************************************/
+void SceneManager::AddTextureSource(const char* filename, std::string tag, TEXTURE_SOURCE_TYPE type)
+{
+	for (int i = 0; i < m_textureSources.size(); i++)
+	{
+		if ((m_textureSources[i].filename.compare(filename) == 0) && (m_textureSources[i].tag.compare(tag) == 0))
+		{
+			return;
+		}
+	}
+
+	TEXTURE_SOURCE source;
+	source.filename = filename;
+	source.tag = tag;
+	source.type = type;
+	std::vector<uint8_t> bytes;
+	ReadFileContents(filename, bytes, source.contentHash);
+	m_textureSources.push_back(source);
+}
+
 /***********************************************************
  *  BindGLTextures()
  *
@@ -232,6 +1081,25 @@ int SceneManager::FindTextureSlot(std::string tag)
 	return(textureSlot);
 }
 
+/***********************************************************
+ *  FindVirtualTexture()
+ *
+ *  This method is used for getting the index of the loaded
+ *  virtual texture associated with the passed in tag.
+ ***********************************************************/
+int SceneManager::FindVirtualTexture(std::string tag)
+{
+	for (int i = 0; i < m_virtualTextures.size(); i++)
+	{
+		if (m_virtualTextures[i]->GetTag().compare(tag) == 0)
+		{
+			return(i);
+		}
+	}
+
+	return(-1);
+}
+
 /***********************************************************
  *  FindMaterial()
  *
@@ -255,6 +1123,12 @@ bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
 			material.diffuseColor = m_objectMaterials[index].diffuseColor;
 			material.specularColor = m_objectMaterials[index].specularColor;
 			material.shininess = m_objectMaterials[index].shininess;
+			material.tag = m_objectMaterials[index].tag;
+			material.proceduralType = m_objectMaterials[index].proceduralType;
+			material.proceduralColorA = m_objectMaterials[index].proceduralColorA;
+			material.proceduralColorB = m_objectMaterials[index].proceduralColorB;
+			material.proceduralParams = m_objectMaterials[index].proceduralParams;
+			material.bakeResolution = m_objectMaterials[index].bakeResolution;
 		}
 		else
 		{
@@ -265,6 +1139,25 @@ bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
 	return(true);
 }
 
+/***********************************************************
+ *  FindSceneObject()
+ *
+ *  This method is used for getting the index of the defined
+ *  scene object associated with the passed in tag, or -1.
+ ***********************************************************/
+int SceneManager::FindSceneObject(std::string tag)
+{
+	for (int i = 0; i < m_sceneObjects.size(); i++)
+	{
+		if (m_sceneObjects[i].tag.compare(tag) == 0)
+		{
+			return(i);
+		}
+	}
+
+	return(-1);
+}
+
 /***********************************************************
  *  SetTransformations()
  *
@@ -277,6 +1170,32 @@ void SceneManager::SetTransformations(
 	float YrotationDegrees,
 	float ZrotationDegrees,
 	glm::vec3 positionXYZ)
+{
+	glm::mat4 modelView = BuildModelMatrix(
+		scaleXYZ,
+		XrotationDegrees,
+		YrotationDegrees,
+		ZrotationDegrees,
+		positionXYZ);
+
+	if (NULL != m_pShaderManager)
+	{
+		m_pShaderManager->setMat4Value(g_ModelName, modelView);
+	}
+}
+
+/***********************************************************
+ *  BuildModelMatrix()
+ *
+ *  This method is used for composing the model matrix from
+ *  the passed in transformation values.
+ ***********************************************************/
+glm::mat4 SceneManager::BuildModelMatrix(
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ)
 {
 	// variables for this method
 	glm::mat4 modelView;
@@ -297,10 +1216,7 @@ void SceneManager::SetTransformations(
 
 	modelView = translation * rotationZ * rotationY * rotationX * scale;
 
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setMat4Value(g_ModelName, modelView);
-	}
+	return(modelView);
 }
 
 /***********************************************************
@@ -326,6 +1242,7 @@ void SceneManager::SetShaderColor(
 	if (NULL != m_pShaderManager)
 	{
 		m_pShaderManager->setIntValue(g_UseTextureName, false);
+		m_pShaderManager->setBoolValue(g_UseAtlasTextureName, false);
 		m_pShaderManager->setVec4Value(g_ColorValueName, currentColor);
 	}
 }
@@ -345,6 +1262,16 @@ void SceneManager::SetShaderTexture(
 
 		int textureID = -1;
 		textureID = FindTextureSlot(textureTag);
+
+		// a packed texture samples its rectangle of the atlas
+		glm::vec4 atlasRect;
+		bool bAtlasTexture = ((textureID < 0) && (m_textureAtlas.FindRect(textureTag, atlasRect) == true));
+		if (bAtlasTexture == true)
+		{
+			textureID = FindTextureSlot(g_AtlasTextureTag);
+			m_pShaderManager->setVec4Value(g_AtlasRectName, atlasRect);
+		}
+		m_pShaderManager->setBoolValue(g_UseAtlasTextureName, bAtlasTexture);
 		m_pShaderManager->setSampler2DValue(g_TextureValueName, textureID);
 	}
 }
@@ -383,429 +1310,4569 @@ void SceneManager::SetShaderMaterial(
 			m_pShaderManager->setVec3Value("material.diffuseColor", material.diffuseColor);
 			m_pShaderManager->setVec3Value("material.specularColor", material.specularColor);
 			m_pShaderManager->setFloatValue("material.shininess", material.shininess);
+
+			int proceduralType = material.proceduralType;
+			if ((proceduralType != PROCEDURAL_NONE) && (material.bakeResolution > 0))
+			{
+				// sample the image baked at load time in place of the live
+				// evaluation, which stands in when it could not be baked
+				std::string bakedTag = g_BakedTexturePrefix + material.tag;
+				if (FindTextureSlot(bakedTag) >= 0)
+				{
+					SetShaderTexture(bakedTag);
+					proceduralType = PROCEDURAL_NONE;
+				}
+			}
+
+			m_pShaderManager->setIntValue(g_ProceduralTypeName, proceduralType);
+			if (proceduralType != PROCEDURAL_NONE)
+			{
+				// the procedural surface takes the place of the texture
+				m_pShaderManager->setIntValue(g_UseTextureName, true);
+				m_pShaderManager->setVec3Value(g_ProceduralColorAName, material.proceduralColorA);
+				m_pShaderManager->setVec3Value(g_ProceduralColorBName, material.proceduralColorB);
+				m_pShaderManager->setVec4Value(g_ProceduralParamsName, material.proceduralParams);
+			}
 		}
 	}
 }
 
-/**************************************************************/
-/*** STUDENTS CAN MODIFY the code in the methods BELOW for  ***/
-/*** preparing and rendering their own 3D replicated scenes.***/
-/*** Please refer to the code in the OpenGL sample project  ***/
-/*** for assistance.                                        ***/
-/**************************************************************/
-
-void SceneManager::LoadSceneTextures()
+/***********************************************************
+ *  SetShaderVirtualTexture()
+ *
+ *  This method is used for binding the virtual texture
+ *  associated with the passed in tag and setting its
+ *  layout into the shader.
+ ***********************************************************/
+void SceneManager::SetShaderVirtualTexture(
+	std::string virtualTextureTag)
 {
-	// Load Mug_Texture.jpg for the mug cylinder and torus.
-	if (CreateGLTexture("Textures/Mug_Texture.jpg", "mugTexture"))
+	int index = FindVirtualTexture(virtualTextureTag);
+	if ((NULL == m_pShaderManager) || (index < 0))
 	{
-		std::cout << "Loaded mugTexture (Mug_Texture.jpg) successfully.\n";
-	}
-	else
-	{
-		std::cout << "Failed to load mugTexture (Mug_Texture.jpg)!\n";
+		return;
 	}
 
-	// Load Table_Texture.jpg into memory for the plane.
-	if (CreateGLTexture("Textures/Table_Texture.jpg", "tableTexture"))
+	const VirtualTexture* pVirtualTexture = m_virtualTextures[index];
+	pVirtualTexture->Bind();
+
+	m_pShaderManager->setIntValue(g_UseTextureName, true);
+	m_pShaderManager->setBoolValue(g_UseVirtualTextureName, true);
+	// feedback pixels name the texture by its index plus one
+	m_pShaderManager->setIntValue("virtualTextureID", index + 1);
+	m_pShaderManager->setFloatValue("virtualTextureSize", static_cast<float>(pVirtualTexture->GetVirtualSize()));
+	m_pShaderManager->setIntValue("virtualTextureMipCount", pVirtualTexture->GetMipCount());
+	m_pShaderManager->setFloatValue("virtualTextureTileSize", static_cast<float>(pVirtualTexture->GetTileSize()));
+	m_pShaderManager->setFloatValue("virtualTextureBorder", static_cast<float>(pVirtualTexture->GetTileBorder()));
+	m_pShaderManager->setFloatValue("virtualTextureCacheSize", static_cast<float>(pVirtualTexture->GetCacheSize()));
+}
+
+/***********************************************************
+ *  UpdateObjectTransforms()
+ *
+ *  This method is used for computing the model matrix and
+ *  the world space bounds of every defined scene object.
+ ***********************************************************/
+void SceneManager::UpdateObjectTransforms()
+{
+	for (int i = 0; i < m_sceneObjects.size(); i++)
 	{
-		std::cout << "Loaded tableTexture (Table_Texture.jpg) successfully.\n";
+		UpdateObjectTransform(i);
 	}
-	else
+}
+
+/***********************************************************
+ *  UpdateObjectTransform()
+ *
+ *  This method is used for computing the model matrix and
+ *  the world space bounds of one scene object.
+ ***********************************************************/
+void SceneManager::UpdateObjectTransform(int index)
+{
+	SCENE_OBJECT& object = m_sceneObjects[index];
+
+	object.modelMatrix = BuildModelMatrix(
+		object.scaleXYZ,
+		object.rotationDegrees.x,
+		object.rotationDegrees.y,
+		object.rotationDegrees.z,
+		object.positionXYZ);
+	UpdateObjectBounds(object);
+}
+
+/***********************************************************
+ *  UpdateObjectBounds()
+ *
+ *  This method is used for computing the world space bounds
+ *  of one scene object from its model matrix, which rigid
+ *  bodies set without going through the transform values.
+ ***********************************************************/
+void SceneManager::UpdateObjectBounds(SCENE_OBJECT& object)
+{
+	// transform the corners of the local bounds into world space
+	glm::vec3 localMin;
+	glm::vec3 localMax;
+	GetShapeBounds(object.shape, localMin, localMax);
+
+	object.boundsMin = glm::vec3(FLT_MAX);
+	object.boundsMax = glm::vec3(-FLT_MAX);
+	for (int corner = 0; corner < 8; corner++)
 	{
-		std::cout << "Failed to load tableTexture (Table_Texture.jpg)!\n";
+		glm::vec3 localCorner(
+			(corner & 1) ? localMax.x : localMin.x,
+			(corner & 2) ? localMax.y : localMin.y,
+			(corner & 4) ? localMax.z : localMin.z);
+		glm::vec3 worldCorner = glm::vec3(object.modelMatrix * glm::vec4(localCorner, 1.0f));
+		object.boundsMin = glm::min(object.boundsMin, worldCorner);
+		object.boundsMax = glm::max(object.boundsMax, worldCorner);
 	}
+}
 
-	// Load Trout_Texture.jpg into memory for the fish.
-	if (CreateGLTexture("Textures/Trout_Texture.jpg", "troutTexture"))
+/***********************************************************
+ *  BuildVisibilitySets()
+ *
+ *  This method is used for loading the potentially visible
+ *  sets of the view cells from the asset cache, and baking
+ *  them across all cores when the cache is missing or was
+ *  baked from a different scene layout.
+ ***********************************************************/
+void SceneManager::BuildVisibilitySets(
+	const std::vector<SCENE_OBJECT>& objects,
+	PotentiallyVisibleSet& visibilitySets,
+	const std::string& cacheFile)
+{
+	std::vector<PotentiallyVisibleSet::PVS_OBJECT> pvsObjects;
+	for (int i = 0; i < objects.size(); i++)
 	{
-		std::cout << "Loaded troutTexture (Trout_Texture.jpg) successfully.\n";
+		PotentiallyVisibleSet::PVS_OBJECT pvsObject;
+		pvsObject.modelMatrix = objects[i].modelMatrix;
+		GetShapeBounds(objects[i].shape, pvsObject.boundsMin, pvsObject.boundsMax);
+		pvsObject.bOccluder = false;
+		pvsObject.occluderMin = glm::vec3(0.0f);
+		pvsObject.occluderMax = glm::vec3(0.0f);
+		if (objects[i].bOccluder)
+		{
+			pvsObject.bOccluder = GetShapeOccluderBounds(
+				objects[i].shape,
+				pvsObject.occluderMin,
+				pvsObject.occluderMax);
+		}
+		pvsObjects.push_back(pvsObject);
 	}
-	else
+
+	uint64_t sourceHash = PotentiallyVisibleSet::ComputeSourceHash(
+		pvsObjects, g_ViewRegionMin, g_ViewRegionMax, g_ViewCellSize);
+
+	if (visibilitySets.LoadFromCache(cacheFile.c_str(), sourceHash) == false)
 	{
-		std::cout << "Failed to load troutTexture (Trout_Texture.jpg)!\n";
+		visibilitySets.Bake(pvsObjects, g_ViewRegionMin, g_ViewRegionMax, g_ViewCellSize, m_pJobSystem);
+
+		std::error_code error;
+		std::filesystem::create_directories(g_AssetCacheFolder, error);
+		visibilitySets.SaveToCache(cacheFile.c_str());
 	}
+}
 
-	// Load Rod_Texture.jpg into memory for the fishing rod.
-	if (CreateGLTexture("Textures/Rod_Texture.jpg", "rodTexture"))
+/***********************************************************
+ *  DrawSceneObject()
+ *
+ *  This method is used for setting the transformation,
+ *  color, texture and material of the passed in scene
+ *  object into the shader and drawing its basic mesh.
+ ***********************************************************/
+void SceneManager::DrawSceneObject(const SCENE_OBJECT& object)
+{
+	if (NULL != m_pShaderManager)
 	{
-		std::cout << "Loaded rodTexture (Rod_Texture.jpg) successfully.\n";
+		m_pShaderManager->setMat4Value(g_ModelName, object.modelMatrix);
 	}
-	else
+
+	SetShaderColor(object.color.r, object.color.g, object.color.b, object.color.a);
+	if (object.textureTag.size() > 0)
 	{
-		std::cout << "Failed to load rodTexture (Rod_Texture.jpg)!\n";
+		SetShaderTexture(object.textureTag);
 	}
-	
-	// Load Box_Texture.jpg into memory for the tackle box.
-	if (CreateGLTexture("Textures/Box_Texture.jpg", "boxTexture"))
+	m_pShaderManager->setBoolValue(g_UseVirtualTextureName, false);
+	if (object.virtualTextureTag.size() > 0)
 	{
-		std::cout << "Loaded boxTexture (Box_Texture.jpg) successfully.\n";
+		SetShaderVirtualTexture(object.virtualTextureTag);
 	}
-	else
+	// procedural materials are mapped with the UV scale too
+	SetTextureUVScale(object.UVscale.x, object.UVscale.y);
+	if (object.materialTag.size() > 0)
 	{
-		std::cout << "Failed to load boxTexture (Box_Texture.jpg)!\n";
+		SetShaderMaterial(object.materialTag);
 	}
-	
-	// Load Cork_Texture.jpg into memory for the fishing rod handle.
-	if (CreateGLTexture("Textures/Cork_Texture.jpg", "corkTexture"))
+
+	if (NULL != m_pShaderManager)
 	{
-		std::cout << "Loaded corkTexture (Cork_Texture.jpg) successfully.\n";
+		m_pShaderManager->setIntValue(g_PointLightCountName, object.pointLightCount);
+		for (int i = 0; i < object.pointLightCount; i++)
+		{
+			m_pShaderManager->setIntValue(g_PointLightIndexNames[i], object.pointLightIndices[i]);
+		}
+		m_pShaderManager->setBoolValue(g_VertexLightingName, object.bVertexLighting);
 	}
-	else
+
+	DrawShapeMesh(object.shape);
+}
+
+/***********************************************************
+ *  DrawFishSchools()
+ *
+ *  This method is used for drawing every fish school with
+ *  one instanced draw each.  The instances carry their own
+ *  transform and time in the swim cycle, so the model
+ *  matrix is left at identity.
+ ***********************************************************/
+void SceneManager::DrawFishSchools(bool bDepthOnly)
+{
+	if ((m_bAquarium == false) || (m_vertexAnimation.IsOpen() == false) || (NULL == m_pShaderManager))
 	{
-		std::cout << "Failed to load corkTexture (Cork_Texture.jpg)!\n";
+		return;
 	}
 
-	// Load Tail_Texture.jpg into memory for the fish tail.
-	if (CreateGLTexture("Textures/Tail_Texture.jpg", "tailTexture"))
+	float time = std::chrono::duration<float>(std::chrono::steady_clock::now() - m_schoolStartTime).count();
+	m_vertexAnimation.Bind();
+	m_pShaderManager->setBoolValue(g_VertexAnimationName, true);
+	m_pShaderManager->setFloatValue(g_VertexAnimationTimeName, time);
+	m_pShaderManager->setMat4Value(g_ModelName, glm::mat4(1.0f));
+	if (bDepthOnly == false)
 	{
-		std::cout << "Loaded tailTexture (Tail_Texture.jpg) successfully.\n";
+		SetShaderColor(1.0f, 1.0f, 1.0f, 1.0f);
+		SetShaderTexture("troutTexture");
+		m_pShaderManager->setBoolValue(g_UseVirtualTextureName, false);
+		SetTextureUVScale(1.0f, 1.0f);
+		SetShaderMaterial("fish");
+		m_pShaderManager->setBoolValue(g_VertexLightingName, false);
 	}
-	else
+
+	for (int i = 0; i < m_fishSchools.size(); i++)
 	{
-		std::cout << "Failed to load tailTexture (Tail_Texture.jpg)!\n";
+		const FISH_SCHOOL& school = m_fishSchools[i];
+		if (bDepthOnly == false)
+		{
+			m_pShaderManager->setIntValue(g_PointLightCountName, school.pointLightCount);
+			for (int j = 0; j < school.pointLightCount; j++)
+			{
+				m_pShaderManager->setIntValue(g_PointLightIndexNames[j], school.pointLightIndices[j]);
+			}
+		}
+		m_vertexAnimation.DrawSchool(school.school);
 	}
 
-	// Load Reel_Texture.jpg into memory for the fishing reel.
-	if (CreateGLTexture("Textures/Reel_Texture.jpg", "reelTexture"))
+	m_pShaderManager->setBoolValue(g_VertexAnimationName, false);
+}
+
+/***********************************************************
+ *  DrawLake()
+ *
+ *  This method is used for drawing the lake as rings of
+ *  grid tiles around the camera, displaced by the simulated
+ *  waves in the vertex shader.  The tiles carry their own
+ *  placement, so the model matrix only lifts them to the
+ *  lake level.
+ ***********************************************************/
+void SceneManager::DrawLake(bool bDepthOnly)
+{
+	if ((m_bLake == false) || (m_waterSurface.IsReady() == false) || (NULL == m_pShaderManager))
 	{
-		std::cout << "Loaded reelTexture (Reel_Texture.jpg) successfully.\n";
+		return;
 	}
-	else
+
+	m_waterSurface.Bind();
+	m_pShaderManager->setBoolValue(g_WaterSurfaceName, true);
+	m_pShaderManager->setMat4Value(g_ModelName, glm::translate(glm::vec3(0.0f, g_LakeLevel, 0.0f)));
+	if (bDepthOnly == false)
 	{
-		std::cout << "Failed to load reelTexture (Reel_Texture.jpg)!\n";
+		SetShaderColor(0.05f, 0.18f, 0.22f, 1.0f);
+		m_pShaderManager->setBoolValue(g_UseVirtualTextureName, false);
+		SetTextureUVScale(1.0f, 1.0f);
+		SetShaderMaterial("water");
+		m_pShaderManager->setBoolValue(g_VertexLightingName, false);
+		m_pShaderManager->setIntValue(g_PointLightCountName, m_lakePointLightCount);
+		for (int i = 0; i < m_lakePointLightCount; i++)
+		{
+			m_pShaderManager->setIntValue(g_PointLightIndexNames[i], m_lakePointLightIndices[i]);
+		}
 	}
 
-	BindGLTextures();
-}
-
-void SceneManager::DefineObjectMaterials() {
+	m_waterSurface.DrawGrid(m_cameraPosition);
 
-	// Wood material for the table.
-	OBJECT_MATERIAL woodMaterial;
-	woodMaterial.diffuseColor = glm::vec3(0.2f, 0.2f, 0.3f);
-	woodMaterial.specularColor = glm::vec3(0.0f, 0.0f, 0.0f);
-	woodMaterial.shininess = 5.0;
-	woodMaterial.tag = "wood";
-	m_objectMaterials.push_back(woodMaterial);
+	m_pShaderManager->setBoolValue(g_WaterSurfaceName, false);
+}
 
-	// Ceramic material for the mug.
-	OBJECT_MATERIAL ceramicMaterial;
-	ceramicMaterial.diffuseColor = glm::vec3(0.4f, 0.4f, 0.4f);
-	ceramicMaterial.specularColor = glm::vec3(0.2f, 0.2f, 0.2f);
-	ceramicMaterial.shininess = 30.0;
-	ceramicMaterial.tag = "mug";
-	m_objectMaterials.push_back(ceramicMaterial);
+/***********************************************************
+ *  DrawTerrain()
+ *
+ *  This method is used for drawing the terrain nodes chosen
+ *  by the last update in one instanced draw.  The nodes
+ *  carry their own placement and the vertex shader reads
+ *  the heights, so the model matrix is left as identity.
+ ***********************************************************/
+void SceneManager::DrawTerrain(bool bDepthOnly)
+{
+	if ((m_bTerrain == false) || (m_terrain.IsReady() == false) || (NULL == m_pShaderManager))
+	{
+		return;
+	}
 
-	// Tackle box material.
-	OBJECT_MATERIAL tackleMaterial;
-	tackleMaterial.diffuseColor = glm::vec3(0.4f, 0.4f, 0.4f);
-	tackleMaterial.specularColor = glm::vec3(0.2f, 0.2f, 0.2f);
-	tackleMaterial.shininess = 15.0f;
-	tackleMaterial.tag = "tackleBox";
-	m_objectMaterials.push_back(tackleMaterial);
+	m_terrain.Bind();
+	m_pShaderManager->setBoolValue(g_TerrainName, true);
+	m_pShaderManager->setMat4Value(g_ModelName, glm::mat4(1.0f));
+	if (bDepthOnly == false)
+	{
+		SetShaderColor(1.0f, 1.0f, 1.0f, 1.0f);
+		m_pShaderManager->setIntValue(g_UseTextureName, true);
+		m_pShaderManager->setBoolValue(g_UseVirtualTextureName, false);
+		SetTextureUVScale(1.0f, 1.0f);
+		SetShaderMaterial("terrain");
+		m_pShaderManager->setBoolValue(g_VertexLightingName, false);
+		m_pShaderManager->setIntValue(g_PointLightCountName, m_terrainPointLightCount);
+		for (int i = 0; i < m_terrainPointLightCount; i++)
+		{
+			m_pShaderManager->setIntValue(g_PointLightIndexNames[i], m_terrainPointLightIndices[i]);
+		}
+	}
 
-	// Fish material.
-	OBJECT_MATERIAL fishMaterial;
-	fishMaterial.diffuseColor = glm::vec3(0.6f, 0.6f, 0.6f);
-	fishMaterial.specularColor = glm::vec3(0.3f, 0.3f, 0.3f);
-	fishMaterial.shininess = 50.0f;
-	fishMaterial.tag = "fish";
-	m_objectMaterials.push_back(fishMaterial);
+	m_terrain.Draw();
 
-	// Cork material for fishing rod handle.
-	OBJECT_MATERIAL corkMaterial;
-	corkMaterial.diffuseColor = glm::vec3(0.8f, 0.6f, 0.4f);
-	corkMaterial.specularColor = glm::vec3(0.1f, 0.1f, 0.1f);
-	corkMaterial.shininess = 5.0f;
-	corkMaterial.tag = "cork";
-	m_objectMaterials.push_back(corkMaterial);
+	m_pShaderManager->setBoolValue(g_TerrainName, false);
 }
 
-void SceneManager::SetupSceneLights() {
+/***********************************************************
+ *  DrawFoliage()
+ *
+ *  This method is used for drawing the clumps the culling
+ *  pass kept, in one indirect draw.  The clumps carry their
+ *  own placement, so the model matrix is left as identity.
+ ***********************************************************/
+void SceneManager::DrawFoliage(bool bDepthOnly)
+{
+	if ((m_bFoliage == false) || (m_bTerrain == false) || (m_foliage.IsReady() == false) || (NULL == m_pShaderManager))
+	{
+		return;
+	}
 
-	// Enable lighting in the shader.
-	m_pShaderManager->setBoolValue(g_UseLightingName, true);
+	float swayTime = std::chrono::duration<float>(std::chrono::steady_clock::now() - m_foliageStartTime).count();
+	m_pShaderManager->setBoolValue(g_FoliageName, true);
+	m_pShaderManager->setFloatValue(g_FoliageTimeName, swayTime);
+	m_pShaderManager->setMat4Value(g_ModelName, glm::mat4(1.0f));
+	if (bDepthOnly == false)
+	{
+		SetShaderColor(1.0f, 1.0f, 1.0f, 1.0f);
+		m_pShaderManager->setIntValue(g_UseTextureName, true);
+		m_pShaderManager->setBoolValue(g_UseVirtualTextureName, false);
+		SetTextureUVScale(1.0f, 1.0f);
+		SetShaderMaterial("foliage");
+		m_pShaderManager->setBoolValue(g_VertexLightingName, false);
+		m_pShaderManager->setIntValue(g_PointLightCountName, m_foliagePointLightCount);
+		for (int i = 0; i < m_foliagePointLightCount; i++)
+		{
+			m_pShaderManager->setIntValue(g_PointLightIndexNames[i], m_foliagePointLightIndices[i]);
+		}
+	}
 
-	// Main directional light (coming from above and slightly behind).
-	glm::vec3 dir = glm::normalize(glm::vec3(0.3f, -1.0f, 0.5f));
-	m_pShaderManager->setVec3Value("directionalLight.direction", dir);
+	m_foliage.Draw();
 
-	// Ambient low for contrast.
-	m_pShaderManager->setVec3Value("directionalLight.ambient", 0.15f, 0.15f, 0.15f);
+	m_pShaderManager->setBoolValue(g_FoliageName, false);
+}
 
-	// Strong main light.
-	m_pShaderManager->setVec3Value("directionalLight.diffuse", 1.0f, 0.95f, 0.8f);
-	m_pShaderManager->setVec3Value("directionalLight.specular", 0.8f, 0.8f, 0.8f);
-	m_pShaderManager->setBoolValue("directionalLight.bActive", true);
+/***********************************************************
+ *  DrawSky()
+ *
+ *  This method is used for drawing the sky on the far plane
+ *  with one triangle covering the screen.  Depth is tested
+ *  but not written, so the sky only shades the pixels that
+ *  nothing was drawn to when it comes after the depth
+ *  pre-pass.
+ ***********************************************************/
+void SceneManager::DrawSky()
+{
+	if ((m_bSky == false) || (m_atmosphere.IsReady() == false) || (NULL == m_pShaderManager))
+	{
+		return;
+	}
 
-	// Brighter point light to simulate sunlight.
-	m_pShaderManager->setVec3Value("pointLights[0].position", -2.0f, 6.0f, -4.0f);
+	GLint oldDepthFunc = GL_LESS;
+	GLboolean oldDepthMask = GL_TRUE;
+	glGetIntegerv(GL_DEPTH_FUNC, &oldDepthFunc);
+	glGetBooleanv(GL_DEPTH_WRITEMASK, &oldDepthMask);
+	glDepthFunc(GL_LEQUAL);
+	glDepthMask(GL_FALSE);
 
-	// Increased ambient for overall brightness.
-	m_pShaderManager->setVec3Value("pointLights[0].ambient", 0.2f, 0.2f, 0.2f);
+	m_atmosphere.Bind();
+	m_pShaderManager->setBoolValue(g_SkyName, true);
+	m_atmosphere.Draw();
+	m_pShaderManager->setBoolValue(g_SkyName, false);
 
-	// Stronger diffuse light.
-	m_pShaderManager->setVec3Value("pointLights[0].diffuse", 1.0f, 0.98f, 0.9f);
-	
-	// Increased specular for sun-like highlights.
-	m_pShaderManager->setVec3Value("pointLights[0].specular", 0.8f, 0.8f, 0.8f);
+	glDepthMask(oldDepthMask);
+	glDepthFunc(oldDepthFunc);
+}
 
-	// Adjusted attenuation for stronger reach.
-	m_pShaderManager->setFloatValue("pointLights[0].constant", 1.0f);
-	m_pShaderManager->setFloatValue("pointLights[0].linear", 0.045f);
-	m_pShaderManager->setFloatValue("pointLights[0].quadratic", 0.0075f);
-	m_pShaderManager->setBoolValue("pointLights[0].bActive", true);
+/***********************************************************
+ *  ResolveReflections()
+ *
+ *  This method is used for tracing the reflections of the
+ *  opaque scene drawn so far and blending them in.  A ray
+ *  that leaves the screen sees the sky when it is drawn,
+ *  and otherwise the ambient light of the directional
+ *  light, standing in for a reflection probe.
+ ***********************************************************/
+void SceneManager::ResolveReflections()
+{
+	bool bSky = (m_bSky) && (m_atmosphere.IsReady());
+	glm::vec3 ambientColor = bSky ? m_atmosphere.GetAmbientColor() : m_directionalLight.ambient;
 
+	m_reflections.Resolve(
+		m_viewMatrix,
+		m_projectionMatrix,
+		m_bLinearMarch,
+		bSky ? &m_atmosphere : NULL,
+		ambientColor);
 }
 
 /***********************************************************
- *  PrepareScene()
+ *  DrawFishingLines()
  *
- *  This method is used for preparing the 3D scene by loading
- *  the shapes, textures in memory to support the 3D scene 
- *  rendering
+ *  This method is used for drawing every fishing line in
+ *  one draw from the streamed points.  The points are
+ *  already in world space, and the ribbons are kept at
+ *  least a pixel wide, so the thin line does not break up
+ *  into dashes in the distance.
  ***********************************************************/
-void SceneManager::PrepareScene()
+void SceneManager::DrawFishingLines(bool bDepthOnly)
 {
-	// Load the textures for the 3d scene.
-	LoadSceneTextures();
+	if ((m_fishingLines.IsReady() == false) || (m_fishingLines.GetLineCount() == 0) || (NULL == m_pShaderManager))
+	{
+		return;
+	}
 
-	DefineObjectMaterials();
+	// the width of one pixel at a distance of one from the camera
+	GLint viewport[4] = { 0, 0, 0, 0 };
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	float pixelScale = 2.0f / (m_projectionMatrix[1][1] * std::max(viewport[3], 1));
 
-	SetupSceneLights();
+	m_fishingLines.Bind();
+	m_pShaderManager->setBoolValue(g_FishingLineName, true);
+	m_pShaderManager->setFloatValue("fishingLinePixelScale", pixelScale);
+	m_pShaderManager->setMat4Value(g_ModelName, glm::mat4(1.0f));
+	if (bDepthOnly == false)
+	{
+		SetShaderColor(0.55f, 0.75f, 0.7f, 1.0f);
+		m_pShaderManager->setBoolValue(g_UseVirtualTextureName, false);
+		SetTextureUVScale(1.0f, 1.0f);
+		SetShaderMaterial("line");
+		m_pShaderManager->setBoolValue(g_VertexLightingName, false);
+		m_pShaderManager->setIntValue(g_PointLightCountName, m_fishingLinePointLightCount);
+		for (int i = 0; i < m_fishingLinePointLightCount; i++)
+		{
+			m_pShaderManager->setIntValue(g_PointLightIndexNames[i], m_fishingLinePointLightIndices[i]);
+		}
+	}
 
-	// only one instance of a particular mesh needs to be
-	// loaded in memory no matter how many times it is drawn
-	// in the rendered 3D scene
+	m_fishingLines.Draw();
 
-	m_basicMeshes->LoadPlaneMesh();
-	m_basicMeshes->LoadCylinderMesh();
-	m_basicMeshes->LoadTorusMesh();
-	m_basicMeshes->LoadBoxMesh();
-	m_basicMeshes->LoadSphereMesh();
+	m_pShaderManager->setBoolValue(g_FishingLineName, false);
 }
 
 /***********************************************************
- *  RenderScene()
+ *  DrawThrownBobbers()
  *
- *  This method is used for rendering the 3D scene by 
- *  transforming and drawing the basic 3D shapes
+ *  This method is used for drawing the bobbers thrown at
+ *  the props.  They are not part of the visibility sets,
+ *  so they are drawn wherever they landed.
  ***********************************************************/
-void SceneManager::RenderScene()
+void SceneManager::DrawThrownBobbers(bool bDepthOnly)
 {
-	// Declare the variables for the transformations.
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
-
-	/*** Set needed transformations before drawing the basic mesh.  ***/
-	/*** This same ordering of code should be used for transforming ***/
-	/*** and drawing all the basic 3D shapes.						***/
-	/******************************************************************/
-	// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(25.0f, 1.0f, 15.0f);
-	positionXYZ = glm::vec3(0.0f, -0.5f, 0.0f);
-	SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
-	SetShaderTexture("tableTexture");
-	SetTextureUVScale(4.0f, 3.0f);
-	SetShaderMaterial("wood");
-
-	// Draw the plane.
-	m_basicMeshes->DrawPlaneMesh();
-
-	/****************************************************************/
-
-	// Coffee mug.
-	scaleXYZ = glm::vec3(1.2f, 2.0f, 1.2f);
-	positionXYZ = glm::vec3(4.0f, 0.0f, 0.0f);
-	SetTransformations(scaleXYZ, 0.0f, 30.0f, 0.0f, positionXYZ);
-	SetShaderColor(1.0f, 1.0f, 1.0f, 1.0f);
-	SetShaderTexture("mugTexture");
-	SetTextureUVScale(1.0, 1.0);
-	SetShaderMaterial("mug");
-	
-	// Draw the cylinder.
-	m_basicMeshes->DrawCylinderMesh();
+	if ((m_bPhysics == false) || (NULL == m_pShaderManager))
+	{
+		return;
+	}
 
-	/****************************************************************/
+	for (int i = 0; i < m_thrownBobbers.size(); i++)
+	{
+		const SCENE_OBJECT& object = m_thrownBobbers[i].object;
+		if (bDepthOnly)
+		{
+			m_pShaderManager->setMat4Value(g_ModelName, object.modelMatrix);
+			DrawShapeMesh(object.shape);
+		}
+		else
+		{
+			DrawSceneObject(object);
+		}
+	}
+}
 
-	// Torus for mug handle.
-	// Set the XYZ scale for the torus.
-	scaleXYZ = glm::vec3(0.5f, 0.75f, 0.5f);
+/***********************************************************
+ *  DrawShapeMesh()
+ *
+ *  This method is used for drawing the basic mesh of the
+ *  passed in shape with the current shader values.
+ ***********************************************************/
+void SceneManager::DrawShapeMesh(SHAPE_TYPE shape)
+{
+	switch (shape)
+	{
+	case SHAPE_PLANE:
+		m_basicMeshes->DrawPlaneMesh();
+		break;
+	case SHAPE_CYLINDER:
+		m_basicMeshes->DrawCylinderMesh();
+		break;
+	case SHAPE_TORUS:
+		m_basicMeshes->DrawTorusMesh();
+		break;
+	case SHAPE_BOX:
+		m_basicMeshes->DrawBoxMesh();
+		break;
+	case SHAPE_SPHERE:
+		m_basicMeshes->DrawSphereMesh();
+		break;
+	}
+}
 
-	// Set the XYZ position for the torus.
-	positionXYZ = glm::vec3(5.25f, 1.0f, 0.0f);
-	SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
-	SetShaderColor(1.0f, 1.0f, 1.0f, 1.0f);
-	SetShaderTexture("mugTexture");
-	SetTextureUVScale(1.0, 1.0);
-	SetShaderMaterial("mug");
+/***********************************************************
+ *  SetCameraPosition()
+ *
+ *  This method is used for setting the world position of
+ *  the camera that the next rendered frame is viewed from.
+ ***********************************************************/
+void SceneManager::SetCameraPosition(glm::vec3 position)
+{
+	m_cameraPosition = position;
+}
 
-	// Draw the torus.
-	m_basicMeshes->DrawTorusMesh();
+/***********************************************************
+ *  SetDepthPrepassEnabled()
+ *
+ *  This method is used for turning the opaque depth
+ *  pre-pass on or off.
+ ***********************************************************/
+void SceneManager::SetDepthPrepassEnabled(bool bEnabled)
+{
+	if (m_bDepthPrepass != bEnabled)
+	{
+		m_bDepthPrepass = bEnabled;
 
-	/****************************************************************/
+		// restart the averaging so the report covers a single mode
+		m_timedFrames = 0;
+		m_gpuTimeTotal = 0.0;
+	}
+}
+
+/***********************************************************
+ *  SetAquariumEnabled()
+ *
+ *  This method is used for switching the fish schools of
+ *  the aquarium variant of the scene on and off.
+ ***********************************************************/
+void SceneManager::SetAquariumEnabled(bool bEnabled)
+{
+	if (m_bAquarium != bEnabled)
+	{
+		m_bAquarium = bEnabled;
+
+		// restart the averaging so the report covers a single mode
+		m_timedFrames = 0;
+		m_gpuTimeTotal = 0.0;
+	}
+}
+
+/***********************************************************
+ *  SetBoidComputeEnabled()
+ *
+ *  This method is used for moving the flocking of the fish
+ *  schools between the CPU and compute shaders.  The program
+ *  is loaded the first time it is asked for, and the schools
+ *  stay on the CPU until asked again when it cannot be.
+ ***********************************************************/
+void SceneManager::SetBoidComputeEnabled(bool bEnabled)
+{
+	if (m_bBoidComputeRequested == bEnabled)
+	{
+		return;
+	}
+	m_bBoidComputeRequested = bEnabled;
+
+	if ((bEnabled) && (m_boidComputeProgram == 0))
+	{
+		m_boidComputeProgram = LoadComputeProgram(g_BoidComputeShaderFile);
+	}
+	bEnabled = (bEnabled) && (m_boidComputeProgram != 0);
+
+	if (m_bBoidCompute != bEnabled)
+	{
+		m_bBoidCompute = bEnabled;
+
+		// restart the averaging so the report covers a single mode
+		m_flockedFrames = 0;
+		m_flockTimeTotal = 0.0;
+	}
+}
+
+/***********************************************************
+ *  SetLakeEnabled()
+ *
+ *  This method is used for switching the lake around the
+ *  table on and off.
+ ***********************************************************/
+void SceneManager::SetLakeEnabled(bool bEnabled)
+{
+	if (m_bLake != bEnabled)
+	{
+		m_bLake = bEnabled;
+
+		// restart the averaging so the report covers a single mode
+		m_timedFrames = 0;
+		m_gpuTimeTotal = 0.0;
+		m_simulatedLakeFrames = 0;
+		m_lakeTimeTotal = 0.0;
+	}
+}
+
+/***********************************************************
+ *  SetTerrainEnabled()
+ *
+ *  This method is used for switching the terrain around the
+ *  lake on and off.
+ ***********************************************************/
+void SceneManager::SetTerrainEnabled(bool bEnabled)
+{
+	if (m_bTerrain != bEnabled)
+	{
+		m_bTerrain = bEnabled;
+
+		// restart the averaging so the report covers a single mode
+		m_timedFrames = 0;
+		m_gpuTimeTotal = 0.0;
+		m_updatedTerrainFrames = 0;
+		m_terrainTimeTotal = 0.0;
+		m_terrainSeconds = 0.0;
+		m_placeholderSeconds = 0.0;
+		m_prefetchUsedTotal = 0;
+		m_prefetchWastedTotal = 0;
+	}
+}
+
+/***********************************************************
+ *  SetPrefetchEnabled()
+ *
+ *  This method is used for switching the prefetch of the
+ *  terrain tiles along the predicted camera path on and
+ *  off.
+ ***********************************************************/
+void SceneManager::SetPrefetchEnabled(bool bEnabled)
+{
+	if (m_bPrefetch != bEnabled)
+	{
+		m_bPrefetch = bEnabled;
+
+		// restart the averaging so the report covers a single mode
+		m_updatedTerrainFrames = 0;
+		m_terrainTimeTotal = 0.0;
+		m_terrainSeconds = 0.0;
+		m_placeholderSeconds = 0.0;
+		m_prefetchUsedTotal = 0;
+		m_prefetchWastedTotal = 0;
+	}
+}
+
+/***********************************************************
+ *  SetFoliageEnabled()
+ *
+ *  This method is used for switching the grass and reeds on
+ *  the terrain on and off.  The compute program is loaded
+ *  and the foliage defined the first time it is asked for,
+ *  and it stays off until asked again when it cannot be.
+ ***********************************************************/
+void SceneManager::SetFoliageEnabled(bool bEnabled)
+{
+	if (m_bFoliageRequested == bEnabled)
+	{
+		return;
+	}
+	m_bFoliageRequested = bEnabled;
+
+	if ((bEnabled) && (m_foliageComputeProgram == 0))
+	{
+		m_foliageComputeProgram = LoadComputeProgram(g_FoliageComputeShaderFile);
+		DefineFoliage();
+	}
+	bEnabled = (bEnabled) && (m_foliage.IsReady());
+
+	if (m_bFoliage != bEnabled)
+	{
+		m_bFoliage = bEnabled;
+
+		// restart the averaging so the report covers a single mode
+		m_timedFrames = 0;
+		m_gpuTimeTotal = 0.0;
+		m_updatedFoliageFrames = 0;
+		m_foliageTimeTotal = 0.0;
+	}
+}
+
+/***********************************************************
+ *  SetSkyEnabled()
+ *
+ *  This method is used for switching the sky, and the sun
+ *  and sky colors of the directional light read off its
+ *  tables, on and off.  The compute program is loaded and
+ *  the tables created the first time it is asked for, and
+ *  it stays off until asked again when they cannot be.
+ ***********************************************************/
+void SceneManager::SetSkyEnabled(bool bEnabled)
+{
+	if (m_bSkyRequested == bEnabled)
+	{
+		return;
+	}
+	m_bSkyRequested = bEnabled;
+
+	if ((bEnabled) && (m_atmosphereComputeProgram == 0))
+	{
+		m_atmosphereComputeProgram = LoadComputeProgram(g_AtmosphereComputeShaderFile);
+		DefineSky();
+	}
+	bEnabled = (bEnabled) && (m_atmosphere.IsReady());
+
+	if (m_bSky != bEnabled)
+	{
+		m_bSky = bEnabled;
+		UploadDirectionalLight();
+
+		// restart the averaging so the report covers a single mode
+		m_timedFrames = 0;
+		m_gpuTimeTotal = 0.0;
+		m_updatedSkyFrames = 0;
+		m_skyViewUpdates = 0;
+		m_skyTimeTotal = 0.0;
+	}
+}
+
+/***********************************************************
+ *  SetReflectionsEnabled()
+ *
+ *  This method is used for switching the reflections of the
+ *  screen on and off.  The compute program is loaded the
+ *  first time they are asked for, and they stay off until
+ *  asked again when it cannot be.
+ ***********************************************************/
+void SceneManager::SetReflectionsEnabled(bool bEnabled)
+{
+	if (m_bReflectionsRequested == bEnabled)
+	{
+		return;
+	}
+	m_bReflectionsRequested = bEnabled;
+
+	if ((bEnabled) && (m_reflectionComputeProgram == 0))
+	{
+		m_reflectionComputeProgram = LoadComputeProgram(g_ReflectionComputeShaderFile);
+		DefineReflections();
+	}
+	bEnabled = (bEnabled) && (m_reflections.IsReady());
+
+	if (m_bReflections != bEnabled)
+	{
+		m_bReflections = bEnabled;
+
+		// restart the averaging so the report covers a single mode
+		m_timedFrames = 0;
+		m_gpuTimeTotal = 0.0;
+		m_reflectionFrames = 0;
+		m_reflectionTimeTotal = 0.0;
+	}
+}
+
+/***********************************************************
+ *  SetLinearMarchEnabled()
+ *
+ *  This method is used for switching the reflections from
+ *  the trace through the depth pyramid to a linear march of
+ *  the same rays and back, to compare their GPU time.
+ ***********************************************************/
+void SceneManager::SetLinearMarchEnabled(bool bEnabled)
+{
+	if (m_bLinearMarch != bEnabled)
+	{
+		m_bLinearMarch = bEnabled;
+
+		// restart the averaging so the report covers a single mode
+		m_timedFrames = 0;
+		m_gpuTimeTotal = 0.0;
+		m_reflectionFrames = 0;
+		m_reflectionTimeTotal = 0.0;
+	}
+}
+
+/***********************************************************
+ *  SetTackleDisplayEnabled()
+ *
+ *  This method is used for hanging the lines of the tackle
+ *  shop display behind the table or taking them down.  The
+ *  fishing lines are defined again, so the lines left all
+ *  start from rest.
+ ***********************************************************/
+void SceneManager::SetTackleDisplayEnabled(bool bEnabled)
+{
+	if (m_bTackleDisplay != bEnabled)
+	{
+		m_bTackleDisplay = bEnabled;
+		DefineFishingLines();
+
+		// restart the averaging so the report covers a single mode
+		m_timedFrames = 0;
+		m_gpuTimeTotal = 0.0;
+		m_simulatedLineFrames = 0;
+		m_lineTimeTotal = 0.0;
+	}
+}
+
+/***********************************************************
+ *  SetPhysicsEnabled()
+ *
+ *  This method is used for switching the rigid bodies of
+ *  the tabletop props on and off.  The props are put back
+ *  where they were defined and the bodies defined again
+ *  either way, so each run starts from the same layout.
+ *  Once the props move the baked visibility sets no longer
+ *  hold, so they are dropped.
+ ***********************************************************/
+void SceneManager::SetPhysicsEnabled(bool bEnabled)
+{
+	if (m_bPhysics != bEnabled)
+	{
+		m_bPhysics = bEnabled;
+		for (int i = 0; i < m_physicsProps.size(); i++)
+		{
+			UpdateObjectTransform(m_physicsProps[i].object);
+		}
+		DefineRigidBodies();
+		if (m_bPhysics)
+		{
+			DisableVisibilitySets();
+		}
+
+		// restart the averaging so the report covers a single mode
+		m_timedFrames = 0;
+		m_gpuTimeTotal = 0.0;
+		m_simulatedPhysicsFrames = 0;
+		m_physicsTimeTotal = 0.0;
+	}
+}
+
+/***********************************************************
+ *  UploadPointLights()
+ *
+ *  This method is used for setting the defined point lights
+ *  into the shader light slots, switching off unused slots.
+ ***********************************************************/
+void SceneManager::UploadPointLights()
+{
+	if (NULL == m_pShaderManager)
+	{
+		return;
+	}
+
+	if (m_pointLights.size() > TOTAL_POINT_LIGHTS)
+	{
+		std::cout << "Only the first " << TOTAL_POINT_LIGHTS << " of "
+			<< m_pointLights.size() << " point lights fit in the shader" << std::endl;
+	}
+
+	for (int i = 0; i < TOTAL_POINT_LIGHTS; i++)
+	{
+		UploadPointLight(i);
+	}
+}
+
+/***********************************************************
+ *  UploadPointLight()
+ *
+ *  This method is used for setting one shader light slot
+ *  from the point light defined for it, or switching the
+ *  slot off when no light is defined for it.
+ ***********************************************************/
+void SceneManager::UploadPointLight(int slot)
+{
+	if ((NULL == m_pShaderManager) || (slot < 0) || (slot >= TOTAL_POINT_LIGHTS))
+	{
+		return;
+	}
+
+	std::string slotName = "pointLights[" + std::to_string(slot) + "].";
+	if (slot < m_pointLights.size())
+	{
+		const POINT_LIGHT& light = m_pointLights[slot];
+		m_pShaderManager->setVec3Value(slotName + "position", light.position);
+		m_pShaderManager->setVec3Value(slotName + "ambient", light.ambient);
+		m_pShaderManager->setVec3Value(slotName + "diffuse", light.diffuse);
+		m_pShaderManager->setVec3Value(slotName + "specular", light.specular);
+		m_pShaderManager->setFloatValue(slotName + "constant", light.constant);
+		m_pShaderManager->setFloatValue(slotName + "linear", light.linear);
+		m_pShaderManager->setFloatValue(slotName + "quadratic", light.quadratic);
+		m_pShaderManager->setBoolValue(slotName + "bActive", light.bActive);
+	}
+	else
+	{
+		m_pShaderManager->setBoolValue(slotName + "bActive", false);
+	}
+}
+
+/***********************************************************
+ *  UploadDirectionalLight()
+ *
+ *  This method is used for setting the defined directional
+ *  light into the shader.
+ ***********************************************************/
+void SceneManager::UploadDirectionalLight()
+{
+	if (NULL == m_pShaderManager)
+	{
+		return;
+	}
+
+	// under the sky the sunlight and the ambient light are read off
+	// the atmosphere tables instead of the defined colors
+	glm::vec3 ambient = m_directionalLight.ambient;
+	glm::vec3 diffuse = m_directionalLight.diffuse;
+	glm::vec3 specular = m_directionalLight.specular;
+	if ((m_bSky) && (m_atmosphere.IsReady()))
+	{
+		ambient = m_atmosphere.GetAmbientColor();
+		diffuse = m_atmosphere.GetSunColor();
+		specular = m_atmosphere.GetSunColor();
+		m_pShaderManager->setVec3Value("skySunDirection", m_atmosphere.GetSunDirection());
+		m_pShaderManager->setVec3Value("skySunDiskColor", m_atmosphere.GetSunDiskColor());
+	}
+
+	m_pShaderManager->setVec3Value("directionalLight.direction", glm::normalize(m_directionalLight.direction));
+	m_pShaderManager->setVec3Value("directionalLight.ambient", ambient);
+	m_pShaderManager->setVec3Value("directionalLight.diffuse", diffuse);
+	m_pShaderManager->setVec3Value("directionalLight.specular", specular);
+	m_pShaderManager->setBoolValue("directionalLight.bActive", m_directionalLight.bActive);
+}
+
+/***********************************************************
+ *  UploadSceneUniforms()
+ *
+ *  This method is used for setting the shader values that
+ *  are set once rather than for every frame, again after
+ *  the shaders were reloaded.
+ ***********************************************************/
+void SceneManager::UploadSceneUniforms()
+{
+	m_pShaderManager->setBoolValue(g_UseLightingName, true);
+	UploadDirectionalLight();
+	UploadPointLights();
+
+	m_pShaderManager->setSampler2DValue("virtualTexturePhysical", g_VirtualTexturePhysicalUnit);
+	m_pShaderManager->setSampler2DValue("virtualTexturePageTable", g_VirtualTexturePageTableUnit);
+
+	m_pShaderManager->setSampler2DValue("vertexAnimationPositions", g_VertexAnimationPositionUnit);
+	m_pShaderManager->setSampler2DValue("vertexAnimationNormals", g_VertexAnimationNormalUnit);
+	m_pShaderManager->setIntValue("vertexAnimationFrameCount", std::max(m_vertexAnimation.GetFrameCount(), 1));
+	m_pShaderManager->setFloatValue("vertexAnimationDuration", m_vertexAnimation.GetDuration());
+
+	m_pShaderManager->setSampler2DValue("waterDisplacements", g_WaterDisplacementUnit);
+	m_pShaderManager->setSampler2DValue("waterNormals", g_WaterNormalUnit);
+	m_pShaderManager->setFloatValue("waterPatchSize", m_waterSurface.GetSettings().patchSize);
+	m_pShaderManager->setIntValue("waterTileResolution", m_waterSurface.GetSettings().tileResolution);
+
+	m_pShaderManager->setSampler2DValue("terrainHeights", g_TerrainHeightUnit);
+	m_pShaderManager->setIntValue("terrainGridResolution", m_terrain.GetSettings().gridResolution);
+	m_pShaderManager->setVec2Value("terrainHeightRange", m_terrain.GetHeightRange());
+	m_pShaderManager->setFloatValue("terrainShoreHeight", g_LakeLevel);
+
+	m_pShaderManager->setVec2Value("foliageWindDirection", glm::normalize(m_foliage.GetSettings().windDirection));
+	m_pShaderManager->setFloatValue("foliageWindStrength", m_foliage.GetSettings().windStrength);
+
+	m_pShaderManager->setSampler2DValue("skyViewTable", g_AtmosphereSkyViewUnit);
+	m_pShaderManager->setFloatValue("skyViewHeight", m_atmosphere.GetViewHeight());
+	m_pShaderManager->setFloatValue("skyGroundRadius", m_atmosphere.GetSettings().groundRadius);
+	m_pShaderManager->setFloatValue("skyExposure", m_atmosphere.GetSettings().skyExposure);
+
+	m_pShaderManager->setSampler2DValue("fishingLinePoints", g_FishingLinePointUnit);
+	m_pShaderManager->setFloatValue("fishingLineRadius", m_fishingLines.GetSettings().radius);
+}
+
+/***********************************************************
+ *  AssignObjectLights()
+ *
+ *  This method is used for building the per-object point
+ *  light lists.  The active lights are sorted into a grid by
+ *  their sphere of influence, and each visible object keeps
+ *  only the lights whose sphere touches its bounds, so the
+ *  shader loops over just those lights.
+ ***********************************************************/
+void SceneManager::AssignObjectLights()
+{
+	std::vector<glm::vec3> positions;
+	std::vector<float> ranges;
+	std::vector<int> slots;
+	for (int i = 0; (i < m_pointLights.size()) && (i < TOTAL_POINT_LIGHTS); i++)
+	{
+		if (m_pointLights[i].bActive)
+		{
+			positions.push_back(m_pointLights[i].position);
+			ranges.push_back(ComputeLightRange(m_pointLights[i]));
+			slots.push_back(i);
+		}
+	}
+
+	m_lightGrid.Build(positions, ranges, g_LightGridCellSize);
+
+	for (int i = 0; i < m_visibleObjects.size(); i++)
+	{
+		SCENE_OBJECT& object = m_sceneObjects[m_visibleObjects[i]];
+		object.pointLightCount = m_lightGrid.QueryBounds(
+			object.boundsMin,
+			object.boundsMax,
+			object.pointLightIndices,
+			TOTAL_POINT_LIGHTS);
+
+		// map the grid light indices back to shader slots
+		for (int j = 0; j < object.pointLightCount; j++)
+		{
+			object.pointLightIndices[j] = slots[object.pointLightIndices[j]];
+		}
+	}
+
+	for (int i = 0; (m_bAquarium) && (i < m_fishSchools.size()); i++)
+	{
+		FISH_SCHOOL& school = m_fishSchools[i];
+		school.pointLightCount = m_lightGrid.QueryBounds(
+			school.boundsMin,
+			school.boundsMax,
+			school.pointLightIndices,
+			TOTAL_POINT_LIGHTS);
+		for (int j = 0; j < school.pointLightCount; j++)
+		{
+			school.pointLightIndices[j] = slots[school.pointLightIndices[j]];
+		}
+	}
+
+	if ((m_bLake) && (m_waterSurface.IsReady()))
+	{
+		// the area covered by the rings, up to the highest crest,
+		// is hundreds of cells across, so the light spheres are tested
+		glm::vec2 center = m_waterSurface.GetGridCenter();
+		float extent = m_waterSurface.GetGridExtent();
+		float height = m_waterSurface.GetMaxHeight();
+		m_lakePointLightCount = m_lightGrid.QueryBoundsDirect(
+			glm::vec3(center.x - extent, g_LakeLevel - height, center.y - extent),
+			glm::vec3(center.x + extent, g_LakeLevel + height, center.y + extent),
+			m_lakePointLightIndices,
+			TOTAL_POINT_LIGHTS);
+		for (int j = 0; j < m_lakePointLightCount; j++)
+		{
+			m_lakePointLightIndices[j] = slots[m_lakePointLightIndices[j]];
+		}
+	}
+
+	if ((m_bTerrain) && (m_terrain.IsReady()))
+	{
+		// the selected terrain nodes can span thousands of units,
+		// far more cells than lights, so the light spheres are tested
+		m_terrainPointLightCount = m_lightGrid.QueryBoundsDirect(
+			m_terrain.GetBoundsMin(),
+			m_terrain.GetBoundsMax(),
+			m_terrainPointLightIndices,
+			TOTAL_POINT_LIGHTS);
+		for (int j = 0; j < m_terrainPointLightCount; j++)
+		{
+			m_terrainPointLightIndices[j] = slots[m_terrainPointLightIndices[j]];
+		}
+	}
+
+	if ((m_bFoliage) && (m_bTerrain) && (m_foliage.GetTileCount() > 0))
+	{
+		// the foliage tiles spread over the terrain, so the light
+		// spheres are tested rather than the cells they cover
+		m_foliagePointLightCount = m_lightGrid.QueryBoundsDirect(
+			m_foliage.GetBoundsMin(),
+			m_foliage.GetBoundsMax(),
+			m_foliagePointLightIndices,
+			TOTAL_POINT_LIGHTS);
+		for (int j = 0; j < m_foliagePointLightCount; j++)
+		{
+			m_foliagePointLightIndices[j] = slots[m_foliagePointLightIndices[j]];
+		}
+	}
+
+	if (m_fishingLines.GetLineCount() > 0)
+	{
+		m_fishingLinePointLightCount = m_lightGrid.QueryBounds(
+			m_fishingLines.GetBoundsMin(),
+			m_fishingLines.GetBoundsMax(),
+			m_fishingLinePointLightIndices,
+			TOTAL_POINT_LIGHTS);
+		for (int j = 0; j < m_fishingLinePointLightCount; j++)
+		{
+			m_fishingLinePointLightIndices[j] = slots[m_fishingLinePointLightIndices[j]];
+		}
+	}
+
+	for (int i = 0; (m_bPhysics) && (i < m_thrownBobbers.size()); i++)
+	{
+		SCENE_OBJECT& object = m_thrownBobbers[i].object;
+		object.pointLightCount = m_lightGrid.QueryBounds(
+			object.boundsMin,
+			object.boundsMax,
+			object.pointLightIndices,
+			TOTAL_POINT_LIGHTS);
+		for (int j = 0; j < object.pointLightCount; j++)
+		{
+			object.pointLightIndices[j] = slots[object.pointLightIndices[j]];
+		}
+	}
+}
+
+/***********************************************************
+ *  SelectShadingTiers()
+ *
+ *  This method is used for choosing the shading tier of
+ *  each visible object from its projected size.  Objects
+ *  whose bounding sphere spans only a few dozen pixels are
+ *  lit per vertex, since per-pixel specular is lost on them.
+ ***********************************************************/
+void SceneManager::SelectShadingTiers()
+{
+	GLint viewport[4] = { 0, 0, 0, 0 };
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	float halfViewportHeight = static_cast<float>(viewport[3]) * 0.5f;
+
+	// an orthographic projection has no perspective divide
+	bool bOrthographic = (m_projectionMatrix[3][3] == 1.0f);
+
+	for (int i = 0; i < m_visibleObjects.size(); i++)
+	{
+		SCENE_OBJECT& object = m_sceneObjects[m_visibleObjects[i]];
+
+		glm::vec3 center = (object.boundsMin + object.boundsMax) * 0.5f;
+		float radius = glm::length(object.boundsMax - object.boundsMin) * 0.5f;
+		float projectedRadius = radius * m_projectionMatrix[1][1] * halfViewportHeight;
+
+		if (bOrthographic == false)
+		{
+			float viewDepth = -(m_viewMatrix * glm::vec4(center, 1.0f)).z;
+			if (viewDepth <= radius)
+			{
+				// the camera is at or inside the bounds
+				object.bVertexLighting = false;
+				continue;
+			}
+			projectedRadius /= viewDepth;
+		}
+
+		object.bVertexLighting = ((projectedRadius * 2.0f) < g_VertexLightingMaxPixels);
+	}
+}
+
+/***********************************************************
+ *  UpdateVirtualTextures()
+ *
+ *  This method is used for drawing the visible opaque
+ *  objects into a small feedback target, where each pixel
+ *  names the virtual texture page and mip it would sample.
+ *  The pixels are read back through a pixel buffer and
+ *  parsed a frame later, so the read never stalls on the
+ *  GPU, and the pages found are handed to their textures.
+ ***********************************************************/
+void SceneManager::UpdateVirtualTextures()
+{
+	if (m_virtualTextures.size() == 0)
+	{
+		return;
+	}
+
+	GLint viewport[4] = { 0, 0, 0, 0 };
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	int width = std::max(viewport[2] / g_FeedbackDownscale, 1);
+	int height = std::max(viewport[3] / g_FeedbackDownscale, 1);
+
+	// create or resize the feedback target along with the window
+	if ((width != m_feedbackWidth) || (height != m_feedbackHeight))
+	{
+		if (m_feedbackFramebuffer == 0)
+		{
+			glGenFramebuffers(1, &m_feedbackFramebuffer);
+			glGenRenderbuffers(2, m_feedbackRenderbuffers);
+			glGenBuffers(2, m_feedbackPixelBuffers);
+		}
+
+		glBindRenderbuffer(GL_RENDERBUFFER, m_feedbackRenderbuffers[0]);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+		glBindRenderbuffer(GL_RENDERBUFFER, m_feedbackRenderbuffers[1]);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, m_feedbackFramebuffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_feedbackRenderbuffers[0]);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_feedbackRenderbuffers[1]);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+		for (int i = 0; i < 2; i++)
+		{
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, m_feedbackPixelBuffers[i]);
+			glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(width) * height * 4, NULL, GL_STREAM_READ);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+		m_feedbackWidth = width;
+		m_feedbackHeight = height;
+		// the buffers now hold nothing worth parsing
+		m_feedbackReadbacks = 0;
+	}
+
+	// draw the page requests of the visible opaque objects
+	GLfloat clearColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_feedbackFramebuffer);
+	glViewport(0, 0, width, height);
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	// the derivatives are larger at the lower resolution, so the
+	// mip selection is biased back to what the full frame samples
+	m_pShaderManager->setBoolValue(g_VirtualTextureFeedbackName, true);
+	m_pShaderManager->setFloatValue("virtualTextureLodBias", -std::log2(static_cast<float>(g_FeedbackDownscale)));
+	for (int i = 0; i < m_visibleObjects.size(); i++)
+	{
+		const SCENE_OBJECT& object = m_sceneObjects[m_visibleObjects[i]];
+		if (object.color.a < 1.0f)
+		{
+			continue;
+		}
+
+		m_pShaderManager->setMat4Value(g_ModelName, object.modelMatrix);
+		m_pShaderManager->setBoolValue(g_UseVirtualTextureName, false);
+		if (object.virtualTextureTag.size() > 0)
+		{
+			SetShaderVirtualTexture(object.virtualTextureTag);
+			SetTextureUVScale(object.UVscale.x, object.UVscale.y);
+		}
+		DrawShapeMesh(object.shape);
+	}
+	m_pShaderManager->setBoolValue(g_VirtualTextureFeedbackName, false);
+	m_pShaderManager->setFloatValue("virtualTextureLodBias", 0.0f);
+
+	// start the read back of this frame into one pixel buffer
+	int bufferIndex = m_feedbackReadbacks & 1;
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, m_feedbackPixelBuffers[bufferIndex]);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	m_feedbackReadbacks++;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+	glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+
+	// parse the read back started a frame ago in the other buffer
+	if (m_feedbackReadbacks >= 2)
+	{
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, m_feedbackPixelBuffers[bufferIndex ^ 1]);
+		const uint8_t* pixels = static_cast<const uint8_t*>(
+			glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(width) * height * 4, GL_MAP_READ_BIT));
+		if (NULL != pixels)
+		{
+			for (int i = 0; i < width * height; i++)
+			{
+				const uint8_t* pixel = &pixels[i * 4];
+				int index = pixel[3] - 1;
+				if ((index >= 0) && (index < m_virtualTextures.size()))
+				{
+					m_virtualTextures[index]->RequestPage(pixel[0], pixel[1], pixel[2], m_renderedFrames);
+				}
+			}
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	for (int i = 0; i < m_virtualTextures.size(); i++)
+	{
+		m_virtualTextures[i]->Update(m_renderedFrames);
+	}
+}
+
+/***********************************************************
+ *  SetViewProjection()
+ *
+ *  This method is used for setting the camera view and
+ *  projection of the next rendered frame.
+ ***********************************************************/
+void SceneManager::SetViewProjection(glm::mat4 view, glm::mat4 projection)
+{
+	m_viewMatrix = view;
+	m_projectionMatrix = projection;
+}
+
+/***********************************************************
+ *  SetShadingTierDebug()
+ *
+ *  This method is used for turning the shading tier debug
+ *  view on or off.
+ ***********************************************************/
+void SceneManager::SetShadingTierDebug(bool bEnabled)
+{
+	m_bShadingTierDebug = bEnabled;
+}
+
+/***********************************************************
+ *  UpdateGPUFrameTime()
+ *
+ *  This method is used for collecting the GPU time of the
+ *  scene drawn with the passed in query, which finished a
+ *  frame ago so reading it does not stall, and printing the
+ *  average so both shading paths can be compared.  The
+ *  fragments of the opaque shading pass per pixel of the
+ *  window are printed with it as the overdraw of each path.
+ ***********************************************************/
+void SceneManager::UpdateGPUFrameTime(int queryIndex)
+{
+	GLuint available = 0;
+	glGetQueryObjectuiv(m_gpuTimerQueries[queryIndex], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (available == 0)
+	{
+		return;
+	}
+
+	// a mode change restarts the averages by clearing the frame count
+	if (m_timedFrames == 0)
+	{
+		m_shadedSampleTotal = 0.0;
+	}
+
+	GLuint64 elapsedNanoseconds = 0;
+	glGetQueryObjectui64v(m_gpuTimerQueries[queryIndex], GL_QUERY_RESULT, &elapsedNanoseconds);
+	m_gpuTimeTotal += static_cast<double>(elapsedNanoseconds) / 1000000.0;
+	GLuint64 shadedSamples = 0;
+	glGetQueryObjectui64v(m_shadedSampleQueries[queryIndex], GL_QUERY_RESULT, &shadedSamples);
+	m_shadedSampleTotal += static_cast<double>(shadedSamples);
+	m_timedFrames++;
+
+	if (m_timedFrames >= g_GPUTimeReportFrames)
+	{
+		GLint viewport[4];
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		double pixelCount = std::max(static_cast<double>(viewport[2]) * viewport[3], 1.0);
+		std::cout << "Render: depth pre-pass " << (m_bDepthPrepass ? "on" : "off")
+			<< ", average GPU scene time " << (m_gpuTimeTotal / m_timedFrames) << " ms"
+			<< ", shaded fragments per pixel " << (m_shadedSampleTotal / m_timedFrames / pixelCount) << std::endl;
+		m_timedFrames = 0;
+		m_gpuTimeTotal = 0.0;
+	}
+}
+
+/**************************************************************/
+/*** STUDENTS CAN MODIFY the code in the methods BELOW for  ***/
+/*** preparing and rendering their own 3D replicated scenes.***/
+/*** Please refer to the code in the OpenGL sample project  ***/
+/*** for assistance.                                        ***/
+/**************************************************************/
+
+void SceneManager::LoadSceneTextures()
+{
+	// Load Trout_Texture.jpg into memory for the fish.
+	if (AddAtlasTexture("Textures/Trout_Texture.jpg", "troutTexture"))
+	{
+		std::cout << "Loaded troutTexture (Trout_Texture.jpg) successfully.\n";
+	}
+	else
+	{
+		std::cout << "Failed to load troutTexture (Trout_Texture.jpg)!\n";
+	}
+
+	// Load Rod_Texture.jpg into memory for the fishing rod.
+	if (AddAtlasTexture("Textures/Rod_Texture.jpg", "rodTexture"))
+	{
+		std::cout << "Loaded rodTexture (Rod_Texture.jpg) successfully.\n";
+	}
+	else
+	{
+		std::cout << "Failed to load rodTexture (Rod_Texture.jpg)!\n";
+	}
+	
+	// Load Box_Texture.jpg into memory for the tackle box.
+	if (AddAtlasTexture("Textures/Box_Texture.jpg", "boxTexture"))
+	{
+		std::cout << "Loaded boxTexture (Box_Texture.jpg) successfully.\n";
+	}
+	else
+	{
+		std::cout << "Failed to load boxTexture (Box_Texture.jpg)!\n";
+	}
+	
+	// Load Tail_Texture.jpg into memory for the fish tail.
+	if (AddAtlasTexture("Textures/Tail_Texture.jpg", "tailTexture"))
+	{
+		std::cout << "Loaded tailTexture (Tail_Texture.jpg) successfully.\n";
+	}
+	else
+	{
+		std::cout << "Failed to load tailTexture (Tail_Texture.jpg)!\n";
+	}
+
+	// Load Reel_Texture.jpg into memory for the fishing reel.
+	if (AddAtlasTexture("Textures/Reel_Texture.jpg", "reelTexture"))
+	{
+		std::cout << "Loaded reelTexture (Reel_Texture.jpg) successfully.\n";
+	}
+	else
+	{
+		std::cout << "Failed to load reelTexture (Reel_Texture.jpg)!\n";
+	}
+
+	// Pack the small textures above into one atlas, so they share a
+	// single texture slot and binding.
+	if (CreateAtlasTexture())
+	{
+		std::cout << "Loaded texture atlas successfully.\n";
+	}
+	else
+	{
+		std::cout << "Failed to load texture atlas!\n";
+	}
+
+	BindGLTextures();
+
+	// The table texture is streamed in tiles, so close up it stays
+	// sharp while only a fixed size tile cache is kept in memory.
+	if (CreateVirtualTexture("Textures/Table_Texture.jpg", "tableVirtual"))
+	{
+		std::cout << "Loaded tableVirtual (Table_Texture.jpg) successfully.\n";
+	}
+	else
+	{
+		std::cout << "Failed to load tableVirtual (Table_Texture.jpg)!\n";
+	}
+}
+
+void SceneManager::DefineObjectMaterials() {
+
+	// Wood material for the table.
+	OBJECT_MATERIAL woodMaterial;
+	woodMaterial.diffuseColor = glm::vec3(0.2f, 0.2f, 0.3f);
+	woodMaterial.specularColor = glm::vec3(0.0f, 0.0f, 0.0f);
+	woodMaterial.shininess = 5.0;
+	woodMaterial.tag = "wood";
+	m_objectMaterials.push_back(woodMaterial);
+
+	// Ceramic material for the mug.
+	OBJECT_MATERIAL ceramicMaterial;
+	ceramicMaterial.diffuseColor = glm::vec3(0.4f, 0.4f, 0.4f);
+	ceramicMaterial.specularColor = glm::vec3(0.2f, 0.2f, 0.2f);
+	ceramicMaterial.shininess = 30.0;
+	ceramicMaterial.tag = "mug";
+	m_objectMaterials.push_back(ceramicMaterial);
+
+	// Tackle box material.
+	OBJECT_MATERIAL tackleMaterial;
+	tackleMaterial.diffuseColor = glm::vec3(0.4f, 0.4f, 0.4f);
+	tackleMaterial.specularColor = glm::vec3(0.2f, 0.2f, 0.2f);
+	tackleMaterial.shininess = 15.0f;
+	tackleMaterial.tag = "tackleBox";
+	m_objectMaterials.push_back(tackleMaterial);
+
+	// Fish material.
+	OBJECT_MATERIAL fishMaterial;
+	fishMaterial.diffuseColor = glm::vec3(0.6f, 0.6f, 0.6f);
+	fishMaterial.specularColor = glm::vec3(0.3f, 0.3f, 0.3f);
+	fishMaterial.shininess = 50.0f;
+	fishMaterial.tag = "fish";
+	m_objectMaterials.push_back(fishMaterial);
+
+	// Cork material for fishing rod handle.
+	OBJECT_MATERIAL corkMaterial;
+	corkMaterial.diffuseColor = glm::vec3(0.8f, 0.6f, 0.4f);
+	corkMaterial.specularColor = glm::vec3(0.1f, 0.1f, 0.1f);
+	corkMaterial.shininess = 5.0f;
+	corkMaterial.tag = "cork";
+	m_objectMaterials.push_back(corkMaterial);
+
+	// Procedural wood grain for the table, lit like the wood material.
+	OBJECT_MATERIAL woodGrainMaterial = woodMaterial;
+	woodGrainMaterial.tag = "woodGrain";
+	woodGrainMaterial.proceduralType = PROCEDURAL_WOOD;
+	woodGrainMaterial.proceduralColorA = glm::vec3(0.62f, 0.42f, 0.24f);
+	woodGrainMaterial.proceduralColorB = glm::vec3(0.38f, 0.23f, 0.12f);
+	woodGrainMaterial.proceduralParams = glm::vec4(4.0f, 12.0f, 2.5f, 0.25f);
+	m_objectMaterials.push_back(woodGrainMaterial);
+
+	// Procedural glazed ceramic for the mug.
+	OBJECT_MATERIAL glazedCeramicMaterial = ceramicMaterial;
+	glazedCeramicMaterial.tag = "glazedCeramic";
+	glazedCeramicMaterial.proceduralType = PROCEDURAL_CERAMIC;
+	glazedCeramicMaterial.proceduralColorA = glm::vec3(0.93f, 0.91f, 0.86f);
+	glazedCeramicMaterial.proceduralColorB = glm::vec3(0.78f, 0.76f, 0.70f);
+	glazedCeramicMaterial.proceduralParams = glm::vec4(4.0f, 0.85f, 1.2f, 0.6f);
+	m_objectMaterials.push_back(glazedCeramicMaterial);
+
+	// Procedural cork for the rod handle, baked once since it is small on screen.
+	OBJECT_MATERIAL corkGrainMaterial = corkMaterial;
+	corkGrainMaterial.tag = "corkGrain";
+	corkGrainMaterial.proceduralType = PROCEDURAL_CORK;
+	corkGrainMaterial.proceduralColorA = glm::vec3(0.80f, 0.62f, 0.42f);
+	corkGrainMaterial.proceduralColorB = glm::vec3(0.58f, 0.40f, 0.24f);
+	corkGrainMaterial.proceduralParams = glm::vec4(8.0f, 0.72f, 1.5f, 0.5f);
+	corkGrainMaterial.bakeResolution = 256;
+	m_objectMaterials.push_back(corkGrainMaterial);
+
+	// Glossy water for the lake.
+	OBJECT_MATERIAL waterMaterial;
+	waterMaterial.diffuseColor = glm::vec3(0.3f, 0.45f, 0.5f);
+	waterMaterial.specularColor = glm::vec3(0.9f, 0.9f, 0.9f);
+	waterMaterial.shininess = 96.0f;
+	waterMaterial.tag = "water";
+	m_objectMaterials.push_back(waterMaterial);
+
+	// Clear monofilament for the fishing lines.
+	OBJECT_MATERIAL lineMaterial;
+	lineMaterial.diffuseColor = glm::vec3(0.6f, 0.7f, 0.7f);
+	lineMaterial.specularColor = glm::vec3(0.8f, 0.8f, 0.8f);
+	lineMaterial.shininess = 64.0f;
+	lineMaterial.tag = "line";
+	m_objectMaterials.push_back(lineMaterial);
+
+	// Glossy plastic for the thrown bobbers.
+	OBJECT_MATERIAL bobberMaterial;
+	bobberMaterial.diffuseColor = glm::vec3(0.8f, 0.8f, 0.8f);
+	bobberMaterial.specularColor = glm::vec3(0.6f, 0.6f, 0.6f);
+	bobberMaterial.shininess = 48.0f;
+	bobberMaterial.tag = "bobber";
+	m_objectMaterials.push_back(bobberMaterial);
+
+	// Matte ground for the terrain, colored in the shader.
+	OBJECT_MATERIAL terrainMaterial;
+	terrainMaterial.diffuseColor = glm::vec3(1.0f, 1.0f, 1.0f);
+	terrainMaterial.specularColor = glm::vec3(0.05f, 0.05f, 0.05f);
+	terrainMaterial.shininess = 4.0f;
+	terrainMaterial.tag = "terrain";
+	m_objectMaterials.push_back(terrainMaterial);
+
+	// Soft sheen for the grass and reeds, colored in the shader.
+	OBJECT_MATERIAL foliageMaterial;
+	foliageMaterial.diffuseColor = glm::vec3(1.0f, 1.0f, 1.0f);
+	foliageMaterial.specularColor = glm::vec3(0.15f, 0.15f, 0.15f);
+	foliageMaterial.shininess = 12.0f;
+	foliageMaterial.tag = "foliage";
+	m_objectMaterials.push_back(foliageMaterial);
+}
+
+void SceneManager::SetupSceneLights() {
+
+	// Enable lighting in the shader.
+	m_pShaderManager->setBoolValue(g_UseLightingName, true);
+
+	// Main directional light (coming from above and slightly behind).
+	m_directionalLight.direction = glm::normalize(glm::vec3(0.3f, -1.0f, 0.5f));
+
+	// Ambient low for contrast.
+	m_directionalLight.ambient = glm::vec3(0.15f, 0.15f, 0.15f);
+
+	// Strong main light.
+	m_directionalLight.diffuse = glm::vec3(1.0f, 0.95f, 0.8f);
+	m_directionalLight.specular = glm::vec3(0.8f, 0.8f, 0.8f);
+	m_directionalLight.bActive = true;
+	UploadDirectionalLight();
+
+	// Brighter point light to simulate sunlight.
+	POINT_LIGHT sunLight;
+	sunLight.tag = "sunLight";
+	sunLight.position = glm::vec3(-2.0f, 6.0f, -4.0f);
+
+	// Increased ambient for overall brightness.
+	sunLight.ambient = glm::vec3(0.2f, 0.2f, 0.2f);
+
+	// Stronger diffuse light.
+	sunLight.diffuse = glm::vec3(1.0f, 0.98f, 0.9f);
+
+	// Increased specular for sun-like highlights.
+	sunLight.specular = glm::vec3(0.8f, 0.8f, 0.8f);
+
+	// Adjusted attenuation for stronger reach.
+	sunLight.constant = 1.0f;
+	sunLight.linear = 0.045f;
+	sunLight.quadratic = 0.0075f;
+	sunLight.bActive = true;
+	m_pointLights.push_back(sunLight);
+
+	UploadPointLights();
+}
+
+void SceneManager::DefineSceneObjects() {
+
+	// Table plane.
+	SCENE_OBJECT tableObject;
+	tableObject.tag = "table";
+	tableObject.shape = SHAPE_PLANE;
+	tableObject.scaleXYZ = glm::vec3(25.0f, 1.0f, 15.0f);
+	tableObject.positionXYZ = glm::vec3(0.0f, -0.5f, 0.0f);
+	tableObject.virtualTextureTag = "tableVirtual";
+	tableObject.UVscale = glm::vec2(4.0f, 3.0f);
+	tableObject.materialTag = "wood";
+	tableObject.bOccluder = true;
+	m_sceneObjects.push_back(tableObject);
+
+	// Coffee mug.
+	SCENE_OBJECT mugObject;
+	mugObject.tag = "mug";
+	mugObject.shape = SHAPE_CYLINDER;
+	mugObject.scaleXYZ = glm::vec3(1.2f, 2.0f, 1.2f);
+	mugObject.rotationDegrees = glm::vec3(0.0f, 30.0f, 0.0f);
+	mugObject.positionXYZ = glm::vec3(4.0f, 0.0f, 0.0f);
+	mugObject.materialTag = "glazedCeramic";
+	mugObject.bOccluder = true;
+	m_sceneObjects.push_back(mugObject);
+
+	// Torus for mug handle.
+	SCENE_OBJECT handleObject;
+	handleObject.tag = "mugHandle";
+	handleObject.shape = SHAPE_TORUS;
+	handleObject.scaleXYZ = glm::vec3(0.5f, 0.75f, 0.5f);
+	handleObject.positionXYZ = glm::vec3(5.25f, 1.0f, 0.0f);
+	handleObject.materialTag = "glazedCeramic";
+	m_sceneObjects.push_back(handleObject);
 
 	// Coffee liquid.
-	scaleXYZ = glm::vec3(1.1f, 0.1f, 1.1f);
-	positionXYZ = glm::vec3(4.0f, 1.91f, 0.0f);
-	SetTransformations(scaleXYZ, 0.0f, 30.0f, 0.0f, positionXYZ);
-	SetShaderColor(0.2f, 0.1f, 0.05f, 1.0f);
+	SCENE_OBJECT coffeeObject;
+	coffeeObject.tag = "coffee";
+	coffeeObject.shape = SHAPE_CYLINDER;
+	coffeeObject.scaleXYZ = glm::vec3(1.1f, 0.1f, 1.1f);
+	coffeeObject.rotationDegrees = glm::vec3(0.0f, 30.0f, 0.0f);
+	coffeeObject.positionXYZ = glm::vec3(4.0f, 1.91f, 0.0f);
+	coffeeObject.color = glm::vec4(0.2f, 0.1f, 0.05f, 1.0f);
+	coffeeObject.materialTag = "mug";
+	m_sceneObjects.push_back(coffeeObject);
+
+	// Tackle box.
+	SCENE_OBJECT tackleBoxObject;
+	tackleBoxObject.tag = "tackleBox";
+	tackleBoxObject.shape = SHAPE_BOX;
+	tackleBoxObject.scaleXYZ = glm::vec3(4.0f, 2.0f, 2.5f);
+	tackleBoxObject.rotationDegrees = glm::vec3(0.0f, 15.0f, 0.0f);
+	tackleBoxObject.positionXYZ = glm::vec3(-4.0f, 1.0f, -1.0f);
+	tackleBoxObject.textureTag = "boxTexture";
+	tackleBoxObject.materialTag = "tackleBox";
+	tackleBoxObject.bOccluder = true;
+	m_sceneObjects.push_back(tackleBoxObject);
+
+	// Fishing rod (cork handle).
+	SCENE_OBJECT handleGripObject;
+	handleGripObject.tag = "rodHandle";
+	handleGripObject.shape = SHAPE_CYLINDER;
+	handleGripObject.scaleXYZ = glm::vec3(0.3f, 3.0f, 0.3f);
+	handleGripObject.rotationDegrees = glm::vec3(0.0f, -20.0f, 90.0f);
+	handleGripObject.positionXYZ = glm::vec3(0.0f, 0.15f, 2.0f);
+	handleGripObject.materialTag = "corkGrain";
+	m_sceneObjects.push_back(handleGripObject);
+
+	// Rod shaft (thinner, darker section).
+	SCENE_OBJECT shaftObject;
+	shaftObject.tag = "rodShaft";
+	shaftObject.shape = SHAPE_CYLINDER;
+	shaftObject.scaleXYZ = glm::vec3(0.15f, 14.0f, 0.15f);
+	shaftObject.rotationDegrees = glm::vec3(0.0f, -20.0f, 90.0f);
+	shaftObject.positionXYZ = glm::vec3(1.25f, 0.15f, 2.0f);
+	shaftObject.textureTag = "rodTexture";
+	shaftObject.UVscale = glm::vec2(1.0f, 3.0f);
+	shaftObject.materialTag = "cork";
+	m_sceneObjects.push_back(shaftObject);
+
+	// Fishing reel, reusing the tackle box material.
+	SCENE_OBJECT reelObject;
+	reelObject.tag = "reel";
+	reelObject.shape = SHAPE_CYLINDER;
+	reelObject.scaleXYZ = glm::vec3(0.6f, 0.2f, 0.6f);
+	reelObject.positionXYZ = glm::vec3(0.65f, 0.05f, 2.75f);
+	reelObject.textureTag = "reelTexture";
+	reelObject.materialTag = "tackleBox";
+	m_sceneObjects.push_back(reelObject);
+
+	// Side of fishing reel.
+	SCENE_OBJECT reelSideObject;
+	reelSideObject.tag = "reelSide";
+	reelSideObject.shape = SHAPE_CYLINDER;
+	reelSideObject.scaleXYZ = glm::vec3(0.3f, 0.1f, 0.3f);
+	reelSideObject.positionXYZ = glm::vec3(0.65f, 0.2f, 2.75f);
+	reelSideObject.color = glm::vec4(0.2f, 0.2f, 0.2f, 1.0f);
+	reelSideObject.materialTag = "tackleBox";
+	m_sceneObjects.push_back(reelSideObject);
+
+	// Fish body (elongated sphere).
+	SCENE_OBJECT fishObject;
+	fishObject.tag = "fishBody";
+	fishObject.shape = SHAPE_SPHERE;
+	fishObject.scaleXYZ = glm::vec3(3.0f, 0.8f, 0.4f);
+	fishObject.rotationDegrees = glm::vec3(270.0f, 10.0f, 0.0f);
+	fishObject.positionXYZ = glm::vec3(0.0f, -0.4f, 6.0f);
+	fishObject.textureTag = "troutTexture";
+	fishObject.UVscale = glm::vec2(2.0f, 1.0f);
+	fishObject.materialTag = "fish";
+	m_sceneObjects.push_back(fishObject);
+
+	// Fish eye, positioned relative to the rotated fish body.
+	SCENE_OBJECT eyeObject;
+	eyeObject.tag = "fishEye";
+	eyeObject.shape = SHAPE_SPHERE;
+	eyeObject.scaleXYZ = glm::vec3(0.15f, 0.15f, 0.05f);
+	eyeObject.rotationDegrees = glm::vec3(270.0f, 10.0f, 10.0f);
+	eyeObject.positionXYZ = glm::vec3(-2.3f, -0.2f, 6.1f);
+	eyeObject.color = glm::vec4(0.1f, 0.1f, 0.1f, 1.0f);
+	eyeObject.materialTag = "fish";
+	m_sceneObjects.push_back(eyeObject);
+
+	// Fish tail using box mesh shaped into a thin triangle.
+	SCENE_OBJECT tailObject;
+	tailObject.tag = "fishTail";
+	tailObject.shape = SHAPE_BOX;
+	tailObject.scaleXYZ = glm::vec3(0.8f, 0.1f, 0.8f);
+	tailObject.rotationDegrees = glm::vec3(0.0f, 54.0f, 0.0f);
+	tailObject.positionXYZ = glm::vec3(2.95f, -0.4f, 5.475f);
+	tailObject.textureTag = "tailTexture";
+	tailObject.materialTag = "fish";
+	m_sceneObjects.push_back(tailObject);
+
+	// Fishing rod eyelets along the angled rod, with a dark
+	// metallic color and the tackle box material.
+	float eyeletPositions[] = { 2.5f, 4.5f, 6.5f, 8.5f, 10.5f };
+	for (int i = 0; i < 5; i++) {
+		SCENE_OBJECT eyeletObject;
+		eyeletObject.tag = "eyelet" + std::to_string(i);
+		eyeletObject.shape = SHAPE_TORUS;
+		eyeletObject.scaleXYZ = glm::vec3(0.15f, 0.15f, 0.15f);
+		eyeletObject.rotationDegrees = glm::vec3(0.0f, 90.0f, 0.0f);
+		eyeletObject.positionXYZ = glm::vec3(
+			-15.0f + (eyeletPositions[i] * cos(glm::radians(-20.0f))),
+			0.15f,
+			2.26f + (eyeletPositions[i] * sin(glm::radians(0.0f))));
+		eyeletObject.color = glm::vec4(0.2f, 0.2f, 0.2f, 1.0f);
+		eyeletObject.materialTag = "tackleBox";
+		m_sceneObjects.push_back(eyeletObject);
+	}
+
+	// Steam particles (small spheres with transparency).
+	float steamHeights[] = { 2.2f, 2.5f, 2.8f };
+	float steamOffsets[] = { 0.1f, -0.1f, 0.0f };
+	for (int i = 0; i < 3; i++) {
+		SCENE_OBJECT steamObject;
+		steamObject.tag = "steam" + std::to_string(i);
+		steamObject.shape = SHAPE_SPHERE;
+		steamObject.scaleXYZ = glm::vec3(0.2f, 0.2f, 0.2f);
+		steamObject.positionXYZ = glm::vec3(4.0f + steamOffsets[i], steamHeights[i], 0.0f);
+		steamObject.color = glm::vec4(1.0f, 1.0f, 1.0f, 0.3f);
+		steamObject.materialTag = "tackleBox";
+		m_sceneObjects.push_back(steamObject);
+	}
+}
+
+/***********************************************************
+ *  DefineFishSchools()
+ *
+ *  This method is used for defining the schools of trout
+ *  swimming above the table in the aquarium variant of the
+ *  scene.  The swim cycle is baked into the asset cache the
+ *  first time, and every school shares it.
+ ***********************************************************/
+void SceneManager::DefineFishSchools()
+{
+	ClearFishSchools();
+
+	std::error_code error;
+	std::filesystem::create_directories(g_AssetCacheFolder, error);
+	if ((VertexAnimation::Bake(g_VertexAnimationCacheFile, g_VertexAnimationFrames) == false) ||
+		(m_vertexAnimation.Open(
+			g_VertexAnimationCacheFile,
+			g_VertexAnimationPositionUnit,
+			g_VertexAnimationNormalUnit) == false))
+	{
+		return;
+	}
+
+	AddFishSchool("troutSchoolLeft", glm::vec3(-6.0f, 5.0f, -8.0f), glm::vec3(4.0f, 1.5f, 2.5f), 0.0f, 2500, 1);
+	AddFishSchool("troutSchoolRight", glm::vec3(6.0f, 4.0f, -6.0f), glm::vec3(3.5f, 1.2f, 2.0f), glm::pi<float>(), 2000, 2);
+	AddFishSchool("troutSchoolHigh", glm::vec3(0.0f, 7.5f, -10.0f), glm::vec3(2.5f, 1.0f, 3.0f), glm::half_pi<float>(), 1500, 3);
+
+	m_schoolStartTime = std::chrono::steady_clock::now();
+	m_lastSchoolTime = m_schoolStartTime;
+}
+
+/***********************************************************
+ *  ClearFishSchools()
+ *
+ *  This method is used for freeing the flocking of every
+ *  fish school and forgetting the schools.  Their instance
+ *  buffers belong to the vertex animation.
+ ***********************************************************/
+void SceneManager::ClearFishSchools()
+{
+	for (int i = 0; i < m_fishSchools.size(); i++)
+	{
+		delete m_fishSchools[i].pBoids;
+	}
+	m_fishSchools.clear();
+}
+
+/***********************************************************
+ *  AddFishSchool()
+ *
+ *  This method is used for scattering the fish of a school
+ *  evenly through an ellipsoid, each with its own size,
+ *  heading close to the heading of the school, and start
+ *  and speed through the swim cycle.  The seed keeps the
+ *  school the same from one run to the next.  The fish are
+ *  then released to flock inside a box around the ellipsoid,
+ *  which the lights of the school are assigned from, since
+ *  no fish leaves it.
+ ***********************************************************/
+void SceneManager::AddFishSchool(
+	std::string tag,
+	glm::vec3 center,
+	glm::vec3 radii,
+	float heading,
+	int fishCount,
+	uint32_t seed)
+{
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> scale(0.28f, 0.4f);
+	std::uniform_real_distribution<float> timeOffset(0.0f, m_vertexAnimation.GetDuration());
+	std::uniform_real_distribution<float> speed(0.8f, 1.3f);
+	std::normal_distribution<float> headingJitter(0.0f, 0.15f);
+
+	// every fish stays within this distance of its position
+	glm::vec3 meshExtent = glm::max(glm::abs(m_vertexAnimation.GetBoundsMin()), glm::abs(m_vertexAnimation.GetBoundsMax()));
+	float meshRadius = glm::length(meshExtent);
+
+	FISH_SCHOOL school;
+	school.tag = tag;
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> velocities;
+	float maxScale = 0.0f;
+	while (school.instances.size() < fishCount)
+	{
+		glm::vec3 offset(unit(random), unit(random), unit(random));
+		if (glm::dot(offset, offset) > 1.0f)
+		{
+			continue;
+		}
+
+		VERTEX_ANIMATION_INSTANCE fish;
+		fish.position = center + (offset * radii);
+		fish.heading = heading + headingJitter(random);
+		fish.scale = scale(random);
+		fish.timeOffset = timeOffset(random);
+		fish.speed = speed(random);
+		fish.padding = 0.0f;
+		school.instances.push_back(fish);
+
+		positions.push_back(fish.position);
+		velocities.push_back(glm::vec3(-cosf(fish.heading), 0.0f, sinf(fish.heading)) * g_SchoolCruiseSpeed);
+		maxScale = std::max(maxScale, fish.scale);
+	}
+
+	BOID_SETTINGS settings;
+	settings.boundsMin = center - (radii * g_SchoolBoundsScale);
+	settings.boundsMax = center + (radii * g_SchoolBoundsScale);
+	school.pBoids = new BoidSimulation();
+	school.pBoids->Initialize(positions, velocities, settings);
+	school.boundsMin = settings.boundsMin - glm::vec3(meshRadius * maxScale);
+	school.boundsMax = settings.boundsMax + glm::vec3(meshRadius * maxScale);
+
+	school.school = m_vertexAnimation.CreateSchool(school.instances);
+	m_fishSchools.push_back(school);
+}
+
+/***********************************************************
+ *  AnimateObjectValue()
+ *
+ *  This method is used for playing a looping clip with one
+ *  track on a value of a scene object, the keys giving the
+ *  offset from the value defined for the object, and for
+ *  marking the object for transform updates.  Values of a
+ *  material are passed with an object index of -1.
+ ***********************************************************/
+void SceneManager::AnimateObjectValue(
+	int objectIndex,
+	float* pValue,
+	ANIMATION_INTERPOLATION interpolation,
+	const std::vector<ANIMATION_KEY>& keys,
+	float duration,
+	float startTime)
+{
+	std::vector<ANIMATION_KEY> valueKeys = keys;
+	for (int i = 0; i < valueKeys.size(); i++)
+	{
+		valueKeys[i].value += *pValue;
+	}
+
+	int clip = m_animationSystem.CreateClip(duration, true);
+	m_animationSystem.AddTrack(clip, interpolation, valueKeys);
+	m_animationSystem.Play(clip, std::vector<float*>(1, pValue), 1.0f, startTime);
+
+	if ((objectIndex >= 0) &&
+		(std::find(m_animatedObjects.begin(), m_animatedObjects.end(), objectIndex) == m_animatedObjects.end()))
+	{
+		m_animatedObjects.push_back(objectIndex);
+	}
+}
+
+/***********************************************************
+ *  DefineSceneAnimations()
+ *
+ *  This method is used for defining the motion of the scene
+ *  as keyframe tracks on the transform values of the
+ *  objects and on the material values.  The objects only
+ *  move about the place the visibility sets were built for,
+ *  and objects missing from a restored or switched scene
+ *  are left still.
+ ***********************************************************/
+void SceneManager::DefineSceneAnimations()
+{
+	m_animationSystem.Clear();
+	m_animatedObjects.clear();
+	m_lastAnimationTime = std::chrono::steady_clock::now();
+
+	// reel spinning on its axle
+	const char* reelTags[] = { "reel", "reelSide" };
+	for (int i = 0; i < 2; i++)
+	{
+		int index = FindSceneObject(reelTags[i]);
+		if (index >= 0)
+		{
+			AnimateObjectValue(index, &m_sceneObjects[index].rotationDegrees.y, ANIMATION_LINEAR,
+				{ { 0.0f, 0.0f }, { 2.0f, 360.0f } }, 2.0f, 0.0f);
+		}
+	}
+
+	// rod flexing up and down from the handle, the eyelets
+	// following the shaft at their distance from the handle
+	std::vector<ANIMATION_KEY> flexKeys = { { 0.0f, 0.0f }, { 0.6f, 1.5f }, { 1.2f, 0.0f }, { 1.8f, -1.0f }, { 2.4f, 0.0f } };
+	int shaftIndex = FindSceneObject("rodShaft");
+	if (shaftIndex >= 0)
+	{
+		AnimateObjectValue(shaftIndex, &m_sceneObjects[shaftIndex].rotationDegrees.z, ANIMATION_CUBIC, flexKeys, 2.4f, 0.0f);
+
+		for (int i = 0; i < 5; i++)
+		{
+			int index = FindSceneObject("eyelet" + std::to_string(i));
+			if (index < 0)
+			{
+				continue;
+			}
+			float distance = fabsf(m_sceneObjects[index].positionXYZ.x - m_sceneObjects[shaftIndex].positionXYZ.x);
+			std::vector<ANIMATION_KEY> eyeletKeys = flexKeys;
+			for (int j = 0; j < eyeletKeys.size(); j++)
+			{
+				eyeletKeys[j].value = -distance * sinf(glm::radians(eyeletKeys[j].value));
+			}
+			AnimateObjectValue(index, &m_sceneObjects[index].positionXYZ.y, ANIMATION_CUBIC, eyeletKeys, 2.4f, 0.0f);
+		}
+	}
+
+	// fish flopping on the table, wagging its tail, blinking
+	// and glistening as it lands
+	const char* fishTags[] = { "fishBody", "fishEye", "fishTail" };
+	for (int i = 0; i < 3; i++)
+	{
+		int index = FindSceneObject(fishTags[i]);
+		if (index >= 0)
+		{
+			AnimateObjectValue(index, &m_sceneObjects[index].positionXYZ.y, ANIMATION_CUBIC,
+				{ { 0.0f, 0.0f }, { 0.4f, 0.5f }, { 0.8f, 0.0f }, { 1.6f, 0.0f } }, 1.6f, 0.0f);
+		}
+	}
+	int tailIndex = FindSceneObject("fishTail");
+	if (tailIndex >= 0)
+	{
+		AnimateObjectValue(tailIndex, &m_sceneObjects[tailIndex].rotationDegrees.y, ANIMATION_LINEAR,
+			{ { 0.0f, 0.0f }, { 0.2f, 20.0f }, { 0.4f, -20.0f }, { 0.6f, 20.0f }, { 0.8f, 0.0f }, { 1.6f, 0.0f } }, 1.6f, 0.0f);
+	}
+	int eyeIndex = FindSceneObject("fishEye");
+	if (eyeIndex >= 0)
+	{
+		float closed = 0.02f - m_sceneObjects[eyeIndex].scaleXYZ.y;
+		AnimateObjectValue(eyeIndex, &m_sceneObjects[eyeIndex].scaleXYZ.y, ANIMATION_STEP,
+			{ { 0.0f, 0.0f }, { 1.2f, closed }, { 1.3f, 0.0f } }, 1.6f, 0.0f);
+	}
+	for (int i = 0; i < m_objectMaterials.size(); i++)
+	{
+		if (m_objectMaterials[i].tag.compare("fish") == 0)
+		{
+			float shininess = m_objectMaterials[i].shininess;
+			AnimateObjectValue(-1, &m_objectMaterials[i].shininess, ANIMATION_CUBIC,
+				{ { 0.0f, 0.0f }, { 0.8f, shininess }, { 1.6f, 0.0f } }, 1.6f, 0.0f);
+		}
+	}
+}
+
+/***********************************************************
+ *  UpdateAnimations()
+ *
+ *  This method is used for evaluating the animations at the
+ *  time passed since the last frame and then computing the
+ *  model matrices and bounds of the animated objects, and
+ *  for reporting the average time this takes.
+ ***********************************************************/
+void SceneManager::UpdateAnimations()
+{
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	float deltaSeconds = std::chrono::duration<float>(startTime - m_lastAnimationTime).count();
+	m_lastAnimationTime = startTime;
+	if (m_animationSystem.GetChannelCount() == 0)
+	{
+		return;
+	}
+
+	m_animationSystem.Update(deltaSeconds, m_pJobSystem);
+	m_pJobSystem->ParallelFor(m_animatedObjects.size(), 16, [this](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				UpdateObjectTransform(m_animatedObjects[i]);
+			}
+		});
+
+	m_animationTimeTotal += std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - startTime).count();
+	m_animatedFrames++;
+	if (m_animatedFrames >= g_GPUTimeReportFrames)
+	{
+		std::cout << "Animation: " << m_animationSystem.GetChannelCount() << " channels, average update time "
+			<< (m_animationTimeTotal / m_animatedFrames) << " ms" << std::endl;
+		m_animatedFrames = 0;
+		m_animationTimeTotal = 0.0;
+	}
+}
+
+/***********************************************************
+ *  UpdateFishSchools()
+ *
+ *  This method is used for flocking the fish schools over
+ *  the time passed since the last frame, and for reporting
+ *  the average time this takes.  On the CPU the heading of
+ *  each fish is turned to its velocity and the instances
+ *  are uploaded; the compute shaders write them in place.
+ *  The rate through the swim cycle is left alone, so the
+ *  tails do not jump as the fish speed up and slow down.
+ ***********************************************************/
+void SceneManager::UpdateFishSchools()
+{
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	float deltaSeconds = std::chrono::duration<float>(startTime - m_lastSchoolTime).count();
+	m_lastSchoolTime = startTime;
+	if ((m_bAquarium == false) || (m_fishSchools.size() == 0))
+	{
+		return;
+	}
+
+	int agentCount = 0;
+	for (int i = 0; i < m_fishSchools.size(); i++)
+	{
+		FISH_SCHOOL& school = m_fishSchools[i];
+		BoidSimulation* pBoids = school.pBoids;
+		agentCount += pBoids->GetAgentCount();
+
+		if ((m_bBoidCompute) && (pBoids->IsComputeEnabled() == false))
+		{
+			pBoids->EnableCompute(m_boidComputeProgram, m_vertexAnimation.GetInstanceBuffer(school.school));
+		}
+		else if ((m_bBoidCompute == false) && (pBoids->IsComputeEnabled()))
+		{
+			pBoids->DisableCompute();
+		}
+
+		pBoids->Update(deltaSeconds, m_pJobSystem);
+		if (pBoids->IsComputeEnabled())
+		{
+			continue;
+		}
+
+		m_pJobSystem->ParallelFor(school.instances.size(), 1024, [&school, pBoids](size_t begin, size_t end)
+			{
+				for (size_t j = begin; j < end; j++)
+				{
+					glm::vec3 velocity = pBoids->GetVelocity(static_cast<int>(j));
+					school.instances[j].position = pBoids->GetPosition(static_cast<int>(j));
+					school.instances[j].heading = atan2f(velocity.z, -velocity.x);
+				}
+			});
+		m_vertexAnimation.UpdateSchool(school.school, school.instances);
+	}
+
+	m_flockTimeTotal += std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - startTime).count();
+	m_flockedFrames++;
+	if (m_flockedFrames >= g_GPUTimeReportFrames)
+	{
+		std::cout << "Boids: " << agentCount << " agents " << (m_bBoidCompute ? "in compute shaders" : "on the CPU")
+			<< ", average update time " << (m_flockTimeTotal / m_flockedFrames) << " ms" << std::endl;
+		m_flockedFrames = 0;
+		m_flockTimeTotal = 0.0;
+	}
+}
+
+/***********************************************************
+ *  DefineLake()
+ *
+ *  This method is used for defining the waves of the lake
+ *  around the table, from a light breeze over a patch of
+ *  water that repeats every 32 meters.  The first surface
+ *  is simulated up front, so the lake never shows flat.
+ ***********************************************************/
+void SceneManager::DefineLake()
+{
+	WATER_SETTINGS settings;
+	settings.resolution = 128;
+	settings.patchSize = 32.0f;
+	settings.windDirection = glm::vec2(1.0f, 0.4f);
+	settings.windSpeed = 6.0f;
+	settings.choppiness = 1.2f;
+	settings.tileResolution = 32;
+	settings.tileSize = 4.0f;
+	settings.levelCount = 5;
+
+	if ((m_waterSurface.Initialize(settings) == false) ||
+		(m_waterSurface.CreateResources(g_WaterDisplacementUnit, g_WaterNormalUnit) == false))
+	{
+		return;
+	}
+
+	m_lakeStartTime = std::chrono::steady_clock::now();
+	m_waterSurface.Simulate(0.0f, m_pJobSystem);
+	m_waterSurface.Upload();
+}
+
+/***********************************************************
+ *  UpdateLake()
+ *
+ *  This method is used for simulating the waves of the lake
+ *  at the current time on the workers and uploading them,
+ *  and for reporting the average time this takes.
+ ***********************************************************/
+void SceneManager::UpdateLake()
+{
+	if ((m_bLake == false) || (m_waterSurface.IsReady() == false))
+	{
+		return;
+	}
+
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	m_waterSurface.Simulate(std::chrono::duration<float>(startTime - m_lakeStartTime).count(), m_pJobSystem);
+	m_waterSurface.Upload();
+
+	m_lakeTimeTotal += std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - startTime).count();
+	m_simulatedLakeFrames++;
+	if (m_simulatedLakeFrames >= g_GPUTimeReportFrames)
+	{
+		int resolution = m_waterSurface.GetSettings().resolution;
+		std::cout << "Lake: " << resolution << "x" << resolution << " waves, average update time "
+			<< (m_lakeTimeTotal / m_simulatedLakeFrames) << " ms" << std::endl;
+		m_simulatedLakeFrames = 0;
+		m_lakeTimeTotal = 0.0;
+	}
+}
+
+/***********************************************************
+ *  DefineTerrain()
+ *
+ *  This method is used for defining the terrain around the
+ *  lake, four kilometers across, with the basin of the lake
+ *  under the table rising to a low shore and into hills.
+ *  The heightmap is cooked into the asset cache the first
+ *  time, and only the tile of the root node is loaded up
+ *  front; the others stream in as the camera nears them.
+ ***********************************************************/
+void SceneManager::DefineTerrain()
+{
+	TERRAIN_SETTINGS settings;
+	settings.basinDepth = g_LakeLevel - 7.0f;
+	settings.shoreHeight = g_LakeLevel + 1.5f;
+
+	// the foliage reads the tiles of the terrain, so let it go first
+	m_foliage.Release();
+
+	std::error_code error;
+	std::filesystem::create_directories(g_AssetCacheFolder, error);
+	if (HeightfieldTerrain::Cook(g_TerrainCacheFile, settings, m_pJobSystem))
+	{
+		m_terrain.Open(g_TerrainCacheFile, settings, g_TerrainHeightUnit, m_pJobSystem);
+	}
+}
+
+/***********************************************************
+ *  UpdateTerrain()
+ *
+ *  This method is used for choosing the terrain nodes for
+ *  the current camera, uploading the tiles the workers have
+ *  loaded and queueing the missing ones, and for reporting
+ *  the average time this takes.  The report also covers
+ *  how long coarse nodes stood in for children still
+ *  loading, and how many of the prefetched tiles were
+ *  drawn before being evicted.
+ ***********************************************************/
+void SceneManager::UpdateTerrain()
+{
+	if ((m_bTerrain == false) || (m_terrain.IsReady() == false))
+	{
+		return;
+	}
+
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	float deltaSeconds = std::chrono::duration<float>(startTime - m_lastTerrainUpdateTime).count();
+	m_lastTerrainUpdateTime = startTime;
+
+	PredictTerrainViews(deltaSeconds);
+	m_terrain.Update(m_cameraPosition, m_projectionMatrix * m_viewMatrix);
+
+	m_terrainTimeTotal += std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - startTime).count();
+	m_terrainSeconds += deltaSeconds;
+	if (m_terrain.GetPlaceholderCount() > 0)
+	{
+		m_placeholderSeconds += deltaSeconds;
+	}
+	int usedCount = 0;
+	int wastedCount = 0;
+	m_terrain.TakePrefetchCounts(usedCount, wastedCount);
+	m_prefetchUsedTotal += usedCount;
+	m_prefetchWastedTotal += wastedCount;
+
+	m_updatedTerrainFrames++;
+	if (m_updatedTerrainFrames >= g_GPUTimeReportFrames)
+	{
+		std::cout << "Terrain: " << m_terrain.GetDrawnCount() << " nodes drawn, "
+			<< m_terrain.GetCulledCount() << " culled, " << m_terrain.GetResidentCount()
+			<< " tiles resident, average update time "
+			<< (m_terrainTimeTotal / m_updatedTerrainFrames) << " ms" << std::endl;
+
+		int prefetchedCount = m_prefetchUsedTotal + m_prefetchWastedTotal;
+		std::cout << "Prefetch " << (m_bPrefetch ? "on" : "off") << ": "
+			<< ((prefetchedCount > 0) ? (100 * m_prefetchUsedTotal) / prefetchedCount : 0)
+			<< "% of " << prefetchedCount << " prefetched tiles drawn, placeholders shown "
+			<< (m_placeholderSeconds * 1000.0) << " ms of " << m_terrainSeconds << " s" << std::endl;
+
+		m_updatedTerrainFrames = 0;
+		m_terrainTimeTotal = 0.0;
+		m_terrainSeconds = 0.0;
+		m_placeholderSeconds = 0.0;
+		m_prefetchUsedTotal = 0;
+		m_prefetchWastedTotal = 0;
+	}
+}
+
+/***********************************************************
+ *  PredictTerrainViews()
+ *
+ *  This method is used for adding the camera of this frame
+ *  to the predictor and, with the prefetch on, passing the
+ *  views it is predicted to reach over the next fraction of
+ *  a second to the terrain, soonest first.  The prediction
+ *  follows the motion the camera actually made, so a
+ *  faster movement speed reaches further ahead by itself.
+ ***********************************************************/
+void SceneManager::PredictTerrainViews(float deltaSeconds)
+{
+	// the camera looks down the negative z axis of the view
+	glm::vec3 front = -glm::vec3(m_viewMatrix[0][2], m_viewMatrix[1][2], m_viewMatrix[2][2]);
+	m_cameraPredictor.AddSample(m_cameraPosition, front, deltaSeconds);
+
+	std::vector<TERRAIN_PREDICTED_VIEW> views;
+	if ((m_bPrefetch) && (m_cameraPredictor.IsReady()))
+	{
+		const CAMERA_PREDICTION_SETTINGS& settings = m_cameraPredictor.GetSettings();
+		for (int i = 0; i < settings.viewCount; i++)
+		{
+			glm::vec3 position;
+			glm::vec3 predictedFront;
+			m_cameraPredictor.Predict(settings.horizonSeconds * (i + 1) / settings.viewCount, position, predictedFront);
+
+			TERRAIN_PREDICTED_VIEW view;
+			view.cameraPosition = position;
+			view.viewProjection = m_projectionMatrix *
+				glm::lookAt(position, position + predictedFront, glm::vec3(0.0f, 1.0f, 0.0f));
+			views.push_back(view);
+		}
+	}
+	m_terrain.SetPredictedViews(views);
+}
+
+/***********************************************************
+ *  DefineFoliage()
+ *
+ *  This method is used for defining the grass and reeds on
+ *  the finest tiles of the terrain, reeds along the lake
+ *  level and grass on the flat ground above it, reaching
+ *  128 meters from the camera.  Nothing is defined until
+ *  the compute program was loaded.
+ ***********************************************************/
+void SceneManager::DefineFoliage()
+{
+	if ((m_foliageComputeProgram == 0) || (m_terrain.IsReady() == false))
+	{
+		return;
+	}
+
+	FOLIAGE_SETTINGS settings;
+	settings.waterLevel = g_LakeLevel;
+	settings.windDirection = glm::vec2(1.0f, 0.4f);
+	settings.windStrength = 0.3f;
+
+	m_foliageStartTime = std::chrono::steady_clock::now();
+	m_foliage.Initialize(settings, &m_terrain, m_foliageComputeProgram, m_pJobSystem);
+}
+
+/***********************************************************
+ *  UpdateFoliage()
+ *
+ *  This method is used for scattering the foliage of the
+ *  tiles that came into range and culling every clump for
+ *  the current camera on the GPU, and for reporting the
+ *  average time this takes on the CPU along with the clumps
+ *  drawn at each level of detail.
+ ***********************************************************/
+void SceneManager::UpdateFoliage()
+{
+	if ((m_bFoliage == false) || (m_bTerrain == false) || (m_foliage.IsReady() == false))
+	{
+		return;
+	}
+
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	m_foliage.Update(m_cameraPosition, m_projectionMatrix * m_viewMatrix);
+
+	m_foliageTimeTotal += std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - startTime).count();
+	m_updatedFoliageFrames++;
+	if (m_updatedFoliageFrames >= g_GPUTimeReportFrames)
+	{
+		int detailedCount = 0;
+		int simpleCount = 0;
+		m_foliage.ReadDrawnCounts(detailedCount, simpleCount);
+		std::cout << "Foliage: " << m_foliage.GetTileCount() << " tiles in range, "
+			<< m_foliage.GetScatteredTileCount() << " scattered so far, "
+			<< detailedCount << " detailed and " << simpleCount << " simple clumps drawn, average update time "
+			<< (m_foliageTimeTotal / m_updatedFoliageFrames) << " ms" << std::endl;
+		m_updatedFoliageFrames = 0;
+		m_foliageTimeTotal = 0.0;
+	}
+}
+
+/***********************************************************
+ *  DefineSky()
+ *
+ *  This method is used for defining the sky over the lake,
+ *  an earth-like atmosphere seen from 200 meters up.  The
+ *  transmittance and multiple scattering tables are kept
+ *  in the asset cache after the first time, and the sky
+ *  view is filled for the defined sun right away.  Nothing
+ *  is defined until the compute program was loaded.
+ ***********************************************************/
+void SceneManager::DefineSky()
+{
+	if (m_atmosphereComputeProgram == 0)
+	{
+		return;
+	}
+
+	ATMOSPHERE_SETTINGS settings;
+	settings.viewerAltitude = 0.2f;
+	settings.skyExposure = 10.0f;
+
+	std::error_code error;
+	std::filesystem::create_directories(g_AssetCacheFolder, error);
+	if (m_atmosphere.Initialize(
+		settings,
+		m_atmosphereComputeProgram,
+		g_AtmosphereCacheFile,
+		g_AtmosphereTransmittanceUnit,
+		g_AtmosphereMultiScatteringUnit,
+		g_AtmosphereSkyViewUnit))
+	{
+		m_atmosphere.UpdateSkyView(-m_directionalLight.direction);
+		if (NULL != m_pShaderManager)
+		{
+			UploadSceneUniforms();
+		}
+	}
+}
+
+/***********************************************************
+ *  UpdateSky()
+ *
+ *  This method is used for filling the sky-view table again
+ *  when the directional light has turned, passing the new
+ *  sun and sky colors to the shader, and for reporting the
+ *  number of fills and the average time they take.
+ ***********************************************************/
+void SceneManager::UpdateSky()
+{
+	if ((m_bSky == false) || (m_atmosphere.IsReady() == false))
+	{
+		return;
+	}
+
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	if (m_atmosphere.UpdateSkyView(-m_directionalLight.direction))
+	{
+		m_skyViewUpdates++;
+		UploadDirectionalLight();
+	}
+
+	m_skyTimeTotal += std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - startTime).count();
+	m_updatedSkyFrames++;
+	if (m_updatedSkyFrames >= g_GPUTimeReportFrames)
+	{
+		std::cout << "Sky: " << m_skyViewUpdates << " sky-view updates, average update time "
+			<< (m_skyTimeTotal / m_updatedSkyFrames) << " ms" << std::endl;
+		m_updatedSkyFrames = 0;
+		m_skyViewUpdates = 0;
+		m_skyTimeTotal = 0.0;
+	}
+}
+
+/***********************************************************
+ *  DefineReflections()
+ *
+ *  This method is used for defining which surfaces of the
+ *  scene reflect the screen.  The water, the fishing line
+ *  and the bobbers are smooth enough, the wood, the terrain
+ *  and the foliage are not.  Nothing is defined until the
+ *  compute program was loaded.
+ ***********************************************************/
+void SceneManager::DefineReflections()
+{
+	if (m_reflectionComputeProgram == 0)
+	{
+		return;
+	}
+
+	REFLECTION_SETTINGS settings;
+	settings.maxRoughness = 0.35f;
+	settings.facingReflectance = 0.2f;
+	settings.maxDistance = 60.0f;
+	settings.thickness = 0.3f;
+	settings.maxIterations = 64;
+	settings.linearSteps = 256;
+	settings.historyWeight = 0.9f;
+
+	m_reflections.Initialize(settings, m_reflectionComputeProgram, g_ReflectionFirstUnit);
+}
+
+/***********************************************************
+ *  UpdateReflections()
+ *
+ *  This method is used for reporting the trace in use, the
+ *  size it runs at and the average GPU time of the passes.
+ ***********************************************************/
+void SceneManager::UpdateReflections()
+{
+	double passTime = 0.0;
+	if ((m_bReflections == false) || (m_reflections.ReadPassTime(passTime) == false))
+	{
+		return;
+	}
+
+	m_reflectionTimeTotal += passTime;
+	m_reflectionFrames++;
+	if (m_reflectionFrames >= g_GPUTimeReportFrames)
+	{
+		std::cout << "Reflections: " << (m_bLinearMarch ? "linear march" : "hi-z trace") << " at "
+			<< m_reflections.GetTraceWidth() << "x" << m_reflections.GetTraceHeight() << ", average GPU time "
+			<< (m_reflectionTimeTotal / m_reflectionFrames) << " ms" << std::endl;
+		m_reflectionFrames = 0;
+		m_reflectionTimeTotal = 0.0;
+	}
+}
+
+/***********************************************************
+ *  DefineFishingLines()
+ *
+ *  This method is used for defining the line running from
+ *  the reel through the eyelets of the rod, with its end
+ *  hanging from the tip onto the table, and, when it is
+ *  enabled, the tackle shop display of spools of line hung
+ *  from rows of pegs behind the table.  Every line rests on
+ *  the table top.
+ ***********************************************************/
+void SceneManager::DefineFishingLines()
+{
+	FISHING_LINE_SETTINGS settings;
+	settings.drag = 0.8f;
+	settings.iterations = 12;
+	settings.radius = 0.01f;
+	settings.friction = 0.3f;
+	int tableIndex = FindSceneObject("table");
+	if (tableIndex >= 0)
+	{
+		const SCENE_OBJECT& table = m_sceneObjects[tableIndex];
+		settings.groundHeight = table.boundsMax.y;
+		settings.groundMin = glm::vec2(table.boundsMin.x, table.boundsMin.z);
+		settings.groundMax = glm::vec2(table.boundsMax.x, table.boundsMax.z);
+	}
+	m_fishingLines.Initialize(settings);
+
+	// the eyelets are numbered from the tip, so the line runs
+	// from the reel through them in reverse
+	m_rodLineAnchors.clear();
+	m_rodLine = -1;
+	int reelIndex = FindSceneObject("reel");
+	if (reelIndex >= 0)
+	{
+		m_rodLineAnchors.push_back(reelIndex);
+	}
+	for (int i = 4; i >= 0; i--)
+	{
+		int index = FindSceneObject("eyelet" + std::to_string(i));
+		if (index >= 0)
+		{
+			m_rodLineAnchors.push_back(index);
+		}
+	}
+	if (m_rodLineAnchors.size() >= 2)
+	{
+		std::vector<glm::vec3> anchors;
+		for (int i = 0; i < m_rodLineAnchors.size(); i++)
+		{
+			anchors.push_back(m_sceneObjects[m_rodLineAnchors[i]].positionXYZ);
+		}
+		m_rodLine = m_fishingLines.AddLine(anchors, 0.1f, 0.02f, 2.0f);
+	}
+
+	if (m_bTackleDisplay)
+	{
+		// the spools hang in loops of different sag, their loose ends
+		// long enough for the lower rows to pile up on the table
+		for (int row = 0; row < g_TackleDisplayRows; row++)
+		{
+			for (int column = 0; column < g_TackleDisplayColumns; column++)
+			{
+				glm::vec3 peg = glm::vec3(-12.0f + (column * 0.75f), 1.0f + (row * 0.4f), -12.0f);
+				std::vector<glm::vec3> anchors = { peg, peg + glm::vec3(0.5f, 0.0f, 0.0f) };
+				float slack = 0.1f + (0.05f * ((row + column) % 5));
+				m_fishingLines.AddLine(anchors, 0.05f, slack, 1.5f + (0.25f * (column % 4)));
+			}
+		}
+	}
+
+	m_lastFishingLineTime = std::chrono::steady_clock::now();
+	if (m_fishingLines.CreateResources(g_FishingLinePointUnit))
+	{
+		m_fishingLines.Upload();
+	}
+}
+
+/***********************************************************
+ *  UpdateFishingLines()
+ *
+ *  This method is used for moving the anchors of the rod
+ *  line to the eyelets as the rod flexes, simulating every
+ *  fishing line on the workers and streaming the points to
+ *  the GPU, and for reporting the average time this takes.
+ ***********************************************************/
+void SceneManager::UpdateFishingLines()
+{
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	float deltaSeconds = std::chrono::duration<float>(startTime - m_lastFishingLineTime).count();
+	m_lastFishingLineTime = startTime;
+	if ((m_fishingLines.IsReady() == false) || (m_fishingLines.GetLineCount() == 0))
+	{
+		return;
+	}
+
+	for (int i = 0; (m_rodLine >= 0) && (i < m_rodLineAnchors.size()); i++)
+	{
+		m_fishingLines.SetAnchor(m_rodLine, i, m_sceneObjects[m_rodLineAnchors[i]].positionXYZ);
+	}
+	m_fishingLines.Update(deltaSeconds, m_pJobSystem);
+	m_fishingLines.Upload();
+
+	m_lineTimeTotal += std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - startTime).count();
+	m_simulatedLineFrames++;
+	if (m_simulatedLineFrames >= g_GPUTimeReportFrames)
+	{
+		std::cout << "Fishing lines: " << m_fishingLines.GetLineCount() << " lines, "
+			<< m_fishingLines.GetSegmentCount() << " segments, average update time "
+			<< (m_lineTimeTotal / m_simulatedLineFrames) << " ms" << std::endl;
+		m_simulatedLineFrames = 0;
+		m_lineTimeTotal = 0.0;
+	}
+}
+
+/***********************************************************
+ *  DefineRigidBodies()
+ *
+ *  This method is used for defining the rigid bodies of the
+ *  tabletop props, resting on the table top.  The mug
+ *  carries its handle and the coffee along with it.  Any
+ *  thrown bobbers are taken away.
+ ***********************************************************/
+void SceneManager::DefineRigidBodies()
+{
+	RIGID_BODY_SETTINGS settings;
+	int tableIndex = FindSceneObject("table");
+	if (tableIndex >= 0)
+	{
+		const SCENE_OBJECT& table = m_sceneObjects[tableIndex];
+		settings.groundHeight = table.boundsMax.y;
+		settings.groundMin = glm::vec2(table.boundsMin.x, table.boundsMin.z);
+		settings.groundMax = glm::vec2(table.boundsMax.x, table.boundsMax.z);
+	}
+	m_rigidBodies.Initialize(settings);
+	m_physicsProps.clear();
+	m_thrownBobbers.clear();
+	m_nextBobber = 0;
+	m_bobberShape = m_rigidBodies.AddSphere(g_BobberRadius);
+
+	AddPhysicsProp({ "mug", "mugHandle", "coffee" }, 0.4f);
+	AddPhysicsProp({ "tackleBox" }, 2.0f);
+
+	m_lastPhysicsTime = std::chrono::steady_clock::now();
+}
+
+/***********************************************************
+ *  AddPhysicsProp()
+ *
+ *  This method is used for adding a rigid body that fills
+ *  the shape of the first of the tagged scene objects.  The
+ *  scale is taken out of the model matrix into the size of
+ *  the body, and every tagged object keeps where it sits
+ *  relative to the body.  Planes and tori have no body.
+ ***********************************************************/
+void SceneManager::AddPhysicsProp(const std::vector<std::string>& tags, float mass)
+{
+	int index = (tags.size() > 0) ? FindSceneObject(tags[0]) : -1;
+	if (index < 0)
+	{
+		return;
+	}
+
+	const SCENE_OBJECT& object = m_sceneObjects[index];
+	glm::vec3 size = glm::vec3(
+		glm::length(glm::vec3(object.modelMatrix[0])),
+		glm::length(glm::vec3(object.modelMatrix[1])),
+		glm::length(glm::vec3(object.modelMatrix[2])));
+	int shape = -1;
+	glm::vec3 center = glm::vec3(0.0f);
+	switch (object.shape)
+	{
+	case SHAPE_BOX:
+		shape = m_rigidBodies.AddBox(size * 0.5f);
+		break;
+	case SHAPE_SPHERE:
+		shape = m_rigidBodies.AddSphere(std::max(size.x, std::max(size.y, size.z)));
+		break;
+	case SHAPE_CYLINDER:
+		// the cylinder mesh stands on its base
+		shape = m_rigidBodies.AddCylinder(std::max(size.x, size.z), size.y * 0.5f);
+		center = glm::vec3(0.0f, 0.5f, 0.0f);
+		break;
+	default:
+		break;
+	}
+	if (shape < 0)
+	{
+		return;
+	}
+
+	glm::mat3 orientation = glm::mat3(
+		glm::vec3(object.modelMatrix[0]) / size.x,
+		glm::vec3(object.modelMatrix[1]) / size.y,
+		glm::vec3(object.modelMatrix[2]) / size.z);
+	glm::vec3 position = glm::vec3(object.modelMatrix * glm::vec4(center, 1.0f));
+	int body = m_rigidBodies.AddBody(shape, position, orientation, mass);
+	if (body < 0)
+	{
+		return;
+	}
+
+	glm::mat4 toBody = glm::inverse(m_rigidBodies.GetTransform(body));
+	for (int i = 0; i < tags.size(); i++)
+	{
+		PHYSICS_PROP prop;
+		prop.body = body;
+		prop.object = FindSceneObject(tags[i]);
+		if (prop.object >= 0)
+		{
+			prop.localMatrix = toBody * m_sceneObjects[prop.object].modelMatrix;
+			m_physicsProps.push_back(prop);
+		}
+	}
+}
+
+/***********************************************************
+ *  UpdateRigidBodies()
+ *
+ *  This method is used for simulating the rigid bodies on
+ *  the workers and moving the props and bobbers they carry,
+ *  and for reporting the average time this takes.
+ ***********************************************************/
+void SceneManager::UpdateRigidBodies()
+{
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	float deltaSeconds = std::chrono::duration<float>(startTime - m_lastPhysicsTime).count();
+	m_lastPhysicsTime = startTime;
+	if ((m_bPhysics == false) || (m_rigidBodies.GetBodyCount() == 0))
+	{
+		return;
+	}
+
+	m_rigidBodies.Update(deltaSeconds, m_pJobSystem);
+	for (int i = 0; i < m_physicsProps.size(); i++)
+	{
+		const PHYSICS_PROP& prop = m_physicsProps[i];
+		SCENE_OBJECT& object = m_sceneObjects[prop.object];
+		object.modelMatrix = m_rigidBodies.GetTransform(prop.body) * prop.localMatrix;
+		UpdateObjectBounds(object);
+	}
+	for (int i = 0; i < m_thrownBobbers.size(); i++)
+	{
+		THROWN_BOBBER& bobber = m_thrownBobbers[i];
+		bobber.object.modelMatrix = m_rigidBodies.GetTransform(bobber.body) * glm::scale(glm::vec3(g_BobberRadius));
+		UpdateObjectBounds(bobber.object);
+	}
+
+	m_physicsTimeTotal += std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - startTime).count();
+	m_simulatedPhysicsFrames++;
+	if (m_simulatedPhysicsFrames >= g_GPUTimeReportFrames)
+	{
+		std::cout << "Rigid bodies: " << m_rigidBodies.GetBodyCount() << " bodies, "
+			<< m_rigidBodies.GetAwakeCount() << " awake, " << m_rigidBodies.GetContactCount()
+			<< " contacts, average update time " << (m_physicsTimeTotal / m_simulatedPhysicsFrames)
+			<< " ms" << std::endl;
+		m_simulatedPhysicsFrames = 0;
+		m_physicsTimeTotal = 0.0;
+	}
+}
+
+/***********************************************************
+ *  ThrowBobber()
+ *
+ *  This method is used for throwing a bobber from just in
+ *  front of the camera along its view.  Once all of them
+ *  are thrown, the oldest is picked up and thrown again.
+ ***********************************************************/
+void SceneManager::ThrowBobber()
+{
+	if (m_bPhysics == false)
+	{
+		return;
+	}
+
+	// the camera looks down the negative z axis of its view
+	glm::vec3 forward = -glm::normalize(glm::vec3(glm::inverse(m_viewMatrix)[2]));
+	glm::vec3 position = m_cameraPosition + (forward * (2.0f * g_BobberRadius));
+
+	int bobberIndex = m_nextBobber % g_MaxThrownBobbers;
+	m_nextBobber++;
+	if (bobberIndex >= m_thrownBobbers.size())
+	{
+		THROWN_BOBBER bobber;
+		bobber.body = m_rigidBodies.AddBody(m_bobberShape, position, glm::mat3(1.0f), g_BobberMass, 0.5f, 0.5f);
+		if (bobber.body < 0)
+		{
+			return;
+		}
+		bobber.object.tag = "bobber" + std::to_string(bobberIndex);
+		bobber.object.shape = SHAPE_SPHERE;
+		bobber.object.color = ((bobberIndex % 2) == 0) ?
+			glm::vec4(0.9f, 0.15f, 0.1f, 1.0f) : glm::vec4(0.95f, 0.95f, 0.9f, 1.0f);
+		bobber.object.materialTag = "bobber";
+		m_thrownBobbers.push_back(bobber);
+	}
+	THROWN_BOBBER& bobber = m_thrownBobbers[bobberIndex];
+	m_rigidBodies.PlaceBody(bobber.body, position, glm::mat3(1.0f));
+	m_rigidBodies.SetVelocity(bobber.body, forward * g_BobberSpeed, glm::vec3(0.0f));
+	bobber.object.modelMatrix = m_rigidBodies.GetTransform(bobber.body) * glm::scale(glm::vec3(g_BobberRadius));
+	UpdateObjectBounds(bobber.object);
+}
+
+/***********************************************************
+ *  PrepareScene()
+ *
+ *  This method is used for preparing the 3D scene by loading
+ *  the shapes, textures in memory to support the 3D scene 
+ *  rendering
+ ***********************************************************/
+void SceneManager::PrepareScene()
+{
+	// Load the textures for the 3d scene.
+	LoadSceneTextures();
+
+	DefineObjectMaterials();
+	BakeProceduralMaterials();
+
+	SetupSceneLights();
+
+	// only one instance of a particular mesh needs to be
+	// loaded in memory no matter how many times it is drawn
+	// in the rendered 3D scene
+
+	m_basicMeshes->LoadPlaneMesh();
+	m_basicMeshes->LoadCylinderMesh();
+	m_basicMeshes->LoadTorusMesh();
+	m_basicMeshes->LoadBoxMesh();
+	m_basicMeshes->LoadSphereMesh();
+
+	// the objects are static, so their transforms and the
+	// visible set of every view cell are computed up front,
+	// after the scene settings file has overridden any values;
+	// the animated objects only move about their defined place
+	DefineSceneObjects();
+	ApplySceneSettings(false);
+	UpdateObjectTransforms();
+	BuildVisibilitySets(m_sceneObjects, m_visibilitySets, g_VisibilityCacheFile);
+	DefineSceneAnimations();
+	DefineFishSchools();
+	DefineLake();
+	DefineTerrain();
+	DefineFoliage();
+	DefineFishingLines();
+	DefineRigidBodies();
+
+	glGenQueries(2, m_gpuTimerQueries);
+	glGenQueries(2, m_shadedSampleQueries);
+
+	UploadSceneUniforms();
+}
+
+
+/***********************************************************
+ *  RenderScene()
+ *
+ *  This method is used for rendering the 3D scene by 
+ *  transforming and drawing the basic 3D shapes
+ ***********************************************************/
+void SceneManager::RenderScene()
+{
+	// the query issued two frames ago has finished by now
+	int queryIndex = m_renderedFrames & 1;
+	if (m_renderedFrames >= 2)
+	{
+		UpdateGPUFrameTime(queryIndex);
+	}
+	glBeginQuery(GL_TIME_ELAPSED, m_gpuTimerQueries[queryIndex]);
+	m_renderedFrames++;
+
+	// the view cell containing the camera selects the objects
+	// that can possibly be seen before any other culling
+	const uint32_t* visibleBits = m_visibilitySets.FindCellVisibility(m_cameraPosition);
+
+	m_visibleObjects.clear();
+	for (int i = 0; i < m_sceneObjects.size(); i++)
+	{
+		if ((NULL != visibleBits) && (PotentiallyVisibleSet::IsObjectVisible(visibleBits, i) == false))
+		{
+			continue;
+		}
+		m_visibleObjects.push_back(i);
+	}
+
+	UpdateVirtualTextures();
+	AssignObjectLights();
+	SelectShadingTiers();
+	m_pShaderManager->setBoolValue(g_ShadingTierDebugName, m_bShadingTierDebug);
+
+	// with reflections the scene is drawn into their framebuffer,
+	// which keeps the surface of every pixel next to its color
+	bool bReflections = false;
+	if (m_bReflections)
+	{
+		GLint viewport[4];
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		bReflections = m_reflections.Begin(viewport[2], viewport[3]);
+	}
+
+	if (m_bDepthPrepass)
+	{
+		// lay down the depth of the opaque objects with color writes off
+		// and the lighting skipped, so the shading pass below runs the
+		// Phong light functions only for the surface that is finally seen
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		m_pShaderManager->setBoolValue(g_DepthOnlyName, true);
+		m_pShaderManager->setBoolValue(g_VertexLightingName, false);
+		for (int i = 0; i < m_visibleObjects.size(); i++)
+		{
+			const SCENE_OBJECT& object = m_sceneObjects[m_visibleObjects[i]];
+			if (object.color.a >= 1.0f)
+			{
+				m_pShaderManager->setMat4Value(g_ModelName, object.modelMatrix);
+				DrawShapeMesh(object.shape);
+			}
+		}
+		DrawFishSchools(true);
+		DrawLake(true);
+		DrawTerrain(true);
+		DrawFoliage(true);
+		DrawFishingLines(true);
+		DrawThrownBobbers(true);
+		m_pShaderManager->setBoolValue(g_DepthOnlyName, false);
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+		// shade the opaque objects where their depth survived
+		glDepthFunc(GL_LEQUAL);
+		glDepthMask(GL_FALSE);
+		glBeginQuery(GL_SAMPLES_PASSED, m_shadedSampleQueries[queryIndex]);
+		for (int i = 0; i < m_visibleObjects.size(); i++)
+		{
+			const SCENE_OBJECT& object = m_sceneObjects[m_visibleObjects[i]];
+			if (object.color.a >= 1.0f)
+			{
+				DrawSceneObject(object);
+			}
+		}
+		DrawFishSchools(false);
+		DrawLake(false);
+		DrawTerrain(false);
+		DrawFoliage(false);
+		DrawFishingLines(false);
+		DrawThrownBobbers(false);
+		DrawSky();
+		glEndQuery(GL_SAMPLES_PASSED);
+		glDepthMask(GL_TRUE);
+		glDepthFunc(GL_LESS);
+
+		// reflect the opaque scene before the transparent objects
+		// are blended over it
+		if (bReflections)
+		{
+			ResolveReflections();
+		}
+
+		// blend the transparent objects over the shaded result
+		for (int i = 0; i < m_visibleObjects.size(); i++)
+		{
+			const SCENE_OBJECT& object = m_sceneObjects[m_visibleObjects[i]];
+			if (object.color.a < 1.0f)
+			{
+				DrawSceneObject(object);
+			}
+		}
+	}
+	else
+	{
+		// without the depth of the scene the sky goes first and is
+		// drawn over by the opaque objects
+		glBeginQuery(GL_SAMPLES_PASSED, m_shadedSampleQueries[queryIndex]);
+		DrawSky();
+		for (int i = 0; i < m_visibleObjects.size(); i++)
+		{
+			const SCENE_OBJECT& object = m_sceneObjects[m_visibleObjects[i]];
+			if (object.color.a >= 1.0f)
+			{
+				DrawSceneObject(object);
+			}
+		}
+		DrawFishSchools(false);
+		DrawLake(false);
+		DrawTerrain(false);
+		DrawFoliage(false);
+		DrawFishingLines(false);
+		DrawThrownBobbers(false);
+		glEndQuery(GL_SAMPLES_PASSED);
+		if (bReflections)
+		{
+			ResolveReflections();
+		}
+
+		// the transparent objects go last, so everything behind
+		// them is already there to blend over
+		for (int i = 0; i < m_visibleObjects.size(); i++)
+		{
+			const SCENE_OBJECT& object = m_sceneObjects[m_visibleObjects[i]];
+			if (object.color.a < 1.0f)
+			{
+				DrawSceneObject(object);
+			}
+		}
+	}
+
+	if (bReflections)
+	{
+		m_reflections.End();
+	}
+
+	glEndQuery(GL_TIME_ELAPSED);
+}
+
+/***********************************************************
+ *  EnableHotReload()
+ *
+ *  This method is used for watching the shader files, the
+ *  image files of the loaded textures and the scene settings
+ *  file, so that edits show up while the scene is running.
+ ***********************************************************/
+void SceneManager::EnableHotReload(const char* vertexShaderFile, const char* fragmentShaderFile)
+{
+	m_vertexShaderFile = vertexShaderFile;
+	m_fragmentShaderFile = fragmentShaderFile;
+
+	if (NULL == m_pFileWatcher)
+	{
+		m_pFileWatcher = new FileWatcher();
+	}
+	m_pFileWatcher->Watch(m_vertexShaderFile);
+	m_pFileWatcher->Watch(m_fragmentShaderFile);
+	m_pFileWatcher->Watch(g_SceneSettingsFile);
+	for (int i = 0; i < m_textureSources.size(); i++)
+	{
+		m_pFileWatcher->Watch(m_textureSources[i].filename);
+	}
+}
+
+/***********************************************************
+ *  UpdateHotReload()
+ *
+ *  This method is used for reloading the files edited since
+ *  the last frame, before the frame is drawn.  Only what a
+ *  file feeds is rebuilt, and both shader stages are
+ *  compiled together once however many of them changed.
+ ***********************************************************/
+void SceneManager::UpdateHotReload()
+{
+	if (NULL == m_pFileWatcher)
+	{
+		return;
+	}
+
+	std::vector<FileWatcher::FILE_CHANGE> changes;
+	m_pFileWatcher->CollectChanges(changes);
+
+	bool bShadersChanged = false;
+	std::filesystem::file_time_type shaderWriteTime;
+	for (int i = 0; i < changes.size(); i++)
+	{
+		const FileWatcher::FILE_CHANGE& change = changes[i];
+		if ((change.path == m_vertexShaderFile) || (change.path == m_fragmentShaderFile))
+		{
+			if ((bShadersChanged == false) || (change.writeTime > shaderWriteTime))
+			{
+				shaderWriteTime = change.writeTime;
+			}
+			bShadersChanged = true;
+			continue;
+		}
+
+		std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+		bool bReloaded = false;
+		if (change.path == g_SceneSettingsFile)
+		{
+			bReloaded = (ApplySceneSettings(true) >= 0);
+		}
+		else
+		{
+			bReloaded = ReloadTexture(change.path);
+		}
+
+		if (bReloaded)
+		{
+			ReportReload(change.path, startTime, change.writeTime);
+		}
+	}
+
+	if (bShadersChanged)
+	{
+		std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+		if (ReloadShaders())
+		{
+			ReportReload(m_fragmentShaderFile, startTime, shaderWriteTime);
+		}
+	}
+}
+
+/***********************************************************
+ *  ReloadShaders()
+ *
+ *  This method is used for loading the edited shader files.
+ *  They are compiled and linked into a throwaway program
+ *  first, and on any error the running program is kept, so
+ *  a typo in a shader never takes down the scene.
+ ***********************************************************/
+bool SceneManager::ReloadShaders()
+{
+	if (ValidateShaderProgram(m_vertexShaderFile, m_fragmentShaderFile) == false)
+	{
+		std::cout << "Keeping the running shaders until the errors are fixed" << std::endl;
+		return(false);
+	}
+
+	GLint oldProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &oldProgram);
+
+	m_pShaderManager->LoadShaders(m_vertexShaderFile.c_str(), m_fragmentShaderFile.c_str());
+	m_pShaderManager->use();
+
+	GLint newProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &newProgram);
+	if ((oldProgram != 0) && (oldProgram != newProgram))
+	{
+		glDeleteProgram(oldProgram);
+	}
+
+	// the new program starts with every uniform at its default
+	UploadSceneUniforms();
+	return(true);
+}
+
+/***********************************************************
+ *  ReloadTexture()
+ *
+ *  This method is used for loading an edited image file
+ *  again into the textures made from it.  A plain texture
+ *  is overwritten in place while its size stays the same,
+ *  an atlas image only has its block of the atlas replaced,
+ *  and a virtual texture is cooked again and reopened.
+ ***********************************************************/
+bool SceneManager::ReloadTexture(const std::string& filename)
+{
+	bool bReloaded = false;
+	for (int i = 0; i < m_textureSources.size(); i++)
+	{
+		const TEXTURE_SOURCE& source = m_textureSources[i];
+		if (source.filename != filename)
+		{
+			continue;
+		}
+
+		// the hash decides which textures preloaded scenes share
+		std::vector<uint8_t> bytes;
+		ReadFileContents(filename, bytes, m_textureSources[i].contentHash);
+
+		if (source.type == TEXTURE_SOURCE_VIRTUAL)
+		{
+			int index = FindVirtualTexture(source.tag);
+			if (index >= 0)
+			{
+				// waits for the tile loads still reading the cache file
+				delete m_virtualTextures[index];
+				m_virtualTextures.erase(m_virtualTextures.begin() + index);
+			}
+			bReloaded |= CreateVirtualTexture(source.filename.c_str(), source.tag);
+			continue;
+		}
+
+		// atlas images are decoded to RGBA8 whatever their channels
+		int width = 0;
+		int height = 0;
+		int colorChannels = 0;
+		int requiredChannels = (source.type == TEXTURE_SOURCE_ATLAS) ? 4 : 0;
+		stbi_set_flip_vertically_on_load(true);
+		unsigned char* image = stbi_load_from_memory(bytes.data(), static_cast<int>(bytes.size()), &width, &height, &colorChannels, requiredChannels);
+		if (!image)
+		{
+			// the editor may still be writing, the next save is caught again
+			std::cout << "Could not load image:" << filename << std::endl;
+			continue;
+		}
+		if (requiredChannels != 0)
+		{
+			colorChannels = requiredChannels;
+		}
+
+		std::vector<TEXTURE_LEVEL> levels;
+		if (source.type == TEXTURE_SOURCE_ATLAS)
+		{
+			std::vector<uint8_t> block;
+			int blockX = 0;
+			int blockY = 0;
+			int blockWidth = 0;
+			int blockHeight = 0;
+			int slot = FindTextureSlot(g_AtlasTextureTag);
+			if ((slot >= 0) &&
+				(PrepareTextureLevels(image, width, height, colorChannels, 0, levels, m_pJobSystem) == true) &&
+				(m_textureAtlas.BuildImageBlock(
+					source.tag,
+					width,
+					height,
+					reinterpret_cast<const uint8_t*>(levels[0].texels.data()),
+					block,
+					blockX,
+					blockY,
+					blockWidth,
+					blockHeight) == true))
+			{
+				// blocks are aligned to the gutter, so each level of the
+				// block lands on whole texels of the same atlas level
+				PrepareTextureLevels(block.data(), blockWidth, blockHeight, 4, m_textureAtlas.GetMaxMipLevel(), levels, m_pJobSystem);
+				glActiveTexture(GL_TEXTURE0 + slot);
+				glBindTexture(GL_TEXTURE_2D, m_textureIDs[slot].ID);
+				UpdateTextureLevels(levels, blockX, blockY);
+				bReloaded = true;
+			}
+			else
+			{
+				std::cout << "Atlas image changed size, restart to pack it again:" << filename << std::endl;
+			}
+		}
+		else
+		{
+			int slot = FindTextureSlot(source.tag);
+			if ((slot >= 0) && (PrepareTextureLevels(image, width, height, colorChannels, -1, levels, m_pJobSystem) == true))
+			{
+				glActiveTexture(GL_TEXTURE0 + slot);
+				glBindTexture(GL_TEXTURE_2D, m_textureIDs[slot].ID);
+
+				GLint textureWidth = 0;
+				GLint textureHeight = 0;
+				glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &textureWidth);
+				glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &textureHeight);
+				if ((textureWidth == width) && (textureHeight == height))
+				{
+					UpdateTextureLevels(levels, 0, 0);
+				}
+				else
+				{
+					// the storage cannot be resized, so replace the texture
+					GLuint textureID = 0;
+					glGenTextures(1, &textureID);
+					glBindTexture(GL_TEXTURE_2D, textureID);
+					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+					UploadTextureLevels(levels);
+
+					glDeleteTextures(1, &m_textureIDs[slot].ID);
+					m_textureIDs[slot].ID = textureID;
+				}
+				bReloaded = true;
+			}
+		}
+		stbi_image_free(image);
+	}
+
+	return(bReloaded);
+}
+
+/***********************************************************
+ *  ApplySceneSettings()
+ *
+ *  This method is used for applying the scene settings file
+ *  over the values defined in code.  Only lines whose values
+ *  differ from what was applied before are written, and the
+ *  values of removed lines go back to their code defaults.
+ *  Returns the number of values changed, or -1 when the
+ *  file cannot be read.
+ ***********************************************************/
+int SceneManager::ApplySceneSettings(bool bLiveEdit)
+{
+	std::vector<SCENE_SETTING> settings;
+	if (ReadSceneSettings(g_SceneSettingsFile, settings) == false)
+	{
+		return(-1);
+	}
+
+	// a later line for the same value wins over an earlier one
+	std::map<std::string, SCENE_SETTING> fileSettings;
+	for (int i = 0; i < settings.size(); i++)
+	{
+		fileSettings[settings[i].GetKey()] = settings[i];
+	}
+
+	int changes = 0;
+	int changeFlags = 0;
+
+	// put back the defaults of the lines that were removed
+	for (auto it = m_appliedSettings.begin(); it != m_appliedSettings.end(); ++it)
+	{
+		auto defaults = m_settingDefaults.find(it->first);
+		if ((fileSettings.find(it->first) != fileSettings.end()) || (defaults == m_settingDefaults.end()))
+		{
+			continue;
+		}
+
+		int valueCount = 0;
+		int flags = 0;
+		int itemIndex = 0;
+		float* values = FindSceneSetting(it->second, valueCount, flags, itemIndex);
+		if (NULL != values)
+		{
+			std::copy(defaults->second.begin(), defaults->second.end(), values);
+			changeFlags |= flags;
+			changes++;
+		}
+	}
+
+	std::map<std::string, SCENE_SETTING> appliedSettings;
+	for (auto it = fileSettings.begin(); it != fileSettings.end(); ++it)
+	{
+		const SCENE_SETTING& setting = it->second;
+		auto applied = m_appliedSettings.find(it->first);
+		if ((applied != m_appliedSettings.end()) && (applied->second.values == setting.values))
+		{
+			appliedSettings[it->first] = setting;
+			continue;
+		}
+
+		int valueCount = 0;
+		int flags = 0;
+		int itemIndex = 0;
+		float* values = FindSceneSetting(setting, valueCount, flags, itemIndex);
+		if (NULL == values)
+		{
+			std::cout << g_SceneSettingsFile << "(" << setting.line << "): unknown setting:" << it->first << std::endl;
+			continue;
+		}
+		if (setting.values.size() != valueCount)
+		{
+			std::cout << g_SceneSettingsFile << "(" << setting.line << "): expected "
+				<< valueCount << " values for:" << it->first << std::endl;
+			continue;
+		}
+
+		if (m_settingDefaults.find(it->first) == m_settingDefaults.end())
+		{
+			m_settingDefaults[it->first].assign(values, values + valueCount);
+		}
+		std::copy(setting.values.begin(), setting.values.end(), values);
+		appliedSettings[it->first] = setting;
+		changeFlags |= flags;
+		changes++;
+	}
+	m_appliedSettings.swap(appliedSettings);
+
+	// materials, colors and UV scales are read again as each object
+	// is drawn, so only the transforms and lights need refreshing
+	if (changeFlags & SETTING_CHANGES_TRANSFORMS)
+	{
+		UpdateObjectTransforms();
+		if (bLiveEdit)
+		{
+			DisableVisibilitySets();
+		}
+	}
+	if (changeFlags & SETTING_CHANGES_LIGHTS)
+	{
+		UploadDirectionalLight();
+		UploadPointLights();
+	}
+
+	return(changes);
+}
+
+/***********************************************************
+ *  FindSceneSetting()
+ *
+ *  This method is used for finding the scene values that a
+ *  setting line overrides, along with how many values they
+ *  hold, what has to be recomputed once they change, and
+ *  the index of the light, material or object holding them,
+ *  which is -1 for the directional light.  Returns NULL for
+ *  an unknown kind, tag or property.
+ ***********************************************************/
+float* SceneManager::FindSceneSetting(const SCENE_SETTING& setting, int& valueCount, int& changeFlags, int& itemIndex)
+{
+	// the values each kind of scene item exposes to the file
+	struct SETTING_VALUE
+	{
+		const char* property;
+		float* values;
+		int count;
+		int changeFlags;
+	};
+	std::vector<SETTING_VALUE> candidates;
+	itemIndex = -1;
+
+	if (setting.kind == "light")
+	{
+		if (setting.tag == "directional")
+		{
+			candidates = {
+				{ "direction", &m_directionalLight.direction[0], 3, SETTING_CHANGES_LIGHTS },
+				{ "ambient", &m_directionalLight.ambient[0], 3, SETTING_CHANGES_LIGHTS },
+				{ "diffuse", &m_directionalLight.diffuse[0], 3, SETTING_CHANGES_LIGHTS },
+				{ "specular", &m_directionalLight.specular[0], 3, SETTING_CHANGES_LIGHTS } };
+		}
+		for (int i = 0; i < m_pointLights.size(); i++)
+		{
+			POINT_LIGHT& light = m_pointLights[i];
+			if (light.tag == setting.tag)
+			{
+				itemIndex = i;
+				candidates = {
+					{ "position", &light.position[0], 3, SETTING_CHANGES_LIGHTS },
+					{ "ambient", &light.ambient[0], 3, SETTING_CHANGES_LIGHTS },
+					{ "diffuse", &light.diffuse[0], 3, SETTING_CHANGES_LIGHTS },
+					{ "specular", &light.specular[0], 3, SETTING_CHANGES_LIGHTS },
+					{ "constant", &light.constant, 1, SETTING_CHANGES_LIGHTS },
+					{ "linear", &light.linear, 1, SETTING_CHANGES_LIGHTS },
+					{ "quadratic", &light.quadratic, 1, SETTING_CHANGES_LIGHTS } };
+				break;
+			}
+		}
+	}
+	else if (setting.kind == "material")
+	{
+		for (int i = 0; i < m_objectMaterials.size(); i++)
+		{
+			OBJECT_MATERIAL& material = m_objectMaterials[i];
+			if (material.tag == setting.tag)
+			{
+				itemIndex = i;
+				candidates = {
+					{ "diffuse", &material.diffuseColor[0], 3, 0 },
+					{ "specular", &material.specularColor[0], 3, 0 },
+					{ "shininess", &material.shininess, 1, 0 } };
+				break;
+			}
+		}
+	}
+	else if (setting.kind == "object")
+	{
+		for (int i = 0; i < m_sceneObjects.size(); i++)
+		{
+			SCENE_OBJECT& object = m_sceneObjects[i];
+			if (object.tag == setting.tag)
+			{
+				itemIndex = i;
+				candidates = {
+					{ "position", &object.positionXYZ[0], 3, SETTING_CHANGES_TRANSFORMS },
+					{ "scale", &object.scaleXYZ[0], 3, SETTING_CHANGES_TRANSFORMS },
+					{ "rotation", &object.rotationDegrees[0], 3, SETTING_CHANGES_TRANSFORMS },
+					{ "color", &object.color[0], 4, 0 },
+					{ "uvScale", &object.UVscale[0], 2, 0 } };
+				break;
+			}
+		}
+	}
+
+	for (int i = 0; i < candidates.size(); i++)
+	{
+		if (setting.property == candidates[i].property)
+		{
+			valueCount = candidates[i].count;
+			changeFlags = candidates[i].changeFlags;
+			return(candidates[i].values);
+		}
+	}
+
+	valueCount = 0;
+	changeFlags = 0;
+	return(NULL);
+}
+
+/***********************************************************
+ *  DisableVisibilitySets()
+ *
+ *  This method is used for dropping the baked visibility
+ *  sets once objects were moved while running.  The sets no
+ *  longer match the scene and baking them again takes too
+ *  long to do between frames, so every object counts as
+ *  visible until the next start bakes the new layout.
+ ***********************************************************/
+void SceneManager::DisableVisibilitySets()
+{
+	if (m_visibilitySets.IsBaked())
+	{
+		m_visibilitySets.Clear();
+		std::cout << "Scene objects moved, view cell culling is off until the next start" << std::endl;
+	}
+}
+
+/***********************************************************
+ *  EnableLiveEditing()
+ *
+ *  This method is used for starting the edit server, so
+ *  that external tools can change the running scene.
+ ***********************************************************/
+void SceneManager::EnableLiveEditing()
+{
+	if (NULL != m_pEditServer)
+	{
+		return;
+	}
+
+	std::error_code error;
+	std::filesystem::create_directories(g_AssetCacheFolder, error);
+
+	m_pEditServer = new EditServer();
+	if (m_pEditServer->Start(g_SceneEditSocketFile) == false)
+	{
+		delete m_pEditServer;
+		m_pEditServer = NULL;
+	}
+}
+
+/***********************************************************
+ *  EnableBackgroundUploads()
+ *
+ *  This method is used for starting the upload thread, so
+ *  the textures of preloaded scenes are created and filled
+ *  off the GL thread.  Without a shared context they keep
+ *  being uploaded a part every frame.
+ ***********************************************************/
+void SceneManager::EnableBackgroundUploads(GLFWwindow* pWindow)
+{
+	if (NULL != m_pUploads)
+	{
+		return;
+	}
+
+	m_pUploads = new UploadThread(m_pTasks);
+	if (m_pUploads->Start(pWindow) == false)
+	{
+		delete m_pUploads;
+		m_pUploads = NULL;
+	}
+}
+
+/***********************************************************
+ *  UpdateLiveEdits()
+ *
+ *  This method is used for applying the edits received
+ *  since the last frame.  Only the last edit of each value
+ *  is applied, and only the edited objects have their
+ *  transforms recomputed and only the edited lights are set
+ *  into their shader slots, so a tool streaming thousands
+ *  of edits costs the frame no more than the values that
+ *  actually changed.  Edits that are rejected are counted
+ *  and reported in one line for the whole batch.
+ ***********************************************************/
+void SceneManager::UpdateLiveEdits()
+{
+	if (NULL == m_pEditServer)
+	{
+		return;
+	}
+
+	std::vector<SCENE_SETTING> edits;
+	int rejectedCount = m_pEditServer->CollectEdits(edits);
+	int receivedCount = rejectedCount + static_cast<int>(edits.size());
+	if (receivedCount == 0)
+	{
+		return;
+	}
+	std::string firstIgnoredKey;
+
+	// keep the last edit of every value, in the order received
+	std::map<std::string, int> lastEdits;
+	for (int i = 0; i < edits.size(); i++)
+	{
+		lastEdits[edits[i].GetKey()] = i;
+	}
+
+	std::vector<bool> movedObjects(m_sceneObjects.size(), false);
+	std::vector<bool> editedLights(m_pointLights.size(), false);
+	bool bObjectsMoved = false;
+	bool bDirectionalLightEdited = false;
+	for (int i = 0; i < edits.size(); i++)
+	{
+		const SCENE_SETTING& edit = edits[i];
+		if (lastEdits[edit.GetKey()] != i)
+		{
+			continue;
+		}
+
+		int valueCount = 0;
+		int changeFlags = 0;
+		int itemIndex = 0;
+		float* values = FindSceneSetting(edit, valueCount, changeFlags, itemIndex);
+		if ((NULL == values) || (edit.values.size() != valueCount))
+		{
+			if (firstIgnoredKey.empty())
+			{
+				firstIgnoredKey = edit.GetKey();
+			}
+			rejectedCount++;
+			continue;
+		}
+		std::copy(edit.values.begin(), edit.values.end(), values);
+
+		if (changeFlags & SETTING_CHANGES_TRANSFORMS)
+		{
+			movedObjects[itemIndex] = true;
+			bObjectsMoved = true;
+		}
+		if (changeFlags & SETTING_CHANGES_LIGHTS)
+		{
+			if (itemIndex < 0)
+			{
+				bDirectionalLightEdited = true;
+			}
+			else
+			{
+				editedLights[itemIndex] = true;
+			}
+		}
+	}
+
+	for (int i = 0; i < movedObjects.size(); i++)
+	{
+		if (movedObjects[i])
+		{
+			UpdateObjectTransform(i);
+		}
+	}
+	if (bObjectsMoved)
+	{
+		DisableVisibilitySets();
+	}
+
+	if (bDirectionalLightEdited)
+	{
+		UploadDirectionalLight();
+	}
+	for (int i = 0; i < editedLights.size(); i++)
+	{
+		if (editedLights[i])
+		{
+			UploadPointLight(i);
+		}
+	}
+
+	if (rejectedCount > 0)
+	{
+		std::cout << "Ignored " << rejectedCount << " of " << receivedCount << " scene edits";
+		if (firstIgnoredKey.empty() == false)
+		{
+			std::cout << ", the first not found:" << firstIgnoredKey;
+		}
+		std::cout << std::endl;
+	}
+}
+
+/***********************************************************
+ *  SaveSnapshot()
+ *
+ *  This method is used for saving the running scene state -
+ *  objects, materials, lights, the camera and the image
+ *  files of the textures - into the snapshot image.  Only
+ *  copying the values into plain records happens here; the
+ *  image is laid out and written on a worker thread.
+ ***********************************************************/
+void SceneManager::SaveSnapshot(const SNAPSHOT_CAMERA& camera)
+{
+	SceneSnapshot snapshot;
+
+	for (int i = 0; i < m_sceneObjects.size(); i++)
+	{
+		const SCENE_OBJECT& object = m_sceneObjects[i];
+		SNAPSHOT_OBJECT record;
+		record.tag = snapshot.AddString(object.tag);
+		record.textureTag = snapshot.AddString(object.textureTag);
+		record.virtualTextureTag = snapshot.AddString(object.virtualTextureTag);
+		record.materialTag = snapshot.AddString(object.materialTag);
+		record.shape = object.shape;
+		record.bOccluder = object.bOccluder;
+		record.scaleXYZ = object.scaleXYZ;
+		record.rotationDegrees = object.rotationDegrees;
+		record.positionXYZ = object.positionXYZ;
+		record.color = object.color;
+		record.UVscale = object.UVscale;
+		record.modelMatrix = object.modelMatrix;
+		record.boundsMin = object.boundsMin;
+		record.boundsMax = object.boundsMax;
+		snapshot.AddObject(record);
+	}
+
+	for (int i = 0; i < m_objectMaterials.size(); i++)
+	{
+		const OBJECT_MATERIAL& material = m_objectMaterials[i];
+		SNAPSHOT_MATERIAL record;
+		record.tag = snapshot.AddString(material.tag);
+		record.diffuseColor = material.diffuseColor;
+		record.specularColor = material.specularColor;
+		record.shininess = material.shininess;
+		record.proceduralType = material.proceduralType;
+		record.proceduralColorA = material.proceduralColorA;
+		record.proceduralColorB = material.proceduralColorB;
+		record.proceduralParams = material.proceduralParams;
+		record.bakeResolution = material.bakeResolution;
+		snapshot.AddMaterial(record);
+	}
+
+	for (int i = 0; i < m_pointLights.size(); i++)
+	{
+		const POINT_LIGHT& light = m_pointLights[i];
+		SNAPSHOT_POINT_LIGHT record;
+		record.tag = snapshot.AddString(light.tag);
+		record.position = light.position;
+		record.ambient = light.ambient;
+		record.diffuse = light.diffuse;
+		record.specular = light.specular;
+		record.constant = light.constant;
+		record.linear = light.linear;
+		record.quadratic = light.quadratic;
+		record.bActive = light.bActive;
+		snapshot.AddPointLight(record);
+	}
+
+	for (int i = 0; i < m_textureSources.size(); i++)
+	{
+		SNAPSHOT_TEXTURE record;
+		record.filename = snapshot.AddString(m_textureSources[i].filename);
+		record.tag = snapshot.AddString(m_textureSources[i].tag);
+		record.type = m_textureSources[i].type;
+		snapshot.AddTexture(record);
+	}
+
+	SNAPSHOT_DIRECTIONAL_LIGHT directionalLight;
+	directionalLight.direction = m_directionalLight.direction;
+	directionalLight.ambient = m_directionalLight.ambient;
+	directionalLight.diffuse = m_directionalLight.diffuse;
+	directionalLight.specular = m_directionalLight.specular;
+	directionalLight.bActive = m_directionalLight.bActive;
+	snapshot.SetDirectionalLight(directionalLight);
+	snapshot.SetCamera(camera);
+
+	std::error_code error;
+	std::filesystem::create_directories(g_AssetCacheFolder, error);
+	snapshot.WriteAsync(g_SceneSnapshotFile, m_pJobSystem);
+}
+
+/***********************************************************
+ *  ReadSnapshotScene()
+ *
+ *  This method is used for copying the records of a mapped
+ *  snapshot image into scene objects, materials, lights and
+ *  texture sources, the objects across the workers.  The
+ *  offsets were checked when the image was opened, and the
+ *  shapes, procedural types, bake resolutions and texture
+ *  types are checked here first, so a damaged image copies
+ *  nothing and returns false.
+ ***********************************************************/
+bool SceneManager::ReadSnapshotScene(
+	const SceneSnapshot& snapshot,
+	std::vector<SCENE_OBJECT>& objects,
+	std::vector<OBJECT_MATERIAL>& materials,
+	std::vector<POINT_LIGHT>& pointLights,
+	DIRECTIONAL_LIGHT& directionalLight,
+	std::vector<TEXTURE_SOURCE>& textureSources)
+{
+	for (int i = 0; i < snapshot.GetMaterialCount(); i++)
+	{
+		const SNAPSHOT_MATERIAL& record = snapshot.GetMaterial(i);
+		if ((record.proceduralType < PROCEDURAL_NONE) || (record.proceduralType > PROCEDURAL_CERAMIC) ||
+			(record.bakeResolution < 0) || (record.bakeResolution > g_MaxBakeResolution))
+		{
+			std::cout << "Snapshot material " << i << " is out of range" << std::endl;
+			return(false);
+		}
+	}
+	for (int i = 0; i < snapshot.GetObjectCount(); i++)
+	{
+		const SNAPSHOT_OBJECT& record = snapshot.GetSceneObject(i);
+		if ((record.shape < SHAPE_PLANE) || (record.shape > SHAPE_SPHERE))
+		{
+			std::cout << "Snapshot object " << i << " is out of range" << std::endl;
+			return(false);
+		}
+	}
+	for (int i = 0; i < snapshot.GetTextureCount(); i++)
+	{
+		const SNAPSHOT_TEXTURE& record = snapshot.GetTexture(i);
+		if ((record.type < TEXTURE_SOURCE_IMAGE) || (record.type > TEXTURE_SOURCE_VIRTUAL))
+		{
+			std::cout << "Snapshot texture " << i << " is out of range" << std::endl;
+			return(false);
+		}
+	}
+
+	materials.resize(snapshot.GetMaterialCount());
+	for (int i = 0; i < snapshot.GetMaterialCount(); i++)
+	{
+		const SNAPSHOT_MATERIAL& record = snapshot.GetMaterial(i);
+		OBJECT_MATERIAL& material = materials[i];
+		material.tag = snapshot.GetString(record.tag);
+		material.diffuseColor = record.diffuseColor;
+		material.specularColor = record.specularColor;
+		material.shininess = record.shininess;
+		material.proceduralType = record.proceduralType;
+		material.proceduralColorA = record.proceduralColorA;
+		material.proceduralColorB = record.proceduralColorB;
+		material.proceduralParams = record.proceduralParams;
+		material.bakeResolution = record.bakeResolution;
+	}
+
+	pointLights.resize(snapshot.GetPointLightCount());
+	for (int i = 0; i < snapshot.GetPointLightCount(); i++)
+	{
+		const SNAPSHOT_POINT_LIGHT& record = snapshot.GetPointLight(i);
+		POINT_LIGHT& light = pointLights[i];
+		light.tag = snapshot.GetString(record.tag);
+		light.position = record.position;
+		light.ambient = record.ambient;
+		light.diffuse = record.diffuse;
+		light.specular = record.specular;
+		light.constant = record.constant;
+		light.linear = record.linear;
+		light.quadratic = record.quadratic;
+		light.bActive = (record.bActive != 0);
+	}
 
-	// Draw the cylinder.
-	m_basicMeshes->DrawCylinderMesh();
+	const SNAPSHOT_DIRECTIONAL_LIGHT& directionalRecord = snapshot.GetDirectionalLight();
+	directionalLight.direction = directionalRecord.direction;
+	directionalLight.ambient = directionalRecord.ambient;
+	directionalLight.diffuse = directionalRecord.diffuse;
+	directionalLight.specular = directionalRecord.specular;
+	directionalLight.bActive = (directionalRecord.bActive != 0);
 
-	/****************************************************************/
+	// the transforms and bounds are saved too, so the objects are
+	// ready to draw as soon as they are copied
+	objects.resize(snapshot.GetObjectCount());
+	m_pJobSystem->ParallelFor(objects.size(), 1024, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				const SNAPSHOT_OBJECT& record = snapshot.GetSceneObject(static_cast<int>(i));
+				SCENE_OBJECT& object = objects[i];
+				object.tag = snapshot.GetString(record.tag);
+				object.textureTag = snapshot.GetString(record.textureTag);
+				object.virtualTextureTag = snapshot.GetString(record.virtualTextureTag);
+				object.materialTag = snapshot.GetString(record.materialTag);
+				object.shape = static_cast<SHAPE_TYPE>(record.shape);
+				object.bOccluder = (record.bOccluder != 0);
+				object.scaleXYZ = record.scaleXYZ;
+				object.rotationDegrees = record.rotationDegrees;
+				object.positionXYZ = record.positionXYZ;
+				object.color = record.color;
+				object.UVscale = record.UVscale;
+				object.modelMatrix = record.modelMatrix;
+				object.boundsMin = record.boundsMin;
+				object.boundsMax = record.boundsMax;
+			}
+		});
 
-	// Tackle box.
-	scaleXYZ = glm::vec3(4.0f, 2.0f, 2.5f);
-	positionXYZ = glm::vec3(-4.0f, 1.0f, -1.0f);
-	SetTransformations(scaleXYZ, 0.0f, 15.0f, 0.0f, positionXYZ);
-	SetShaderColor(1.0f, 1.0f, 1.0f, 1.0f);
-	SetShaderTexture("boxTexture");
-	SetTextureUVScale(1.0, 1.0);
-	SetShaderMaterial("tackleBox");
-	m_basicMeshes->DrawBoxMesh();
+	textureSources.resize(snapshot.GetTextureCount());
+	for (int i = 0; i < snapshot.GetTextureCount(); i++)
+	{
+		const SNAPSHOT_TEXTURE& record = snapshot.GetTexture(i);
+		textureSources[i].filename = snapshot.GetString(record.filename);
+		textureSources[i].tag = snapshot.GetString(record.tag);
+		textureSources[i].type = static_cast<TEXTURE_SOURCE_TYPE>(record.type);
+	}
 
-	/****************************************************************/
+	return(true);
+}
 
-	// Fishing rod (cork handle).
-	scaleXYZ = glm::vec3(0.3f, 3.0f, 0.3f);
-	positionXYZ = glm::vec3(0.0f, 0.15f, 2.0f);
-	SetTransformations(scaleXYZ, 0.0f, -20.0f, 90.0f, positionXYZ);
-	SetShaderColor(1.0f, 1.0f, 1.0f, 1.0f);
-	SetShaderTexture("corkTexture");
-	SetTextureUVScale(1.0, 1.0);
-	SetShaderMaterial("cork");
-	m_basicMeshes->DrawCylinderMesh();
+/***********************************************************
+ *  RestoreScene()
+ *
+ *  This method is used in place of PrepareScene() for
+ *  restoring the state saved by SaveSnapshot().  The image
+ *  is mapped and its records are copied straight into the
+ *  scene across the workers, instead of defining the scene
+ *  in code and applying the settings file and edits again.
+ *  The textures are loaded from the saved image files.
+ *  Returns false, with nothing prepared, when there is no
+ *  valid snapshot.  The reported time covers the whole
+ *  restore, the textures and visibility sets included.
+ ***********************************************************/
+bool SceneManager::RestoreScene(SNAPSHOT_CAMERA& camera)
+{
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
 
-	/****************************************************************/
+	SceneSnapshot snapshot;
+	if (snapshot.Open(g_SceneSnapshotFile) == false)
+	{
+		return(false);
+	}
 
-	// Rod shaft (thinner, darker section).
-	scaleXYZ = glm::vec3(0.15f, 14.0f, 0.15f);
-	positionXYZ = glm::vec3(1.25f, 0.15f, 2.0f);
-	SetTransformations(scaleXYZ, 0.0f, -20.0f, 90.0f, positionXYZ);
-	SetShaderColor(1.0f, 1.0f, 1.0f, 1.0f);
-	SetShaderTexture("rodTexture");
-	SetTextureUVScale(1.0, 3.0);
-	m_basicMeshes->DrawCylinderMesh();
+	std::vector<TEXTURE_SOURCE> textureSources;
+	if (ReadSnapshotScene(snapshot, m_sceneObjects, m_objectMaterials, m_pointLights, m_directionalLight, textureSources) == false)
+	{
+		std::cout << "Ignoring damaged snapshot:" << g_SceneSnapshotFile << std::endl;
+		return(false);
+	}
+	camera = snapshot.GetCamera();
 
-	/****************************************************************/
+	// unmapped before any new snapshot can be moved over the file
+	snapshot.Close();
 
-	// Fishing reel.
-	scaleXYZ = glm::vec3(0.6f, 0.2f, 0.6f);
+	// load the textures in the same order as LoadSceneTextures()
+	for (int i = 0; i < textureSources.size(); i++)
+	{
+		if (textureSources[i].type == TEXTURE_SOURCE_IMAGE)
+		{
+			CreateGLTexture(textureSources[i].filename.c_str(), textureSources[i].tag);
+		}
+		else if (textureSources[i].type == TEXTURE_SOURCE_ATLAS)
+		{
+			AddAtlasTexture(textureSources[i].filename.c_str(), textureSources[i].tag);
+		}
+	}
+	CreateAtlasTexture();
+	BindGLTextures();
+	for (int i = 0; i < textureSources.size(); i++)
+	{
+		if (textureSources[i].type == TEXTURE_SOURCE_VIRTUAL)
+		{
+			CreateVirtualTexture(textureSources[i].filename.c_str(), textureSources[i].tag);
+		}
+	}
+	BakeProceduralMaterials();
 
-	// Rotate around X so the circular face is vertical.
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-	positionXYZ = glm::vec3(0.65f, 0.05f, 2.75f);
+	m_basicMeshes->LoadPlaneMesh();
+	m_basicMeshes->LoadCylinderMesh();
+	m_basicMeshes->LoadTorusMesh();
+	m_basicMeshes->LoadBoxMesh();
+	m_basicMeshes->LoadSphereMesh();
 
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
+	BuildVisibilitySets(m_sceneObjects, m_visibilitySets, g_VisibilityCacheFile);
+	DefineSceneAnimations();
+	DefineFishSchools();
+	DefineLake();
+	DefineTerrain();
+	DefineFoliage();
+	DefineFishingLines();
+	DefineRigidBodies();
 
-	// Reuse the tackle box material.
-	SetShaderColor(1.0f, 1.0f, 1.0f, 1.0f);
-	SetShaderTexture("reelTexture");
-	SetTextureUVScale(1.0, 1.0);
-	SetShaderMaterial("tackleBox");
+	glGenQueries(2, m_gpuTimerQueries);
+	glGenQueries(2, m_shadedSampleQueries);
 
-	m_basicMeshes->DrawCylinderMesh();
+	UploadSceneUniforms();
 
-	/****************************************************************/
+	double restoreMilliseconds = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - startTime).count();
+	std::cout << "Restored " << m_sceneObjects.size() << " scene objects from "
+		<< g_SceneSnapshotFile << " in " << restoreMilliseconds << " ms" << std::endl;
+	return(true);
+}
 
-	// Side of fishing reel.
-	scaleXYZ = glm::vec3(0.3f, 0.1f, 0.3f);
+/***********************************************************
+ *  PreloadScene()
+ *
+ *  This method is used for starting to load the scene saved
+ *  in the passed in snapshot image while the current scene
+ *  keeps rendering.  PreloadSceneTask() reads and uploads
+ *  it over the next frames, and SwitchToPreloadedScene()
+ *  swaps the scene in once everything is resident.
+ ***********************************************************/
+bool SceneManager::PreloadScene(const char* snapshotFile)
+{
+	if (m_preloadState == PRELOAD_LOADING)
+	{
+		std::cout << "Still preloading scene:" << m_pPreloadedScene->filename << std::endl;
+		return(false);
+	}
+	DiscardPreloadedScene();
 
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-	positionXYZ = glm::vec3(0.65f, 0.2f, 2.75f);
+	PRELOADED_SCENE* pScene = new PRELOADED_SCENE();
+	pScene->filename = snapshotFile;
+	pScene->startTime = std::chrono::steady_clock::now();
+	// the worker compares against the textures loaded now, and keeps
+	// the packed atlas when the new scene packs the same images
+	pScene->residentSources = m_textureSources;
+	pScene->textureAtlas = m_textureAtlas;
 
-	SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
+	m_pPreloadedScene = pScene;
+	m_preloadState = PRELOAD_LOADING;
+	m_preloadSerial++;
+	m_pTasks->Start(PreloadSceneTask(pScene, m_preloadSerial));
 
-	// Reuse the tackle box material.
-	SetShaderColor(0.2f, 0.2f, 0.2f, 1.0f);
-	SetShaderMaterial("tackleBox");
+	return(true);
+}
 
-	m_basicMeshes->DrawCylinderMesh();
+/***********************************************************
+ *  PreloadSceneTask()
+ *
+ *  This method is used for loading a preloaded scene as one
+ *  task.  The records and textures are read on a worker,
+ *  the textures are uploaded on the upload thread, or a
+ *  part every frame on the GL thread without one, and the
+ *  scene is ready once a fence shows the GPU has copied
+ *  the last of them.  The task stops early
+ *  when a newer preload has replaced its scene.
+ ***********************************************************/
+Task SceneManager::PreloadSceneTask(PRELOADED_SCENE* pScene, int preload)
+{
+	co_await m_pTasks->ResumeOnWorker();
+	bool bLoaded = LoadPreloadedScene(pScene);
 
-	/****************************************************************/
+	// the scene cannot be replaced while it is loading
+	co_await m_pTasks->ResumeOnMainThread();
+	if (bLoaded == false)
+	{
+		std::cout << "Could not preload scene:" << pScene->filename << std::endl;
+		DiscardPreloadedScene();
+		co_return;
+	}
 
-	// Fish body (elongated sphere).
-	scaleXYZ = glm::vec3(3.0f, 0.8f, 0.4f);
-	positionXYZ = glm::vec3(0.0f, -0.4f, 6.0f);
-	SetTransformations(scaleXYZ, 270.0f, 10.0f, 0.0f, positionXYZ);
-	SetShaderColor(1.0f, 1.0f, 1.0f, 1.0f);
-	SetShaderTexture("troutTexture");
-	SetTextureUVScale(2.0, 1.0);
-	SetShaderMaterial("fish");
-	m_basicMeshes->DrawSphereMesh();
-
-	/****************************************************************/
-
-	// Fish eye.
-	scaleXYZ = glm::vec3(0.15f, 0.15f, 0.05f);
-
-	// Positioning relative to the fish body, adjusting for the fish's rotation.
-	positionXYZ = glm::vec3(-2.3f, -0.2f, 6.1f);
-	SetTransformations(scaleXYZ, 270.0f, 10.0f, 10.0f, positionXYZ);
-
-	// Dark color for the eye.
-	SetShaderColor(0.1f, 0.1f, 0.1f, 1.0f); 
-	m_basicMeshes->DrawSphereMesh();
-
-	/****************************************************************/
-
-	// Fish tail using box mesh shaped into a triangle.
-	// Thin and triangular shape.
-	scaleXYZ = glm::vec3(0.8f, 0.1f, 0.8f); 
-	positionXYZ = glm::vec3(2.95f, -0.4f, 5.475f);
-	SetTransformations(scaleXYZ, 0.0f, 54.0f, 0.0f, positionXYZ);
-	SetShaderColor(1.0f, 1.0f, 1.0f, 1.0f);
-	SetShaderTexture("tailTexture");
-	SetTextureUVScale(1.0, 1.0);
-	SetShaderMaterial("fish");
-	m_basicMeshes->DrawBoxMesh();
-
-	/****************************************************************/
-
-	// Fishing rod eyelets.
-	// Adding multiple eyelets along the rod.
-	// Positions along the rod.
-	float eyeletPositions[] = { 2.5f, 4.5f, 6.5f, 8.5f, 10.5f }; 
-	for (int i = 0; i < 5; i++) {
-		scaleXYZ = glm::vec3(0.15f, 0.15f, 0.15f);
+	// the upload thread creates and fills the textures while the scene
+	// still counts as loading, so nothing replaces it meanwhile
+	if (NULL != m_pUploads)
+	{
+		size_t uploadedBytes = 0;
+		double uploadMilliseconds = 0.0;
+		co_await m_pUploads->Upload([this, pScene, &uploadedBytes, &uploadMilliseconds]()
+			{
+				std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+				uploadedBytes = UploadPreloadedImages(pScene);
+				uploadMilliseconds = std::chrono::duration<double, std::milli>(
+					std::chrono::steady_clock::now() - startTime).count();
+			});
+		std::cout << "Uploaded " << (uploadedBytes / (1024 * 1024)) << " MB of textures on the upload thread in "
+			<< uploadMilliseconds << " ms" << std::endl;
+	}
+	m_preloadState = PRELOAD_UPLOADING;
 
-		// Calculate position along the angled rod.
-		positionXYZ = glm::vec3(
-			-15.0f + (eyeletPositions[i] * cos(glm::radians(-20.0f))), 
-			0.15f,                                                     
-			2.26f + (eyeletPositions[i] * sin(glm::radians(0.0f)))   
-		);
+	while (UploadPreloadedTextures(pScene) == false)
+	{
+		co_await m_pTasks->NextFrame();
+		if (m_preloadSerial != preload)
+		{
+			co_return;
+		}
+	}
 
-		SetTransformations(scaleXYZ, 0.0f, 90.0f, 0.0f, positionXYZ);
+	co_await m_pTasks->WaitForFence(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+	if (m_preloadSerial != preload)
+	{
+		co_return;
+	}
+	m_preloadState = PRELOAD_READY;
 
-		// Dark metallic color for eyelets.
-		SetShaderColor(0.2f, 0.2f, 0.2f, 1.0f); 
+	double preloadMilliseconds = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - pScene->startTime).count();
+	std::cout << "Preloaded scene:" << pScene->filename << " in " << preloadMilliseconds << " ms" << std::endl;
+}
 
-		// Reusing tackle box material for metallic look.
-		SetShaderMaterial("tackleBox"); 
-		m_basicMeshes->DrawTorusMesh();
+/***********************************************************
+ *  LoadPreloadedScene()
+ *
+ *  This method is run on a worker thread for reading the
+ *  records of a preloaded scene, hashing its image files,
+ *  and preparing the textures whose content is not loaded
+ *  already, so only new texels are uploaded.  The visibility
+ *  sets are loaded or baked into a cache file of their own
+ *  for each scene.
+ ***********************************************************/
+bool SceneManager::LoadPreloadedScene(PRELOADED_SCENE* pScene)
+{
+	SceneSnapshot snapshot;
+	if (snapshot.Open(pScene->filename.c_str()) == false)
+	{
+		return(false);
+	}
+	if (ReadSnapshotScene(
+		snapshot,
+		pScene->objects,
+		pScene->materials,
+		pScene->pointLights,
+		pScene->directionalLight,
+		pScene->textureSources) == false)
+	{
+		return(false);
 	}
+	pScene->camera = snapshot.GetCamera();
+	snapshot.Close();
 
-	/****************************************************************/
+	std::vector<TEXTURE_SOURCE>& sources = pScene->textureSources;
+	std::vector<std::vector<uint8_t>> fileContents(sources.size());
+	m_pJobSystem->ParallelFor(sources.size(), 1, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				if (ReadFileContents(sources[i].filename, fileContents[i], sources[i].contentHash) == false)
+				{
+					std::cout << "Could not load image:" << sources[i].filename << std::endl;
+				}
+			}
+		});
 
-	// Steam particles (small spheres with transparency).
-	SetShaderColor(1.0f, 1.0f, 1.0f, 0.3f);
-	float steamHeights[] = { 2.2f, 2.5f, 2.8f };
-	float steamOffsets[] = { 0.1f, -0.1f, 0.0f };
-	for (int i = 0; i < 3; i++) {
-		scaleXYZ = glm::vec3(0.2f, 0.2f, 0.2f);
-		positionXYZ = glm::vec3(4.0f + steamOffsets[i], steamHeights[i], 0.0f);
-		SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
-		m_basicMeshes->DrawSphereMesh();
+	// find the loaded texture with the same content as each source,
+	// where the packed atlas is only kept when every image is the same
+	std::vector<std::string> sharedTags(sources.size());
+	int atlasImageCount = 0;
+	int residentAtlasImageCount = 0;
+	bool bAtlasShared = true;
+	for (int i = 0; i < pScene->residentSources.size(); i++)
+	{
+		if (pScene->residentSources[i].type == TEXTURE_SOURCE_ATLAS)
+		{
+			residentAtlasImageCount++;
+		}
+	}
+	for (int i = 0; i < sources.size(); i++)
+	{
+		for (int j = 0; j < pScene->residentSources.size(); j++)
+		{
+			const TEXTURE_SOURCE& resident = pScene->residentSources[j];
+			if ((resident.type == sources[i].type) && (resident.contentHash == sources[i].contentHash) &&
+				((sources[i].type == TEXTURE_SOURCE_IMAGE) || (resident.tag == sources[i].tag)))
+			{
+				sharedTags[i] = resident.tag;
+				break;
+			}
+		}
+		if (sources[i].type == TEXTURE_SOURCE_ATLAS)
+		{
+			atlasImageCount++;
+			bAtlasShared &= (sharedTags[i].size() > 0);
+		}
+	}
+	bAtlasShared &= (atlasImageCount == residentAtlasImageCount);
+
+	// decode the images that are not shared, expanding RGB to RGBA
+	std::vector<std::vector<TEXTURE_LEVEL>> sourceLevels(sources.size());
+	stbi_set_flip_vertically_on_load(true);
+	m_pJobSystem->ParallelFor(sources.size(), 1, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				bool bShared = (sources[i].type == TEXTURE_SOURCE_ATLAS) ? bAtlasShared : (sharedTags[i].size() > 0);
+				if ((sources[i].type == TEXTURE_SOURCE_VIRTUAL) || bShared || (fileContents[i].size() == 0))
+				{
+					continue;
+				}
+
+				// atlas images are decoded to RGBA8 whatever their channels
+				int width = 0;
+				int height = 0;
+				int colorChannels = 0;
+				int requiredChannels = (sources[i].type == TEXTURE_SOURCE_ATLAS) ? 4 : 0;
+				unsigned char* image = stbi_load_from_memory(
+					fileContents[i].data(),
+					static_cast<int>(fileContents[i].size()),
+					&width,
+					&height,
+					&colorChannels,
+					requiredChannels);
+				std::vector<uint8_t>().swap(fileContents[i]);
+				if (!image)
+				{
+					continue;
+				}
+				if (requiredChannels != 0)
+				{
+					colorChannels = requiredChannels;
+				}
+
+				// atlas images are mipmapped once packed
+				int maxLevel = (sources[i].type == TEXTURE_SOURCE_ATLAS) ? 0 : -1;
+				PrepareTextureLevels(image, width, height, colorChannels, maxLevel, sourceLevels[i], m_pJobSystem);
+				stbi_image_free(image);
+			}
+		});
+
+	int slotCount = 0;
+	for (int i = 0; i < sources.size(); i++)
+	{
+		if (sources[i].type == TEXTURE_SOURCE_ATLAS)
+		{
+			continue;
+		}
+
+		PRELOAD_TEXTURE texture;
+		texture.tag = sources[i].tag;
+		texture.type = sources[i].type;
+		texture.sharedTag = sharedTags[i];
+		if ((sources[i].type == TEXTURE_SOURCE_VIRTUAL) && (texture.sharedTag.size() == 0))
+		{
+			std::error_code error;
+			std::filesystem::create_directories(g_AssetCacheFolder, error);
+			texture.virtualCacheFile = std::string(g_AssetCacheFolder) + "/" +
+				std::filesystem::path(sources[i].filename).stem().string() + g_VirtualTextureCacheExtension;
+			if (VirtualTexture::Cook(sources[i].filename.c_str(), texture.virtualCacheFile.c_str(), m_pJobSystem) == false)
+			{
+				continue;
+			}
+		}
+		else if (sources[i].type == TEXTURE_SOURCE_IMAGE)
+		{
+			if ((texture.sharedTag.size() == 0) && (sourceLevels[i].size() == 0))
+			{
+				std::cout << "Could not load image:" << sources[i].filename << std::endl;
+				continue;
+			}
+			texture.levels.swap(sourceLevels[i]);
+			slotCount++;
+		}
+		pScene->textures.push_back(texture);
+	}
+
+	if (atlasImageCount > 0)
+	{
+		PRELOAD_TEXTURE texture;
+		texture.tag = g_AtlasTextureTag;
+		texture.type = TEXTURE_SOURCE_ATLAS;
+		if (bAtlasShared)
+		{
+			texture.sharedTag = g_AtlasTextureTag;
+		}
+		else
+		{
+			pScene->textureAtlas = TextureAtlas();
+			for (int i = 0; i < sources.size(); i++)
+			{
+				if ((sources[i].type == TEXTURE_SOURCE_ATLAS) && (sourceLevels[i].size() > 0))
+				{
+					pScene->textureAtlas.AddImage(
+						sources[i].tag,
+						sourceLevels[i][0].width,
+						sourceLevels[i][0].height,
+						reinterpret_cast<const uint8_t*>(sourceLevels[i][0].texels.data()));
+				}
+			}
+			if ((pScene->textureAtlas.GetImageCount() > 0) && (pScene->textureAtlas.Pack(g_AtlasSize) == true))
+			{
+				PrepareTextureLevels(
+					pScene->textureAtlas.GetPixels().data(),
+					pScene->textureAtlas.GetWidth(),
+					pScene->textureAtlas.GetHeight(),
+					4,
+					pScene->textureAtlas.GetMaxMipLevel(),
+					texture.levels,
+					m_pJobSystem);
+			}
+			pScene->textureAtlas.ReleasePixels();
+		}
+		if ((texture.sharedTag.size() > 0) || (texture.levels.size() > 0))
+		{
+			pScene->textures.push_back(texture);
+			slotCount++;
+		}
+	}
+
+	if (slotCount > g_VertexAnimationPositionUnit)
+	{
+		std::cout << "Too many textures to preload scene:" << pScene->filename << std::endl;
+		return(false);
+	}
+
+	std::string cacheFile = std::string(g_AssetCacheFolder) + "/" +
+		std::filesystem::path(pScene->filename).stem().string() + g_VisibilityCacheExtension;
+	BuildVisibilitySets(pScene->objects, pScene->visibilitySets, cacheFile);
+
+	return(true);
+}
+
+/***********************************************************
+ *  UploadPreloadedTextures()
+ *
+ *  This method is used for uploading the next rows of the
+ *  preloaded textures, up to a fixed number of bytes each
+ *  frame, and opening at most one of its virtual textures
+ *  per frame.  The textures bound for the current scene are
+ *  left as they are.  Returns true once every texture of
+ *  the scene is resident.
+ ***********************************************************/
+bool SceneManager::UploadPreloadedTextures(PRELOADED_SCENE* pScene)
+{
+	size_t byteBudget = g_PreloadUploadBytesPerFrame;
+	GLint activeUnit = 0;
+	GLint boundTexture = 0;
+	glGetIntegerv(GL_ACTIVE_TEXTURE, &activeUnit);
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &boundTexture);
+
+	bool bUploaded = true;
+	for (int i = 0; (i < pScene->textures.size()) && (byteBudget > 0); i++)
+	{
+		PRELOAD_TEXTURE& texture = pScene->textures[i];
+		if ((texture.bUploaded) || (texture.sharedTag.size() > 0))
+		{
+			continue;
+		}
+
+		if (texture.type == TEXTURE_SOURCE_VIRTUAL)
+		{
+			texture.pVirtualTexture = new VirtualTexture();
+			if (texture.pVirtualTexture->Open(
+				texture.virtualCacheFile.c_str(),
+				texture.tag,
+				g_VirtualTexturePhysicalUnit,
+				g_VirtualTexturePageTableUnit,
+				m_pJobSystem) == false)
+			{
+				delete texture.pVirtualTexture;
+				texture.pVirtualTexture = NULL;
+			}
+			texture.bUploaded = true;
+			byteBudget = 0;
+			bUploaded = false;
+			continue;
+		}
+
+		if (texture.ID == 0)
+		{
+			CreatePreloadedTexture(texture);
+		}
+		else
+		{
+			glBindTexture(GL_TEXTURE_2D, texture.ID);
+		}
+
+		texture.bUploaded = UploadTextureLevelsPartly(texture.levels, texture.uploadedBytes, byteBudget);
+		if (texture.bUploaded)
+		{
+			std::vector<TEXTURE_LEVEL>().swap(texture.levels);
+		}
+		bUploaded &= texture.bUploaded;
+	}
+	// opening a virtual texture moves the active unit
+	glActiveTexture(activeUnit);
+	glBindTexture(GL_TEXTURE_2D, boundTexture);
+
+	for (int i = 0; i < pScene->textures.size(); i++)
+	{
+		bUploaded &= (pScene->textures[i].bUploaded || (pScene->textures[i].sharedTag.size() > 0));
+	}
+	return(bUploaded);
+}
+
+/***********************************************************
+ *  UploadPreloadedImages()
+ *
+ *  This method is run on the upload thread for creating
+ *  the image and atlas textures of a preloaded scene and
+ *  uploading all of their levels at once, since nothing
+ *  waits on this thread.  Virtual textures are left to be
+ *  opened on the GL thread.  Returns the bytes uploaded.
+ ***********************************************************/
+size_t SceneManager::UploadPreloadedImages(PRELOADED_SCENE* pScene)
+{
+	size_t uploadedBytes = 0;
+	for (int i = 0; i < pScene->textures.size(); i++)
+	{
+		PRELOAD_TEXTURE& texture = pScene->textures[i];
+		if ((texture.bUploaded) || (texture.sharedTag.size() > 0) || (texture.type == TEXTURE_SOURCE_VIRTUAL))
+		{
+			continue;
+		}
+
+		CreatePreloadedTexture(texture);
+		UpdateTextureLevels(texture.levels, 0, 0);
+		for (int level = 0; level < texture.levels.size(); level++)
+		{
+			uploadedBytes += texture.levels[level].texels.size() * sizeof(uint32_t);
+		}
+		texture.bUploaded = true;
+		std::vector<TEXTURE_LEVEL>().swap(texture.levels);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	return(uploadedBytes);
+}
+
+/***********************************************************
+ *  CreatePreloadedTexture()
+ *
+ *  This method is used for creating a texture of a preloaded
+ *  scene, binding it and allocating its prepared levels.
+ ***********************************************************/
+void SceneManager::CreatePreloadedTexture(PRELOAD_TEXTURE& texture)
+{
+	glGenTextures(1, &texture.ID);
+	glBindTexture(GL_TEXTURE_2D, texture.ID);
+	if (texture.type == TEXTURE_SOURCE_ATLAS)
+	{
+		// the shader wraps inside each image rectangle itself
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	}
+	else
+	{
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	AllocateTextureLevels(texture.levels);
+}
+
+/***********************************************************
+ *  UpdateTasks()
+ *
+ *  This method is used for resuming the background tasks
+ *  that wait for the GL thread, for this frame or for a GPU
+ *  fence.  It is called once every frame.
+ ***********************************************************/
+void SceneManager::UpdateTasks()
+{
+	m_pTasks->Update();
+}
+
+/***********************************************************
+ *  SwitchToPreloadedScene()
+ *
+ *  This method is used for swapping the preloaded scene in
+ *  for the current one between two frames.  Everything it
+ *  draws with is resident already, so only the texture
+ *  table, the scene records and the shader values change.
+ *  The textures of the current scene that the new one does
+ *  not share are freed.  Returns false while the preloaded
+ *  scene is not ready yet.
+ ***********************************************************/
+bool SceneManager::SwitchToPreloadedScene(SNAPSHOT_CAMERA& camera)
+{
+	if (m_preloadState != PRELOAD_READY)
+	{
+		return(false);
+	}
+
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	PRELOADED_SCENE* pScene = m_pPreloadedScene;
+
+	TEXTURE_INFO textureIDs[16];
+	int loadedTextures = 0;
+	std::vector<VirtualTexture*> virtualTextures;
+	for (int i = 0; i < pScene->textures.size(); i++)
+	{
+		PRELOAD_TEXTURE& texture = pScene->textures[i];
+		if (texture.type == TEXTURE_SOURCE_VIRTUAL)
+		{
+			int index = (texture.sharedTag.size() > 0) ? FindVirtualTexture(texture.sharedTag) : -1;
+			if (index >= 0)
+			{
+				virtualTextures.push_back(m_virtualTextures[index]);
+				m_virtualTextures.erase(m_virtualTextures.begin() + index);
+			}
+			else if (texture.pVirtualTexture != NULL)
+			{
+				virtualTextures.push_back(texture.pVirtualTexture);
+				texture.pVirtualTexture = NULL;
+			}
+			continue;
+		}
+
+		int textureID = (texture.sharedTag.size() > 0) ? FindTextureID(texture.sharedTag) : static_cast<int>(texture.ID);
+		if (textureID <= 0)
+		{
+			continue;
+		}
+		textureIDs[loadedTextures].ID = textureID;
+		textureIDs[loadedTextures].tag = texture.tag;
+		loadedTextures++;
+		texture.ID = 0;
+	}
+
+	// baked procedural textures stay loaded for unchanged materials
+	for (int i = 0; i < m_loadedTextures; i++)
+	{
+		const std::string& tag = m_textureIDs[i].tag;
+		std::string prefix = g_BakedTexturePrefix;
+		if ((tag.compare(0, prefix.size(), prefix) != 0) ||
+			(loadedTextures >= g_VertexAnimationPositionUnit))
+		{
+			continue;
+		}
+
+		OBJECT_MATERIAL material;
+		if (FindMaterial(tag.substr(prefix.size()), material) == false)
+		{
+			continue;
+		}
+		for (int j = 0; j < pScene->materials.size(); j++)
+		{
+			const OBJECT_MATERIAL& newMaterial = pScene->materials[j];
+			if ((newMaterial.tag == material.tag) &&
+				(newMaterial.proceduralType == material.proceduralType) &&
+				(newMaterial.proceduralColorA == material.proceduralColorA) &&
+				(newMaterial.proceduralColorB == material.proceduralColorB) &&
+				(newMaterial.proceduralParams == material.proceduralParams) &&
+				(newMaterial.bakeResolution == material.bakeResolution))
+			{
+				textureIDs[loadedTextures] = m_textureIDs[i];
+				loadedTextures++;
+				break;
+			}
+		}
+	}
+
+	// free the loaded textures the new scene does not share
+	for (int i = 0; i < m_loadedTextures; i++)
+	{
+		bool bShared = false;
+		for (int j = 0; j < loadedTextures; j++)
+		{
+			bShared |= (textureIDs[j].ID == m_textureIDs[i].ID);
+		}
+		if (bShared == false)
+		{
+			glDeleteTextures(1, &m_textureIDs[i].ID);
+		}
+	}
+	for (int i = 0; i < 16; i++)
+	{
+		if (i < loadedTextures)
+		{
+			m_textureIDs[i] = textureIDs[i];
+		}
+		else
+		{
+			m_textureIDs[i].tag = "/0";
+			m_textureIDs[i].ID = -1;
+		}
+	}
+	m_loadedTextures = loadedTextures;
+
+	// waits for the tile loads still reading the cache files
+	for (int i = 0; i < m_virtualTextures.size(); i++)
+	{
+		delete m_virtualTextures[i];
+	}
+	m_virtualTextures.swap(virtualTextures);
+
+	m_sceneObjects.swap(pScene->objects);
+	m_objectMaterials.swap(pScene->materials);
+	m_pointLights.swap(pScene->pointLights);
+	m_directionalLight = pScene->directionalLight;
+	m_textureSources.swap(pScene->textureSources);
+	m_textureAtlas = pScene->textureAtlas;
+	m_visibilitySets = pScene->visibilitySets;
+	camera = pScene->camera;
+	// the animations were bound to the values of the old scene
+	DefineSceneAnimations();
+
+	// the settings applied so far named the items of the old scene
+	m_appliedSettings.clear();
+	m_settingDefaults.clear();
+	if (NULL != m_pFileWatcher)
+	{
+		for (int i = 0; i < m_textureSources.size(); i++)
+		{
+			m_pFileWatcher->Watch(m_textureSources[i].filename);
+		}
+	}
+
+	BindGLTextures();
+	BakeProceduralMaterials();
+	UploadSceneUniforms();
+
+	double switchMilliseconds = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - startTime).count();
+	std::cout << "Switched to scene:" << pScene->filename << " in " << switchMilliseconds << " ms" << std::endl;
+
+	delete pScene;
+	m_pPreloadedScene = NULL;
+	m_preloadState = PRELOAD_NONE;
+
+	return(true);
+}
+
+/***********************************************************
+ *  DiscardPreloadedScene()
+ *
+ *  This method is used for dropping the preloaded scene and
+ *  freeing the textures uploaded for it.  It must not be
+ *  called while the worker is still loading it.
+ ***********************************************************/
+void SceneManager::DiscardPreloadedScene()
+{
+	if (NULL == m_pPreloadedScene)
+	{
+		return;
+	}
+
+	for (int i = 0; i < m_pPreloadedScene->textures.size(); i++)
+	{
+		PRELOAD_TEXTURE& texture = m_pPreloadedScene->textures[i];
+		if (texture.ID != 0)
+		{
+			glDeleteTextures(1, &texture.ID);
+		}
+		delete texture.pVirtualTexture;
 	}
-}
\ No newline at end of file
+
+	delete m_pPreloadedScene;
+	m_pPreloadedScene = NULL;
+	m_preloadState = PRELOAD_NONE;
+}
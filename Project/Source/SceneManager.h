@@ -11,10 +11,40 @@
 
 #include "ShaderManager.h"
 #include "ShapeMeshes.h"
+#include "JobSystem.h"
+#include "TaskScheduler.h"
+#include "PotentiallyVisibleSet.h"
+#include "LightGrid.h"
+#include "ProceduralMaterials.h"
+#include "VirtualTexture.h"
+#include "TextureAtlas.h"
+#include "TexturePreparation.h"
+#include "FileWatcher.h"
+#include "SceneFile.h"
+#include "EditServer.h"
+#include "SceneSnapshot.h"
+#include "AnimationSystem.h"
+#include "VertexAnimation.h"
+#include "BoidSimulation.h"
+#include "WaterSurface.h"
+#include "FishingLineSimulation.h"
+#include "RigidBodySimulation.h"
+#include "HeightfieldTerrain.h"
+#include "CameraPredictor.h"
+#include "FoliageScatter.h"
+#include "AtmosphereSky.h"
+#include "ScreenSpaceReflections.h"
+#include "UploadThread.h"
 
+#include <atomic>
+#include <chrono>
+#include <map>
 #include <string>
 #include <vector>
 
+// number of point light slots in the fragment shader
+#define TOTAL_POINT_LIGHTS 5
+
 /***********************************************************
  *  SceneManager
  *
@@ -41,6 +71,107 @@ public:
 		glm::vec3 specularColor;
 		float shininess;
 		std::string tag;
+		// surface evaluated from noise in the shader instead of a texture
+		int proceduralType = PROCEDURAL_NONE;
+		glm::vec3 proceduralColorA = glm::vec3(1.0f);
+		glm::vec3 proceduralColorB = glm::vec3(1.0f);
+		glm::vec4 proceduralParams = glm::vec4(1.0f);
+		// when above zero the procedural surface is baked into a
+		// texture of this resolution the first time it is drawn
+		int bakeResolution = 0;
+	};
+
+	struct POINT_LIGHT
+	{
+		glm::vec3 position;
+		glm::vec3 ambient;
+		glm::vec3 diffuse;
+		glm::vec3 specular;
+		float constant;
+		float linear;
+		float quadratic;
+		bool bActive;
+		std::string tag;
+	};
+
+	struct DIRECTIONAL_LIGHT
+	{
+		glm::vec3 direction;
+		glm::vec3 ambient;
+		glm::vec3 diffuse;
+		glm::vec3 specular;
+		bool bActive;
+	};
+
+	// basic mesh shapes that scene objects are drawn with
+	enum SHAPE_TYPE
+	{
+		SHAPE_PLANE,
+		SHAPE_CYLINDER,
+		SHAPE_TORUS,
+		SHAPE_BOX,
+		SHAPE_SPHERE
+	};
+
+	struct SCENE_OBJECT
+	{
+		std::string tag;
+		SHAPE_TYPE shape = SHAPE_BOX;
+		glm::vec3 scaleXYZ = glm::vec3(1.0f);
+		glm::vec3 rotationDegrees = glm::vec3(0.0f);
+		glm::vec3 positionXYZ = glm::vec3(0.0f);
+		glm::vec4 color = glm::vec4(1.0f);
+		// empty when the object is drawn with a solid color
+		std::string textureTag;
+		glm::vec2 UVscale = glm::vec2(1.0f);
+		// empty unless the texture is streamed through a virtual texture
+		std::string virtualTextureTag;
+		std::string materialTag;
+		// true when the object hides whatever is behind it
+		bool bOccluder = false;
+		// computed from the values above by UpdateObjectTransforms()
+		glm::mat4 modelMatrix = glm::mat4(1.0f);
+		glm::vec3 boundsMin = glm::vec3(0.0f);
+		glm::vec3 boundsMax = glm::vec3(0.0f);
+		// point lights reaching the object, assigned every frame
+		int pointLightCount = 0;
+		int pointLightIndices[TOTAL_POINT_LIGHTS] = { 0 };
+		// true when the object is small enough on screen to be
+		// lit per vertex, selected every frame
+		bool bVertexLighting = false;
+	};
+
+	// school of fish drawn with one instanced draw of the baked swim cycle
+	struct FISH_SCHOOL
+	{
+		std::string tag;
+		// index of the school in the vertex animation
+		int school = -1;
+		std::vector<VERTEX_ANIMATION_INSTANCE> instances;
+		// flocking of the fish, owned by the school
+		BoidSimulation* pBoids = NULL;
+		// world bounds of every fish over the whole cycle
+		glm::vec3 boundsMin = glm::vec3(0.0f);
+		glm::vec3 boundsMax = glm::vec3(0.0f);
+		// point lights reaching the school, assigned every frame
+		int pointLightCount = 0;
+		int pointLightIndices[TOTAL_POINT_LIGHTS] = { 0 };
+	};
+
+	// scene object carried by a rigid body, placed by the transform of
+	// the body followed by the local matrix
+	struct PHYSICS_PROP
+	{
+		int body = -1;
+		int object = -1;
+		glm::mat4 localMatrix = glm::mat4(1.0f);
+	};
+
+	// bobber thrown from the camera, drawn as its own scene object
+	struct THROWN_BOBBER
+	{
+		int body = -1;
+		SCENE_OBJECT object;
 	};
 
 private:
@@ -52,11 +183,287 @@ private:
 	int m_loadedTextures;
 	// loaded textures info
 	TEXTURE_INFO m_textureIDs[16];
+	// small textures packed together into one loaded texture
+	TextureAtlas m_textureAtlas;
+	// image files and tags waiting to be decoded into the atlas
+	std::vector<std::string> m_atlasFilenames;
+	std::vector<std::string> m_atlasTags;
 	// defined object materials
 	std::vector<OBJECT_MATERIAL> m_objectMaterials;
+	// defined scene objects, drawn in order
+	std::vector<SCENE_OBJECT> m_sceneObjects;
+	// worker threads for scene preparation work
+	JobSystem* m_pJobSystem;
+	// coroutines for work spanning frames and threads
+	TaskScheduler* m_pTasks;
+	// creates and fills textures on a shared context, NULL until
+	// background uploads are enabled
+	UploadThread* m_pUploads;
+	// baked visible objects for each view cell of the scene
+	PotentiallyVisibleSet m_visibilitySets;
+	// defined directional light
+	DIRECTIONAL_LIGHT m_directionalLight;
+	// defined point lights, uploaded to the shader slots in order
+	std::vector<POINT_LIGHT> m_pointLights;
+	// spatial grid over the point light influence spheres
+	LightGrid m_lightGrid;
+	// current world position of the camera
+	glm::vec3 m_cameraPosition;
+	// current camera view and projection
+	glm::mat4 m_viewMatrix;
+	glm::mat4 m_projectionMatrix;
+	// true when objects are tinted by their shading tier
+	bool m_bShadingTierDebug;
+	// indices of the objects that passed culling this frame
+	std::vector<int> m_visibleObjects;
+	// true when opaque depth is laid down before shading
+	bool m_bDepthPrepass;
+	// GPU timer queries alternating between frames
+	GLuint m_gpuTimerQueries[2];
+	// queries counting the fragments of the opaque shading pass,
+	// alternating between frames with the timer queries
+	GLuint m_shadedSampleQueries[2];
+	// total number of rendered frames
+	int m_renderedFrames;
+	// timed frames and GPU time since the last report
+	int m_timedFrames;
+	double m_gpuTimeTotal;
+	double m_shadedSampleTotal;
+	// textures too large to be fully resident, streamed in tiles
+	std::vector<VirtualTexture*> m_virtualTextures;
+	// low resolution target the virtual texture feedback is drawn into
+	GLuint m_feedbackFramebuffer;
+	GLuint m_feedbackRenderbuffers[2];
+	int m_feedbackWidth;
+	int m_feedbackHeight;
+	// read back buffers alternating between frames
+	GLuint m_feedbackPixelBuffers[2];
+	int m_feedbackReadbacks;
+
+	// how a texture image file was loaded, to reload it the same way
+	enum TEXTURE_SOURCE_TYPE
+	{
+		TEXTURE_SOURCE_IMAGE,
+		TEXTURE_SOURCE_ATLAS,
+		TEXTURE_SOURCE_VIRTUAL
+	};
+
+	struct TEXTURE_SOURCE
+	{
+		std::string filename;
+		std::string tag;
+		TEXTURE_SOURCE_TYPE type;
+		// hash of the file bytes, equal files share one loaded texture
+		uint64_t contentHash = 0;
+	};
+
+	// image files of the loaded textures
+	std::vector<TEXTURE_SOURCE> m_textureSources;
+	// watches the shader, texture and scene settings files for edits
+	FileWatcher* m_pFileWatcher;
+	std::string m_vertexShaderFile;
+	std::string m_fragmentShaderFile;
+	// scene settings applied from the file, by setting key
+	std::map<std::string, SCENE_SETTING> m_appliedSettings;
+	// values defined in code before the file first overrode them
+	std::map<std::string, std::vector<float>> m_settingDefaults;
+	// receives live edits from external tools
+	EditServer* m_pEditServer;
+
+	// progress of the scene being loaded in the background
+	enum PRELOAD_STATE
+	{
+		PRELOAD_NONE,
+		PRELOAD_LOADING,
+		PRELOAD_UPLOADING,
+		PRELOAD_READY
+	};
+
+	// texture of the preloaded scene, either a loaded texture with the
+	// same content or prepared levels uploaded on the upload thread, or
+	// a few rows per frame without it
+	struct PRELOAD_TEXTURE
+	{
+		std::string tag;
+		TEXTURE_SOURCE_TYPE type = TEXTURE_SOURCE_IMAGE;
+		// tag of the loaded texture it shares, empty when uploaded
+		std::string sharedTag;
+		std::vector<TEXTURE_LEVEL> levels;
+		GLuint ID = 0;
+		size_t uploadedBytes = 0;
+		// tiles cooked by the worker for a virtual texture
+		std::string virtualCacheFile;
+		VirtualTexture* pVirtualTexture = NULL;
+		bool bUploaded = false;
+	};
+
+	// every part of a scene loaded in the background, swapped in whole
+	struct PRELOADED_SCENE
+	{
+		std::string filename;
+		std::vector<SCENE_OBJECT> objects;
+		std::vector<OBJECT_MATERIAL> materials;
+		std::vector<POINT_LIGHT> pointLights;
+		DIRECTIONAL_LIGHT directionalLight;
+		SNAPSHOT_CAMERA camera;
+		std::vector<TEXTURE_SOURCE> textureSources;
+		std::vector<PRELOAD_TEXTURE> textures;
+		TextureAtlas textureAtlas;
+		PotentiallyVisibleSet visibilitySets;
+		// loaded textures at the time the preload started
+		std::vector<TEXTURE_SOURCE> residentSources;
+		std::chrono::steady_clock::time_point startTime;
+	};
+
+	// scene loaded in the background, NULL when none was requested
+	PRELOADED_SCENE* m_pPreloadedScene;
+	std::atomic<int> m_preloadState;
+	// counts the preloads started, so a task can tell when a newer
+	// preload replaced its scene
+	int m_preloadSerial;
+
+	// keyframed values of the scene objects and materials
+	AnimationSystem m_animationSystem;
+	// objects whose transforms are animated
+	std::vector<int> m_animatedObjects;
+	// time of the last animation update
+	std::chrono::steady_clock::time_point m_lastAnimationTime;
+	// animated frames and update time since the last report
+	int m_animatedFrames;
+	double m_animationTimeTotal;
+
+	// baked swim cycle shared by the fish schools
+	VertexAnimation m_vertexAnimation;
+	std::vector<FISH_SCHOOL> m_fishSchools;
+	// time the swim cycles are played from
+	std::chrono::steady_clock::time_point m_schoolStartTime;
+	// true when the aquarium variant of the scene is drawn
+	bool m_bAquarium;
+	// time of the last flocking update
+	std::chrono::steady_clock::time_point m_lastSchoolTime;
+	// flocked frames and update time since the last report
+	int m_flockedFrames;
+	double m_flockTimeTotal;
+	// program flocking the schools in compute shaders, 0 until
+	// first requested or when not supported
+	GLuint m_boidComputeProgram;
+	bool m_bBoidCompute;
+	bool m_bBoidComputeRequested;
+
+	// waves of the lake around the table
+	WaterSurface m_waterSurface;
+	// true when the lake is simulated and drawn
+	bool m_bLake;
+	// time the waves are simulated from
+	std::chrono::steady_clock::time_point m_lakeStartTime;
+	// simulated frames and update time since the last report
+	int m_simulatedLakeFrames;
+	double m_lakeTimeTotal;
+	// point lights reaching the lake, assigned every frame
+	int m_lakePointLightCount;
+	int m_lakePointLightIndices[TOTAL_POINT_LIGHTS];
+
+	// terrain reaching kilometers out from the lakeshore
+	HeightfieldTerrain m_terrain;
+	// true when the terrain is drawn
+	bool m_bTerrain;
+	// updated frames and update time since the last report
+	int m_updatedTerrainFrames;
+	double m_terrainTimeTotal;
+	// motion of the camera, extrapolated to prefetch the tiles it will
+	// need, and whether that is done
+	CameraPredictor m_cameraPredictor;
+	bool m_bPrefetch;
+	std::chrono::steady_clock::time_point m_lastTerrainUpdateTime;
+	// seconds updated and seconds a node waited on missing children,
+	// and prefetched tiles drawn and evicted unused, since the last
+	// report
+	double m_terrainSeconds;
+	double m_placeholderSeconds;
+	int m_prefetchUsedTotal;
+	int m_prefetchWastedTotal;
+	// point lights reaching the chosen terrain nodes, assigned every frame
+	int m_terrainPointLightCount;
+	int m_terrainPointLightIndices[TOTAL_POINT_LIGHTS];
+
+	// grass and reeds scattered and culled on the GPU, growing on the
+	// terrain tiles near the camera
+	FoliageScatter m_foliage;
+	GLuint m_foliageComputeProgram;
+	bool m_bFoliage;
+	bool m_bFoliageRequested;
+	// time the blades sway from
+	std::chrono::steady_clock::time_point m_foliageStartTime;
+	// updated frames and update time since the last report
+	int m_updatedFoliageFrames;
+	double m_foliageTimeTotal;
+	// point lights reaching the foliage, assigned every frame
+	int m_foliagePointLightCount;
+	int m_foliagePointLightIndices[TOTAL_POINT_LIGHTS];
+
+	// sky from the precomputed scattering of the atmosphere, which also
+	// colors the directional light as the sun and the sky
+	AtmosphereSky m_atmosphere;
+	GLuint m_atmosphereComputeProgram;
+	bool m_bSky;
+	bool m_bSkyRequested;
+	// updated frames, sky-view fills and update time since the last report
+	int m_updatedSkyFrames;
+	int m_skyViewUpdates;
+	double m_skyTimeTotal;
+
+	// reflections of the screen on the smooth surfaces, traced through
+	// a depth pyramid or, to compare against, marched linearly
+	ScreenSpaceReflections m_reflections;
+	GLuint m_reflectionComputeProgram;
+	bool m_bReflections;
+	bool m_bReflectionsRequested;
+	bool m_bLinearMarch;
+	// resolved frames and GPU time of the passes since the last report
+	int m_reflectionFrames;
+	double m_reflectionTimeTotal;
+
+	// line through the eyelets of the rod and the lines of the
+	// tackle shop display
+	FishingLineSimulation m_fishingLines;
+	// scene objects the rod line is pinned to, from the reel to the
+	// tip, and the index of the rod line, -1 when there is none
+	std::vector<int> m_rodLineAnchors;
+	int m_rodLine;
+	// true when the tackle shop display is hung behind the table
+	bool m_bTackleDisplay;
+	// time of the last fishing line update
+	std::chrono::steady_clock::time_point m_lastFishingLineTime;
+	// simulated frames and update time since the last report
+	int m_simulatedLineFrames;
+	double m_lineTimeTotal;
+	// point lights reaching the fishing lines, assigned every frame
+	int m_fishingLinePointLightCount;
+	int m_fishingLinePointLightIndices[TOTAL_POINT_LIGHTS];
+
+	// tabletop props knocked around as rigid bodies
+	RigidBodySimulation m_rigidBodies;
+	std::vector<PHYSICS_PROP> m_physicsProps;
+	// bobbers thrown at the props, reused from the oldest once all of
+	// them were thrown
+	std::vector<THROWN_BOBBER> m_thrownBobbers;
+	int m_nextBobber;
+	// rigid body shape shared by the bobbers
+	int m_bobberShape;
+	// true when the props are simulated
+	bool m_bPhysics;
+	// time of the last rigid body update
+	std::chrono::steady_clock::time_point m_lastPhysicsTime;
+	// simulated frames and update time since the last report
+	int m_simulatedPhysicsFrames;
+	double m_physicsTimeTotal;
 
 	// load texture images and convert to OpenGL texture data
 	bool CreateGLTexture(const char* filename, std::string tag);
+	// queue a small texture image to be packed into the atlas
+	bool AddAtlasTexture(const char* filename, std::string tag);
+	// decode and pack the queued small textures and load the atlas
+	bool CreateAtlasTexture();
 	// bind loaded OpenGL textures to slots in memory
 	void BindGLTextures();
 	// free the loaded OpenGL textures
@@ -66,6 +473,60 @@ private:
 	int FindTextureSlot(std::string tag);
 	// find a defined material by tag
 	bool FindMaterial(std::string tag, OBJECT_MATERIAL& material);
+	// find the index of a defined scene object by tag
+	int FindSceneObject(std::string tag);
+	// play a looping clip of one track on a value of a scene object,
+	// with the keys offset from the value it has now
+	void AnimateObjectValue(
+		int objectIndex,
+		float* pValue,
+		ANIMATION_INTERPOLATION interpolation,
+		const std::vector<ANIMATION_KEY>& keys,
+		float duration,
+		float startTime);
+	// bake a procedural material into a texture and register it
+	bool CreateProceduralTexture(const OBJECT_MATERIAL& material, std::string tag);
+	// bake the procedural materials asking for it that are not baked yet
+	void BakeProceduralMaterials();
+	// cook a large image into tiles and open it as a virtual texture
+	bool CreateVirtualTexture(const char* filename, std::string tag);
+	// find a loaded virtual texture by tag
+	int FindVirtualTexture(std::string tag);
+	// remember the image file a texture was loaded from
+	void AddTextureSource(const char* filename, std::string tag, TEXTURE_SOURCE_TYPE type);
+	// copy the scene records of a mapped snapshot image, returning
+	// false with nothing copied when a record is out of range
+	bool ReadSnapshotScene(
+		const SceneSnapshot& snapshot,
+		std::vector<SCENE_OBJECT>& objects,
+		std::vector<OBJECT_MATERIAL>& materials,
+		std::vector<POINT_LIGHT>& pointLights,
+		DIRECTIONAL_LIGHT& directionalLight,
+		std::vector<TEXTURE_SOURCE>& textureSources);
+	// load a scene in the background from the worker read to the
+	// uploaded textures
+	Task PreloadSceneTask(PRELOADED_SCENE* pScene, int preload);
+	// decode the textures and bake the visibility of a preloaded scene,
+	// run on a worker thread, returns false when it could not be read
+	bool LoadPreloadedScene(PRELOADED_SCENE* pScene);
+	// upload the next part of the preloaded scene textures, returns
+	// true once all of them are resident
+	bool UploadPreloadedTextures(PRELOADED_SCENE* pScene);
+	// upload every prepared level of the preloaded scene textures at
+	// once, run on the upload thread, returning the bytes uploaded
+	size_t UploadPreloadedImages(PRELOADED_SCENE* pScene);
+	// create and bind a preloaded scene texture and allocate its levels
+	void CreatePreloadedTexture(PRELOAD_TEXTURE& texture);
+	// free the textures of a preloaded scene that were not shared
+	void DiscardPreloadedScene();
+
+	// compose the model matrix from the transformation values
+	glm::mat4 BuildModelMatrix(
+		glm::vec3 scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		glm::vec3 positionXYZ);
 
 	// set the transformation values 
 	// into the transform buffer
@@ -95,6 +556,87 @@ private:
 	void SetShaderMaterial(
 		std::string materialTag);
 
+	// set the virtual texture into the shader
+	void SetShaderVirtualTexture(
+		std::string virtualTextureTag);
+
+	// compute the model matrix and world bounds of every scene object
+	void UpdateObjectTransforms();
+	void UpdateObjectTransform(int index);
+	// compute the world bounds of one scene object from its model matrix
+	void UpdateObjectBounds(SCENE_OBJECT& object);
+	// scatter the fish of a school through an ellipsoid and create its
+	// instance buffer, all heading roughly the same way
+	void AddFishSchool(
+		std::string tag,
+		glm::vec3 center,
+		glm::vec3 radii,
+		float heading,
+		int fishCount,
+		uint32_t seed);
+	// draw every fish school, with only the values depth needs when
+	// laying down the depth pre-pass
+	void DrawFishSchools(bool bDepthOnly);
+	// free the instances and flocking of every fish school
+	void ClearFishSchools();
+	// draw the lake around the camera, with only the values depth
+	// needs when laying down the depth pre-pass
+	void DrawLake(bool bDepthOnly);
+	// draw the chosen terrain nodes, with only the values depth needs
+	// when laying down the depth pre-pass
+	void DrawTerrain(bool bDepthOnly);
+	// draw the foliage left by the culling pass, with only the values
+	// depth needs when laying down the depth pre-pass
+	void DrawFoliage(bool bDepthOnly);
+	// draw the sky on the far plane behind everything else
+	void DrawSky();
+	// trace the reflections of the opaque scene drawn so far, missed
+	// rays seeing the sky or the ambient light
+	void ResolveReflections();
+	// draw the fishing lines as ribbons facing the camera, with only
+	// the values depth needs when laying down the depth pre-pass
+	void DrawFishingLines(bool bDepthOnly);
+	// add a rigid body around the first of the tagged scene objects,
+	// carrying the others along with it
+	void AddPhysicsProp(const std::vector<std::string>& tags, float mass);
+	// draw the thrown bobbers, with only the values depth needs when
+	// laying down the depth pre-pass
+	void DrawThrownBobbers(bool bDepthOnly);
+	// load the visibility sets of the objects from the cache or bake them
+	void BuildVisibilitySets(
+		const std::vector<SCENE_OBJECT>& objects,
+		PotentiallyVisibleSet& visibilitySets,
+		const std::string& cacheFile);
+	// set the shader values for the scene object and draw its mesh
+	void DrawSceneObject(const SCENE_OBJECT& object);
+	// draw the basic mesh of the passed in shape
+	void DrawShapeMesh(SHAPE_TYPE shape);
+	// collect the GPU time of a finished frame and report the average
+	void UpdateGPUFrameTime(int queryIndex);
+	// set the defined point lights into the shader light slots
+	void UploadPointLights();
+	void UploadPointLight(int slot);
+	// set the defined directional light into the shader
+	void UploadDirectionalLight();
+	// set every shader value that is not set again for each frame
+	void UploadSceneUniforms();
+	// apply the changed lines of the scene settings file
+	int ApplySceneSettings(bool bLiveEdit);
+	// find the scene values a setting line refers to
+	float* FindSceneSetting(const SCENE_SETTING& setting, int& valueCount, int& changeFlags, int& itemIndex);
+	// drop the visibility sets once objects moved while running
+	void DisableVisibilitySets();
+	// compile and swap in edited shaders, keeping the old ones on errors
+	bool ReloadShaders();
+	// load an edited texture image into its existing texture
+	bool ReloadTexture(const std::string& filename);
+	// find the point lights that reach each visible object
+	void AssignObjectLights();
+	// pick per-pixel or per-vertex lighting for each visible object
+	void SelectShadingTiers();
+	// find the virtual texture pages on screen and stream them in
+	void UpdateVirtualTextures();
+
 public:
 
 	// The following methods are for the students to 
@@ -110,4 +652,146 @@ public:
 
 	// Add and define the light sources before rendering.
 	void SetupSceneLights();
+
+	// Define the objects that make up the scene.
+	void DefineSceneObjects();
+
+	// Define the fish schools of the aquarium variant of the scene.
+	void DefineFishSchools();
+
+	// Define the waves of the lake around the table.
+	void DefineLake();
+
+	// Define the terrain around the lake.
+	void DefineTerrain();
+
+	// Define the grass and reeds growing on the terrain.
+	void DefineFoliage();
+
+	// Define the sky and the atmosphere lighting the scene.
+	void DefineSky();
+
+	// Define the reflections of the screen on the smooth surfaces.
+	void DefineReflections();
+
+	// Define the fishing line through the rod and the tackle shop display.
+	void DefineFishingLines();
+
+	// Define the rigid bodies of the tabletop props.
+	void DefineRigidBodies();
+
+	// Define the keyframed motion of the scene objects.
+	void DefineSceneAnimations();
+
+	// advance the animations and update the animated transforms
+	void UpdateAnimations();
+
+	// flock the fish schools and update their instances
+	void UpdateFishSchools();
+
+	// simulate the waves of the lake and upload them
+	void UpdateLake();
+
+	// choose the terrain nodes for the camera and stream their tiles
+	void UpdateTerrain();
+	// measure the motion of the camera and pass the views it is
+	// predicted to reach to the terrain
+	void PredictTerrainViews(float deltaSeconds);
+
+	// scatter the foliage of the tiles in range and cull it for the camera
+	void UpdateFoliage();
+
+	// fill the sky-view table again when the sun has moved
+	void UpdateSky();
+
+	// report the GPU time of the reflection passes
+	void UpdateReflections();
+
+	// pin the rod line to the eyelets, simulate the fishing lines and
+	// stream them to the GPU
+	void UpdateFishingLines();
+
+	// simulate the rigid bodies and move the props they carry
+	void UpdateRigidBodies();
+
+	// throw a bobber from the camera at the props
+	void ThrowBobber();
+
+	// set the camera position used for visibility culling
+	void SetCameraPosition(glm::vec3 position);
+
+	// set the camera view and projection used for shading level-of-detail
+	void SetViewProjection(glm::mat4 view, glm::mat4 projection);
+
+	// tint objects by whether they are lit per pixel or per vertex
+	void SetShadingTierDebug(bool bEnabled);
+
+	// lay down opaque depth first so every pixel is shaded once
+	void SetDepthPrepassEnabled(bool bEnabled);
+
+	// draw the fish schools of the aquarium variant of the scene
+	void SetAquariumEnabled(bool bEnabled);
+
+	// flock the fish schools in compute shaders instead of on the CPU
+	void SetBoidComputeEnabled(bool bEnabled);
+
+	// simulate and draw the lake around the table
+	void SetLakeEnabled(bool bEnabled);
+
+	// draw the terrain around the lake
+	void SetTerrainEnabled(bool bEnabled);
+
+	// load the terrain tiles along the predicted camera path ahead of time
+	void SetPrefetchEnabled(bool bEnabled);
+
+	// grow grass and reeds on the terrain
+	void SetFoliageEnabled(bool bEnabled);
+
+	// draw the sky and light the scene with the sun and sky colors of
+	// the atmosphere
+	void SetSkyEnabled(bool bEnabled);
+
+	// reflect the screen in the smooth surfaces of the scene
+	void SetReflectionsEnabled(bool bEnabled);
+
+	// trace the reflections with a linear march instead of the depth
+	// pyramid, to compare the two
+	void SetLinearMarchEnabled(bool bEnabled);
+
+	// hang the lines of the tackle shop display behind the table
+	void SetTackleDisplayEnabled(bool bEnabled);
+
+	// knock the tabletop props around as rigid bodies, putting them
+	// back in place when switched off
+	void SetPhysicsEnabled(bool bEnabled);
+
+	// start watching the shader, texture and scene settings files
+	void EnableHotReload(const char* vertexShaderFile, const char* fragmentShaderFile);
+	// reload whatever was edited since the last frame
+	void UpdateHotReload();
+
+	// start receiving scene edits from external tools
+	void EnableLiveEditing();
+
+	// create and fill the textures of preloaded scenes on a thread
+	// with a context shared with the passed in window
+	void EnableBackgroundUploads(GLFWwindow* pWindow);
+	// apply the scene edits received since the last frame
+	void UpdateLiveEdits();
+
+	// save the running scene state and camera as a snapshot image
+	void SaveSnapshot(const SNAPSHOT_CAMERA& camera);
+	// prepare the scene from the saved snapshot instead of PrepareScene(),
+	// returns false when there is no valid snapshot
+	bool RestoreScene(SNAPSHOT_CAMERA& camera);
+
+	// start loading the scene saved in a snapshot image in the background,
+	// replacing a scene preloaded earlier
+	bool PreloadScene(const char* snapshotFile);
+	// resume the background tasks waiting for the GL thread or for
+	// this frame, such as the scene preload
+	void UpdateTasks();
+	// swap the preloaded scene in for the current one, returns false
+	// while it is still loading
+	bool SwitchToPreloadedScene(SNAPSHOT_CAMERA& camera);
 };
\ No newline at end of file
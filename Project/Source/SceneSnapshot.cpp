@@ -0,0 +1,399 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenesnapshot.cpp
+// ============
+// save the running scene state as one binary image and map it back in
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneSnapshot.h"
+
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// declaration of global variables
+namespace
+{
+	// identifies a snapshot image and the layout of its records
+	const char SNAPSHOT_MAGIC[4] = { 'S', 'N', 'P', '1' };
+	const uint32_t SNAPSHOT_VERSION = 1;
+	// start of every section, so the records are aligned in the mapping
+	const size_t SNAPSHOT_ALIGNMENT = 16;
+
+	// place of one record array in the image
+	struct SNAPSHOT_SECTION
+	{
+		uint64_t offset;
+		uint32_t count;
+		uint32_t stride;
+	};
+
+	struct SNAPSHOT_HEADER
+	{
+		char magic[4];
+		uint32_t version;
+		uint64_t imageSize;
+		SNAPSHOT_SECTION objects;
+		SNAPSHOT_SECTION materials;
+		SNAPSHOT_SECTION pointLights;
+		SNAPSHOT_SECTION textures;
+		SNAPSHOT_SECTION strings;
+		SNAPSHOT_DIRECTIONAL_LIGHT directionalLight;
+		SNAPSHOT_CAMERA camera;
+	};
+
+	// the records handed from the render thread to the writing worker
+	struct SNAPSHOT_CONTENTS
+	{
+		std::string filename;
+		std::vector<SNAPSHOT_OBJECT> objects;
+		std::vector<SNAPSHOT_MATERIAL> materials;
+		std::vector<SNAPSHOT_POINT_LIGHT> pointLights;
+		std::vector<SNAPSHOT_TEXTURE> textures;
+		std::vector<char> strings;
+		SNAPSHOT_DIRECTIONAL_LIGHT directionalLight;
+		SNAPSHOT_CAMERA camera;
+	};
+
+	// round up to the section alignment
+	uint64_t AlignSection(uint64_t offset)
+	{
+		return((offset + SNAPSHOT_ALIGNMENT - 1) & ~static_cast<uint64_t>(SNAPSHOT_ALIGNMENT - 1));
+	}
+
+	// place a record array after the image written so far
+	template <typename T>
+	SNAPSHOT_SECTION PlaceSection(const std::vector<T>& records, uint64_t& imageSize)
+	{
+		SNAPSHOT_SECTION section;
+		section.offset = AlignSection(imageSize);
+		section.count = static_cast<uint32_t>(records.size());
+		section.stride = sizeof(T);
+		imageSize = section.offset + (static_cast<uint64_t>(section.count) * section.stride);
+		return(section);
+	}
+
+	// copy a record array to its place in the image
+	template <typename T>
+	void CopySection(const std::vector<T>& records, const SNAPSHOT_SECTION& section, std::vector<uint8_t>& image)
+	{
+		if (records.size() > 0)
+		{
+			memcpy(&image[section.offset], records.data(), records.size() * sizeof(T));
+		}
+	}
+
+	// resolve a record array of the mapped image, checking it lies inside
+	template <typename T>
+	bool ResolveSection(const uint8_t* pImage, size_t imageSize, const SNAPSHOT_SECTION& section, const T*& pRecords, int& count)
+	{
+		if ((section.stride != sizeof(T)) ||
+			((section.offset % SNAPSHOT_ALIGNMENT) != 0) ||
+			(section.offset > imageSize) ||
+			(static_cast<uint64_t>(section.count) * section.stride > imageSize - section.offset))
+		{
+			return(false);
+		}
+		pRecords = reinterpret_cast<const T*>(pImage + section.offset);
+		count = static_cast<int>(section.count);
+		return(true);
+	}
+
+	/***********************************************************
+	 *  WriteSnapshotImage()
+	 *
+	 *  Lay the records out behind the header and write the
+	 *  image next to the target file, then move it over the
+	 *  target, so a reader never maps a half written image.
+	 ***********************************************************/
+	void WriteSnapshotImage(const SNAPSHOT_CONTENTS& contents)
+	{
+		SNAPSHOT_HEADER header = {};
+		memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+		header.version = SNAPSHOT_VERSION;
+
+		uint64_t imageSize = sizeof(SNAPSHOT_HEADER);
+		header.objects = PlaceSection(contents.objects, imageSize);
+		header.materials = PlaceSection(contents.materials, imageSize);
+		header.pointLights = PlaceSection(contents.pointLights, imageSize);
+		header.textures = PlaceSection(contents.textures, imageSize);
+		header.strings = PlaceSection(contents.strings, imageSize);
+		header.imageSize = imageSize;
+		header.directionalLight = contents.directionalLight;
+		header.camera = contents.camera;
+
+		std::vector<uint8_t> image(imageSize, 0);
+		memcpy(image.data(), &header, sizeof(header));
+		CopySection(contents.objects, header.objects, image);
+		CopySection(contents.materials, header.materials, image);
+		CopySection(contents.pointLights, header.pointLights, image);
+		CopySection(contents.textures, header.textures, image);
+		CopySection(contents.strings, header.strings, image);
+
+		// every save writes its own temporary file, so two saves in
+		// flight at once never write into the same file
+		static std::atomic<int> saveCount(0);
+		std::string tempFile = contents.filename + "." + std::to_string(saveCount++) + ".tmp";
+		{
+			std::ofstream file(tempFile, std::ios::binary | std::ios::trunc);
+			file.write(reinterpret_cast<const char*>(image.data()), image.size());
+			if (!file)
+			{
+				std::cout << "Could not write scene snapshot:" << tempFile << std::endl;
+				return;
+			}
+		}
+
+		std::error_code error;
+		std::filesystem::rename(tempFile, contents.filename, error);
+		if (error)
+		{
+			std::cout << "Could not replace scene snapshot:" << contents.filename << std::endl;
+			std::filesystem::remove(tempFile, error);
+			return;
+		}
+
+		std::cout << "Saved scene snapshot:" << contents.filename << ", objects:"
+			<< contents.objects.size() << ", bytes:" << image.size() << std::endl;
+	}
+}
+
+/***********************************************************
+ *  SceneSnapshot()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneSnapshot::SceneSnapshot()
+{
+	m_directionalLight = SNAPSHOT_DIRECTIONAL_LIGHT();
+	m_camera = SNAPSHOT_CAMERA();
+
+	m_pImage = NULL;
+	m_imageSize = 0;
+	m_fileHandle = NULL;
+	m_mappingHandle = NULL;
+	m_pObjects = NULL;
+	m_objectCount = 0;
+	m_pMaterials = NULL;
+	m_materialCount = 0;
+	m_pPointLights = NULL;
+	m_pointLightCount = 0;
+	m_pTextures = NULL;
+	m_textureCount = 0;
+	m_pStrings = NULL;
+	m_stringPoolSize = 0;
+}
+
+/***********************************************************
+ *  ~SceneSnapshot()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SceneSnapshot::~SceneSnapshot()
+{
+	Close();
+}
+
+/***********************************************************
+ *  AddString()
+ *
+ *  This method is used for copying text into the string
+ *  pool of the image being built.
+ ***********************************************************/
+SNAPSHOT_STRING SceneSnapshot::AddString(const std::string& text)
+{
+	SNAPSHOT_STRING pooled;
+	pooled.offset = static_cast<uint32_t>(m_stringPool.size());
+	pooled.length = static_cast<uint32_t>(text.size());
+	m_stringPool.insert(m_stringPool.end(), text.begin(), text.end());
+	return(pooled);
+}
+
+/***********************************************************
+ *  WriteAsync()
+ *
+ *  This method is used for moving the built records into a
+ *  job, so the render thread only pays for collecting the
+ *  records while the layout and the file writing run on a
+ *  worker.  The builder is empty afterwards.
+ ***********************************************************/
+void SceneSnapshot::WriteAsync(const char* filename, JobSystem* pJobSystem)
+{
+	std::shared_ptr<SNAPSHOT_CONTENTS> contents = std::make_shared<SNAPSHOT_CONTENTS>();
+	contents->filename = filename;
+	contents->objects.swap(m_objects);
+	contents->materials.swap(m_materials);
+	contents->pointLights.swap(m_pointLights);
+	contents->textures.swap(m_textures);
+	contents->strings.swap(m_stringPool);
+	contents->directionalLight = m_directionalLight;
+	contents->camera = m_camera;
+
+	if (NULL != pJobSystem)
+	{
+		pJobSystem->Submit([contents]()
+			{
+				WriteSnapshotImage(*contents);
+			});
+	}
+	else
+	{
+		WriteSnapshotImage(*contents);
+	}
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method is used for mapping a written image into
+ *  memory and resolving the section offsets of its header
+ *  against the mapped address.  Every section is checked to
+ *  lie inside the file, and nothing else is read until the
+ *  records are used.
+ ***********************************************************/
+bool SceneSnapshot::Open(const char* filename)
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return(false);
+	}
+	LARGE_INTEGER fileSize;
+	HANDLE mapping = NULL;
+	if ((GetFileSizeEx(file, &fileSize) != 0) && (fileSize.QuadPart >= static_cast<LONGLONG>(sizeof(SNAPSHOT_HEADER))))
+	{
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	}
+	if (mapping == NULL)
+	{
+		CloseHandle(file);
+		return(false);
+	}
+	m_pImage = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	m_imageSize = static_cast<size_t>(fileSize.QuadPart);
+	m_fileHandle = file;
+	m_mappingHandle = mapping;
+#else
+	int file = open(filename, O_RDONLY);
+	if (file < 0)
+	{
+		return(false);
+	}
+	struct stat fileStatus;
+	if ((fstat(file, &fileStatus) != 0) || (fileStatus.st_size < static_cast<off_t>(sizeof(SNAPSHOT_HEADER))))
+	{
+		close(file);
+		return(false);
+	}
+	void* pMapped = mmap(NULL, fileStatus.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if (pMapped == MAP_FAILED)
+	{
+		return(false);
+	}
+	m_pImage = static_cast<const uint8_t*>(pMapped);
+	m_imageSize = static_cast<size_t>(fileStatus.st_size);
+#endif
+
+	if (NULL == m_pImage)
+	{
+		Close();
+		return(false);
+	}
+
+	const SNAPSHOT_HEADER* pHeader = reinterpret_cast<const SNAPSHOT_HEADER*>(m_pImage);
+	int stringCount = 0;
+	if ((memcmp(pHeader->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) ||
+		(pHeader->version != SNAPSHOT_VERSION) ||
+		(pHeader->imageSize != m_imageSize) ||
+		(ResolveSection(m_pImage, m_imageSize, pHeader->objects, m_pObjects, m_objectCount) == false) ||
+		(ResolveSection(m_pImage, m_imageSize, pHeader->materials, m_pMaterials, m_materialCount) == false) ||
+		(ResolveSection(m_pImage, m_imageSize, pHeader->pointLights, m_pPointLights, m_pointLightCount) == false) ||
+		(ResolveSection(m_pImage, m_imageSize, pHeader->textures, m_pTextures, m_textureCount) == false) ||
+		(ResolveSection(m_pImage, m_imageSize, pHeader->strings, m_pStrings, stringCount) == false))
+	{
+		std::cout << "Scene snapshot is damaged or from another version:" << filename << std::endl;
+		Close();
+		return(false);
+	}
+	m_stringPoolSize = static_cast<size_t>(stringCount);
+	m_directionalLight = pHeader->directionalLight;
+	m_camera = pHeader->camera;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method is used for unmapping the image.
+ ***********************************************************/
+void SceneSnapshot::Close()
+{
+#ifdef _WIN32
+	if (NULL != m_pImage)
+	{
+		UnmapViewOfFile(m_pImage);
+	}
+	if (NULL != m_mappingHandle)
+	{
+		CloseHandle(m_mappingHandle);
+	}
+	if (NULL != m_fileHandle)
+	{
+		CloseHandle(m_fileHandle);
+	}
+#else
+	if (NULL != m_pImage)
+	{
+		munmap(const_cast<uint8_t*>(m_pImage), m_imageSize);
+	}
+#endif
+
+	m_pImage = NULL;
+	m_imageSize = 0;
+	m_fileHandle = NULL;
+	m_mappingHandle = NULL;
+	m_pObjects = NULL;
+	m_objectCount = 0;
+	m_pMaterials = NULL;
+	m_materialCount = 0;
+	m_pPointLights = NULL;
+	m_pointLightCount = 0;
+	m_pTextures = NULL;
+	m_textureCount = 0;
+	m_pStrings = NULL;
+	m_stringPoolSize = 0;
+}
+
+/***********************************************************
+ *  GetString()
+ *
+ *  This method is used for getting text of the string pool
+ *  of the mapped image.
+ ***********************************************************/
+std::string SceneSnapshot::GetString(SNAPSHOT_STRING text) const
+{
+	if ((NULL == m_pStrings) ||
+		(text.offset > m_stringPoolSize) ||
+		(text.length > m_stringPoolSize - text.offset))
+	{
+		return(std::string());
+	}
+	return(std::string(m_pStrings + text.offset, text.length));
+}
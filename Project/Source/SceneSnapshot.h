@@ -0,0 +1,183 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenesnapshot.h
+// ============
+// save the running scene state as one binary image and map it back in
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "JobSystem.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// text stored in the string pool of the image, by offset into the pool
+struct SNAPSHOT_STRING
+{
+	uint32_t offset;
+	uint32_t length;
+};
+
+// records of the image, plain data only so they are written and
+// read as they lie in memory
+struct SNAPSHOT_OBJECT
+{
+	SNAPSHOT_STRING tag;
+	SNAPSHOT_STRING textureTag;
+	SNAPSHOT_STRING virtualTextureTag;
+	SNAPSHOT_STRING materialTag;
+	int32_t shape;
+	int32_t bOccluder;
+	glm::vec3 scaleXYZ;
+	glm::vec3 rotationDegrees;
+	glm::vec3 positionXYZ;
+	glm::vec4 color;
+	glm::vec2 UVscale;
+	glm::mat4 modelMatrix;
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+};
+
+struct SNAPSHOT_MATERIAL
+{
+	SNAPSHOT_STRING tag;
+	glm::vec3 diffuseColor;
+	glm::vec3 specularColor;
+	float shininess;
+	int32_t proceduralType;
+	glm::vec3 proceduralColorA;
+	glm::vec3 proceduralColorB;
+	glm::vec4 proceduralParams;
+	int32_t bakeResolution;
+};
+
+struct SNAPSHOT_POINT_LIGHT
+{
+	SNAPSHOT_STRING tag;
+	glm::vec3 position;
+	glm::vec3 ambient;
+	glm::vec3 diffuse;
+	glm::vec3 specular;
+	float constant;
+	float linear;
+	float quadratic;
+	int32_t bActive;
+};
+
+struct SNAPSHOT_DIRECTIONAL_LIGHT
+{
+	glm::vec3 direction;
+	glm::vec3 ambient;
+	glm::vec3 diffuse;
+	glm::vec3 specular;
+	int32_t bActive;
+};
+
+// image file a texture is loaded from, and how it is loaded
+struct SNAPSHOT_TEXTURE
+{
+	SNAPSHOT_STRING filename;
+	SNAPSHOT_STRING tag;
+	int32_t type;
+};
+
+struct SNAPSHOT_CAMERA
+{
+	glm::vec3 position;
+	glm::vec3 front;
+	glm::vec3 up;
+	float yaw;
+	float pitch;
+	float zoom;
+	float movementSpeed;
+	int32_t bOrthographic;
+};
+
+/***********************************************************
+ *  SceneSnapshot
+ *
+ *  This class lays scene records out into one position
+ *  independent image - a header, one array per record type
+ *  and a string pool, all found by offsets from the start -
+ *  and writes it on a worker thread.  Reading maps the file
+ *  into memory and resolves the offsets against the mapped
+ *  address, so the records are read in place without being
+ *  parsed; the scene then copies them into its own lists
+ *  once while restoring.
+ ***********************************************************/
+class SceneSnapshot
+{
+public:
+	// constructor
+	SceneSnapshot();
+	// destructor
+	~SceneSnapshot();
+
+	// copy text into the string pool of the image being built
+	SNAPSHOT_STRING AddString(const std::string& text);
+	// add records to the image being built
+	void AddObject(const SNAPSHOT_OBJECT& object) { m_objects.push_back(object); }
+	void AddMaterial(const SNAPSHOT_MATERIAL& material) { m_materials.push_back(material); }
+	void AddPointLight(const SNAPSHOT_POINT_LIGHT& light) { m_pointLights.push_back(light); }
+	void AddTexture(const SNAPSHOT_TEXTURE& texture) { m_textures.push_back(texture); }
+	void SetDirectionalLight(const SNAPSHOT_DIRECTIONAL_LIGHT& light) { m_directionalLight = light; }
+	void SetCamera(const SNAPSHOT_CAMERA& camera) { m_camera = camera; }
+	// hand the built records to a worker, which lays out the image
+	// and replaces the file with it once completely written
+	void WriteAsync(const char* filename, JobSystem* pJobSystem);
+
+	// map a written image, returns false when it is missing or invalid
+	bool Open(const char* filename);
+	// unmap the image
+	void Close();
+
+	// get the records of the mapped image
+	int GetObjectCount() const { return(m_objectCount); }
+	const SNAPSHOT_OBJECT& GetSceneObject(int index) const { return(m_pObjects[index]); }
+	int GetMaterialCount() const { return(m_materialCount); }
+	const SNAPSHOT_MATERIAL& GetMaterial(int index) const { return(m_pMaterials[index]); }
+	int GetPointLightCount() const { return(m_pointLightCount); }
+	const SNAPSHOT_POINT_LIGHT& GetPointLight(int index) const { return(m_pPointLights[index]); }
+	int GetTextureCount() const { return(m_textureCount); }
+	const SNAPSHOT_TEXTURE& GetTexture(int index) const { return(m_pTextures[index]); }
+	const SNAPSHOT_DIRECTIONAL_LIGHT& GetDirectionalLight() const { return(m_directionalLight); }
+	const SNAPSHOT_CAMERA& GetCamera() const { return(m_camera); }
+	// get text of the string pool, empty when out of range
+	std::string GetString(SNAPSHOT_STRING text) const;
+
+private:
+	// records being built for writing
+	std::vector<SNAPSHOT_OBJECT> m_objects;
+	std::vector<SNAPSHOT_MATERIAL> m_materials;
+	std::vector<SNAPSHOT_POINT_LIGHT> m_pointLights;
+	std::vector<SNAPSHOT_TEXTURE> m_textures;
+	std::vector<char> m_stringPool;
+	SNAPSHOT_DIRECTIONAL_LIGHT m_directionalLight;
+	SNAPSHOT_CAMERA m_camera;
+
+	// mapped image and its records resolved from the offsets
+	const uint8_t* m_pImage;
+	size_t m_imageSize;
+	void* m_fileHandle;
+	void* m_mappingHandle;
+	const SNAPSHOT_OBJECT* m_pObjects;
+	int m_objectCount;
+	const SNAPSHOT_MATERIAL* m_pMaterials;
+	int m_materialCount;
+	const SNAPSHOT_POINT_LIGHT* m_pPointLights;
+	int m_pointLightCount;
+	const SNAPSHOT_TEXTURE* m_pTextures;
+	int m_textureCount;
+	const char* m_pStrings;
+	size_t m_stringPoolSize;
+};
+
+static_assert(std::is_trivially_copyable<SNAPSHOT_OBJECT>::value, "snapshot records must be plain data");
+static_assert(std::is_trivially_copyable<SNAPSHOT_MATERIAL>::value, "snapshot records must be plain data");
+static_assert(std::is_trivially_copyable<SNAPSHOT_POINT_LIGHT>::value, "snapshot records must be plain data");
+static_assert(std::is_trivially_copyable<SNAPSHOT_CAMERA>::value, "snapshot records must be plain data");
@@ -0,0 +1,445 @@
+///////////////////////////////////////////////////////////////////////////////
+// screenspacereflections.cpp
+// ============
+// trace reflections of the rendered scene through a hierarchical depth buffer
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ScreenSpaceReflections.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// passes of the compute program, selected by reflectionPass
+	const int REFLECTION_PASS_FIRST_LEVEL = 0;
+	const int REFLECTION_PASS_NEXT_LEVEL = 1;
+	const int REFLECTION_PASS_TRACE = 2;
+	const int REFLECTION_PASS_COMPOSITE = 3;
+	// invocations along each side of a work group, the local size of
+	// the program
+	const int REFLECTION_COMPUTE_GROUP_SIZE = 8;
+
+	// texture units after the first, in the order the passes read them
+	const int REFLECTION_COLOR_UNIT = 0;
+	const int REFLECTION_DEPTH_UNIT = 1;
+	const int REFLECTION_SURFACE_UNIT = 2;
+	const int REFLECTION_HI_Z_UNIT = 3;
+	const int REFLECTION_HISTORY_UNIT = 4;
+
+	// value of the surface target where nothing reflects
+	const GLfloat NO_SURFACE[4] = { 0.0f, 0.0f, 1.0f, 0.0f };
+
+	/***********************************************************
+	 *  GroupCount()
+	 *
+	 *  Work groups covering a number of invocations.
+	 ***********************************************************/
+	GLuint GroupCount(int invocations)
+	{
+		return(static_cast<GLuint>((invocations + REFLECTION_COMPUTE_GROUP_SIZE - 1) / REFLECTION_COMPUTE_GROUP_SIZE));
+	}
+}
+
+/***********************************************************
+ *  ScreenSpaceReflections()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ScreenSpaceReflections::ScreenSpaceReflections()
+{
+	m_computeProgram = 0;
+	m_firstUnit = 0;
+	m_framebuffer = 0;
+	m_colorTexture = 0;
+	m_surfaceTexture = 0;
+	m_depthTexture = 0;
+	m_width = 0;
+	m_height = 0;
+	m_hiZTexture = 0;
+	m_hiZLevelCount = 0;
+	m_reflectionTextures[0] = 0;
+	m_reflectionTextures[1] = 0;
+	m_traceWidth = 0;
+	m_traceHeight = 0;
+	m_frameIndex = 0;
+	m_previousViewProjection = glm::mat4(1.0f);
+	m_bHistory = false;
+	for (int i = 0; i < 4; i++)
+	{
+		m_timerQueries[i] = 0;
+	}
+	m_timedFrames = 0;
+	m_lastPassTime = 0.0;
+	m_bPassTime = false;
+}
+
+/***********************************************************
+ *  ~ScreenSpaceReflections()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ScreenSpaceReflections::~ScreenSpaceReflections()
+{
+	Release();
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for keeping the settings and the
+ *  compute program.  The framebuffer and the textures are
+ *  made by the first frame, once the screen size is known.
+ ***********************************************************/
+bool ScreenSpaceReflections::Initialize(const REFLECTION_SETTINGS& settings, GLuint computeProgram, int firstUnit)
+{
+	Release();
+
+	if ((computeProgram == 0) || (settings.maxIterations < 1) || (settings.linearSteps < 1))
+	{
+		std::cout << "Screen-space reflections need their compute program" << std::endl;
+		return(false);
+	}
+
+	m_settings = settings;
+	m_computeProgram = computeProgram;
+	m_firstUnit = firstUnit;
+	glGenQueries(4, m_timerQueries);
+	m_timedFrames = 0;
+	m_bPassTime = false;
+	return(true);
+}
+
+/***********************************************************
+ *  Release()
+ *
+ *  This method is used for freeing the framebuffer, the
+ *  textures and the timer queries.
+ ***********************************************************/
+void ScreenSpaceReflections::Release()
+{
+	ReleaseTargets();
+	if (m_timerQueries[0] != 0)
+	{
+		glDeleteQueries(4, m_timerQueries);
+		for (int i = 0; i < 4; i++)
+		{
+			m_timerQueries[i] = 0;
+		}
+	}
+	m_computeProgram = 0;
+}
+
+/***********************************************************
+ *  CreateTargets()
+ *
+ *  This method is used for making the framebuffer the scene
+ *  is drawn into for a screen size, with its color, surface
+ *  and depth textures, and the depth pyramid and the two
+ *  reflection textures at half that size.
+ ***********************************************************/
+bool ScreenSpaceReflections::CreateTargets(int width, int height)
+{
+	ReleaseTargets();
+
+	m_width = width;
+	m_height = height;
+	m_traceWidth = std::max(width / 2, 1);
+	m_traceHeight = std::max(height / 2, 1);
+	m_hiZLevelCount = static_cast<int>(std::floor(std::log2(static_cast<float>(std::max(m_traceWidth, m_traceHeight))))) + 1;
+
+	GLuint* targets[3] = { &m_colorTexture, &m_surfaceTexture, &m_depthTexture };
+	GLenum formats[3] = { GL_RGBA8, GL_RGBA16F, GL_DEPTH_COMPONENT24 };
+	for (int i = 0; i < 3; i++)
+	{
+		glGenTextures(1, targets[i]);
+		glBindTexture(GL_TEXTURE_2D, *targets[i]);
+		glTexStorage2D(GL_TEXTURE_2D, 1, formats[i], width, height);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (i == 0) ? GL_LINEAR : GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, (i == 0) ? GL_LINEAR : GL_NEAREST);
+	}
+
+	glGenTextures(1, &m_hiZTexture);
+	glBindTexture(GL_TEXTURE_2D, m_hiZTexture);
+	glTexStorage2D(GL_TEXTURE_2D, m_hiZLevelCount, GL_R32F, m_traceWidth, m_traceHeight);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	glGenTextures(2, m_reflectionTextures);
+	for (int i = 0; i < 2; i++)
+	{
+		glBindTexture(GL_TEXTURE_2D, m_reflectionTextures[i]);
+		glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA16F, m_traceWidth, m_traceHeight);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenFramebuffers(1, &m_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_colorTexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, m_surfaceTexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_depthTexture, 0);
+	GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glDrawBuffers(2, drawBuffers);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Reflection framebuffer is incomplete:" << status << std::endl;
+		ReleaseTargets();
+		return(false);
+	}
+
+	// the reflections of the frames before the resize are gone
+	m_bHistory = false;
+	return(true);
+}
+
+/***********************************************************
+ *  ReleaseTargets()
+ *
+ *  This method is used for freeing the framebuffer and the
+ *  textures.
+ ***********************************************************/
+void ScreenSpaceReflections::ReleaseTargets()
+{
+	if (m_framebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_framebuffer);
+		m_framebuffer = 0;
+	}
+
+	GLuint textures[6] = { m_colorTexture, m_surfaceTexture, m_depthTexture, m_hiZTexture, m_reflectionTextures[0], m_reflectionTextures[1] };
+	for (int i = 0; i < 6; i++)
+	{
+		if (textures[i] != 0)
+		{
+			glDeleteTextures(1, &textures[i]);
+		}
+	}
+	m_colorTexture = 0;
+	m_surfaceTexture = 0;
+	m_depthTexture = 0;
+	m_hiZTexture = 0;
+	m_reflectionTextures[0] = 0;
+	m_reflectionTextures[1] = 0;
+	m_width = 0;
+	m_height = 0;
+	m_bHistory = false;
+}
+
+/***********************************************************
+ *  Begin()
+ *
+ *  This method is used for drawing the scene into the
+ *  framebuffer from here on, made again when the screen was
+ *  resized, and clearing it with the clear color of the
+ *  window and the surface target to no reflection.
+ ***********************************************************/
+bool ScreenSpaceReflections::Begin(int width, int height)
+{
+	if ((IsReady() == false) || (width <= 0) || (height <= 0))
+	{
+		return(false);
+	}
+	if (((width != m_width) || (height != m_height) || (m_framebuffer == 0)) &&
+		(CreateTargets(width, height) == false))
+	{
+		return(false);
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	glClearBufferfv(GL_COLOR, 1, NO_SURFACE);
+	return(true);
+}
+
+/***********************************************************
+ *  Resolve()
+ *
+ *  This method is used for running the passes over the
+ *  scene drawn so far - building the depth pyramid level by
+ *  level, tracing and accumulating the reflections at half
+ *  resolution and blending them into the scene color.  The
+ *  passes are timed with timestamps, read back two frames
+ *  later so the GPU is never waited on.
+ ***********************************************************/
+void ScreenSpaceReflections::Resolve(
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	bool bLinearMarch,
+	const AtmosphereSky* pSky,
+	glm::vec3 ambientColor)
+{
+	if ((IsReady() == false) || (m_framebuffer == 0))
+	{
+		return;
+	}
+
+	// the timestamps issued two frames ago have finished by now
+	int queryIndex = (m_timedFrames & 1) * 2;
+	if (m_timedFrames >= 2)
+	{
+		GLuint available = 0;
+		glGetQueryObjectuiv(m_timerQueries[queryIndex + 1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available != 0)
+		{
+			GLuint64 startTime = 0;
+			GLuint64 endTime = 0;
+			glGetQueryObjectui64v(m_timerQueries[queryIndex], GL_QUERY_RESULT, &startTime);
+			glGetQueryObjectui64v(m_timerQueries[queryIndex + 1], GL_QUERY_RESULT, &endTime);
+			m_lastPassTime = static_cast<double>(endTime - startTime) / 1000000.0;
+			m_bPassTime = true;
+		}
+	}
+	glQueryCounter(m_timerQueries[queryIndex], GL_TIMESTAMP);
+
+	GLint oldProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &oldProgram);
+	glUseProgram(m_computeProgram);
+	SetComputeUniforms(view, projection, bLinearMarch, pSky, ambientColor);
+
+	GLuint current = m_reflectionTextures[m_frameIndex & 1];
+	GLuint previous = m_reflectionTextures[(m_frameIndex + 1) & 1];
+	GLuint units[5] = { m_colorTexture, m_depthTexture, m_surfaceTexture, m_hiZTexture, previous };
+	for (int i = 0; i < 5; i++)
+	{
+		glActiveTexture(GL_TEXTURE0 + m_firstUnit + i);
+		glBindTexture(GL_TEXTURE_2D, units[i]);
+	}
+
+	// the nearest depths, from the scene depth and then level by level
+	glUniform1i(glGetUniformLocation(m_computeProgram, "reflectionPass"), REFLECTION_PASS_FIRST_LEVEL);
+	glBindImageTexture(0, m_hiZTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+	glDispatchCompute(GroupCount(m_traceWidth), GroupCount(m_traceHeight), 1);
+	glUniform1i(glGetUniformLocation(m_computeProgram, "reflectionPass"), REFLECTION_PASS_NEXT_LEVEL);
+	for (int level = 1; level < m_hiZLevelCount; level++)
+	{
+		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+		glBindImageTexture(0, m_hiZTexture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+		glBindImageTexture(1, m_hiZTexture, level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+		glDispatchCompute(GroupCount(std::max(m_traceWidth >> level, 1)), GroupCount(std::max(m_traceHeight >> level, 1)), 1);
+	}
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+	glUniform1i(glGetUniformLocation(m_computeProgram, "reflectionPass"), REFLECTION_PASS_TRACE);
+	glBindImageTexture(2, current, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+	glDispatchCompute(GroupCount(m_traceWidth), GroupCount(m_traceHeight), 1);
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+	// blend the reflections of this frame into the scene color
+	glActiveTexture(GL_TEXTURE0 + m_firstUnit + REFLECTION_HISTORY_UNIT);
+	glBindTexture(GL_TEXTURE_2D, current);
+	glUniform1i(glGetUniformLocation(m_computeProgram, "reflectionPass"), REFLECTION_PASS_COMPOSITE);
+	glBindImageTexture(3, m_colorTexture, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA8);
+	glDispatchCompute(GroupCount(m_width), GroupCount(m_height), 1);
+	glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+	glUseProgram(oldProgram);
+
+	glQueryCounter(m_timerQueries[queryIndex + 1], GL_TIMESTAMP);
+	m_timedFrames++;
+
+	m_previousViewProjection = projection * view;
+	m_bHistory = true;
+	m_frameIndex++;
+}
+
+/***********************************************************
+ *  End()
+ *
+ *  This method is used for copying the scene color to the
+ *  window and drawing there again.
+ ***********************************************************/
+void ScreenSpaceReflections::End()
+{
+	if (m_framebuffer == 0)
+	{
+		return;
+	}
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(0, 0, m_width, m_height, 0, 0, m_width, m_height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+/***********************************************************
+ *  ReadPassTime()
+ *
+ *  This method is used for getting the GPU time of the
+ *  passes of the last frame read back, once.
+ ***********************************************************/
+bool ScreenSpaceReflections::ReadPassTime(double& milliseconds)
+{
+	if (m_bPassTime == false)
+	{
+		return(false);
+	}
+
+	milliseconds = m_lastPassTime;
+	m_bPassTime = false;
+	return(true);
+}
+
+/***********************************************************
+ *  SetComputeUniforms()
+ *
+ *  This method is used for passing the view, the settings
+ *  and what a missed ray sees to the compute program.
+ ***********************************************************/
+void ScreenSpaceReflections::SetComputeUniforms(
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	bool bLinearMarch,
+	const AtmosphereSky* pSky,
+	glm::vec3 ambientColor)
+{
+	glm::mat4 inverseView = glm::inverse(view);
+	glm::mat4 inverseProjection = glm::inverse(projection);
+	glUniformMatrix4fv(glGetUniformLocation(m_computeProgram, "view"), 1, GL_FALSE, &view[0][0]);
+	glUniformMatrix4fv(glGetUniformLocation(m_computeProgram, "projection"), 1, GL_FALSE, &projection[0][0]);
+	glUniformMatrix4fv(glGetUniformLocation(m_computeProgram, "inverseView"), 1, GL_FALSE, &inverseView[0][0]);
+	glUniformMatrix4fv(glGetUniformLocation(m_computeProgram, "inverseProjection"), 1, GL_FALSE, &inverseProjection[0][0]);
+	glUniformMatrix4fv(glGetUniformLocation(m_computeProgram, "previousViewProjection"), 1, GL_FALSE, &m_previousViewProjection[0][0]);
+
+	glUniform1i(glGetUniformLocation(m_computeProgram, "sceneColor"), m_firstUnit + REFLECTION_COLOR_UNIT);
+	glUniform1i(glGetUniformLocation(m_computeProgram, "sceneDepth"), m_firstUnit + REFLECTION_DEPTH_UNIT);
+	glUniform1i(glGetUniformLocation(m_computeProgram, "sceneSurface"), m_firstUnit + REFLECTION_SURFACE_UNIT);
+	glUniform1i(glGetUniformLocation(m_computeProgram, "hiZTexture"), m_firstUnit + REFLECTION_HI_Z_UNIT);
+	glUniform1i(glGetUniformLocation(m_computeProgram, "reflectionTexture"), m_firstUnit + REFLECTION_HISTORY_UNIT);
+
+	glUniform1i(glGetUniformLocation(m_computeProgram, "hiZLevelCount"), m_hiZLevelCount);
+	glUniform1i(glGetUniformLocation(m_computeProgram, "bLinearMarch"), bLinearMarch);
+	glUniform1i(glGetUniformLocation(m_computeProgram, "maxIterations"), m_settings.maxIterations);
+	glUniform1i(glGetUniformLocation(m_computeProgram, "linearSteps"), m_settings.linearSteps);
+	glUniform1f(glGetUniformLocation(m_computeProgram, "maxDistance"), m_settings.maxDistance);
+	glUniform1f(glGetUniformLocation(m_computeProgram, "thickness"), m_settings.thickness);
+	glUniform1f(glGetUniformLocation(m_computeProgram, "maxRoughness"), m_settings.maxRoughness);
+	glUniform1f(glGetUniformLocation(m_computeProgram, "facingReflectance"), m_settings.facingReflectance);
+	glUniform1f(glGetUniformLocation(m_computeProgram, "historyWeight"), m_settings.historyWeight);
+	glUniform1i(glGetUniformLocation(m_computeProgram, "bHistory"), m_bHistory);
+	glUniform1ui(glGetUniformLocation(m_computeProgram, "frameIndex"), m_frameIndex);
+
+	bool bSkyProbe = (NULL != pSky) && (pSky->IsReady());
+	glUniform1i(glGetUniformLocation(m_computeProgram, "bSkyProbe"), bSkyProbe);
+	glUniform3fv(glGetUniformLocation(m_computeProgram, "probeColor"), 1, &ambientColor[0]);
+	if (bSkyProbe)
+	{
+		glm::vec3 sunDirection = pSky->GetSunDirection();
+		pSky->Bind();
+		glUniform1i(glGetUniformLocation(m_computeProgram, "skyViewTable"), pSky->GetSkyViewUnit());
+		glUniform3fv(glGetUniformLocation(m_computeProgram, "skySunDirection"), 1, &sunDirection[0]);
+		glUniform1f(glGetUniformLocation(m_computeProgram, "skyViewHeight"), pSky->GetViewHeight());
+		glUniform1f(glGetUniformLocation(m_computeProgram, "skyGroundRadius"), pSky->GetSettings().groundRadius);
+		glUniform1f(glGetUniformLocation(m_computeProgram, "skyExposure"), pSky->GetSettings().skyExposure);
+	}
+}
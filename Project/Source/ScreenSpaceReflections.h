@@ -0,0 +1,140 @@
+///////////////////////////////////////////////////////////////////////////////
+// screenspacereflections.h
+// ============
+// trace reflections of the rendered scene through a hierarchical depth buffer
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "AtmosphereSky.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+// which surfaces reflect and how far and how carefully their rays are
+// traced, in world units (meters)
+struct REFLECTION_SETTINGS
+{
+	// roughest surface that still reflects, fading out from half of it
+	float maxRoughness = 0.35f;
+	// reflectance of a surface facing the viewer, rising to one at
+	// grazing angles, scaled by the specular strength of the material
+	float facingReflectance = 0.2f;
+	// farthest a ray is traced, and how far behind the nearest depth a
+	// ray may pass and still hit it
+	float maxDistance = 60.0f;
+	float thickness = 0.3f;
+	// most steps of the depth pyramid trace, and of the linear march it
+	// is compared against
+	int maxIterations = 64;
+	int linearSteps = 256;
+	// weight of the reprojected reflections of earlier frames
+	float historyWeight = 0.9f;
+};
+
+/***********************************************************
+ *  ScreenSpaceReflections
+ *
+ *  This class adds reflections of what is on screen to the
+ *  smooth surfaces of the scene.  The scene is drawn into
+ *  its own framebuffer, which also keeps the normal, the
+ *  roughness and the specular strength of every pixel.  A
+ *  compute program then builds a pyramid of the nearest
+ *  depths at half the screen resolution and traces one
+ *  reflected ray for every pixel at that resolution through
+ *  it, crossing open space a whole cell of a coarse level
+ *  at a time.  Rough surfaces spread their rays differently
+ *  every frame and the reflections reprojected from the
+ *  last frame are blended in, so a few frames average into
+ *  a glossy reflection.  A ray that misses sees the sky, or
+ *  the ambient light without one.  The reflections are
+ *  blended into the scene color and the framebuffer copied
+ *  to the window.  A linear march of the same rays can be
+ *  switched in to compare the GPU time of the two traces.
+ ***********************************************************/
+class ScreenSpaceReflections
+{
+public:
+	// constructor
+	ScreenSpaceReflections();
+	// destructor
+	~ScreenSpaceReflections();
+
+	// keep the settings and the compute program, and the first of the
+	// five texture units the passes read from
+	bool Initialize(const REFLECTION_SETTINGS& settings, GLuint computeProgram, int firstUnit);
+	// free the framebuffer, the textures and the timer queries
+	void Release();
+
+	// draw the scene into the framebuffer from here on, made for the
+	// passed in size when it changed, and cleared
+	bool Begin(int width, int height);
+	// trace the reflections of the opaque scene drawn so far and blend
+	// them in, seeing the sky when one is passed in and the ambient
+	// color otherwise
+	void Resolve(
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		bool bLinearMarch,
+		const AtmosphereSky* pSky,
+		glm::vec3 ambientColor);
+	// copy the scene to the window and draw there again
+	void End();
+
+	// true once the compute program was set
+	bool IsReady() const { return(m_computeProgram != 0); }
+	const REFLECTION_SETTINGS& GetSettings() const { return(m_settings); }
+	// get the size the reflections are traced at
+	int GetTraceWidth() const { return(m_traceWidth); }
+	int GetTraceHeight() const { return(m_traceHeight); }
+	// get the GPU time of the passes of a finished frame, returning
+	// false when no new time is available
+	bool ReadPassTime(double& milliseconds);
+
+private:
+	REFLECTION_SETTINGS m_settings;
+	GLuint m_computeProgram;
+	int m_firstUnit;
+
+	// scene color, surface and depth the scene is drawn into
+	GLuint m_framebuffer;
+	GLuint m_colorTexture;
+	GLuint m_surfaceTexture;
+	GLuint m_depthTexture;
+	int m_width;
+	int m_height;
+
+	// nearest depths at half resolution and every level above, and the
+	// reflections of this frame and the last, swapped every frame
+	GLuint m_hiZTexture;
+	int m_hiZLevelCount;
+	GLuint m_reflectionTextures[2];
+	int m_traceWidth;
+	int m_traceHeight;
+
+	// frames resolved, the view projection of the last one and whether
+	// its reflections can be reprojected
+	unsigned int m_frameIndex;
+	glm::mat4 m_previousViewProjection;
+	bool m_bHistory;
+
+	// timestamps around the passes of the last two frames, read back
+	// two frames later
+	GLuint m_timerQueries[4];
+	int m_timedFrames;
+	// GPU time of the last frame read back, until it is taken
+	double m_lastPassTime;
+	bool m_bPassTime;
+
+	// create the framebuffer and the textures for a screen size
+	bool CreateTargets(int width, int height);
+	// free the framebuffer and the textures
+	void ReleaseTargets();
+	// set the uniforms of the compute program shared by the passes
+	void SetComputeUniforms(
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		bool bLinearMarch,
+		const AtmosphereSky* pSky,
+		glm::vec3 ambientColor);
+};
@@ -0,0 +1,325 @@
+///////////////////////////////////////////////////////////////////////////////
+// taskscheduler.cpp
+// ============
+// write work spanning frames and threads as coroutines
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <iostream>
+
+/***********************************************************
+ *  ~Task()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+Task::~Task()
+{
+	// a task that was awaited is done by now, and one that was
+	// started belongs to the scheduler
+	if (m_handle)
+	{
+		m_handle.destroy();
+	}
+}
+
+/***********************************************************
+ *  await_suspend()
+ *
+ *  This method is used for running the task in place of the
+ *  awaiting one, which continues once the task finishes.
+ ***********************************************************/
+std::coroutine_handle<> Task::await_suspend(HANDLE parent) noexcept
+{
+	m_handle.promise().parent = parent;
+	return(m_handle);
+}
+
+/***********************************************************
+ *  Release()
+ *
+ *  This method is used for giving up the coroutine of the
+ *  task without freeing it.
+ ***********************************************************/
+Task::HANDLE Task::Release()
+{
+	HANDLE handle = m_handle;
+	m_handle = HANDLE();
+	return(handle);
+}
+
+/***********************************************************
+ *  FindRoot()
+ *
+ *  This method is used for following the awaiting tasks up
+ *  to the one that was started, whose frame owns the frames
+ *  of all the tasks it waits on.
+ ***********************************************************/
+Task::HANDLE Task::FindRoot(HANDLE handle)
+{
+	while (handle.promise().parent)
+	{
+		handle = handle.promise().parent;
+	}
+	return(handle);
+}
+
+/***********************************************************
+ *  unhandled_exception()
+ *
+ *  This method is used for stopping the program when a task
+ *  throws, since there is nobody left to catch it.
+ ***********************************************************/
+void Task::promise_type::unhandled_exception() const
+{
+	std::cout << "Unhandled exception in a task" << std::endl;
+	std::terminate();
+}
+
+/***********************************************************
+ *  await_suspend()
+ *
+ *  This method is used for continuing the awaiting task
+ *  once a task finishes, or freeing the finished task when
+ *  it was started on its own.
+ ***********************************************************/
+std::coroutine_handle<> Task::FINAL_AWAITER::await_suspend(HANDLE handle) noexcept
+{
+	promise_type& promise = handle.promise();
+	if (promise.parent)
+	{
+		return(promise.parent);
+	}
+
+	TaskScheduler* pScheduler = promise.pScheduler;
+	handle.destroy();
+	if (NULL != pScheduler)
+	{
+		pScheduler->m_runningCount--;
+	}
+	return(std::noop_coroutine());
+}
+
+/***********************************************************
+ *  await_suspend()
+ *
+ *  This method is used for handing the task to a worker.
+ *  It goes to the background queue, which the GL thread
+ *  never takes jobs from while it waits on a parallel loop.
+ ***********************************************************/
+void TaskScheduler::WORKER_AWAITER::await_suspend(Task::HANDLE handle) const
+{
+	pScheduler->m_pJobSystem->Submit([handle] { handle.resume(); });
+}
+
+/***********************************************************
+ *  await_suspend()
+ *
+ *  This method is used for queueing the task for the GL
+ *  thread.
+ ***********************************************************/
+void TaskScheduler::MAIN_THREAD_AWAITER::await_suspend(Task::HANDLE handle) const
+{
+	pScheduler->QueueMainThread(handle);
+}
+
+/***********************************************************
+ *  await_suspend()
+ *
+ *  This method is used for queueing the task for the next
+ *  frame.
+ ***********************************************************/
+void TaskScheduler::NEXT_FRAME_AWAITER::await_suspend(Task::HANDLE handle) const
+{
+	std::lock_guard<std::mutex> lock(pScheduler->m_queueMutex);
+	pScheduler->m_nextFrameTasks.push_back(handle);
+}
+
+/***********************************************************
+ *  await_suspend()
+ *
+ *  This method is used for queueing the task until the
+ *  fence has passed.
+ ***********************************************************/
+void TaskScheduler::FENCE_AWAITER::await_suspend(Task::HANDLE handle)
+{
+	std::lock_guard<std::mutex> lock(pScheduler->m_queueMutex);
+	pScheduler->m_fenceWaits.push_back(FENCE_WAIT{ fence, this, handle });
+}
+
+/***********************************************************
+ *  await_suspend()
+ *
+ *  This method is used for reading the file on a worker,
+ *  which then continues the task, or reading it right away
+ *  without a job system.
+ ***********************************************************/
+bool TaskScheduler::FILE_READ_AWAITER::await_suspend(Task::HANDLE handle)
+{
+	auto read = [this]()
+	{
+		bRead = false;
+		pContents->clear();
+
+		std::ifstream file(filename, std::ios::binary | std::ios::ate);
+		if (file.is_open())
+		{
+			std::streamsize size = file.tellg();
+			file.seekg(0, std::ios::beg);
+			if (size >= 0)
+			{
+				pContents->resize(static_cast<size_t>(size));
+				bRead = (size == 0) || file.read(reinterpret_cast<char*>(pContents->data()), size).good();
+			}
+		}
+	};
+
+	if (NULL == pScheduler->m_pJobSystem)
+	{
+		read();
+		return(false);
+	}
+
+	pScheduler->m_pJobSystem->Submit([read, handle] { read(); handle.resume(); });
+	return(true);
+}
+
+/***********************************************************
+ *  TaskScheduler()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TaskScheduler::TaskScheduler(JobSystem* pJobSystem)
+{
+	m_pJobSystem = pJobSystem;
+	m_mainThreadId = std::this_thread::get_id();
+	m_runningCount = 0;
+	m_frame = 0;
+	m_bUpdating = false;
+}
+
+/***********************************************************
+ *  ~TaskScheduler()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TaskScheduler::~TaskScheduler()
+{
+	// the tasks still queued will never be resumed, so free them
+	// from the started task down, once each
+	std::vector<Task::HANDLE> waiting = m_mainThreadTasks;
+	waiting.insert(waiting.end(), m_nextFrameTasks.begin(), m_nextFrameTasks.end());
+	for (size_t i = 0; i < m_fenceWaits.size(); i++)
+	{
+		glDeleteSync(m_fenceWaits[i].fence);
+		waiting.push_back(m_fenceWaits[i].handle);
+	}
+
+	std::vector<Task::HANDLE> roots;
+	for (size_t i = 0; i < waiting.size(); i++)
+	{
+		Task::HANDLE root = Task::FindRoot(waiting[i]);
+		if (std::find(roots.begin(), roots.end(), root) == roots.end())
+		{
+			roots.push_back(root);
+		}
+	}
+	for (size_t i = 0; i < roots.size(); i++)
+	{
+		if (roots[i].promise().pScheduler == this)
+		{
+			m_runningCount--;
+		}
+		roots[i].destroy();
+	}
+
+	if (m_runningCount > 0)
+	{
+		std::cout << m_runningCount << " tasks were still running when the scheduler was destroyed" << std::endl;
+	}
+}
+
+/***********************************************************
+ *  Start()
+ *
+ *  This method is used for running a task until it first
+ *  waits.  The scheduler frees the task once it finishes.
+ ***********************************************************/
+void TaskScheduler::Start(Task task)
+{
+	Task::HANDLE handle = task.Release();
+	if (!handle)
+	{
+		return;
+	}
+
+	handle.promise().pScheduler = this;
+	m_runningCount++;
+	handle.resume();
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for resuming the tasks that moved to
+ *  the GL thread, waited for this frame or whose fences
+ *  have passed.  It is called once every frame on the GL
+ *  thread.
+ ***********************************************************/
+void TaskScheduler::Update()
+{
+	m_frame++;
+
+	// take the queues before resuming anything, so a task waiting
+	// for the next frame from here waits a whole frame
+	std::vector<Task::HANDLE> ready;
+	{
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+		ready.swap(m_mainThreadTasks);
+		ready.insert(ready.end(), m_nextFrameTasks.begin(), m_nextFrameTasks.end());
+		m_nextFrameTasks.clear();
+
+		// poll the fences without waiting on the GPU
+		size_t kept = 0;
+		for (size_t i = 0; i < m_fenceWaits.size(); i++)
+		{
+			FENCE_WAIT& wait = m_fenceWaits[i];
+			GLenum result = glClientWaitSync(wait.fence, 0, 0);
+			if ((result == GL_ALREADY_SIGNALED) ||
+				(result == GL_CONDITION_SATISFIED) ||
+				(result == GL_WAIT_FAILED))
+			{
+				wait.pAwaiter->bSignaled = (result != GL_WAIT_FAILED);
+				glDeleteSync(wait.fence);
+				ready.push_back(wait.handle);
+			}
+			else
+			{
+				m_fenceWaits[kept++] = wait;
+			}
+		}
+		m_fenceWaits.resize(kept);
+	}
+
+	m_bUpdating = true;
+	for (size_t i = 0; i < ready.size(); i++)
+	{
+		ready[i].resume();
+	}
+	m_bUpdating = false;
+}
+
+/***********************************************************
+ *  QueueMainThread()
+ *
+ *  This method is used for queueing a task to be resumed on
+ *  the GL thread by the next Update().
+ ***********************************************************/
+void TaskScheduler::QueueMainThread(Task::HANDLE handle)
+{
+	std::lock_guard<std::mutex> lock(m_queueMutex);
+	m_mainThreadTasks.push_back(handle);
+}
@@ -0,0 +1,218 @@
+///////////////////////////////////////////////////////////////////////////////
+// taskscheduler.h
+// ============
+// write work spanning frames and threads as coroutines
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "JobSystem.h"
+
+#include <GL/glew.h>
+
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class TaskScheduler;
+
+/***********************************************************
+ *  Task
+ *
+ *  This class is the coroutine type of the task layer.  A
+ *  function returning a Task may co_await the awaitables of
+ *  the scheduler to continue on a worker, on the GL thread,
+ *  in the next frame, after a GPU fence or after a file
+ *  read, and may co_await another Task to run it to its end
+ *  first.  A task does not start until it is awaited or
+ *  handed to TaskScheduler::Start().
+ ***********************************************************/
+class Task
+{
+public:
+	struct promise_type;
+	typedef std::coroutine_handle<promise_type> HANDLE;
+
+	// resumes the awaiting task once this one finishes, or frees
+	// the task when it was started on its own
+	struct FINAL_AWAITER
+	{
+		bool await_ready() const noexcept { return(false); }
+		std::coroutine_handle<> await_suspend(HANDLE handle) noexcept;
+		void await_resume() const noexcept {}
+	};
+
+	struct promise_type
+	{
+		// task waiting for this one, none for a started task
+		HANDLE parent;
+		// scheduler a started task counts against
+		TaskScheduler* pScheduler = NULL;
+
+		Task get_return_object() { return(Task(HANDLE::from_promise(*this))); }
+		std::suspend_always initial_suspend() const noexcept { return(std::suspend_always()); }
+		FINAL_AWAITER final_suspend() const noexcept { return(FINAL_AWAITER()); }
+		void return_void() const {}
+		void unhandled_exception() const;
+	};
+
+	// constructor
+	Task() {}
+	explicit Task(HANDLE handle) : m_handle(handle) {}
+	Task(Task&& other) noexcept : m_handle(other.m_handle) { other.m_handle = HANDLE(); }
+	Task(const Task&) = delete;
+	Task& operator=(const Task&) = delete;
+	// destructor - frees a task that was never started
+	~Task();
+
+	// run the task from the awaiting one and continue that one
+	// once this task finishes
+	bool await_ready() const noexcept { return(!m_handle || m_handle.done()); }
+	std::coroutine_handle<> await_suspend(HANDLE parent) noexcept;
+	void await_resume() const noexcept {}
+
+	// give up the coroutine without freeing it
+	HANDLE Release();
+
+	// follow the awaiting tasks up to the one that was started
+	static HANDLE FindRoot(HANDLE handle);
+
+private:
+	HANDLE m_handle;
+};
+
+/***********************************************************
+ *  TaskScheduler
+ *
+ *  This class runs tasks and resumes them where they asked
+ *  to continue.  Tasks moving to a worker are submitted to
+ *  the background queue of the job system, which only the
+ *  workers run, and tasks waiting for the GL thread, the
+ *  next frame or a GPU fence are queued until Update(),
+ *  called once every frame on the GL thread, resumes them.
+ *  A task only continues on the GL thread from within
+ *  Update(), never in the middle of whatever else the GL
+ *  thread is doing.  The queues are locked, so tasks may
+ *  wait from any thread.
+ ***********************************************************/
+class TaskScheduler
+{
+public:
+	// continue on a worker, or right away without a job system
+	struct WORKER_AWAITER
+	{
+		TaskScheduler* pScheduler;
+		bool await_ready() const noexcept { return(NULL == pScheduler->m_pJobSystem); }
+		void await_suspend(Task::HANDLE handle) const;
+		void await_resume() const noexcept {}
+	};
+
+	// continue on the GL thread from Update(), right away when
+	// already resumed by it
+	struct MAIN_THREAD_AWAITER
+	{
+		TaskScheduler* pScheduler;
+		bool await_ready() const noexcept { return(pScheduler->IsInUpdate()); }
+		void await_suspend(Task::HANDLE handle) const;
+		void await_resume() const noexcept {}
+	};
+
+	// continue on the GL thread in the next frame
+	struct NEXT_FRAME_AWAITER
+	{
+		TaskScheduler* pScheduler;
+		bool await_ready() const noexcept { return(false); }
+		void await_suspend(Task::HANDLE handle) const;
+		void await_resume() const noexcept {}
+	};
+
+	// continue on the GL thread in the first frame the fence has
+	// passed, which is deleted then; true unless the wait failed
+	struct FENCE_AWAITER
+	{
+		TaskScheduler* pScheduler;
+		GLsync fence;
+		bool bSignaled;
+		bool await_ready() const noexcept { return(NULL == fence); }
+		void await_suspend(Task::HANDLE handle);
+		bool await_resume() const noexcept { return(bSignaled); }
+	};
+
+	// read a whole file on a worker and continue there; true when
+	// every byte was read
+	struct FILE_READ_AWAITER
+	{
+		TaskScheduler* pScheduler;
+		std::string filename;
+		std::vector<uint8_t>* pContents;
+		bool bRead;
+		bool await_ready() const noexcept { return(false); }
+		bool await_suspend(Task::HANDLE handle);
+		bool await_resume() const noexcept { return(bRead); }
+	};
+
+	// constructor - the calling thread becomes the GL thread, and
+	// without a job system worker steps run on the awaiting thread
+	TaskScheduler(JobSystem* pJobSystem);
+	// destructor - frees the tasks still waiting in the queues
+	~TaskScheduler();
+
+	// run a task until it first waits, and free it once it finishes
+	void Start(Task task);
+	// resume the tasks queued for the GL thread and the new frame
+	void Update();
+
+	// awaitables for the tasks
+	WORKER_AWAITER ResumeOnWorker() { return(WORKER_AWAITER{ this }); }
+	MAIN_THREAD_AWAITER ResumeOnMainThread() { return(MAIN_THREAD_AWAITER{ this }); }
+	NEXT_FRAME_AWAITER NextFrame() { return(NEXT_FRAME_AWAITER{ this }); }
+	FENCE_AWAITER WaitForFence(GLsync fence) { return(FENCE_AWAITER{ this, fence, true }); }
+	FILE_READ_AWAITER ReadFile(const std::string& filename, std::vector<uint8_t>& contents)
+	{
+		return(FILE_READ_AWAITER{ this, filename, &contents, false });
+	}
+
+	// number of started tasks that have not finished
+	int GetRunningCount() const { return(m_runningCount.load()); }
+	// number of times Update() has run
+	uint64_t GetFrame() const { return(m_frame); }
+	// true on the GL thread while Update() resumes the queued tasks
+	bool IsInUpdate() const
+	{
+		return((m_bUpdating) && (std::this_thread::get_id() == m_mainThreadId));
+	}
+
+private:
+	// a task waiting for a fence to pass
+	struct FENCE_WAIT
+	{
+		GLsync fence;
+		FENCE_AWAITER* pAwaiter;
+		Task::HANDLE handle;
+	};
+
+	JobSystem* m_pJobSystem;
+	std::thread::id m_mainThreadId;
+	std::atomic<int> m_runningCount;
+	uint64_t m_frame;
+	// true while Update() resumes the queued tasks, read from any
+	// thread but only set on the GL thread
+	std::atomic<bool> m_bUpdating;
+
+	// guards the queues below
+	std::mutex m_queueMutex;
+	// tasks waiting for the GL thread, for the next frame and for
+	// fences to pass
+	std::vector<Task::HANDLE> m_mainThreadTasks;
+	std::vector<Task::HANDLE> m_nextFrameTasks;
+	std::vector<FENCE_WAIT> m_fenceWaits;
+
+	// queue a task to be resumed by the next Update()
+	void QueueMainThread(Task::HANDLE handle);
+
+	friend struct Task::FINAL_AWAITER;
+};
@@ -0,0 +1,357 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureatlas.cpp
+// ============
+// pack many small texture images into one atlas image
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureAtlas.h"
+
+#include <algorithm>
+#include <climits>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// texels of wrapped image content around every image, which is
+	// also the alignment of the blocks, so that the texels of mip
+	// levels up to log2 of it never span two images
+	const int ATLAS_GUTTER = 8;
+
+	// round up to the next multiple of the gutter
+	int AlignToGutter(int value)
+	{
+		return(((value + ATLAS_GUTTER - 1) / ATLAS_GUTTER) * ATLAS_GUTTER);
+	}
+}
+
+/***********************************************************
+ *  TextureAtlas()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureAtlas::TextureAtlas()
+{
+	m_width = 0;
+	m_height = 0;
+}
+
+/***********************************************************
+ *  ~TextureAtlas()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TextureAtlas::~TextureAtlas()
+{
+}
+
+/***********************************************************
+ *  AddImage()
+ *
+ *  This method is used for adding an RGBA image under the
+ *  passed in tag to the images packed by Pack().
+ ***********************************************************/
+void TextureAtlas::AddImage(std::string tag, int width, int height, const uint8_t* pixels)
+{
+	ATLAS_IMAGE image;
+	image.tag = tag;
+	image.width = width;
+	image.height = height;
+	image.pixels.assign(pixels, pixels + (static_cast<size_t>(width) * height * 4));
+	image.x = 0;
+	image.y = 0;
+	m_images.push_back(image);
+}
+
+/***********************************************************
+ *  Pack()
+ *
+ *  This method is used for placing every added image, the
+ *  tallest first, at the lowest free spot along the top of
+ *  the packed area, and then copying the images and their
+ *  wrapped gutters into the atlas pixels.
+ ***********************************************************/
+bool TextureAtlas::Pack(int maxSize)
+{
+	std::vector<int> order(m_images.size());
+	for (int i = 0; i < order.size(); i++)
+	{
+		order[i] = i;
+	}
+	std::sort(order.begin(), order.end(), [this](int a, int b)
+		{
+			return(m_images[a].height > m_images[b].height);
+		});
+
+	std::vector<SKYLINE_NODE> skyline;
+	SKYLINE_NODE ground = { 0, 0, maxSize };
+	skyline.push_back(ground);
+
+	int usedHeight = 0;
+	for (int i = 0; i < order.size(); i++)
+	{
+		ATLAS_IMAGE& image = m_images[order[i]];
+		int blockWidth = AlignToGutter(image.width + (2 * ATLAS_GUTTER));
+		int blockHeight = AlignToGutter(image.height + (2 * ATLAS_GUTTER));
+
+		int x = 0;
+		int y = 0;
+		int nodeIndex = FindPosition(skyline, maxSize, blockWidth, blockHeight, x, y);
+		if ((nodeIndex < 0) || (y + blockHeight > maxSize))
+		{
+			std::cout << "Texture atlas of " << maxSize << " texels is too small for:" << image.tag << std::endl;
+			return(false);
+		}
+		AddSkylineLevel(skyline, nodeIndex, x, y, blockWidth, blockHeight);
+
+		image.x = x + ATLAS_GUTTER;
+		image.y = y + ATLAS_GUTTER;
+		usedHeight = std::max(usedHeight, y + blockHeight);
+	}
+
+	m_width = maxSize;
+	m_height = usedHeight;
+	m_pixels.assign(static_cast<size_t>(m_width) * m_height * 4, 0);
+
+	for (int i = 0; i < m_images.size(); i++)
+	{
+		const ATLAS_IMAGE& image = m_images[i];
+		CopyImageBlock(image, image.pixels.data(), m_pixels.data(), m_width, image.x - ATLAS_GUTTER, image.y - ATLAS_GUTTER);
+	}
+
+	std::cout << "Packed " << m_images.size() << " textures into a "
+		<< m_width << "x" << m_height << " atlas" << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  ReleasePixels()
+ *
+ *  This method is used for freeing the image and atlas
+ *  pixels, keeping only the packed rectangles.
+ ***********************************************************/
+void TextureAtlas::ReleasePixels()
+{
+	for (int i = 0; i < m_images.size(); i++)
+	{
+		std::vector<uint8_t>().swap(m_images[i].pixels);
+	}
+	std::vector<uint8_t>().swap(m_pixels);
+}
+
+/***********************************************************
+ *  BuildImageBlock()
+ *
+ *  This method is used for preparing the new pixels of an
+ *  edited image for copying over its block of the uploaded
+ *  atlas.  The image must keep its size, since moving it
+ *  would mean packing the atlas again.
+ ***********************************************************/
+bool TextureAtlas::BuildImageBlock(
+	std::string tag,
+	int width,
+	int height,
+	const uint8_t* pixels,
+	std::vector<uint8_t>& block,
+	int& blockX,
+	int& blockY,
+	int& blockWidth,
+	int& blockHeight) const
+{
+	for (int i = 0; i < m_images.size(); i++)
+	{
+		const ATLAS_IMAGE& image = m_images[i];
+		if (image.tag.compare(tag) != 0)
+		{
+			continue;
+		}
+		if ((image.width != width) || (image.height != height))
+		{
+			return(false);
+		}
+
+		blockX = image.x - ATLAS_GUTTER;
+		blockY = image.y - ATLAS_GUTTER;
+		blockWidth = AlignToGutter(image.width + (2 * ATLAS_GUTTER));
+		blockHeight = AlignToGutter(image.height + (2 * ATLAS_GUTTER));
+		block.resize(static_cast<size_t>(blockWidth) * blockHeight * 4);
+		CopyImageBlock(image, pixels, block.data(), blockWidth, 0, 0);
+		return(true);
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  FindRect()
+ *
+ *  This method is used for getting the rectangle of the
+ *  packed image associated with the passed in tag.
+ ***********************************************************/
+bool TextureAtlas::FindRect(std::string tag, glm::vec4& rect) const
+{
+	if ((m_width == 0) || (m_height == 0))
+	{
+		return(false);
+	}
+
+	for (int i = 0; i < m_images.size(); i++)
+	{
+		if (m_images[i].tag.compare(tag) == 0)
+		{
+			rect = glm::vec4(
+				static_cast<float>(m_images[i].x) / m_width,
+				static_cast<float>(m_images[i].y) / m_height,
+				static_cast<float>(m_images[i].width) / m_width,
+				static_cast<float>(m_images[i].height) / m_height);
+			return(true);
+		}
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  GetMaxMipLevel()
+ *
+ *  This method is used for getting the coarsest mip level
+ *  that stays inside the gutters.
+ ***********************************************************/
+int TextureAtlas::GetMaxMipLevel() const
+{
+	int level = 0;
+	while ((2 << level) <= ATLAS_GUTTER)
+	{
+		level++;
+	}
+	return(level);
+}
+
+/***********************************************************
+ *  CopyImageBlock()
+ *
+ *  This method is used for copying an image over its whole
+ *  block at the passed in position of the target, filling
+ *  the gutter and the alignment padding with its own texels
+ *  wrapped around from the opposite edges.
+ ***********************************************************/
+void TextureAtlas::CopyImageBlock(
+	const ATLAS_IMAGE& image,
+	const uint8_t* pixels,
+	uint8_t* target,
+	int targetWidth,
+	int targetX,
+	int targetY) const
+{
+	int blockWidth = AlignToGutter(image.width + (2 * ATLAS_GUTTER));
+	int blockHeight = AlignToGutter(image.height + (2 * ATLAS_GUTTER));
+
+	for (int y = 0; y < blockHeight; y++)
+	{
+		int sourceY = ((y - ATLAS_GUTTER) % image.height + image.height) % image.height;
+		for (int x = 0; x < blockWidth; x++)
+		{
+			int sourceX = ((x - ATLAS_GUTTER) % image.width + image.width) % image.width;
+			const uint8_t* source = &pixels[((static_cast<size_t>(sourceY) * image.width) + sourceX) * 4];
+			uint8_t* texel = &target[((static_cast<size_t>(targetY + y) * targetWidth) + targetX + x) * 4];
+			std::copy(source, source + 4, texel);
+		}
+	}
+}
+
+/***********************************************************
+ *  FindPosition()
+ *
+ *  This method is used for finding the skyline node where a
+ *  block rests lowest, preferring the narrower node on ties.
+ ***********************************************************/
+int TextureAtlas::FindPosition(
+	const std::vector<SKYLINE_NODE>& skyline,
+	int maxWidth,
+	int blockWidth,
+	int blockHeight,
+	int& x,
+	int& y) const
+{
+	int bestIndex = -1;
+	int bestTop = INT_MAX;
+	int bestWidth = INT_MAX;
+
+	for (int i = 0; i < skyline.size(); i++)
+	{
+		if (skyline[i].x + blockWidth > maxWidth)
+		{
+			break;
+		}
+
+		// the block rests on the highest node it spans
+		int restY = 0;
+		int widthLeft = blockWidth;
+		for (int j = i; widthLeft > 0; j++)
+		{
+			restY = std::max(restY, skyline[j].y);
+			widthLeft -= skyline[j].width;
+		}
+
+		int top = restY + blockHeight;
+		if ((top < bestTop) || ((top == bestTop) && (skyline[i].width < bestWidth)))
+		{
+			bestIndex = i;
+			bestTop = top;
+			bestWidth = skyline[i].width;
+			x = skyline[i].x;
+			y = restY;
+		}
+	}
+
+	return(bestIndex);
+}
+
+/***********************************************************
+ *  AddSkylineLevel()
+ *
+ *  This method is used for inserting the top of a placed
+ *  block into the skyline, trimming the nodes it covers and
+ *  merging neighbors of equal height.
+ ***********************************************************/
+void TextureAtlas::AddSkylineLevel(
+	std::vector<SKYLINE_NODE>& skyline,
+	int nodeIndex,
+	int x,
+	int y,
+	int blockWidth,
+	int blockHeight) const
+{
+	SKYLINE_NODE node = { x, y + blockHeight, blockWidth };
+	skyline.insert(skyline.begin() + nodeIndex, node);
+
+	for (int i = nodeIndex + 1; i < skyline.size(); i++)
+	{
+		int coveredEnd = skyline[i - 1].x + skyline[i - 1].width;
+		if (skyline[i].x >= coveredEnd)
+		{
+			break;
+		}
+
+		int shrink = coveredEnd - skyline[i].x;
+		skyline[i].x += shrink;
+		skyline[i].width -= shrink;
+		if (skyline[i].width > 0)
+		{
+			break;
+		}
+		skyline.erase(skyline.begin() + i);
+		i--;
+	}
+
+	for (int i = 0; i + 1 < skyline.size(); i++)
+	{
+		if (skyline[i].y == skyline[i + 1].y)
+		{
+			skyline[i].width += skyline[i + 1].width;
+			skyline.erase(skyline.begin() + i + 1);
+			i--;
+		}
+	}
+}
@@ -0,0 +1,116 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureatlas.h
+// ============
+// pack many small texture images into one atlas image
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  TextureAtlas
+ *
+ *  This class packs small RGBA images into a single atlas
+ *  with a skyline bottom-left packer.  Every image gets a
+ *  gutter filled with its own wrapped texels, and blocks are
+ *  aligned so that the gutters keep images apart down to
+ *  GetMaxMipLevel(), which lets the shader repeat an image
+ *  inside its rectangle without bleeding at any used mip.
+ ***********************************************************/
+class TextureAtlas
+{
+public:
+	// constructor
+	TextureAtlas();
+	// destructor
+	~TextureAtlas();
+
+	// copy an RGBA image in to be packed by the next Pack()
+	void AddImage(std::string tag, int width, int height, const uint8_t* pixels);
+	// pack the added images into an atlas no wider than maxSize,
+	// returns false when they do not fit
+	bool Pack(int maxSize);
+	// free the added images and the atlas pixels once uploaded
+	void ReleasePixels();
+
+	// fill the block of a packed image with new pixels of the same size,
+	// returning the block and its texel position in the atlas
+	bool BuildImageBlock(
+		std::string tag,
+		int width,
+		int height,
+		const uint8_t* pixels,
+		std::vector<uint8_t>& block,
+		int& blockX,
+		int& blockY,
+		int& blockWidth,
+		int& blockHeight) const;
+
+	// get the rectangle of an image as the atlas UV offset (xy)
+	// and size (zw), returns false for an unknown tag
+	bool FindRect(std::string tag, glm::vec4& rect) const;
+
+	// get the packed atlas image
+	const std::vector<uint8_t>& GetPixels() const { return(m_pixels); }
+	int GetWidth() const { return(m_width); }
+	int GetHeight() const { return(m_height); }
+	// get the last mip level whose texels never mix two images
+	int GetMaxMipLevel() const;
+	// get the number of packed images
+	int GetImageCount() const { return(static_cast<int>(m_images.size())); }
+
+private:
+	struct ATLAS_IMAGE
+	{
+		std::string tag;
+		int width;
+		int height;
+		std::vector<uint8_t> pixels;
+		// origin of the image content in the atlas, set by Pack()
+		int x;
+		int y;
+	};
+
+	// top edge of the packed area over a span of columns
+	struct SKYLINE_NODE
+	{
+		int x;
+		int y;
+		int width;
+	};
+
+	std::vector<ATLAS_IMAGE> m_images;
+	std::vector<uint8_t> m_pixels;
+	int m_width;
+	int m_height;
+
+	// copy an image into its block of the target, wrapping into the gutter
+	void CopyImageBlock(
+		const ATLAS_IMAGE& image,
+		const uint8_t* pixels,
+		uint8_t* target,
+		int targetWidth,
+		int targetX,
+		int targetY) const;
+	// find the lowest spot for a block, returns the skyline node index or -1
+	int FindPosition(
+		const std::vector<SKYLINE_NODE>& skyline,
+		int maxWidth,
+		int blockWidth,
+		int blockHeight,
+		int& x,
+		int& y) const;
+	// raise the skyline over a placed block
+	void AddSkylineLevel(
+		std::vector<SKYLINE_NODE>& skyline,
+		int nodeIndex,
+		int x,
+		int y,
+		int blockWidth,
+		int blockHeight) const;
+};
@@ -0,0 +1,386 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturepreparation.cpp
+// ============
+// convert decoded images and build their mip chains on the CPU before upload
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TexturePreparation.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <tmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TEXTURE_PREPARATION_SSSE3_FUNCTION
+#else
+#define TEXTURE_PREPARATION_SSSE3_FUNCTION __attribute__((target("ssse3")))
+#endif
+#define TEXTURE_PREPARATION_SSSE3
+#endif
+
+// declaration of global variables
+namespace
+{
+	// precision of the linear to sRGB encoding table
+	const int LINEAR_TABLE_SIZE = 4096;
+
+	/***********************************************************
+	 *  CpuSupportsSSSE3()
+	 *
+	 *  Check once that the processor supports the SSSE3
+	 *  instructions.
+	 ***********************************************************/
+	bool CpuSupportsSSSE3()
+	{
+#if defined(TEXTURE_PREPARATION_SSSE3) && defined(_MSC_VER)
+		static const bool bSupported = []()
+			{
+				int info[4] = { 0 };
+				__cpuid(info, 1);
+				return((info[2] & (1 << 9)) != 0);
+			}();
+		return(bSupported);
+#elif defined(TEXTURE_PREPARATION_SSSE3)
+		static const bool bSupported = (__builtin_cpu_supports("ssse3") != 0);
+		return(bSupported);
+#else
+		return(false);
+#endif
+	}
+
+#ifdef TEXTURE_PREPARATION_SSSE3
+	/***********************************************************
+	 *  ExpandRGBToRGBASSSE3()
+	 *
+	 *  Expand RGB8 texels to RGBA8 four at a time, returning
+	 *  how many were expanded.  Each step shuffles four texels
+	 *  out of a 16 byte load and sets their alpha bytes,
+	 *  stopping while a whole load still fits in the source so
+	 *  it never reads past the end.
+	 ***********************************************************/
+	TEXTURE_PREPARATION_SSSE3_FUNCTION
+	size_t ExpandRGBToRGBASSSE3(const uint8_t* rgb, uint32_t* rgba, size_t texelCount)
+	{
+		const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+		const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+		size_t i = 0;
+		for (; (i + 6) <= texelCount; i += 4)
+		{
+			__m128i source = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb + (i * 3)));
+			__m128i expanded = _mm_or_si128(_mm_shuffle_epi8(source, shuffle), alpha);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(rgba + i), expanded);
+		}
+		return(i);
+	}
+#endif
+
+	/***********************************************************
+	 *  GAMMA_TABLES
+	 *
+	 *  Lookup tables between sRGB encoded bytes and linear
+	 *  light, built once on first use.
+	 ***********************************************************/
+	struct GAMMA_TABLES
+	{
+		float toLinear[256];
+		uint8_t toSRGB[LINEAR_TABLE_SIZE];
+
+		GAMMA_TABLES()
+		{
+			for (int i = 0; i < 256; i++)
+			{
+				float c = i / 255.0f;
+				toLinear[i] = (c <= 0.04045f) ? (c / 12.92f) : std::pow((c + 0.055f) / 1.055f, 2.4f);
+			}
+			for (int i = 0; i < LINEAR_TABLE_SIZE; i++)
+			{
+				float c = i / static_cast<float>(LINEAR_TABLE_SIZE - 1);
+				float encoded = (c <= 0.0031308f) ? (c * 12.92f) : ((1.055f * std::pow(c, 1.0f / 2.4f)) - 0.055f);
+				toSRGB[i] = static_cast<uint8_t>((encoded * 255.0f) + 0.5f);
+			}
+		}
+	};
+
+	const GAMMA_TABLES& GetGammaTables()
+	{
+		static const GAMMA_TABLES tables;
+		return(tables);
+	}
+
+	/***********************************************************
+	 *  DownsampleLevel()
+	 *
+	 *  Average each 2x2 block of the source level into one
+	 *  texel, with the color averaged in linear light and the
+	 *  alpha averaged as is.  On an odd edge the last block
+	 *  is three texels wide, so the last column or row is
+	 *  folded in rather than dropped, and a source edge of a
+	 *  single texel clamps to it.
+	 ***********************************************************/
+	void DownsampleLevel(const TEXTURE_LEVEL& source, TEXTURE_LEVEL& target, JobSystem* pJobSystem)
+	{
+		const GAMMA_TABLES& tables = GetGammaTables();
+		target.width = std::max(source.width / 2, 1);
+		target.height = std::max(source.height / 2, 1);
+		target.texels.resize(static_cast<size_t>(target.width) * target.height);
+
+		auto downsampleRows = [&](size_t begin, size_t end)
+			{
+				for (size_t y = begin; y < end; y++)
+				{
+					int rowCount = ((y + 1 == target.height) && (source.height > 1) && (source.height & 1)) ? 3 : 2;
+					for (int x = 0; x < target.width; x++)
+					{
+						int columnCount = ((x + 1 == target.width) && (source.width > 1) && (source.width & 1)) ? 3 : 2;
+						float linear[3] = { 0.0f, 0.0f, 0.0f };
+						uint32_t alpha = 0;
+						for (int row = 0; row < rowCount; row++)
+						{
+							int sourceY = std::min((static_cast<int>(y) * 2) + row, source.height - 1);
+							for (int column = 0; column < columnCount; column++)
+							{
+								int sourceX = std::min((x * 2) + column, source.width - 1);
+								uint32_t sample = source.texels[(static_cast<size_t>(sourceY) * source.width) + sourceX];
+								for (int channel = 0; channel < 3; channel++)
+								{
+									linear[channel] += tables.toLinear[(sample >> (channel * 8)) & 0xFF];
+								}
+								alpha += sample >> 24;
+							}
+						}
+
+						int sampleCount = rowCount * columnCount;
+						uint32_t texel = 0;
+						for (int channel = 0; channel < 3; channel++)
+						{
+							int index = static_cast<int>(((linear[channel] / sampleCount) * (LINEAR_TABLE_SIZE - 1)) + 0.5f);
+							texel |= static_cast<uint32_t>(tables.toSRGB[index]) << (channel * 8);
+						}
+						alpha = (alpha + (sampleCount / 2)) / sampleCount;
+						target.texels[(y * target.width) + x] = texel | (alpha << 24);
+					}
+				}
+			};
+
+		if (NULL != pJobSystem)
+		{
+			pJobSystem->ParallelFor(target.height, 16, downsampleRows);
+		}
+		else
+		{
+			downsampleRows(0, target.height);
+		}
+	}
+}
+
+/***********************************************************
+ *  ExpandRGBToRGBA()
+ *
+ *  Expand RGB8 texels to RGBA8, with SSSE3 when the x86
+ *  processor has it and one texel at a time for the rest
+ *  and on every other processor.
+ ***********************************************************/
+void ExpandRGBToRGBA(const uint8_t* rgb, uint32_t* rgba, size_t texelCount)
+{
+	size_t i = 0;
+
+#ifdef TEXTURE_PREPARATION_SSSE3
+	if (CpuSupportsSSSE3())
+	{
+		i = ExpandRGBToRGBASSSE3(rgb, rgba, texelCount);
+	}
+#endif
+
+	for (; i < texelCount; i++)
+	{
+		const uint8_t* texel = rgb + (i * 3);
+		rgba[i] = static_cast<uint32_t>(texel[0]) |
+			(static_cast<uint32_t>(texel[1]) << 8) |
+			(static_cast<uint32_t>(texel[2]) << 16) |
+			0xFF000000u;
+	}
+}
+
+/***********************************************************
+ *  PrepareTextureLevels()
+ *
+ *  Convert the decoded image into the first level, split
+ *  into row ranges across the workers, then build each
+ *  smaller level from the one before it.
+ ***********************************************************/
+bool PrepareTextureLevels(
+	const uint8_t* pixels,
+	int width,
+	int height,
+	int colorChannels,
+	int maxLevel,
+	std::vector<TEXTURE_LEVEL>& levels,
+	JobSystem* pJobSystem)
+{
+	if ((colorChannels != 3) && (colorChannels != 4))
+	{
+		return(false);
+	}
+
+	levels.clear();
+	levels.resize(1);
+	TEXTURE_LEVEL& base = levels[0];
+	base.width = width;
+	base.height = height;
+	base.texels.resize(static_cast<size_t>(width) * height);
+
+	auto convertRows = [&](size_t begin, size_t end)
+		{
+			const uint8_t* source = pixels + (begin * width * colorChannels);
+			uint32_t* target = &base.texels[begin * width];
+			size_t texelCount = (end - begin) * width;
+			if (colorChannels == 3)
+			{
+				ExpandRGBToRGBA(source, target, texelCount);
+			}
+			else
+			{
+				std::copy(source, source + (texelCount * 4), reinterpret_cast<uint8_t*>(target));
+			}
+		};
+
+	if (NULL != pJobSystem)
+	{
+		pJobSystem->ParallelFor(height, 16, convertRows);
+	}
+	else
+	{
+		convertRows(0, height);
+	}
+
+	while (((levels.back().width > 1) || (levels.back().height > 1)) &&
+		((maxLevel < 0) || (static_cast<int>(levels.size()) <= maxLevel)))
+	{
+		TEXTURE_LEVEL next;
+		DownsampleLevel(levels.back(), next, pJobSystem);
+		levels.push_back(std::move(next));
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  UploadTextureLevels()
+ *
+ *  Allocate storage for every level of the bound texture
+ *  and copy the prepared texels in, so the driver neither
+ *  converts formats nor generates mipmaps.
+ ***********************************************************/
+void UploadTextureLevels(const std::vector<TEXTURE_LEVEL>& levels)
+{
+	GLsizei levelCount = static_cast<GLsizei>(levels.size());
+	if (levelCount == 0)
+	{
+		return;
+	}
+
+	AllocateTextureLevels(levels);
+
+	// RGBA8 rows are always four byte aligned
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	for (GLint level = 0; level < levelCount; level++)
+	{
+		glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, levels[level].width, levels[level].height, GL_RGBA, GL_UNSIGNED_BYTE, levels[level].texels.data());
+	}
+}
+
+/***********************************************************
+ *  AllocateTextureLevels()
+ *
+ *  Allocate storage for every level of the bound texture,
+ *  leaving the texels to be copied in afterwards.
+ ***********************************************************/
+void AllocateTextureLevels(const std::vector<TEXTURE_LEVEL>& levels)
+{
+	GLsizei levelCount = static_cast<GLsizei>(levels.size());
+	if (levelCount == 0)
+	{
+		return;
+	}
+
+	if (GLEW_ARB_texture_storage)
+	{
+		glTexStorage2D(GL_TEXTURE_2D, levelCount, GL_RGBA8, levels[0].width, levels[0].height);
+	}
+	else
+	{
+		for (GLint level = 0; level < levelCount; level++)
+		{
+			glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, levels[level].width, levels[level].height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		}
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+}
+
+/***********************************************************
+ *  UploadTextureLevelsPartly()
+ *
+ *  Copy the next rows of the prepared levels into the
+ *  allocated storage of the bound texture, as many as fit
+ *  into the byte budget, so that a large texture is spread
+ *  over several frames.  At least one row is copied for
+ *  any budget left, so every upload finishes.
+ ***********************************************************/
+bool UploadTextureLevelsPartly(
+	const std::vector<TEXTURE_LEVEL>& levels,
+	size_t& uploadedBytes,
+	size_t& byteBudget)
+{
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	size_t levelStart = 0;
+	for (GLint level = 0; level < static_cast<GLint>(levels.size()); level++)
+	{
+		const TEXTURE_LEVEL& textureLevel = levels[level];
+		size_t rowBytes = static_cast<size_t>(textureLevel.width) * 4;
+		size_t levelBytes = rowBytes * textureLevel.height;
+		if (uploadedBytes >= levelStart + levelBytes)
+		{
+			levelStart += levelBytes;
+			continue;
+		}
+		if (byteBudget == 0)
+		{
+			return(false);
+		}
+
+		int firstRow = static_cast<int>((uploadedBytes - levelStart) / rowBytes);
+		int rowCount = static_cast<int>(std::max<size_t>(byteBudget / rowBytes, 1));
+		rowCount = std::min(rowCount, textureLevel.height - firstRow);
+		glTexSubImage2D(GL_TEXTURE_2D, level, 0, firstRow, textureLevel.width, rowCount, GL_RGBA, GL_UNSIGNED_BYTE,
+			textureLevel.texels.data() + (static_cast<size_t>(firstRow) * textureLevel.width));
+
+		size_t copiedBytes = rowBytes * rowCount;
+		uploadedBytes += copiedBytes;
+		byteBudget -= std::min(copiedBytes, byteBudget);
+		levelStart += levelBytes;
+		if (uploadedBytes < levelStart)
+		{
+			return(false);
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  UpdateTextureLevels()
+ *
+ *  Copy the prepared texels over a region of every level of
+ *  the bound texture, halving the offset with each level.
+ ***********************************************************/
+void UpdateTextureLevels(const std::vector<TEXTURE_LEVEL>& levels, int x, int y)
+{
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	for (GLint level = 0; level < static_cast<GLint>(levels.size()); level++)
+	{
+		glTexSubImage2D(GL_TEXTURE_2D, level, x >> level, y >> level, levels[level].width, levels[level].height, GL_RGBA, GL_UNSIGNED_BYTE, levels[level].texels.data());
+	}
+}
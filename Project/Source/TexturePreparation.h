@@ -0,0 +1,56 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturepreparation.h
+// ============
+// convert decoded images and build their mip chains on the CPU before upload
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "JobSystem.h"
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// one level of a prepared mip chain, with tightly packed RGBA8 texels
+struct TEXTURE_LEVEL
+{
+	int width;
+	int height;
+	std::vector<uint32_t> texels;
+};
+
+// expand packed RGB8 texels to RGBA8 with opaque alpha
+void ExpandRGBToRGBA(const uint8_t* rgb, uint32_t* rgba, size_t texelCount);
+
+// convert a decoded image with 3 or 4 channels to RGBA8 and build its
+// gamma-correct mip chain down to maxLevel, or to 1x1 when maxLevel is -1
+bool PrepareTextureLevels(
+	const uint8_t* pixels,
+	int width,
+	int height,
+	int colorChannels,
+	int maxLevel,
+	std::vector<TEXTURE_LEVEL>& levels,
+	JobSystem* pJobSystem);
+
+// allocate the bound 2D texture and upload every prepared level into it
+void UploadTextureLevels(const std::vector<TEXTURE_LEVEL>& levels);
+
+// allocate storage for every prepared level of the bound 2D texture
+// without copying texels in
+void AllocateTextureLevels(const std::vector<TEXTURE_LEVEL>& levels);
+
+// copy whole rows of the prepared levels into the bound 2D texture,
+// continuing after the uploadedBytes already copied and stopping once
+// byteBudget is used up; returns true when every level is uploaded
+bool UploadTextureLevelsPartly(
+	const std::vector<TEXTURE_LEVEL>& levels,
+	size_t& uploadedBytes,
+	size_t& byteBudget);
+
+// copy prepared levels into the existing storage of the bound 2D texture,
+// with level 0 placed at the passed in texel offset
+void UpdateTextureLevels(const std::vector<TEXTURE_LEVEL>& levels, int x, int y);
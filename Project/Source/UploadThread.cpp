@@ -0,0 +1,157 @@
+///////////////////////////////////////////////////////////////////////////////
+// uploadthread.cpp
+// ============
+// create and fill GL buffers and textures on a thread with a shared context
+///////////////////////////////////////////////////////////////////////////////
+
+#include "UploadThread.h"
+
+#include <iostream>
+
+/***********************************************************
+ *  await_suspend()
+ *
+ *  This method is used for queueing the GL calls for the
+ *  upload thread, or running them right away on the GL
+ *  thread when there is none.
+ ***********************************************************/
+void UploadThread::UPLOAD_AWAITER::await_suspend(Task::HANDLE handle)
+{
+	if (pUploads->IsRunning() == false)
+	{
+		pUploads->RunJob(UPLOAD_JOB{ this, handle });
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(pUploads->m_queueMutex);
+		pUploads->m_jobs.push_back(UPLOAD_JOB{ this, handle });
+	}
+	pUploads->m_queueCondition.notify_one();
+}
+
+/***********************************************************
+ *  UploadThread()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+UploadThread::UploadThread(TaskScheduler* pScheduler)
+{
+	m_pScheduler = pScheduler;
+	m_pWindow = NULL;
+	m_bStop = false;
+}
+
+/***********************************************************
+ *  ~UploadThread()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+UploadThread::~UploadThread()
+{
+	Stop();
+}
+
+/***********************************************************
+ *  Start()
+ *
+ *  This method is used for creating a hidden window whose
+ *  context shares the objects of the passed in window, and
+ *  starting the thread the context is made current on.
+ *  GLFW only creates windows on the main thread, which is
+ *  also the GL thread.
+ ***********************************************************/
+bool UploadThread::Start(GLFWwindow* pSharedWindow)
+{
+	if (m_thread.joinable())
+	{
+		return(true);
+	}
+
+	// the context version hints set for the main window still apply
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	m_pWindow = glfwCreateWindow(1, 1, "", NULL, pSharedWindow);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+	if (NULL == m_pWindow)
+	{
+		std::cout << "Could not create the shared context for background uploads" << std::endl;
+		return(false);
+	}
+
+	m_bStop = false;
+	m_thread = std::thread(&UploadThread::UploadLoop, this);
+	return(true);
+}
+
+/***********************************************************
+ *  Stop()
+ *
+ *  This method is used for stopping the thread once the
+ *  queued uploads are finished, and destroying the hidden
+ *  window with its context.
+ ***********************************************************/
+void UploadThread::Stop()
+{
+	if (m_thread.joinable() == false)
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+		m_bStop = true;
+	}
+	m_queueCondition.notify_one();
+	m_thread.join();
+
+	glfwDestroyWindow(m_pWindow);
+	m_pWindow = NULL;
+}
+
+/***********************************************************
+ *  RunJob()
+ *
+ *  This method is used for running the GL calls of a job
+ *  on the current context and fencing them.  The fence is
+ *  flushed so the GL thread sees it pass without this
+ *  context issuing anything further, and the task is then
+ *  queued with the scheduler until it does.
+ ***********************************************************/
+void UploadThread::RunJob(const UPLOAD_JOB& job)
+{
+	job.pAwaiter->upload();
+
+	job.pAwaiter->fenceWait.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	glFlush();
+	job.pAwaiter->fenceWait.await_suspend(job.handle);
+}
+
+/***********************************************************
+ *  UploadLoop()
+ *
+ *  This method is used for running the queued jobs in
+ *  order on the shared context until the thread is asked
+ *  to stop with nothing left in the queue.
+ ***********************************************************/
+void UploadThread::UploadLoop()
+{
+	glfwMakeContextCurrent(m_pWindow);
+
+	while (true)
+	{
+		UPLOAD_JOB job;
+		{
+			std::unique_lock<std::mutex> lock(m_queueMutex);
+			m_queueCondition.wait(lock, [this] { return((m_bStop) || (m_jobs.empty() == false)); });
+			if (m_jobs.empty())
+			{
+				break;
+			}
+			job = m_jobs.front();
+			m_jobs.pop_front();
+		}
+		RunJob(job);
+	}
+
+	glfwMakeContextCurrent(NULL);
+}
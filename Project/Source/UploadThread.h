@@ -0,0 +1,94 @@
+///////////////////////////////////////////////////////////////////////////////
+// uploadthread.h
+// ============
+// create and fill GL buffers and textures on a thread with a shared context
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "TaskScheduler.h"
+
+#include <GL/glew.h>
+#include "GLFW/glfw3.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/***********************************************************
+ *  UploadThread
+ *
+ *  This class owns a hidden window whose GL context shares
+ *  its objects with the main window, made current on a
+ *  thread of its own.  A task hands it the GL calls that
+ *  create and fill buffers and textures from data prepared
+ *  by the workers, and is resumed on the GL thread once a
+ *  fence shows the GPU has finished them, so the render
+ *  thread only ever sees finished objects.  Vertex arrays
+ *  and framebuffers are not shared between contexts and
+ *  must still be made on the GL thread.  Without a second
+ *  context the GL calls run on the GL thread instead.
+ ***********************************************************/
+class UploadThread
+{
+public:
+	// run the GL calls on the upload thread and continue on the GL
+	// thread once the GPU has finished them; true unless the wait
+	// for the fence failed
+	struct UPLOAD_AWAITER
+	{
+		UploadThread* pUploads;
+		std::function<void()> upload;
+		TaskScheduler::FENCE_AWAITER fenceWait;
+		bool await_ready() const noexcept { return(false); }
+		void await_suspend(Task::HANDLE handle);
+		bool await_resume() const noexcept { return(fenceWait.bSignaled); }
+	};
+
+	// constructor
+	UploadThread(TaskScheduler* pScheduler);
+	// destructor
+	~UploadThread();
+
+	// create the shared context next to the passed in window and start
+	// the thread, returns false when no context could be created; must
+	// be called on the GL thread
+	bool Start(GLFWwindow* pSharedWindow);
+	// finish the queued uploads and stop the thread
+	void Stop();
+
+	// true while the thread is running
+	bool IsRunning() const { return(m_thread.joinable()); }
+	// awaitable for the tasks, which must await it on the GL thread
+	UPLOAD_AWAITER Upload(const std::function<void()>& upload)
+	{
+		return(UPLOAD_AWAITER{ this, upload, TaskScheduler::FENCE_AWAITER{ m_pScheduler, NULL, true } });
+	}
+
+private:
+	// GL calls waiting for the thread, and the task to resume after them
+	struct UPLOAD_JOB
+	{
+		UPLOAD_AWAITER* pAwaiter;
+		Task::HANDLE handle;
+	};
+
+	TaskScheduler* m_pScheduler;
+	// hidden window owning the shared context
+	GLFWwindow* m_pWindow;
+	std::thread m_thread;
+	std::deque<UPLOAD_JOB> m_jobs;
+	// guards the queued jobs
+	std::mutex m_queueMutex;
+	// signalled when a job is queued or the thread stops
+	std::condition_variable m_queueCondition;
+	bool m_bStop;
+
+	// run the GL calls of a job, fence them and hand the task to the
+	// scheduler until the fence passes
+	void RunJob(const UPLOAD_JOB& job);
+	// the loop executed by the upload thread
+	void UploadLoop();
+};
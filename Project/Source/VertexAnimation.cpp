@@ -0,0 +1,528 @@
+///////////////////////////////////////////////////////////////////////////////
+// vertexanimation.cpp
+// ============
+// draw large instanced schools of fish deformed by a baked animation texture
+///////////////////////////////////////////////////////////////////////////////
+
+#include "VertexAnimation.h"
+
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// identifies a baked vertex animation cache file and its layout
+	// version, raised whenever the mesh or the swim cycle changes
+	const uint32_t VAT_FILE_MAGIC = 0x31544156; // "VAT1"
+	const uint32_t VAT_FILE_VERSION = 1;
+
+	// rings along the body of the trout and vertices around each ring,
+	// the first vertex of a ring repeated at its end for the texture seam
+	const int VAT_BODY_RINGS = 20;
+	const int VAT_RING_VERTICES = 12;
+	// length of the body, from the nose at -0.5 along +x, with the
+	// tail fin making up the rest of the unit length
+	const float VAT_BODY_LENGTH = 0.8f;
+	// largest half height and half width of the body
+	const float VAT_BODY_HEIGHT = 0.2f;
+	const float VAT_BODY_WIDTH = 0.09f;
+
+	// length of one beat of the tail in seconds
+	const float VAT_CYCLE_SECONDS = 0.8f;
+	// sideways sway at the nose and at the tail, and the number of
+	// waves along the body at any moment
+	const float VAT_NOSE_SWAY = 0.015f;
+	const float VAT_TAIL_SWAY = 0.11f;
+	const float VAT_WAVES_ALONG_BODY = 0.9f;
+
+	// floats of each vertex of the mesh buffer - position, normal
+	// and texture coordinate, as in the basic shape meshes
+	const int VAT_VERTEX_FLOATS = 8;
+
+	/***********************************************************
+	 *  BuildTroutMesh()
+	 *
+	 *  Build the rest pose of the trout, a flattened body of
+	 *  revolution closed at the nose and narrowing towards the
+	 *  tail, with a forked tail fin made of two sheets facing
+	 *  opposite ways so both sides are lit.
+	 ***********************************************************/
+	void BuildTroutMesh(
+		std::vector<glm::vec3>& positions,
+		std::vector<glm::vec2>& texcoords,
+		std::vector<uint16_t>& indices)
+	{
+		const int ringSize = VAT_RING_VERTICES + 1;
+		for (int ring = 0; ring <= VAT_BODY_RINGS; ring++)
+		{
+			float t = static_cast<float>(ring) / VAT_BODY_RINGS;
+			// widest a third of the way back, narrowing to the tail
+			float profile = (sqrtf(t) * (1.0f - t) * 2.6f) + (0.05f * t);
+			float x = -0.5f + (t * VAT_BODY_LENGTH);
+			for (int i = 0; i < ringSize; i++)
+			{
+				float angle = glm::two_pi<float>() * i / VAT_RING_VERTICES;
+				positions.push_back(glm::vec3(
+					x,
+					VAT_BODY_HEIGHT * profile * sinf(angle),
+					VAT_BODY_WIDTH * profile * cosf(angle)));
+				texcoords.push_back(glm::vec2(t * VAT_BODY_LENGTH, static_cast<float>(i) / VAT_RING_VERTICES));
+			}
+		}
+		for (int ring = 0; ring < VAT_BODY_RINGS; ring++)
+		{
+			for (int i = 0; i < VAT_RING_VERTICES; i++)
+			{
+				uint16_t a = static_cast<uint16_t>((ring * ringSize) + i);
+				uint16_t b = static_cast<uint16_t>(a + ringSize);
+				indices.insert(indices.end(), { a, b, static_cast<uint16_t>(a + 1) });
+				indices.insert(indices.end(), { static_cast<uint16_t>(a + 1), b, static_cast<uint16_t>(b + 1) });
+			}
+		}
+
+		// tail fin from the end of the body, forked at the back
+		float finStart = -0.5f + VAT_BODY_LENGTH - 0.02f;
+		const glm::vec3 finPoints[5] =
+		{
+			glm::vec3(finStart, 0.02f, 0.0f),
+			glm::vec3(finStart, -0.02f, 0.0f),
+			glm::vec3(0.52f, 0.17f, 0.0f),
+			glm::vec3(0.52f, -0.17f, 0.0f),
+			glm::vec3(0.44f, 0.0f, 0.0f)
+		};
+		const uint16_t finTriangles[9] = { 0, 4, 2, 0, 1, 4, 1, 3, 4 };
+		for (int side = 0; side < 2; side++)
+		{
+			uint16_t first = static_cast<uint16_t>(positions.size());
+			float offset = (side == 0) ? 0.002f : -0.002f;
+			for (int i = 0; i < 5; i++)
+			{
+				positions.push_back(finPoints[i] + glm::vec3(0.0f, 0.0f, offset));
+				texcoords.push_back(glm::vec2(VAT_BODY_LENGTH + (finPoints[i].x - finStart), 0.5f + finPoints[i].y));
+			}
+			for (int i = 0; i < 9; i += 3)
+			{
+				if (side == 0)
+				{
+					indices.insert(indices.end(), { uint16_t(first + finTriangles[i]), uint16_t(first + finTriangles[i + 1]), uint16_t(first + finTriangles[i + 2]) });
+				}
+				else
+				{
+					indices.insert(indices.end(), { uint16_t(first + finTriangles[i]), uint16_t(first + finTriangles[i + 2]), uint16_t(first + finTriangles[i + 1]) });
+				}
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  ComputeNormals()
+	 *
+	 *  Compute the vertex normals of a deformed frame from the
+	 *  area weighted normals of the triangles around them.
+	 ***********************************************************/
+	void ComputeNormals(
+		const std::vector<glm::vec3>& positions,
+		const std::vector<uint16_t>& indices,
+		std::vector<glm::vec3>& normals)
+	{
+		normals.assign(positions.size(), glm::vec3(0.0f));
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			glm::vec3 faceNormal = glm::cross(
+				positions[indices[i + 1]] - positions[indices[i]],
+				positions[indices[i + 2]] - positions[indices[i]]);
+			normals[indices[i]] += faceNormal;
+			normals[indices[i + 1]] += faceNormal;
+			normals[indices[i + 2]] += faceNormal;
+		}
+		for (size_t i = 0; i < normals.size(); i++)
+		{
+			float length = glm::length(normals[i]);
+			normals[i] = (length > 0.0f) ? (normals[i] / length) : glm::vec3(-1.0f, 0.0f, 0.0f);
+		}
+	}
+}
+
+/***********************************************************
+ *  VertexAnimation()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+VertexAnimation::VertexAnimation()
+{
+	m_vertexBuffer = 0;
+	m_indexBuffer = 0;
+	m_vertexCount = 0;
+	m_indexCount = 0;
+	m_positionTexture = 0;
+	m_normalTexture = 0;
+	m_positionUnit = 0;
+	m_normalUnit = 0;
+	m_frameCount = 0;
+	m_duration = 1.0f;
+	m_boundsMin = glm::vec3(0.0f);
+	m_boundsMax = glm::vec3(0.0f);
+}
+
+/***********************************************************
+ *  ~VertexAnimation()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+VertexAnimation::~VertexAnimation()
+{
+	Close();
+}
+
+/***********************************************************
+ *  Bake()
+ *
+ *  This method is used for baking the swim cycle into the
+ *  cache file read by Open().  A wave runs down the body
+ *  from the nose, growing towards the tail, and each frame
+ *  stores the deformed position and the recomputed normal
+ *  of every vertex.  Baking is skipped when the cache file
+ *  has the current layout and frame count.
+ ***********************************************************/
+bool VertexAnimation::Bake(const char* cacheFile, int frameCount)
+{
+	// keep the existing cache file when it was baked the same way
+	{
+		std::ifstream cached(cacheFile, std::ios::binary);
+		uint32_t magic = 0;
+		uint32_t version = 0;
+		int32_t layout[3] = { 0 };
+		cached.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+		cached.read(reinterpret_cast<char*>(&version), sizeof(version));
+		cached.read(reinterpret_cast<char*>(layout), sizeof(layout));
+		if (cached && (magic == VAT_FILE_MAGIC) && (version == VAT_FILE_VERSION) && (layout[2] == frameCount))
+		{
+			return(true);
+		}
+	}
+
+	std::vector<glm::vec3> restPositions;
+	std::vector<glm::vec2> texcoords;
+	std::vector<uint16_t> indices;
+	BuildTroutMesh(restPositions, texcoords, indices);
+
+	const size_t vertexCount = restPositions.size();
+	std::vector<glm::vec4> framePositions(vertexCount * frameCount);
+	std::vector<glm::vec4> frameNormals(vertexCount * frameCount);
+	std::vector<glm::vec3> positions(vertexCount);
+	std::vector<glm::vec3> normals;
+	glm::vec3 boundsMin = glm::vec3(FLT_MAX);
+	glm::vec3 boundsMax = glm::vec3(-FLT_MAX);
+
+	for (int frame = 0; frame < frameCount; frame++)
+	{
+		float phase = glm::two_pi<float>() * frame / frameCount;
+		for (size_t i = 0; i < vertexCount; i++)
+		{
+			const glm::vec3& rest = restPositions[i];
+			float t = rest.x + 0.5f;
+			float sway = VAT_NOSE_SWAY + (VAT_TAIL_SWAY * t * t);
+			positions[i] = rest + glm::vec3(0.0f, 0.0f, sway * sinf(phase - (glm::two_pi<float>() * VAT_WAVES_ALONG_BODY * t)));
+			boundsMin = glm::min(boundsMin, positions[i]);
+			boundsMax = glm::max(boundsMax, positions[i]);
+		}
+		ComputeNormals(positions, indices, normals);
+
+		for (size_t i = 0; i < vertexCount; i++)
+		{
+			framePositions[(frame * vertexCount) + i] = glm::vec4(positions[i], 1.0f);
+			frameNormals[(frame * vertexCount) + i] = glm::vec4(normals[i], 0.0f);
+		}
+	}
+
+	std::ofstream file(cacheFile, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		std::cout << "Could not write vertex animation cache:" << cacheFile << std::endl;
+		return(false);
+	}
+
+	int32_t layout[3] = { static_cast<int32_t>(vertexCount), static_cast<int32_t>(indices.size()), frameCount };
+	float duration = VAT_CYCLE_SECONDS;
+	file.write(reinterpret_cast<const char*>(&VAT_FILE_MAGIC), sizeof(VAT_FILE_MAGIC));
+	file.write(reinterpret_cast<const char*>(&VAT_FILE_VERSION), sizeof(VAT_FILE_VERSION));
+	file.write(reinterpret_cast<const char*>(layout), sizeof(layout));
+	file.write(reinterpret_cast<const char*>(&duration), sizeof(duration));
+	file.write(reinterpret_cast<const char*>(&boundsMin), sizeof(boundsMin));
+	file.write(reinterpret_cast<const char*>(&boundsMax), sizeof(boundsMax));
+	file.write(reinterpret_cast<const char*>(texcoords.data()), texcoords.size() * sizeof(glm::vec2));
+	file.write(reinterpret_cast<const char*>(indices.data()), indices.size() * sizeof(uint16_t));
+	file.write(reinterpret_cast<const char*>(framePositions.data()), framePositions.size() * sizeof(glm::vec4));
+	file.write(reinterpret_cast<const char*>(frameNormals.data()), frameNormals.size() * sizeof(glm::vec4));
+	if (!file)
+	{
+		std::cout << "Could not write vertex animation cache:" << cacheFile << std::endl;
+		return(false);
+	}
+
+	std::cout << "Baked " << frameCount << " frames of " << vertexCount << " vertices into:" << cacheFile << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method is used for reading a baked cache file.  The
+ *  first frame becomes the vertex buffer of the mesh, so it
+ *  can still be drawn without the animation, and every
+ *  frame is uploaded into the position and normal textures.
+ *  They are sampled with texelFetch, so they are neither
+ *  filtered nor mipmapped.
+ ***********************************************************/
+bool VertexAnimation::Open(const char* cacheFile, int positionUnit, int normalUnit)
+{
+	Close();
+
+	std::ifstream file(cacheFile, std::ios::binary);
+	uint32_t magic = 0;
+	uint32_t version = 0;
+	int32_t layout[3] = { 0 };
+	float duration = 0.0f;
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+	file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+	file.read(reinterpret_cast<char*>(&version), sizeof(version));
+	file.read(reinterpret_cast<char*>(layout), sizeof(layout));
+	file.read(reinterpret_cast<char*>(&duration), sizeof(duration));
+	file.read(reinterpret_cast<char*>(&boundsMin), sizeof(boundsMin));
+	file.read(reinterpret_cast<char*>(&boundsMax), sizeof(boundsMax));
+	if (!file || (magic != VAT_FILE_MAGIC) || (version != VAT_FILE_VERSION) ||
+		(layout[0] <= 0) || (layout[0] > 65536) || (layout[1] <= 0) || (layout[2] <= 0) || (duration <= 0.0f))
+	{
+		std::cout << "Invalid vertex animation cache:" << cacheFile << std::endl;
+		return(false);
+	}
+
+	GLint maxTextureSize = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+	if ((layout[0] > maxTextureSize) || (layout[2] > maxTextureSize))
+	{
+		std::cout << "Vertex animation is too large for a texture:" << cacheFile << std::endl;
+		return(false);
+	}
+
+	const size_t vertexCount = layout[0];
+	const size_t frameTexels = vertexCount * layout[2];
+	std::vector<glm::vec2> texcoords(vertexCount);
+	std::vector<uint16_t> indices(layout[1]);
+	std::vector<glm::vec4> framePositions(frameTexels);
+	std::vector<glm::vec4> frameNormals(frameTexels);
+	file.read(reinterpret_cast<char*>(texcoords.data()), texcoords.size() * sizeof(glm::vec2));
+	file.read(reinterpret_cast<char*>(indices.data()), indices.size() * sizeof(uint16_t));
+	file.read(reinterpret_cast<char*>(framePositions.data()), framePositions.size() * sizeof(glm::vec4));
+	file.read(reinterpret_cast<char*>(frameNormals.data()), frameNormals.size() * sizeof(glm::vec4));
+	if (!file)
+	{
+		std::cout << "Could not read vertex animation cache:" << cacheFile << std::endl;
+		return(false);
+	}
+
+	m_vertexCount = layout[0];
+	m_indexCount = layout[1];
+	m_frameCount = layout[2];
+	m_duration = duration;
+	m_boundsMin = boundsMin;
+	m_boundsMax = boundsMax;
+	m_positionUnit = positionUnit;
+	m_normalUnit = normalUnit;
+
+	std::vector<float> vertices(vertexCount * VAT_VERTEX_FLOATS);
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		float* vertex = &vertices[i * VAT_VERTEX_FLOATS];
+		vertex[0] = framePositions[i].x;
+		vertex[1] = framePositions[i].y;
+		vertex[2] = framePositions[i].z;
+		vertex[3] = frameNormals[i].x;
+		vertex[4] = frameNormals[i].y;
+		vertex[5] = frameNormals[i].z;
+		vertex[6] = texcoords[i].x;
+		vertex[7] = texcoords[i].y;
+	}
+
+	glGenBuffers(1, &m_vertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	// the index buffer is bound to the vertex array of each school
+	glGenBuffers(1, &m_indexBuffer);
+
+	glActiveTexture(GL_TEXTURE0 + m_positionUnit);
+	glGenTextures(1, &m_positionTexture);
+	glBindTexture(GL_TEXTURE_2D, m_positionTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, m_vertexCount, m_frameCount, 0, GL_RGBA, GL_FLOAT, framePositions.data());
+
+	// normals keep enough precision in half floats, halving their size
+	glActiveTexture(GL_TEXTURE0 + m_normalUnit);
+	glGenTextures(1, &m_normalTexture);
+	glBindTexture(GL_TEXTURE_2D, m_normalTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, m_vertexCount, m_frameCount, 0, GL_RGBA, GL_FLOAT, frameNormals.data());
+
+	// the index buffer needs a vertex array bound to be filled
+	GLuint uploadArray = 0;
+	glGenVertexArrays(1, &uploadArray);
+	glBindVertexArray(uploadArray);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint16_t), indices.data(), GL_STATIC_DRAW);
+	glBindVertexArray(0);
+	glDeleteVertexArrays(1, &uploadArray);
+
+	return(true);
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method is used for freeing the mesh, the animation
+ *  textures and the buffers of every school.
+ ***********************************************************/
+void VertexAnimation::Close()
+{
+	for (int i = 0; i < m_schools.size(); i++)
+	{
+		glDeleteVertexArrays(1, &m_schools[i].vertexArray);
+		glDeleteBuffers(1, &m_schools[i].instanceBuffer);
+	}
+	m_schools.clear();
+
+	if (m_positionTexture != 0)
+	{
+		glDeleteTextures(1, &m_positionTexture);
+		glDeleteTextures(1, &m_normalTexture);
+		glDeleteBuffers(1, &m_vertexBuffer);
+		glDeleteBuffers(1, &m_indexBuffer);
+	}
+	m_positionTexture = 0;
+	m_normalTexture = 0;
+	m_vertexBuffer = 0;
+	m_indexBuffer = 0;
+}
+
+/***********************************************************
+ *  CreateSchool()
+ *
+ *  This method is used for creating the vertex array of a
+ *  school, reading the shared mesh per vertex and the
+ *  instance buffer of the school once per instance.
+ ***********************************************************/
+int VertexAnimation::CreateSchool(const std::vector<VERTEX_ANIMATION_INSTANCE>& instances)
+{
+	if (IsOpen() == false)
+	{
+		return(-1);
+	}
+
+	SCHOOL school;
+	school.instanceCount = static_cast<int>(instances.size());
+	glGenVertexArrays(1, &school.vertexArray);
+	glBindVertexArray(school.vertexArray);
+
+	const GLsizei stride = VAT_VERTEX_FLOATS * sizeof(float);
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(0));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(3 * sizeof(float)));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(6 * sizeof(float)));
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+
+	const GLsizei instanceStride = sizeof(VERTEX_ANIMATION_INSTANCE);
+	glGenBuffers(1, &school.instanceBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, school.instanceBuffer);
+	glBufferData(GL_ARRAY_BUFFER, instances.size() * instanceStride, instances.data(), GL_DYNAMIC_DRAW);
+	glEnableVertexAttribArray(3);
+	glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, instanceStride,
+		reinterpret_cast<void*>(offsetof(VERTEX_ANIMATION_INSTANCE, position)));
+	glVertexAttribDivisor(3, 1);
+	glEnableVertexAttribArray(4);
+	glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, instanceStride,
+		reinterpret_cast<void*>(offsetof(VERTEX_ANIMATION_INSTANCE, scale)));
+	glVertexAttribDivisor(4, 1);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	m_schools.push_back(school);
+	return(static_cast<int>(m_schools.size()) - 1);
+}
+
+/***********************************************************
+ *  UpdateSchool()
+ *
+ *  This method is used for replacing the instances of a
+ *  school, in place when their number is unchanged.
+ ***********************************************************/
+void VertexAnimation::UpdateSchool(int school, const std::vector<VERTEX_ANIMATION_INSTANCE>& instances)
+{
+	if ((school < 0) || (school >= m_schools.size()))
+	{
+		return;
+	}
+
+	SCHOOL& target = m_schools[school];
+	glBindBuffer(GL_ARRAY_BUFFER, target.instanceBuffer);
+	if (instances.size() == target.instanceCount)
+	{
+		glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(VERTEX_ANIMATION_INSTANCE), instances.data());
+	}
+	else
+	{
+		glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(VERTEX_ANIMATION_INSTANCE), instances.data(), GL_DYNAMIC_DRAW);
+		target.instanceCount = static_cast<int>(instances.size());
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/***********************************************************
+ *  Bind()
+ *
+ *  This method is used for binding the position and normal
+ *  textures to their texture units.
+ ***********************************************************/
+void VertexAnimation::Bind() const
+{
+	glActiveTexture(GL_TEXTURE0 + m_positionUnit);
+	glBindTexture(GL_TEXTURE_2D, m_positionTexture);
+	glActiveTexture(GL_TEXTURE0 + m_normalUnit);
+	glBindTexture(GL_TEXTURE_2D, m_normalTexture);
+}
+
+/***********************************************************
+ *  DrawSchool()
+ *
+ *  This method is used for drawing every fish of a school
+ *  with one instanced draw call.
+ ***********************************************************/
+void VertexAnimation::DrawSchool(int school) const
+{
+	if ((school < 0) || (school >= m_schools.size()) || (m_schools[school].instanceCount == 0))
+	{
+		return;
+	}
+
+	glBindVertexArray(m_schools[school].vertexArray);
+	glDrawElementsInstanced(GL_TRIANGLES, m_indexCount, GL_UNSIGNED_SHORT, NULL, m_schools[school].instanceCount);
+	glBindVertexArray(0);
+}
@@ -0,0 +1,117 @@
+///////////////////////////////////////////////////////////////////////////////
+// vertexanimation.h
+// ============
+// draw large instanced schools of fish deformed by a baked animation texture
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// one fish of a school, laid out as the two per-instance vertex
+// attributes the vertex shader reads
+struct VERTEX_ANIMATION_INSTANCE
+{
+	glm::vec3 position;
+	// rotation about the vertical axis in radians, the fish
+	// swims along -x when it is zero
+	float heading;
+	float scale;
+	// seconds into the cycle at time zero, so the fish of a
+	// school do not beat their tails in step
+	float timeOffset;
+	// rate the cycle is played at
+	float speed;
+	float padding;
+};
+
+/***********************************************************
+ *  VertexAnimation
+ *
+ *  This class draws a mesh deformed by a swim cycle that was
+ *  baked ahead of time.  The position and normal of every
+ *  vertex in every frame of the cycle are stored as the
+ *  texels of two float textures, one row per frame and one
+ *  column per vertex.  The vertex shader fetches the two
+ *  frames around the time of each instance and blends them,
+ *  so a school of thousands of fish is one instanced draw
+ *  with no skinning work on the CPU.  The instances of each
+ *  school are kept in a GPU buffer read as per-instance
+ *  vertex attributes.
+ ***********************************************************/
+class VertexAnimation
+{
+public:
+	// constructor
+	VertexAnimation();
+	// destructor
+	~VertexAnimation();
+
+	// bake the swim cycle of the trout mesh into the cache file,
+	// unless it is already current
+	static bool Bake(const char* cacheFile, int frameCount);
+
+	// read a baked cache file and create the mesh and the animation
+	// textures, which are bound to the passed in texture units
+	bool Open(const char* cacheFile, int positionUnit, int normalUnit);
+	// free the mesh, the animation textures and every school
+	void Close();
+
+	// create the instance buffer of a school, returns its index
+	int CreateSchool(const std::vector<VERTEX_ANIMATION_INSTANCE>& instances);
+	// replace the instances of a school
+	void UpdateSchool(int school, const std::vector<VERTEX_ANIMATION_INSTANCE>& instances);
+	// bind the animation textures to their texture units
+	void Bind() const;
+	// draw every instance of a school with the current shader values
+	void DrawSchool(int school) const;
+
+	// true once a cache file was opened
+	bool IsOpen() const { return(m_positionTexture != 0); }
+	// get the number of schools created
+	int GetSchoolCount() const { return(static_cast<int>(m_schools.size())); }
+	// get the number of instances of a school
+	int GetInstanceCount(int school) const { return(m_schools[school].instanceCount); }
+	// get the instance buffer of a school, for writing it on the GPU
+	GLuint GetInstanceBuffer(int school) const { return(m_schools[school].instanceBuffer); }
+	// get the number of baked frames and the length of the cycle in seconds
+	int GetFrameCount() const { return(m_frameCount); }
+	float GetDuration() const { return(m_duration); }
+	// get the bounds of the mesh over every frame of the cycle
+	const glm::vec3& GetBoundsMin() const { return(m_boundsMin); }
+	const glm::vec3& GetBoundsMax() const { return(m_boundsMax); }
+
+private:
+	// vertex array and instance buffer of one school
+	struct SCHOOL
+	{
+		GLuint vertexArray;
+		GLuint instanceBuffer;
+		int instanceCount;
+	};
+
+	// shared mesh buffers
+	GLuint m_vertexBuffer;
+	GLuint m_indexBuffer;
+	int m_vertexCount;
+	int m_indexCount;
+
+	// animation textures and the texture units they are bound to
+	GLuint m_positionTexture;
+	GLuint m_normalTexture;
+	int m_positionUnit;
+	int m_normalUnit;
+
+	// layout of the baked cycle
+	int m_frameCount;
+	float m_duration;
+	glm::vec3 m_boundsMin;
+	glm::vec3 m_boundsMax;
+
+	std::vector<SCHOOL> m_schools;
+};
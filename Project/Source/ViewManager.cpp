@@ -40,6 +40,77 @@ namespace
 	// the following variable is false when orthographic projection
 	// is off and true when it is on
 	bool bOrthographicProjection = false;
+
+	// the following variable is true when the scene lays down
+	// the opaque depth before shading, toggled with the V key
+	bool bDepthPrepass = true;
+
+	// the following variable is true when objects are tinted by
+	// their shading level-of-detail, toggled with the L key
+	bool bShadingTierDebug = false;
+
+	// the following variable is true when the fish schools of the
+	// aquarium variant of the scene are drawn, toggled with the F key
+	bool bAquarium = false;
+
+	// the following variable is true when the fish schools flock
+	// in compute shaders, toggled with the G key
+	bool bBoidCompute = false;
+
+	// the following variable is true when the lake around the
+	// table is simulated and drawn, toggled with the K key
+	bool bLake = false;
+
+	// the following variable is true when the terrain around the
+	// lake is drawn, toggled with the H key
+	bool bTerrain = false;
+
+	// the following variable is true when the terrain tiles along
+	// the predicted path of the camera are loaded ahead of time,
+	// toggled with the N key
+	bool bPrefetch = true;
+
+	// the following variable is true when grass and reeds grow on
+	// the terrain, toggled with the J key
+	bool bFoliage = false;
+
+	// the following variable is true when the sky is drawn and
+	// lights the scene, toggled with the Y key
+	bool bSky = false;
+
+	// the following variable is true when the screen is reflected in
+	// the smooth surfaces of the scene, toggled with the U key
+	bool bReflections = false;
+
+	// the following variable is true when the reflections are traced
+	// with a linear march instead of the depth pyramid, toggled with
+	// the I key
+	bool bLinearMarch = false;
+
+	// the following variable is true when the tackle shop display
+	// of fishing lines is hung behind the table, toggled with the
+	// T key
+	bool bTackleDisplay = false;
+
+	// the following variable is true when the tabletop props are
+	// knocked around as rigid bodies, toggled with the R key
+	bool bPhysics = false;
+
+	// the following variable is true when the B key was pressed
+	// and the bobber has not been thrown yet
+	bool bBobberThrowRequested = false;
+
+	// the following variable is true when the F5 key was pressed
+	// and the scene snapshot has not been saved yet
+	bool bSnapshotRequested = false;
+
+	// the following variable is true when the F6 key was pressed
+	// and the next scene layout has not been switched to yet
+	bool bSceneSwitchRequested = false;
+
+	// view and projection matrices of the current frame
+	glm::mat4 gViewMatrix = glm::mat4(1.0f);
+	glm::mat4 gProjectionMatrix = glm::mat4(1.0f);
 }
 
 /***********************************************************
@@ -60,6 +131,11 @@ ViewManager::ViewManager(
 	g_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);
 	g_pCamera->Zoom = 80;
 	g_pCamera->MovementSpeed = 20;
+
+	for (int i = 0; i <= GLFW_KEY_LAST; i++)
+	{
+		m_keyWasPressed[i] = false;
+	}
 }
 
 /***********************************************************
@@ -239,6 +315,130 @@ void ViewManager::ProcessKeyboardEvents()
 		// Zoom doesnt matter much for ortho, but can be used if desired.
 		g_pCamera->Zoom = 45.0f; 
 	}
+
+	// Toggle the depth pre-pass if the V key is pressed.
+	if (IsKeyNewlyPressed(GLFW_KEY_V))
+	{
+		bDepthPrepass = !bDepthPrepass;
+		std::cout << "Depth pre-pass " << (bDepthPrepass ? "enabled" : "disabled") << std::endl;
+	}
+
+	// Toggle the shading level-of-detail debug view if the L key is pressed.
+	if (IsKeyNewlyPressed(GLFW_KEY_L))
+	{
+		bShadingTierDebug = !bShadingTierDebug;
+	}
+
+	// Toggle the aquarium variant of the scene if the F key is pressed.
+	if (IsKeyNewlyPressed(GLFW_KEY_F))
+	{
+		bAquarium = !bAquarium;
+		std::cout << "Aquarium " << (bAquarium ? "enabled" : "disabled") << std::endl;
+	}
+
+	// Toggle flocking the fish schools on the GPU if the G key is pressed.
+	if (IsKeyNewlyPressed(GLFW_KEY_G))
+	{
+		bBoidCompute = !bBoidCompute;
+		std::cout << "Compute shader flocking " << (bBoidCompute ? "enabled" : "disabled") << std::endl;
+	}
+
+	// Toggle the lake around the table if the K key is pressed.
+	if (IsKeyNewlyPressed(GLFW_KEY_K))
+	{
+		bLake = !bLake;
+		std::cout << "Lake " << (bLake ? "enabled" : "disabled") << std::endl;
+	}
+
+	// Toggle the terrain around the lake if the H key is pressed.
+	if (IsKeyNewlyPressed(GLFW_KEY_H))
+	{
+		bTerrain = !bTerrain;
+		std::cout << "Terrain " << (bTerrain ? "enabled" : "disabled") << std::endl;
+	}
+
+	// Toggle the prefetch of the terrain tiles if the N key is pressed.
+	if (IsKeyNewlyPressed(GLFW_KEY_N))
+	{
+		bPrefetch = !bPrefetch;
+		std::cout << "Prefetch " << (bPrefetch ? "enabled" : "disabled") << std::endl;
+	}
+
+	// Toggle the grass and reeds on the terrain if the J key is pressed.
+	if (IsKeyNewlyPressed(GLFW_KEY_J))
+	{
+		bFoliage = !bFoliage;
+		std::cout << "Foliage " << (bFoliage ? "enabled" : "disabled") << std::endl;
+	}
+
+	// Toggle the sky if the Y key is pressed.
+	if (IsKeyNewlyPressed(GLFW_KEY_Y))
+	{
+		bSky = !bSky;
+		std::cout << "Sky " << (bSky ? "enabled" : "disabled") << std::endl;
+	}
+
+	// Toggle the screen-space reflections if the U key is pressed.
+	if (IsKeyNewlyPressed(GLFW_KEY_U))
+	{
+		bReflections = !bReflections;
+		std::cout << "Reflections " << (bReflections ? "enabled" : "disabled") << std::endl;
+	}
+
+	// Toggle the linear march of the reflections if the I key is pressed.
+	if (IsKeyNewlyPressed(GLFW_KEY_I))
+	{
+		bLinearMarch = !bLinearMarch;
+		std::cout << "Linear march " << (bLinearMarch ? "enabled" : "disabled") << std::endl;
+	}
+
+	// Toggle the tackle shop display if the T key is pressed.
+	if (IsKeyNewlyPressed(GLFW_KEY_T))
+	{
+		bTackleDisplay = !bTackleDisplay;
+		std::cout << "Tackle display " << (bTackleDisplay ? "enabled" : "disabled") << std::endl;
+	}
+
+	// Toggle the rigid body props if the R key is pressed.
+	if (IsKeyNewlyPressed(GLFW_KEY_R))
+	{
+		bPhysics = !bPhysics;
+		std::cout << "Physics " << (bPhysics ? "enabled" : "disabled") << std::endl;
+	}
+
+	// Throw a bobber at the props if the B key is pressed.
+	if (IsKeyNewlyPressed(GLFW_KEY_B))
+	{
+		bBobberThrowRequested = true;
+	}
+
+	// Request a scene snapshot if the F5 key is pressed.
+	if (IsKeyNewlyPressed(GLFW_KEY_F5))
+	{
+		bSnapshotRequested = true;
+	}
+
+	// Request the next scene layout if the F6 key is pressed.
+	if (IsKeyNewlyPressed(GLFW_KEY_F6))
+	{
+		bSceneSwitchRequested = true;
+	}
+}
+
+/***********************************************************
+ *  IsKeyNewlyPressed()
+ *
+ *  This method is used for detecting the moment a key goes
+ *  down, so toggles flip once per press instead of once per
+ *  frame while the key is held.
+ ***********************************************************/
+bool ViewManager::IsKeyNewlyPressed(int key)
+{
+	bool bPressed = (glfwGetKey(m_pWindow, key) == GLFW_PRESS);
+	bool bNewlyPressed = bPressed && (m_keyWasPressed[key] == false);
+	m_keyWasPressed[key] = bPressed;
+
+	return(bNewlyPressed);
 }
 
 /***********************************************************
@@ -275,15 +475,20 @@ void ViewManager::PrepareSceneView()
 	}
 	else
 	{
-		// Perspective setup.
+		// Perspective setup, reaching to the far edge of the terrain
+		// when it is drawn.
 		projection = glm::perspective(
 			glm::radians(g_pCamera->Zoom),
 			(GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT,
 			0.1f,
-			100.0f
+			bTerrain ? 4000.0f : 100.0f
 		);
 	}
 
+	// keep the matrices for the scene culling and level-of-detail
+	gViewMatrix = view;
+	gProjectionMatrix = projection;
+
 	// if the shader manager object is valid
 	if (NULL != m_pShaderManager)
 	{
@@ -294,4 +499,267 @@ void ViewManager::PrepareSceneView()
 		// set the view position of the camera into the shader for proper rendering
 		m_pShaderManager->setVec3Value("viewPosition", g_pCamera->Position);
 	}
-}
\ No newline at end of file
+}
+
+/***********************************************************
+ *  GetCameraPosition()
+ *
+ *  This method is used for getting the current world
+ *  position of the camera.
+ ***********************************************************/
+glm::vec3 ViewManager::GetCameraPosition()
+{
+	return(g_pCamera->Position);
+}
+
+/***********************************************************
+ *  IsDepthPrepassEnabled()
+ *
+ *  This method is used for getting whether the scene should
+ *  lay down the opaque depth before shading.
+ ***********************************************************/
+bool ViewManager::IsDepthPrepassEnabled()
+{
+	return(bDepthPrepass);
+}
+
+/***********************************************************
+ *  GetViewMatrix()
+ *
+ *  This method is used for getting the view matrix of the
+ *  current frame.
+ ***********************************************************/
+glm::mat4 ViewManager::GetViewMatrix()
+{
+	return(gViewMatrix);
+}
+
+/***********************************************************
+ *  GetProjectionMatrix()
+ *
+ *  This method is used for getting the projection matrix
+ *  of the current frame.
+ ***********************************************************/
+glm::mat4 ViewManager::GetProjectionMatrix()
+{
+	return(gProjectionMatrix);
+}
+
+/***********************************************************
+ *  IsShadingTierDebugEnabled()
+ *
+ *  This method is used for getting whether objects should
+ *  be tinted by their shading level-of-detail.
+ ***********************************************************/
+bool ViewManager::IsShadingTierDebugEnabled()
+{
+	return(bShadingTierDebug);
+}
+
+/***********************************************************
+ *  IsAquariumEnabled()
+ *
+ *  This method is used for getting whether the fish schools
+ *  of the aquarium variant of the scene should be drawn.
+ ***********************************************************/
+bool ViewManager::IsAquariumEnabled()
+{
+	return(bAquarium);
+}
+
+/***********************************************************
+ *  IsBoidComputeEnabled()
+ *
+ *  This method is used for getting whether the fish schools
+ *  should flock in compute shaders rather than on the CPU.
+ ***********************************************************/
+bool ViewManager::IsBoidComputeEnabled()
+{
+	return(bBoidCompute);
+}
+
+/***********************************************************
+ *  IsLakeEnabled()
+ *
+ *  This method is used for getting whether the lake around
+ *  the table should be simulated and drawn.
+ ***********************************************************/
+bool ViewManager::IsLakeEnabled()
+{
+	return(bLake);
+}
+
+/***********************************************************
+ *  IsTerrainEnabled()
+ *
+ *  This method is used for getting whether the terrain
+ *  around the lake should be drawn.
+ ***********************************************************/
+bool ViewManager::IsTerrainEnabled()
+{
+	return(bTerrain);
+}
+
+/***********************************************************
+ *  IsPrefetchEnabled()
+ *
+ *  This method is used for getting whether the terrain
+ *  tiles along the predicted path of the camera should be
+ *  loaded ahead of time.
+ ***********************************************************/
+bool ViewManager::IsPrefetchEnabled()
+{
+	return(bPrefetch);
+}
+
+/***********************************************************
+ *  IsFoliageEnabled()
+ *
+ *  This method is used for getting whether grass and reeds
+ *  should grow on the terrain.
+ ***********************************************************/
+bool ViewManager::IsFoliageEnabled()
+{
+	return(bFoliage);
+}
+
+/***********************************************************
+ *  IsSkyEnabled()
+ *
+ *  This method is used for getting whether the sky should
+ *  be drawn and light the scene.
+ ***********************************************************/
+bool ViewManager::IsSkyEnabled()
+{
+	return(bSky);
+}
+
+/***********************************************************
+ *  IsReflectionsEnabled()
+ *
+ *  This method is used for getting whether the screen should
+ *  be reflected in the smooth surfaces of the scene.
+ ***********************************************************/
+bool ViewManager::IsReflectionsEnabled()
+{
+	return(bReflections);
+}
+
+/***********************************************************
+ *  IsLinearMarchEnabled()
+ *
+ *  This method is used for getting whether the reflections
+ *  should be traced with a linear march.
+ ***********************************************************/
+bool ViewManager::IsLinearMarchEnabled()
+{
+	return(bLinearMarch);
+}
+
+/***********************************************************
+ *  IsTackleDisplayEnabled()
+ *
+ *  This method is used for getting whether the tackle shop
+ *  display of fishing lines should be hung behind the table.
+ ***********************************************************/
+bool ViewManager::IsTackleDisplayEnabled()
+{
+	return(bTackleDisplay);
+}
+
+/***********************************************************
+ *  IsPhysicsEnabled()
+ *
+ *  This method is used for getting whether the tabletop
+ *  props should be knocked around as rigid bodies.
+ ***********************************************************/
+bool ViewManager::IsPhysicsEnabled()
+{
+	return(bPhysics);
+}
+
+/***********************************************************
+ *  IsBobberThrowRequested()
+ *
+ *  This method is used for getting whether a bobber should
+ *  be thrown at the props, clearing the request.
+ ***********************************************************/
+bool ViewManager::IsBobberThrowRequested()
+{
+	bool bRequested = bBobberThrowRequested;
+	bBobberThrowRequested = false;
+	return(bRequested);
+}
+
+/***********************************************************
+ *  IsSnapshotRequested()
+ *
+ *  This method is used for getting whether a scene snapshot
+ *  was requested, clearing the request.
+ ***********************************************************/
+bool ViewManager::IsSnapshotRequested()
+{
+	bool bRequested = bSnapshotRequested;
+	bSnapshotRequested = false;
+	return(bRequested);
+}
+
+/***********************************************************
+ *  IsSceneSwitchRequested()
+ *
+ *  This method is used for getting whether the next scene
+ *  layout was requested.  The request stays pending until
+ *  it is cleared, so a press made while the next layout is
+ *  still loading switches as soon as it is ready.
+ ***********************************************************/
+bool ViewManager::IsSceneSwitchRequested()
+{
+	return(bSceneSwitchRequested);
+}
+
+/***********************************************************
+ *  ClearSceneSwitchRequest()
+ *
+ *  This method is used for clearing the request for the
+ *  next scene layout once it was switched to.
+ ***********************************************************/
+void ViewManager::ClearSceneSwitchRequest()
+{
+	bSceneSwitchRequested = false;
+}
+
+/***********************************************************
+ *  GetCameraSnapshot()
+ *
+ *  This method is used for getting the camera state that is
+ *  saved along with the scene.
+ ***********************************************************/
+void ViewManager::GetCameraSnapshot(SNAPSHOT_CAMERA& camera)
+{
+	camera.position = g_pCamera->Position;
+	camera.front = g_pCamera->Front;
+	camera.up = g_pCamera->Up;
+	camera.yaw = g_pCamera->Yaw;
+	camera.pitch = g_pCamera->Pitch;
+	camera.zoom = g_pCamera->Zoom;
+	camera.movementSpeed = g_pCamera->MovementSpeed;
+	camera.bOrthographic = bOrthographicProjection;
+}
+
+/***********************************************************
+ *  SetCameraSnapshot()
+ *
+ *  This method is used for putting the camera back into a
+ *  state saved along with the scene.
+ ***********************************************************/
+void ViewManager::SetCameraSnapshot(const SNAPSHOT_CAMERA& camera)
+{
+	g_pCamera->Position = camera.position;
+	g_pCamera->Front = camera.front;
+	g_pCamera->Up = camera.up;
+	g_pCamera->Yaw = camera.yaw;
+	g_pCamera->Pitch = camera.pitch;
+	g_pCamera->Zoom = camera.zoom;
+	g_pCamera->MovementSpeed = camera.movementSpeed;
+	bOrthographicProjection = (camera.bOrthographic != 0);
+}
@@ -10,6 +10,7 @@
 #pragma once
 
 #include "ShaderManager.h"
+#include "SceneSnapshot.h"
 #include "camera.h"
 
 // GLFW library
@@ -36,8 +37,13 @@ private:
 	// active OpenGL display window
 	GLFWwindow* m_pWindow;
 
+	// key states from the previous frame, for detecting new presses
+	bool m_keyWasPressed[GLFW_KEY_LAST + 1];
+
 	// process keyboard events for interaction with the 3D scene
 	void ProcessKeyboardEvents();
+	// true only on the frame the key goes down
+	bool IsKeyNewlyPressed(int key);
 
 public:
 	// create the initial OpenGL display window
@@ -45,4 +51,64 @@ public:
 	
 	// prepare the conversion from 3D object display to 2D scene display
 	void PrepareSceneView();
+
+	// get the current world position of the camera
+	glm::vec3 GetCameraPosition();
+
+	// get the view and projection matrices of the current frame
+	glm::mat4 GetViewMatrix();
+	glm::mat4 GetProjectionMatrix();
+
+	// true when the scene should lay down depth before shading
+	bool IsDepthPrepassEnabled();
+
+	// true when objects should be tinted by their shading tier
+	bool IsShadingTierDebugEnabled();
+
+	// true when the fish schools of the aquarium should be drawn
+	bool IsAquariumEnabled();
+
+	// true when the fish schools should flock in compute shaders
+	bool IsBoidComputeEnabled();
+
+	// true when the lake around the table should be drawn
+	bool IsLakeEnabled();
+
+	// true when the terrain around the lake should be drawn
+	bool IsTerrainEnabled();
+
+	// true when the terrain tiles ahead of the camera should be prefetched
+	bool IsPrefetchEnabled();
+
+	// true when grass and reeds should grow on the terrain
+	bool IsFoliageEnabled();
+
+	// true when the sky should be drawn and light the scene
+	bool IsSkyEnabled();
+
+	// true when the screen should be reflected in the smooth surfaces
+	bool IsReflectionsEnabled();
+
+	// true when the reflections should be traced with a linear march
+	bool IsLinearMarchEnabled();
+
+	// true when the tackle shop display of fishing lines should be drawn
+	bool IsTackleDisplayEnabled();
+
+	// true when the tabletop props should be knocked around as rigid bodies
+	bool IsPhysicsEnabled();
+
+	// true once for each press of the bobber throw key
+	bool IsBobberThrowRequested();
+
+	// true once for each press of the snapshot key
+	bool IsSnapshotRequested();
+
+	// true from a press of the next scene key until it is cleared
+	bool IsSceneSwitchRequested();
+	void ClearSceneSwitchRequest();
+
+	// get or replace the camera state saved in scene snapshots
+	void GetCameraSnapshot(SNAPSHOT_CAMERA& camera);
+	void SetCameraSnapshot(const SNAPSHOT_CAMERA& camera);
 };
\ No newline at end of file
@@ -0,0 +1,725 @@
+///////////////////////////////////////////////////////////////////////////////
+// virtualtexture.cpp
+// ============
+// stream the tiles of a very large texture into a fixed size GPU tile cache
+///////////////////////////////////////////////////////////////////////////////
+
+#include "VirtualTexture.h"
+
+#include "stb_image.h"
+
+#include <algorithm>
+#include <climits>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+// declaration of global variables
+namespace
+{
+	// identifies a cooked virtual texture cache file and its layout version
+	const uint32_t VT_FILE_MAGIC = 0x31435456; // "VTC1"
+	const uint32_t VT_FILE_VERSION = 1;
+
+	// texels of image content along each side of a tile, and the
+	// texels repeated around it so bilinear filtering never reads
+	// from a neighboring slot of the physical cache
+	const int VT_TILE_SIZE = 128;
+	const int VT_TILE_BORDER = 4;
+	// the physical cache holds this many tiles along each side
+	const int VT_CACHE_TILES = 8;
+	// page coordinates are stored in bytes in the page table
+	const int VT_MAX_PAGES = 256;
+
+	// limits on the streaming work done for each frame
+	const int VT_MAX_UPLOADS_PER_FRAME = 8;
+	const int VT_MAX_LOADS_IN_FLIGHT = 16;
+
+	// size in bytes of the cache file header
+	const uint64_t VT_HEADER_SIZE = (sizeof(uint32_t) * 2) + sizeof(uint64_t) + (sizeof(int32_t) * 4);
+
+	/***********************************************************
+	 *  RunParallel()
+	 *
+	 *  Run the loop on the job system when there is one.
+	 ***********************************************************/
+	void RunParallel(
+		JobSystem* pJobSystem,
+		size_t count,
+		size_t grainSize,
+		const std::function<void(size_t begin, size_t end)>& func)
+	{
+		if (NULL != pJobSystem)
+		{
+			pJobSystem->ParallelFor(count, grainSize, func);
+		}
+		else
+		{
+			func(0, count);
+		}
+	}
+
+	/***********************************************************
+	 *  HashSourceFile()
+	 *
+	 *  Hash the size and modification time of the source image
+	 *  with 64-bit FNV-1a, so an edited image is cooked again.
+	 ***********************************************************/
+	uint64_t HashSourceFile(const char* sourceFile)
+	{
+		std::error_code error;
+		uint64_t fileSize = std::filesystem::file_size(sourceFile, error);
+		if (error)
+		{
+			return(0);
+		}
+		int64_t writeTime = std::filesystem::last_write_time(sourceFile, error).time_since_epoch().count();
+
+		uint64_t hash = 14695981039346656037ull;
+		auto hashBytes = [&hash](const void* data, size_t size)
+			{
+				const uint8_t* bytes = static_cast<const uint8_t*>(data);
+				for (size_t i = 0; i < size; i++)
+				{
+					hash ^= bytes[i];
+					hash *= 1099511628211ull;
+				}
+			};
+
+		hashBytes(&VT_FILE_VERSION, sizeof(VT_FILE_VERSION));
+		hashBytes(&VT_TILE_SIZE, sizeof(VT_TILE_SIZE));
+		hashBytes(&VT_TILE_BORDER, sizeof(VT_TILE_BORDER));
+		hashBytes(&fileSize, sizeof(fileSize));
+		hashBytes(&writeTime, sizeof(writeTime));
+		return(hash);
+	}
+}
+
+/***********************************************************
+ *  VirtualTexture()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+VirtualTexture::VirtualTexture()
+{
+	m_pJobSystem = NULL;
+	m_virtualSize = 0;
+	m_mipCount = 0;
+	m_tileSize = VT_TILE_SIZE;
+	m_tileBorder = VT_TILE_BORDER;
+	m_physicalTexture = 0;
+	m_pageTableTexture = 0;
+	m_physicalUnit = 0;
+	m_pageTableUnit = 0;
+	m_bPageTableDirty = false;
+	m_loadsInFlight = 0;
+}
+
+/***********************************************************
+ *  ~VirtualTexture()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+VirtualTexture::~VirtualTexture()
+{
+	// the workers write into this object, so let them finish
+	while (m_loadsInFlight.load() > 0)
+	{
+		std::this_thread::yield();
+	}
+
+	if (m_physicalTexture != 0)
+	{
+		glDeleteTextures(1, &m_physicalTexture);
+	}
+	if (m_pageTableTexture != 0)
+	{
+		glDeleteTextures(1, &m_pageTableTexture);
+	}
+}
+
+/***********************************************************
+ *  Cook()
+ *
+ *  This method is used for converting a source image into
+ *  the tiled cache file read by Open().  The image is
+ *  stretched to a square power of two, and every mip level
+ *  is cut into tiles with a border taken from the wrapped
+ *  neighboring texels, so tiles filter seamlessly across
+ *  their edges and across the repeat of the texture.
+ ***********************************************************/
+bool VirtualTexture::Cook(const char* sourceFile, const char* cacheFile, JobSystem* pJobSystem)
+{
+	uint64_t sourceHash = HashSourceFile(sourceFile);
+	if (sourceHash == 0)
+	{
+		std::cout << "Could not find virtual texture source:" << sourceFile << std::endl;
+		return(false);
+	}
+
+	// keep the existing cache file when it was cooked from this image
+	{
+		std::ifstream cached(cacheFile, std::ios::binary);
+		uint32_t magic = 0;
+		uint32_t version = 0;
+		uint64_t cachedHash = 0;
+		cached.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+		cached.read(reinterpret_cast<char*>(&version), sizeof(version));
+		cached.read(reinterpret_cast<char*>(&cachedHash), sizeof(cachedHash));
+		if (cached && (magic == VT_FILE_MAGIC) && (version == VT_FILE_VERSION) && (cachedHash == sourceHash))
+		{
+			return(true);
+		}
+	}
+
+	int width = 0;
+	int height = 0;
+	int colorChannels = 0;
+	stbi_set_flip_vertically_on_load(true);
+	unsigned char* image = stbi_load(sourceFile, &width, &height, &colorChannels, 4);
+	if (!image)
+	{
+		std::cout << "Could not load image:" << sourceFile << std::endl;
+		return(false);
+	}
+
+	int virtualSize = VT_TILE_SIZE;
+	while ((virtualSize < std::max(width, height)) && (virtualSize < VT_TILE_SIZE * VT_MAX_PAGES))
+	{
+		virtualSize *= 2;
+	}
+	int mipCount = 1;
+	while ((VT_TILE_SIZE << (mipCount - 1)) < virtualSize)
+	{
+		mipCount++;
+	}
+
+	// stretch the image over the virtual size with bilinear filtering
+	std::vector<uint8_t> level(static_cast<size_t>(virtualSize) * virtualSize * 4);
+	RunParallel(pJobSystem, virtualSize, 16, [&](size_t begin, size_t end)
+		{
+			for (size_t y = begin; y < end; y++)
+			{
+				float sourceY = std::clamp(((y + 0.5f) * height / virtualSize) - 0.5f, 0.0f, height - 1.0f);
+				int y0 = static_cast<int>(sourceY);
+				int y1 = std::min(y0 + 1, height - 1);
+				float fy = sourceY - y0;
+				for (int x = 0; x < virtualSize; x++)
+				{
+					float sourceX = std::clamp(((x + 0.5f) * width / virtualSize) - 0.5f, 0.0f, width - 1.0f);
+					int x0 = static_cast<int>(sourceX);
+					int x1 = std::min(x0 + 1, width - 1);
+					float fx = sourceX - x0;
+					for (int channel = 0; channel < 4; channel++)
+					{
+						float top = (image[((y0 * width) + x0) * 4 + channel] * (1.0f - fx)) + (image[((y0 * width) + x1) * 4 + channel] * fx);
+						float bottom = (image[((y1 * width) + x0) * 4 + channel] * (1.0f - fx)) + (image[((y1 * width) + x1) * 4 + channel] * fx);
+						level[((y * virtualSize) + x) * 4 + channel] = static_cast<uint8_t>((top * (1.0f - fy)) + (bottom * fy) + 0.5f);
+					}
+				}
+			}
+		});
+	stbi_image_free(image);
+
+	std::ofstream file(cacheFile, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		std::cout << "Could not write virtual texture cache:" << cacheFile << std::endl;
+		return(false);
+	}
+
+	int32_t layout[4] = { virtualSize, mipCount, VT_TILE_SIZE, VT_TILE_BORDER };
+	file.write(reinterpret_cast<const char*>(&VT_FILE_MAGIC), sizeof(VT_FILE_MAGIC));
+	file.write(reinterpret_cast<const char*>(&VT_FILE_VERSION), sizeof(VT_FILE_VERSION));
+	file.write(reinterpret_cast<const char*>(&sourceHash), sizeof(sourceHash));
+	file.write(reinterpret_cast<const char*>(layout), sizeof(layout));
+
+	const int paddedSize = VT_TILE_SIZE + (2 * VT_TILE_BORDER);
+	const size_t tileBytes = static_cast<size_t>(paddedSize) * paddedSize * 4;
+	std::vector<uint8_t> rowTiles;
+	std::vector<uint8_t> nextLevel;
+
+	for (int mip = 0; mip < mipCount; mip++)
+	{
+		int levelSize = virtualSize >> mip;
+		int pages = levelSize / VT_TILE_SIZE;
+
+		// write the tiles one row of pages at a time
+		rowTiles.resize(pages * tileBytes);
+		for (int pageY = 0; pageY < pages; pageY++)
+		{
+			RunParallel(pJobSystem, pages, 1, [&](size_t begin, size_t end)
+				{
+					for (size_t pageX = begin; pageX < end; pageX++)
+					{
+						uint8_t* tile = &rowTiles[pageX * tileBytes];
+						for (int y = 0; y < paddedSize; y++)
+						{
+							int sourceY = ((pageY * VT_TILE_SIZE) - VT_TILE_BORDER + y + levelSize) % levelSize;
+							for (int x = 0; x < paddedSize; x++)
+							{
+								int sourceX = ((static_cast<int>(pageX) * VT_TILE_SIZE) - VT_TILE_BORDER + x + levelSize) % levelSize;
+								const uint8_t* texel = &level[((static_cast<size_t>(sourceY) * levelSize) + sourceX) * 4];
+								std::copy(texel, texel + 4, &tile[((y * paddedSize) + x) * 4]);
+							}
+						}
+					}
+				});
+			file.write(reinterpret_cast<const char*>(rowTiles.data()), rowTiles.size());
+		}
+
+		// average each 2x2 block of texels into the next mip level
+		if (mip + 1 < mipCount)
+		{
+			int nextSize = levelSize / 2;
+			nextLevel.resize(static_cast<size_t>(nextSize) * nextSize * 4);
+			RunParallel(pJobSystem, nextSize, 16, [&](size_t begin, size_t end)
+				{
+					for (size_t y = begin; y < end; y++)
+					{
+						for (int x = 0; x < nextSize; x++)
+						{
+							for (int channel = 0; channel < 4; channel++)
+							{
+								int sum =
+									level[((((y * 2) + 0) * levelSize) + (x * 2) + 0) * 4 + channel] +
+									level[((((y * 2) + 0) * levelSize) + (x * 2) + 1) * 4 + channel] +
+									level[((((y * 2) + 1) * levelSize) + (x * 2) + 0) * 4 + channel] +
+									level[((((y * 2) + 1) * levelSize) + (x * 2) + 1) * 4 + channel];
+								nextLevel[((y * nextSize) + x) * 4 + channel] = static_cast<uint8_t>((sum + 2) / 4);
+							}
+						}
+					}
+				});
+			level.swap(nextLevel);
+		}
+	}
+
+	std::cout << "Cooked virtual texture:" << sourceFile << ", size:" << virtualSize
+		<< ", mips:" << mipCount << std::endl;
+
+	return(file.good());
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method is used for reading the layout of a cooked
+ *  cache file and creating the GPU textures.  The single
+ *  tile of the coarsest mip is loaded right away and never
+ *  evicted, so every page always has a tile to fall back to.
+ ***********************************************************/
+bool VirtualTexture::Open(
+	const char* cacheFile,
+	std::string tag,
+	int physicalUnit,
+	int pageTableUnit,
+	JobSystem* pJobSystem)
+{
+	std::ifstream file(cacheFile, std::ios::binary);
+	if (!file)
+	{
+		std::cout << "Could not open virtual texture cache:" << cacheFile << std::endl;
+		return(false);
+	}
+
+	uint32_t magic = 0;
+	uint32_t version = 0;
+	uint64_t sourceHash = 0;
+	int32_t layout[4] = { 0 };
+	file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+	file.read(reinterpret_cast<char*>(&version), sizeof(version));
+	file.read(reinterpret_cast<char*>(&sourceHash), sizeof(sourceHash));
+	file.read(reinterpret_cast<char*>(layout), sizeof(layout));
+	if (!file || (magic != VT_FILE_MAGIC) || (version != VT_FILE_VERSION) ||
+		(layout[2] != VT_TILE_SIZE) || (layout[3] != VT_TILE_BORDER))
+	{
+		std::cout << "Invalid virtual texture cache:" << cacheFile << std::endl;
+		return(false);
+	}
+
+	m_cacheFile = cacheFile;
+	m_tag = tag;
+	m_pJobSystem = pJobSystem;
+	m_physicalUnit = physicalUnit;
+	m_pageTableUnit = pageTableUnit;
+	m_virtualSize = layout[0];
+	m_mipCount = layout[1];
+
+	const int paddedSize = m_tileSize + (2 * m_tileBorder);
+	const uint64_t tileBytes = static_cast<uint64_t>(paddedSize) * paddedSize * 4;
+	uint64_t offset = VT_HEADER_SIZE;
+	m_mipOffsets.resize(m_mipCount);
+	m_residentSlots.resize(m_mipCount);
+	m_pendingPages.resize(m_mipCount);
+	for (int mip = 0; mip < m_mipCount; mip++)
+	{
+		int pages = GetPageCount(mip);
+		m_mipOffsets[mip] = offset;
+		offset += static_cast<uint64_t>(pages) * pages * tileBytes;
+		m_residentSlots[mip].assign(pages * pages, -1);
+		m_pendingPages[mip].assign(pages * pages, false);
+	}
+
+	CACHE_SLOT freeSlot = { -1, 0, 0, -1 };
+	m_slots.assign(VT_CACHE_TILES * VT_CACHE_TILES, freeSlot);
+
+	// the physical cache, a fixed size no matter how big the texture is
+	glActiveTexture(GL_TEXTURE0 + m_physicalUnit);
+	glGenTextures(1, &m_physicalTexture);
+	glBindTexture(GL_TEXTURE_2D, m_physicalTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, GetCacheSize(), GetCacheSize(), 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+	// the page table, with one texel per page in each mip level
+	glActiveTexture(GL_TEXTURE0 + m_pageTableUnit);
+	glGenTextures(1, &m_pageTableTexture);
+	glBindTexture(GL_TEXTURE_2D, m_pageTableTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, m_mipCount - 1);
+	for (int mip = 0; mip < m_mipCount; mip++)
+	{
+		glTexImage2D(GL_TEXTURE_2D, mip, GL_RGBA8, GetPageCount(mip), GetPageCount(mip), 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	}
+
+	LOADED_TILE coarsest;
+	coarsest.mip = m_mipCount - 1;
+	coarsest.pageX = 0;
+	coarsest.pageY = 0;
+	if ((ReadTile(coarsest.mip, 0, 0, coarsest.texels) == false) ||
+		(UploadTile(coarsest, 0) == false))
+	{
+		std::cout << "Could not read virtual texture cache:" << cacheFile << std::endl;
+		return(false);
+	}
+	m_slots[m_residentSlots[coarsest.mip][0]].lastUsedFrame = INT_MAX;
+	UpdatePageTable();
+
+	std::cout << "Opened virtual texture:" << m_tag << ", size:" << m_virtualSize
+		<< ", cache:" << GetCacheSize() << "x" << GetCacheSize() << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  RequestPage()
+ *
+ *  This method is used for marking a page as seen on screen.
+ *  Every coarser page covering it is requested as well, so
+ *  the fallback improves step by step while loading.
+ ***********************************************************/
+void VirtualTexture::RequestPage(int pageX, int pageY, int mip, int frame)
+{
+	if ((mip < 0) || (mip >= m_mipCount) ||
+		(pageX < 0) || (pageY < 0) ||
+		(pageX >= GetPageCount(mip)) || (pageY >= GetPageCount(mip)))
+	{
+		return;
+	}
+
+	for (; mip < m_mipCount; mip++)
+	{
+		int index = (pageY * GetPageCount(mip)) + pageX;
+		int slot = m_residentSlots[mip][index];
+		if (slot >= 0)
+		{
+			m_slots[slot].lastUsedFrame = std::max(m_slots[slot].lastUsedFrame, frame);
+		}
+		else if (m_pendingPages[mip][index] == false)
+		{
+			m_pendingPages[mip][index] = true;
+			m_requests.push_back(glm::ivec3(pageX, pageY, mip));
+		}
+		pageX >>= 1;
+		pageY >>= 1;
+	}
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for uploading the tiles the workers
+ *  have finished loading, within a per-frame budget, and
+ *  handing the new requests to the workers.
+ ***********************************************************/
+void VirtualTexture::Update(int frame)
+{
+	std::vector<LOADED_TILE> loaded;
+	{
+		std::lock_guard<std::mutex> lock(m_loadedMutex);
+		loaded.swap(m_loadedTiles);
+	}
+
+	int uploads = 0;
+	for (size_t i = 0; i < loaded.size(); i++)
+	{
+		LOADED_TILE& tile = loaded[i];
+		if (uploads >= VT_MAX_UPLOADS_PER_FRAME)
+		{
+			// over budget, so keep the tile for the next frame
+			std::lock_guard<std::mutex> lock(m_loadedMutex);
+			m_loadedTiles.push_back(std::move(tile));
+			continue;
+		}
+
+		// a tile that could not be read or placed is requested again
+		// by the feedback pass if it is still on screen
+		int index = (tile.pageY * GetPageCount(tile.mip)) + tile.pageX;
+		m_pendingPages[tile.mip][index] = false;
+		if (tile.texels.size() > 0)
+		{
+			UploadTile(tile, frame);
+			uploads++;
+		}
+	}
+
+	if (m_bPageTableDirty == true)
+	{
+		UpdatePageTable();
+	}
+
+	// load the coarse pages first, since they cover the most screen
+	std::sort(m_requests.begin(), m_requests.end(), [](const glm::ivec3& a, const glm::ivec3& b)
+		{
+			return(a.z > b.z);
+		});
+
+	for (size_t i = 0; i < m_requests.size(); i++)
+	{
+		int pageX = m_requests[i].x;
+		int pageY = m_requests[i].y;
+		int mip = m_requests[i].z;
+
+		if (m_loadsInFlight.load() >= VT_MAX_LOADS_IN_FLIGHT)
+		{
+			// dropped, the next feedback pass asks again if still needed
+			m_pendingPages[mip][(pageY * GetPageCount(mip)) + pageX] = false;
+			continue;
+		}
+
+		m_loadsInFlight++;
+		auto loadTile = [this, pageX, pageY, mip]()
+			{
+				LOADED_TILE tile;
+				tile.mip = mip;
+				tile.pageX = pageX;
+				tile.pageY = pageY;
+				if (ReadTile(mip, pageX, pageY, tile.texels) == false)
+				{
+					tile.texels.clear();
+				}
+				{
+					std::lock_guard<std::mutex> lock(m_loadedMutex);
+					m_loadedTiles.push_back(std::move(tile));
+				}
+				m_loadsInFlight--;
+			};
+
+		if (NULL != m_pJobSystem)
+		{
+			m_pJobSystem->Submit(loadTile);
+		}
+		else
+		{
+			loadTile();
+		}
+	}
+	m_requests.clear();
+}
+
+/***********************************************************
+ *  Bind()
+ *
+ *  This method is used for binding the tile cache and the
+ *  page table for the next draw command.
+ ***********************************************************/
+void VirtualTexture::Bind() const
+{
+	glActiveTexture(GL_TEXTURE0 + m_physicalUnit);
+	glBindTexture(GL_TEXTURE_2D, m_physicalTexture);
+	glActiveTexture(GL_TEXTURE0 + m_pageTableUnit);
+	glBindTexture(GL_TEXTURE_2D, m_pageTableTexture);
+}
+
+/***********************************************************
+ *  GetCacheSize()
+ *
+ *  This method is used for getting the width and height of
+ *  the physical tile cache in texels.
+ ***********************************************************/
+int VirtualTexture::GetCacheSize() const
+{
+	return(VT_CACHE_TILES * (m_tileSize + (2 * m_tileBorder)));
+}
+
+/***********************************************************
+ *  GetResidentCount()
+ *
+ *  This method is used for counting the occupied slots of
+ *  the physical tile cache.
+ ***********************************************************/
+int VirtualTexture::GetResidentCount() const
+{
+	int count = 0;
+	for (size_t i = 0; i < m_slots.size(); i++)
+	{
+		if (m_slots[i].mip >= 0)
+		{
+			count++;
+		}
+	}
+	return(count);
+}
+
+/***********************************************************
+ *  GetPageCount()
+ *
+ *  This method is used for getting the number of pages
+ *  along each side of a mip level.
+ ***********************************************************/
+int VirtualTexture::GetPageCount(int mip) const
+{
+	return(std::max((m_virtualSize / m_tileSize) >> mip, 1));
+}
+
+/***********************************************************
+ *  ReadTile()
+ *
+ *  This method is used for reading the bordered texels of
+ *  a tile from the cache file.  It is called by the workers,
+ *  so it only reads members that never change after Open().
+ ***********************************************************/
+bool VirtualTexture::ReadTile(int mip, int pageX, int pageY, std::vector<uint8_t>& texels) const
+{
+	std::ifstream file(m_cacheFile, std::ios::binary);
+	if (!file)
+	{
+		return(false);
+	}
+
+	const int paddedSize = m_tileSize + (2 * m_tileBorder);
+	const uint64_t tileBytes = static_cast<uint64_t>(paddedSize) * paddedSize * 4;
+	uint64_t tileIndex = (static_cast<uint64_t>(pageY) * GetPageCount(mip)) + pageX;
+
+	texels.resize(tileBytes);
+	file.seekg(m_mipOffsets[mip] + (tileIndex * tileBytes));
+	file.read(reinterpret_cast<char*>(texels.data()), tileBytes);
+	return(file.good());
+}
+
+/***********************************************************
+ *  UploadTile()
+ *
+ *  This method is used for copying a tile into a free slot
+ *  of the physical cache, or else into the slot of the page
+ *  seen least recently.  Pages seen in the current frame are
+ *  never evicted, so a full cache cannot thrash.
+ ***********************************************************/
+bool VirtualTexture::UploadTile(const LOADED_TILE& tile, int frame)
+{
+	int slot = -1;
+	for (int i = 0; i < m_slots.size(); i++)
+	{
+		if (m_slots[i].mip < 0)
+		{
+			slot = i;
+			break;
+		}
+		if ((m_slots[i].lastUsedFrame < frame) &&
+			((slot < 0) || (m_slots[i].lastUsedFrame < m_slots[slot].lastUsedFrame)))
+		{
+			slot = i;
+		}
+	}
+	if (slot < 0)
+	{
+		return(false);
+	}
+
+	// evict the page held by the slot
+	CACHE_SLOT& cacheSlot = m_slots[slot];
+	if (cacheSlot.mip >= 0)
+	{
+		m_residentSlots[cacheSlot.mip][(cacheSlot.pageY * GetPageCount(cacheSlot.mip)) + cacheSlot.pageX] = -1;
+	}
+	cacheSlot.mip = tile.mip;
+	cacheSlot.pageX = tile.pageX;
+	cacheSlot.pageY = tile.pageY;
+	cacheSlot.lastUsedFrame = frame;
+	m_residentSlots[tile.mip][(tile.pageY * GetPageCount(tile.mip)) + tile.pageX] = slot;
+
+	const int paddedSize = m_tileSize + (2 * m_tileBorder);
+	glActiveTexture(GL_TEXTURE0 + m_physicalUnit);
+	glBindTexture(GL_TEXTURE_2D, m_physicalTexture);
+	glTexSubImage2D(
+		GL_TEXTURE_2D,
+		0,
+		(slot % VT_CACHE_TILES) * paddedSize,
+		(slot / VT_CACHE_TILES) * paddedSize,
+		paddedSize,
+		paddedSize,
+		GL_RGBA,
+		GL_UNSIGNED_BYTE,
+		tile.texels.data());
+
+	m_bPageTableDirty = true;
+	return(true);
+}
+
+/***********************************************************
+ *  UpdatePageTable()
+ *
+ *  This method is used for rebuilding the page table from
+ *  the coarsest mip down.  A page that is not resident
+ *  inherits the entry of the page covering it one mip up.
+ *  Each entry holds the cache slot column and row and the
+ *  mip level of the tile it points at.
+ ***********************************************************/
+void VirtualTexture::UpdatePageTable()
+{
+	std::vector<uint8_t> coarser;
+	std::vector<uint8_t> entries;
+
+	glActiveTexture(GL_TEXTURE0 + m_pageTableUnit);
+	glBindTexture(GL_TEXTURE_2D, m_pageTableTexture);
+
+	for (int mip = m_mipCount - 1; mip >= 0; mip--)
+	{
+		int pages = GetPageCount(mip);
+		entries.assign(static_cast<size_t>(pages) * pages * 4, 0);
+		for (int pageY = 0; pageY < pages; pageY++)
+		{
+			for (int pageX = 0; pageX < pages; pageX++)
+			{
+				uint8_t* entry = &entries[((pageY * pages) + pageX) * 4];
+				int slot = m_residentSlots[mip][(pageY * pages) + pageX];
+				if (slot >= 0)
+				{
+					entry[0] = static_cast<uint8_t>(slot % VT_CACHE_TILES);
+					entry[1] = static_cast<uint8_t>(slot / VT_CACHE_TILES);
+					entry[2] = static_cast<uint8_t>(mip);
+					entry[3] = 255;
+				}
+				else if (coarser.size() > 0)
+				{
+					int coarserPages = GetPageCount(mip + 1);
+					const uint8_t* parent = &coarser[((((pageY >> 1) * coarserPages) + (pageX >> 1))) * 4];
+					std::copy(parent, parent + 4, entry);
+				}
+			}
+		}
+
+		glTexSubImage2D(GL_TEXTURE_2D, mip, 0, 0, pages, pages, GL_RGBA, GL_UNSIGNED_BYTE, entries.data());
+		coarser.swap(entries);
+	}
+
+	m_bPageTableDirty = false;
+}
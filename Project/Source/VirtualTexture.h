@@ -0,0 +1,139 @@
+///////////////////////////////////////////////////////////////////////////////
+// virtualtexture.h
+// ============
+// stream the tiles of a very large texture into a fixed size GPU tile cache
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "JobSystem.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  VirtualTexture
+ *
+ *  This class samples a texture far larger than the video
+ *  memory given to it.  The image is cooked once into a
+ *  cache file of bordered tiles for every mip level.  Only
+ *  the tiles the feedback pass asks for are read back in,
+ *  on the worker threads, and kept in a small physical
+ *  tile texture managed least recently used first.  The
+ *  shader finds the tiles through a page table texture
+ *  holding, for every page of every mip, the slot of the
+ *  finest resident tile that covers it.
+ ***********************************************************/
+class VirtualTexture
+{
+public:
+	// constructor
+	VirtualTexture();
+	// destructor
+	~VirtualTexture();
+
+	// split the source image into bordered tiles of every mip level
+	// and write them into the cache file, unless it is already current
+	static bool Cook(const char* sourceFile, const char* cacheFile, JobSystem* pJobSystem);
+
+	// open a cooked cache file and create the page table and tile
+	// cache, which are kept bound to the passed in texture units
+	bool Open(
+		const char* cacheFile,
+		std::string tag,
+		int physicalUnit,
+		int pageTableUnit,
+		JobSystem* pJobSystem);
+
+	// record a page that the last feedback pass found on screen
+	void RequestPage(int pageX, int pageY, int mip, int frame);
+	// start loading the requested pages and upload the loaded ones
+	void Update(int frame);
+	// bind the tile cache and the page table to their texture units
+	void Bind() const;
+
+	// get the tag used by scene objects to refer to the texture
+	const std::string& GetTag() const { return(m_tag); }
+	// get the width and height of the full texture in texels
+	int GetVirtualSize() const { return(m_virtualSize); }
+	// get the number of cooked mip levels
+	int GetMipCount() const { return(m_mipCount); }
+	// get the size of the tile contents and of the border around them
+	int GetTileSize() const { return(m_tileSize); }
+	int GetTileBorder() const { return(m_tileBorder); }
+	// get the width and height of the physical tile cache in texels
+	int GetCacheSize() const;
+	// get the number of tiles currently resident in the cache
+	int GetResidentCount() const;
+
+private:
+	// a tile loaded by a worker, waiting to be uploaded
+	struct LOADED_TILE
+	{
+		int mip;
+		int pageX;
+		int pageY;
+		std::vector<uint8_t> texels;
+	};
+
+	// one tile slot in the physical cache
+	struct CACHE_SLOT
+	{
+		// page held by the slot, mip is -1 while the slot is free
+		int mip;
+		int pageX;
+		int pageY;
+		// last frame the page was on screen
+		int lastUsedFrame;
+	};
+
+	std::string m_tag;
+	std::string m_cacheFile;
+	JobSystem* m_pJobSystem;
+
+	// layout of the cooked cache file
+	int m_virtualSize;
+	int m_mipCount;
+	int m_tileSize;
+	int m_tileBorder;
+	// offset of the first tile of each mip level in the cache file
+	std::vector<uint64_t> m_mipOffsets;
+
+	// GPU textures and the texture units they are bound to
+	GLuint m_physicalTexture;
+	GLuint m_pageTableTexture;
+	int m_physicalUnit;
+	int m_pageTableUnit;
+
+	// cache slot of every page of every mip, -1 when not resident
+	std::vector<std::vector<int>> m_residentSlots;
+	// true for pages being loaded by a worker
+	std::vector<std::vector<bool>> m_pendingPages;
+	// physical cache slots
+	std::vector<CACHE_SLOT> m_slots;
+	// pages requested by the feedback pass and not yet loading
+	std::vector<glm::ivec3> m_requests;
+	// set when the page table has to be rebuilt and uploaded
+	bool m_bPageTableDirty;
+
+	// tiles handed back by the workers
+	std::vector<LOADED_TILE> m_loadedTiles;
+	std::mutex m_loadedMutex;
+	// number of tile loads still running on the workers
+	std::atomic<int> m_loadsInFlight;
+
+	// get the number of pages across a mip level
+	int GetPageCount(int mip) const;
+	// read the texels of one tile from the cache file
+	bool ReadTile(int mip, int pageX, int pageY, std::vector<uint8_t>& texels) const;
+	// copy a loaded tile into a cache slot, evicting the stalest page
+	bool UploadTile(const LOADED_TILE& tile, int frame);
+	// point every page at its finest resident tile and upload the table
+	void UpdatePageTable();
+};
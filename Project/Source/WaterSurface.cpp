@@ -0,0 +1,939 @@
+///////////////////////////////////////////////////////////////////////////////
+// watersurface.cpp
+// ============
+// simulate lake waves from a wave spectrum with FFTs on the worker threads
+///////////////////////////////////////////////////////////////////////////////
+
+#include "WaterSurface.h"
+
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <emmintrin.h>
+#define WATER_SSE
+#endif
+
+// declaration of global variables
+namespace
+{
+	// gravity, for the deep water dispersion of the waves
+	const float WATER_GRAVITY = 9.81f;
+	// waves much shorter than this fraction of the wind wave are
+	// damped, so the patch is not covered in grid sized ripples
+	const float WATER_SMALL_WAVE_FRACTION = 0.001f;
+	// rows or columns transformed together by one worker at the least
+	const size_t WATER_GRAIN_SIZE = 8;
+	// the smallest patch resolution, so the columns always come in
+	// whole groups of four
+	const int WATER_MIN_RESOLUTION = 16;
+
+	// edges of a grid tile that border a ring twice as coarse, whose
+	// odd vertices are moved onto the coarse edge in the vertex shader
+	const int WATER_EDGE_LEFT = 1;
+	const int WATER_EDGE_RIGHT = 2;
+	const int WATER_EDGE_BACK = 4;
+	const int WATER_EDGE_FRONT = 8;
+
+	/***********************************************************
+	 *  PhillipsSpectrum()
+	 *
+	 *  Energy of the waves with the passed in wave vector for
+	 *  the wind, suppressing waves that travel across it and
+	 *  those much shorter than the largest wind wave.
+	 ***********************************************************/
+	float PhillipsSpectrum(glm::vec2 waveVector, const WATER_SETTINGS& settings)
+	{
+		float k2 = glm::dot(waveVector, waveVector);
+		if (k2 < 0.000001f)
+		{
+			return(0.0f);
+		}
+
+		float windWave = (settings.windSpeed * settings.windSpeed) / WATER_GRAVITY;
+		float smallWave = windWave * WATER_SMALL_WAVE_FRACTION;
+		float alignment = glm::dot(waveVector / sqrtf(k2), glm::normalize(settings.windDirection));
+		float spectrum = settings.amplitude * (expf(-1.0f / (k2 * windWave * windWave)) / (k2 * k2)) * (alignment * alignment);
+
+		// waves running against the wind are weaker
+		if (alignment < 0.0f)
+		{
+			spectrum *= 0.25f;
+		}
+		return(spectrum * expf(-k2 * smallWave * smallWave));
+	}
+
+	/***********************************************************
+	 *  TransformScalar()
+	 *
+	 *  Inverse transform one row or column of a complex grid in
+	 *  place, the samples being stride floats apart.  The
+	 *  samples are put in bit reversed order first, then
+	 *  combined in radix-2 passes of growing size.
+	 ***********************************************************/
+	void TransformScalar(
+		float* real,
+		float* imaginary,
+		size_t stride,
+		int count,
+		const float* twiddleReal,
+		const float* twiddleImaginary,
+		const uint32_t* bitReversed)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			int j = static_cast<int>(bitReversed[i]);
+			if (i < j)
+			{
+				std::swap(real[i * stride], real[j * stride]);
+				std::swap(imaginary[i * stride], imaginary[j * stride]);
+			}
+		}
+
+		for (int half = 1; half < count; half *= 2)
+		{
+			for (int start = 0; start < count; start += half * 2)
+			{
+				for (int j = 0; j < half; j++)
+				{
+					float wr = twiddleReal[half - 1 + j];
+					float wi = twiddleImaginary[half - 1 + j];
+					size_t a = (start + j) * stride;
+					size_t b = (start + j + half) * stride;
+					float tr = (real[b] * wr) - (imaginary[b] * wi);
+					float ti = (real[b] * wi) + (imaginary[b] * wr);
+					real[b] = real[a] - tr;
+					imaginary[b] = imaginary[a] - ti;
+					real[a] += tr;
+					imaginary[a] += ti;
+				}
+			}
+		}
+	}
+
+#ifdef WATER_SSE
+	/***********************************************************
+	 *  TransformRowSSE()
+	 *
+	 *  Inverse transform one row of a complex grid in place.
+	 *  The first two passes are done one butterfly at a time,
+	 *  every later pass four neighboring butterflies at a time,
+	 *  which read four twiddles in a row.
+	 ***********************************************************/
+	void TransformRowSSE(
+		float* real,
+		float* imaginary,
+		int count,
+		const float* twiddleReal,
+		const float* twiddleImaginary,
+		const uint32_t* bitReversed)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			int j = static_cast<int>(bitReversed[i]);
+			if (i < j)
+			{
+				std::swap(real[i], real[j]);
+				std::swap(imaginary[i], imaginary[j]);
+			}
+		}
+
+		for (int half = 1; half < count; half *= 2)
+		{
+			for (int start = 0; start < count; start += half * 2)
+			{
+				if (half < 4)
+				{
+					for (int j = 0; j < half; j++)
+					{
+						float wr = twiddleReal[half - 1 + j];
+						float wi = twiddleImaginary[half - 1 + j];
+						int a = start + j;
+						int b = a + half;
+						float tr = (real[b] * wr) - (imaginary[b] * wi);
+						float ti = (real[b] * wi) + (imaginary[b] * wr);
+						real[b] = real[a] - tr;
+						imaginary[b] = imaginary[a] - ti;
+						real[a] += tr;
+						imaginary[a] += ti;
+					}
+					continue;
+				}
+
+				for (int j = 0; j < half; j += 4)
+				{
+					int a = start + j;
+					int b = a + half;
+					__m128 wr = _mm_loadu_ps(&twiddleReal[half - 1 + j]);
+					__m128 wi = _mm_loadu_ps(&twiddleImaginary[half - 1 + j]);
+					__m128 ar = _mm_loadu_ps(&real[a]);
+					__m128 ai = _mm_loadu_ps(&imaginary[a]);
+					__m128 br = _mm_loadu_ps(&real[b]);
+					__m128 bi = _mm_loadu_ps(&imaginary[b]);
+					__m128 tr = _mm_sub_ps(_mm_mul_ps(br, wr), _mm_mul_ps(bi, wi));
+					__m128 ti = _mm_add_ps(_mm_mul_ps(br, wi), _mm_mul_ps(bi, wr));
+					_mm_storeu_ps(&real[b], _mm_sub_ps(ar, tr));
+					_mm_storeu_ps(&imaginary[b], _mm_sub_ps(ai, ti));
+					_mm_storeu_ps(&real[a], _mm_add_ps(ar, tr));
+					_mm_storeu_ps(&imaginary[a], _mm_add_ps(ai, ti));
+				}
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  TransformColumnsSSE()
+	 *
+	 *  Inverse transform four neighboring columns of a complex
+	 *  grid in place at once.  The samples of the four columns
+	 *  in a row lie next to each other, so every butterfly of
+	 *  the four transforms is one set of vector operations with
+	 *  the same twiddle in each lane.
+	 ***********************************************************/
+	void TransformColumnsSSE(
+		float* real,
+		float* imaginary,
+		size_t stride,
+		int count,
+		const float* twiddleReal,
+		const float* twiddleImaginary,
+		const uint32_t* bitReversed)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			int j = static_cast<int>(bitReversed[i]);
+			if (i < j)
+			{
+				__m128 swapReal = _mm_loadu_ps(&real[i * stride]);
+				__m128 swapImaginary = _mm_loadu_ps(&imaginary[i * stride]);
+				_mm_storeu_ps(&real[i * stride], _mm_loadu_ps(&real[j * stride]));
+				_mm_storeu_ps(&imaginary[i * stride], _mm_loadu_ps(&imaginary[j * stride]));
+				_mm_storeu_ps(&real[j * stride], swapReal);
+				_mm_storeu_ps(&imaginary[j * stride], swapImaginary);
+			}
+		}
+
+		for (int half = 1; half < count; half *= 2)
+		{
+			for (int j = 0; j < half; j++)
+			{
+				__m128 wr = _mm_set1_ps(twiddleReal[half - 1 + j]);
+				__m128 wi = _mm_set1_ps(twiddleImaginary[half - 1 + j]);
+				for (int start = 0; start < count; start += half * 2)
+				{
+					size_t a = (start + j) * stride;
+					size_t b = (start + j + half) * stride;
+					__m128 ar = _mm_loadu_ps(&real[a]);
+					__m128 ai = _mm_loadu_ps(&imaginary[a]);
+					__m128 br = _mm_loadu_ps(&real[b]);
+					__m128 bi = _mm_loadu_ps(&imaginary[b]);
+					__m128 tr = _mm_sub_ps(_mm_mul_ps(br, wr), _mm_mul_ps(bi, wi));
+					__m128 ti = _mm_add_ps(_mm_mul_ps(br, wi), _mm_mul_ps(bi, wr));
+					_mm_storeu_ps(&real[b], _mm_sub_ps(ar, tr));
+					_mm_storeu_ps(&imaginary[b], _mm_sub_ps(ai, ti));
+					_mm_storeu_ps(&real[a], _mm_add_ps(ar, tr));
+					_mm_storeu_ps(&imaginary[a], _mm_add_ps(ai, ti));
+				}
+			}
+		}
+	}
+#endif
+}
+
+/***********************************************************
+ *  WaterSurface()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+WaterSurface::WaterSurface()
+{
+	m_resolution = 0;
+	m_log2Resolution = 0;
+	m_maxHeight = 0.0f;
+	m_displacementTexture = 0;
+	m_normalTexture = 0;
+	m_displacementUnit = 0;
+	m_normalUnit = 0;
+	m_gridVertexArray = 0;
+	m_gridVertexBuffer = 0;
+	m_gridIndexBuffer = 0;
+	m_tileBuffer = 0;
+	m_gridIndexCount = 0;
+	m_tileCount = 0;
+	m_gridCenter = glm::vec2(0.0f);
+}
+
+/***********************************************************
+ *  ~WaterSurface()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+WaterSurface::~WaterSurface()
+{
+	ReleaseResources();
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for drawing the starting amplitude
+ *  of every wave of the patch from the Phillips spectrum
+ *  with Gaussian noise, and for building the twiddle and
+ *  bit reversal tables of the transforms.  The spectrum is
+ *  stored centered, with wave number zero in the middle of
+ *  the grid.  Returns false when the resolution is not a
+ *  power of two of at least 16.
+ ***********************************************************/
+bool WaterSurface::Initialize(const WATER_SETTINGS& settings)
+{
+	int resolution = settings.resolution;
+	if ((resolution < WATER_MIN_RESOLUTION) || ((resolution & (resolution - 1)) != 0))
+	{
+		std::cout << "Water resolution must be a power of two of at least "
+			<< WATER_MIN_RESOLUTION << ":" << resolution << std::endl;
+		return(false);
+	}
+
+	m_settings = settings;
+	m_resolution = resolution;
+	m_log2Resolution = 0;
+	while ((1 << m_log2Resolution) < resolution)
+	{
+		m_log2Resolution++;
+	}
+
+	size_t sampleCount = static_cast<size_t>(resolution) * resolution;
+	m_spectrumReal.resize(sampleCount);
+	m_spectrumImaginary.resize(sampleCount);
+	m_frequencies.resize(sampleCount);
+	m_directionX.resize(sampleCount);
+	m_directionZ.resize(sampleCount);
+
+	std::mt19937 random(settings.seed);
+	std::normal_distribution<float> gaussian(0.0f, 1.0f);
+	const float waveNumberStep = glm::two_pi<float>() / settings.patchSize;
+	for (int row = 0; row < resolution; row++)
+	{
+		for (int column = 0; column < resolution; column++)
+		{
+			size_t i = (static_cast<size_t>(row) * resolution) + column;
+			glm::vec2 waveVector(
+				(column - (resolution / 2)) * waveNumberStep,
+				(row - (resolution / 2)) * waveNumberStep);
+			float waveNumber = glm::length(waveVector);
+
+			float amplitude = sqrtf(PhillipsSpectrum(waveVector, settings) * 0.5f);
+			m_spectrumReal[i] = gaussian(random) * amplitude;
+			m_spectrumImaginary[i] = gaussian(random) * amplitude;
+			m_frequencies[i] = sqrtf(WATER_GRAVITY * waveNumber);
+			m_directionX[i] = (waveNumber > 0.0f) ? (waveVector.x / waveNumber) : 0.0f;
+			m_directionZ[i] = (waveNumber > 0.0f) ? (waveVector.y / waveNumber) : 0.0f;
+		}
+	}
+
+	for (int grid = 0; grid < 2; grid++)
+	{
+		m_gridReal[grid].assign(sampleCount, 0.0f);
+		m_gridImaginary[grid].assign(sampleCount, 0.0f);
+	}
+
+	m_twiddleReal.resize(resolution - 1);
+	m_twiddleImaginary.resize(resolution - 1);
+	for (int half = 1; half < resolution; half *= 2)
+	{
+		for (int j = 0; j < half; j++)
+		{
+			float angle = glm::pi<float>() * j / half;
+			m_twiddleReal[half - 1 + j] = cosf(angle);
+			m_twiddleImaginary[half - 1 + j] = sinf(angle);
+		}
+	}
+
+	m_bitReversed.resize(resolution);
+	for (int i = 0; i < resolution; i++)
+	{
+		uint32_t reversed = 0;
+		for (int bit = 0; bit < m_log2Resolution; bit++)
+		{
+			reversed |= ((i >> bit) & 1) << (m_log2Resolution - 1 - bit);
+		}
+		m_bitReversed[i] = reversed;
+	}
+
+	m_displacements.assign(sampleCount * 4, 0.0f);
+	m_normals.assign(sampleCount * 4, 0.0f);
+	m_maxHeight = 0.0f;
+	return(true);
+}
+
+/***********************************************************
+ *  Simulate()
+ *
+ *  This method is used for computing the surface at the
+ *  passed in time.  Each stage is split across the workers
+ *  by rows or by groups of four columns and finishes before
+ *  the next starts.  Touches no OpenGL state, so it may run
+ *  on any thread while the last surface is being drawn.
+ ***********************************************************/
+void WaterSurface::Simulate(float time, JobSystem* pJobSystem)
+{
+	if (m_resolution == 0)
+	{
+		return;
+	}
+
+	auto runRows = [pJobSystem](size_t count, const std::function<void(size_t, size_t)>& func)
+		{
+			if (NULL != pJobSystem)
+			{
+				pJobSystem->ParallelFor(count, WATER_GRAIN_SIZE, func);
+			}
+			else
+			{
+				func(0, count);
+			}
+		};
+
+	runRows(m_resolution, [this, time](size_t begin, size_t end)
+		{
+			EvaluateSpectrum(time, begin, end);
+		});
+	runRows(m_resolution, [this](size_t begin, size_t end)
+		{
+			TransformRows(0, begin, end);
+			TransformRows(1, begin, end);
+		});
+	runRows(m_resolution / 4, [this](size_t begin, size_t end)
+		{
+			TransformColumns(0, begin * 4, end * 4);
+			TransformColumns(1, begin * 4, end * 4);
+		});
+	runRows(m_resolution, [this](size_t begin, size_t end)
+		{
+			ResolveDisplacements(begin, end);
+		});
+	runRows(m_resolution, [this](size_t begin, size_t end)
+		{
+			ComputeNormals(begin, end);
+		});
+
+	float maxHeight = 0.0f;
+	for (size_t i = 1; i < m_displacements.size(); i += 4)
+	{
+		maxHeight = std::max(maxHeight, fabsf(m_displacements[i]));
+	}
+	m_maxHeight = maxHeight;
+}
+
+/***********************************************************
+ *  EvaluateSpectrum()
+ *
+ *  This method is used for advancing every wave of the rows
+ *  to the passed in time, pairing it with the wave running
+ *  the other way so the transformed height is real.  The
+ *  first grid gets the height spectrum plus the sideways
+ *  displacement along x times i, so after the transform its
+ *  real part is the height and its imaginary part the x
+ *  displacement.  The second grid carries the displacement
+ *  along z the same way, in its imaginary part.
+ ***********************************************************/
+void WaterSurface::EvaluateSpectrum(float time, size_t beginRow, size_t endRow)
+{
+	const int mask = m_resolution - 1;
+	const float choppiness = m_settings.choppiness;
+
+	for (size_t row = beginRow; row < endRow; row++)
+	{
+		size_t mirrorRow = (m_resolution - row) & mask;
+		for (int column = 0; column < m_resolution; column++)
+		{
+			size_t i = (row * m_resolution) + column;
+			size_t mirror = (mirrorRow * m_resolution) + ((m_resolution - column) & mask);
+
+			float phase = m_frequencies[i] * time;
+			float c = cosf(phase);
+			float s = sinf(phase);
+
+			// h0(k) e^(iwt) + conj(h0(-k)) e^(-iwt)
+			float mirrorReal = m_spectrumReal[mirror];
+			float mirrorImaginary = -m_spectrumImaginary[mirror];
+			float heightReal = (m_spectrumReal[i] * c) - (m_spectrumImaginary[i] * s) + (mirrorReal * c) + (mirrorImaginary * s);
+			float heightImaginary = (m_spectrumReal[i] * s) + (m_spectrumImaginary[i] * c) + (mirrorImaginary * c) - (mirrorReal * s);
+
+			// i * (-i k/|k| h) is k/|k| h, landing in the imaginary part
+			float scaleX = choppiness * m_directionX[i];
+			float scaleZ = choppiness * m_directionZ[i];
+			m_gridReal[0][i] = heightReal * (1.0f + scaleX);
+			m_gridImaginary[0][i] = heightImaginary * (1.0f + scaleX);
+			m_gridReal[1][i] = heightReal * scaleZ;
+			m_gridImaginary[1][i] = heightImaginary * scaleZ;
+		}
+	}
+}
+
+/***********************************************************
+ *  TransformRows()
+ *
+ *  This method is used for inverse transforming a range of
+ *  rows of a grid.
+ ***********************************************************/
+void WaterSurface::TransformRows(int grid, size_t beginRow, size_t endRow)
+{
+	for (size_t row = beginRow; row < endRow; row++)
+	{
+		float* real = &m_gridReal[grid][row * m_resolution];
+		float* imaginary = &m_gridImaginary[grid][row * m_resolution];
+#ifdef WATER_SSE
+		TransformRowSSE(real, imaginary, m_resolution,
+			m_twiddleReal.data(), m_twiddleImaginary.data(), m_bitReversed.data());
+#else
+		TransformScalar(real, imaginary, 1, m_resolution,
+			m_twiddleReal.data(), m_twiddleImaginary.data(), m_bitReversed.data());
+#endif
+	}
+}
+
+/***********************************************************
+ *  TransformColumns()
+ *
+ *  This method is used for inverse transforming a range of
+ *  columns of a grid, which starts and ends on a multiple
+ *  of four.
+ ***********************************************************/
+void WaterSurface::TransformColumns(int grid, size_t beginColumn, size_t endColumn)
+{
+	for (size_t column = beginColumn; column < endColumn; column += 4)
+	{
+		float* real = &m_gridReal[grid][column];
+		float* imaginary = &m_gridImaginary[grid][column];
+#ifdef WATER_SSE
+		TransformColumnsSSE(real, imaginary, m_resolution, m_resolution,
+			m_twiddleReal.data(), m_twiddleImaginary.data(), m_bitReversed.data());
+#else
+		for (int lane = 0; lane < 4; lane++)
+		{
+			TransformScalar(real + lane, imaginary + lane, m_resolution, m_resolution,
+				m_twiddleReal.data(), m_twiddleImaginary.data(), m_bitReversed.data());
+		}
+#endif
+	}
+}
+
+/***********************************************************
+ *  ResolveDisplacements()
+ *
+ *  This method is used for writing the displacement of each
+ *  texel of the rows as x, height and z.  The spectrum was
+ *  centered, which multiplies every transformed sample by
+ *  -1 to the power of its row plus its column.
+ ***********************************************************/
+void WaterSurface::ResolveDisplacements(size_t beginRow, size_t endRow)
+{
+	for (size_t row = beginRow; row < endRow; row++)
+	{
+		for (int column = 0; column < m_resolution; column++)
+		{
+			size_t i = (row * m_resolution) + column;
+			float sign = (((row + column) & 1) != 0) ? -1.0f : 1.0f;
+			m_displacements[(i * 4)] = m_gridImaginary[0][i] * sign;
+			m_displacements[(i * 4) + 1] = m_gridReal[0][i] * sign;
+			m_displacements[(i * 4) + 2] = m_gridImaginary[1][i] * sign;
+			m_displacements[(i * 4) + 3] = 0.0f;
+		}
+	}
+}
+
+/***********************************************************
+ *  ComputeNormals()
+ *
+ *  This method is used for computing the normal of the
+ *  displaced surface at each texel of the rows from its
+ *  neighbors, wrapping around the patch.  The Jacobian of
+ *  the sideways displacement drops below one where crests
+ *  fold over, and how far below is kept as foam.
+ ***********************************************************/
+void WaterSurface::ComputeNormals(size_t beginRow, size_t endRow)
+{
+	const int mask = m_resolution - 1;
+	const float inverseSpacing = m_resolution / (2.0f * m_settings.patchSize);
+
+	for (size_t row = beginRow; row < endRow; row++)
+	{
+		size_t back = ((row + mask) & mask) * m_resolution;
+		size_t front = ((row + 1) & mask) * m_resolution;
+		for (int column = 0; column < m_resolution; column++)
+		{
+			size_t i = (row * m_resolution) + column;
+			size_t left = ((row * m_resolution) + ((column + mask) & mask)) * 4;
+			size_t right = ((row * m_resolution) + ((column + 1) & mask)) * 4;
+			size_t up = (back + column) * 4;
+			size_t down = (front + column) * 4;
+
+			glm::vec3 alongX(
+				1.0f + ((m_displacements[right] - m_displacements[left]) * inverseSpacing),
+				(m_displacements[right + 1] - m_displacements[left + 1]) * inverseSpacing,
+				(m_displacements[right + 2] - m_displacements[left + 2]) * inverseSpacing);
+			glm::vec3 alongZ(
+				(m_displacements[down] - m_displacements[up]) * inverseSpacing,
+				(m_displacements[down + 1] - m_displacements[up + 1]) * inverseSpacing,
+				1.0f + ((m_displacements[down + 2] - m_displacements[up + 2]) * inverseSpacing));
+			glm::vec3 normal = glm::normalize(glm::cross(alongZ, alongX));
+
+			float jacobian = (alongX.x * alongZ.z) - (alongZ.x * alongX.z);
+			m_normals[(i * 4)] = normal.x;
+			m_normals[(i * 4) + 1] = normal.y;
+			m_normals[(i * 4) + 2] = normal.z;
+			m_normals[(i * 4) + 3] = std::min(std::max(1.0f - jacobian, 0.0f), 1.0f);
+		}
+	}
+}
+
+/***********************************************************
+ *  CreateResources()
+ *
+ *  This method is used for creating the displacement and
+ *  normal textures, which repeat across the lake, and the
+ *  grid the lake is drawn with: one tile of quads over the
+ *  unit square, and a buffer with the placement of every
+ *  tile of the rings read as a per-instance attribute.
+ ***********************************************************/
+bool WaterSurface::CreateResources(int displacementUnit, int normalUnit)
+{
+	if (m_resolution == 0)
+	{
+		return(false);
+	}
+	ReleaseResources();
+
+	m_displacementUnit = displacementUnit;
+	m_normalUnit = normalUnit;
+
+	glActiveTexture(GL_TEXTURE0 + m_displacementUnit);
+	glGenTextures(1, &m_displacementTexture);
+	glBindTexture(GL_TEXTURE_2D, m_displacementTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, m_resolution, m_resolution, 0, GL_RGBA, GL_FLOAT, m_displacements.data());
+
+	// the normals are mipmapped, so distant water does not sparkle
+	glActiveTexture(GL_TEXTURE0 + m_normalUnit);
+	glGenTextures(1, &m_normalTexture);
+	glBindTexture(GL_TEXTURE_2D, m_normalTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, m_resolution, m_resolution, 0, GL_RGBA, GL_FLOAT, m_normals.data());
+	glGenerateMipmap(GL_TEXTURE_2D);
+
+	// one tile, positions and texture coordinates over the unit
+	// square with the same layout as the basic meshes
+	const int quads = m_settings.tileResolution;
+	std::vector<float> vertices;
+	vertices.reserve(static_cast<size_t>(quads + 1) * (quads + 1) * 8);
+	for (int z = 0; z <= quads; z++)
+	{
+		for (int x = 0; x <= quads; x++)
+		{
+			float u = static_cast<float>(x) / quads;
+			float v = static_cast<float>(z) / quads;
+			float vertex[8] = { u, 0.0f, v, 0.0f, 1.0f, 0.0f, u, v };
+			vertices.insert(vertices.end(), vertex, vertex + 8);
+		}
+	}
+	std::vector<uint16_t> indices;
+	indices.reserve(static_cast<size_t>(quads) * quads * 6);
+	for (int z = 0; z < quads; z++)
+	{
+		for (int x = 0; x < quads; x++)
+		{
+			uint16_t corner = static_cast<uint16_t>((z * (quads + 1)) + x);
+			uint16_t quad[6] = {
+				corner, static_cast<uint16_t>(corner + quads + 1), static_cast<uint16_t>(corner + 1),
+				static_cast<uint16_t>(corner + 1), static_cast<uint16_t>(corner + quads + 1), static_cast<uint16_t>(corner + quads + 2) };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	}
+	m_gridIndexCount = static_cast<int>(indices.size());
+	m_tileCount = 16 + (12 * (m_settings.levelCount - 1));
+
+	glGenVertexArrays(1, &m_gridVertexArray);
+	glBindVertexArray(m_gridVertexArray);
+
+	const GLsizei stride = 8 * sizeof(float);
+	glGenBuffers(1, &m_gridVertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, m_gridVertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(0));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(3 * sizeof(float)));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(6 * sizeof(float)));
+
+	glGenBuffers(1, &m_gridIndexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_gridIndexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint16_t), indices.data(), GL_STATIC_DRAW);
+
+	// each tile is placed by its corner, side and coarse edges
+	glGenBuffers(1, &m_tileBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, m_tileBuffer);
+	glBufferData(GL_ARRAY_BUFFER, m_tileCount * sizeof(glm::vec4), NULL, GL_DYNAMIC_DRAW);
+	glEnableVertexAttribArray(3);
+	glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), reinterpret_cast<void*>(0));
+	glVertexAttribDivisor(3, 1);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	// force the tiles to be placed on the first draw
+	m_gridCenter = glm::vec2(FLT_MAX);
+	return(true);
+}
+
+/***********************************************************
+ *  ReleaseResources()
+ *
+ *  This method is used for freeing the textures and the
+ *  grid.
+ ***********************************************************/
+void WaterSurface::ReleaseResources()
+{
+	if (m_displacementTexture != 0)
+	{
+		glDeleteTextures(1, &m_displacementTexture);
+		glDeleteTextures(1, &m_normalTexture);
+		m_displacementTexture = 0;
+		m_normalTexture = 0;
+	}
+	if (m_gridVertexArray != 0)
+	{
+		glDeleteVertexArrays(1, &m_gridVertexArray);
+		glDeleteBuffers(1, &m_gridVertexBuffer);
+		glDeleteBuffers(1, &m_gridIndexBuffer);
+		glDeleteBuffers(1, &m_tileBuffer);
+		m_gridVertexArray = 0;
+		m_gridVertexBuffer = 0;
+		m_gridIndexBuffer = 0;
+		m_tileBuffer = 0;
+	}
+}
+
+/***********************************************************
+ *  Upload()
+ *
+ *  This method is used for copying the last simulated
+ *  surface into the textures and rebuilding the mipmaps of
+ *  the normals.
+ ***********************************************************/
+void WaterSurface::Upload()
+{
+	if (IsReady() == false)
+	{
+		return;
+	}
+
+	glActiveTexture(GL_TEXTURE0 + m_displacementUnit);
+	glBindTexture(GL_TEXTURE_2D, m_displacementTexture);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_resolution, m_resolution, GL_RGBA, GL_FLOAT, m_displacements.data());
+	glActiveTexture(GL_TEXTURE0 + m_normalUnit);
+	glBindTexture(GL_TEXTURE_2D, m_normalTexture);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_resolution, m_resolution, GL_RGBA, GL_FLOAT, m_normals.data());
+	glGenerateMipmap(GL_TEXTURE_2D);
+}
+
+/***********************************************************
+ *  Bind()
+ *
+ *  This method is used for binding the textures to their
+ *  texture units.
+ ***********************************************************/
+void WaterSurface::Bind() const
+{
+	glActiveTexture(GL_TEXTURE0 + m_displacementUnit);
+	glBindTexture(GL_TEXTURE_2D, m_displacementTexture);
+	glActiveTexture(GL_TEXTURE0 + m_normalUnit);
+	glBindTexture(GL_TEXTURE_2D, m_normalTexture);
+}
+
+/***********************************************************
+ *  GetGridExtent()
+ *
+ *  This method is used for getting half the side of the
+ *  square covered by the rings of tiles, which is two tiles
+ *  of the coarsest level.
+ ***********************************************************/
+float WaterSurface::GetGridExtent() const
+{
+	return(2.0f * m_settings.tileSize * static_cast<float>(1 << (m_settings.levelCount - 1)));
+}
+
+/***********************************************************
+ *  DrawGrid()
+ *
+ *  This method is used for drawing the rings of tiles around
+ *  the camera.  The innermost level is a block of four by
+ *  four tiles, and each coarser level a ring of twelve tiles
+ *  twice as large around it.  The center snaps to the
+ *  vertex spacing of the coarsest level, so no vertex
+ *  slides over the waves as the camera moves, and the tiles
+ *  are only placed again when it snaps somewhere new.
+ ***********************************************************/
+void WaterSurface::DrawGrid(glm::vec3 cameraPosition)
+{
+	if (IsReady() == false)
+	{
+		return;
+	}
+
+	const int levelCount = m_settings.levelCount;
+	float snap = (m_settings.tileSize * static_cast<float>(1 << (levelCount - 1))) / m_settings.tileResolution;
+	glm::vec2 center(floorf(cameraPosition.x / snap) * snap, floorf(cameraPosition.z / snap) * snap);
+
+	if (center != m_gridCenter)
+	{
+		m_gridCenter = center;
+
+		std::vector<glm::vec4> tiles;
+		tiles.reserve(m_tileCount);
+		for (int level = 0; level < levelCount; level++)
+		{
+			float size = m_settings.tileSize * static_cast<float>(1 << level);
+			bool bCoarserOutside = (level < (levelCount - 1));
+			for (int z = 0; z < 4; z++)
+			{
+				for (int x = 0; x < 4; x++)
+				{
+					// the middle of every ring is the level inside it
+					if ((level > 0) && (x >= 1) && (x <= 2) && (z >= 1) && (z <= 2))
+					{
+						continue;
+					}
+
+					int edges = 0;
+					if (bCoarserOutside)
+					{
+						edges |= (x == 0) ? WATER_EDGE_LEFT : 0;
+						edges |= (x == 3) ? WATER_EDGE_RIGHT : 0;
+						edges |= (z == 0) ? WATER_EDGE_BACK : 0;
+						edges |= (z == 3) ? WATER_EDGE_FRONT : 0;
+					}
+					tiles.push_back(glm::vec4(
+						center.x + ((x - 2) * size),
+						center.y + ((z - 2) * size),
+						size,
+						static_cast<float>(edges)));
+				}
+			}
+		}
+
+		glBindBuffer(GL_ARRAY_BUFFER, m_tileBuffer);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, tiles.size() * sizeof(glm::vec4), tiles.data());
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	glBindVertexArray(m_gridVertexArray);
+	glDrawElementsInstanced(GL_TRIANGLES, m_gridIndexCount, GL_UNSIGNED_SHORT, NULL, m_tileCount);
+	glBindVertexArray(0);
+}
+
+/***********************************************************
+ *  Benchmark()
+ *
+ *  This method is used for timing a full surface update and
+ *  the transforms alone at each resolution, from one
+ *  thread up to every hardware core, and printing a table.
+ *  Each run is warmed up once and averaged over enough
+ *  updates to last a fraction of a second.
+ ***********************************************************/
+void WaterSurface::Benchmark()
+{
+	const int resolutions[] = { 64, 128, 256, 512, 1024 };
+	unsigned int coreCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+	std::vector<unsigned int> threadCounts;
+	for (unsigned int threads = 1; threads < coreCount; threads *= 2)
+	{
+		threadCounts.push_back(threads);
+	}
+	threadCounts.push_back(coreCount);
+
+#ifdef WATER_SSE
+	std::cout << "Water FFT benchmark, SSE butterflies" << std::endl;
+#else
+	std::cout << "Water FFT benchmark, scalar butterflies" << std::endl;
+#endif
+	std::cout << "resolution threads  update ms  transforms ms" << std::endl;
+
+	for (int r = 0; r < sizeof(resolutions) / sizeof(resolutions[0]); r++)
+	{
+		WATER_SETTINGS settings;
+		settings.resolution = resolutions[r];
+		WaterSurface surface;
+		surface.Initialize(settings);
+		int iterations = std::max(4, (1 << 22) / (resolutions[r] * resolutions[r]));
+
+		for (int t = 0; t < threadCounts.size(); t++)
+		{
+			// the calling thread works too, so one fewer worker
+			JobSystem* pJobSystem = NULL;
+			if (threadCounts[t] > 1)
+			{
+				pJobSystem = new JobSystem(threadCounts[t] - 1);
+			}
+
+			surface.Simulate(0.0f, pJobSystem);
+			std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+			for (int i = 0; i < iterations; i++)
+			{
+				surface.Simulate(i * 0.016f, pJobSystem);
+			}
+			double updateMilliseconds = std::chrono::duration<double, std::milli>(
+				std::chrono::steady_clock::now() - startTime).count() / iterations;
+
+			// the spectrum is evaluated again before each timed transform,
+			// since transforming the same grids over and over overflows them
+			double transformMilliseconds = 0.0;
+			for (int i = 0; i < iterations; i++)
+			{
+				surface.EvaluateSpectrum(i * 0.016f, 0, surface.m_resolution);
+				auto transform = [&surface](size_t begin, size_t end)
+					{
+						surface.TransformRows(0, begin, end);
+						surface.TransformRows(1, begin, end);
+					};
+				auto transformColumns = [&surface](size_t begin, size_t end)
+					{
+						surface.TransformColumns(0, begin * 4, end * 4);
+						surface.TransformColumns(1, begin * 4, end * 4);
+					};
+				startTime = std::chrono::steady_clock::now();
+				if (NULL != pJobSystem)
+				{
+					pJobSystem->ParallelFor(surface.m_resolution, WATER_GRAIN_SIZE, transform);
+					pJobSystem->ParallelFor(surface.m_resolution / 4, WATER_GRAIN_SIZE, transformColumns);
+				}
+				else
+				{
+					transform(0, surface.m_resolution);
+					transformColumns(0, surface.m_resolution / 4);
+				}
+				transformMilliseconds += std::chrono::duration<double, std::milli>(
+					std::chrono::steady_clock::now() - startTime).count();
+			}
+			transformMilliseconds /= iterations;
+
+			std::cout << resolutions[r] << "\t   " << threadCounts[t] << "\t   "
+				<< updateMilliseconds << "\t    " << transformMilliseconds << std::endl;
+			delete pJobSystem;
+		}
+	}
+}
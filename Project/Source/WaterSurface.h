@@ -0,0 +1,146 @@
+///////////////////////////////////////////////////////////////////////////////
+// watersurface.h
+// ============
+// simulate lake waves from a wave spectrum with FFTs on the worker threads
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "JobSystem.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// shape of the waves and of the grid they are drawn on, in world
+// units (meters) and seconds
+struct WATER_SETTINGS
+{
+	// samples along each side of the simulated patch, a power of two
+	int resolution = 128;
+	// side of the patch, which repeats across the whole lake
+	float patchSize = 32.0f;
+	// direction and speed of the wind raising the waves
+	glm::vec2 windDirection = glm::vec2(1.0f, 0.4f);
+	float windSpeed = 6.0f;
+	// scale of the wave spectrum, and how far crests lean sideways
+	float amplitude = 0.00002f;
+	float choppiness = 1.2f;
+	uint32_t seed = 7;
+
+	// quads along each side of a grid tile, the side of the finest
+	// tiles and the number of levels, each twice the size of the last
+	int tileResolution = 32;
+	float tileSize = 4.0f;
+	int levelCount = 6;
+};
+
+/***********************************************************
+ *  WaterSurface
+ *
+ *  This class animates a patch of water with Tessendorf's
+ *  method.  A spectrum of waves is drawn once from the
+ *  Phillips spectrum, and every frame it is advanced by the
+ *  deep water dispersion and turned into the height and the
+ *  sideways displacement of the surface by inverse FFTs.
+ *  The FFTs run as radix-2 passes over the rows and then the
+ *  columns of the grid, spread across the workers, with the
+ *  butterflies done four at a time with SSE.  The results
+ *  are uploaded as a displacement and a normal texture that
+ *  tile across the lake.  The lake itself is drawn as nested
+ *  rings of grid tiles around the camera, each ring twice as
+ *  coarse as the one inside it, in one instanced draw.
+ ***********************************************************/
+class WaterSurface
+{
+public:
+	// constructor
+	WaterSurface();
+	// destructor
+	~WaterSurface();
+
+	// draw the wave spectrum and size the simulation buffers
+	bool Initialize(const WATER_SETTINGS& settings);
+	// compute the surface at the passed in time, on the CPU only
+	void Simulate(float time, JobSystem* pJobSystem);
+
+	// create the textures and the grid, bound to the passed in units
+	bool CreateResources(int displacementUnit, int normalUnit);
+	// free the textures and the grid
+	void ReleaseResources();
+	// copy the last simulated surface into the textures
+	void Upload();
+	// bind the textures to their texture units
+	void Bind() const;
+	// center the rings of tiles on the camera and draw them
+	void DrawGrid(glm::vec3 cameraPosition);
+
+	// true once the textures and the grid were created
+	bool IsReady() const { return(m_gridVertexArray != 0); }
+	const WATER_SETTINGS& GetSettings() const { return(m_settings); }
+	// get the center the rings of tiles were last drawn around
+	glm::vec2 GetGridCenter() const { return(m_gridCenter); }
+	// get half the side of the area covered by the grid
+	float GetGridExtent() const;
+	// get the highest wave crest of the last simulated surface
+	float GetMaxHeight() const { return(m_maxHeight); }
+
+	// time the FFTs against the resolution and the number of threads
+	static void Benchmark();
+
+private:
+	WATER_SETTINGS m_settings;
+	int m_resolution;
+	int m_log2Resolution;
+
+	// wave amplitude at time zero and the angular frequency of each
+	// wave number, one per sample
+	std::vector<float> m_spectrumReal;
+	std::vector<float> m_spectrumImaginary;
+	std::vector<float> m_frequencies;
+	// unit wave vector of each sample, zero at the center
+	std::vector<float> m_directionX;
+	std::vector<float> m_directionZ;
+
+	// two complex grids transformed together, the first carrying the
+	// height and the sideways displacement along x, the second along z
+	std::vector<float> m_gridReal[2];
+	std::vector<float> m_gridImaginary[2];
+	// twiddle factors of every pass, the pass with half size h
+	// starting at h - 1, and the bit reversed index of each sample
+	std::vector<float> m_twiddleReal;
+	std::vector<float> m_twiddleImaginary;
+	std::vector<uint32_t> m_bitReversed;
+
+	// simulated surface, four floats per texel
+	std::vector<float> m_displacements;
+	std::vector<float> m_normals;
+	float m_maxHeight;
+
+	// textures and the texture units they are bound to
+	GLuint m_displacementTexture;
+	GLuint m_normalTexture;
+	int m_displacementUnit;
+	int m_normalUnit;
+
+	// one grid tile, and a buffer with the placement of every tile
+	GLuint m_gridVertexArray;
+	GLuint m_gridVertexBuffer;
+	GLuint m_gridIndexBuffer;
+	GLuint m_tileBuffer;
+	int m_gridIndexCount;
+	int m_tileCount;
+	glm::vec2 m_gridCenter;
+
+	// evaluate the spectrum at the passed in time into the grids
+	void EvaluateSpectrum(float time, size_t beginRow, size_t endRow);
+	// inverse transform a range of rows or of columns of a grid
+	void TransformRows(int grid, size_t beginRow, size_t endRow);
+	void TransformColumns(int grid, size_t beginColumn, size_t endColumn);
+	// undo the centering of the spectrum and write the displacements
+	void ResolveDisplacements(size_t beginRow, size_t endRow);
+	// compute the normals and foam from the displaced surface
+	void ComputeNormals(size_t beginRow, size_t endRow);
+};
@@ -0,0 +1,309 @@
+#version 430 core
+// the lookup tables of the sky, run as three passes selected by
+// atmospherePass - the transmittance from every height and zenith angle to
+// the top of the atmosphere, the light scattered any number of times for
+// every height and sun zenith angle, and the sky radiance around the viewer
+// for the current sun; distances are in kilometers
+layout (local_size_x = 8, local_size_y = 8) in;
+
+layout (rgba32f, binding = 0) uniform writeonly image2D transmittanceImage;
+layout (rgba32f, binding = 1) uniform writeonly image2D multiScatteringImage;
+layout (rgba16f, binding = 2) uniform writeonly image2D skyViewImage;
+
+// the tables written by the earlier passes
+uniform sampler2D transmittanceTable;
+uniform sampler2D multiScatteringTable;
+
+uniform int atmospherePass;
+uniform float groundRadius;
+uniform float topRadius;
+uniform vec3 rayleighScattering;
+uniform float rayleighScaleHeight;
+uniform float mieScattering;
+uniform float mieExtinction;
+uniform float mieScaleHeight;
+uniform float mieAnisotropy;
+uniform vec3 ozoneAbsorption;
+uniform vec3 groundAlbedo;
+uniform vec3 sunIlluminance;
+
+// the viewer and the sun of the sky-view table
+uniform float viewHeight;
+uniform vec3 sunDirection;
+
+const float PI = 3.14159265f;
+const int TRANSMITTANCE_STEPS = 40;
+const int MULTI_SCATTERING_STEPS = 20;
+const int MULTI_SCATTERING_DIRECTIONS = 8;
+const int SKY_VIEW_STEPS = 30;
+
+// scattering and extinction of the air at a height above the ground
+struct Medium {
+    vec3 rayleigh;
+    vec3 mie;
+    vec3 extinction;
+};
+
+Medium SampleMedium(float height)
+{
+    float rayleighDensity = exp(-height / rayleighScaleHeight);
+    float mieDensity = exp(-height / mieScaleHeight);
+    float ozoneDensity = max(0.0f, 1.0f - (abs(height - 25.0f) / 15.0f));
+
+    Medium medium;
+    medium.rayleigh = rayleighScattering * rayleighDensity;
+    medium.mie = vec3(mieScattering * mieDensity);
+    medium.extinction = medium.rayleigh + vec3(mieExtinction * mieDensity) + (ozoneAbsorption * ozoneDensity);
+    return medium;
+}
+
+// distance along a ray from a radius at a zenith cosine to a sphere, -1
+// when it misses
+float DistanceToSphere(float r, float mu, float radius)
+{
+    float discriminant = (r * r * ((mu * mu) - 1.0f)) + (radius * radius);
+    if(discriminant < 0.0f)
+    {
+        return -1.0f;
+    }
+    float root = sqrt(discriminant);
+    float near = (-r * mu) - root;
+    float far = (-r * mu) + root;
+    if(near >= 0.0f)
+    {
+        return near;
+    }
+    return (far >= 0.0f) ? far : -1.0f;
+}
+
+// the mapping of the transmittance table, from Bruneton's precomputed
+// atmospheric scattering, giving more texels to rays near the horizon
+vec2 TransmittanceUV(float r, float mu)
+{
+    float horizon = sqrt((topRadius * topRadius) - (groundRadius * groundRadius));
+    float rho = sqrt(max((r * r) - (groundRadius * groundRadius), 0.0f));
+    float discriminant = (r * r * ((mu * mu) - 1.0f)) + (topRadius * topRadius);
+    float d = max((-r * mu) + sqrt(max(discriminant, 0.0f)), 0.0f);
+    float dMin = topRadius - r;
+    float dMax = rho + horizon;
+    return vec2((d - dMin) / (dMax - dMin), rho / horizon);
+}
+
+void TransmittanceRay(vec2 uv, out float r, out float mu)
+{
+    float horizon = sqrt((topRadius * topRadius) - (groundRadius * groundRadius));
+    float rho = horizon * uv.y;
+    r = sqrt((rho * rho) + (groundRadius * groundRadius));
+    float dMin = topRadius - r;
+    float dMax = rho + horizon;
+    float d = dMin + (uv.x * (dMax - dMin));
+    mu = (d == 0.0f) ? 1.0f : ((horizon * horizon) - (rho * rho) - (d * d)) / (2.0f * r * d);
+    mu = clamp(mu, -1.0f, 1.0f);
+}
+
+// transmittance to the top of the atmosphere, zero below the horizon
+vec3 SunTransmittance(float r, float mu)
+{
+    if(DistanceToSphere(r, mu, groundRadius) > 0.0f)
+    {
+        return vec3(0.0f);
+    }
+    return texture(transmittanceTable, TransmittanceUV(r, mu)).rgb;
+}
+
+// light scattered more than once, reaching a height with the sun at a
+// zenith cosine
+vec3 MultiScattering(float r, float muSun)
+{
+    vec2 uv = vec2((muSun * 0.5f) + 0.5f, (r - groundRadius) / (topRadius - groundRadius));
+    return texture(multiScatteringTable, clamp(uv, 0.0f, 1.0f)).rgb;
+}
+
+float RayleighPhase(float cosAngle)
+{
+    return (3.0f / (16.0f * PI)) * (1.0f + (cosAngle * cosAngle));
+}
+
+// Cornette-Shanks phase function
+float MiePhase(float cosAngle)
+{
+    float g = mieAnisotropy;
+    float g2 = g * g;
+    float denominator = 1.0f + g2 - (2.0f * g * cosAngle);
+    return (3.0f / (8.0f * PI)) * ((1.0f - g2) * (1.0f + (cosAngle * cosAngle))) /
+           ((2.0f + g2) * denominator * sqrt(denominator));
+}
+
+// integrate the optical depth from a texel's height and zenith angle to
+// the top of the atmosphere
+void ComputeTransmittance(ivec2 texel, ivec2 size)
+{
+    float r;
+    float mu;
+    TransmittanceRay((vec2(texel) + 0.5f) / vec2(size), r, mu);
+
+    float rayLength = DistanceToSphere(r, mu, topRadius);
+    float dt = max(rayLength, 0.0f) / float(TRANSMITTANCE_STEPS);
+    vec3 opticalDepth = vec3(0.0f);
+    for(int i = 0; i < TRANSMITTANCE_STEPS; i++)
+    {
+        float t = (float(i) + 0.5f) * dt;
+        float height = sqrt((r * r) + (t * t) + (2.0f * r * mu * t)) - groundRadius;
+        opticalDepth += SampleMedium(height).extinction * dt;
+    }
+    imageStore(transmittanceImage, texel, vec4(exp(-opticalDepth), 1.0f));
+}
+
+// Hillaire's multiple scattering approximation - the light scattered
+// twice toward a point from all directions, with isotropic phase, and the
+// fraction of light the surroundings scatter back, summed as a geometric
+// series into the light scattered any number of times
+void ComputeMultiScattering(ivec2 texel, ivec2 size)
+{
+    vec2 uv = (vec2(texel) + 0.5f) / vec2(size);
+    float muSun = (uv.x * 2.0f) - 1.0f;
+    float r = groundRadius + (uv.y * (topRadius - groundRadius));
+    vec3 sun = vec3(sqrt(1.0f - (muSun * muSun)), muSun, 0.0f);
+    const float isotropicPhase = 1.0f / (4.0f * PI);
+
+    vec3 secondOrder = vec3(0.0f);
+    vec3 transfer = vec3(0.0f);
+    for(int j = 0; j < MULTI_SCATTERING_DIRECTIONS; j++)
+    {
+        for(int i = 0; i < MULTI_SCATTERING_DIRECTIONS; i++)
+        {
+            float cosTheta = 1.0f - (2.0f * (float(j) + 0.5f) / float(MULTI_SCATTERING_DIRECTIONS));
+            float sinTheta = sqrt(1.0f - (cosTheta * cosTheta));
+            float phi = 2.0f * PI * (float(i) + 0.5f) / float(MULTI_SCATTERING_DIRECTIONS);
+            vec3 direction = vec3(sinTheta * cos(phi), cosTheta, sinTheta * sin(phi));
+
+            float groundDistance = DistanceToSphere(r, direction.y, groundRadius);
+            float rayLength = (groundDistance > 0.0f) ? groundDistance : DistanceToSphere(r, direction.y, topRadius);
+            float dt = max(rayLength, 0.0f) / float(MULTI_SCATTERING_STEPS);
+
+            vec3 throughput = vec3(1.0f);
+            vec3 luminance = vec3(0.0f);
+            vec3 fraction = vec3(0.0f);
+            for(int k = 0; k < MULTI_SCATTERING_STEPS; k++)
+            {
+                vec3 position = vec3(0.0f, r, 0.0f) + (direction * ((float(k) + 0.5f) * dt));
+                float sampleRadius = length(position);
+                Medium medium = SampleMedium(sampleRadius - groundRadius);
+                vec3 scattering = medium.rayleigh + medium.mie;
+                vec3 stepTransmittance = exp(-medium.extinction * dt);
+                vec3 toSun = SunTransmittance(sampleRadius, dot(position / sampleRadius, sun));
+
+                // integrate the scattering over the step analytically
+                vec3 integral = (vec3(1.0f) - stepTransmittance) / max(medium.extinction, vec3(1e-6f));
+                luminance += throughput * scattering * isotropicPhase * toSun * integral;
+                fraction += throughput * scattering * integral;
+                throughput *= stepTransmittance;
+            }
+
+            // the sunlit ground bounces light back up
+            if(groundDistance > 0.0f)
+            {
+                vec3 ground = vec3(0.0f, r, 0.0f) + (direction * groundDistance);
+                vec3 normal = normalize(ground);
+                float muGround = dot(normal, sun);
+                luminance += throughput * SunTransmittance(groundRadius, muGround) *
+                             max(muGround, 0.0f) * groundAlbedo / PI;
+            }
+
+            secondOrder += luminance / float(MULTI_SCATTERING_DIRECTIONS * MULTI_SCATTERING_DIRECTIONS);
+            transfer += fraction * isotropicPhase * (4.0f * PI) /
+                        float(MULTI_SCATTERING_DIRECTIONS * MULTI_SCATTERING_DIRECTIONS);
+        }
+    }
+
+    vec3 multiScattering = secondOrder / max(vec3(1.0f) - transfer, vec3(1e-3f));
+    imageStore(multiScatteringImage, texel, vec4(multiScattering, 1.0f));
+}
+
+// the view zenith cosine of a row of the sky-view table, with half the
+// rows above the horizon and half below, packed toward the horizon
+float SkyViewZenithCosine(float v)
+{
+    float horizonCos = sqrt((viewHeight * viewHeight) - (groundRadius * groundRadius)) / viewHeight;
+    float beta = acos(horizonCos);
+    float zenithHorizonAngle = PI - beta;
+    if(v < 0.5f)
+    {
+        float coord = 1.0f - (2.0f * v);
+        coord = 1.0f - (coord * coord);
+        return cos(zenithHorizonAngle * coord);
+    }
+    float coord = (v * 2.0f) - 1.0f;
+    return cos(zenithHorizonAngle + (beta * coord * coord));
+}
+
+// march from the viewer along a texel's direction, gathering the sunlight
+// scattered once toward it and the multiple scattering
+void ComputeSkyView(ivec2 texel, ivec2 size)
+{
+    vec2 uv = (vec2(texel) + 0.5f) / vec2(size);
+    float viewCos = SkyViewZenithCosine(uv.y);
+    float azimuth = uv.x * PI;
+    float viewSin = sqrt(max(1.0f - (viewCos * viewCos), 0.0f));
+
+    // the sun lies in the x y plane, the azimuth measured from it
+    float sunCos = clamp(sunDirection.y, -1.0f, 1.0f);
+    vec3 sun = vec3(sqrt(max(1.0f - (sunCos * sunCos), 0.0f)), sunCos, 0.0f);
+    vec3 direction = vec3(viewSin * cos(azimuth), viewCos, viewSin * sin(azimuth));
+    float cosAngle = dot(direction, sun);
+    float rayleighPhase = RayleighPhase(cosAngle);
+    float miePhase = MiePhase(cosAngle);
+
+    float groundDistance = DistanceToSphere(viewHeight, viewCos, groundRadius);
+    float rayLength = (groundDistance > 0.0f) ? groundDistance : DistanceToSphere(viewHeight, viewCos, topRadius);
+    float dt = max(rayLength, 0.0f) / float(SKY_VIEW_STEPS);
+
+    vec3 throughput = vec3(1.0f);
+    vec3 luminance = vec3(0.0f);
+    for(int i = 0; i < SKY_VIEW_STEPS; i++)
+    {
+        vec3 position = vec3(0.0f, viewHeight, 0.0f) + (direction * ((float(i) + 0.5f) * dt));
+        float sampleRadius = length(position);
+        float sampleSunCos = dot(position / sampleRadius, sun);
+        Medium medium = SampleMedium(sampleRadius - groundRadius);
+        vec3 stepTransmittance = exp(-medium.extinction * dt);
+        vec3 toSun = SunTransmittance(sampleRadius, sampleSunCos);
+
+        vec3 inScattering = (toSun * ((medium.rayleigh * rayleighPhase) + (medium.mie * miePhase))) +
+                            (MultiScattering(sampleRadius, sampleSunCos) * (medium.rayleigh + medium.mie));
+        vec3 integral = (vec3(1.0f) - stepTransmittance) / max(medium.extinction, vec3(1e-6f));
+        luminance += throughput * inScattering * integral;
+        throughput *= stepTransmittance;
+    }
+
+    imageStore(skyViewImage, texel, vec4(luminance * sunIlluminance, 1.0f));
+}
+
+void main()
+{
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    if(atmospherePass == 0)
+    {
+        ivec2 size = imageSize(transmittanceImage);
+        if((texel.x < size.x) && (texel.y < size.y))
+        {
+            ComputeTransmittance(texel, size);
+        }
+    }
+    else if(atmospherePass == 1)
+    {
+        ivec2 size = imageSize(multiScatteringImage);
+        if((texel.x < size.x) && (texel.y < size.y))
+        {
+            ComputeMultiScattering(texel, size);
+        }
+    }
+    else
+    {
+        ivec2 size = imageSize(skyViewImage);
+        if((texel.x < size.x) && (texel.y < size.y))
+        {
+            ComputeSkyView(texel, size);
+        }
+    }
+}
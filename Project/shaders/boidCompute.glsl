@@ -0,0 +1,234 @@
+#version 430 core
+// one step of the fish school flocking, run as four passes selected by
+// simulationPass - counting the agents of each hash bucket, summing the
+// counts into bucket starts, scattering the agents into bucket order and
+// steering and moving them
+layout (local_size_x = 256) in;
+
+struct Agent {
+    vec4 position;
+    vec4 velocity;
+};
+
+struct Instance {
+    vec4 positionHeading;
+    vec4 scaleTimeSpeed;
+};
+
+layout (std430, binding = 0) buffer Agents { Agent agents[]; };
+// agent count of each bucket, then the first sorted agent of each
+// bucket, with one more entry holding the agent count
+layout (std430, binding = 1) buffer Buckets { uint buckets[]; };
+// next free sorted slot of each bucket while scattering
+layout (std430, binding = 2) buffer Cursors { uint cursors[]; };
+// agents in bucket order, the original index is kept in position.w
+layout (std430, binding = 3) buffer Sorted { Agent sorted[]; };
+layout (std430, binding = 4) buffer Instances { Instance instances[]; };
+
+uniform int simulationPass;
+uniform uint agentCount;
+uniform uint bucketMask;
+uniform float deltaSeconds;
+uniform float neighborRadius;
+uniform float separationRadius;
+uniform float separationWeight;
+uniform float alignmentWeight;
+uniform float cohesionWeight;
+uniform float avoidanceMargin;
+uniform float avoidanceWeight;
+uniform float maxAcceleration;
+uniform float minSpeed;
+uniform float maxSpeed;
+uniform vec3 boundsMin;
+uniform vec3 boundsMax;
+
+shared uint groupSums[256];
+
+// hash the integer coordinates of a grid cell, the same as the CPU path
+uint HashCell(ivec3 cell)
+{
+    uvec3 u = uvec3(cell);
+    return ((u.x * 73856093u) ^ (u.y * 19349663u) ^ (u.z * 83492791u)) & bucketMask;
+}
+
+ivec3 CellOf(vec3 position)
+{
+    return ivec3(floor(position / neighborRadius));
+}
+
+// count the agents of each bucket
+void CountAgents(uint agent)
+{
+    if (agent < agentCount)
+    {
+        atomicAdd(buckets[HashCell(CellOf(agents[agent].position.xyz))], 1u);
+    }
+}
+
+// turn the counts into bucket starts in one work group, each thread
+// summing a contiguous run of buckets and the runs then summed in
+// shared memory
+void ScanBuckets(uint thread)
+{
+    uint bucketCount = bucketMask + 1u;
+    uint runLength = bucketCount / 256u;
+    uint first = thread * runLength;
+
+    uint runSum = 0u;
+    for (uint i = 0u; i < runLength; i++)
+    {
+        runSum += buckets[first + i];
+    }
+    groupSums[thread] = runSum;
+    barrier();
+
+    for (uint offset = 1u; offset < 256u; offset *= 2u)
+    {
+        uint value = (thread >= offset) ? groupSums[thread - offset] : 0u;
+        barrier();
+        groupSums[thread] += value;
+        barrier();
+    }
+
+    uint start = groupSums[thread] - runSum;
+    for (uint i = 0u; i < runLength; i++)
+    {
+        uint count = buckets[first + i];
+        buckets[first + i] = start;
+        cursors[first + i] = start;
+        start += count;
+    }
+    if (thread == 255u)
+    {
+        buckets[bucketCount] = agentCount;
+    }
+}
+
+// copy each agent into the next free slot of its bucket
+void ScatterAgents(uint agent)
+{
+    if (agent < agentCount)
+    {
+        Agent value = agents[agent];
+        uint slot = atomicAdd(cursors[HashCell(CellOf(value.position.xyz))], 1u);
+        value.position.w = uintBitsToFloat(agent);
+        sorted[slot] = value;
+    }
+}
+
+// steer a sorted agent by its neighbors and the walls and move it
+void MoveAgent(uint index)
+{
+    if (index >= agentCount)
+    {
+        return;
+    }
+
+    vec3 position = sorted[index].position.xyz;
+    vec3 velocity = sorted[index].velocity.xyz;
+    uint agent = floatBitsToUint(sorted[index].position.w);
+    ivec3 cell = CellOf(position);
+
+    float neighborRadius2 = neighborRadius * neighborRadius;
+    float separationRadius2 = separationRadius * separationRadius;
+    uint neighborCount = 0u;
+    vec3 positionSum = vec3(0.0);
+    vec3 velocitySum = vec3(0.0);
+    vec3 separation = vec3(0.0);
+
+    uint visited[27];
+    int visitedCount = 0;
+    for (int z = -1; z <= 1; z++)
+    {
+        for (int y = -1; y <= 1; y++)
+        {
+            for (int x = -1; x <= 1; x++)
+            {
+                uint bucket = HashCell(cell + ivec3(x, y, z));
+                bool bSeen = false;
+                for (int i = 0; i < visitedCount; i++)
+                {
+                    bSeen = bSeen || (visited[i] == bucket);
+                }
+                if (bSeen)
+                {
+                    continue;
+                }
+                visited[visitedCount++] = bucket;
+
+                for (uint other = buckets[bucket]; other < buckets[bucket + 1u]; other++)
+                {
+                    vec3 otherPosition = sorted[other].position.xyz;
+                    vec3 offset = otherPosition - position;
+                    float distance2 = dot(offset, offset);
+                    if ((distance2 >= neighborRadius2) || (distance2 <= 0.0))
+                    {
+                        continue;
+                    }
+                    neighborCount++;
+                    positionSum += otherPosition;
+                    velocitySum += sorted[other].velocity.xyz;
+                    if (distance2 < separationRadius2)
+                    {
+                        separation -= offset / distance2;
+                    }
+                }
+            }
+        }
+    }
+
+    vec3 acceleration = separation * separationWeight;
+    if (neighborCount > 0u)
+    {
+        float inverseCount = 1.0 / float(neighborCount);
+        acceleration += ((velocitySum * inverseCount) - velocity) * alignmentWeight;
+        acceleration += ((positionSum * inverseCount) - position) * cohesionWeight;
+    }
+    vec3 low = max((boundsMin + avoidanceMargin) - position, 0.0);
+    vec3 high = max(position - (boundsMax - avoidanceMargin), 0.0);
+    acceleration += ((low - high) / avoidanceMargin) * avoidanceWeight;
+
+    float accelerationLength = length(acceleration);
+    if (accelerationLength > maxAcceleration)
+    {
+        acceleration *= maxAcceleration / accelerationLength;
+    }
+
+    velocity += acceleration * deltaSeconds;
+    float speed = length(velocity);
+    if (speed < 0.0001)
+    {
+        velocity = vec3(-minSpeed, 0.0, 0.0);
+    }
+    else
+    {
+        velocity *= clamp(speed, minSpeed, maxSpeed) / speed;
+    }
+    position = clamp(position + (velocity * deltaSeconds), boundsMin, boundsMax);
+
+    agents[agent].position = vec4(position, 0.0);
+    agents[agent].velocity = vec4(velocity, 0.0);
+    // the fish swims along -x at heading zero
+    instances[agent].positionHeading = vec4(position, atan(velocity.z, -velocity.x));
+}
+
+void main()
+{
+    uint index = gl_GlobalInvocationID.x;
+    if (simulationPass == 0)
+    {
+        CountAgents(index);
+    }
+    else if (simulationPass == 1)
+    {
+        ScanBuckets(gl_LocalInvocationID.x);
+    }
+    else if (simulationPass == 2)
+    {
+        ScatterAgents(index);
+    }
+    else
+    {
+        MoveAgent(index);
+    }
+}
@@ -0,0 +1,207 @@
+#version 430 core
+// the grass and reeds of the lakeshore, run as three passes selected by
+// foliagePass - scattering the clumps of one terrain tile from its heights
+// and density map, culling the clumps of every tile into the instances of
+// their level of detail, and clamping the instance counts of the draws
+layout (local_size_x = 256) in;
+
+struct Clump {
+    vec4 positionHeading;
+    vec4 heightWidthPhaseKind;
+};
+
+// heights of every slot with a border of one sample, then a reed and a
+// grass density at every vertex of the tile grid
+layout (std430, binding = 0) buffer Tiles { float tiles[]; };
+// clumps scattered into every slot
+layout (std430, binding = 1) buffer Counts { uint counts[]; };
+layout (std430, binding = 2) buffer Scattered { Clump scattered[]; };
+// clumps drawn, the detailed ones first and the simple ones from maxVisible
+layout (std430, binding = 3) buffer Visible { Clump visible[]; };
+// two indexed indirect draw commands of five values each
+layout (std430, binding = 4) buffer Commands { uint commands[]; };
+
+uniform int foliagePass;
+uniform uint slotCapacity;
+uniform int slotFloats;
+uniform int tileGridResolution;
+uniform float tileSize;
+uniform int candidatesPerSide;
+uniform uint seed;
+
+// the tile being scattered
+uniform int tileSlot;
+uniform ivec2 tileIndex;
+uniform vec2 tileCorner;
+
+// the view the clumps are culled for, the planes facing inward
+uniform vec4 frustumPlanes[6];
+uniform vec3 cameraPosition;
+uniform float range;
+uniform float fadeStart;
+uniform float detailRange;
+uniform int slotCount;
+uniform uint maxVisible;
+
+// PCG hash of an integer
+uint Hash(uint value)
+{
+    uint state = (value * 747796405u) + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+// the next random value between 0 and 1 of a sequence
+float Random(inout uint state)
+{
+    state = Hash(state);
+    return float(state) / 4294967295.0f;
+}
+
+// height of the tile at a position on its grid, split into triangles
+// the same way as the terrain grid
+float TileHeight(vec2 gridPosition)
+{
+    int tileSamples = tileGridResolution + 3;
+    int first = tileSlot * slotFloats;
+    ivec2 cell = clamp(ivec2(floor(gridPosition)), ivec2(0), ivec2(tileGridResolution - 1));
+    vec2 fraction = gridPosition - vec2(cell);
+    int corner = first + ((cell.y + 1) * tileSamples) + (cell.x + 1);
+
+    float h00 = tiles[corner];
+    float h10 = tiles[corner + 1];
+    float h01 = tiles[corner + tileSamples];
+    float h11 = tiles[corner + tileSamples + 1];
+    if(fraction.x + fraction.y <= 1.0f)
+    {
+        return h00 + ((h10 - h00) * fraction.x) + ((h01 - h00) * fraction.y);
+    }
+    return h11 + ((h01 - h11) * (1.0f - fraction.x)) + ((h10 - h11) * (1.0f - fraction.y));
+}
+
+// reed and grass density of the tile at a position on its grid
+vec2 TileDensity(vec2 gridPosition)
+{
+    int tileSamples = tileGridResolution + 3;
+    int texels = tileGridResolution + 1;
+    int first = (tileSlot * slotFloats) + (tileSamples * tileSamples);
+    ivec2 cell = clamp(ivec2(floor(gridPosition)), ivec2(0), ivec2(tileGridResolution - 1));
+    vec2 fraction = gridPosition - vec2(cell);
+    int corner = first + (((cell.y * texels) + cell.x) * 2);
+    int above = corner + (texels * 2);
+
+    vec2 bottom = mix(vec2(tiles[corner], tiles[corner + 1]), vec2(tiles[corner + 2], tiles[corner + 3]), fraction.x);
+    vec2 top = mix(vec2(tiles[above], tiles[above + 1]), vec2(tiles[above + 2], tiles[above + 3]), fraction.x);
+    return mix(bottom, top, fraction.y);
+}
+
+// grow at most one clump at a candidate position, jittered inside its
+// cell of the tile, as reeds or grass by the density map
+void ScatterClump(uint candidate)
+{
+    uint side = uint(candidatesPerSide);
+    if(candidate >= side * side)
+    {
+        return;
+    }
+
+    uint state = Hash(candidate + Hash(uint(tileIndex.x) + Hash(uint(tileIndex.y) + seed)));
+    vec2 cell = vec2(float(candidate % side), float(candidate / side));
+    vec2 jitter = vec2(Random(state), Random(state)) - 0.5f;
+    vec2 position = (cell + 0.5f + (jitter * 0.8f)) / float(side);
+    vec2 gridPosition = position * float(tileGridResolution);
+
+    vec2 density = TileDensity(gridPosition);
+    float pick = Random(state);
+    float kind;
+    if(pick < density.x)
+    {
+        kind = 1.0f;
+    }
+    else if(pick < density.x + density.y)
+    {
+        kind = 0.0f;
+    }
+    else
+    {
+        return;
+    }
+
+    float size = mix(0.7f, 1.3f, Random(state));
+    Clump clump;
+    clump.positionHeading = vec4(tileCorner.x + (position.x * tileSize),
+                                 TileHeight(gridPosition),
+                                 tileCorner.y + (position.y * tileSize),
+                                 Random(state) * 6.2831853f);
+    clump.heightWidthPhaseKind = vec4((kind == 1.0f) ? (1.6f * size) : (0.45f * size),
+                                      (kind == 1.0f) ? 0.03f : 0.05f,
+                                      Random(state) * 6.2831853f,
+                                      kind);
+
+    uint index = atomicAdd(counts[tileSlot], 1u);
+    scattered[(uint(tileSlot) * slotCapacity) + index] = clump;
+}
+
+// keep a clump in view and in range, thinning out over the fade by its
+// own phase so the same clumps drop first every frame, and append it to
+// the instances of its level of detail
+void CullClump(uint index)
+{
+    uint slot = index / slotCapacity;
+    if((slot >= uint(slotCount)) || ((index % slotCapacity) >= counts[slot]))
+    {
+        return;
+    }
+
+    Clump clump = scattered[index];
+    vec3 root = clump.positionHeading.xyz;
+    float height = clump.heightWidthPhaseKind.x;
+    float distanceToCamera = distance(cameraPosition, root);
+    float keep = clump.heightWidthPhaseKind.z / 6.2831853f;
+    if(distanceToCamera > mix(fadeStart, range, keep))
+    {
+        return;
+    }
+
+    // a sphere around the clump, wide enough for it to sway
+    vec3 center = root + vec3(0.0f, height * 0.5f, 0.0f);
+    float radius = height * 0.75f;
+    for(int i = 0; i < 6; i++)
+    {
+        if(dot(frustumPlanes[i].xyz, center) + frustumPlanes[i].w < -radius)
+        {
+            return;
+        }
+    }
+
+    uint level = (distanceToCamera < detailRange) ? 0u : 1u;
+    uint instance = atomicAdd(commands[(level * 5u) + 1u], 1u);
+    if(instance < maxVisible)
+    {
+        visible[(level * maxVisible) + instance] = clump;
+    }
+}
+
+// keep the draws inside their half of the instances
+void ClampCounts()
+{
+    commands[1] = min(commands[1], maxVisible);
+    commands[6] = min(commands[6], maxVisible);
+}
+
+void main()
+{
+    uint index = gl_GlobalInvocationID.x;
+    if(foliagePass == 0)
+    {
+        ScatterClump(index);
+    }
+    else if(foliagePass == 1)
+    {
+        CullClump(index);
+    }
+    else if(index == 0u)
+    {
+        ClampCounts();
+    }
+}
@@ -1,14 +1,25 @@
 #version 330 core
-out vec4 fragmentColor;
+layout(location = 0) out vec4 fragmentColor;
+// the surface read by the screen-space reflections - the octahedral
+// normal, the roughness and the specular strength
+layout(location = 1) out vec4 fragmentSurface;
 
 in vec3 fragmentPosition;
 in vec3 fragmentVertexNormal;
 in vec2 fragmentTextureCoordinate;
+in vec3 gouraudLight;
+in vec3 gouraudSpecular;
 
 struct Material {
     vec3 diffuseColor;
     vec3 specularColor;
     float shininess;
+
+    // procedural surface in place of the texture, 0 when not used
+    int proceduralType;
+    vec3 proceduralColorA;
+    vec3 proceduralColorB;
+    vec4 proceduralParams;
 }; 
 
 struct DirectionalLight {
@@ -23,6 +34,10 @@ struct DirectionalLight {
 
 struct PointLight {
     vec3 position;
+
+    float constant;
+    float linear;
+    float quadratic;
     
     vec3 ambient;
     vec3 diffuse;
@@ -49,34 +64,137 @@ struct SpotLight {
 };
 
 #define TOTAL_POINT_LIGHTS 5
+// a point light is culled from an object where its attenuation falls to
+// this fraction, matching g_LightCutoffAttenuation in SceneManager.cpp,
+// so it fades out to nothing there
+const float POINT_LIGHT_CUTOFF = 1.0f / 256.0f;
 
 uniform bool bUseTexture=false;
 uniform bool bUseLighting=false;
+uniform bool bDepthOnly=false;
+uniform bool bVertexLighting=false;
+uniform bool bShadingTierDebug=false;
 uniform vec4 objectColor = vec4(1.0f);
 uniform vec3 viewPosition;
 uniform DirectionalLight directionalLight;
 uniform PointLight pointLights[TOTAL_POINT_LIGHTS];
+// indices of the point lights assigned to the object being drawn
+uniform int pointLightCount = 0;
+uniform int pointLightIndices[TOTAL_POINT_LIGHTS];
 uniform SpotLight spotLight;
 uniform Material material;
 uniform sampler2D objectTexture;
 uniform vec2 UVscale = vec2(1.0f, 1.0f);
+// texture packed into an atlas, with its rectangle as offset (xy) and size (zw)
+uniform bool bAtlasTexture=false;
+uniform vec4 atlasRect = vec4(0.0f, 0.0f, 1.0f, 1.0f);
+
+// virtual texture, sampled through the page table from the tile cache
+uniform bool bVirtualTexture=false;
+uniform bool bVirtualTextureFeedback=false;
+uniform sampler2D virtualTexturePhysical;
+uniform sampler2D virtualTexturePageTable;
+uniform int virtualTextureID = 0;
+uniform float virtualTextureSize = 1.0f;
+uniform int virtualTextureMipCount = 1;
+uniform float virtualTextureTileSize = 1.0f;
+uniform float virtualTextureBorder = 0.0f;
+uniform float virtualTextureCacheSize = 1.0f;
+uniform float virtualTextureLodBias = 0.0f;
+
+// lake surface, lit with the simulated normals and whitened by the foam
+uniform bool bWaterSurface=false;
+uniform sampler2D waterNormals;
+
+// terrain, colored by its height above the lake and its slope
+uniform bool bTerrain=false;
+uniform float terrainShoreHeight = 0.0f;
+
+// foliage clumps, colored by their kind and up the blade
+uniform bool bFoliage=false;
+
+// the sky, looked up in the sky-view table by the angle from the zenith
+// and the azimuth from the sun, in kilometers from the planet center
+uniform bool bSky=false;
+uniform sampler2D skyViewTable;
+uniform vec3 skySunDirection = vec3(0.0f, 1.0f, 0.0f);
+uniform vec3 skySunDiskColor = vec3(0.0f);
+uniform float skyViewHeight = 6360.2f;
+uniform float skyGroundRadius = 6360.0f;
+uniform float skyExposure = 1.0f;
+// cosine of the angular radius of the sun disk
+const float SKY_SUN_DISK_COSINE = 0.99998918f;
 
 // the scaled texture coordinate to use in calculations
 vec2 fragmentTextureCoordinateScaled = fragmentTextureCoordinate * UVscale;
 
 // function prototypes
-vec3 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir);
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
-vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
+vec3 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir, vec3 baseColor);
+vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 baseColor);
+vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 baseColor);
+float CalcPointAttenuation(PointLight light, vec3 fragPos);
+vec4 SampleObjectTexture();
+int VirtualTextureMip(vec2 uv);
+vec4 SampleVirtualTexture(vec2 uv);
+vec3 ProceduralColor(vec2 uv);
+vec3 TerrainColor();
+vec3 FoliageColor();
+vec3 SkyColor(vec3 direction);
+vec2 EncodeNormal(vec3 normal);
 
 void main()
 {   
+    // surfaces without lighting are left out of the reflections
+    fragmentSurface = vec4(0.0f, 0.0f, 1.0f, 0.0f);
+
+    // the depth pre-pass only needs the rasterized depth, so skip all shading
+    if(bDepthOnly == true)
+    {
+        fragmentColor = vec4(0.0f);
+        return;
+    }
+
+    // the sky is one lookup of its table along the view direction
+    if(bSky == true)
+    {
+        fragmentColor = vec4(SkyColor(normalize(fragmentPosition)), 1.0f);
+        return;
+    }
+
+    // the feedback pass writes the virtual texture page this fragment needs
+    if(bVirtualTextureFeedback == true)
+    {
+        fragmentColor = vec4(0.0f);
+        if(bVirtualTexture == true)
+        {
+            int mip = VirtualTextureMip(fragmentTextureCoordinateScaled);
+            int pages = textureSize(virtualTexturePageTable, mip).x;
+            ivec2 page = min(ivec2(fract(fragmentTextureCoordinateScaled) * float(pages)), ivec2(pages - 1));
+            fragmentColor = vec4(vec2(page), float(mip), float(virtualTextureID)) / 255.0f;
+        }
+        return;
+    }
+
+    // the surface color is sampled once and shared by every light, as
+    // the procedural materials evaluate several octaves of noise
+    vec4 baseColor = objectColor;
+    if(bUseTexture == true)
+    {
+        baseColor = SampleObjectTexture();
+    }
+
     if(bUseLighting == true)
     {
         vec3 phongResult = vec3(0.0f);
         // properties
         vec3 norm = normalize(fragmentVertexNormal);
         vec3 viewDir = normalize(viewPosition - fragmentPosition);
+        vec4 waterNormal = vec4(0.0f);
+        if(bWaterSurface == true)
+        {
+            waterNormal = texture(waterNormals, fragmentTextureCoordinate);
+            norm = normalize(waterNormal.xyz);
+        }
     
         // == =====================================================
         // Our lighting is set up in 3 phases: directional, point lights and an optional flashlight
@@ -84,54 +202,65 @@ void main()
         // per light source. In the main() function we take all the calculated colors and sum them 
         // up for this fragment's final color.
         // == =====================================================
-        // phase 1: directional lighting
-        if(directionalLight.bActive == true)
+        if(bVertexLighting == true)
         {
-            phongResult += CalcDirectionalLight(directionalLight, norm, viewDir);
+            // phases 1 and 2 were evaluated per vertex for this small object
+            phongResult += (gouraudLight * vec3(baseColor)) + gouraudSpecular;
         }
-        // phase 2: point lights
-        for(int i = 0; i < TOTAL_POINT_LIGHTS; i++)
+        else
         {
-	    if(pointLights[i].bActive == true)
+            // phase 1: directional lighting
+            if(directionalLight.bActive == true)
+            {
+                phongResult += CalcDirectionalLight(directionalLight, norm, viewDir, vec3(baseColor));
+            }
+            // phase 2: point lights, only those assigned to this object
+            for(int i = 0; i < pointLightCount; i++)
             {
-                phongResult += CalcPointLight(pointLights[i], norm, fragmentPosition, viewDir);   
+                int lightIndex = pointLightIndices[i];
+                if(pointLights[lightIndex].bActive == true)
+                {
+                    phongResult += CalcPointLight(pointLights[lightIndex], norm, fragmentPosition, viewDir, vec3(baseColor));
+                }
             }
-        } 
+        }
         // phase 3: spot light
         if(spotLight.bActive == true)
         {
-            phongResult += CalcSpotLight(spotLight, norm, fragmentPosition, viewDir);    
+            phongResult += CalcSpotLight(spotLight, norm, fragmentPosition, viewDir, vec3(baseColor));
         }
     
-        if(bUseTexture == true)
+        fragmentColor = vec4(phongResult, baseColor.a);
+
+        // the roughness of the Beckmann distribution matching the
+        // Phong shininess of the material
+        float specularStrength = dot(material.specularColor, vec3(0.2126f, 0.7152f, 0.0722f));
+        fragmentSurface = vec4(EncodeNormal(norm), sqrt(2.0f / (material.shininess + 2.0f)), specularStrength);
+
+        // folding crests of the lake turn to foam
+        if(bWaterSurface == true)
         {
-            fragmentColor = vec4(phongResult, (texture(objectTexture, fragmentTextureCoordinateScaled)).a);
+            float foam = clamp(waterNormal.w * 2.0f, 0.0f, 1.0f);
+            fragmentColor.rgb = mix(fragmentColor.rgb, vec3(0.9f), foam);
+            fragmentSurface.w *= 1.0f - foam;
         }
-        else
+
+        // tint by shading tier - green is per-pixel, red is per-vertex
+        if(bShadingTierDebug == true)
         {
-            fragmentColor = vec4(phongResult, objectColor.a);
+            vec3 tierColor = (bVertexLighting == true) ? vec3(1.0f, 0.2f, 0.2f) : vec3(0.2f, 1.0f, 0.2f);
+            fragmentColor.rgb = mix(fragmentColor.rgb, tierColor, 0.5f);
         }
     }
     else
     {
-        if(bUseTexture == true)
-        {
-            fragmentColor = texture(objectTexture, fragmentTextureCoordinateScaled);
-        }
-        else
-        {
-            fragmentColor = objectColor;
-        }
+        fragmentColor = baseColor;
     }
 }
 
 // calculates the color when using a directional light.
-vec3 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir)
+vec3 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir, vec3 baseColor)
 {
-    vec3 ambient = vec3(0.0f);
-    vec3 diffuse = vec3(0.0f);
-    vec3 specular = vec3(0.0f);
-
     vec3 lightDirection = normalize(-light.direction);
     // diffuse shading
     float diff = max(dot(normal, lightDirection), 0.0);
@@ -139,29 +268,16 @@ vec3 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir)
     vec3 reflectDir = reflect(-lightDirection, normal);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
     // combine results
-    if(bUseTexture == true)
-    {
-        ambient = light.ambient * vec3(texture(objectTexture, fragmentTextureCoordinateScaled));
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(texture(objectTexture, fragmentTextureCoordinateScaled));
-        specular = light.specular * spec * material.specularColor * vec3(texture(objectTexture, fragmentTextureCoordinateScaled));
-    }
-    else
-    {
-        ambient = light.ambient * vec3(objectColor);
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(objectColor);
-        specular = light.specular * spec * material.specularColor * vec3(objectColor);
-    }
+    vec3 ambient = light.ambient * baseColor;
+    vec3 diffuse = light.diffuse * diff * material.diffuseColor * baseColor;
+    vec3 specular = light.specular * spec * material.specularColor * baseColor;
     
     return (ambient + diffuse + specular);
 }
 
 // calculates the color when using a point light.
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
+vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 baseColor)
 {
-    vec3 ambient = vec3(0.0f);
-    vec3 diffuse = vec3(0.0f);
-    vec3 specular= vec3(0.0f);
-
     vec3 lightDir = normalize(light.position - fragPos);
     // diffuse shading
     float diff = max(dot(normal, lightDir), 0.0);
@@ -169,31 +285,29 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     vec3 reflectDir = reflect(-lightDir, normal);
     // Calculate specular component
     float specularComponent = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    // attenuation
+    float attenuation = CalcPointAttenuation(light, fragPos);
    
-    // combine results
-    if(bUseTexture == true)
-    {
-        ambient = light.ambient * vec3(texture(objectTexture, fragmentTextureCoordinateScaled));
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(texture(objectTexture, fragmentTextureCoordinateScaled));
-        specular = light.specular * specularComponent * material.specularColor;
-    }
-    else
-    {
-        ambient = light.ambient * vec3(objectColor);
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(objectColor);
-        specular = light.specular * specularComponent * material.specularColor;
-    }
+    // combine results - the specular term is not scaled by the base color
+    vec3 ambient = light.ambient * baseColor;
+    vec3 diffuse = light.diffuse * diff * material.diffuseColor * baseColor;
+    vec3 specular = light.specular * specularComponent * material.specularColor;
     
-    return (ambient + diffuse + specular);
+    return ((ambient + diffuse + specular) * attenuation);
 }
 
-// calculates the color when using a spot light.
-vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
+// calculates the attenuation of a point light, rescaled to reach zero at
+// the cutoff the lights are culled at.
+float CalcPointAttenuation(PointLight light, vec3 fragPos)
 {
-    vec3 ambient = vec3(0.0f);
-    vec3 diffuse = vec3(0.0f);
-    vec3 specular = vec3(0.0f);
+    float distance = length(light.position - fragPos);
+    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+    return max((attenuation - POINT_LIGHT_CUTOFF) / (1.0 - POINT_LIGHT_CUTOFF), 0.0);
+}
 
+// calculates the color when using a spot light.
+vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 baseColor)
+{
     vec3 lightDir = normalize(light.position - fragPos);
     // diffuse shading
     float diff = max(dot(normal, lightDir), 0.0);
@@ -208,21 +322,261 @@ vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     float epsilon = light.cutOff - light.outerCutOff;
     float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
     // combine results
-    if(bUseTexture == true)
-    {
-        ambient = light.ambient * vec3(texture(objectTexture, fragmentTextureCoordinateScaled));
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(texture(objectTexture, fragmentTextureCoordinateScaled));
-        specular = light.specular * spec * material.specularColor * vec3(texture(objectTexture, fragmentTextureCoordinateScaled));
-    }
-    else
-    {
-        ambient = light.ambient * vec3(objectColor);
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(objectColor);
-        specular = light.specular * spec * material.specularColor * vec3(objectColor);
-    }
+    vec3 ambient = light.ambient * baseColor;
+    vec3 diffuse = light.diffuse * diff * material.diffuseColor * baseColor;
+    vec3 specular = light.specular * spec * material.specularColor * baseColor;
     
     ambient *= attenuation * intensity;
     diffuse *= attenuation * intensity;
     specular *= attenuation * intensity;
     return (ambient + diffuse + specular);
 }
+
+// procedural surface types, matching PROCEDURAL_TYPE in ProceduralMaterials.h
+#define PROCEDURAL_WOOD 1
+#define PROCEDURAL_CORK 2
+#define PROCEDURAL_CERAMIC 3
+
+// returns the surface color, from the bound texture or the procedural material.
+vec4 SampleObjectTexture()
+{
+    if(bTerrain == true)
+    {
+        return vec4(TerrainColor(), 1.0f);
+    }
+    if(bFoliage == true)
+    {
+        return vec4(FoliageColor(), 1.0f);
+    }
+    if(material.proceduralType != 0)
+    {
+        return vec4(ProceduralColor(fragmentTextureCoordinateScaled), 1.0f);
+    }
+    if(bVirtualTexture == true)
+    {
+        return SampleVirtualTexture(fragmentTextureCoordinateScaled);
+    }
+    if(bAtlasTexture == true)
+    {
+        // repeat inside the rectangle, with the gradients of the unwrapped
+        // coordinate so the mip level does not jump at the wrap
+        vec2 atlasCoordinate = atlasRect.xy + (fract(fragmentTextureCoordinateScaled) * atlasRect.zw);
+        return textureGrad(objectTexture, atlasCoordinate,
+            dFdx(fragmentTextureCoordinateScaled) * atlasRect.zw,
+            dFdy(fragmentTextureCoordinateScaled) * atlasRect.zw);
+    }
+    return texture(objectTexture, fragmentTextureCoordinateScaled);
+}
+
+// returns the virtual texture mip level with about one texel per pixel.
+int VirtualTextureMip(vec2 uv)
+{
+    vec2 dx = dFdx(uv * virtualTextureSize);
+    vec2 dy = dFdy(uv * virtualTextureSize);
+    float lod = (0.5f * log2(max(dot(dx, dx), dot(dy, dy)))) + virtualTextureLodBias;
+    return clamp(int(floor(lod)), 0, virtualTextureMipCount - 1);
+}
+
+// returns the virtual texture color, from the finest resident tile covering the page.
+vec4 SampleVirtualTexture(vec2 uv)
+{
+    int mip = VirtualTextureMip(uv);
+    vec2 wrapped = fract(uv);
+    int pages = textureSize(virtualTexturePageTable, mip).x;
+    ivec2 page = min(ivec2(wrapped * float(pages)), ivec2(pages - 1));
+
+    // the entry holds the cache slot and the mip of the tile, which is
+    // coarser than requested while the wanted tile is still streaming in
+    vec3 entry = floor((texelFetch(virtualTexturePageTable, page, mip).xyz * 255.0f) + 0.5f);
+    float tilePages = float(textureSize(virtualTexturePageTable, int(entry.z)).x);
+    vec2 inTile = fract(wrapped * tilePages);
+
+    float slotSize = virtualTextureTileSize + (2.0f * virtualTextureBorder);
+    vec2 texel = (entry.xy * slotSize) + virtualTextureBorder + (inTile * virtualTextureTileSize);
+    return textureLod(virtualTexturePhysical, texel / virtualTextureCacheSize, 0.0f);
+}
+
+// == =====================================================
+// The procedural functions below are mirrored line for line by
+// ProceduralMaterials.cpp, which bakes the same surfaces into textures,
+// except for the fading of the octaves finer than a pixel, which the
+// mipmaps of a baked texture take care of.
+// == =====================================================
+
+// integer hash of a lattice cell.
+uint HashCell(uint x, uint y)
+{
+    uint h = (x * 0x8da6b343u) ^ (y * 0xd8163841u);
+    h ^= h >> 15;
+    h *= 0x2c1b3c6du;
+    h ^= h >> 12;
+    h *= 0x297a2d39u;
+    h ^= h >> 15;
+    return h;
+}
+
+// random value in [0, 1] of a cell, wrapped to the period so the noise tiles.
+float LatticeValue(vec2 cell, vec2 period)
+{
+    vec2 wrapped = cell - (period * floor(cell / period));
+    uint h = HashCell(uint(wrapped.x), uint(wrapped.y));
+    return float(h & 0xFFFFFFu) / 16777215.0f;
+}
+
+// smoothly interpolated lattice noise.
+float ValueNoise(vec2 p, vec2 period)
+{
+    vec2 cell = floor(p);
+    vec2 f = p - cell;
+    vec2 u = f * f * (vec2(3.0f) - (f * 2.0f));
+
+    float a = LatticeValue(cell, period);
+    float b = LatticeValue(cell + vec2(1.0f, 0.0f), period);
+    float c = LatticeValue(cell + vec2(0.0f, 1.0f), period);
+    float d = LatticeValue(cell + vec2(1.0f, 1.0f), period);
+
+    return mix(mix(a, b, u.x), mix(c, d, u.x), u.y);
+}
+
+// lattice noise faded to its average of one half as its cells shrink
+// toward a pixel, so it does not alias in the distance.
+float FilteredValueNoise(vec2 p, vec2 period)
+{
+    vec2 width = fwidth(p);
+    float fade = smoothstep(0.25f, 0.5f, max(width.x, width.y));
+    return mix(ValueNoise(p, period), 0.5f, fade);
+}
+
+// four octaves of value noise, each keeping the tiling, the octaves
+// finer than a pixel faded out.
+float Fbm(vec2 p, vec2 period)
+{
+    float sum = 0.0f;
+    float amplitude = 0.5f;
+    for(int octave = 0; octave < 4; octave++)
+    {
+        sum += amplitude * FilteredValueNoise(p, period);
+        p *= 2.0f;
+        period *= 2.0f;
+        amplitude *= 0.5f;
+    }
+    return sum;
+}
+
+// calculates the color of the procedural material at a texture coordinate.
+vec3 ProceduralColor(vec2 uv)
+{
+    vec3 colorA = material.proceduralColorA;
+    vec3 colorB = material.proceduralColorB;
+    vec4 params = material.proceduralParams;
+
+    float scale = floor(params.x);
+    vec2 p = uv * scale;
+    vec2 period = vec2(scale);
+
+    if(material.proceduralType == PROCEDURAL_WOOD)
+    {
+        // growth rings bent by noise stretched along the grain
+        vec2 grainScale = vec2(1.0f, 4.0f);
+        float bend = Fbm(p * grainScale, period * grainScale);
+        float ring = uv.y * floor(params.y) + (bend * params.z);
+        ring = ring - floor(ring);
+        float band = smoothstep(0.2f, 0.8f, abs((ring * 2.0f) - 1.0f));
+        // fine streaks along the grain
+        vec2 streakScale = vec2(1.0f, 16.0f);
+        float streak = Fbm(p * streakScale, period * streakScale);
+        return mix(colorA, colorB, band) * (1.0f - (params.w * streak));
+    }
+    if(material.proceduralType == PROCEDURAL_CORK)
+    {
+        // granules of varying tone with dark pores
+        float granule = Fbm(p * 2.0f, period * 2.0f);
+        float pore = smoothstep(params.y, params.y + 0.05f, FilteredValueNoise(p * 8.0f, period * 8.0f));
+        vec3 color = mix(colorA, colorB, clamp(granule * params.z, 0.0f, 1.0f));
+        return color * (1.0f - (params.w * pore));
+    }
+    if(material.proceduralType == PROCEDURAL_CERAMIC)
+    {
+        // a glaze pooling into slightly darker patches, with fine speckles
+        float pooling = Fbm(p, period);
+        float speckle = smoothstep(params.y, params.y + 0.02f, FilteredValueNoise(p * 16.0f, period * 16.0f));
+        vec3 color = mix(colorA, colorB, clamp(pooling * params.z, 0.0f, 1.0f));
+        return color * (1.0f - (params.w * speckle));
+    }
+
+    return colorA;
+}
+
+// returns the terrain color, sand along the shore, grass on the flat
+// ground and rock on the steep slopes, with patches of lighter grass.
+vec3 TerrainColor()
+{
+    vec3 normal = normalize(fragmentVertexNormal);
+    float patches = ValueNoise(fragmentPosition.xz * 0.05f, vec2(4096.0f));
+    vec3 sand = vec3(0.72f, 0.66f, 0.5f);
+    vec3 grass = mix(vec3(0.2f, 0.34f, 0.12f), vec3(0.32f, 0.42f, 0.16f), patches);
+    vec3 rock = vec3(0.42f, 0.4f, 0.38f);
+
+    float aboveShore = smoothstep(terrainShoreHeight + 0.5f, terrainShoreHeight + 2.5f, fragmentPosition.y);
+    vec3 color = mix(sand, grass, aboveShore);
+    return mix(color, rock, smoothstep(0.8f, 0.6f, normal.y));
+}
+
+// returns the foliage color, dark at the root of each blade and lighter
+// toward the tip, the grass green and the reeds turning to straw.
+vec3 FoliageColor()
+{
+    float tip = fragmentTextureCoordinate.y;
+    vec3 grass = mix(vec3(0.1f, 0.2f, 0.05f), vec3(0.4f, 0.54f, 0.18f), tip);
+    vec3 reed = mix(vec3(0.18f, 0.26f, 0.09f), vec3(0.62f, 0.56f, 0.34f), tip * tip);
+    return mix(grass, reed, fragmentTextureCoordinate.x);
+}
+
+// returns the sky color along a view direction, from the sky-view table
+// with the mapping of the compute program, which packs the rows toward
+// the horizon and covers the azimuths on one side of the sun, plus the
+// sun disk, tone mapped by the exposure.
+vec3 SkyColor(vec3 direction)
+{
+    const float PI = 3.14159265f;
+    float horizonCos = sqrt((skyViewHeight * skyViewHeight) - (skyGroundRadius * skyGroundRadius)) / skyViewHeight;
+    float beta = acos(horizonCos);
+    float zenithHorizonAngle = PI - beta;
+    float zenithAngle = acos(clamp(direction.y, -1.0f, 1.0f));
+
+    vec2 uv;
+    if(zenithAngle < zenithHorizonAngle)
+    {
+        float coord = zenithAngle / zenithHorizonAngle;
+        uv.y = (1.0f - sqrt(max(1.0f - coord, 0.0f))) * 0.5f;
+    }
+    else
+    {
+        float coord = (zenithAngle - zenithHorizonAngle) / beta;
+        uv.y = (sqrt(clamp(coord, 0.0f, 1.0f)) * 0.5f) + 0.5f;
+    }
+
+    vec2 viewFlat = direction.xz;
+    vec2 sunFlat = skySunDirection.xz;
+    float flatLengths = length(viewFlat) * length(sunFlat);
+    float azimuthCos = (flatLengths > 0.000001f) ? dot(viewFlat, sunFlat) / flatLengths : 1.0f;
+    uv.x = acos(clamp(azimuthCos, -1.0f, 1.0f)) / PI;
+    vec3 radiance = texture(skyViewTable, uv).rgb;
+
+    float sunCos = dot(direction, normalize(skySunDirection));
+    radiance += skySunDiskColor * smoothstep(SKY_SUN_DISK_COSINE - 0.000004f, SKY_SUN_DISK_COSINE, sunCos);
+    return vec3(1.0f) - exp(-radiance * skyExposure);
+}
+
+// returns the normal packed into two values between 0 and 1 by folding
+// the lower half of the octahedron over the upper half.
+vec2 EncodeNormal(vec3 normal)
+{
+    normal /= abs(normal.x) + abs(normal.y) + abs(normal.z);
+    vec2 encoded = normal.xy;
+    if(normal.z < 0.0f)
+    {
+        encoded = (vec2(1.0f) - abs(normal.yx)) * vec2((normal.x >= 0.0f) ? 1.0f : -1.0f, (normal.y >= 0.0f) ? 1.0f : -1.0f);
+    }
+    return (encoded * 0.5f) + 0.5f;
+}
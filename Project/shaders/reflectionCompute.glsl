@@ -0,0 +1,360 @@
+#version 430 core
+// screen-space reflections, run as four passes selected by reflectionPass -
+// the first level of the depth pyramid at half the screen resolution from
+// the scene depth, every further level from the one below it, the trace of
+// a reflected ray for every pixel at half resolution, accumulated over the
+// frames, and the blend of the reflections into the scene color
+layout (local_size_x = 8, local_size_y = 8) in;
+
+// the level of the depth pyramid written, and the level below it
+layout (r32f, binding = 0) uniform writeonly image2D hiZWriteImage;
+layout (r32f, binding = 1) uniform readonly image2D hiZReadImage;
+// the reflections of this frame, accumulated with the earlier frames
+layout (rgba16f, binding = 2) uniform writeonly image2D reflectionImage;
+layout (rgba8, binding = 3) uniform image2D sceneColorImage;
+
+uniform sampler2D sceneColor;
+uniform sampler2D sceneDepth;
+// octahedral normal, roughness and specular strength of every pixel
+uniform sampler2D sceneSurface;
+uniform sampler2D hiZTexture;
+// the reflections of the last frame while tracing, and of this frame while
+// blending them into the scene
+uniform sampler2D reflectionTexture;
+
+uniform int reflectionPass;
+uniform mat4 view;
+uniform mat4 projection;
+uniform mat4 inverseView;
+uniform mat4 inverseProjection;
+uniform mat4 previousViewProjection;
+uniform int hiZLevelCount;
+uniform bool bLinearMarch;
+uniform int maxIterations;
+uniform int linearSteps;
+uniform float maxDistance;
+uniform float thickness;
+uniform float maxRoughness;
+uniform float facingReflectance;
+uniform float historyWeight;
+uniform bool bHistory;
+uniform uint frameIndex;
+
+// what a ray that leaves the screen sees, the sky-view table of the
+// atmosphere as a distant probe, or the ambient color without it
+uniform bool bSkyProbe;
+uniform sampler2D skyViewTable;
+uniform vec3 skySunDirection;
+uniform float skyViewHeight;
+uniform float skyGroundRadius;
+uniform float skyExposure;
+uniform vec3 probeColor;
+
+const float PI = 3.14159265f;
+
+// PCG hash of an integer
+uint Hash(uint value)
+{
+    uint state = (value * 747796405u) + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+// the next random value between 0 and 1 of a sequence
+float Random(inout uint state)
+{
+    state = Hash(state);
+    return float(state) / 4294967295.0f;
+}
+
+// normal packed into two values by folding the octahedron
+vec3 DecodeNormal(vec2 encoded)
+{
+    vec2 f = (encoded * 2.0f) - 1.0f;
+    vec3 normal = vec3(f, 1.0f - abs(f.x) - abs(f.y));
+    float fold = clamp(-normal.z, 0.0f, 1.0f);
+    normal.x += (normal.x >= 0.0f) ? -fold : fold;
+    normal.y += (normal.y >= 0.0f) ? -fold : fold;
+    return normalize(normal);
+}
+
+// view space position of a screen position and its depth
+vec3 ViewPosition(vec2 uv, float depth)
+{
+    vec4 position = inverseProjection * vec4((vec3(uv, depth) * 2.0f) - 1.0f, 1.0f);
+    return position.xyz / position.w;
+}
+
+// screen position and depth of a view space position
+vec3 ScreenPosition(vec3 position)
+{
+    vec4 clip = projection * vec4(position, 1.0f);
+    return ((clip.xyz / clip.w) * 0.5f) + 0.5f;
+}
+
+// distance in front of the camera of a depth
+float LinearDepth(float depth)
+{
+    return -ViewPosition(vec2(0.5f), depth).z;
+}
+
+// smallest of the two by two texels of the level below, and of the extra
+// row and column folded into the last texels when the level below is odd
+float MinimumBelow(ivec2 texel, ivec2 size, ivec2 belowSize)
+{
+    ivec2 first = texel * 2;
+    ivec2 last = min(first + 1, belowSize - 1);
+    if(texel.x == size.x - 1)
+    {
+        last.x = belowSize.x - 1;
+    }
+    if(texel.y == size.y - 1)
+    {
+        last.y = belowSize.y - 1;
+    }
+
+    float minimum = 1.0f;
+    for(int y = first.y; y <= last.y; y++)
+    {
+        for(int x = first.x; x <= last.x; x++)
+        {
+            float depth = (reflectionPass == 0) ? texelFetch(sceneDepth, ivec2(x, y), 0).r :
+                                                  imageLoad(hiZReadImage, ivec2(x, y)).r;
+            minimum = min(minimum, depth);
+        }
+    }
+    return minimum;
+}
+
+// point where the ray leaves a cell of the pyramid, nudged into the next
+vec3 IntersectCellBoundary(vec3 origin, vec3 direction, vec2 cell, vec2 cellCount, vec2 crossStep, vec2 crossOffset)
+{
+    vec2 boundary = ((cell + crossStep) / cellCount) + crossOffset;
+    vec2 delta = (boundary - origin.xy) / direction.xy;
+    return origin + (direction * min(delta.x, delta.y));
+}
+
+// Uludag's hierarchical trace - the ray walks the depth pyramid from its
+// finest level, stepping to the nearest depth in a cell when it is in
+// front of everything there and climbing a level to cross the cell when
+// it is not, so open space is crossed in a few big steps; only rays going
+// away from the camera can be traced against the nearest depths
+bool HiZTrace(vec3 start, vec3 ray, out vec3 hit, out int iterations)
+{
+    vec2 crossStep = vec2((ray.x >= 0.0f) ? 1.0f : -1.0f, (ray.y >= 0.0f) ? 1.0f : -1.0f);
+    vec2 crossOffset = crossStep * 0.00001f;
+    crossStep = clamp(crossStep, 0.0f, 1.0f);
+
+    // along this direction the depth grows by one, from an origin at
+    // depth zero, so the depth of a point is also its distance
+    vec3 direction = ray / ray.z;
+    direction.xy = sign(direction.xy + 1e-12f) * max(abs(direction.xy), vec2(1e-7f));
+    vec3 origin = start - (direction * start.z);
+    float endDepth = start.z + ray.z;
+
+    int level = 0;
+    vec2 cellCount = vec2(textureSize(hiZTexture, 0));
+    vec3 position = IntersectCellBoundary(origin, direction, floor(start.xy * cellCount), cellCount, crossStep, crossOffset);
+    hit = position;
+    for(iterations = 0; (level >= 0) && (iterations < maxIterations); iterations++)
+    {
+        if(any(lessThan(position.xy, vec2(0.0f))) || any(greaterThanEqual(position.xy, vec2(1.0f))) || (position.z > endDepth))
+        {
+            return false;
+        }
+
+        cellCount = vec2(textureSize(hiZTexture, level));
+        vec2 cell = floor(position.xy * cellCount);
+        float minimum = texelFetch(hiZTexture, ivec2(cell), level).r;
+        vec3 next = origin + (direction * max(position.z, minimum));
+        if(floor(next.xy * cellCount) != cell)
+        {
+            next = IntersectCellBoundary(origin, direction, cell, cellCount, crossStep, crossOffset);
+            level = min(level + 2, hiZLevelCount - 1);
+        }
+        position = next;
+        level--;
+    }
+
+    hit = position;
+    if(level >= 0)
+    {
+        return false;
+    }
+    float surface = texelFetch(hiZTexture, ivec2(position.xy * vec2(textureSize(hiZTexture, 0))), 0).r;
+    return (LinearDepth(position.z) - LinearDepth(surface)) < thickness;
+}
+
+// the baseline, marching one texel of the first pyramid level at a time
+bool LinearTrace(vec3 start, vec3 ray, out vec3 hit, out int iterations)
+{
+    vec2 cellCount = vec2(textureSize(hiZTexture, 0));
+    float texels = max(abs(ray.x) * cellCount.x, abs(ray.y) * cellCount.y);
+    int steps = int(min(texels, float(linearSteps)));
+    vec3 stepSize = ray / max(float(steps), 1.0f);
+    vec3 position = start + stepSize;
+    hit = position;
+    for(iterations = 0; iterations < steps; iterations++)
+    {
+        if(any(lessThan(position.xy, vec2(0.0f))) || any(greaterThanEqual(position.xy, vec2(1.0f))))
+        {
+            return false;
+        }
+
+        float surface = texelFetch(hiZTexture, ivec2(position.xy * cellCount), 0).r;
+        if((position.z >= surface) && ((LinearDepth(position.z) - LinearDepth(surface)) < thickness))
+        {
+            hit = position;
+            return true;
+        }
+        position += stepSize;
+    }
+    return false;
+}
+
+// the sky along a world direction, with the mapping of the fragment shader
+vec3 SkyProbe(vec3 direction)
+{
+    float horizonCos = sqrt((skyViewHeight * skyViewHeight) - (skyGroundRadius * skyGroundRadius)) / skyViewHeight;
+    float beta = acos(horizonCos);
+    float zenithHorizonAngle = PI - beta;
+    float zenithAngle = acos(clamp(direction.y, -1.0f, 1.0f));
+
+    vec2 uv;
+    if(zenithAngle < zenithHorizonAngle)
+    {
+        uv.y = (1.0f - sqrt(max(1.0f - (zenithAngle / zenithHorizonAngle), 0.0f))) * 0.5f;
+    }
+    else
+    {
+        uv.y = (sqrt(clamp((zenithAngle - zenithHorizonAngle) / beta, 0.0f, 1.0f)) * 0.5f) + 0.5f;
+    }
+    float flatLengths = length(direction.xz) * length(skySunDirection.xz);
+    float azimuthCos = (flatLengths > 0.000001f) ? dot(direction.xz, skySunDirection.xz) / flatLengths : 1.0f;
+    uv.x = acos(clamp(azimuthCos, -1.0f, 1.0f)) / PI;
+
+    return vec3(1.0f) - exp(-textureLod(skyViewTable, uv, 0.0f).rgb * skyExposure);
+}
+
+// trace the reflection of a pixel at half resolution, spreading the rays
+// of rough surfaces differently every frame, and blend it with the
+// reflection reprojected from the last frame
+void TraceReflection(ivec2 texel, ivec2 size)
+{
+    vec2 uv = (vec2(texel) + 0.5f) / vec2(size);
+    ivec2 fullSize = textureSize(sceneDepth, 0);
+    ivec2 fullTexel = min(ivec2(uv * vec2(fullSize)), fullSize - 1);
+    float depth = texelFetch(sceneDepth, fullTexel, 0).r;
+    vec4 surface = texelFetch(sceneSurface, fullTexel, 0);
+    if((depth >= 1.0f) || (surface.w <= 0.0f) || (surface.z > maxRoughness))
+    {
+        imageStore(reflectionImage, texel, vec4(0.0f));
+        return;
+    }
+
+    vec3 position = ViewPosition(uv, depth);
+    vec3 normal = normalize(mat3(view) * DecodeNormal(surface.xy));
+    uint state = Hash(uint(texel.x) + Hash(uint(texel.y) + Hash(frameIndex)));
+    vec3 jitter = vec3(Random(state), Random(state), Random(state)) - 0.5f;
+    normal = normalize(normal + (jitter * (surface.z * surface.z * 2.0f)));
+    vec3 direction = reflect(normalize(position), normal);
+
+    // keep the end of the ray in front of the near plane
+    float rayLength = maxDistance;
+    float nearPlane = projection[3][2] / (projection[2][2] - 1.0f);
+    if(direction.z > 0.0f)
+    {
+        rayLength = min(rayLength, 0.99f * (-nearPlane - position.z) / direction.z);
+    }
+    vec3 start = ScreenPosition(position);
+    vec3 ray = ScreenPosition(position + (direction * rayLength)) - start;
+
+    vec3 hit;
+    int iterations;
+    bool bHit = ((bLinearMarch == false) && (ray.z > 0.0f)) ? HiZTrace(start, ray, hit, iterations) :
+                                                               LinearTrace(start, ray, hit, iterations);
+
+    vec3 probe = (bSkyProbe == true) ? SkyProbe(mat3(inverseView) * direction) : probeColor;
+    vec3 reflection = probe;
+    if(bHit == true)
+    {
+        // fade toward the probe where the hit nears the edge of the screen
+        vec2 edge = abs((hit.xy * 2.0f) - 1.0f);
+        float confidence = 1.0f - smoothstep(0.85f, 1.0f, max(edge.x, edge.y));
+        reflection = mix(probe, textureLod(sceneColor, hit.xy, 0.0f).rgb, confidence);
+    }
+
+    vec4 world = inverseView * vec4(position, 1.0f);
+    vec4 previousClip = previousViewProjection * world;
+    vec2 previousUV = ((previousClip.xy / previousClip.w) * 0.5f) + 0.5f;
+    if((bHistory == true) && (previousClip.w > 0.0f) &&
+       all(greaterThanEqual(previousUV, vec2(0.0f))) && all(lessThan(previousUV, vec2(1.0f))))
+    {
+        vec4 history = textureLod(reflectionTexture, previousUV, 0.0f);
+        if(history.a > 0.0f)
+        {
+            reflection = mix(reflection, history.rgb / history.a, historyWeight);
+        }
+    }
+    imageStore(reflectionImage, texel, vec4(reflection, 1.0f));
+}
+
+// blend the reflections into a pixel of the scene by its specular strength,
+// the Fresnel effect and how smooth it is
+void CompositeReflection(ivec2 texel, ivec2 size)
+{
+    float depth = texelFetch(sceneDepth, texel, 0).r;
+    vec4 surface = texelFetch(sceneSurface, texel, 0);
+    if((depth >= 1.0f) || (surface.w <= 0.0f) || (surface.z > maxRoughness))
+    {
+        return;
+    }
+
+    vec2 uv = (vec2(texel) + 0.5f) / vec2(size);
+    vec4 reflection = textureLod(reflectionTexture, uv, 0.0f);
+    if(reflection.a <= 0.0f)
+    {
+        return;
+    }
+
+    vec3 position = ViewPosition(uv, depth);
+    vec3 normal = normalize(mat3(view) * DecodeNormal(surface.xy));
+    float facing = max(dot(normal, -normalize(position)), 0.0f);
+    float fresnel = facingReflectance + ((1.0f - facingReflectance) * pow(1.0f - facing, 5.0f));
+    float smoothness = 1.0f - smoothstep(maxRoughness * 0.5f, maxRoughness, surface.z);
+    float weight = clamp(surface.w * fresnel * smoothness, 0.0f, 1.0f);
+
+    vec4 color = imageLoad(sceneColorImage, texel);
+    color.rgb = mix(color.rgb, reflection.rgb / reflection.a, weight);
+    imageStore(sceneColorImage, texel, color);
+}
+
+void main()
+{
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    if(reflectionPass <= 1)
+    {
+        ivec2 size = imageSize(hiZWriteImage);
+        ivec2 belowSize = (reflectionPass == 0) ? textureSize(sceneDepth, 0) : imageSize(hiZReadImage);
+        if((texel.x < size.x) && (texel.y < size.y))
+        {
+            imageStore(hiZWriteImage, texel, vec4(MinimumBelow(texel, size, belowSize)));
+        }
+    }
+    else if(reflectionPass == 2)
+    {
+        ivec2 size = imageSize(reflectionImage);
+        if((texel.x < size.x) && (texel.y < size.y))
+        {
+            TraceReflection(texel, size);
+        }
+    }
+    else
+    {
+        ivec2 size = imageSize(sceneColorImage);
+        if((texel.x < size.x) && (texel.y < size.y))
+        {
+            CompositeReflection(texel, size);
+        }
+    }
+}
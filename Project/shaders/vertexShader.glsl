@@ -2,19 +2,359 @@
 layout (location = 0) in vec3 inVertexPosition;
 layout (location = 1) in vec3 inVertexNormal;
 layout (location = 2) in vec2 inTextureCoordinate;
+// per-instance values of a vertex animated school - position and
+// heading, then scale, cycle time offset and cycle speed; a lake
+// tile reads its corner, side and coarse edges from the first, and
+// a terrain node its corner, side and tile slot, then the distances
+// its vertices morph between, and a foliage clump its root and heading,
+// then its height, blade width, sway phase and kind
+layout (location = 3) in vec4 inInstancePositionHeading;
+layout (location = 4) in vec4 inInstanceScaleTimeSpeed;
 
 out vec3 fragmentPosition;
 out vec3 fragmentVertexNormal;
 out vec2 fragmentTextureCoordinate;
+// per-vertex lighting, scaled by the base color in the fragment shader
+out vec3 gouraudLight;
+// per-vertex specular, added unscaled in the fragment shader
+out vec3 gouraudSpecular;
+
+// the depth pre-pass and the shading pass must produce identical depth
+invariant gl_Position;
+
+struct Material {
+    vec3 diffuseColor;
+    vec3 specularColor;
+    float shininess;
+
+    // procedural surface in place of the texture, 0 when not used
+    int proceduralType;
+    vec3 proceduralColorA;
+    vec3 proceduralColorB;
+    vec4 proceduralParams;
+}; 
+
+struct DirectionalLight {
+    vec3 direction;
+	
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+
+    bool bActive;
+};
+
+struct PointLight {
+    vec3 position;
+
+    float constant;
+    float linear;
+    float quadratic;
+    
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+
+    bool bActive;
+};
+
+#define TOTAL_POINT_LIGHTS 5
+// a point light is culled from an object where its attenuation falls to
+// this fraction, matching g_LightCutoffAttenuation in SceneManager.cpp,
+// so it fades out to nothing there
+const float POINT_LIGHT_CUTOFF = 1.0f / 256.0f;
 
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
+uniform bool bUseLighting=false;
+uniform bool bVertexLighting=false;
+uniform vec3 viewPosition;
+uniform DirectionalLight directionalLight;
+uniform PointLight pointLights[TOTAL_POINT_LIGHTS];
+uniform int pointLightCount = 0;
+uniform int pointLightIndices[TOTAL_POINT_LIGHTS];
+uniform Material material;
+
+// baked vertex animation, one texel per vertex and one row per frame
+uniform bool bVertexAnimation=false;
+uniform sampler2D vertexAnimationPositions;
+uniform sampler2D vertexAnimationNormals;
+uniform int vertexAnimationFrameCount = 1;
+uniform float vertexAnimationDuration = 1.0f;
+uniform float vertexAnimationTime = 0.0f;
+
+// lake tiles displaced by the simulated waves, which repeat every patch
+uniform bool bWaterSurface=false;
+uniform sampler2D waterDisplacements;
+uniform float waterPatchSize = 1.0f;
+uniform int waterTileResolution = 1;
+
+// terrain nodes, one grid each, reading the heights from their tile in
+// the cache, which holds the range of heights and a border of one sample
+uniform bool bTerrain=false;
+uniform sampler2DArray terrainHeights;
+uniform int terrainGridResolution = 1;
+uniform vec2 terrainHeightRange = vec2(0.0f, 1.0f);
+
+// clumps of grass and reeds scattered on the terrain, swaying in the wind
+uniform bool bFoliage=false;
+uniform float foliageTime = 0.0f;
+uniform vec2 foliageWindDirection = vec2(1.0f, 0.0f);
+uniform float foliageWindStrength = 0.0f;
+
+// fishing lines streamed as points, the w component being 1 where a
+// segment starts; the ribbons are at least one pixel wide, a pixel being
+// fishingLinePixelScale wide at a distance of one
+uniform bool bFishingLine=false;
+uniform samplerBuffer fishingLinePoints;
+uniform float fishingLineRadius = 0.01f;
+uniform float fishingLinePixelScale = 0.0f;
+// end of the segment and side of the ribbon of the six vertices drawn
+// for each segment, making two triangles
+const int fishingLineEnds[6] = int[6](0, 0, 1, 1, 0, 1);
+const float fishingLineSides[6] = float[6](-1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f);
+
+// the sky, one triangle covering the screen at the far plane made from
+// the vertex index, passing the world direction of its corners on
+uniform bool bSky=false;
+
+// function prototypes
+void CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir, inout vec3 baseLight, inout vec3 specularLight);
+void CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, inout vec3 baseLight, inout vec3 specularLight);
+float CalcPointAttenuation(PointLight light, vec3 fragPos);
+float TerrainHeight(vec2 gridPosition, float slot);
+
 void main()
 {
-   fragmentPosition = vec3(model * vec4(inVertexPosition, 1.0));
-   gl_Position = projection * view * model * vec4(inVertexPosition, 1.0f);
-   fragmentVertexNormal = inVertexNormal;
-   fragmentTextureCoordinate = inTextureCoordinate;
-}
\ No newline at end of file
+   vec3 vertexPosition = inVertexPosition;
+   vec3 vertexNormal = inVertexNormal;
+   vec2 textureCoordinate = inTextureCoordinate;
+   mat4 objectMatrix = model;
+
+   // the view direction through a corner of the screen is interpolated
+   // linearly across it, as the projection has no offset
+   if(bSky == true)
+   {
+      vec2 corner = (vec2(float((gl_VertexID << 1) & 2), float(gl_VertexID & 2)) * 2.0f) - 1.0f;
+      vec3 viewDirection = vec3(corner.x / projection[0][0], corner.y / projection[1][1], -1.0f);
+      fragmentPosition = transpose(mat3(view)) * viewDirection;
+      fragmentVertexNormal = vec3(0.0f, 1.0f, 0.0f);
+      fragmentTextureCoordinate = vec2(0.0f);
+      gouraudLight = vec3(0.0f);
+      gouraudSpecular = vec3(0.0f);
+      gl_Position = vec4(corner, 1.0f, 1.0f);
+      return;
+   }
+
+   // the instances of a school fetch the two baked frames around their
+   // own time in the cycle and blend them, then are turned to their
+   // heading, scaled and moved to their position
+   if(bVertexAnimation == true)
+   {
+      float cycle = (vertexAnimationTime * inInstanceScaleTimeSpeed.z) + inInstanceScaleTimeSpeed.y;
+      float frame = fract(cycle / vertexAnimationDuration) * float(vertexAnimationFrameCount);
+      int frame0 = int(frame) % vertexAnimationFrameCount;
+      int frame1 = (frame0 + 1) % vertexAnimationFrameCount;
+      float blend = fract(frame);
+      vertexPosition = mix(texelFetch(vertexAnimationPositions, ivec2(gl_VertexID, frame0), 0).xyz,
+                           texelFetch(vertexAnimationPositions, ivec2(gl_VertexID, frame1), 0).xyz, blend);
+      vertexNormal = mix(texelFetch(vertexAnimationNormals, ivec2(gl_VertexID, frame0), 0).xyz,
+                         texelFetch(vertexAnimationNormals, ivec2(gl_VertexID, frame1), 0).xyz, blend);
+
+      float headingCos = cos(inInstancePositionHeading.w);
+      float headingSin = sin(inInstancePositionHeading.w);
+      float scale = inInstanceScaleTimeSpeed.x;
+      mat4 instanceMatrix = mat4(
+         vec4(headingCos * scale, 0.0f, -headingSin * scale, 0.0f),
+         vec4(0.0f, scale, 0.0f, 0.0f),
+         vec4(headingSin * scale, 0.0f, headingCos * scale, 0.0f),
+         vec4(inInstancePositionHeading.xyz, 1.0f));
+      objectMatrix = model * instanceMatrix;
+      vertexNormal = mat3(instanceMatrix) * vertexNormal;
+   }
+
+   // a lake tile is placed around the camera and displaced by the waves
+   // at its world position; the odd vertices along an edge bordering a
+   // coarser tile take the mean of their neighbors, so they stay on the
+   // coarse edge and no cracks open between the rings
+   if(bWaterSurface == true)
+   {
+      vec2 worldXZ = inInstancePositionHeading.xy + (inVertexPosition.xz * inInstancePositionHeading.z);
+      int coarseEdges = int(inInstancePositionHeading.w + 0.5f);
+      ivec2 cell = ivec2(inVertexPosition.xz * float(waterTileResolution) + 0.5f);
+      float spacing = inInstancePositionHeading.z / float(waterTileResolution);
+      vec2 uv = worldXZ / waterPatchSize;
+      vec3 displacement = textureLod(waterDisplacements, uv, 0.0f).xyz;
+
+      bool bAlongZ = ((((coarseEdges & 1) != 0) && (cell.x == 0)) || (((coarseEdges & 2) != 0) && (cell.x == waterTileResolution))) && ((cell.y & 1) == 1);
+      bool bAlongX = ((((coarseEdges & 4) != 0) && (cell.y == 0)) || (((coarseEdges & 8) != 0) && (cell.y == waterTileResolution))) && ((cell.x & 1) == 1);
+      if(bAlongZ == true || bAlongX == true)
+      {
+         vec2 neighbor = (bAlongZ == true) ? vec2(0.0f, spacing) : vec2(spacing, 0.0f);
+         displacement = 0.5f * (textureLod(waterDisplacements, (worldXZ - neighbor) / waterPatchSize, 0.0f).xyz +
+                                textureLod(waterDisplacements, (worldXZ + neighbor) / waterPatchSize, 0.0f).xyz);
+      }
+
+      vertexPosition = vec3(worldXZ.x, 0.0f, worldXZ.y) + displacement;
+      vertexNormal = vec3(0.0f, 1.0f, 0.0f);
+      textureCoordinate = uv;
+   }
+
+   // a terrain vertex morphs toward the grid of the next coarser level
+   // with its distance from the camera, the odd vertices sliding onto
+   // their even neighbors, so it matches the coarser node beside it by
+   // the end of the range of its level
+   if(bTerrain == true)
+   {
+      float size = inInstancePositionHeading.z;
+      float slot = inInstancePositionHeading.w;
+      float resolution = float(terrainGridResolution);
+      float spacing = size / resolution;
+      vec2 gridPosition = floor((inVertexPosition.xz * resolution) + 0.5f);
+      vec2 worldXZ = inInstancePositionHeading.xy + (gridPosition * spacing);
+      vec3 unmorphed = vec3(worldXZ.x, TerrainHeight(gridPosition, slot), worldXZ.y);
+      float morph = clamp((distance(viewPosition, unmorphed) - inInstanceScaleTimeSpeed.x) /
+                          (inInstanceScaleTimeSpeed.y - inInstanceScaleTimeSpeed.x), 0.0f, 1.0f);
+
+      gridPosition -= mod(gridPosition, 2.0f) * morph;
+      worldXZ = inInstancePositionHeading.xy + (gridPosition * spacing);
+      float slopeX = TerrainHeight(gridPosition + vec2(1.0f, 0.0f), slot) - TerrainHeight(gridPosition - vec2(1.0f, 0.0f), slot);
+      float slopeZ = TerrainHeight(gridPosition + vec2(0.0f, 1.0f), slot) - TerrainHeight(gridPosition - vec2(0.0f, 1.0f), slot);
+
+      vertexPosition = vec3(worldXZ.x, TerrainHeight(gridPosition, slot), worldXZ.y);
+      vertexNormal = normalize(vec3(-slopeX, 2.0f * spacing, -slopeZ));
+      textureCoordinate = worldXZ;
+   }
+
+   // a foliage clump is turned to its heading and scaled, its blades
+   // leaning out and swaying in the wind more the higher up they are,
+   // gusts rolling across the ground and every clump at its own phase
+   if(bFoliage == true)
+   {
+      vec3 root = inInstancePositionHeading.xyz;
+      float heading = inInstancePositionHeading.w;
+      float clumpHeight = inInstanceScaleTimeSpeed.x;
+      float bend = inVertexPosition.y * inVertexPosition.y;
+      mat2 turn = mat2(cos(heading), sin(heading), -sin(heading), cos(heading));
+      vec2 across = turn * (inVertexPosition.xz * inInstanceScaleTimeSpeed.y);
+      vec2 facing = turn * inVertexNormal.xz;
+      float gust = sin((foliageTime * 1.8f) + inInstanceScaleTimeSpeed.z + (dot(root.xz, foliageWindDirection) * 0.2f));
+      vec2 sway = foliageWindDirection * (foliageWindStrength * (0.6f + (0.4f * gust)));
+      vec2 offset = across + (((facing * 0.25f) + sway) * (bend * clumpHeight));
+
+      vertexPosition = root + vec3(offset.x, inVertexPosition.y * clumpHeight, offset.y);
+      vertexNormal = normalize(vec3(facing.x + sway.x, 0.8f, facing.y + sway.y));
+      textureCoordinate = vec2(inInstanceScaleTimeSpeed.w, inVertexPosition.y);
+   }
+
+   // a fishing line point is found from the vertex index and pushed
+   // sideways to the camera along the line through its neighbors; the
+   // segment from the end of one line to the start of the next collapses
+   if(bFishingLine == true)
+   {
+      int segment = gl_VertexID / 6;
+      int corner = gl_VertexID % 6;
+      int pointIndex = segment + fishingLineEnds[corner];
+      vec4 point = texelFetch(fishingLinePoints, pointIndex);
+      vec3 previousPoint = point.xyz;
+      if(pointIndex > 0)
+      {
+         vec4 previous = texelFetch(fishingLinePoints, pointIndex - 1);
+         previousPoint = (previous.w > 0.5f) ? previous.xyz : point.xyz;
+      }
+      vec3 nextPoint = (point.w > 0.5f) ? texelFetch(fishingLinePoints, pointIndex + 1).xyz : point.xyz;
+
+      vec3 tangent = normalize(nextPoint - previousPoint);
+      vec3 toCamera = viewPosition - point.xyz;
+      vec3 viewDir = normalize(toCamera);
+      vec3 across = cross(tangent, viewDir);
+      across = (dot(across, across) > 0.000001f) ? normalize(across) : vec3(0.0f);
+      float halfWidth = max(fishingLineRadius, 0.5f * fishingLinePixelScale * length(toCamera));
+      float side = fishingLineSides[corner];
+      if(texelFetch(fishingLinePoints, segment).w < 0.5f)
+      {
+         side = 0.0f;
+      }
+
+      vertexPosition = point.xyz + (across * (side * halfWidth));
+      vertexNormal = viewDir - (tangent * dot(viewDir, tangent));
+      textureCoordinate = vec2((side * 0.5f) + 0.5f, float(pointIndex));
+   }
+
+   fragmentPosition = vec3(objectMatrix * vec4(vertexPosition, 1.0));
+   gl_Position = projection * view * objectMatrix * vec4(vertexPosition, 1.0f);
+   fragmentVertexNormal = vertexNormal;
+   fragmentTextureCoordinate = textureCoordinate;
+
+   gouraudLight = vec3(0.0f);
+   gouraudSpecular = vec3(0.0f);
+
+   // small and distant objects evaluate the directional and point lights
+   // once per vertex, and the results are interpolated across each triangle
+   if(bUseLighting == true && bVertexLighting == true)
+   {
+      vec3 norm = normalize(vertexNormal);
+      vec3 viewDir = normalize(viewPosition - fragmentPosition);
+
+      if(directionalLight.bActive == true)
+      {
+         CalcDirectionalLight(directionalLight, norm, viewDir, gouraudLight, gouraudSpecular);
+      }
+      for(int i = 0; i < pointLightCount; i++)
+      {
+         int lightIndex = pointLightIndices[i];
+         if(pointLights[lightIndex].bActive == true)
+         {
+            CalcPointLight(pointLights[lightIndex], norm, fragmentPosition, viewDir, gouraudLight, gouraudSpecular);
+         }
+      }
+   }
+}
+
+// height of the terrain at a position on the grid of a node, filtered
+// between the samples of its tile
+float TerrainHeight(vec2 gridPosition, float slot)
+{
+   float tileSize = float(textureSize(terrainHeights, 0).x);
+   vec2 uv = (gridPosition + 1.5f) / tileSize;
+   return mix(terrainHeightRange.x, terrainHeightRange.y, textureLod(terrainHeights, vec3(uv, slot), 0.0f).r);
+}
+
+// same math as the fragment shader version, with the base color factored out
+void CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir, inout vec3 baseLight, inout vec3 specularLight)
+{
+    vec3 lightDirection = normalize(-light.direction);
+    // diffuse shading
+    float diff = max(dot(normal, lightDirection), 0.0);
+    // specular shading
+    vec3 reflectDir = reflect(-lightDirection, normal);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    // combine results - all three terms are scaled by the base color
+    baseLight += light.ambient + (light.diffuse * diff * material.diffuseColor) + (light.specular * spec * material.specularColor);
+}
+
+// same math as the fragment shader version, with the base color factored out
+void CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, inout vec3 baseLight, inout vec3 specularLight)
+{
+    vec3 lightDir = normalize(light.position - fragPos);
+    // diffuse shading
+    float diff = max(dot(normal, lightDir), 0.0);
+    // specular shading
+    vec3 reflectDir = reflect(-lightDir, normal);
+    float specularComponent = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    // attenuation
+    float attenuation = CalcPointAttenuation(light, fragPos);
+    // combine results - the specular term is not scaled by the base color
+    baseLight += (light.ambient + (light.diffuse * diff * material.diffuseColor)) * attenuation;
+    specularLight += light.specular * specularComponent * material.specularColor * attenuation;
+}
+
+// same math as the fragment shader version
+float CalcPointAttenuation(PointLight light, vec3 fragPos)
+{
+    float distance = length(light.position - fragPos);
+    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+    return max((attenuation - POINT_LIGHT_CUTOFF) / (1.0 - POINT_LIGHT_CUTOFF), 0.0);
+}